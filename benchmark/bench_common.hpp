@@ -0,0 +1,74 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <qtest.h>
+
+#include "data_series.hpp"
+
+
+/*
+ * Largest sample count of the data-driven benchmarks (1e7, unless the environment variable
+ * LUMBERJACK_BENCHMARK_MAX_POINTS is set, e.g. to 1e8 on a machine with enough memory)
+ */
+inline qint64 getBenchmarkMaxPoints(void)
+{
+    if (qEnvironmentVariableIsSet("LUMBERJACK_BENCHMARK_MAX_POINTS"))
+    {
+        return (qint64) qEnvironmentVariable("LUMBERJACK_BENCHMARK_MAX_POINTS").toDouble();
+    }
+
+    return 10000000;
+}
+
+
+/*
+ * Add a row for each sample count, from 1e4 up to the maximum (or the limit, if smaller)
+ */
+inline void addBenchmarkSizes(qint64 limit = 0)
+{
+    QTest::addColumn<qint64>("points");
+
+    const qint64 maximum = limit > 0 ? std::min(limit, getBenchmarkMaxPoints()) : getBenchmarkMaxPoints();
+
+    for (qint64 n = 10000; n <= maximum; n *= 10)
+    {
+        QTest::newRow(QByteArray::number(n).constData()) << n;
+    }
+}
+
+
+/*
+ * Fill a series with a noisy sine wave, sampled every millisecond
+ */
+inline void fillBenchmarkSeries(DataSeries &series, qint64 n)
+{
+    series.clearData(false);
+
+    const size_t CHUNK = 1 << 16;
+
+    std::vector<double> t(CHUNK);
+    std::vector<double> v(CHUNK);
+
+    for (qint64 first = 0; first < n; first += CHUNK)
+    {
+        const size_t count = (size_t) std::min<qint64>(CHUNK, n - first);
+
+        for (size_t ii = 0; ii < count; ii++)
+        {
+            const qint64 idx = first + ii;
+
+            t[ii] = (double) idx;
+            v[ii] = std::sin(idx * 1e-3) * 100 + (double) ((idx * 7919) % 13);
+        }
+
+        series.addData(t.data(), v.data(), count, false);
+    }
+}
+
+
+#endif // BENCH_COMMON_HPP
@@ -0,0 +1,168 @@
+#ifndef BENCH_CSV_HPP
+#define BENCH_CSV_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "bench_common.hpp"
+#include "lumberjack_csv_importer.hpp"
+#include "lumberjack_csv_exporter.hpp"
+#include "synthetic_generator.hpp"
+
+
+class CSVBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    // Files of the largest sizes are several GB, so they are not generated
+    void benchImport_data(void) { addBenchmarkSizes(1000000); }
+    void benchImport(void)
+    {
+        QFETCH(qint64, points);
+
+        QTemporaryDir dir;
+
+        const QString filename = dir.filePath("import.csv");
+
+        QVERIFY(writeFile(filename, points));
+
+        int columns = 0;
+
+        QBENCHMARK
+        {
+            LumberjackCSVImporter importer;
+            QStringList errors;
+
+            importer.setFilename(filename);
+
+            QVERIFY(importer.importData(errors));
+
+            columns = importer.getDataSeries().count();
+        }
+
+        QCOMPARE(columns, (int) COLUMNS);
+    }
+
+    // An irregular log: jittered, with gaps, out-of-order samples and missing values
+    void benchImportSynthetic_data(void) { addBenchmarkSizes(1000000); }
+    void benchImportSynthetic(void)
+    {
+        QFETCH(qint64, points);
+
+        QTemporaryDir dir;
+
+        const QString filename = dir.filePath("synthetic.csv");
+
+        SyntheticGenerator::Options options;
+
+        options.channels = COLUMNS;
+        options.rate = 1000;
+        options.duration = points / options.rate;
+        options.jitter = 0.2;
+        options.gapFraction = 0.05;
+        options.outOfOrderFraction = 0.001;
+        options.nanFraction = 0.01;
+
+        QStringList errors;
+
+        QVERIFY(SyntheticGenerator(options).writeCSV(filename, errors));
+
+        int columns = 0;
+
+        QBENCHMARK
+        {
+            LumberjackCSVImporter importer;
+
+            importer.setFilename(filename);
+
+            QVERIFY(importer.importData(errors));
+
+            columns = importer.getDataSeries().count();
+        }
+
+        QCOMPARE(columns, (int) COLUMNS);
+    }
+
+    void benchExport_data(void) { addBenchmarkSizes(1000000); }
+    void benchExport(void)
+    {
+        QFETCH(qint64, points);
+
+        QTemporaryDir dir;
+
+        QList<DataSeriesPointer> series;
+
+        for (int col = 0; col < COLUMNS; col++)
+        {
+            auto s = DataSeriesPointer(new DataSeries(QString("column %1").arg(col)));
+
+            fillBenchmarkSeries(*s, points);
+            s->setScaler(col + 1, false);
+
+            series.append(s);
+        }
+
+        QBENCHMARK
+        {
+            LumberjackCSVExporter exporter;
+            QStringList errors;
+
+            exporter.setFilename(dir.filePath("export.csv"));
+
+            QVERIFY(exporter.exportData(series, errors));
+        }
+
+        QVERIFY(QFile(dir.filePath("export.csv")).size() > points);
+    }
+
+protected:
+    static const int COLUMNS = 4;
+
+    //! Generate a file with a timestamp column and COLUMNS data columns
+    static bool writeFile(const QString &filename, qint64 rows)
+    {
+        QFile file(filename);
+
+        if (!file.open(QIODevice::WriteOnly)) return false;
+
+        QByteArray buffer = "time";
+
+        for (int col = 0; col < COLUMNS; col++)
+        {
+            buffer += ",column " + QByteArray::number(col);
+        }
+
+        buffer += "\n";
+
+        for (qint64 row = 0; row < rows; row++)
+        {
+            buffer += QByteArray::number(row * 1e-3, 'f', 3);
+
+            for (int col = 0; col < COLUMNS; col++)
+            {
+                buffer += ',';
+                buffer += QByteArray::number(std::sin(row * 1e-3 * (col + 1)) * 100, 'g', 8);
+            }
+
+            buffer += '\n';
+
+            if (buffer.size() > (1 << 20))
+            {
+                file.write(buffer);
+                buffer.clear();
+            }
+        }
+
+        file.write(buffer);
+
+        return true;
+    }
+};
+
+
+#endif // BENCH_CSV_HPP
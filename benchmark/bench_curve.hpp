@@ -0,0 +1,110 @@
+#ifndef BENCH_CURVE_HPP
+#define BENCH_CURVE_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include "bench_common.hpp"
+#include "plot_sampler.hpp"
+#include "fft_sampler.hpp"
+
+
+class PlotCurveBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void benchCurveSamples_data(void)
+    {
+        QTest::addColumn<qint64>("points");
+        QTest::addColumn<double>("zoom");
+        QTest::addColumn<int>("mode");
+
+        const struct { const char *name; int mode; } modes[] = {
+            {"m4", PlotCurveUpdater::DOWNSAMPLE_M4},
+            {"lttb", PlotCurveUpdater::DOWNSAMPLE_LTTB},
+        };
+
+        // Fraction of the series which is visible
+        const double zooms[] = {1, 0.1, 0.001};
+
+        for (qint64 n = 10000; n <= getBenchmarkMaxPoints(); n *= 10)
+        {
+            for (const auto &m : modes)
+            {
+                for (double zoom : zooms)
+                {
+                    QTest::newRow(QString("%1/%2/%3").arg(n).arg(m.name).arg(zoom).toLatin1().constData()) << n << zoom << m.mode;
+                }
+            }
+        }
+    }
+
+    void benchCurveSamples(void)
+    {
+        QFETCH(qint64, points);
+        QFETCH(double, zoom);
+        QFETCH(int, mode);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        PlotCurveUpdater updater(series);
+
+        updater.setDownsampleMode(mode);
+
+        size_t samples = 0;
+
+        connect(&updater, &PlotCurveUpdater::sampleComplete, [&samples](PlotSamplesPointer result, double, double) {
+            if (result) samples = result->size();
+        });
+
+        const double span = points * zoom;
+        const double t_min = (points - span) / 2;
+
+        // Each iteration pans the view, so resampled results are not re-used
+        int step = 0;
+
+        QBENCHMARK
+        {
+            const double offset = span * 0.01 * (step++ % 10);
+
+            updater.updateCurveSamples(t_min + offset, t_min + offset + span, 1920);
+        }
+
+        QVERIFY(samples > 0);
+    }
+
+    void benchFFTSamples_data(void) { addBenchmarkSizes(); }
+    void benchFFTSamples(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        FFTCurveUpdater updater(series);
+
+        size_t samples = 0;
+
+        connect(&updater, &FFTCurveUpdater::sampleComplete, [&samples](PlotSamplesPointer result, double, double) {
+            if (result) samples = result->size();
+        });
+
+        QBENCHMARK
+        {
+            // Spectra are cached, so each iteration computes the spectrum again
+            FFTCurveUpdater::clearSpectrumCache();
+
+            updater.updateCurveSamples(0, (double) points, 0);
+        }
+
+        QVERIFY(samples > 0);
+    }
+};
+
+
+#endif // BENCH_CURVE_HPP
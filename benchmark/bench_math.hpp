@@ -0,0 +1,117 @@
+#ifndef BENCH_MATH_HPP
+#define BENCH_MATH_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include "bench_common.hpp"
+#include "math_expression_parser.hpp"
+#include "math_trace_computer.hpp"
+
+
+class MathBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void benchEvaluate_data(void) { addBenchmarkSizes(1000000); }
+    void benchEvaluate(void)
+    {
+        QFETCH(qint64, points);
+
+        MathExpressionParser parser;
+
+        QVERIFY(parser.parse("abs(sin(a) * cos(b)) / (c + 2) - a ^ 2"));
+
+        QMap<QString, double> variables;
+
+        double sum = 0;
+
+        QBENCHMARK
+        {
+            for (qint64 idx = 0; idx < points; idx++)
+            {
+                variables["a"] = idx * 1e-3;
+                variables["b"] = idx * 2e-3;
+                variables["c"] = (double) (idx % 7);
+
+                double result = 0;
+
+                if (parser.evaluate(variables, result)) sum += result;
+            }
+        }
+
+        QVERIFY(!std::isnan(sum));
+    }
+
+    void benchEvaluateBlock_data(void) { addBenchmarkSizes(); }
+    void benchEvaluateBlock(void)
+    {
+        QFETCH(qint64, points);
+
+        MathExpressionParser parser;
+        MathProgram program;
+
+        QStringList names;
+        names << "a" << "b" << "c";
+
+        QVERIFY(parser.parse("abs(sin(a) * cos(b)) / (c + 2) - a ^ 2"));
+        QVERIFY(parser.compile(names, program));
+
+        std::vector<double> columns[3];
+
+        for (auto &column : columns) column.resize(points);
+
+        for (qint64 idx = 0; idx < points; idx++)
+        {
+            columns[0][idx] = idx * 1e-3;
+            columns[1][idx] = idx * 2e-3;
+            columns[2][idx] = (double) (idx % 7);
+        }
+
+        const double* inputs[] = {columns[0].data(), columns[1].data(), columns[2].data()};
+
+        std::vector<double> output(points);
+        std::vector<unsigned char> valid(points);
+
+        QBENCHMARK
+        {
+            std::fill(valid.begin(), valid.end(), 1);
+
+            program.evaluateBlock(inputs, points, output.data(), valid.data());
+        }
+    }
+
+    void benchMathTrace_data(void) { addBenchmarkSizes(); }
+    void benchMathTrace(void)
+    {
+        QFETCH(qint64, points);
+
+        auto a = DataSeriesPointer(new DataSeries("a"));
+        auto b = DataSeriesPointer(new DataSeries("b"));
+
+        fillBenchmarkSeries(*a, points);
+        fillBenchmarkSeries(*b, points);
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+        mapping["b"] = b;
+
+        auto output = MathDataSeriesPointer(new MathDataSeries("c", "a * b - 1", mapping));
+
+        QBENCHMARK
+        {
+            MathTraceComputer computer;
+
+            computer.compute("a * b - 1", mapping, output);
+            computer.startComputation();
+        }
+
+        QCOMPARE((qint64) output->size(), points);
+    }
+};
+
+
+#endif // BENCH_MATH_HPP
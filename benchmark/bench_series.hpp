@@ -0,0 +1,206 @@
+#ifndef BENCH_SERIES_HPP
+#define BENCH_SERIES_HPP
+
+#include <random>
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include "bench_common.hpp"
+#include "event_index.hpp"
+#include "histogram_engine.hpp"
+
+
+class DataSeriesBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void benchAddDataOrdered_data(void) { addBenchmarkSizes(); }
+    void benchAddDataOrdered(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        QBENCHMARK
+        {
+            series.clearData(false);
+
+            for (qint64 idx = 0; idx < points; idx++)
+            {
+                series.addData((double) idx, (double) (idx % 1000), false);
+            }
+        }
+
+        QCOMPARE((qint64) series.size(), points);
+    }
+
+    // Every out-of-order sample is merged into the series, so the largest sizes are not run
+    void benchAddDataRandom_data(void) { addBenchmarkSizes(1000000); }
+    void benchAddDataRandom(void)
+    {
+        QFETCH(qint64, points);
+
+        std::mt19937_64 rng(1234);
+        std::uniform_real_distribution<double> dist(0, (double) points);
+
+        std::vector<double> timestamps(points);
+
+        for (auto &t : timestamps) t = dist(rng);
+
+        DataSeries series;
+
+        QBENCHMARK
+        {
+            series.clearData(false);
+
+            for (qint64 idx = 0; idx < points; idx++)
+            {
+                series.addData(timestamps[idx], (double) (idx % 1000), false);
+            }
+
+            series.flush(false);
+        }
+
+        QCOMPARE((qint64) series.size(), points);
+    }
+
+    void benchIndexForTimestamp_data(void) { addBenchmarkSizes(); }
+    void benchIndexForTimestamp(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        const int LOOKUPS = 100000;
+
+        uint64_t total = 0;
+
+        QBENCHMARK
+        {
+            for (int idx = 0; idx < LOOKUPS; idx++)
+            {
+                total += series.getIndexForTimestamp((double) ((idx * 7919LL) % points) + 0.5);
+            }
+        }
+
+        QVERIFY(total > 0);
+    }
+
+    void benchRangeStatistics_data(void) { addBenchmarkSizes(); }
+    void benchRangeStatistics(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        double sum = 0;
+
+        // Ranges which do not align with the blocks of the series
+        QBENCHMARK
+        {
+            for (int idx = 1; idx <= 100; idx++)
+            {
+                const double t_min = points * 0.004 * idx / 3;
+                const double t_max = points - t_min;
+
+                sum += series.getMinimumValue(t_min, t_max);
+                sum += series.getMaximumValue(t_min, t_max);
+                sum += series.getMeanValue(t_min, t_max);
+            }
+        }
+
+        QVERIFY(!std::isnan(sum));
+    }
+
+    void benchEventIndex_data(void) { addBenchmarkSizes(); }
+    void benchEventIndex(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        const DataSnapshot snapshot = series.getSnapshot();
+
+        size_t intervals = 0;
+
+        // Crossings only occur near the peaks of the sine, so most buckets are skipped
+        QBENCHMARK
+        {
+            intervals = EventIndex::build(snapshot, EventIndex::CONDITION_ABOVE, 105)->size();
+        }
+
+        QVERIFY(intervals > 0);
+    }
+
+    void benchAggregate_data(void) { addBenchmarkSizes(); }
+    void benchAggregate(void)
+    {
+        QFETCH(qint64, points);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        const DataSnapshot snapshot = series.getSnapshot();
+
+        double sum = 0;
+
+        // One bucket per pixel of a wide plot
+        QBENCHMARK
+        {
+            const auto result = snapshot.aggregate(points * 0.01, points * 0.99, 2000);
+
+            sum += result.mean[1000];
+        }
+
+        QVERIFY(!std::isnan(sum));
+    }
+
+    void benchHistogram_data(void)
+    {
+        QTest::addColumn<qint64>("points");
+        QTest::addColumn<bool>("exact");
+
+        for (qint64 n = 10000; n <= getBenchmarkMaxPoints(); n *= 10)
+        {
+            QTest::newRow(QString("%1/estimate").arg(n).toLatin1().constData()) << n << false;
+            QTest::newRow(QString("%1/exact").arg(n).toLatin1().constData()) << n << true;
+        }
+    }
+
+    void benchHistogram(void)
+    {
+        QFETCH(qint64, points);
+        QFETCH(bool, exact);
+
+        DataSeries series;
+
+        fillBenchmarkSeries(series, points);
+
+        const DataSnapshot snapshot = series.getSnapshot();
+
+        double total = 0;
+
+        // The estimate only visits the block summaries
+        QBENCHMARK
+        {
+            const auto result = HistogramEngine::computeHistogram(snapshot, points * 0.01, points * 0.99, HistogramEngine::DEFAULT_BINS, exact);
+
+            total += result.counts[0];
+        }
+
+        QVERIFY(total > 0);
+    }
+};
+
+
+#endif // BENCH_SERIES_HPP
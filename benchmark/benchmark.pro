@@ -0,0 +1,147 @@
+QT += core gui opengl testlib widgets
+
+greaterThan(QT_MAJOR_VERSION, 5): QT += openglwidgets
+
+CONFIG += c++17 console
+
+CONFIG -= app_bundle
+
+# Benchmarks are always optimised (results of a debug build are not comparable between releases)
+CONFIG -= debug
+CONFIG += release
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter -Wno-unused-variable -Wno-sign-compare -Wno-unused-but-set-variable
+QMAKE_CFLAGS += -Wno-unused-parameter -Wno-unused-variable -Wno-sign-compare -Wno-unused-but-set-variable
+
+# Dynamic linking for qwt libraries
+include(../qwt/qwt.prf)
+
+LIBS += -L../qwt/lib -lqwt
+
+INCLUDEPATH += ../qwt/src
+
+INCLUDEPATH += ../src
+INCLUDEPATH += ../src/widgets
+INCLUDEPATH += ../src/plugins
+INCLUDEPATH += ../plugins/csv_importer
+INCLUDEPATH += ../plugins/csv_exporter
+
+# Optional decompression libraries
+include(../src/decompression.pri)
+
+SOURCES += \
+    ../src/arrow_file.cpp \
+    ../src/data_block.cpp \
+    ../src/data_codec.cpp \
+    ../src/data_kernels.cpp \
+    ../src/data_store.cpp \
+    ../src/data_series.cpp \
+    ../src/data_source.cpp \
+    ../src/decompression_device.cpp \
+    ../src/event_index.cpp \
+    ../src/event_store.cpp \
+    ../src/filter_chain.cpp \
+    ../src/fft_engine.cpp \
+    ../src/fft_sampler.cpp \
+    ../src/gpu_compute.cpp \
+    ../src/histogram_engine.cpp \
+    ../src/hover_lookup.cpp \
+    ../src/import_arena.cpp \
+    ../src/import_cache.cpp \
+    ../src/import_sink.cpp \
+    ../src/label_registry.cpp \
+    ../src/lumberjack_debug.cpp \
+    ../src/math_data_series.cpp \
+    ../src/math_dependency_graph.cpp \
+    ../src/math_expression_parser.cpp \
+    ../src/math_sampler.cpp \
+    ../src/math_trace_cache.cpp \
+    ../src/math_trace_computer.cpp \
+    ../src/parallel_for.cpp \
+    ../src/parse_kernels.cpp \
+    ../src/plot_curve.cpp \
+    ../src/plot_opengl_canvas.cpp \
+    ../src/plugins/plugin_filter.cpp \
+    ../src/plugins/plugin_importer.cpp \
+    ../src/quantile_sketch.cpp \
+    ../src/series_file.cpp \
+    ../src/series_envelope.cpp \
+    ../src/series_search_index.cpp \
+    ../src/series_update_scheduler.cpp \
+    ../src/spectrogram_sampler.cpp \
+    ../src/stats_engine.cpp \
+    ../src/synthetic_generator.cpp \
+    ../src/text_export_pipeline.cpp \
+    ../src/trace_recorder.cpp \
+    ../src/widgets/plot_sampler.cpp \
+    ../plugins/csv_exporter/lumberjack_csv_exporter.cpp \
+    ../plugins/csv_importer/import_options_dialog.cpp \
+    ../plugins/csv_importer/lumberjack_csv_importer.cpp \
+    main.cpp \
+
+HEADERS += \
+    ../src/arrow_file.hpp \
+    ../src/data_block.hpp \
+    ../src/data_codec.hpp \
+    ../src/data_kernels.hpp \
+    ../src/data_store.hpp \
+    ../src/data_series.hpp \
+    ../src/data_source.hpp \
+    ../src/decompression_device.hpp \
+    ../src/event_index.hpp \
+    ../src/event_store.hpp \
+    ../src/filter_chain.hpp \
+    ../src/fft_engine.hpp \
+    ../src/fft_sampler.hpp \
+    ../src/gpu_compute.hpp \
+    ../src/histogram_engine.hpp \
+    ../src/hover_lookup.hpp \
+    ../src/import_arena.hpp \
+    ../src/import_cache.hpp \
+    ../src/import_sink.hpp \
+    ../src/label_registry.hpp \
+    ../src/lumberjack_debug.hpp \
+    ../src/math_data_series.hpp \
+    ../src/math_dependency_graph.hpp \
+    ../src/math_expression_parser.hpp \
+    ../src/math_sampler.hpp \
+    ../src/math_trace_cache.hpp \
+    ../src/math_trace_computer.hpp \
+    ../src/parallel_for.hpp \
+    ../src/parse_kernels.hpp \
+    ../src/lumberjack_version.hpp \
+    ../src/plot_curve.hpp \
+    ../src/plot_opengl_canvas.hpp \
+    ../src/cancellation_token.hpp \
+    ../src/plugins/plugin_base.hpp \
+    ../src/plugins/plugin_filter.hpp \
+    ../src/plugins/plugin_importer.hpp \
+    ../src/quantile_sketch.hpp \
+    ../src/series_file.hpp \
+    ../src/series_envelope.hpp \
+    ../src/series_search_index.hpp \
+    ../src/series_update_scheduler.hpp \
+    ../src/spectrogram_sampler.hpp \
+    ../src/stats_engine.hpp \
+    ../src/synthetic_generator.hpp \
+    ../src/text_export_pipeline.hpp \
+    ../src/time_ticks.hpp \
+    ../src/trace_recorder.hpp \
+    ../src/widgets/plot_sampler.hpp \
+    ../plugins/csv_exporter/lumberjack_csv_exporter.hpp \
+    ../plugins/csv_importer/csv_import_options.hpp \
+    ../plugins/csv_importer/import_options_dialog.hpp \
+    ../plugins/csv_importer/lumberjack_csv_importer.hpp \
+    bench_common.hpp \
+    bench_csv.hpp \
+    bench_curve.hpp \
+    bench_math.hpp \
+    bench_series.hpp
+
+FORMS += \
+    ../plugins/csv_importer/ui/csv_import_options.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
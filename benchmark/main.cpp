@@ -0,0 +1,51 @@
+#include <qtest.h>
+
+#include "bench_series.hpp"
+#include "bench_curve.hpp"
+#include "bench_math.hpp"
+#include "bench_csv.hpp"
+
+
+/*
+ * Run a benchmark class. Unless an output is specified on the command line, the results are printed,
+ * and also written (as QtTest XML) to benchmark_<name>.xml, so they can be tracked across releases.
+ */
+static int runBenchmark(QObject *benchmark, const char *name, int argc, char *argv[])
+{
+    QStringList args;
+
+    for (int ii = 0; ii < argc; ii++)
+    {
+        args << QString::fromLocal8Bit(argv[ii]);
+    }
+
+    if (!args.contains("-o"))
+    {
+        args << "-o" << QString("benchmark_%1.xml,xml").arg(name);
+        args << "-o" << "-,txt";
+    }
+
+    return QTest::qExec(benchmark, args);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int result = 0;
+
+    DataSeriesBenchmarks bench_series;
+    result += runBenchmark(&bench_series, "series", argc, argv);
+
+    PlotCurveBenchmarks bench_curve;
+    result += runBenchmark(&bench_curve, "curve", argc, argv);
+
+    MathBenchmarks bench_math;
+    result += runBenchmark(&bench_math, "math", argc, argv);
+
+    CSVBenchmarks bench_csv;
+    result += runBenchmark(&bench_csv, "csv", argc, argv);
+
+    qDebug() << "All benchmarks complete" << result;
+
+    return result;
+}
@@ -1,10 +1,11 @@
-QT       += core gui opengl svg
+QT       += core gui network opengl svg
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 5): QT += openglwidgets
 
 DEFINES += QT_DISABLE_DEPRECATED_UP_TO=0x050F00
 
-CONFIG += c++11
+CONFIG += c++17
 CONFIG += file_copies
 CONFIG -= debug_and_release
 
@@ -12,6 +13,19 @@ QMAKE_CXXFLAGS += -Wno-unused-parameter -Wno-unused-variable -Wno-sign-compare -
 QMAKE_CXXFLAGS += -Wreturn-type -Werror=return-type
 QMAKE_LFLAGS += --verbose
 
+# Hot-path tracing (see TraceRecorder) is compiled out by building with CONFIG+=notrace
+notrace: DEFINES += LUMBERJACK_NO_TRACE
+
+# Python scripting (see PythonBridge) requires the Python development files, and is enabled with CONFIG+=python
+python {
+    DEFINES += LUMBERJACK_PYTHON
+    CONFIG += link_pkgconfig
+    PKGCONFIG += python3-embed
+
+    SOURCES += src/python_bridge.cpp
+    HEADERS += src/python_bridge.hpp
+}
+
 INCLUDEPATH += ./qwt/src
 DEPENDPATH += ./qwt/src
 
@@ -27,36 +41,86 @@ CONFIG (debug, debug|release) {
 # Includes for default plugins
 include("plugins/plugins.pri")
 
+# Optional decompression libraries
+include("src/decompression.pri")
+
 INCLUDEPATH += src \
     src/plugins \
     src/widgets \
-    fft/include/simple_fft \
     plugins \
     plugins/cedat_protocol \
     plugins/cobsr
 
 SOURCES += \
     src/data_source_manager.cpp \
+    src/fft_engine.cpp \
     src/fft_sampler.cpp \
     src/fft_widget.cpp \
+    src/gpu_compute.cpp \
     src/helpers.cpp \
+    src/arrow_file.cpp \
+    src/batch_processor.cpp \
+    src/concatenated_series.cpp \
+    src/correlation_engine.cpp \
+    src/correlation_widget.cpp \
+    src/data_block.cpp \
+    src/data_codec.cpp \
+    src/data_kernels.cpp \
+    src/data_store.cpp \
     src/data_series.cpp \
     src/data_source.cpp \
+    src/decompression_device.cpp \
+    src/event_index.cpp \
+    src/event_store.cpp \
+    src/filter_chain.cpp \
+    src/histogram_engine.cpp \
+    src/histogram_widget.cpp \
+    src/hover_lookup.cpp \
+    src/import_arena.cpp \
+    src/import_cache.cpp \
+    src/import_sink.cpp \
+    src/label_registry.cpp \
     src/lumberjack_debug.cpp \
     src/lumberjack_settings.cpp \
     src/lumberjack_version.cpp \
     src/math_data_series.cpp \
     src/math_data_source.cpp \
+    src/math_dependency_graph.cpp \
     src/math_expression_parser.cpp \
+    src/math_sampler.cpp \
+    src/math_trace_cache.cpp \
     src/math_trace_computer.cpp \
+    src/parallel_for.cpp \
+    src/parse_kernels.cpp \
     src/plot_curve.cpp \
     src/plot_legend.cpp \
     src/plot_marker.cpp \
+    src/plot_opengl_canvas.cpp \
+    src/plot_performance.cpp \
+    src/plot_scheduler.cpp \
     src/plot_widget.cpp \
+    src/quantile_sketch.cpp \
+    src/series_buffer.cpp \
+    src/series_file.cpp \
+    src/series_envelope.cpp \
+    src/series_search_index.cpp \
+    src/series_update_scheduler.cpp \
+    src/spectrogram_sampler.cpp \
+    src/spectrogram_widget.cpp \
+    src/stats_engine.cpp \
+    src/synthetic_generator.cpp \
+    src/telemetry_ingest.cpp \
+    src/telemetry_source.cpp \
+    src/text_export_pipeline.cpp \
+    src/time_alignment.cpp \
+    src/trace_recorder.cpp \
+    src/workspace_file.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
     src/plugins/plugin_exporter.cpp \
+    src/plugins/plugin_filter.cpp \
     src/plugins/plugin_importer.cpp \
+    src/plugins/plugin_library.cpp \
     src/plugins/plugin_registry.cpp \
     src/widgets/about_dialog.cpp \
     src/widgets/axis_edit_dialog.cpp \
@@ -64,6 +128,7 @@ SOURCES += \
     src/widgets/dataview_tree.cpp \
     src/widgets/dataview_widget.cpp \
     src/widgets/debug_widget.cpp \
+    src/widgets/import_progress_widget.cpp \
     src/widgets/math_trace_dialog.cpp \
     src/widgets/plot_sampler.cpp \
     src/widgets/plugins_dialog.cpp \
@@ -74,27 +139,77 @@ SOURCES += \
 HEADERS += \
     src/data_source_manager.hpp \
     src/mainwindow.h \
+    src/fft_engine.hpp \
     src/fft_sampler.hpp \
     src/fft_widget.hpp \
+    src/gpu_compute.hpp \
     src/helpers.hpp \
+    src/arrow_file.hpp \
+    src/batch_processor.hpp \
+    src/concatenated_series.hpp \
+    src/correlation_engine.hpp \
+    src/correlation_widget.hpp \
+    src/data_block.hpp \
+    src/data_codec.hpp \
+    src/data_kernels.hpp \
+    src/data_store.hpp \
     src/data_series.hpp \
     src/data_source.hpp \
+    src/decompression_device.hpp \
+    src/event_index.hpp \
+    src/event_store.hpp \
+    src/filter_chain.hpp \
+    src/histogram_engine.hpp \
+    src/histogram_widget.hpp \
+    src/hover_lookup.hpp \
+    src/import_arena.hpp \
+    src/import_cache.hpp \
+    src/import_sink.hpp \
+    src/label_registry.hpp \
     src/lumberjack_debug.hpp \
     src/lumberjack_settings.hpp \
     src/lumberjack_version.hpp \
     src/math_data_series.hpp \
     src/math_data_source.hpp \
+    src/math_dependency_graph.hpp \
     src/math_expression_parser.hpp \
+    src/math_sampler.hpp \
+    src/math_trace_cache.hpp \
     src/math_trace_computer.hpp \
+    src/parallel_for.hpp \
+    src/parse_kernels.hpp \
     src/plot_curve.hpp \
     src/plot_legend.hpp \
     src/plot_marker.hpp \
+    src/plot_opengl_canvas.hpp \
+    src/plot_performance.hpp \
     src/plot_panner.hpp \
+    src/plot_scheduler.hpp \
     src/plot_widget.hpp \
+    src/quantile_sketch.hpp \
+    src/series_buffer.hpp \
+    src/series_file.hpp \
+    src/series_envelope.hpp \
+    src/series_search_index.hpp \
+    src/series_update_scheduler.hpp \
+    src/spectrogram_sampler.hpp \
+    src/spectrogram_widget.hpp \
+    src/spsc_ring.hpp \
+    src/stats_engine.hpp \
+    src/synthetic_generator.hpp \
+    src/telemetry_ingest.hpp \
+    src/telemetry_source.hpp \
+    src/text_export_pipeline.hpp \
+    src/time_alignment.hpp \
+    src/time_ticks.hpp \
+    src/trace_recorder.hpp \
+    src/workspace_file.hpp \
     src/plugins/plugin_base.hpp \
+    src/cancellation_token.hpp \
     src/plugins/plugin_exporter.hpp \
     src/plugins/plugin_filter.hpp \
     src/plugins/plugin_importer.hpp \
+    src/plugins/plugin_library.hpp \
     src/plugins/plugin_registry.hpp \
     src/widgets/about_dialog.hpp \
     src/widgets/axis_edit_dialog.hpp \
@@ -102,6 +217,7 @@ HEADERS += \
     src/widgets/dataview_tree.hpp \
     src/widgets/dataview_widget.hpp \
     src/widgets/debug_widget.hpp \
+    src/widgets/import_progress_widget.hpp \
     src/widgets/math_trace_dialog.hpp \
     src/widgets/plot_sampler.hpp \
     src/widgets/plugins_dialog.hpp \
@@ -109,16 +225,6 @@ HEADERS += \
     src/widgets/stats_widget.hpp \
     src/widgets/timeline_widget.hpp \
 
-# simple-fft includes
-HEADERS += \
-    fft/include/simple_fft/check_fft.hpp \
-    fft/include/simple_fft/copy_array.hpp \
-    fft/include/simple_fft/error_handling.hpp \
-    fft/include/simple_fft/fft.h \
-    fft/include/simple_fft/fft.hpp \
-    fft/include/simple_fft/fft_impl.hpp \
-    fft/include/simple_fft/fft_settings.h
-
 FORMS += \
     ui/about_dialog.ui \
     ui/axis_edit_dialog.ui \
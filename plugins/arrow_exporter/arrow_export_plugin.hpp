@@ -0,0 +1,19 @@
+#ifndef ARROW_EXPORT_PLUGIN_HPP
+#define ARROW_EXPORT_PLUGIN_HPP
+
+#include "arrow_exporter.hpp"
+#include "arrow_exporter_global.h"
+
+
+/**
+ * Plugin interface definition for the ArrowExporter
+ * Use this to compile as a standalone plugin
+ */
+class ARROW_EXPORTER_EXPORT ArrowExporterPlugin : public ArrowExporter
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ExporterInterface_iid)
+    Q_INTERFACES(ExportPlugin)
+};
+
+#endif // ARROW_EXPORT_PLUGIN_HPP
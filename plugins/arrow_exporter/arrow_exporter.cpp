@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include <QFile>
+
+#include "arrow_exporter.hpp"
+#include "arrow_file.hpp"
+
+
+const uint64_t ArrowExporter::BATCH_ROWS;
+
+
+ArrowExporter::ArrowExporter()
+{
+
+}
+
+
+QStringList ArrowExporter::supportedFileTypes() const
+{
+    QStringList fileTypes;
+
+    fileTypes << "arrow";
+    fileTypes << "feather";
+
+    return fileTypes;
+}
+
+
+/*
+ * Export the provided series to an Arrow IPC file
+ */
+bool ArrowExporter::exportData(QList<DataSeriesPointer> &series, QStringList &errors)
+{
+    if (m_filename.isEmpty())
+    {
+        errors.append(tr("Filename is empty"));
+        return false;
+    }
+
+    QFile outputFile(m_filename);
+
+    if (!outputFile.open(QIODevice::WriteOnly) || !outputFile.isOpen() || !outputFile.isWritable())
+    {
+        errors.append(tr("Could not open file for writing"));
+        return false;
+    }
+
+    // Data are read from views, which are unaffected by changes made during export
+    std::vector<DataView> views;
+
+    QStringList columns;
+
+    uint64_t rows = 0;
+
+    m_sampleCount = 0;
+    m_samplesWritten = 0;
+
+    for (auto s : series)
+    {
+        if (s.isNull()) continue;
+
+        views.push_back(getScopedView(s));
+
+        columns << s->getLabel() + ".timestamp";
+        columns << s->getLabel();
+
+        rows = std::max(rows, views.back().size());
+        m_sampleCount += views.back().size();
+    }
+
+    m_isExporting = true;
+
+    ArrowFileWriter writer(outputFile);
+
+    bool valid = writer.begin(columns);
+
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    std::vector<int64_t> counts(columns.size());
+
+    for (uint64_t first = 0; valid && first < rows; first += BATCH_ROWS)
+    {
+        if (!m_isExporting || isCancelled()) break;
+
+        const uint64_t last = std::min(rows, first + BATCH_ROWS);
+
+        for (size_t ii = 0; ii < views.size(); ii++)
+        {
+            const uint64_t size = views[ii].size();
+
+            counts[2 * ii] = counts[2 * ii + 1] = (int64_t) (std::min(size, last) - std::min(size, first));
+        }
+
+        valid = writer.beginBatch((int64_t) (last - first), counts);
+
+        for (size_t ii = 0; valid && ii < views.size(); ii++)
+        {
+            const uint64_t base = views[ii].getFirstIndex();
+            const uint64_t size = views[ii].size();
+
+            const DataView view = views[ii].getSnapshot().getView(base + std::min(size, first), base + std::min(size, last));
+
+            timestamps.resize(view.size());
+            values.resize(view.size());
+
+            view.copyTimestamps(timestamps.data());
+            view.copyValues(values.data());
+
+            valid = writer.writeColumn(timestamps.data(), (int64_t) view.size()) &&
+                    writer.writeColumn(values.data(), (int64_t) view.size());
+
+            m_samplesWritten += view.size();
+        }
+    }
+
+    const bool cancelled = !m_isExporting || isCancelled();
+
+    // The footer is written even if the export is cancelled, so the file holds the batches that were complete
+    valid = valid && writer.finish();
+
+    outputFile.close();
+
+    m_isExporting = false;
+
+    if (!valid)
+    {
+        errors.append(tr("Could not write to file") + ": " + writer.errorString());
+        return false;
+    }
+
+    if (cancelled)
+    {
+        errors.append(tr("File export was cancelled"));
+        return false;
+    }
+
+    return true;
+}
+
+
+void ArrowExporter::cancelExport()
+{
+    m_isExporting = false;
+}
+
+
+uint8_t ArrowExporter::getExportProgress(void) const
+{
+    if (m_sampleCount == 0) return 0;
+
+    return (uint8_t) ((double) m_samplesWritten / (double) m_sampleCount * 100);
+}
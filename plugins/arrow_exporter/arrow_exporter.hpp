@@ -0,0 +1,60 @@
+/*
+ * Data exporter for Apache Arrow IPC files (.arrow, .feather)
+ *
+ * The exported file can be read by pyarrow, pandas (read_feather), polars, etc.
+ * See arrow_file.hpp for details of the file format.
+ */
+
+#ifndef ARROW_EXPORTER_HPP
+#define ARROW_EXPORTER_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "plugin_exporter.hpp"
+
+
+/**
+ * @brief The ArrowExporter class exports each series as a pair of columns: "<label>.timestamp" and "<label>".
+ *
+ * The series are not merged onto a common time base (as for CSV export): the samples of each series
+ * are copied, a record batch at a time, straight from the blocks of the series into the file. A series
+ * with fewer samples than the longest series is padded with null rows.
+ */
+class ArrowExporter : public ExportPlugin
+{
+    Q_OBJECT
+
+public:
+    ArrowExporter();
+
+    // Base plugin functionality
+    virtual QString pluginName(void) const override { return m_name; }
+    virtual QString pluginDescription(void) const override { return m_description; }
+    virtual QString pluginVersion(void) const override { return m_version; }
+
+    // Exporter plugin functionality
+    virtual QStringList supportedFileTypes(void) const override;
+
+    virtual bool exportData(QList<DataSeriesPointer> &series, QStringList &errors) override;
+    virtual void cancelExport(void) override;
+    virtual uint8_t getExportProgress(void) const override;
+
+protected:
+    const QString m_name = "Arrow Exporter";
+    const QString m_description = "Export data to Apache Arrow (Feather) file";
+    const QString m_version = "0.1.0";
+
+    //! Maximum number of rows in each record batch
+    static const uint64_t BATCH_ROWS = 1 << 20;
+
+    std::atomic<bool> m_isExporting{false};
+
+    //! Progress of the current export (samples)
+    std::atomic<uint64_t> m_samplesWritten{0};
+    uint64_t m_sampleCount = 0;
+};
+
+#endif // ARROW_EXPORTER_HPP
@@ -0,0 +1,7 @@
+INCLUDEPATH += ./plugins/arrow_exporter
+
+HEADERS += \
+    ./plugins/arrow_exporter/arrow_exporter.hpp
+
+SOURCES += \
+    ./plugins/arrow_exporter/arrow_exporter.cpp
@@ -0,0 +1,64 @@
+QT += gui widgets
+
+TEMPLATE = lib
+DEFINES += ARROW_EXPORTER_LIBRARY
+
+CONFIG += c++17
+CONFIG -= debug_and_release
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += \
+    ../../src \
+    ../../src/plugins
+
+HEADERS += \
+    arrow_exporter_global.h \
+    arrow_export_plugin.hpp \
+    arrow_exporter.hpp \
+    ../../src/arrow_file.hpp \
+    ../../src/data_block.hpp \
+    ../../src/data_codec.hpp \
+    ../../src/data_kernels.hpp \
+    ../../src/data_store.hpp \
+    ../../src/data_series.hpp \
+    ../../src/plugins/plugin_base.hpp \
+    ../../src/cancellation_token.hpp \
+    ../../src/plugins/plugin_exporter.hpp \
+
+SOURCES += \
+    arrow_exporter.cpp \
+    ../../src/arrow_file.cpp \
+    ../../src/data_block.cpp \
+    ../../src/data_codec.cpp \
+    ../../src/data_kernels.cpp \
+    ../../src/data_store.cpp \
+    ../../src/data_series.cpp \
+    ../../src/plugins/plugin_exporter.cpp
+
+# Default rules for deployment.
+unix {
+    target.path = /usr/lib
+}
+
+# Specify output directory
+CONFIG(debug, debug|release) {
+    CONFIG += debug
+    DESTDIR = build/debug
+
+} else {
+    CONFIG += release
+    DESTDIR = ../build/release
+}
+
+RCC_DIR = $$DESDIR
+MOC_DIR = $$DESTDIR/moc
+OBJECTS_DIR = $$DESTDIR/objects
+
+#Set the location for the generated ui_xxxx.h files
+UI_DIR = build/ui
+
+!isEmpty(target.path): INSTALLS += target
+
+DISTFILES += \
+    arrow_exporter.json
@@ -0,0 +1,12 @@
+#ifndef ARROW_EXPORTER_GLOBAL_H
+#define ARROW_EXPORTER_GLOBAL_H
+
+#include <QtCore/qglobal.h>
+
+#if defined(ARROW_EXPORTER_LIBRARY)
+#define ARROW_EXPORTER_EXPORT Q_DECL_EXPORT
+#else
+#define ARROW_EXPORTER_EXPORT Q_DECL_IMPORT
+#endif
+
+#endif // ARROW_EXPORTER_GLOBAL_H
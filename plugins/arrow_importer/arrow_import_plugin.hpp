@@ -0,0 +1,19 @@
+#ifndef ARROW_IMPORT_PLUGIN_HPP
+#define ARROW_IMPORT_PLUGIN_HPP
+
+#include "arrow_importer.hpp"
+#include "arrow_importer_global.h"
+
+
+/**
+ * Plugin interface definition for the ArrowImporter
+ * Use this to compile as a standalone plugin
+ */
+class ARROW_IMPORTER_EXPORT ArrowImporterPlugin : public ArrowImporter
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ImporterInterface_iid)
+    Q_INTERFACES(ImportPlugin)
+};
+
+#endif // ARROW_IMPORT_PLUGIN_HPP
@@ -0,0 +1,283 @@
+#include <cmath>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+
+#include "arrow_importer.hpp"
+#include "arrow_file.hpp"
+
+
+ArrowImporter::ArrowImporter()
+{
+
+}
+
+
+/*
+ * Return a list of support file extensions for this importer class
+ */
+QStringList ArrowImporter::supportedFileTypes() const
+{
+    QStringList fileTypes;
+
+    fileTypes << "arrow";
+    fileTypes << "feather";
+
+    return fileTypes;
+}
+
+
+/**
+ * @brief ArrowImporter::reuseImportOptions - There are no import options, so any file can be imported with another
+ */
+bool ArrowImporter::reuseImportOptions(const ImportPlugin &other)
+{
+    Q_UNUSED(other);
+
+    return true;
+}
+
+
+/*
+ * Read the numeric columns of the selected file
+ */
+bool ArrowImporter::importData(QStringList &errors)
+{
+    QFile file(m_filename);
+
+    // Attempt to open the file
+    if (!file.exists() || !file.open(QIODevice::ReadOnly) || !file.isOpen() || !file.isReadable())
+    {
+        errors.append(tr("Could not open file for reading"));
+        return false;
+    }
+
+    QElapsedTimer totalTime;
+    totalTime.restart();
+
+    const qint64 fileSize = file.size();
+
+    // The columns are read in place, if the file can be memory-mapped
+    uchar *mapped = file.map(0, fileSize);
+
+    QByteArray contents;
+
+    const uint8_t *data = (const uint8_t*) mapped;
+
+    if (!mapped)
+    {
+        contents = file.readAll();
+        data = (const uint8_t*) contents.constData();
+    }
+
+    ArrowFileReader reader;
+
+    if (!reader.open(data, mapped ? fileSize : contents.size()))
+    {
+        errors.append(tr("Could not read file") + ": " + reader.errorString());
+
+        if (mapped) file.unmap(mapped);
+
+        return false;
+    }
+
+    // Find the timestamp column of each (numeric) column
+    QHash<QString, int> columns;
+
+    int sharedTimestamp = -1;
+
+    for (int col = 0; col < reader.getColumnCount(); col++)
+    {
+        if (!reader.isNumericColumn(col)) continue;
+
+        const QString name = reader.getColumnName(col);
+
+        columns.insert(name, col);
+
+        if (sharedTimestamp < 0 && (name.toLower() == "timestamp" || name.toLower() == "time"))
+        {
+            sharedTimestamp = col;
+        }
+    }
+
+    std::vector<SeriesColumn> seriesColumns;
+
+    m_seriesMutex.lock();
+
+    m_series.clear();
+
+    for (int col = 0; col < reader.getColumnCount(); col++)
+    {
+        const QString name = reader.getColumnName(col);
+
+        if (!reader.isNumericColumn(col) || col == sharedTimestamp || name.endsWith(".timestamp")) continue;
+
+        SeriesColumn s;
+
+        s.column = col;
+        s.timestampColumn = columns.value(name + ".timestamp", sharedTimestamp);
+
+        // Samples are pushed into the sink (if one is set), otherwise the importer builds its own series
+        if (m_sink)
+        {
+            s.channel = m_sink->declareChannel(name);
+        }
+        else
+        {
+            s.series = DataSeriesPointer(new DataSeries(name));
+            m_series.append(s.series);
+        }
+
+        seriesColumns.push_back(s);
+    }
+
+    m_seriesMutex.unlock();
+
+    m_batchCount = reader.getBatchCount();
+    m_batchesRead = 0;
+
+    m_isImporting = true;
+
+    bool valid = true;
+
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    std::vector<uint8_t> timestampValid;
+    std::vector<uint8_t> valueValid;
+
+    std::vector<double> t;
+    std::vector<double> v;
+
+    // Number of rows in previous batches (for series which are indexed by row number)
+    int64_t firstRow = 0;
+
+    for (int batch = 0; valid && batch < m_batchCount; batch++)
+    {
+        if (!m_isImporting || isCancelled()) break;
+
+        const int64_t rows = reader.getBatchRows(batch);
+
+        int timestampColumn = -1;
+
+        for (const auto &s : seriesColumns)
+        {
+            if (!reader.readColumn(batch, s.column, values, valueValid))
+            {
+                valid = false;
+                break;
+            }
+
+            // Consecutive series often share a timestamp column
+            if (s.timestampColumn < 0)
+            {
+                timestamps.resize(rows);
+                timestampValid.assign(rows, 1);
+
+                for (int64_t idx = 0; idx < rows; idx++)
+                {
+                    timestamps[idx] = (double) (firstRow + idx);
+                }
+            }
+            else if (s.timestampColumn != timestampColumn &&
+                     !reader.readColumn(batch, s.timestampColumn, timestamps, timestampValid))
+            {
+                valid = false;
+                break;
+            }
+
+            timestampColumn = s.timestampColumn;
+
+            t.clear();
+            v.clear();
+
+            for (int64_t idx = 0; idx < rows; idx++)
+            {
+                if (valueValid[idx] && timestampValid[idx] && !std::isnan(timestamps[idx]))
+                {
+                    t.push_back(timestamps[idx]);
+                    v.push_back(values[idx]);
+                }
+            }
+
+            if (s.series.isNull())
+            {
+                m_sink->pushSamples(s.channel, t.data(), v.data(), t.size());
+            }
+            else
+            {
+                s.series->addData(t, v, false);
+            }
+        }
+
+        firstRow += rows;
+
+        m_batchesRead++;
+    }
+
+    if (mapped)
+    {
+        file.unmap(mapped);
+    }
+
+    file.close();
+
+    const bool cancelled = !m_isImporting || isCancelled();
+
+    m_isImporting = false;
+
+    if (!valid)
+    {
+        errors.append(tr("Could not read file") + ": " + reader.errorString());
+        return false;
+    }
+
+    if (cancelled)
+    {
+        errors.append(tr("File import was cancelled"));
+        return false;
+    }
+
+    if (seriesColumns.empty())
+    {
+        errors.append(tr("File does not contain any numeric columns"));
+        return false;
+    }
+
+    qDebug() << "Imported" << seriesColumns.size() << "columns from" << m_filename << "in" << QString::number((double) totalTime.elapsed() / 1000, 'f', 2) + "s";
+
+    return true;
+}
+
+
+void ArrowImporter::cancelImport(void)
+{
+    m_isImporting = false;
+}
+
+
+QSharedPointer<ImportPlugin> ArrowImporter::createInstance(void) const
+{
+    return QSharedPointer<ImportPlugin>(new ArrowImporter());
+}
+
+
+uint8_t ArrowImporter::getImportProgress(void) const
+{
+    if (!m_isImporting || m_batchCount == 0) return 0;
+
+    return (uint8_t) ((float) m_batchesRead / (float) m_batchCount * 100);
+}
+
+
+/**
+ * Return the list of imported data series (whose samples are added while the file is being imported)
+ */
+QList<DataSeriesPointer> ArrowImporter::getDataSeries(void) const
+{
+    QMutexLocker lock(&m_seriesMutex);
+
+    return m_series;
+}
@@ -0,0 +1,96 @@
+/*
+ * Data importer for Apache Arrow IPC files (.arrow, .feather)
+ *
+ * This plugin imports the numeric columns of files written by pyarrow, pandas (to_feather),
+ * polars, etc. (and by the Arrow exporter). See arrow_file.hpp for details of the file format.
+ */
+
+#ifndef ARROW_IMPORTER_HPP
+#define ARROW_IMPORTER_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include <QMutex>
+
+#include "plugin_importer.hpp"
+
+
+/**
+ * @brief The ArrowImporter class imports each numeric column of an Arrow IPC file as a series.
+ *
+ * The timestamp of each sample is found (in order of preference) in:
+ * - a column named "<label>.timestamp" (as written by the Arrow exporter)
+ * - a column named "timestamp" or "time", which is shared by every other column
+ * - otherwise, the row number is used
+ *
+ * The file is memory-mapped, and the columns are imported a record batch at a time.
+ * Rows which are null (in either the value or the timestamp column) are skipped.
+ */
+class ArrowImporter : public ImportPlugin
+{
+    Q_OBJECT
+
+public:
+    ArrowImporter();
+
+    // Base plugin functionality
+    virtual QString pluginName(void) const override { return m_name; }
+    virtual QString pluginDescription(void) const override { return m_description; }
+    virtual QString pluginVersion(void) const override { return m_version; }
+
+    // Importer plugin functionality
+    virtual QStringList supportedFileTypes(void) const override;
+
+    virtual bool reuseImportOptions(const ImportPlugin &other) override;
+    virtual bool importData(QStringList &errors) override;
+    virtual void cancelImport(void) override;
+
+    virtual uint8_t getImportProgress(void) const override;
+
+    virtual QList<DataSeriesPointer> getDataSeries(void) const override;
+
+    virtual QSharedPointer<ImportPlugin> createInstance(void) const override;
+
+    virtual bool supportsImportSink(void) const override { return true; }
+
+protected:
+    //! Plugin metadata
+    const QString m_name = "Arrow Importer";
+    const QString m_description = "Import data from Apache Arrow (Feather) files";
+    const QString m_version = "0.1.0";
+
+    /**
+     * @brief The SeriesColumn struct is a column which is imported as a series, and its timestamp column
+     */
+    struct SeriesColumn
+    {
+        int column = 0;
+
+        //! Column of timestamps (or -1 if the row number is used)
+        int timestampColumn = -1;
+
+        //! Channel of the import sink (see ImportPlugin::setImportSink)
+        int channel = -1;
+
+        //! Series which is built by the importer (if no sink is set)
+        DataSeriesPointer series;
+    };
+
+    //! Imported series (in column order), if no sink is set
+    QList<DataSeriesPointer> m_series;
+
+    //! Protects the series list, which is read while the import is running (see getDataSeries)
+    mutable QMutex m_seriesMutex;
+
+    std::atomic<bool> m_isImporting{false};
+
+    //! Progress of the current import (record batches)
+    std::atomic<int> m_batchesRead{0};
+    int m_batchCount = 0;
+};
+
+
+#endif // ARROW_IMPORTER_HPP
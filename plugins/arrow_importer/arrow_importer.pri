@@ -0,0 +1,7 @@
+INCLUDEPATH += ./plugins/arrow_importer
+
+HEADERS += \
+    ./plugins/arrow_importer/arrow_importer.hpp
+
+SOURCES += \
+    ./plugins/arrow_importer/arrow_importer.cpp
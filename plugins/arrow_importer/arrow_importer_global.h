@@ -0,0 +1,12 @@
+#ifndef ARROW_IMPORTER_GLOBAL_H
+#define ARROW_IMPORTER_GLOBAL_H
+
+#include <QtCore/qglobal.h>
+
+#if defined(ARROW_IMPORTER_LIBRARY)
+#define ARROW_IMPORTER_EXPORT Q_DECL_EXPORT
+#else
+#define ARROW_IMPORTER_EXPORT Q_DECL_IMPORT
+#endif
+
+#endif // ARROW_IMPORTER_GLOBAL_H
@@ -16,14 +16,26 @@ HEADERS += \
     csv_exporter_global.h \
     lumberjack_csv_export_plugin.hpp \
     lumberjack_csv_exporter.hpp \
+    ../../src/data_block.hpp \
+    ../../src/data_codec.hpp \
+    ../../src/data_kernels.hpp \
+    ../../src/data_store.hpp \
     ../../src/data_series.hpp \
+    ../../src/time_ticks.hpp \
     ../../src/plugins/plugin_base.hpp \
+    ../../src/cancellation_token.hpp \
     ../../src/plugins/plugin_exporter.hpp \
+    ../../src/text_export_pipeline.hpp \
 
 SOURCES += \
     lumberjack_csv_exporter.cpp \
+    ../../src/data_block.cpp \
+    ../../src/data_codec.cpp \
+    ../../src/data_kernels.cpp \
+    ../../src/data_store.cpp \
     ../../src/data_series.cpp \
-    ../../src/plugins/plugin_exporter.cpp
+    ../../src/plugins/plugin_exporter.cpp \
+    ../../src/text_export_pipeline.cpp
 
 # Default rules for deployment.
 unix {
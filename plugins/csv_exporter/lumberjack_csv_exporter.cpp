@@ -1,6 +1,22 @@
+#include <algorithm>
+#include <cmath>
+
 #include <QFile>
 
 #include "lumberjack_csv_exporter.hpp"
+#include "time_ticks.hpp"
+
+
+const uint64_t LumberjackCSVExporter::BLOCK_SAMPLES;
+
+
+/*
+ * Order the merge heap by the earliest timestamp
+ */
+bool LumberjackCSVExporter::isLater(const HeapEntry &a, const HeapEntry &b)
+{
+    return a.ticks > b.ticks;
+}
 
 
 LumberjackCSVExporter::LumberjackCSVExporter()
@@ -48,14 +64,20 @@ bool LumberjackCSVExporter::exportData(QList<DataSeriesPointer> &series, QString
 
     // Copy across data series
     m_data.clear();
-    m_indices.clear();
+    m_views.clear();
+    m_epochBases.clear();
+
+    m_epochTimestamps = false;
 
     for (auto s : series)
     {
         if (!s.isNull())
         {
             m_data.append(s);
-            m_indices.append(0);
+            m_views.push_back(getScopedView(s));
+            m_epochBases.push_back(s->getEpochBase());
+
+            if (s->getEpochBase() != 0) m_epochTimestamps = true;
         }
     }
 
@@ -63,48 +85,48 @@ bool LumberjackCSVExporter::exportData(QList<DataSeriesPointer> &series, QString
 
     // Write header row
     row = headerRow();
-    outputFile.write(rowToString(row));
+    bool valid = outputFile.write(rowToString(row)) >= 0;
 
     if (m_unitsRow)
     {
         row = unitsRow();
-        outputFile.write(rowToString(row));
+        valid = valid && outputFile.write(rowToString(row)) >= 0;
     }
 
-    // Extract min/max timestamps (for progress bar)
-    double tMin = LONG_MAX;
-    double tMax = -LONG_MAX;
+    m_isExporting = true;
 
-    for (auto s : series)
-    {
-        if (s.isNull()) continue;
-        if (s->size() == 0) continue;
+    // The rows are formatted (in parallel) a block at a time, and written in order
+    findBoundaries();
 
-        DataPoint p1 = s->getDataPoint(0);
-        DataPoint p2 = s->getDataPoint(s->size() - 1);
+    m_blockCount = m_boundaries.size() + 1;
 
-        if (p1.timestamp < tMin) tMin = p1.timestamp;
-        if (p2.timestamp > tMax) tMax = p2.timestamp;
-    }
+    valid = valid && m_pipeline.run(m_blockCount,
+        [this](size_t block, std::vector<char> &output) { formatBlock(block, output); },
+        outputFile,
+        [this]() { return !m_isExporting || isCancelled(); });
 
-    m_minTimestamp = tMin;
-    m_maxTimestamp = tMax;
+    const bool cancelled = !m_isExporting || isCancelled();
 
-    bool valid = true;
+    outputFile.close();
 
-    m_isExporting = true;
+    m_isExporting = false;
 
-    while (valid && m_isExporting)
-    {
-        row = nextDataRow(valid);
+    // Release the snapshots
+    m_views.clear();
+    m_epochBases.clear();
+    m_boundaries.clear();
 
-        if (valid)
-        {
-            outputFile.write(rowToString(row));
-        }
+    if (cancelled)
+    {
+        errors.append(tr("File export was cancelled"));
+        return false;
     }
 
-    outputFile.close();
+    if (!valid)
+    {
+        errors.append(tr("Could not write to file"));
+        return false;
+    }
 
     return true;
 }
@@ -161,80 +183,191 @@ QStringList LumberjackCSVExporter::unitsRow(void) const
 
 
 /**
- * @brief LumberjackCSVExporter::nextDataRow - Generate the next row of data
- * @param valid
- * @return
+ * @brief LumberjackCSVExporter::findBoundaries - Divide the rows into blocks (of roughly BLOCK_SAMPLES samples),
+ * at timestamps of the longest series. A row takes every sample at the same tick, so each row lies within a single block.
  */
-QStringList LumberjackCSVExporter::nextDataRow(bool &valid)
+void LumberjackCSVExporter::findBoundaries(void)
 {
-    // TODO: Better configuration of timestamp resolution...
-    const double DT = 1e-6;
+    m_boundaries.clear();
+
+    if (m_views.empty()) return;
 
-    QStringList values;
+    uint64_t total = 0;
+    size_t longest = 0;
 
-    double nextTimestamp = LONG_MAX;
+    for (size_t ii = 0; ii < m_views.size(); ii++)
+    {
+        total += m_views[ii].size();
+
+        if (m_views[ii].size() > m_views[longest].size()) longest = ii;
+    }
 
-    int N = qMin(m_data.count(), m_indices.count());
+    const DataView &view = m_views[longest];
 
-    bool dataAvailable = false;
+    const uint64_t blocks = total / BLOCK_SAMPLES + 1;
 
-    // What is the *smallest* timestamp?
-    for (int ii = 0; ii < N; ii++)
+    for (uint64_t ii = 1; ii < blocks; ii++)
     {
-        auto series = m_data.at(ii);
-        uint64_t idx = m_indices.at(ii);
+        const double t = view.getTimestamp(view.size() * ii / blocks);
 
-        if (idx < series->size())
+        if (std::isnan(t)) continue;
+
+        const int64_t ticks = getTicks(longest, t);
+
+        if (m_boundaries.empty() || ticks > m_boundaries.back())
         {
-            dataAvailable = true;
+            m_boundaries.push_back(ticks);
+        }
+    }
+}
 
-            auto point = series->getDataPoint(idx);
 
-            if (point.timestamp < nextTimestamp)
-            {
-                nextTimestamp = point.timestamp;
-            }
+/*
+ * Return the tick of a timestamp of a series, relative to the epoch
+ */
+int64_t LumberjackCSVExporter::getTicks(size_t series, double timestamp) const
+{
+    return m_epochBases[series] + TimeTicks::fromSeconds(timestamp);
+}
+
+
+/**
+ * @brief LumberjackCSVExporter::findBoundary - Find the first sample of a series at (or after) a boundary.
+ * The timestamp of the boundary is only approximate (relative to the epoch base of the series),
+ * so the index is then corrected by comparing ticks.
+ * @return the index of the sample (within the snapshot of the series)
+ */
+uint64_t LumberjackCSVExporter::findBoundary(size_t series, int64_t boundary) const
+{
+    const DataView &view = m_views[series];
+    const DataSnapshot &snapshot = view.getSnapshot();
+
+    const uint64_t first = view.getFirstIndex();
+    const uint64_t last = first + view.size();
+
+    uint64_t idx = snapshot.lowerBound(TimeTicks::toSeconds(boundary - m_epochBases[series]));
+
+    idx = std::min(std::max(idx, first), last);
+
+    while (idx > first && getTicks(series, snapshot.getTimestamp(idx - 1)) >= boundary) idx--;
+    while (idx < last && getTicks(series, snapshot.getTimestamp(idx)) < boundary) idx++;
+
+    return idx;
+}
+
+
+/**
+ * @brief LumberjackCSVExporter::formatBlock - Format the rows of a block (called concurrently, for different blocks)
+ * @param block - Index of the block: the rows with ticks in [m_boundaries[block - 1], m_boundaries[block])
+ * @param output - Receives the formatted rows
+ */
+void LumberjackCSVExporter::formatBlock(size_t block, std::vector<char> &output) const
+{
+    MergeState state;
+
+    for (size_t ii = 0; ii < m_views.size(); ii++)
+    {
+        const DataView &view = m_views[ii];
+        const DataSnapshot &snapshot = view.getSnapshot();
+
+        uint64_t a = view.getFirstIndex();
+        uint64_t b = a + view.size();
+
+        if (block > 0) a = findBoundary(ii, m_boundaries[block - 1]);
+        if (block < m_boundaries.size()) b = findBoundary(ii, m_boundaries[block]);
+
+        state.views.push_back(snapshot.getView(a, b));
+    }
+
+    for (size_t ii = 0; ii < state.views.size(); ii++)
+    {
+        state.cursors.push_back(state.views[ii].begin());
+
+        if (!state.views[ii].isEmpty())
+        {
+            const double t = state.cursors[ii].getTimestamp();
+
+            state.heap.push_back({getTicks(ii, t), t, ii});
         }
     }
 
-    m_currentTimestamp = nextTimestamp;
+    std::make_heap(state.heap.begin(), state.heap.end(), isLater);
+
+    while (nextDataRow(state, output))
+    {
+    }
+}
+
 
+/**
+ * @brief LumberjackCSVExporter::nextDataRow - Format the next row of data (within a block), appending it to the output buffer.
+ * The series are merged by timestamp: the heap holds the next sample of each series, so each row takes
+ * the earliest sample, and any other sample at the same tick (at most one per series).
+ * @return false if there is no more data
+ */
+bool LumberjackCSVExporter::nextDataRow(MergeState &state, std::vector<char> &output) const
+{
     // No more data available
-    if (!dataAvailable)
+    if (state.heap.empty()) return false;
+
+    const int64_t nextTicks = state.heap.front().ticks;
+    const double nextTimestamp = state.heap.front().timestamp;
+
+    state.rowSeries.clear();
+
+    while (!state.heap.empty() && state.heap.front().ticks == nextTicks)
     {
-        valid = false;
-        return values;
+        std::pop_heap(state.heap.begin(), state.heap.end(), isLater);
+
+        state.rowSeries.push_back(state.heap.back().series);
+        state.heap.pop_back();
     }
 
-    // Timestamp
-    values.append(QString::number(nextTimestamp));
+    std::sort(state.rowSeries.begin(), state.rowSeries.end());
 
-    // Now, iterate through each series, and see if it has a corresponding value at this timestamp
-    for (int ii = 0; ii < N; ii++)
+    // Timestamp (an epoch-based timestamp would lose its resolution as a double)
+    if (m_epochTimestamps)
+    {
+        TextExportPipeline::appendTicks(output, nextTicks);
+    }
+    else
     {
-        auto series = m_data.at(ii);
-        uint64_t idx = m_indices.at(ii);
+        TextExportPipeline::appendNumber(output, nextTimestamp);
+    }
+
+    const char delimiter = m_delimiter.isEmpty() ? ',' : m_delimiter.at(0).toLatin1();
+
+    const size_t N = state.views.size();
 
-        QString value;
+    size_t next = 0;
 
-        if (idx < series->size())
+    for (size_t ii = 0; ii < N; ii++)
+    {
+        output.push_back(delimiter);
+
+        // TODO: "Empty" value compensation?
+        if (next < state.rowSeries.size() && state.rowSeries[next] == ii)
         {
-            auto point = series->getDataPoint(idx);
+            auto& cursor = state.cursors[ii];
 
-            // Timestamp is within allowable range
-            if (point.timestamp <= (nextTimestamp + DT))
+            TextExportPipeline::appendNumber(output, (*cursor).value);
+            ++cursor;
+
+            if (cursor != state.views[ii].end())
             {
-                value = QString::number(point.value);
-                m_indices[ii]++;
+                const double t = cursor.getTimestamp();
+
+                state.heap.push_back({getTicks(ii, t), t, ii});
+                std::push_heap(state.heap.begin(), state.heap.end(), isLater);
             }
-        }
 
-        // TODO: "Empty" value compensation?
-        values.append(value);
+            next++;
+        }
     }
 
-    valid = true;
-    return values;
+    output.push_back('\n');
+
+    return true;
 }
 
 
@@ -246,14 +379,9 @@ void LumberjackCSVExporter::cancelExport()
 
 uint8_t LumberjackCSVExporter::getExportProgress(void) const
 {
-    double dt = m_maxTimestamp - m_minTimestamp;
-
-    if (dt == 0) return 0;
-
-    double progress = (m_currentTimestamp - m_minTimestamp) / dt;
+    const size_t blocks = m_blockCount;
 
-    if (progress < 0) progress = 0;
-    if (progress > 1) progress = 1;
+    if (blocks == 0) return 0;
 
-    return (uint8_t) (progress * 100);
+    return (uint8_t) (std::min(m_pipeline.getBlocksWritten(), blocks) * 100 / blocks);
 }
@@ -1,7 +1,13 @@
 #ifndef LUMBERJACK_CSV_EXPORTER_HPP
 #define LUMBERJACK_CSV_EXPORTER_HPP
 
+#include <atomic>
+#include <vector>
+
+#include <QFile>
+
 #include "plugin_exporter.hpp"
+#include "text_export_pipeline.hpp"
 
 
 class LumberjackCSVExporter : public ExportPlugin
@@ -30,13 +36,57 @@ protected:
     const QString m_version = "0.1.0";
 
     QList<DataSeriesPointer> m_data;
-    QList<uint64_t> m_indices;
 
-    bool m_isExporting = false;
+    //! Approximate number of samples in each block of rows, which are formatted in parallel (see TextExportPipeline)
+    static const uint64_t BLOCK_SAMPLES = 1 << 16;
+
+    //! Snapshot view of each series
+    std::vector<DataView> m_views;
+
+    //! Epoch base of each series (samples are merged into the same row if they are at the same tick, relative to the epoch)
+    std::vector<int64_t> m_epochBases;
+
+    //! Timestamps are written exactly (relative to the epoch) if any series has an epoch base
+    bool m_epochTimestamps = false;
+
+    //! Blocks of rows are divided at these ticks (each block starts at a boundary)
+    std::vector<int64_t> m_boundaries;
+
+    /**
+     * @brief The HeapEntry struct is the timestamp of the next sample of a series (see nextDataRow)
+     */
+    struct HeapEntry
+    {
+        //! Tick of the sample (relative to the epoch)
+        int64_t ticks;
+        double timestamp;
+        size_t series;
+    };
 
-    double m_currentTimestamp = 0;
-    double m_minTimestamp = 0;
-    double m_maxTimestamp = 0;
+    static bool isLater(const HeapEntry &a, const HeapEntry &b);
+
+    /**
+     * @brief The MergeState struct is the state of the merge of the series, within a block of rows
+     */
+    struct MergeState
+    {
+        //! Samples of each series within the block, and the read position within those samples
+        std::vector<DataView> views;
+        std::vector<DataView::const_iterator> cursors;
+
+        //! Min-heap of every series which has samples remaining, ordered by the timestamp of its next sample
+        std::vector<HeapEntry> heap;
+
+        //! Series which have a value in the current row (in column order)
+        std::vector<size_t> rowSeries;
+    };
+
+    TextExportPipeline m_pipeline;
+
+    std::atomic<bool> m_isExporting{false};
+
+    //! Number of blocks of the current export (for the progress bar)
+    std::atomic<size_t> m_blockCount{0};
 
     // Data export options
     QString m_delimiter = ",";
@@ -49,7 +99,12 @@ protected:
     QStringList headerRow(void) const;
     QStringList unitsRow(void) const;
 
-    QStringList nextDataRow(bool &valid);
+    void findBoundaries(void);
+    int64_t getTicks(size_t series, double timestamp) const;
+    uint64_t findBoundary(size_t series, int64_t boundary) const;
+
+    void formatBlock(size_t block, std::vector<char> &output) const;
+    bool nextDataRow(MergeState &state, std::vector<char> &output) const;
 
 };
 
@@ -43,6 +43,15 @@ struct CSVImportOptions
 
     QString ignoreRowsStartingWith;
 
+    //! Parse the values of each column when its series is first read (only the timestamps are parsed during the import)
+    bool lazyImport = false;
+
+    //! Continue to import lines which are appended to the file (an incomplete final line is not imported until it is complete)
+    bool followFile = false;
+
+    //! Parse timestamps exactly (to the nanosecond), relative to the day of the first timestamp (see DataSeries::getEpochBase)
+    bool exactTimestamps = false;
+
     QString getDelimiterString(void) const
     {
         switch (delimeter)
@@ -75,6 +84,20 @@ struct CSVImportOptions
             return 0.001;
         }
     }
+
+    //! Number of nanoseconds in one unit of a numeric timestamp, as a power of ten (see ParseKernels::parseTicks)
+    int getTimestampExponent(void) const
+    {
+        switch (timestampFormat)
+        {
+        default:
+        case TimestampFormat::SECONDS:
+        case TimestampFormat::HHMMSS:
+            return 9;
+        case TimestampFormat::MILLISECONDS:
+            return 6;
+        }
+    }
 };
 
 #endif // CSV_IMPORT_OPTIONS_HPP
@@ -15,18 +15,38 @@ INCLUDEPATH += \
     ../../src \
     ../../src/plugins
 
+include(../../src/decompression.pri)
+
 HEADERS += \
     csv_importer_global.h \
     lumberjack_csv_import_plugin.hpp \
     lumberjack_csv_importer.hpp \
     import_options_dialog.hpp \
     csv_import_options.hpp \
+    ../../src/data_block.hpp \
+    ../../src/data_codec.hpp \
+    ../../src/data_kernels.hpp \
+    ../../src/data_store.hpp \
     ../../src/data_series.hpp \
+    ../../src/decompression_device.hpp \
+    ../../src/import_arena.hpp \
+    ../../src/parallel_for.hpp \
+    ../../src/parse_kernels.hpp \
+    ../../src/time_ticks.hpp \
     ../../src/plugins/plugin_base.hpp \
+    ../../src/cancellation_token.hpp \
     ../../src/plugins/plugin_importer.hpp \
 
 SOURCES += \
+    ../../src/data_block.cpp \
+    ../../src/data_codec.cpp \
+    ../../src/data_kernels.cpp \
+    ../../src/data_store.cpp \
     ../../src/data_series.cpp \
+    ../../src/decompression_device.cpp \
+    ../../src/import_arena.cpp \
+    ../../src/parallel_for.cpp \
+    ../../src/parse_kernels.cpp \
     ../../src/plugins/plugin_importer.cpp \
     import_options_dialog.cpp \
     lumberjack_csv_importer.cpp
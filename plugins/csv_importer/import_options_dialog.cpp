@@ -2,6 +2,7 @@
 #include <QTableWidget>
 #include <QTableWidgetItem>
 
+#include "decompression_device.hpp"
 #include "import_options_dialog.hpp"
 
 CSVImportOptionsDialog::CSVImportOptionsDialog(QString filename, QWidget *parent) :
@@ -64,6 +65,19 @@ void CSVImportOptionsDialog::initImportOptions()
     ui.dataStartRow->setValue(m_options.rowDataStart);
 
     ui.ignoreStartWith->setText(m_options.ignoreRowsStartingWith);
+
+    ui.lazyImport->setChecked(m_options.lazyImport);
+    ui.followFile->setChecked(m_options.followFile);
+    ui.exactTimestamps->setChecked(m_options.exactTimestamps);
+
+    // A compressed file can only be read in sequence (so its columns cannot be loaded later), and is not followed
+    if (DecompressionDevice::getFormat(m_filename) != DecompressionDevice::FORMAT_NONE)
+    {
+        ui.lazyImport->setChecked(false);
+        ui.lazyImport->setEnabled(false);
+        ui.followFile->setChecked(false);
+        ui.followFile->setEnabled(false);
+    }
 }
 
 
@@ -87,6 +101,12 @@ void CSVImportOptionsDialog::saveImportOptions()
 
     options.ignoreRowsStartingWith = ui.ignoreStartWith->text().trimmed();
 
+    options.lazyImport = ui.lazyImport->isChecked();
+    options.followFile = ui.followFile->isChecked();
+    options.exactTimestamps = ui.exactTimestamps->isChecked();
+
+    m_options = options;
+
     accept();
 }
 
@@ -103,13 +123,23 @@ void CSVImportOptionsDialog::readFileHeader(void)
 
     if (f.open(QIODevice::ReadOnly) && f.isOpen() && f.isReadable())
     {
+        // The header of a compressed file is decompressed
+        DecompressionDevice decompressed(&f, DecompressionDevice::getFormat(m_filename));
+
+        QIODevice *device = &f;
+
+        if (DecompressionDevice::getFormat(m_filename) != DecompressionDevice::FORMAT_NONE)
+        {
+            device = decompressed.open(QIODevice::ReadOnly) ? &decompressed : nullptr;
+        }
+
         int idx = 0;
 
-        while ((idx < N_HEADER_LINES) && !f.atEnd())
+        while (device && (idx < N_HEADER_LINES) && !device->atEnd())
         {
             idx++;
 
-            m_fileHeader.append(QString(f.readLine()).trimmed());
+            m_fileHeader.append(QString(device->readLine()).trimmed());
         }
     }
 
@@ -2,149 +2,847 @@
 #include <QFileInfo>
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include <QThreadPool>
 
 #include <QDialog>
 
-#include "lumberjack_csv_importer.hpp"
-#include "import_options_dialog.hpp"
+#include "lumberjack_csv_importer.hpp"
+#include "import_options_dialog.hpp"
+#include "decompression_device.hpp"
+#include "parallel_for.hpp"
+#include "parse_kernels.hpp"
+#include "time_ticks.hpp"
+
+
+const size_t LumberjackCSVImporter::LOAD_ROWS;
+
+
+LumberjackCSVImporter::LumberjackCSVImporter()
+{
+
+}
+
+
+QStringList LumberjackCSVImporter::supportedFileTypes() const
+{
+    QStringList fileTypes;
+
+    fileTypes << "csv";
+    fileTypes << "tsv";
+
+    return fileTypes;
+}
+
+
+
+/**
+ * @brief LumberjackCSVImporter::beforeLoadData - Open configuration dialog
+ * @return
+ */
+bool LumberjackCSVImporter::beforeImport(void)
+{
+    CSVImportOptionsDialog dlg(m_filename);
+
+    int result = dlg.exec();
+
+    if (result == QDialog::Accepted)
+    {
+        m_options = dlg.getOptions();
+    }
+
+    return result == QDialog::Accepted;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::reuseImportOptions - Use the options of another CSV import, if the file has the same layout
+ * @param other - An importer which has completed beforeImport
+ * @return true if the options are used (otherwise the user is asked for options)
+ */
+bool LumberjackCSVImporter::reuseImportOptions(const ImportPlugin &other)
+{
+    const LumberjackCSVImporter *previous = dynamic_cast<const LumberjackCSVImporter*>(&other);
+
+    if (!previous) return false;
+
+    const QByteArray layout = readLayout(m_filename, previous->m_options);
+
+    if (layout.isEmpty() || layout != readLayout(previous->m_filename, previous->m_options))
+    {
+        return false;
+    }
+
+    m_options = previous->m_options;
+
+    return true;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::readLayout - Describe the layout of a file: every row before the data (e.g. the headers),
+ * and the number of columns of the first data row
+ * @param filename - The file (which may be compressed)
+ * @param options - The import options which describe the rows
+ * @return the layout, or an empty array if the file cannot be read
+ */
+QByteArray LumberjackCSVImporter::readLayout(const QString &filename, const CSVImportOptions &options)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    const DecompressionDevice::Format format = DecompressionDevice::getFormat(filename);
+
+    DecompressionDevice decompressed(&file, format);
+
+    QIODevice *device = &file;
+
+    if (format != DecompressionDevice::FORMAT_NONE)
+    {
+        if (!decompressed.open(QIODevice::ReadOnly)) return QByteArray();
+
+        device = &decompressed;
+    }
+
+    const int firstDataRow = std::max({options.rowDataStart, options.rowHeaders + 1, options.rowUnits + 1});
+
+    QByteArray layout;
+
+    for (int row = 0; row <= firstDataRow && !device->atEnd(); row++)
+    {
+        const QByteArray line = device->readLine().trimmed();
+
+        if (row < firstDataRow)
+        {
+            layout += line + "\n";
+        }
+        else
+        {
+            layout += QByteArray::number(line.count(options.getDelimiterString().at(0).toLatin1()) + 1);
+        }
+    }
+
+    return layout;
+}
+
+
+/*
+ * Bytes which are removed from either end of a line or cell (as for QString::trimmed)
+ */
+static inline bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+static inline std::string_view trimmed(std::string_view text)
+{
+    size_t first = 0;
+    size_t last = text.size();
+
+    while (first < last && isSpace(text[first])) first++;
+    while (last > first && isSpace(text[last - 1])) last--;
+
+    return text.substr(first, last - first);
+}
+
+
+/*
+ * Split a line at each delimiter (empty fields are retained, as for QString::split)
+ */
+static void splitRow(std::string_view line, char delimiter, std::vector<std::string_view> &fields)
+{
+    fields.clear();
+
+    size_t first = 0;
+
+    while (true)
+    {
+        const size_t next = line.find(delimiter, first);
+
+        if (next == std::string_view::npos)
+        {
+            fields.push_back(line.substr(first));
+            return;
+        }
+
+        fields.push_back(line.substr(first, next - first));
+        first = next + 1;
+    }
+}
+
+
+/*
+ * Compare text against a lower case word, ignoring case (ASCII only)
+ */
+static inline bool equalsWord(std::string_view text, const char *word)
+{
+    for (char c : text)
+    {
+        if ((c | 0x20) != *word++) return false;
+    }
+
+    return *word == 0;
+}
+
+
+/*
+ * Recognise a boolean cell: true / on / yes / y, or false / off / no / n (ignoring case)
+ */
+static bool parseBoolean(std::string_view text, double &value)
+{
+    bool result = false;
+
+    switch (text.size())
+    {
+    case 1:
+        if (equalsWord(text, "y")) { value = 1; result = true; }
+        else if (equalsWord(text, "n")) { value = 0; result = true; }
+        break;
+    case 2:
+        if (equalsWord(text, "on")) { value = 1; result = true; }
+        else if (equalsWord(text, "no")) { value = 0; result = true; }
+        break;
+    case 3:
+        if (equalsWord(text, "yes")) { value = 1; result = true; }
+        else if (equalsWord(text, "off")) { value = 0; result = true; }
+        break;
+    case 4:
+        if (equalsWord(text, "true")) { value = 1; result = true; }
+        break;
+    case 5:
+        if (equalsWord(text, "false")) { value = 0; result = true; }
+        break;
+    default:
+        break;
+    }
+
+    return result;
+}
+
+
+/*
+ * Convert a cell to a sample value. Empty cells, and cells which are not finite numbers (or booleans), are ignored.
+ */
+static bool parseCell(std::string_view field, double &value)
+{
+    const std::string_view text = trimmed(field);
+
+    // Ignore empty cell values
+    if (text.empty()) return false;
+
+    // Booleans are recognised by length (and first byte), before attempting to convert a number
+    bool result = parseBoolean(text, value);
+
+    if (!result)
+    {
+        result = ParseKernels::parseDouble(text.data(), text.data() + text.size(), value);
+    }
+
+    // Ignore invalid or infinite values
+    return result && !isnan(value) && !isinf(value);
+}
+
+
+/*
+ * Read the next line from [ptr, end), advancing ptr past the newline.
+ * Returns false if there is no complete line (the last line need not end with a newline if final).
+ */
+static inline bool nextLine(const char *&ptr, const char *end, bool final, std::string_view &line)
+{
+    if (ptr >= end) return false;
+
+    const char *eol = (const char*) memchr(ptr, '\n', end - ptr);
+
+    if (!eol)
+    {
+        if (!final) return false;
+
+        eol = end;
+    }
+
+    line = trimmed(std::string_view(ptr, eol - ptr));
+
+    ptr = eol < end ? eol + 1 : end;
+
+    return true;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::loadDataFile
+ * @param filename - The filename to load
+ * @param errors -
+ * @return
+ */
+bool LumberjackCSVImporter::importData(QStringList &errors)
+{
+    // Reset importer to initial conditions
+    m_headers.clear();
+
+    m_columnMutex.lock();
+    columnMap.clear();
+    m_columnMutex.unlock();
+
+    columnSeries.clear();
+    columnSeriesIndex.clear();
+    m_errors.clear();
+    m_dataRows = 0;
+    m_rowIndex.reset();
+    initialTimestampSeen = false;
+    m_epochBase = 0;
+
+    QFileInfo fi(m_filename);
+
+    if (!fi.exists() || !fi.isFile())
+    {
+        errors.append(tr("File does not exist"));
+        return false;
+    }
+
+    m_bytesRead = 0;
+    m_compressedRead = 0;
+    m_fileSize = fi.size();
+
+    m_file = new QFile(m_filename);
+
+    if (!m_file->open(QIODevice::ReadOnly) || !m_file->isOpen() || !m_file->isReadable())
+    {
+        errors.append(tr("Could not open file for reading"));
+        m_file->close();
+        return false;
+    }
+
+    const DecompressionDevice::Format format = DecompressionDevice::getFormat(m_filename);
+
+    if (!DecompressionDevice::isSupported(format))
+    {
+        errors.append(tr("Compressed files (.%1) are not supported").arg(fi.suffix()));
+        m_file->close();
+        return false;
+    }
+
+    // A compressed file is read in sequence, so it is parsed in full and is not followed
+    if (format != DecompressionDevice::FORMAT_NONE)
+    {
+        m_options.lazyImport = false;
+        m_options.followFile = false;
+    }
+
+    m_delimiter = m_options.getDelimiterString().at(0).toLatin1();
+    m_ignorePrefix = m_options.ignoreRowsStartingWith.toStdString();
+
+    m_firstDataRow = std::max({m_options.rowDataStart, m_options.rowHeaders + 1, m_options.rowUnits + 1});
+
+    m_lineCount = 0;
+    m_badLineCount = 0;
+    m_chunkLines = 0;
+
+    // A file which is followed is parsed in full (its columns cannot be loaded later, as the file changes)
+    if (m_options.lazyImport && !m_options.followFile)
+    {
+        m_rowIndex = std::make_shared<RowIndex>();
+
+        m_rowIndex->filename = fi.absoluteFilePath();
+        m_rowIndex->fileSize = m_fileSize;
+        m_rowIndex->lastModified = fi.lastModified();
+        m_rowIndex->delimiter = m_delimiter;
+    }
+
+    m_fileOffset = 0;
+
+    m_isImporting = true;
+
+    if (format != DecompressionDevice::FORMAT_NONE)
+    {
+        DecompressionDevice device(m_file, format);
+
+        if (!device.open(QIODevice::ReadOnly))
+        {
+            errors.append(device.errorString());
+        }
+        else
+        {
+            processStream(device, true);
+
+            // Any data decoded before the error are retained
+            if (device.hasFailed()) m_errors.append(device.errorString());
+        }
+    }
+    else
+    {
+        // If the file is followed, an incomplete final line is left for the next update (see importAppendedData)
+        processFile(*m_file, !m_options.followFile);
+    }
+
+    // Ensure file object is closed
+    m_file->close();
+
+    // The transient state of the import is released in one go
+    m_chunkArenas.clear();
+
+    // Each series parses its own columns from the file, when it is first read
+    if (m_rowIndex && m_isImporting)
+    {
+        std::shared_ptr<const RowIndex> index = m_rowIndex;
+
+        for (size_t idx = 0; idx < columnSeries.size(); idx++)
+        {
+            std::vector<int> columns;
+
+            for (size_t ii = 0; ii < columnSeriesIndex.size(); ii++)
+            {
+                if (columnSeriesIndex[ii] == (int) idx) columns.push_back((int) ii);
+            }
+
+            columnSeries[idx]->setLoader([index, columns](std::vector<double> &t_ms, std::vector<double> &values) {
+                return loadColumns(*index, columns, t_ms, values);
+            });
+        }
+    }
+
+    m_rowIndex.reset();
+
+    m_isImporting = false;
+
+    errors.append(m_errors);
+
+    if (m_badLineCount > 0)
+    {
+        errors.append(QString("Lines with errors: " + QString::number(m_badLineCount)));
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::processFile - Process the file from the current offset (m_fileOffset) to the end (m_fileSize).
+ * The offset is advanced past each line which is processed.
+ * @param file - The file, which is open for reading
+ * @param final - True if the file is complete (otherwise an incomplete final line is not processed)
+ */
+void LumberjackCSVImporter::processFile(QFile &file, bool final)
+{
+    const qint64 length = m_fileSize - m_fileOffset;
+
+    if (length <= 0) return;
+
+    // Each block is divided into chunks for the worker threads
+    const qint64 blockSize = m_chunkSize * std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+
+    // The file is tokenized in place, if it can be memory-mapped
+    uchar *mapped = m_mapFile ? file.map(m_fileOffset, length) : nullptr;
+
+    if (mapped)
+    {
+        const char *ptr = (const char*) mapped;
+        const char *end = ptr + length;
+
+        m_blockBase = ptr;
+        m_blockOffset = m_fileOffset;
+
+        while (ptr < end && m_isImporting)
+        {
+            const char *limit = end - ptr > blockSize ? ptr + blockSize : end;
+
+            size_t used = processBlock(ptr, limit, final && limit == end);
+
+            // A line which is longer than the block
+            if (used == 0 && limit < end)
+            {
+                used = processBlock(ptr, end, final);
+            }
+
+            // An incomplete final line
+            if (used == 0) break;
+
+            ptr += used;
+        }
+
+        m_fileOffset += ptr - (const char*) mapped;
+
+        file.unmap(mapped);
+    }
+    else
+    {
+        // Otherwise the file is read a block at a time
+        file.seek(m_fileOffset);
+
+        processStream(file, final);
+    }
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::processStream - Process the data read from a device, a block at a time
+ * (an incomplete line is carried into the next block). The offset (m_fileOffset) is advanced past each line which is processed.
+ * @param device - The device, which is positioned at the offset (e.g. a file, or a DecompressionDevice)
+ * @param final - True if the data are complete (otherwise an incomplete final line is not processed)
+ */
+void LumberjackCSVImporter::processStream(QIODevice &device, bool final)
+{
+    const qint64 blockSize = m_chunkSize * std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+
+    // Progress of a compressed file is measured in compressed bytes (see getImportProgress)
+    const DecompressionDevice *decompression = qobject_cast<const DecompressionDevice*>(&device);
+
+    std::vector<char> block;
+    size_t pending = 0;
+
+    while (!device.atEnd() && m_isImporting && !isCancelled())
+    {
+        block.resize(pending + blockSize);
+
+        const qint64 n = device.read(block.data() + pending, blockSize);
+
+        if (n <= 0) break;
+
+        if (decompression) m_compressedRead = decompression->getCompressedPosition();
+
+        const size_t available = pending + n;
+
+        // Offset of the start of the block within the file
+        m_blockBase = block.data();
+        m_blockOffset = m_fileOffset;
+
+        const size_t used = processBlock(block.data(), block.data() + available, final && device.atEnd());
+
+        m_fileOffset += used;
+        pending = available - used;
+        memmove(block.data(), block.data() + used, pending);
+    }
+
+    // The end of the data was only found by the last (empty) read
+    if (final && pending > 0 && m_isImporting)
+    {
+        m_blockBase = block.data();
+        m_blockOffset = m_fileOffset;
+
+        m_fileOffset += processBlock(block.data(), block.data() + pending, true);
+    }
+}
+
+
+/*
+ * A compressed file is not followed (see importData)
+ */
+bool LumberjackCSVImporter::isFollowEnabled(void) const
+{
+    return m_options.followFile && DecompressionDevice::getFormat(m_filename) == DecompressionDevice::FORMAT_NONE;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::importAppendedData - Import the lines which have been appended to the file since
+ * the previous import. Only complete lines are imported, and the samples are added to the existing series.
+ * @param errors
+ * @return false if the file can no longer be followed
+ */
+bool LumberjackCSVImporter::importAppendedData(QStringList &errors)
+{
+    QFile file(m_filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errors.append(tr("Could not open file for reading"));
+        return false;
+    }
+
+    const qint64 size = file.size();
+
+    // The file has been replaced, or truncated
+    if (size < m_fileOffset)
+    {
+        errors.append(tr("File has been truncated"));
+        return false;
+    }
+
+    m_fileSize = size;
+    m_errors.clear();
+
+    const qint64 badLines = m_badLineCount;
+
+    m_isImporting = true;
+
+    processFile(file, false);
+
+    m_chunkArenas.clear();
+
+    m_isImporting = false;
+
+    errors.append(m_errors);
+
+    if (m_badLineCount > badLines)
+    {
+        errors.append(QString("Lines with errors: " + QString::number(m_badLineCount - badLines)));
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::processBlock - Process each complete line within a block of bytes.
+ * Rows before the first data row are processed in order (headers must be extracted before any data),
+ * then the remaining lines are divided into chunks (at line boundaries), which are parsed in parallel.
+ * @param begin - First byte
+ * @param end - One past the last byte
+ * @param final - True if the block ends at the end of the file (so the last line need not end with a newline)
+ * @return the number of bytes processed (any incomplete line is not processed)
+ */
+size_t LumberjackCSVImporter::processBlock(const char *begin, const char *end, bool final)
+{
+    const char *ptr = begin;
+
+    std::string_view line;
+
+    if (m_lineCount < m_firstDataRow)
+    {
+        ImportChunk chunk(getChunkArena(0));
+
+        while (m_lineCount < m_firstDataRow && m_isImporting)
+        {
+            const char *start = ptr;
+
+            if (!nextLine(ptr, end, final, line)) break;
+
+            m_bytesRead += ptr - start;
+
+            // Ignore lines which start with prohibited characters
+            if (!m_ignorePrefix.empty() && line.substr(0, m_ignorePrefix.size()) == m_ignorePrefix)
+            {
+                continue;
+            }
+
+            splitRow(line, m_delimiter, chunk.row);
+
+            if (!processRow(m_lineCount, chunk))
+            {
+                m_badLineCount++;
+            }
+
+            m_lineCount++;
+        }
+
+        appendChunk(chunk);
+
+        chunk.arena->reset();
+
+        if (m_lineCount < m_firstDataRow) return ptr - begin;
+    }
+
+    // Only complete lines are parsed, unless this is the end of the file
+    const char *last = end;
+
+    if (!final)
+    {
+        while (last > ptr && last[-1] != '\n') last--;
+    }
+
+    if (last <= ptr || !m_isImporting) return ptr - begin;
+
+    const size_t count = std::max<size_t>(1, (last - ptr) / m_chunkSize);
+
+    std::vector<ImportChunk> chunks;
+    chunks.reserve(count);
+
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        chunks.emplace_back(getChunkArena(ii));
+
+        // Chunks are a similar size, so a chunk is likely to hold as many rows as the chunks before it
+        chunks[ii].rowHint = (size_t) m_chunkLines;
+
+        if (m_rowIndex)
+        {
+            chunks[ii].rowOffsets.reserve(chunks[ii].rowHint);
+            chunks[ii].rowTimestamps.reserve(chunks[ii].rowHint);
+        }
+    }
+
+    const char *start = ptr;
+
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        const char *split = ii + 1 == count ? last : ptr + (last - ptr) * (ii + 1) / count;
+
+        if (split < last)
+        {
+            // Each chunk ends after a newline
+            const char *eol = (const char*) memchr(std::max(split, start), '\n', last - std::max(split, start));
+
+            split = eol ? eol + 1 : last;
+        }
+
+        chunks[ii].begin = start;
+        chunks[ii].end = split;
+
+        start = split;
+    }
+
+    parallelFor(count, [this, &chunks](size_t idx) {
+        parseChunk(chunks[idx]);
+    }, QThreadPool::globalInstance());
 
+    m_chunkLines = 0;
 
-LumberjackCSVImporter::LumberjackCSVImporter()
-{
+    for (auto &chunk : chunks)
+    {
+        appendChunk(chunk);
+
+        m_chunkLines = std::max(m_chunkLines, chunk.lineCount);
+
+        chunk.arena->reset();
+    }
 
+    return last - begin;
 }
 
 
-QStringList LumberjackCSVImporter::supportedFileTypes() const
+/*
+ * Return the arena of a chunk of the current block (the arenas are retained until the import is complete)
+ */
+ImportArena* LumberjackCSVImporter::getChunkArena(size_t idx)
 {
-    QStringList fileTypes;
-
-    fileTypes << "csv";
-    fileTypes << "tsv";
+    while (m_chunkArenas.size() <= idx)
+    {
+        m_chunkArenas.push_back(std::make_unique<ImportArena>());
+    }
 
-    return fileTypes;
+    return m_chunkArenas[idx].get();
 }
 
 
-
 /**
- * @brief LumberjackCSVImporter::beforeLoadData - Open configuration dialog
- * @return
+ * @brief LumberjackCSVImporter::parseChunk - Parse the data rows of a chunk (called concurrently for each chunk of a block).
+ * The row index of any warning is relative to the start of the chunk.
  */
-bool LumberjackCSVImporter::beforeImport(void)
+void LumberjackCSVImporter::parseChunk(ImportChunk &chunk)
 {
-    CSVImportOptionsDialog dlg(m_filename);
+    const char *ptr = chunk.begin;
 
-    int result = dlg.exec();
+    std::string_view line;
 
-    if (result == QDialog::Accepted)
+    while (m_isImporting && !isCancelled() && nextLine(ptr, chunk.end, true, line))
     {
-        m_options = dlg.getOptions();
+        // Ignore lines which start with prohibited characters
+        if (!m_ignorePrefix.empty() && line.substr(0, m_ignorePrefix.size()) == m_ignorePrefix)
+        {
+            continue;
+        }
+
+        splitRow(line, m_delimiter, chunk.row);
+
+        if (!extractData(chunk.lineCount, chunk))
+        {
+            chunk.badLineCount++;
+        }
+
+        chunk.lineCount++;
     }
 
-    return result == QDialog::Accepted;
+    m_bytesRead += chunk.end - chunk.begin;
 }
 
 
 /**
- * @brief LumberjackCSVImporter::loadDataFile
- * @param filename - The filename to load
- * @param errors -
- * @return
+ * @brief LumberjackCSVImporter::appendChunk - Add the samples of a chunk to their respective series.
+ * Chunks must be appended in file order (rows without a timestamp column are numbered across chunks).
  */
-bool LumberjackCSVImporter::importData(QStringList &errors)
+void LumberjackCSVImporter::appendChunk(ImportChunk &chunk)
 {
-    // Reset importer to initial conditions
-    m_headers.clear();
-    columnMap.clear();
-    incrementingTimestamp = 0;
-    initialTimestampSeen = false;
+    m_lineCount += chunk.lineCount;
+    m_badLineCount += chunk.badLineCount;
+    m_errors.append(chunk.errors);
 
-    QFileInfo fi(m_filename);
-
-    if (!fi.exists() || !fi.isFile())
-    {
-        errors.append(tr("File does not exist"));
-        return false;
-    }
+    const double scaler = m_options.getTimestampScaler();
 
-    m_bytesRead = 0;
-    m_fileSize = fi.size();
+    const bool numbered = !m_options.hasTimestamp;
+    const double row_offset = (double) m_dataRows;
 
-    m_file = new QFile(m_filename);
+    const bool exact = m_options.exactTimestamps && !numbered;
 
-    if (!m_file->open(QIODevice::ReadOnly) || !m_file->isOpen() || !m_file->isReadable())
+    if (exact && chunk.timestampSeen && !initialTimestampSeen)
     {
-        errors.append(tr("Could not open file for reading"));
-        m_file->close();
-        return false;
+        m_epochBase = chunk.epochBase;
     }
 
-    QString delimiter = m_options.getDelimiterString();
+    // Bases are whole days, so the difference between the base of a chunk and the base of the import is exact
+    const double base_offset = exact ? TimeTicks::toSeconds(chunk.epochBase - m_epochBase) : 0;
 
-    qint64 lineCount = 0;
-    qint64 badLineCount = 0;
+    // Rows are evenly spaced, so the series can be stored without a timestamp column
+    auto convert = [&](double t) {
+        return numbered ? (t + row_offset) * scaler : t + base_offset;
+    };
 
-    // Ensure we are at the start of the file
-    m_file->seek(0);
+    if (chunk.timestampSeen && !initialTimestampSeen)
+    {
+        initialTimestampSeen = true;
+        initialTimetamp = convert(chunk.firstTimestamp);
+    }
 
-    QStringList row;
+    const double zero = (m_options.colTimestamp >= 0 && m_options.zeroTimestamp) ? initialTimetamp : 0;
 
-    m_isImporting = true;
+    // Zeroed timestamps are not relative to a point in time
+    const qint64 epoch_base = exact && !m_options.zeroTimestamp ? m_epochBase : 0;
 
-    while (!m_file->atEnd() && m_isImporting && m_file != nullptr)
+    for (size_t idx = 0; idx < chunk.samples.size() && idx < columnSeries.size(); idx++)
     {
-        QByteArray bytes = m_file->readLine();
+        ChunkSamples &buffer = chunk.samples[idx];
 
-        QString line(bytes);
+        if (buffer.timestamps.empty()) continue;
 
-        line = line.trimmed();
+        columnSeries[idx]->setEpochBase(epoch_base);
 
-        // Ignore lines which start with prohibited characters
-        if (!m_options.ignoreRowsStartingWith.isEmpty() && line.startsWith(m_options.ignoreRowsStartingWith)) {
-            continue;
+        for (double &t : buffer.timestamps)
+        {
+            t = convert(t) - zero;
         }
 
-        row = line.split(delimiter);
+        // Out-of-order timestamps (e.g. which interleave with earlier chunks) are merged by the series
+        columnSeries[idx]->addData(buffer.timestamps.data(), buffer.values.data(), buffer.timestamps.size(), false);
+    }
 
-        if (!processRow(lineCount, row, errors))
+    if (m_rowIndex)
+    {
+        for (auto &series : columnSeries)
         {
-            badLineCount++;
+            series->setEpochBase(epoch_base);
         }
 
-        m_bytesRead += line.length();
-
-        lineCount++;
-    }
-
-    // Ensure file object is closed
-    m_file->close();
+        for (double &t : chunk.rowTimestamps)
+        {
+            t = convert(t) - zero;
+        }
 
-    m_isImporting = false;
+        m_rowIndex->offsets.insert(m_rowIndex->offsets.end(), chunk.rowOffsets.begin(), chunk.rowOffsets.end());
+        m_rowIndex->timestamps.insert(m_rowIndex->timestamps.end(), chunk.rowTimestamps.begin(), chunk.rowTimestamps.end());
 
-    if (badLineCount > 0)
-    {
-        errors.append(QString("Lines with errors: " + QString::number(badLineCount)));
+        chunk.rowOffsets.clear();
+        chunk.rowTimestamps.clear();
     }
 
-    return true;
+    m_dataRows += chunk.dataRows;
+
+    chunk.samples.clear();
 }
 
 
 /**
  * @brief LumberjackCSVImporter::processRow - Process a single row of data from the file
  * @param rowIndex - The row index with in the file
- * @param row - Delimited row data
- * @param errors
+ * @param chunk - Holds the delimited row data, and receives any samples
  * @return
  */
-bool LumberjackCSVImporter::processRow(int rowIndex, const QStringList &row, QStringList& errors)
+bool LumberjackCSVImporter::processRow(int rowIndex, ImportChunk &chunk)
 {
-    Q_UNUSED(errors)
-
     if (rowIndex == m_options.rowHeaders)
     {
-        return extractHeaders(rowIndex, row, errors);
+        return extractHeaders(rowIndex, chunk.row, chunk.errors);
     }
     else if (rowIndex == m_options.rowUnits)
     {
@@ -154,7 +852,7 @@ bool LumberjackCSVImporter::processRow(int rowIndex, const QStringList &row, QSt
     }
     else if (rowIndex >= m_options.rowDataStart)
     {
-        return extractData(rowIndex, row, errors);
+        return extractData(rowIndex, chunk);
     }
     else
     {
@@ -164,13 +862,14 @@ bool LumberjackCSVImporter::processRow(int rowIndex, const QStringList &row, QSt
 
 
 /**
- * @brief LumberjackCSVImporter::extractHeaders - Extract headers from the provided file
+ * @brief LumberjackCSVImporter::extractHeaders - Extract headers from the provided file.
+ * The series (and buffer) for each column is resolved here, rather than for each cell.
  * @param rowIndex
  * @param row
  * @param errors
  * @return
  */
-bool LumberjackCSVImporter::extractHeaders(int rowIndex, const QStringList &row, QStringList &errors)
+bool LumberjackCSVImporter::extractHeaders(int rowIndex, const Row &row, QStringList &errors)
 {
     Q_UNUSED(rowIndex);
 
@@ -179,9 +878,11 @@ bool LumberjackCSVImporter::extractHeaders(int rowIndex, const QStringList &row,
 
     m_headers.clear();
 
-    for (int ii = 0; ii < row.length(); ii++)
+    for (size_t ii = 0; ii < row.size(); ii++)
     {
-        QString header = row.at(ii).trimmed();
+        const std::string_view field = trimmed(row[ii]);
+
+        QString header = QString::fromUtf8(field.data(), (int) field.size());
 
         if (header.isEmpty())
         {
@@ -194,7 +895,7 @@ bool LumberjackCSVImporter::extractHeaders(int rowIndex, const QStringList &row,
         m_headers.append(header);
 
         // Ignore timestamp column
-        if (m_options.hasTimestamp && ii == m_options.colTimestamp)
+        if (m_options.hasTimestamp && (int) ii == m_options.colTimestamp)
         {
             continue;
         }
@@ -202,11 +903,56 @@ bool LumberjackCSVImporter::extractHeaders(int rowIndex, const QStringList &row,
         // Check that we don't have a duplicate header already
         if (!columnMap.contains(header))
         {
+            m_columnMutex.lock();
+
             columnMap.insert(
                 header,
                 QSharedPointer<DataSeries>(new DataSeries(header))
             );
+
+            m_columnMutex.unlock();
+        }
+    }
+
+    columnSeriesIndex.assign(m_headers.length(), -1);
+
+    QHash<DataSeries*, int> seriesIndex;
+
+    for (int ii = 0; ii < m_headers.length(); ii++)
+    {
+        // Ignore the timestamp column
+        if (m_options.hasTimestamp && ii == m_options.colTimestamp)
+        {
+            continue;
+        }
+
+        const QString header = m_headers.at(ii);
+        const QString backupHeader = "Column " + QString::number(ii);
+
+        QSharedPointer<DataSeries> series;
+
+        if (columnMap.contains(header))
+        {
+            series = columnMap.value(header);
+        }
+        else if (columnMap.contains(backupHeader))
+        {
+            series = columnMap.value(backupHeader);
+        }
+
+        if (series.isNull())
+        {
+            qWarning() << "CSV: No series matching label" << header;
+            continue;
         }
+
+        if (!seriesIndex.contains(series.data()))
+        {
+            seriesIndex.insert(series.data(), (int) columnSeries.size());
+            columnSeries.push_back(series);
+        }
+
+        columnSeriesIndex[ii] = seriesIndex.value(series.data());
     }
 
     return true;
@@ -215,26 +961,41 @@ bool LumberjackCSVImporter::extractHeaders(int rowIndex, const QStringList &row,
 
 
 /**
- * @brief LumberjackCSVImporter::extractData - Extract data from a given row
+ * @brief LumberjackCSVImporter::extractData - Extract data from a given row.
+ * Samples are added to the chunk, with the raw timestamp (or row number) of the row (see appendChunk).
  * @param rowIndex
- * @param row
- * @param errors
+ * @param chunk
  * @return
  */
-bool LumberjackCSVImporter::extractData(int rowIndex, const QStringList &row, QStringList &errors)
+bool LumberjackCSVImporter::extractData(int rowIndex, ImportChunk &chunk)
 {
-    // TODO: Error messages
-    Q_UNUSED(errors)
+    const Row &row = chunk.row;
 
     double timestamp = 0;
-
-    QString text;
     double value = 0;
-    bool result = false;
+
+    qint64 ticks = 0;
 
     if (!m_options.hasTimestamp)
     {
-        timestamp = incrementingTimestamp + m_options.getTimestampScaler();
+        chunk.dataRows++;
+        timestamp = (double) chunk.dataRows;
+    }
+    else if (m_options.exactTimestamps)
+    {
+        if (!extractTicks(rowIndex, row, ticks))
+        {
+            qWarning() << "CSV:" << "Line" << rowIndex << "does not contain valid timestamp";
+            return false;
+        }
+
+        // The timestamps of the chunk are relative to the day of its first timestamp (see appendChunk)
+        if (!chunk.timestampSeen)
+        {
+            chunk.epochBase = TimeTicks::getDayBase(ticks);
+        }
+
+        timestamp = TimeTicks::toSeconds(ticks - chunk.epochBase);
     }
     else if (!extractTimestamp(rowIndex, row, timestamp))
     {
@@ -242,83 +1003,59 @@ bool LumberjackCSVImporter::extractData(int rowIndex, const QStringList &row, QS
         return false;
     }
 
-    if (!initialTimestampSeen)
+    if (!chunk.timestampSeen)
     {
-        initialTimestampSeen = true;
-        initialTimetamp = timestamp;
+        chunk.timestampSeen = true;
+        chunk.firstTimestamp = timestamp;
     }
 
-    if (m_options.colTimestamp >= 0 && m_options.zeroTimestamp)
+    // The values of a lazy import are parsed later (see loadColumns), from the start of the row
+    if (m_rowIndex)
     {
-        timestamp -= initialTimetamp;
+        chunk.rowOffsets.push_back(m_blockOffset + (row.front().data() - m_blockBase));
+        chunk.rowTimestamps.push_back(timestamp);
+
+        return true;
     }
 
-    for (int ii = 0; ii < row.length(); ii++)
+    if (chunk.samples.size() < columnSeries.size())
     {
-        // Ignore the timestamp column
-        if (ii == m_options.colTimestamp)
-        {
-            continue;
-        }
-
-        QString text = row.at(ii).trimmed();
+        chunk.samples.reserve(columnSeries.size());
 
-        if (ii >= m_headers.length())
+        while (chunk.samples.size() < columnSeries.size())
         {
-            qWarning() << "CSV: Line" << rowIndex << "exceeded header count";
-            continue;
+            chunk.samples.push_back(ChunkSamples(chunk.arena));
+
+            chunk.samples.back().timestamps.reserve(chunk.rowHint);
+            chunk.samples.back().values.reserve(chunk.rowHint);
         }
+    }
 
-        // Ignore empty cell values
-        if (text.isEmpty())
+    for (size_t ii = 0; ii < row.size(); ii++)
+    {
+        // Ignore the timestamp column
+        if (m_options.hasTimestamp && (int) ii == m_options.colTimestamp)
         {
             continue;
         }
 
-        text = text.toLower();
-
-        if (text == "true" || text == "on" || text == "yes" || text == "y")
-        {
-            value = 1;
-            result = true;
-        }
-        else if (text == "false" || text == "off" || text == "no" || text == "n")
-        {
-            value = 0;
-            result = true;
-        }
-        else
+        if (ii >= columnSeriesIndex.size())
         {
-            value = text.toDouble(&result);
+            qWarning() << "CSV: Line" << rowIndex << "exceeded header count";
+            continue;
         }
 
         // Data could not be converted to a number
-        if (!result) continue;
+        if (!parseCell(row[ii], value)) continue;
 
-        // Ignore invalid or infinite values
-        if (isnan(value) || isinf(value)) continue;
+        const int index = columnSeriesIndex[ii];
 
-        QString header = m_headers.at(ii);
-        QString backupHeader = "Column " + QString::number(ii);
-
-        QSharedPointer<DataSeries> series;
-
-        if (columnMap.contains(header))
-        {
-            series = columnMap.value(header);
-        }
-        else if (columnMap.contains(backupHeader))
+        if (index >= 0)
         {
-            series = columnMap.value(backupHeader);
-        }
+            ChunkSamples &buffer = chunk.samples[index];
 
-        if (series.isNull())
-        {
-            qWarning() << "CSV: No series matching label" << header;
-        }
-        else
-        {
-            series->addData(timestamp, value, false);
+            buffer.timestamps.push_back(timestamp);
+            buffer.values.push_back(value);
         }
     }
 
@@ -333,90 +1070,185 @@ bool LumberjackCSVImporter::extractData(int rowIndex, const QStringList &row, QS
  * @param timestamp
  * @return
  */
-bool LumberjackCSVImporter::extractTimestamp(int rowIndex, const QStringList &row, double &timestamp)
+bool LumberjackCSVImporter::extractTimestamp(int rowIndex, const Row &row, double &timestamp)
 {
-    if (row.length() <= m_options.colTimestamp)
+    if ((int) row.size() <= m_options.colTimestamp)
     {
         qWarning() << "Line" << rowIndex << "missing timestamp column";
         return false;
     }
 
-    QString ts = row.at(m_options.colTimestamp);
+    const std::string_view ts = trimmed(row[m_options.colTimestamp]);
 
-    bool result = false;
+    const char *begin = ts.data();
+    const char *end = ts.data() + ts.size();
 
-    double timestampScaler = m_options.getTimestampScaler();
+    // Convert from ISO 8601 (e.g. 2024-03-01T12:30:05.250Z), as seconds since the epoch
+    if (ts.size() >= 10 && ts[4] == '-' && ts[7] == '-')
+    {
+        return ParseKernels::parseDateTime(begin, end, timestamp);
+    }
 
     // Convert from hh:mm::ss
-    if (ts.contains(":"))
+    if (ts.find(':') != std::string_view::npos)
     {
-        QStringList hhmmss = ts.trimmed().split(":");
+        return ParseKernels::parseTime(begin, end, timestamp);
+    }
 
-        double t = 0;
+    if (!ParseKernels::parseDouble(begin, end, timestamp))
+    {
+        return false;
+    }
 
-        double hh = 0;
-        double mm = 0;
-        double ss = 0;
-        double ms = 0;
+    timestamp *= m_options.getTimestampScaler();
 
-        bool hhOk = true;
-        bool mmOk = true;
-        bool ssOk = true;
-        bool msOk = true;
+    return true;
+}
 
-        // Expected format is hh:mm:ss:ms
 
-        if (hhmmss.length() > 0)
-        {
-            hh = hhmmss[0].toDouble(&hhOk);
-        }
+/**
+ * @brief LumberjackCSVImporter::extractTicks - Extract the exact timestamp of the provided row (see CSVImportOptions::exactTimestamps)
+ * @param rowIndex
+ * @param row
+ * @param ticks - Receives the timestamp, in nanoseconds
+ * @return
+ */
+bool LumberjackCSVImporter::extractTicks(int rowIndex, const Row &row, qint64 &ticks)
+{
+    if ((int) row.size() <= m_options.colTimestamp)
+    {
+        qWarning() << "Line" << rowIndex << "missing timestamp column";
+        return false;
+    }
 
-        if (hhmmss.length() > 1)
-        {
-            mm = hhmmss[1].toDouble(&mmOk);
-        }
+    const std::string_view ts = trimmed(row[m_options.colTimestamp]);
 
-        if (hhmmss.length() > 2)
-        {
-            ss = hhmmss[2].toDouble(&ssOk);
-        }
+    const char *begin = ts.data();
+    const char *end = ts.data() + ts.size();
 
-        // Process milliseconds
-        if (hhmmss.length() > 3)
-        {
-            ms = hhmmss[3].toDouble(&msOk);
+    int64_t value = 0;
 
-            if (msOk)
-            {
-                // "Resolution" of milliseconds depends on the length of the provided string
-                ms /= pow(10, hhmmss[3].length());
-            }
-        }
+    // Convert from ISO 8601, as nanoseconds since the epoch
+    if (ts.size() >= 10 && ts[4] == '-' && ts[7] == '-')
+    {
+        if (!ParseKernels::parseDateTimeTicks(begin, end, value)) return false;
+    }
+    else if (ts.find(':') != std::string_view::npos || !ParseKernels::parseTicks(begin, end, m_options.getTimestampExponent(), value))
+    {
+        // A time of day is small enough to be exact as a double, as is a number with an exponent (which is not fixed point)
+        double timestamp = 0;
+
+        if (!extractTimestamp(rowIndex, row, timestamp)) return false;
+
+        value = TimeTicks::fromSeconds(timestamp);
+    }
+
+    ticks = (qint64) value;
+
+    return true;
+}
+
+
+/**
+ * @brief LumberjackCSVImporter::loadColumns - Parse the values of the specified columns of a lazy import.
+ * The rows are divided into tasks of LOAD_ROWS, which are parsed in parallel.
+ * @param index - The data rows of the file
+ * @param columns - The columns of the series (columns with a duplicate header share a series)
+ * @param t_ms - Receives the timestamp of each sample
+ * @param values - Receives the value of each sample
+ * @return false if the file could not be read (or has changed since it was imported)
+ */
+bool LumberjackCSVImporter::loadColumns(const RowIndex &index, const std::vector<int> &columns, std::vector<double> &t_ms, std::vector<double> &values)
+{
+    QFileInfo fi(index.filename);
+
+    if (fi.size() != index.fileSize || fi.lastModified() != index.lastModified)
+    {
+        qWarning() << "CSV: File has changed since it was imported:" << index.filename;
+        return false;
+    }
+
+    QFile file(index.filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "CSV: Could not open file for reading:" << index.filename;
+        return false;
+    }
+
+    // If the file cannot be memory-mapped, it is read in full
+    QByteArray contents;
+
+    uchar *mapped = index.fileSize > 0 ? file.map(0, index.fileSize) : nullptr;
+
+    if (!mapped)
+    {
+        contents = file.readAll();
+
+        if (contents.size() != index.fileSize) return false;
+    }
+
+    const char *data = mapped ? (const char*) mapped : contents.constData();
+    const char *end = data + index.fileSize;
+
+    const size_t rows = index.offsets.size();
+    const size_t count = (rows + LOAD_ROWS - 1) / LOAD_ROWS;
+
+    std::vector<SampleBuffer> buffers(count);
+
+    parallelFor(count, [&](size_t task) {
+        SampleBuffer &buffer = buffers[task];
+        Row row;
+
+        std::string_view line;
+        double value = 0;
 
-        if (hhOk && mmOk && ssOk && msOk)
+        const size_t last = std::min(rows, (task + 1) * LOAD_ROWS);
+
+        for (size_t idx = task * LOAD_ROWS; idx < last; idx++)
         {
-            t = ss;
-            t += (mm * 60);
-            t += (hh * 3600);
-            t += ms;
+            const char *ptr = data + index.offsets[idx];
+
+            if (!nextLine(ptr, end, true, line)) continue;
 
-            timestamp = t;
+            splitRow(line, index.delimiter, row);
 
-            return true;
+            for (int column : columns)
+            {
+                if (column < (int) row.size() && parseCell(row[column], value))
+                {
+                    buffer.timestamps.push_back(index.timestamps[idx]);
+                    buffer.values.push_back(value);
+                }
+            }
         }
+    }, QThreadPool::globalInstance());
 
-        return false;
+    if (mapped)
+    {
+        file.unmap(mapped);
+    }
+
+    size_t total = 0;
 
+    for (const auto &buffer : buffers)
+    {
+        total += buffer.timestamps.size();
     }
 
-    timestamp = ts.toDouble(&result);
+    t_ms.clear();
+    values.clear();
+
+    t_ms.reserve(total);
+    values.reserve(total);
 
-    if (result)
+    for (const auto &buffer : buffers)
     {
-        timestamp *= timestampScaler;
+        t_ms.insert(t_ms.end(), buffer.timestamps.begin(), buffer.timestamps.end());
+        values.insert(values.end(), buffer.values.begin(), buffer.values.end());
     }
 
-    return result;
+    return true;
 }
 
 
@@ -441,22 +1273,57 @@ void LumberjackCSVImporter::cancelImport(void)
 }
 
 
+QSharedPointer<ImportPlugin> LumberjackCSVImporter::createInstance(void) const
+{
+    return QSharedPointer<ImportPlugin>(new LumberjackCSVImporter());
+}
+
+
 uint8_t LumberjackCSVImporter::getImportProgress(void) const
 {
     if (!m_isImporting) return 0;
 
-    if (m_bytesRead == 0 || m_fileSize == 0) return 0;
+    // The uncompressed size of a compressed file is not known
+    const int64_t bytesRead = m_compressedRead > 0 ? m_compressedRead.load() : m_bytesRead.load();
 
-    float progress = (float) m_bytesRead / (float) m_fileSize;
+    if (bytesRead == 0 || m_fileSize == 0) return 0;
+
+    float progress = (float) bytesRead / (float) m_fileSize;
 
     return (uint8_t) (progress * 100);
 }
 
 
 /**
- * Return the list of imported data series
+ * Return the list of imported data series (which grows while the headers are being imported)
  */
 QList<QSharedPointer<DataSeries>> LumberjackCSVImporter::getDataSeries(void) const
 {
+    QMutexLocker lock(&m_columnMutex);
+
     return columnMap.values();
 }
+
+
+/**
+ * Return a description of every import option (imported series are only re-used with the same options)
+ */
+QByteArray LumberjackCSVImporter::getOptionsKey(void) const
+{
+    QStringList options;
+
+    options << QString::number(m_options.zeroTimestamp);
+    options << QString::number(m_options.hasTimestamp);
+    options << QString::number(m_options.hasHeaders);
+    options << QString::number(m_options.hasUnits);
+    options << QString::number(m_options.colTimestamp);
+    options << QString::number(m_options.rowHeaders);
+    options << QString::number(m_options.rowUnits);
+    options << QString::number(m_options.rowDataStart);
+    options << QString::number(m_options.timestampFormat);
+    options << QString::number(m_options.exactTimestamps);
+    options << QString::number(m_options.delimeter);
+    options << m_options.ignoreRowsStartingWith;
+
+    return options.join(",").toUtf8();
+}
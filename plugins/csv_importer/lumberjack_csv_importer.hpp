@@ -1,10 +1,19 @@
 #ifndef LUMBERJACK_CSV_IMPORTER_HPP
 #define LUMBERJACK_CSV_IMPORTER_HPP
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QDateTime>
 #include <QFile>
+#include <QMutex>
 
 #include "plugin_importer.hpp"
 #include "csv_import_options.hpp"
+#include "import_arena.hpp"
 
 
 class LumberjackCSVImporter : public ImportPlugin
@@ -22,6 +31,7 @@ public:
     virtual QStringList supportedFileTypes(void) const override;
 
     virtual bool beforeImport(void) override;
+    virtual bool reuseImportOptions(const ImportPlugin &other) override;
     virtual bool importData(QStringList &errors) override;
     virtual void afterImport(void) override;
     virtual void cancelImport(void) override;
@@ -30,6 +40,15 @@ public:
 
     virtual QList<QSharedPointer<DataSeries>> getDataSeries(void) const override;
 
+    virtual QByteArray getOptionsKey(void) const override;
+
+    virtual QSharedPointer<ImportPlugin> createInstance(void) const override;
+
+    virtual bool isFollowEnabled(void) const override;
+    virtual bool importAppendedData(QStringList &errors) override;
+
+    virtual bool supportsCompressedFiles(void) const override { return true; }
+
 protected:
     //! Plugin metadata
     const QString m_name = "CSV Importer";
@@ -41,33 +60,190 @@ protected:
 
     QStringList m_headers;
 
+    /**
+     * @brief Row is a delimited row of the file. Each field refers to the bytes of the file in place,
+     * so rows are split (and cells are parsed) without any conversion to QString.
+     */
+    typedef std::vector<std::string_view> Row;
+
+    struct SampleBuffer
+    {
+        std::vector<double> timestamps;
+        std::vector<double> values;
+    };
+
+    /**
+     * @brief The ChunkSamples struct holds the samples of a series parsed from a chunk (allocated from the arena of the chunk)
+     */
+    struct ChunkSamples
+    {
+        ChunkSamples(ImportArena *arena) : timestamps(arena), values(arena) {}
+
+        ArenaBuffer<double> timestamps;
+        ArenaBuffer<double> values;
+    };
+
+    /**
+     * @brief The ImportChunk struct holds the samples parsed from a range of complete lines.
+     * Data rows are independent, so the chunks of a block are parsed concurrently, and the samples
+     * of each chunk are then added to the series in order (as a single batch per series).
+     *
+     * The samples are allocated from the arena of the chunk, which is reset once the block has been appended.
+     */
+    struct ImportChunk
+    {
+        ImportChunk(ImportArena *arena) : arena(arena), samples(arena), rowOffsets(arena), rowTimestamps(arena) {}
+
+        ImportArena *arena;
+
+        const char *begin = nullptr;
+        const char *end = nullptr;
+
+        //! Number of samples reserved for each series (from the size of the chunks of the previous block)
+        size_t rowHint = 0;
+
+        //! Samples for each series (indexed as for columnSeries)
+        ArenaBuffer<ChunkSamples> samples;
+
+        //! Fields of the current row
+        Row row;
+
+        qint64 lineCount = 0;
+        qint64 badLineCount = 0;
+
+        //! Number of data rows (which are numbered, if the file has no timestamp column)
+        qint64 dataRows = 0;
+
+        bool timestampSeen = false;
+        double firstTimestamp = 0;
+
+        //! Exact timestamps of the chunk are relative to this base (the day of its first timestamp)
+        qint64 epochBase = 0;
+
+        //! Offset and raw timestamp of each data row (if the values are not parsed)
+        ArenaBuffer<qint64> rowOffsets;
+        ArenaBuffer<double> rowTimestamps;
+
+        QStringList errors;
+    };
+
+    /**
+     * @brief The RowIndex struct records the data rows of a file which is imported lazily (see CSVImportOptions::lazyImport).
+     * Only the timestamp of each row is parsed during the import. The values of a column are parsed from
+     * the file (in parallel) when its series is first read, so the rows are located without scanning the file again.
+     */
+    struct RowIndex
+    {
+        QString filename;
+
+        //! The file must not change between the import and loading a column
+        qint64 fileSize = 0;
+        QDateTime lastModified;
+
+        char delimiter = ',';
+
+        //! Offset of each data row within the file
+        std::vector<qint64> offsets;
+
+        //! Timestamp of each data row
+        std::vector<double> timestamps;
+    };
+
+    //! Number of rows parsed by each task, when a column is loaded
+    static const size_t LOAD_ROWS = 1 << 16;
+
+    //! Approximate number of bytes parsed by each chunk
+    static const qint64 CHUNK_SIZE = 4 << 20;
+
     //! Internal functions for processing data
-    bool processRow(int rowIndex, const QStringList &row, QStringList &errors);
-    bool extractHeaders(int rowIndex, const QStringList &row, QStringList &errors);
-    bool extractData(int rowIndex, const QStringList &row, QStringList &errors);
-    bool extractTimestamp(int rowIndex, const QStringList &row, double &timestamp);
+    void processFile(QFile &file, bool final);
+    void processStream(QIODevice &device, bool final);
+    size_t processBlock(const char *begin, const char *end, bool final);
+    void parseChunk(ImportChunk &chunk);
+    void appendChunk(ImportChunk &chunk);
+    bool processRow(int rowIndex, ImportChunk &chunk);
+    bool extractHeaders(int rowIndex, const Row &row, QStringList &errors);
+    bool extractData(int rowIndex, ImportChunk &chunk);
+    bool extractTimestamp(int rowIndex, const Row &row, double &timestamp);
+    bool extractTicks(int rowIndex, const Row &row, qint64 &ticks);
+
+    static QByteArray readLayout(const QString &filename, const CSVImportOptions &options);
+
+    static bool loadColumns(const RowIndex &index, const std::vector<int> &columns, std::vector<double> &t_ms, std::vector<double> &values);
+
+    ImportArena* getChunkArena(size_t idx);
+
+    //! Arena of each chunk of a block (reset once the block has been appended, and released once the import is complete)
+    std::vector<std::unique_ptr<ImportArena>> m_chunkArenas;
+
+    //! Number of lines of the largest chunk of the previous block
+    qint64 m_chunkLines = 0;
 
     // Keep track of data columns while loading
     QHash<QString, QSharedPointer<DataSeries>> columnMap;
 
+    //! Protects the column map, which is read while the import is running (see getDataSeries)
+    mutable QMutex m_columnMutex;
+
+    //! Each series, in the order of the samples of each chunk (columns with duplicate headers share a series)
+    std::vector<QSharedPointer<DataSeries>> columnSeries;
+
+    //! Series for the samples of each column, or -1 if the column is not imported (resolved from the headers)
+    std::vector<int> columnSeriesIndex;
+
+    //! Delimiter, and prefix of ignored rows (as bytes)
+    char m_delimiter = ',';
+    std::string m_ignorePrefix;
+
+    //! Rows before this index (e.g. headers and units) are processed in order, and all later rows in parallel
+    qint64 m_firstDataRow = 0;
+
+    //! Line counts of the current import
+    qint64 m_lineCount = 0;
+    qint64 m_badLineCount = 0;
+
+    //! Data rows which have been added to the series
+    qint64 m_dataRows = 0;
+
+    //! Data rows of a lazy import (nullptr if the values are parsed during the import)
+    std::shared_ptr<RowIndex> m_rowIndex;
+
+    //! Start of the block being processed, and its offset within the file
+    const char *m_blockBase = nullptr;
+    qint64 m_blockOffset = 0;
+
+    QStringList m_errors;
+
     // Keep track of first timestamp value
     double initialTimetamp = 0;
     bool initialTimestampSeen = false;
 
-    // Internal timestamp which is used if not available in imported file
-    double incrementingTimestamp = 0;
+    //! Exact timestamps of the import are relative to this base (the epoch base of the first chunk)
+    qint64 m_epochBase = 0;
 
     //! File object being imported
     QFile *m_file = nullptr;
 
-    bool m_isImporting = false;
+    //! The file is memory-mapped if possible (otherwise it is read a block at a time, see processStream)
+    bool m_mapFile = true;
+
+    //! Approximate number of bytes parsed by each chunk (each block holds one chunk per worker thread)
+    qint64 m_chunkSize = CHUNK_SIZE;
+
+    std::atomic<bool> m_isImporting{false};
 
-    //! Number of bytes processed from the file
-    int64_t m_bytesRead;
+    //! Number of bytes processed from the file (by every worker)
+    std::atomic<int64_t> m_bytesRead{0};
+
+    //! Number of compressed bytes read from the file (if it is compressed)
+    std::atomic<int64_t> m_compressedRead{0};
 
     //! Total number of bytes in the file
     int64_t m_fileSize;
 
+    //! Offset of the first line which has not been processed (any later data are imported when the file is followed)
+    qint64 m_fileOffset = 0;
+
 };
 
 #endif // LUMBERJACK_CSV_IMPORTER_HPP
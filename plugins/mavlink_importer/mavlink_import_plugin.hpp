@@ -0,0 +1,19 @@
+#ifndef MAVLINK_IMPORT_PLUGIN_HPP
+#define MAVLINK_IMPORT_PLUGIN_HPP
+
+#include "mavlink_importer.hpp"
+#include "mavlink_importer_global.h"
+
+
+/**
+ * Plugin interface definition for the MavlinkImporter
+ * Use this to compile as a standalone plugin
+ */
+class MAVLINK_IMPORTER_EXPORT MavlinkImporterPlugin : public MavlinkImporter
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ImporterInterface_iid)
+    Q_INTERFACES(ImportPlugin)
+};
+
+#endif // MAVLINK_IMPORT_PLUGIN_HPP
@@ -0,0 +1,781 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThreadPool>
+
+#include "mavlink_importer.hpp"
+#include "parallel_for.hpp"
+
+
+const uint8_t MavlinkImporter::HEAD_BYTE_1;
+const uint8_t MavlinkImporter::HEAD_BYTE_2;
+const int MavlinkImporter::HEADER_LENGTH;
+const int MavlinkImporter::FORMAT_LENGTH;
+const qint64 MavlinkImporter::CHUNK_SIZE;
+const int MavlinkImporter::SYNC_MESSAGES;
+
+
+MavlinkImporter::MavlinkImporter()
+{
+
+}
+
+
+/*
+ * Return a list of support file extensions for this importer class
+ */
+QStringList MavlinkImporter::supportedFileTypes() const
+{
+    QStringList fileTypes;
+
+    fileTypes << "bin";
+
+    return fileTypes;
+}
+
+
+/**
+ * @brief MavlinkImporter::reuseImportOptions - There are no import options, so any file can be imported with another
+ */
+bool MavlinkImporter::reuseImportOptions(const ImportPlugin &other)
+{
+    Q_UNUSED(other);
+
+    return true;
+}
+
+
+/**
+ * @brief MavlinkImporter::getFieldFormat - Describe the encoding of a format character
+ * @param format - The format character (see LogStructure.h)
+ * @return the field format, or nullptr if the character is not known
+ */
+const MavlinkImporter::FieldFormat* MavlinkImporter::getFieldFormat(char format)
+{
+    static const FieldFormat formats[] =
+    {
+        {'a', FIELD_NONE,   64, 1},     // int16_t[32]
+        {'b', FIELD_INT8,   1,  1},     // int8_t
+        {'B', FIELD_UINT8,  1,  1},     // uint8_t
+        {'h', FIELD_INT16,  2,  1},     // int16_t
+        {'H', FIELD_UINT16, 2,  1},     // uint16_t
+        {'i', FIELD_INT32,  4,  1},     // int32_t
+        {'I', FIELD_UINT32, 4,  1},     // uint32_t
+        {'f', FIELD_FLOAT,  4,  1},     // float
+        {'d', FIELD_DOUBLE, 8,  1},     // double
+        {'n', FIELD_NONE,   4,  1},     // char[4]
+        {'N', FIELD_NONE,   16, 1},     // char[16]
+        {'Z', FIELD_NONE,   64, 1},     // char[64]
+        {'c', FIELD_INT16,  2,  0.01},  // int16_t * 100
+        {'C', FIELD_UINT16, 2,  0.01},  // uint16_t * 100
+        {'e', FIELD_INT32,  4,  0.01},  // int32_t * 100
+        {'E', FIELD_UINT32, 4,  0.01},  // uint32_t * 100
+        {'L', FIELD_INT32,  4,  1e-7},  // int32_t lat/lng (degrees * 1e7)
+        {'M', FIELD_UINT8,  1,  1},     // uint8_t flight mode
+        {'q', FIELD_INT64,  8,  1},     // int64_t
+        {'Q', FIELD_UINT64, 8,  1},     // uint64_t
+    };
+
+    for (const auto &f : formats)
+    {
+        if (f.format == format) return &f;
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Read mavlink data from the selected file
+ */
+bool MavlinkImporter::importData(QStringList &errors)
+{
+    QFile file(m_filename);
+
+    // Attempt to open the file
+    if (!file.exists() || !file.open(QIODevice::ReadOnly) || !file.isOpen() || !file.isReadable())
+    {
+        errors.append(tr("Could not open file for reading"));
+        return false;
+    }
+
+    m_fileSize = file.size();
+
+    if (m_fileSize < FORMAT_LENGTH)
+    {
+        errors.append(tr("File size is too small"));
+        return false;
+    }
+
+    QElapsedTimer totalTime;
+    totalTime.restart();
+
+    m_layouts.assign(256, MessageLayout());
+
+    m_timestamp = 0;
+    m_messageCount = 0;
+    m_skippedBytes = 0;
+    m_formatCount = 0;
+    m_bytesRead = 0;
+
+    m_isImporting = true;
+
+    // The messages are decoded in place, if the file can be memory-mapped
+    uchar *mapped = file.map(0, m_fileSize);
+
+    QByteArray contents;
+
+    const uint8_t *begin = (const uint8_t*) mapped;
+
+    if (!mapped)
+    {
+        contents = file.readAll();
+        begin = (const uint8_t*) contents.constData();
+    }
+
+    processFile(begin, begin + (mapped ? m_fileSize : contents.size()));
+
+    if (mapped)
+    {
+        file.unmap(mapped);
+    }
+
+    file.close();
+
+    const bool cancelled = !m_isImporting || isCancelled();
+
+    m_isImporting = false;
+
+    // The layouts are not needed after import
+    m_layouts.clear();
+
+    if (cancelled)
+    {
+        errors.append(tr("File import was cancelled"));
+        return false;
+    }
+
+    if (m_formatCount == 0)
+    {
+        errors.append(tr("File does not contain any format messages"));
+        return false;
+    }
+
+    if (m_skippedBytes > 0)
+    {
+        errors.append(tr("Bytes which could not be decoded: ") + QString::number(m_skippedBytes));
+    }
+
+    qDebug() << "Decoded" << m_messageCount << "messages from" << m_filename << "in" << QString::number((double) totalTime.elapsed() / 1000, 'f', 2) + "s";
+
+    return true;
+}
+
+
+/**
+ * @brief MavlinkImporter::processFile - Decode every message of the file.
+ * The format messages are read first. The file is then divided into chunks, which are decoded a round
+ * at a time (a chunk for each thread), so that the series grow while the file is being imported.
+ * @param begin - Start of the file
+ * @param end - End of the file
+ */
+void MavlinkImporter::processFile(const uint8_t *begin, const uint8_t *end)
+{
+    readFormats(begin, end);
+
+    if (m_formatCount == 0) return;
+
+    std::vector<const uint8_t*> boundaries;
+
+    const uint8_t *ptr = begin;
+
+    while (ptr < end)
+    {
+        boundaries.push_back(ptr);
+
+        ptr = end - ptr > m_chunkSize ? findBoundary(ptr + m_chunkSize, end) : end;
+    }
+
+    boundaries.push_back(end);
+
+    const size_t count = boundaries.size() - 1;
+    const size_t round = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+
+    for (size_t first = 0; first < count && m_isImporting && !isCancelled(); first += round)
+    {
+        std::vector<DecodeChunk> chunks(std::min(round, count - first));
+
+        for (size_t idx = 0; idx < chunks.size(); idx++)
+        {
+            chunks[idx].begin = boundaries[first + idx];
+            chunks[idx].end = boundaries[first + idx + 1];
+        }
+
+        parallelFor(chunks.size(), [this, &chunks](size_t idx) {
+            decodeChunk(chunks[idx]);
+        }, QThreadPool::globalInstance());
+
+        // Samples are added to each series in file order
+        for (auto &chunk : chunks)
+        {
+            appendChunk(chunk);
+        }
+    }
+}
+
+
+/**
+ * @brief MavlinkImporter::readFormats - Find every format message in the file, and then every format units message.
+ * A candidate header is only accepted if it is followed by another header (or the end of the file).
+ * If a type is described by more than one format message, the first is used.
+ * @param begin - Start of the file
+ * @param end - End of the file
+ */
+void MavlinkImporter::readFormats(const uint8_t *begin, const uint8_t *end)
+{
+    int unitsType = -1;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const int id = pass == 0 ? (int) MSG_ID_FORMAT : unitsType;
+
+        if (id < 0) break;
+
+        const int length = pass == 0 ? FORMAT_LENGTH : m_layouts[id].length;
+
+        const uint8_t *ptr = begin;
+
+        while (end - ptr >= length)
+        {
+            ptr = (const uint8_t*) memchr(ptr, HEAD_BYTE_1, end - ptr - length + 1);
+
+            if (!ptr) break;
+
+            const uint8_t *next = ptr + length;
+
+            const bool followed = end - next < 2 || (next[0] == HEAD_BYTE_1 && next[1] == HEAD_BYTE_2);
+
+            if (ptr[1] != HEAD_BYTE_2 || ptr[2] != id || !followed)
+            {
+                ptr++;
+                continue;
+            }
+
+            if (pass == 0)
+            {
+                decodeFormat(ptr + HEADER_LENGTH);
+            }
+            else
+            {
+                decodeFormatUnits(m_layouts[id], ptr + HEADER_LENGTH);
+            }
+
+            ptr = next;
+        }
+
+        for (int type = 0; type < (int) m_layouts.size() && unitsType < 0; type++)
+        {
+            if (m_layouts[type].formatUnits && m_layouts[type].valid) unitsType = type;
+        }
+    }
+}
+
+
+/**
+ * @brief MavlinkImporter::getMessageLength - Return the length of the message at the specified position,
+ * or zero if the position is not the header of a known message type
+ */
+int MavlinkImporter::getMessageLength(const uint8_t *ptr) const
+{
+    if (ptr[0] != HEAD_BYTE_1 || ptr[1] != HEAD_BYTE_2) return 0;
+
+    // Format message defines a "new packet format"
+    if (ptr[2] == MSG_ID_FORMAT) return FORMAT_LENGTH;
+
+    const MessageLayout &layout = m_layouts[ptr[2]];
+
+    return layout.defined ? layout.length : 0;
+}
+
+
+/**
+ * @brief MavlinkImporter::isFramed - Check that a number of consecutive messages start at the specified position
+ * @param ptr - Position of the first message
+ * @param end - End of the file
+ * @param count - Number of messages
+ * @return true if each message (up to the end of the file) has a known type, and is followed by the next
+ */
+bool MavlinkImporter::isFramed(const uint8_t *ptr, const uint8_t *end, int count) const
+{
+    for (int idx = 0; idx < count; idx++)
+    {
+        if (ptr == end) return true;
+
+        if (end - ptr < HEADER_LENGTH) return false;
+
+        const int length = getMessageLength(ptr);
+
+        if (length == 0 || end - ptr < length) return false;
+
+        ptr += length;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief MavlinkImporter::findBoundary - Find the first message boundary at (or after) the specified position
+ * @return the start of a message, or the end of the file if there are no more messages
+ */
+const uint8_t* MavlinkImporter::findBoundary(const uint8_t *ptr, const uint8_t *end) const
+{
+    while (ptr < end)
+    {
+        ptr = (const uint8_t*) memchr(ptr, HEAD_BYTE_1, end - ptr);
+
+        if (!ptr) break;
+
+        // A header byte sequence may also appear within a payload
+        if (isFramed(ptr, end, SYNC_MESSAGES)) return ptr;
+
+        ptr++;
+    }
+
+    return end;
+}
+
+
+/**
+ * @brief MavlinkImporter::decodeFormat - Compile a format message into the layout of its message type.
+ * A format must have a name, a format string, and a label for each format character.
+ * @param payload - The payload of the format message
+ * @return true if the layout of the type was added
+ */
+bool MavlinkImporter::decodeFormat(const uint8_t *payload)
+{
+    const uint8_t type = payload[0];
+    const uint8_t length = payload[1];
+
+    // The format of the format message itself is fixed
+    if (type == MSG_ID_FORMAT || m_layouts[type].defined) return false;
+
+    MessageLayout layout;
+
+    layout.name = readString(payload + 2, 4);
+    layout.formats = readString(payload + 6, 16).toLatin1();
+
+    for (auto label : readString(payload + 22, 64).split(","))
+    {
+        if (!label.isEmpty())
+        {
+            layout.labels.append(label);
+        }
+    }
+
+    if (layout.name.isEmpty() || layout.formats.isEmpty() || layout.labels.isEmpty())
+    {
+        qWarning() << "Invalid format message for type" << type;
+        return false;
+    }
+
+    if (layout.labels.length() != layout.formats.length())
+    {
+        qWarning() << layout.name << "Invalid format message - mismatch between format and label length";
+        return false;
+    }
+
+    if (length <= HEADER_LENGTH)
+    {
+        qWarning() << layout.name << "Invalid format message - zero length";
+        return false;
+    }
+
+    layout.length = length;
+    layout.defined = true;
+    layout.formatUnits = layout.name == "FMTU";
+    layout.valid = true;
+
+    // Compute the offset of each field, and the fields which are imported
+    int offset = 0;
+
+    for (int idx = 0; idx < layout.formats.length(); idx++)
+    {
+        const FieldFormat *format = getFieldFormat(layout.formats.at(idx));
+
+        if (!format)
+        {
+            // The offset of any later field is not known
+            qWarning() << layout.name << "invalid format:" << layout.formats.at(idx);
+            layout.valid = false;
+            break;
+        }
+
+        layout.offsets.push_back(offset);
+
+        const QString &label = layout.labels.at(idx);
+
+        if (format->type != FIELD_NONE)
+        {
+            Field field;
+
+            field.offset = offset;
+            field.type = format->type;
+            field.scale = format->scale;
+
+            if (idx == 0 && label == "TimeUS")
+            {
+                // Convert from microseconds to seconds
+                field.scale = 1e-6;
+                layout.timestamp = field;
+            }
+            else if (idx == 0 && label == "TimeMS")
+            {
+                field.scale = 1e-3;
+                layout.timestamp = field;
+            }
+            else
+            {
+                layout.fields.push_back(field);
+                layout.fieldLabels.append(label);
+            }
+        }
+
+        offset += format->size;
+    }
+
+    // Units and multipliers describe the other messages, and are not imported
+    if (layout.name == "UNIT" || layout.name == "MULT")
+    {
+        layout.fields.clear();
+        layout.fieldLabels.clear();
+    }
+
+    if (offset > length - HEADER_LENGTH)
+    {
+        qWarning() << layout.name << "Invalid format message - fields exceed message length";
+        layout.valid = false;
+    }
+
+    // Messages of an invalid format are still skipped (by their length)
+    m_layouts[type] = layout;
+
+    m_formatCount++;
+
+    return true;
+}
+
+
+/**
+ * @brief MavlinkImporter::decodeFormatUnits - Decode a "format units" message, which identifies
+ * the instance field of a message type (the field whose unit is '#')
+ * @param layout - The layout of the FMTU message
+ * @param payload - The payload of the FMTU message
+ */
+void MavlinkImporter::decodeFormatUnits(const MessageLayout &layout, const uint8_t *payload)
+{
+    const int typeIndex = layout.labels.indexOf("FmtType");
+    const int unitsIndex = layout.labels.indexOf("UnitIds");
+
+    if (typeIndex < 0 || unitsIndex < 0 || layout.formats.at(unitsIndex) != 'N') return;
+
+    const FieldFormat *typeFormat = getFieldFormat(layout.formats.at(typeIndex));
+
+    if (!typeFormat || typeFormat->type == FIELD_NONE) return;
+
+    const int type = (int) readField(payload + layout.offsets[typeIndex], typeFormat->type);
+
+    if (type < 0 || type >= (int) m_layouts.size() || type == MSG_ID_FORMAT) return;
+
+    MessageLayout &target = m_layouts[type];
+
+    // If a type is described more than once, the first is used
+    if (!target.valid || target.instance.type != FIELD_NONE) return;
+
+    const QString units = readString(payload + layout.offsets[unitsIndex], 16);
+
+    const int index = units.indexOf('#');
+
+    if (index < 0 || index >= target.labels.length()) return;
+
+    const QString label = target.labels.at(index);
+    const int field = target.fieldLabels.indexOf(label);
+
+    if (field < 0) return;
+
+    // The instance field identifies the series, rather than being imported
+    target.instance = target.fields[field];
+    target.instance.scale = 1;
+
+    target.fields.erase(target.fields.begin() + field);
+    target.fieldLabels.removeAt(field);
+}
+
+
+/**
+ * @brief MavlinkImporter::decodeChunk - Decode every message in a chunk of the file (called concurrently for each chunk).
+ * Data between messages (e.g. a message which was partially written) are skipped, until the next header is found.
+ * @param chunk - The chunk, which receives the decoded samples
+ */
+void MavlinkImporter::decodeChunk(MavlinkImporter::DecodeChunk &chunk) const
+{
+    chunk.timestamp = NAN;
+    chunk.buffers.resize(m_layouts.size());
+
+    const uint8_t *ptr = chunk.begin;
+    const uint8_t *end = chunk.end;
+
+    while (end - ptr >= HEADER_LENGTH)
+    {
+        // Check for cancellation periodically
+        if ((chunk.messageCount & 0xFFF) == 0 && (!m_isImporting || isCancelled())) return;
+
+        const int length = getMessageLength(ptr);
+
+        // Not a known message, so search for the next header
+        if (length == 0)
+        {
+            const uint8_t *next = (const uint8_t*) memchr(ptr + 1, HEAD_BYTE_1, end - ptr - 1);
+
+            if (!next) next = end;
+
+            chunk.skippedBytes += next - ptr;
+            ptr = next;
+            continue;
+        }
+
+        // An incomplete final message
+        if (end - ptr < length) break;
+
+        const uint8_t id = ptr[2];
+
+        // Format (and format units) messages have already been read
+        if (id != MSG_ID_FORMAT && m_layouts[id].valid && !m_layouts[id].formatUnits)
+        {
+            decodeMessage(chunk, id, ptr + HEADER_LENGTH);
+        }
+
+        chunk.messageCount++;
+
+        ptr += length;
+    }
+
+    chunk.skippedBytes += end - ptr;
+}
+
+
+/**
+ * @brief MavlinkImporter::decodeMessage - Decode a data message, appending the value of each field to its column buffer
+ * @param chunk - The chunk which contains the message
+ * @param type - The message type
+ * @param payload - The payload of the message
+ */
+void MavlinkImporter::decodeMessage(MavlinkImporter::DecodeChunk &chunk, uint8_t type, const uint8_t *payload) const
+{
+    const MessageLayout &layout = m_layouts[type];
+
+    if (layout.timestamp.type != FIELD_NONE)
+    {
+        chunk.timestamp = readField(payload + layout.timestamp.offset, layout.timestamp.type) * layout.timestamp.scale;
+    }
+
+    if (layout.fields.empty()) return;
+
+    int instance = 0;
+
+    if (layout.instance.type != FIELD_NONE)
+    {
+        instance = (int) readField(payload + layout.instance.offset, layout.instance.type);
+
+        // Instances are numbered from zero
+        if (instance < 0 || instance > 0xFF) return;
+    }
+
+    auto &buffers = chunk.buffers[type];
+
+    if ((int) buffers.size() <= instance)
+    {
+        buffers.resize(instance + 1);
+    }
+
+    ColumnBuffer &buffer = buffers[instance];
+
+    const size_t n = layout.fields.size();
+
+    if (buffer.values.empty())
+    {
+        buffer.values.resize(n);
+    }
+
+    buffer.timestamps.push_back(chunk.timestamp);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        const Field &field = layout.fields[idx];
+
+        buffer.values[idx].push_back(readField(payload + field.offset, field.type) * field.scale);
+    }
+}
+
+
+/**
+ * @brief MavlinkImporter::appendChunk - Add the samples of a chunk to the series (as a single batch per series).
+ * Chunks are appended in file order.
+ */
+void MavlinkImporter::appendChunk(MavlinkImporter::DecodeChunk &chunk)
+{
+    m_messageCount += chunk.messageCount;
+    m_skippedBytes += chunk.skippedBytes;
+
+    for (size_t type = 0; type < chunk.buffers.size(); type++)
+    {
+        for (size_t instance = 0; instance < chunk.buffers[type].size(); instance++)
+        {
+            ColumnBuffer &buffer = chunk.buffers[type][instance];
+
+            if (buffer.timestamps.empty()) continue;
+
+            // Messages before the first timestamp of the chunk use the time of the previous chunk
+            for (double &t : buffer.timestamps)
+            {
+                if (!std::isnan(t)) break;
+
+                t = m_timestamp;
+            }
+
+            const auto &series = getSeries(m_layouts[type], (int) instance);
+
+            for (size_t idx = 0; idx < series.size() && idx < buffer.values.size(); idx++)
+            {
+                series[idx]->addData(buffer.timestamps, buffer.values[idx], false);
+            }
+        }
+    }
+
+    if (!std::isnan(chunk.timestamp))
+    {
+        m_timestamp = chunk.timestamp;
+    }
+
+    m_bytesRead += chunk.end - chunk.begin;
+
+    // The samples are no longer needed
+    chunk.buffers.clear();
+}
+
+
+/**
+ * @brief MavlinkImporter::getSeries - Return the series of an instance of a message type,
+ * creating them when the first samples of the instance are added
+ */
+const std::vector<DataSeriesPointer>& MavlinkImporter::getSeries(MavlinkImporter::MessageLayout &layout, int instance)
+{
+    if ((int) layout.series.size() <= instance)
+    {
+        layout.series.resize(instance + 1);
+    }
+
+    auto &series = layout.series[instance];
+
+    if (series.empty())
+    {
+        QString prefix = layout.name;
+
+        if (layout.instance.type != FIELD_NONE)
+        {
+            prefix += "[" + QString::number(instance) + "]";
+        }
+
+        for (const QString &label : layout.fieldLabels)
+        {
+            const QString graphName = prefix + ":" + label;
+
+            m_seriesMutex.lock();
+
+            // A label may be shared by more than one message type
+            DataSeriesPointer s = m_series.value(graphName);
+
+            if (s.isNull())
+            {
+                s = DataSeriesPointer(new DataSeries(graphName));
+                m_series.insert(graphName, s);
+            }
+
+            m_seriesMutex.unlock();
+
+            series.push_back(s);
+        }
+    }
+
+    return series;
+}
+
+
+/**
+ * @brief MavlinkImporter::readField - Read a (little-endian, unaligned) field value from a message
+ */
+double MavlinkImporter::readField(const uint8_t *data, MavlinkImporter::FieldType type)
+{
+    switch (type)
+    {
+    case FIELD_INT8:    { int8_t v;   memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_UINT8:   { uint8_t v;  memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_INT16:   { int16_t v;  memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_UINT16:  { uint16_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_INT32:   { int32_t v;  memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_UINT32:  { uint32_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_INT64:   { int64_t v;  memcpy(&v, data, sizeof(v)); return (double) v; }
+    case FIELD_UINT64:  { uint64_t v; memcpy(&v, data, sizeof(v)); return (double) v; }
+    case FIELD_FLOAT:   { float v;    memcpy(&v, data, sizeof(v)); return v; }
+    case FIELD_DOUBLE:  { double v;   memcpy(&v, data, sizeof(v)); return v; }
+    default:
+        return 0;
+    }
+}
+
+
+/**
+ * @brief MavlinkImporter::readString - Read a fixed-length (and null-padded) string field
+ */
+QString MavlinkImporter::readString(const uint8_t *data, int length)
+{
+    const char *str = (const char*) data;
+
+    return QString::fromLatin1(str, (int) strnlen(str, length));
+}
+
+
+void MavlinkImporter::cancelImport(void)
+{
+    m_isImporting = false;
+}
+
+
+QSharedPointer<ImportPlugin> MavlinkImporter::createInstance(void) const
+{
+    return QSharedPointer<ImportPlugin>(new MavlinkImporter());
+}
+
+
+uint8_t MavlinkImporter::getImportProgress(void) const
+{
+    if (!m_isImporting || m_fileSize == 0) return 0;
+
+    return (uint8_t) ((float) m_bytesRead / (float) m_fileSize * 100);
+}
+
+
+/**
+ * Return the list of imported data series (which grows while the file is being imported)
+ */
+QList<DataSeriesPointer> MavlinkImporter::getDataSeries(void) const
+{
+    QMutexLocker lock(&m_seriesMutex);
+
+    return m_series.values();
+}
@@ -0,0 +1,253 @@
+/*
+ * Data importer for mavlink log files (.bin)
+ *
+ * This plugin provides support for ardupilot/mavlink logs,
+ * which would otherwise be viewed using mavexplorer.
+ *
+ * References:
+ * - https://discuss.ardupilot.org/t/log-file-format/49089
+ * - https://github.com/ArduPilot/ardupilot/blob/master/libraries/AP_Logger/LogStructure.h
+ */
+
+#ifndef MAVLINK_IMPORTER_HPP
+#define MAVLINK_IMPORTER_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+
+#include "plugin_importer.hpp"
+
+
+/**
+ * @brief The MavlinkImporter class imports ArduPilot DataFlash logs (.bin).
+ *
+ * Each message is a header (0xA3 0x95 and the message type) followed by a packed payload, whose
+ * layout is described by an earlier "format" (FMT) message. When a format message is decoded it is
+ * compiled into a MessageLayout: the offset, type and scale of each numeric field. The file is
+ * memory-mapped, and each later message of that type is decoded by reading its fields at those
+ * offsets, straight into the column buffers of its series.
+ *
+ * Messages which are logged for several instances of a sensor (e.g. IMU) are identified by the
+ * "format units" (FMTU) message of their type, and a series is created for each instance (e.g. IMU[1]:AccX).
+ *
+ * The format (and format units) messages are found first, by searching the file for their headers.
+ * The file is then divided into chunks at message boundaries: a boundary is only accepted where
+ * several consecutive messages are framed by the lengths of the format table, so a header byte
+ * sequence within a payload is not mistaken for a message. The chunks are decoded concurrently, and
+ * the samples of each chunk are then added to the series in order.
+ */
+class MavlinkImporter : public ImportPlugin
+{
+    Q_OBJECT
+
+public:
+    MavlinkImporter();
+
+    // Base plugin functionality
+    virtual QString pluginName(void) const override { return m_name; }
+    virtual QString pluginDescription(void) const override { return m_description; }
+    virtual QString pluginVersion(void) const override { return m_version; }
+
+    // Importer plugin functionality
+    virtual QStringList supportedFileTypes(void) const override;
+
+    virtual bool reuseImportOptions(const ImportPlugin &other) override;
+    virtual bool importData(QStringList &errors) override;
+    virtual void cancelImport(void) override;
+
+    virtual uint8_t getImportProgress(void) const override;
+
+    virtual QList<DataSeriesPointer> getDataSeries(void) const override;
+
+    virtual QSharedPointer<ImportPlugin> createInstance(void) const override;
+
+protected:
+    //! Plugin metadata
+    const QString m_name = "Mavlink Importer";
+    const QString m_description = "Import data from ArduPilot (mavlink) log files";
+    const QString m_version = "0.2.0";
+
+    // Expected header bytes (according to ArduPilot spec)
+    static const uint8_t HEAD_BYTE_1 = 0xA3;
+    static const uint8_t HEAD_BYTE_2 = 0x95;
+
+    //! Length of the message header
+    static const int HEADER_LENGTH = 3;
+
+    // Known message identifiers
+    enum
+    {
+        MSG_ID_FORMAT = 128,
+    };
+
+    //! Length of a format message: header + type (1) + length (1) + name (4) + format (16) + labels (64)
+    static const int FORMAT_LENGTH = HEADER_LENGTH + 86;
+
+    //! Approximate number of bytes decoded by each chunk
+    static const qint64 CHUNK_SIZE = 4 << 20;
+
+    //! A chunk boundary must be followed by this many messages (or the end of the file) of a known length
+    static const int SYNC_MESSAGES = 4;
+
+    //! Encoding of a field value within a message
+    enum FieldType : uint8_t
+    {
+        FIELD_NONE = 0,     // Not a numeric field (e.g. a string)
+        FIELD_INT8,
+        FIELD_UINT8,
+        FIELD_INT16,
+        FIELD_UINT16,
+        FIELD_INT32,
+        FIELD_UINT32,
+        FIELD_INT64,
+        FIELD_UINT64,
+        FIELD_FLOAT,
+        FIELD_DOUBLE,
+    };
+
+    /**
+     * @brief The FieldFormat struct describes a format character (e.g. 'c' is an int16_t * 100)
+     */
+    struct FieldFormat
+    {
+        char format;
+        FieldType type;
+        uint8_t size;
+        double scale;
+    };
+
+    static const FieldFormat* getFieldFormat(char format);
+
+    /**
+     * @brief The Field struct is a numeric field of a message, which is imported as a series
+     */
+    struct Field
+    {
+        uint16_t offset = 0;
+        FieldType type = FIELD_NONE;
+        double scale = 1;
+    };
+
+    /**
+     * @brief The ColumnBuffer struct holds the samples decoded for one instance of a message type, within a chunk
+     */
+    struct ColumnBuffer
+    {
+        std::vector<double> timestamps;
+
+        //! Values of each field (indexed as for MessageLayout::fields)
+        std::vector<std::vector<double>> values;
+    };
+
+    /**
+     * @brief The DecodeChunk struct holds the samples decoded from a range of complete messages
+     */
+    struct DecodeChunk
+    {
+        const uint8_t *begin = nullptr;
+        const uint8_t *end = nullptr;
+
+        //! Samples of each message type and instance
+        std::vector<std::vector<ColumnBuffer>> buffers;
+
+        //! Timestamp of the most recent message (NaN until a message with a timestamp is decoded)
+        double timestamp = 0;
+
+        qint64 messageCount = 0;
+        qint64 skippedBytes = 0;
+    };
+
+    /**
+     * @brief The MessageLayout struct is compiled from a format message, and describes where each field is found within the payload
+     */
+    struct MessageLayout
+    {
+        //! The type has been described by a valid format message
+        bool defined = false;
+
+        //! The fields of the type can be decoded (otherwise the messages are skipped)
+        bool valid = false;
+
+        QString name;
+
+        //! The messages are "format units", which describe the other message types (see decodeFormatUnits)
+        bool formatUnits = false;
+
+        //! Length of each message (including the header)
+        uint16_t length = 0;
+
+        //! Format character, label and offset of every field (including those which are not imported)
+        QByteArray formats;
+        QStringList labels;
+        std::vector<uint16_t> offsets;
+
+        //! Numeric fields, and the label of each
+        std::vector<Field> fields;
+        QStringList fieldLabels;
+
+        //! The timestamp field (if the type has no timestamp, the time of the previous message is used)
+        Field timestamp;
+
+        //! Field which identifies the instance (e.g. of a sensor), if the messages are logged for several instances
+        Field instance;
+
+        //! Series of each instance (messages without an instance field use the first)
+        std::vector<std::vector<DataSeriesPointer>> series;
+    };
+
+    void processFile(const uint8_t *begin, const uint8_t *end);
+
+    void readFormats(const uint8_t *begin, const uint8_t *end);
+    bool isFramed(const uint8_t *ptr, const uint8_t *end, int count) const;
+    const uint8_t* findBoundary(const uint8_t *ptr, const uint8_t *end) const;
+    int getMessageLength(const uint8_t *ptr) const;
+
+    bool decodeFormat(const uint8_t *payload);
+    void decodeFormatUnits(const MessageLayout &layout, const uint8_t *payload);
+
+    void decodeChunk(DecodeChunk &chunk) const;
+    void decodeMessage(DecodeChunk &chunk, uint8_t type, const uint8_t *payload) const;
+    void appendChunk(DecodeChunk &chunk);
+
+    const std::vector<DataSeriesPointer>& getSeries(MessageLayout &layout, int instance);
+
+    static double readField(const uint8_t *data, FieldType type);
+    static QString readString(const uint8_t *data, int length);
+
+    //! Layout of each message type, compiled from its format message
+    std::vector<MessageLayout> m_layouts;
+
+    //! Imported series, by label
+    QHash<QString, DataSeriesPointer> m_series;
+
+    //! Protects the series map, which is read while the import is running (see getDataSeries)
+    mutable QMutex m_seriesMutex;
+
+    //! Timestamp of the most recent message which has been added to the series (seconds)
+    double m_timestamp = 0;
+
+    //! Counts of the current import
+    qint64 m_messageCount = 0;
+    qint64 m_skippedBytes = 0;
+    qint64 m_formatCount = 0;
+
+    std::atomic<bool> m_isImporting{false};
+
+    //! Number of bytes decoded from the file
+    std::atomic<int64_t> m_bytesRead{0};
+
+    //! Total number of bytes in the file
+    int64_t m_fileSize = 0;
+
+    //! Approximate number of bytes decoded by each chunk
+    qint64 m_chunkSize = CHUNK_SIZE;
+};
+
+
+#endif // MAVLINK_IMPORTER_HPP
@@ -0,0 +1,7 @@
+INCLUDEPATH += ./plugins/mavlink_importer
+
+HEADERS += \
+    ./plugins/mavlink_importer/mavlink_importer.hpp
+
+SOURCES += \
+    ./plugins/mavlink_importer/mavlink_importer.cpp
@@ -0,0 +1,68 @@
+QT += gui widgets
+
+TEMPLATE = lib
+DEFINES += MAVLINK_IMPORTER_LIBRARY
+
+CONFIG += c++17
+CONFIG -= debug_and_release
+
+# Error if non-void func does not have a return type
+QMAKE_CXXFLAGS += -Wreturn-type -Werror=return-type
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += \
+    ../../src \
+    ../../src/plugins
+
+include(../../src/decompression.pri)
+
+HEADERS += \
+    mavlink_importer_global.h \
+    mavlink_import_plugin.hpp \
+    mavlink_importer.hpp \
+    ../../src/data_block.hpp \
+    ../../src/data_codec.hpp \
+    ../../src/data_kernels.hpp \
+    ../../src/data_store.hpp \
+    ../../src/data_series.hpp \
+    ../../src/decompression_device.hpp \
+    ../../src/parallel_for.hpp \
+    ../../src/plugins/plugin_base.hpp \
+    ../../src/cancellation_token.hpp \
+    ../../src/plugins/plugin_importer.hpp \
+
+SOURCES += \
+    ../../src/data_block.cpp \
+    ../../src/data_codec.cpp \
+    ../../src/data_kernels.cpp \
+    ../../src/data_store.cpp \
+    ../../src/data_series.cpp \
+    ../../src/decompression_device.cpp \
+    ../../src/parallel_for.cpp \
+    ../../src/plugins/plugin_importer.cpp \
+    mavlink_importer.cpp
+
+# Default rules for deployment.
+unix {
+    target.path = /usr/lib
+}
+
+# Specify output directory
+CONFIG(debug, debug|release) {
+    CONFIG += debug
+    DESTDIR = build/debug
+
+} else {
+    CONFIG += release
+    DESTDIR = ../build/release
+}
+
+RCC_DIR = $$DESDIR
+MOC_DIR = $$DESTDIR/moc
+OBJECTS_DIR = $$DESTDIR/objects
+
+!isEmpty(target.path): INSTALLS += target
+
+DISTFILES += \
+    mavlink_importer.json
@@ -0,0 +1,12 @@
+#ifndef MAVLINK_IMPORTER_GLOBAL_H
+#define MAVLINK_IMPORTER_GLOBAL_H
+
+#include <QtCore/qglobal.h>
+
+#if defined(MAVLINK_IMPORTER_LIBRARY)
+#define MAVLINK_IMPORTER_EXPORT Q_DECL_EXPORT
+#else
+#define MAVLINK_IMPORTER_EXPORT Q_DECL_IMPORT
+#endif
+
+#endif // MAVLINK_IMPORTER_GLOBAL_H
@@ -3,5 +3,18 @@
 
 OffsetFilter::OffsetFilter()
 {
-    // TODO
+}
+
+
+/**
+ * @brief OffsetFilter::filterChunk - Add the offset to every value (which may be done in place)
+ */
+void OffsetFilter::filterChunk(const FilterChunk &chunk)
+{
+    const double offset = m_offset;
+
+    for (size_t ii = 0; ii < chunk.length; ii++)
+    {
+        chunk.output[ii] = chunk.input[ii] + offset;
+    }
 }
@@ -18,11 +18,22 @@ public:
     virtual QString pluginDescription(void) const override { return m_description; }
     virtual QString pluginVersion(void) const override { return m_version; }
 
+    // Filter functionality
+    virtual bool isStateless(void) const override { return true; }
+    virtual void filterChunk(const FilterChunk &chunk) override;
+    virtual bool getAffine(double &scaler, double &offset) const override { scaler = 1; offset = m_offset; return true; }
+
+    void setOffset(double offset) { m_offset = offset; }
+    double getOffset(void) const { return m_offset; }
+
 protected:
     const QString m_name = "Offset Filter";
     const QString m_description = "Apply custom offset to a dataset";
     const QString m_version = "0.1.0";
 
+    //! Value which is added to every sample
+    double m_offset = 0.0;
+
 };
 
 #endif // LUMBERJACK_OFFSET_FILTER_HPP
@@ -15,12 +15,26 @@ INCLUDEPATH += \
 HEADERS += \
     offset_filter_global.h \
     offset_filter.hpp \
+    ../../src/data_block.hpp \
+    ../../src/data_codec.hpp \
+    ../../src/data_kernels.hpp \
+    ../../src/data_store.hpp \
+    ../../src/data_series.hpp \
+    ../../src/parallel_for.hpp \
     ../../src/plugins/plugin_base.hpp \
+    ../../src/cancellation_token.hpp \
     ../../src/plugins/plugin_filter.hpp \
     offset_filter_plugin.hpp
 
 SOURCES += \
-    offset_filter.cpp
+    offset_filter.cpp \
+    ../../src/data_block.cpp \
+    ../../src/data_codec.cpp \
+    ../../src/data_kernels.cpp \
+    ../../src/data_store.cpp \
+    ../../src/data_series.cpp \
+    ../../src/parallel_for.cpp \
+    ../../src/plugins/plugin_filter.cpp
 
 # Default rules for deployment.
 unix {
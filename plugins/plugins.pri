@@ -1,8 +1,11 @@
 # Importer plugins
 include("csv_importer/csv_importer.pri")
+include("mavlink_importer/mavlink_importer.pri")
+include("arrow_importer/arrow_importer.pri")
 
 # Exporter plugins
 include("csv_exporter/csv_exporter.pri")
+include("arrow_exporter/arrow_exporter.pri")
 
 # Filter plugins
 include("offset_filter/offset_filter.pri")
@@ -4,7 +4,10 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     csv_importer \
+    mavlink_importer \
+    arrow_importer \
     csv_exporter \
+    arrow_exporter \
     offset_filter \
     scaler_filter \
 
@@ -1,8 +1,20 @@
 #include "scaler_filter.hpp"
 
 
-
 ScalerFilter::ScalerFilter()
 {
-    // TODO
+}
+
+
+/**
+ * @brief ScalerFilter::filterChunk - Multiply every value by the scaler (which may be done in place)
+ */
+void ScalerFilter::filterChunk(const FilterChunk &chunk)
+{
+    const double scaler = m_scaler;
+
+    for (size_t ii = 0; ii < chunk.length; ii++)
+    {
+        chunk.output[ii] = chunk.input[ii] * scaler;
+    }
 }
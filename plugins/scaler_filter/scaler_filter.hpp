@@ -18,11 +18,22 @@ public:
     virtual QString pluginDescription(void) const override { return m_description; }
     virtual QString pluginVersion(void) const override { return m_version; }
 
+    // Filter functionality
+    virtual bool isStateless(void) const override { return true; }
+    virtual void filterChunk(const FilterChunk &chunk) override;
+    virtual bool getAffine(double &scaler, double &offset) const override { scaler = m_scaler; offset = 0; return true; }
+
+    void setScaler(double scaler) { m_scaler = scaler; }
+    double getScaler(void) const { return m_scaler; }
+
 protected:
     const QString m_name = "Scaler Filter";
     const QString m_description = "Apply custom scaler to a dataset";
     const QString m_version = "0.1.0";
 
+    //! Value which is multiplied with every sample
+    double m_scaler = 1.0;
+
 };
 
 #endif // LUMBERJACK_SCALER_FILTER_HPP
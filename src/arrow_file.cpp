@@ -0,0 +1,1250 @@
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef DECOMPRESS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "arrow_file.hpp"
+
+
+static const char ARROW_MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+
+//! Marks the start of an encapsulated message
+static const uint32_t CONTINUATION_MARKER = 0xFFFFFFFF;
+
+//! Metadata version (V5)
+static const int16_t METADATA_VERSION = 4;
+
+//! Message header types (see Message.fbs)
+static const uint8_t HEADER_SCHEMA = 1;
+static const uint8_t HEADER_RECORD_BATCH = 3;
+
+//! Floating point precision (see Schema.fbs)
+static const int16_t PRECISION_HALF = 0;
+static const int16_t PRECISION_SINGLE = 1;
+static const int16_t PRECISION_DOUBLE = 2;
+
+//! Buffer compression codecs (see Message.fbs)
+static const int CODEC_LZ4_FRAME = 0;
+static const int CODEC_ZSTD = 1;
+
+//! Each buffer of a message body starts at a multiple of this
+static const int64_t BODY_ALIGNMENT = 8;
+
+
+static int64_t paddedLength(int64_t length, int64_t alignment)
+{
+    return (length + alignment - 1) / alignment * alignment;
+}
+
+
+/**
+ * @brief The FlatBufferBuilder class builds FlatBuffers tables from back to front, as for the reference
+ * implementation: each child (e.g. a string or a vector) must be created before the table which refers to it,
+ * and is identified by its offset from the end of the buffer.
+ */
+class FlatBufferBuilder
+{
+public:
+    typedef uint32_t Offset;
+
+    size_t size(void) const { return m_buffer.size() - m_head; }
+
+    void startTable(void)
+    {
+        m_fields.clear();
+        m_tableStart = size();
+    }
+
+    template<typename T> void addScalar(int slot, T value)
+    {
+        push(value);
+        m_fields.push_back({slot, size()});
+    }
+
+    void addOffset(int slot, Offset offset)
+    {
+        pushOffset(offset);
+        m_fields.push_back({slot, size()});
+    }
+
+    Offset endTable(void);
+
+    Offset createString(const QString &string);
+    Offset createOffsetVector(const std::vector<Offset> &offsets);
+    Offset createStructVector(const void *data, size_t count, size_t elementSize, size_t alignment);
+
+    std::vector<uint8_t> finish(Offset root);
+
+protected:
+    void prepend(const void *data, size_t length);
+    void align(size_t alignment, size_t additional = 0);
+
+    template<typename T> void push(T value)
+    {
+        align(sizeof(T));
+        prepend(&value, sizeof(T));
+    }
+
+    //! An offset is relative to its own location (and refers forward, to an object which was created earlier)
+    void pushOffset(Offset offset)
+    {
+        align(sizeof(Offset));
+
+        const Offset value = (Offset) (size() + sizeof(Offset) - offset);
+
+        prepend(&value, sizeof(value));
+    }
+
+    std::vector<uint8_t> m_buffer;
+    size_t m_head = 0;
+
+    size_t m_minAlignment = 1;
+
+    //! Slot and location of each field of the current table
+    std::vector<std::pair<int, size_t>> m_fields;
+    size_t m_tableStart = 0;
+};
+
+
+void FlatBufferBuilder::prepend(const void *data, size_t length)
+{
+    if (m_head < length)
+    {
+        const size_t used = size();
+        const size_t capacity = std::max(m_buffer.size() * 2, used + length + 256);
+
+        std::vector<uint8_t> buffer(capacity);
+
+        if (used > 0) memcpy(buffer.data() + capacity - used, m_buffer.data() + m_head, used);
+
+        m_buffer.swap(buffer);
+        m_head = capacity - used;
+    }
+
+    m_head -= length;
+
+    if (data)
+    {
+        memcpy(m_buffer.data() + m_head, data, length);
+    }
+    else
+    {
+        memset(m_buffer.data() + m_head, 0, length);
+    }
+}
+
+
+/*
+ * Pad the buffer, so that it is aligned after a further number of bytes are added
+ */
+void FlatBufferBuilder::align(size_t alignment, size_t additional)
+{
+    m_minAlignment = std::max(m_minAlignment, alignment);
+
+    const size_t padding = (alignment - ((size() + additional) % alignment)) % alignment;
+
+    if (padding > 0) prepend(nullptr, padding);
+}
+
+
+/*
+ * Complete the current table, by adding its vtable (which precedes the table)
+ */
+FlatBufferBuilder::Offset FlatBufferBuilder::endTable(void)
+{
+    // Offset to the vtable, which is patched below
+    push<int32_t>(0);
+
+    const size_t table = size();
+
+    int slotCount = 0;
+
+    for (const auto &field : m_fields)
+    {
+        slotCount = std::max(slotCount, field.first + 1);
+    }
+
+    std::vector<uint16_t> vtable(2 + slotCount, 0);
+
+    vtable[0] = (uint16_t) (vtable.size() * sizeof(uint16_t));
+    vtable[1] = (uint16_t) (table - m_tableStart);
+
+    for (const auto &field : m_fields)
+    {
+        vtable[2 + field.first] = (uint16_t) (table - field.second);
+    }
+
+    for (size_t idx = vtable.size(); idx-- > 0;)
+    {
+        push<uint16_t>(vtable[idx]);
+    }
+
+    const int32_t vtableOffset = (int32_t) (size() - table);
+
+    memcpy(m_buffer.data() + m_buffer.size() - table, &vtableOffset, sizeof(vtableOffset));
+
+    m_fields.clear();
+
+    return (Offset) table;
+}
+
+
+FlatBufferBuilder::Offset FlatBufferBuilder::createString(const QString &string)
+{
+    const QByteArray bytes = string.toUtf8();
+
+    // Strings are null-terminated
+    align(sizeof(Offset), bytes.size() + 1);
+
+    prepend(nullptr, 1);
+    prepend(bytes.constData(), bytes.size());
+
+    push<uint32_t>((uint32_t) bytes.size());
+
+    return (Offset) size();
+}
+
+
+FlatBufferBuilder::Offset FlatBufferBuilder::createOffsetVector(const std::vector<FlatBufferBuilder::Offset> &offsets)
+{
+    align(sizeof(Offset), offsets.size() * sizeof(Offset));
+
+    for (size_t idx = offsets.size(); idx-- > 0;)
+    {
+        pushOffset(offsets[idx]);
+    }
+
+    push<uint32_t>((uint32_t) offsets.size());
+
+    return (Offset) size();
+}
+
+
+FlatBufferBuilder::Offset FlatBufferBuilder::createStructVector(const void *data, size_t count, size_t elementSize, size_t alignment)
+{
+    const size_t length = count * elementSize;
+
+    align(sizeof(Offset), length);
+    align(alignment, length);
+
+    if (length > 0) prepend(data, length);
+
+    push<uint32_t>((uint32_t) count);
+
+    return (Offset) size();
+}
+
+
+std::vector<uint8_t> FlatBufferBuilder::finish(FlatBufferBuilder::Offset root)
+{
+    align(m_minAlignment, sizeof(Offset));
+
+    pushOffset(root);
+
+    return std::vector<uint8_t>(m_buffer.begin() + m_head, m_buffer.end());
+}
+
+
+/**
+ * @brief buildSchema - Add a Schema table, in which each column is a nullable float64 column
+ */
+static FlatBufferBuilder::Offset buildSchema(FlatBufferBuilder &fbb, const QStringList &columns)
+{
+    std::vector<FlatBufferBuilder::Offset> fields;
+
+    for (const QString &column : columns)
+    {
+        const auto name = fbb.createString(column);
+
+        // Readers expect the children of every field (even if there are none)
+        const auto children = fbb.createOffsetVector({});
+
+        fbb.startTable();
+        fbb.addScalar<int16_t>(0, PRECISION_DOUBLE);
+        const auto type = fbb.endTable();
+
+        // Field: name, nullable, type_type, type, children
+        fbb.startTable();
+        fbb.addOffset(0, name);
+        fbb.addScalar<uint8_t>(1, 1);
+        fbb.addScalar<uint8_t>(2, ArrowFileReader::TYPE_FLOATING_POINT);
+        fbb.addOffset(3, type);
+        fbb.addOffset(5, children);
+        fields.push_back(fbb.endTable());
+    }
+
+    const auto vector = fbb.createOffsetVector(fields);
+
+    // Schema: endianness (little), fields
+    fbb.startTable();
+    fbb.addScalar<int16_t>(0, 0);
+    fbb.addOffset(1, vector);
+
+    return fbb.endTable();
+}
+
+
+/**
+ * @brief buildMessage - Complete a Message table (version, header_type, header, bodyLength)
+ */
+static std::vector<uint8_t> buildMessage(FlatBufferBuilder &fbb, uint8_t headerType, FlatBufferBuilder::Offset header, int64_t bodyLength)
+{
+    fbb.startTable();
+    fbb.addScalar<int64_t>(3, bodyLength);
+    fbb.addOffset(2, header);
+    fbb.addScalar<int16_t>(0, METADATA_VERSION);
+    fbb.addScalar<uint8_t>(1, headerType);
+
+    return fbb.finish(fbb.endTable());
+}
+
+
+ArrowFileWriter::ArrowFileWriter(QIODevice &device) : m_device(device)
+{
+}
+
+
+/**
+ * @brief ArrowFileWriter::begin - Write the file header and the schema
+ * @param columns - The name of each column
+ */
+bool ArrowFileWriter::begin(const QStringList &columns)
+{
+    m_columns = columns;
+    m_blocks.clear();
+    m_position = 0;
+    m_rows = 0;
+    m_counts.clear();
+    m_column = 0;
+
+    // The magic string is padded to 8 bytes
+    if (!writeBytes(ARROW_MAGIC, sizeof(ARROW_MAGIC)) || !writePadding(2)) return false;
+
+    FlatBufferBuilder fbb;
+
+    const auto schema = buildSchema(fbb, m_columns);
+
+    int64_t metadataLength = 0;
+
+    return writeMessage(buildMessage(fbb, HEADER_SCHEMA, schema, 0), 0, metadataLength);
+}
+
+
+/**
+ * @brief ArrowFileWriter::beginBatch - Start a record batch, by writing its metadata.
+ * The values of each column must then be written (in order) by writeColumn.
+ * @param rows - Number of rows in the batch
+ * @param counts - Number of values of each column (any remaining rows of the column are null)
+ */
+bool ArrowFileWriter::beginBatch(int64_t rows, const std::vector<int64_t> &counts)
+{
+    if (m_column < m_counts.size())
+    {
+        m_error = "Previous record batch is incomplete";
+        return false;
+    }
+
+    if ((int) counts.size() != m_columns.size())
+    {
+        m_error = "Column count does not match the schema";
+        return false;
+    }
+
+    m_rows = rows;
+    m_counts = counts;
+    m_column = 0;
+
+    // FieldNode (length, null_count) and Buffer (offset, length) of each column
+    std::vector<int64_t> nodes;
+    std::vector<int64_t> buffers;
+
+    int64_t bodyLength = 0;
+
+    for (int64_t count : counts)
+    {
+        const int64_t bitmapLength = count < rows ? (rows + 7) / 8 : 0;
+        const int64_t dataLength = rows * (int64_t) sizeof(double);
+
+        nodes.push_back(rows);
+        nodes.push_back(rows - count);
+
+        buffers.push_back(bodyLength);
+        buffers.push_back(bitmapLength);
+        bodyLength += paddedLength(bitmapLength, BODY_ALIGNMENT);
+
+        buffers.push_back(bodyLength);
+        buffers.push_back(dataLength);
+        bodyLength += paddedLength(dataLength, BODY_ALIGNMENT);
+    }
+
+    FlatBufferBuilder fbb;
+
+    const auto nodeVector = fbb.createStructVector(nodes.data(), nodes.size() / 2, 2 * sizeof(int64_t), sizeof(int64_t));
+    const auto bufferVector = fbb.createStructVector(buffers.data(), buffers.size() / 2, 2 * sizeof(int64_t), sizeof(int64_t));
+
+    // RecordBatch: length, nodes, buffers
+    fbb.startTable();
+    fbb.addScalar<int64_t>(0, rows);
+    fbb.addOffset(1, nodeVector);
+    fbb.addOffset(2, bufferVector);
+    const auto batch = fbb.endTable();
+
+    Block block;
+
+    block.offset = m_position;
+    block.bodyLength = bodyLength;
+
+    int64_t metadataLength = 0;
+
+    if (!writeMessage(buildMessage(fbb, HEADER_RECORD_BATCH, batch, bodyLength), bodyLength, metadataLength)) return false;
+
+    block.metadataLength = (int32_t) metadataLength;
+
+    m_blocks.push_back(block);
+
+    return true;
+}
+
+
+/**
+ * @brief ArrowFileWriter::writeColumn - Write the values of the next column of the current record batch
+ * @param values - The values of the column
+ * @param count - Number of values (as given to beginBatch)
+ */
+bool ArrowFileWriter::writeColumn(const double *values, int64_t count)
+{
+    if (m_column >= m_counts.size() || count != m_counts[m_column])
+    {
+        m_error = "Column does not match the record batch";
+        return false;
+    }
+
+    m_column++;
+
+    // Validity bitmap (least significant bit first), if any rows are null
+    if (count < m_rows)
+    {
+        std::vector<uint8_t> bitmap((size_t) paddedLength((m_rows + 7) / 8, BODY_ALIGNMENT), 0);
+
+        memset(bitmap.data(), 0xFF, (size_t) (count / 8));
+
+        if (count % 8) bitmap[count / 8] = (uint8_t) ((1 << (count % 8)) - 1);
+
+        if (!writeBytes(bitmap.data(), (int64_t) bitmap.size())) return false;
+    }
+
+    // Values of null rows are zero
+    return writeBytes(values, count * (int64_t) sizeof(double)) &&
+           writePadding((m_rows - count) * (int64_t) sizeof(double));
+}
+
+
+/**
+ * @brief ArrowFileWriter::finish - Write the footer, which locates each record batch
+ */
+bool ArrowFileWriter::finish(void)
+{
+    if (m_column < m_counts.size())
+    {
+        m_error = "Record batch is incomplete";
+        return false;
+    }
+
+    // Block: offset (int64), metaDataLength (int32, padded to 8 bytes), bodyLength (int64)
+    std::vector<uint8_t> blocks(m_blocks.size() * 24, 0);
+
+    for (size_t idx = 0; idx < m_blocks.size(); idx++)
+    {
+        memcpy(&blocks[idx * 24], &m_blocks[idx].offset, 8);
+        memcpy(&blocks[idx * 24 + 8], &m_blocks[idx].metadataLength, 4);
+        memcpy(&blocks[idx * 24 + 16], &m_blocks[idx].bodyLength, 8);
+    }
+
+    FlatBufferBuilder fbb;
+
+    const auto schema = buildSchema(fbb, m_columns);
+    const auto dictionaries = fbb.createStructVector(nullptr, 0, 24, 8);
+    const auto batches = fbb.createStructVector(blocks.data(), m_blocks.size(), 24, 8);
+
+    // Footer: version, schema, dictionaries, recordBatches
+    fbb.startTable();
+    fbb.addOffset(1, schema);
+    fbb.addOffset(2, dictionaries);
+    fbb.addOffset(3, batches);
+    fbb.addScalar<int16_t>(0, METADATA_VERSION);
+
+    const std::vector<uint8_t> footer = fbb.finish(fbb.endTable());
+
+    const int32_t footerLength = (int32_t) footer.size();
+
+    return writeBytes(footer.data(), footerLength) &&
+           writeBytes(&footerLength, sizeof(footerLength)) &&
+           writeBytes(ARROW_MAGIC, sizeof(ARROW_MAGIC));
+}
+
+
+/*
+ * Write an encapsulated message: continuation marker, metadata length, metadata (padded to 8 bytes)
+ */
+bool ArrowFileWriter::writeMessage(const std::vector<uint8_t> &metadata, int64_t bodyLength, int64_t &metadataLength)
+{
+    Q_UNUSED(bodyLength);
+
+    const int32_t length = (int32_t) (paddedLength(8 + (int64_t) metadata.size(), 8) - 8);
+
+    metadataLength = 8 + length;
+
+    return writeBytes(&CONTINUATION_MARKER, sizeof(CONTINUATION_MARKER)) &&
+           writeBytes(&length, sizeof(length)) &&
+           writeBytes(metadata.data(), (int64_t) metadata.size()) &&
+           writePadding(length - (int64_t) metadata.size());
+}
+
+
+bool ArrowFileWriter::writeBytes(const void *data, int64_t length)
+{
+    if (length <= 0) return true;
+
+    if (m_device.write((const char*) data, length) != length)
+    {
+        m_error = m_device.errorString();
+        return false;
+    }
+
+    m_position += length;
+
+    return true;
+}
+
+
+bool ArrowFileWriter::writePadding(int64_t length)
+{
+    static const char zeros[4096] = {0};
+
+    while (length > 0)
+    {
+        const int64_t n = std::min<int64_t>(length, sizeof(zeros));
+
+        if (!writeBytes(zeros, n)) return false;
+
+        length -= n;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief The FlatTable class reads the fields of a FlatBuffers table, checking that every access is within the buffer
+ */
+class FlatTable
+{
+public:
+    FlatTable() {}
+
+    FlatTable(const uint8_t *data, int64_t size, int64_t position) : m_data(data), m_size(size)
+    {
+        int32_t vtableOffset = 0;
+
+        if (!read(position, vtableOffset)) return;
+
+        const int64_t vtable = position - vtableOffset;
+
+        uint16_t vtableSize = 0;
+        uint16_t tableSize = 0;
+
+        if (!read(vtable, vtableSize) || !read(vtable + 2, tableSize) || vtableSize < 4 ||
+            !contains(vtable, vtableSize) || !contains(position, tableSize))
+        {
+            return;
+        }
+
+        m_position = position;
+        m_vtable = vtable;
+        m_vtableSize = vtableSize;
+        m_tableSize = tableSize;
+        m_valid = true;
+    }
+
+    //! The root table of a buffer
+    static FlatTable getRoot(const uint8_t *data, int64_t size)
+    {
+        return FlatTable(data, size, 0).getTableAt(0);
+    }
+
+    bool isValid(void) const { return m_valid; }
+
+    template<typename T> T getScalar(int slot, T value) const
+    {
+        const int64_t field = getField(slot);
+
+        if (field >= 0) read(field, value);
+
+        return value;
+    }
+
+    FlatTable getTable(int slot) const
+    {
+        const int64_t field = getField(slot);
+
+        return field < 0 ? FlatTable() : getTableAt(field);
+    }
+
+    //! The table which is referred to by the offset at the specified position
+    FlatTable getTableAt(int64_t position) const
+    {
+        uint32_t offset = 0;
+
+        if (!read(position, offset)) return FlatTable();
+
+        return FlatTable(m_data, m_size, position + offset);
+    }
+
+    QString getString(int slot) const
+    {
+        int64_t position = 0;
+        uint32_t count = 0;
+
+        if (!getVector(slot, 1, position, count)) return QString();
+
+        return QString::fromUtf8((const char*) m_data + position, (int) count);
+    }
+
+    //! Locate the elements of a vector
+    bool getVector(int slot, int64_t elementSize, int64_t &position, uint32_t &count) const
+    {
+        const int64_t field = getField(slot);
+
+        uint32_t offset = 0;
+
+        if (field < 0 || !read(field, offset) || !read(field + offset, count)) return false;
+
+        position = field + offset + 4;
+
+        return contains(position, count * elementSize);
+    }
+
+    template<typename T> bool read(int64_t position, T &value) const
+    {
+        if (!contains(position, sizeof(T))) return false;
+
+        memcpy(&value, m_data + position, sizeof(T));
+
+        return true;
+    }
+
+protected:
+    bool contains(int64_t position, int64_t length) const
+    {
+        return m_data && position >= 0 && length >= 0 && position + length <= m_size;
+    }
+
+    //! Position of a field, or -1 if the field is not present
+    int64_t getField(int slot) const
+    {
+        const int64_t entry = 4 + 2 * (int64_t) slot;
+
+        if (!m_valid || entry + 2 > m_vtableSize) return -1;
+
+        uint16_t offset = 0;
+
+        read(m_vtable + entry, offset);
+
+        if (offset == 0 || offset >= m_tableSize) return -1;
+
+        return m_position + offset;
+    }
+
+    const uint8_t *m_data = nullptr;
+    int64_t m_size = 0;
+
+    bool m_valid = false;
+
+    int64_t m_position = 0;
+    int64_t m_vtable = 0;
+    uint16_t m_vtableSize = 0;
+    uint16_t m_tableSize = 0;
+};
+
+
+/**
+ * @brief countLayout - Count the field nodes and buffers of a field (and its children) within a record batch
+ * @return false if the layout of the field is not known
+ */
+static bool countLayout(const FlatTable &field, int &nodes, int &buffers)
+{
+    nodes++;
+
+    // Only the indices of a dictionary-encoded field are in the record batch
+    if (field.getTable(4).isValid())
+    {
+        buffers += 2;
+        return true;
+    }
+
+    const uint8_t type = field.getScalar<uint8_t>(2, 0);
+
+    switch (type)
+    {
+    case ArrowFileReader::TYPE_NULL:
+    case ArrowFileReader::TYPE_RUN_END_ENCODED:
+        break;
+    case ArrowFileReader::TYPE_INT:
+    case ArrowFileReader::TYPE_FLOATING_POINT:
+    case ArrowFileReader::TYPE_BOOL:
+    case ArrowFileReader::TYPE_DECIMAL:
+    case ArrowFileReader::TYPE_DATE:
+    case ArrowFileReader::TYPE_TIME:
+    case ArrowFileReader::TYPE_TIMESTAMP:
+    case ArrowFileReader::TYPE_INTERVAL:
+    case ArrowFileReader::TYPE_FIXED_SIZE_BINARY:
+    case ArrowFileReader::TYPE_DURATION:
+    case ArrowFileReader::TYPE_LIST:
+    case ArrowFileReader::TYPE_LARGE_LIST:
+    case ArrowFileReader::TYPE_MAP:
+        buffers += 2;
+        break;
+    case ArrowFileReader::TYPE_BINARY:
+    case ArrowFileReader::TYPE_UTF8:
+    case ArrowFileReader::TYPE_LARGE_BINARY:
+    case ArrowFileReader::TYPE_LARGE_UTF8:
+        buffers += 3;
+        break;
+    case ArrowFileReader::TYPE_STRUCT:
+    case ArrowFileReader::TYPE_FIXED_SIZE_LIST:
+        buffers += 1;
+        break;
+    case ArrowFileReader::TYPE_UNION:
+        // Type ids (and offsets, for a dense union)
+        buffers += field.getTable(3).getScalar<int16_t>(0, 0) == 1 ? 2 : 1;
+        break;
+    default:
+        return false;
+    }
+
+    int64_t position = 0;
+    uint32_t count = 0;
+
+    if (field.getVector(5, 4, position, count))
+    {
+        for (uint32_t idx = 0; idx < count; idx++)
+        {
+            if (!countLayout(field.getTableAt(position + 4 * idx), nodes, buffers)) return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Seconds per unit of a time (SECOND, MILLISECOND, MICROSECOND, NANOSECOND)
+ */
+static double getTimeScale(int16_t unit)
+{
+    switch (unit)
+    {
+    default:
+    case 0: return 1;
+    case 1: return 1e-3;
+    case 2: return 1e-6;
+    case 3: return 1e-9;
+    }
+}
+
+
+/**
+ * @brief ArrowFileReader::open - Read the schema and locate each record batch of a file
+ * @param data - The contents of the file
+ * @param size - The size of the file
+ * @return false if the file is not a (supported) Arrow IPC file, see errorString
+ */
+bool ArrowFileReader::open(const uint8_t *data, int64_t size)
+{
+    m_data = data;
+    m_size = size;
+    m_columns.clear();
+    m_batches.clear();
+
+    const int64_t trailer = sizeof(int32_t) + sizeof(ARROW_MAGIC);
+
+    if (!data || size < 8 + trailer ||
+        memcmp(data, ARROW_MAGIC, sizeof(ARROW_MAGIC)) != 0 ||
+        memcmp(data + size - sizeof(ARROW_MAGIC), ARROW_MAGIC, sizeof(ARROW_MAGIC)) != 0)
+    {
+        m_error = "Not an Arrow IPC file";
+        return false;
+    }
+
+    int32_t footerLength = 0;
+    memcpy(&footerLength, data + size - trailer, sizeof(footerLength));
+
+    const int64_t footerStart = size - trailer - footerLength;
+
+    if (footerLength <= 0 || footerStart < 8)
+    {
+        m_error = "Invalid footer";
+        return false;
+    }
+
+    const FlatTable footer = FlatTable::getRoot(data + footerStart, footerLength);
+    const FlatTable schema = footer.getTable(1);
+
+    int64_t position = 0;
+    uint32_t count = 0;
+
+    if (!schema.isValid() || !schema.getVector(1, 4, position, count))
+    {
+        m_error = "Invalid schema";
+        return false;
+    }
+
+    int nodes = 0;
+    int buffers = 0;
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        const FlatTable field = schema.getTableAt(position + 4 * idx);
+
+        Column column;
+
+        column.name = field.getString(0);
+        column.type = field.getScalar<uint8_t>(2, 0);
+        column.dictionary = field.getTable(4).isValid();
+        column.node = nodes;
+        column.buffer = buffers;
+
+        const FlatTable type = field.getTable(3);
+
+        switch (column.type)
+        {
+        case TYPE_INT:
+            column.bitWidth = type.getScalar<int32_t>(0, 0);
+            column.isSigned = type.getScalar<uint8_t>(1, 0) != 0;
+            break;
+        case TYPE_FLOATING_POINT:
+            column.precision = type.getScalar<int16_t>(0, PRECISION_HALF);
+            break;
+        case TYPE_TIMESTAMP:
+        case TYPE_DURATION:
+            column.bitWidth = 64;
+            column.scale = getTimeScale(type.getScalar<int16_t>(0, 0));
+            break;
+        case TYPE_TIME:
+            column.scale = getTimeScale(type.getScalar<int16_t>(0, 1));
+            column.bitWidth = type.getScalar<int32_t>(1, 32);
+            break;
+        case TYPE_DATE:
+            // Days (int32) or milliseconds (int64)
+            if (type.getScalar<int16_t>(0, 1) == 0)
+            {
+                column.bitWidth = 32;
+                column.scale = 86400;
+            }
+            else
+            {
+                column.bitWidth = 64;
+                column.scale = 1e-3;
+            }
+            break;
+        default:
+            break;
+        }
+
+        column.isSigned = column.isSigned || column.type != TYPE_INT;
+
+        if (!field.isValid() || !countLayout(field, nodes, buffers))
+        {
+            m_error = "Unsupported column type: " + column.name;
+            return false;
+        }
+
+        m_columns.push_back(column);
+    }
+
+    // Block: offset (int64), metaDataLength (int32), bodyLength (int64)
+    if (!footer.getVector(3, 24, position, count))
+    {
+        m_error = "Invalid footer";
+        return false;
+    }
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        int64_t offset = 0;
+        int32_t metadataLength = 0;
+        int64_t bodyLength = 0;
+
+        footer.read(position + 24 * idx, offset);
+        footer.read(position + 24 * idx + 8, metadataLength);
+        footer.read(position + 24 * idx + 16, bodyLength);
+
+        if (!readBatch(offset, metadataLength, bodyLength)) return false;
+
+        const Batch &batch = m_batches.back();
+
+        if ((int) batch.nullCounts.size() < nodes || (int) batch.bufferOffsets.size() < buffers)
+        {
+            m_error = "Record batch does not match the schema";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Read the metadata of a record batch
+ */
+bool ArrowFileReader::readBatch(int64_t offset, int32_t metadataLength, int64_t bodyLength)
+{
+    if (offset < 8 || metadataLength < 8 || bodyLength < 0 || offset + metadataLength + bodyLength > m_size)
+    {
+        m_error = "Invalid record batch location";
+        return false;
+    }
+
+    const uint8_t *message = m_data + offset;
+
+    uint32_t marker = 0;
+    int32_t length = 0;
+
+    memcpy(&marker, message, sizeof(marker));
+
+    // Files written before the continuation marker was introduced only have the length
+    int64_t prefix = sizeof(int32_t);
+
+    if (marker == CONTINUATION_MARKER)
+    {
+        memcpy(&length, message + 4, sizeof(length));
+        prefix += sizeof(marker);
+    }
+    else
+    {
+        length = (int32_t) marker;
+    }
+
+    if (length <= 0 || prefix + length > metadataLength)
+    {
+        m_error = "Invalid record batch metadata";
+        return false;
+    }
+
+    const FlatTable root = FlatTable::getRoot(message + prefix, length);
+
+    const FlatTable header = root.getTable(2);
+
+    if (root.getScalar<uint8_t>(1, 0) != HEADER_RECORD_BATCH || !header.isValid())
+    {
+        m_error = "Invalid record batch metadata";
+        return false;
+    }
+
+    Batch batch;
+
+    batch.rows = header.getScalar<int64_t>(0, 0);
+    batch.body = m_data + offset + metadataLength;
+    batch.bodyLength = bodyLength;
+
+    int64_t position = 0;
+    uint32_t count = 0;
+
+    // FieldNode: length, null_count
+    if (header.getVector(1, 16, position, count))
+    {
+        for (uint32_t idx = 0; idx < count; idx++)
+        {
+            int64_t nulls = 0;
+            header.read(position + 16 * idx + 8, nulls);
+            batch.nullCounts.push_back(nulls);
+        }
+    }
+
+    // Buffer: offset, length
+    if (header.getVector(2, 16, position, count))
+    {
+        for (uint32_t idx = 0; idx < count; idx++)
+        {
+            int64_t bufferOffset = 0;
+            int64_t bufferLength = 0;
+
+            header.read(position + 16 * idx, bufferOffset);
+            header.read(position + 16 * idx + 8, bufferLength);
+
+            if (bufferOffset < 0 || bufferLength < 0 || bufferOffset + bufferLength > bodyLength)
+            {
+                m_error = "Invalid buffer location";
+                return false;
+            }
+
+            batch.bufferOffsets.push_back(bufferOffset);
+            batch.bufferLengths.push_back(bufferLength);
+        }
+    }
+
+    const FlatTable compression = header.getTable(3);
+
+    if (compression.isValid())
+    {
+        batch.codec = compression.getScalar<int8_t>(0, CODEC_LZ4_FRAME);
+    }
+
+    m_batches.push_back(batch);
+
+    return true;
+}
+
+
+QString ArrowFileReader::getColumnName(int column) const
+{
+    if (column < 0 || column >= (int) m_columns.size()) return QString();
+
+    return m_columns[column].name;
+}
+
+
+bool ArrowFileReader::isNumericColumn(int column) const
+{
+    if (column < 0 || column >= (int) m_columns.size()) return false;
+
+    const Column &c = m_columns[column];
+
+    if (c.dictionary) return false;
+
+    switch (c.type)
+    {
+    case TYPE_INT:
+    case TYPE_TIME:
+        return c.bitWidth == 8 || c.bitWidth == 16 || c.bitWidth == 32 || c.bitWidth == 64;
+    case TYPE_FLOATING_POINT:
+        return c.precision >= PRECISION_HALF && c.precision <= PRECISION_DOUBLE;
+    case TYPE_BOOL:
+    case TYPE_DATE:
+    case TYPE_TIMESTAMP:
+    case TYPE_DURATION:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+int64_t ArrowFileReader::getBatchRows(int batch) const
+{
+    if (batch < 0 || batch >= (int) m_batches.size()) return 0;
+
+    return m_batches[batch].rows;
+}
+
+
+/*
+ * Locate a buffer of a record batch (decompressing the buffer if required)
+ */
+bool ArrowFileReader::getBuffer(const Batch &batch, int index, const uint8_t *&data, int64_t &length, std::vector<uint8_t> &storage)
+{
+    if (index < 0 || index >= (int) batch.bufferOffsets.size()) return false;
+
+    data = batch.body + batch.bufferOffsets[index];
+    length = batch.bufferLengths[index];
+
+    if (batch.codec < 0 || length == 0) return true;
+
+    // A compressed buffer is prefixed by its uncompressed length (or -1, if it is not compressed)
+    int64_t uncompressed = 0;
+
+    if (length < 8) return false;
+
+    memcpy(&uncompressed, data, sizeof(uncompressed));
+
+    data += 8;
+    length -= 8;
+
+    if (uncompressed == -1) return true;
+
+    if (batch.codec != CODEC_ZSTD)
+    {
+        m_error = "LZ4 compressed files are not supported (use zstd or uncompressed)";
+        return false;
+    }
+
+#ifdef DECOMPRESS_ZSTD
+    storage.resize((size_t) uncompressed);
+
+    const size_t result = ZSTD_decompress(storage.data(), storage.size(), data, (size_t) length);
+
+    if (ZSTD_isError(result) || result != (size_t) uncompressed)
+    {
+        m_error = "Invalid compressed buffer";
+        return false;
+    }
+
+    data = storage.data();
+    length = uncompressed;
+
+    return true;
+#else
+    Q_UNUSED(storage);
+
+    m_error = "Compressed files are not supported";
+    return false;
+#endif
+}
+
+
+template<typename T> static void readValues(const uint8_t *data, int64_t rows, double scale, std::vector<double> &values)
+{
+    for (int64_t idx = 0; idx < rows; idx++)
+    {
+        T value;
+        memcpy(&value, data + idx * sizeof(T), sizeof(T));
+
+        values[idx] = (double) value * scale;
+    }
+}
+
+
+static float halfToFloat(uint16_t half)
+{
+    const int exponent = (half >> 10) & 0x1F;
+    const int mantissa = half & 0x3FF;
+
+    float value;
+
+    if (exponent == 0)
+    {
+        value = std::ldexp((float) mantissa, -24);
+    }
+    else if (exponent == 0x1F)
+    {
+        value = mantissa ? NAN : INFINITY;
+    }
+    else
+    {
+        value = std::ldexp((float) (mantissa | 0x400), exponent - 25);
+    }
+
+    return (half & 0x8000) ? -value : value;
+}
+
+
+/**
+ * @brief ArrowFileReader::readColumn - Read the values of a numeric column within a record batch
+ * @param batch - The record batch
+ * @param column - The column
+ * @param values - Receives the value of each row (converted to a double)
+ * @param valid - Receives the validity of each row (zero if the row is null)
+ * @return false if the column could not be read (see errorString)
+ */
+bool ArrowFileReader::readColumn(int batch, int column, std::vector<double> &values, std::vector<uint8_t> &valid)
+{
+    if (batch < 0 || batch >= (int) m_batches.size() || !isNumericColumn(column))
+    {
+        m_error = "Invalid column";
+        return false;
+    }
+
+    const Batch &b = m_batches[batch];
+    const Column &c = m_columns[column];
+
+    const int64_t rows = b.rows;
+
+    std::vector<uint8_t> bitmapStorage;
+    std::vector<uint8_t> dataStorage;
+
+    const uint8_t *bitmap = nullptr;
+    const uint8_t *data = nullptr;
+
+    int64_t bitmapLength = 0;
+    int64_t dataLength = 0;
+
+    if (!getBuffer(b, c.buffer, bitmap, bitmapLength, bitmapStorage) ||
+        !getBuffer(b, c.buffer + 1, data, dataLength, dataStorage))
+    {
+        if (m_error.isEmpty()) m_error = "Invalid buffer";
+        return false;
+    }
+
+    valid.assign((size_t) rows, 1);
+
+    // The validity bitmap may be omitted if no rows are null
+    if (b.nullCounts[c.node] > 0 && bitmapLength > 0)
+    {
+        if (bitmapLength < (rows + 7) / 8)
+        {
+            m_error = "Invalid validity bitmap";
+            return false;
+        }
+
+        for (int64_t idx = 0; idx < rows; idx++)
+        {
+            valid[idx] = (bitmap[idx / 8] >> (idx % 8)) & 1;
+        }
+    }
+
+    values.resize((size_t) rows);
+
+    int64_t width = c.bitWidth / 8;
+
+    if (c.type == TYPE_FLOATING_POINT) width = c.precision == PRECISION_HALF ? 2 : (c.precision == PRECISION_SINGLE ? 4 : 8);
+
+    const int64_t required = c.type == TYPE_BOOL ? (rows + 7) / 8 : rows * width;
+
+    if (dataLength < required)
+    {
+        m_error = "Invalid data buffer";
+        return false;
+    }
+
+    if (c.type == TYPE_BOOL)
+    {
+        for (int64_t idx = 0; idx < rows; idx++)
+        {
+            values[idx] = (data[idx / 8] >> (idx % 8)) & 1;
+        }
+    }
+    else if (c.type == TYPE_FLOATING_POINT)
+    {
+        switch (c.precision)
+        {
+        case PRECISION_HALF:
+            for (int64_t idx = 0; idx < rows; idx++)
+            {
+                uint16_t half;
+                memcpy(&half, data + idx * 2, sizeof(half));
+                values[idx] = halfToFloat(half);
+            }
+            break;
+        case PRECISION_SINGLE:
+            readValues<float>(data, rows, 1, values);
+            break;
+        default:
+            readValues<double>(data, rows, 1, values);
+            break;
+        }
+    }
+    else
+    {
+        switch (c.bitWidth)
+        {
+        case 8:
+            if (c.isSigned) readValues<int8_t>(data, rows, c.scale, values); else readValues<uint8_t>(data, rows, c.scale, values);
+            break;
+        case 16:
+            if (c.isSigned) readValues<int16_t>(data, rows, c.scale, values); else readValues<uint16_t>(data, rows, c.scale, values);
+            break;
+        case 32:
+            if (c.isSigned) readValues<int32_t>(data, rows, c.scale, values); else readValues<uint32_t>(data, rows, c.scale, values);
+            break;
+        default:
+            if (c.isSigned) readValues<int64_t>(data, rows, c.scale, values); else readValues<uint64_t>(data, rows, c.scale, values);
+            break;
+        }
+    }
+
+    return true;
+}
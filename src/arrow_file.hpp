@@ -0,0 +1,190 @@
+#ifndef ARROW_FILE_HPP
+#define ARROW_FILE_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+
+
+/*
+ * Support for the Arrow IPC file format (also known as Feather V2), which is read by pyarrow and pandas
+ * (e.g. pandas.read_feather). The format is columnar: a file is a schema, followed by record batches,
+ * each of which holds a contiguous buffer of values (and a validity bitmap) for every column.
+ *
+ * The metadata of each message are FlatBuffers tables, which are written and read here directly
+ * (see arrow_file.cpp), so no Arrow library is required.
+ *
+ * References:
+ * - https://arrow.apache.org/docs/format/Columnar.html
+ * - https://github.com/apache/arrow/blob/main/format/Schema.fbs (and Message.fbs, File.fbs)
+ */
+
+
+/**
+ * @brief The ArrowFileWriter class writes columns of doubles to an Arrow IPC file.
+ *
+ * Every column is a nullable float64 column. The rows are written in record batches: the number of
+ * valid values in each column of a batch is given first (see beginBatch), and then the values of each
+ * column are written in order (see writeColumn). The values of a column are the first rows of the batch,
+ * and any remaining rows are null, so columns of different lengths can be written to the same file.
+ */
+class ArrowFileWriter
+{
+public:
+    explicit ArrowFileWriter(QIODevice &device);
+
+    bool begin(const QStringList &columns);
+    bool beginBatch(int64_t rows, const std::vector<int64_t> &counts);
+    bool writeColumn(const double *values, int64_t count);
+    bool finish(void);
+
+    QString errorString(void) const { return m_error; }
+
+protected:
+    bool writeMessage(const std::vector<uint8_t> &metadata, int64_t bodyLength, int64_t &metadataLength);
+    bool writeBytes(const void *data, int64_t length);
+    bool writePadding(int64_t length);
+
+    /**
+     * @brief The Block struct is the location of a record batch within the file (for the footer)
+     */
+    struct Block
+    {
+        int64_t offset;
+        int32_t metadataLength;
+        int64_t bodyLength;
+    };
+
+    QIODevice &m_device;
+
+    QStringList m_columns;
+
+    std::vector<Block> m_blocks;
+
+    //! Rows, and valid rows of each column, in the current batch
+    int64_t m_rows = 0;
+    std::vector<int64_t> m_counts;
+
+    //! Next column of the current batch
+    size_t m_column = 0;
+
+    //! Number of bytes written
+    int64_t m_position = 0;
+
+    QString m_error;
+};
+
+
+/**
+ * @brief The ArrowFileReader class reads the numeric columns of an Arrow IPC file, which is in memory
+ * (e.g. memory-mapped). The values of each column are converted to doubles: integer, floating point,
+ * boolean, timestamp, date and duration columns are supported (times are converted to seconds).
+ * Other columns (e.g. strings) are skipped.
+ *
+ * Buffers which are compressed with ZSTD are supported if the zstd library is available (see decompression.pri).
+ */
+class ArrowFileReader
+{
+public:
+    bool open(const uint8_t *data, int64_t size);
+
+    QString errorString(void) const { return m_error; }
+
+    int getColumnCount(void) const { return (int) m_columns.size(); }
+    QString getColumnName(int column) const;
+    bool isNumericColumn(int column) const;
+
+    int getBatchCount(void) const { return (int) m_batches.size(); }
+    int64_t getBatchRows(int batch) const;
+
+    bool readColumn(int batch, int column, std::vector<double> &values, std::vector<uint8_t> &valid);
+
+    //! Column types (see Schema.fbs)
+    enum TypeId
+    {
+        TYPE_NONE = 0,
+        TYPE_NULL = 1,
+        TYPE_INT = 2,
+        TYPE_FLOATING_POINT = 3,
+        TYPE_BINARY = 4,
+        TYPE_UTF8 = 5,
+        TYPE_BOOL = 6,
+        TYPE_DECIMAL = 7,
+        TYPE_DATE = 8,
+        TYPE_TIME = 9,
+        TYPE_TIMESTAMP = 10,
+        TYPE_INTERVAL = 11,
+        TYPE_LIST = 12,
+        TYPE_STRUCT = 13,
+        TYPE_UNION = 14,
+        TYPE_FIXED_SIZE_BINARY = 15,
+        TYPE_FIXED_SIZE_LIST = 16,
+        TYPE_MAP = 17,
+        TYPE_DURATION = 18,
+        TYPE_LARGE_BINARY = 19,
+        TYPE_LARGE_UTF8 = 20,
+        TYPE_LARGE_LIST = 21,
+        TYPE_RUN_END_ENCODED = 22,
+    };
+
+protected:
+    /**
+     * @brief The Column struct describes a (top-level) column of the schema
+     */
+    struct Column
+    {
+        QString name;
+
+        int type = TYPE_NONE;
+
+        //! Integer width (bits) and signedness, or floating point precision (0 = half, 1 = single, 2 = double)
+        int bitWidth = 0;
+        bool isSigned = false;
+        int precision = 0;
+
+        //! Seconds per unit, for times (e.g. 1e-6 for a microsecond timestamp)
+        double scale = 1;
+
+        //! The column is dictionary-encoded (which is not supported)
+        bool dictionary = false;
+
+        //! Index of the first field node and buffer of the column, within each record batch
+        int node = 0;
+        int buffer = 0;
+    };
+
+    /**
+     * @brief The Batch struct is a record batch: its row count, and the location of each buffer
+     */
+    struct Batch
+    {
+        int64_t rows = 0;
+
+        const uint8_t *body = nullptr;
+        int64_t bodyLength = 0;
+
+        std::vector<int64_t> bufferOffsets;
+        std::vector<int64_t> bufferLengths;
+        std::vector<int64_t> nullCounts;
+
+        //! Buffer compression codec (-1 if the buffers are not compressed)
+        int codec = -1;
+    };
+
+    bool readBatch(int64_t offset, int32_t metadataLength, int64_t bodyLength);
+    bool getBuffer(const Batch &batch, int index, const uint8_t *&data, int64_t &length, std::vector<uint8_t> &storage);
+
+    const uint8_t *m_data = nullptr;
+    int64_t m_size = 0;
+
+    std::vector<Column> m_columns;
+    std::vector<Batch> m_batches;
+
+    QString m_error;
+};
+
+#endif // ARROW_FILE_HPP
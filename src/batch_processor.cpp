@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+
+#include "batch_processor.hpp"
+#include "math_data_series.hpp"
+#include "math_trace_computer.hpp"
+#include "parallel_for.hpp"
+#include "trace_recorder.hpp"
+
+
+BatchProcessor::BatchProcessor(const ImportPluginList &importers, const ExportPluginList &exporters) :
+    importers(importers),
+    exporters(exporters)
+{
+    for (const auto &plugin : importers)
+    {
+        locks[plugin.data()] = QSharedPointer<QMutex>(new QMutex());
+    }
+
+    for (const auto &plugin : exporters)
+    {
+        locks[plugin.data()] = QSharedPointer<QMutex>(new QMutex());
+    }
+}
+
+
+/**
+ * @brief BatchProcessor::loadJob - Read a job file (see parseJob)
+ */
+bool BatchProcessor::loadJob(const QString &filename, Job &job, QStringList &errors)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errors.append(QString("Could not open job file: %1").arg(filename));
+        return false;
+    }
+
+    return parseJob(file.readAll(), QFileInfo(filename).absoluteDir(), job, errors);
+}
+
+
+/*
+ * Expand a wildcard pattern (in the file name only) to the matching files, in order of name
+ */
+static QStringList expandPattern(const QString &pattern, const QDir &base)
+{
+    const QFileInfo info(base, pattern);
+
+    if (!info.fileName().contains('*') && !info.fileName().contains('?'))
+    {
+        return QStringList(info.absoluteFilePath());
+    }
+
+    const QDir dir = info.absoluteDir();
+
+    QStringList files;
+
+    for (const QString &name : dir.entryList(QStringList(info.fileName()), QDir::Files, QDir::Name))
+    {
+        files.append(dir.absoluteFilePath(name));
+    }
+
+    return files;
+}
+
+
+/**
+ * @brief BatchProcessor::parseJob - Parse the description of a job
+ * @param json is the job (see BatchProcessor)
+ * @param base is the directory to which relative paths are resolved
+ * @param job receives the job, with its input patterns expanded
+ * @param errors receives a description of any problem
+ * @return true if the job is valid
+ */
+bool BatchProcessor::parseJob(const QByteArray &json, const QDir &base, Job &job, QStringList &errors)
+{
+    QJsonParseError error;
+
+    const QJsonDocument document = QJsonDocument::fromJson(json, &error);
+
+    if (!document.isObject())
+    {
+        errors.append(QString("Invalid job: %1").arg(error.errorString()));
+        return false;
+    }
+
+    const QJsonObject object = document.object();
+
+    Job parsed;
+
+    for (const auto &input : object["inputs"].toArray())
+    {
+        const QStringList files = expandPattern(input.toString(), base);
+
+        if (files.isEmpty())
+        {
+            errors.append(QString("No files match %1").arg(input.toString()));
+        }
+
+        parsed.inputs.append(files);
+    }
+
+    parsed.inputs.removeDuplicates();
+
+    if (parsed.inputs.isEmpty())
+    {
+        errors.append("The job has no input files");
+        return false;
+    }
+
+    const QString output = object["output"].toString();
+
+    if (output.isEmpty())
+    {
+        errors.append("The job has no output");
+        return false;
+    }
+
+    // Each input is exported to its own file
+    if (parsed.inputs.size() > 1 && !output.contains("{name}"))
+    {
+        errors.append("The output must contain {name} when there is more than one input");
+        return false;
+    }
+
+    parsed.output = QDir::isAbsolutePath(output) ? output : base.absoluteFilePath(output);
+
+    for (const auto &series : object["series"].toArray())
+    {
+        parsed.series.append(series.toString());
+    }
+
+    for (const auto &value : object["math"].toArray())
+    {
+        const QJsonObject trace = value.toObject();
+
+        MathTrace math;
+
+        math.label = trace["label"].toString();
+        math.expression = trace["expression"].toString();
+        math.maxGapSize = trace["maxGap"].toDouble(math.maxGapSize);
+
+        const QJsonObject variables = trace["variables"].toObject();
+
+        for (auto it = variables.begin(); it != variables.end(); ++it)
+        {
+            math.variables[it.key()] = it.value().toString();
+        }
+
+        if (math.label.isEmpty() || math.expression.isEmpty() || math.variables.isEmpty())
+        {
+            errors.append("Each math trace requires a label, an expression and its variables");
+            return false;
+        }
+
+        parsed.math.append(math);
+    }
+
+    const QJsonObject scope = object["scope"].toObject();
+    const QString mode = scope["mode"].toString("all");
+
+    if (mode == "resample")
+    {
+        parsed.scope.mode = ExportScope::SCOPE_RESAMPLE;
+        parsed.scope.rate = scope["rate"].toDouble();
+    }
+    else if (mode == "decimate")
+    {
+        parsed.scope.mode = ExportScope::SCOPE_DECIMATE;
+        parsed.scope.points = (uint64_t) scope["points"].toDouble();
+    }
+    else if (mode != "all")
+    {
+        errors.append(QString("Invalid export scope: %1").arg(mode));
+        return false;
+    }
+
+    if (scope.contains("tMin") || scope.contains("tMax"))
+    {
+        parsed.scope.rangeOnly = true;
+        parsed.scope.tMin = scope["tMin"].toDouble(-std::numeric_limits<double>::infinity());
+        parsed.scope.tMax = scope["tMax"].toDouble(std::numeric_limits<double>::infinity());
+    }
+
+    parsed.parallel = std::max(0, object["parallel"].toInt());
+
+    job = parsed;
+
+    return true;
+}
+
+
+/**
+ * @brief BatchProcessor::getOutputFilename - The output file of an input, where {name} in the pattern
+ * is replaced by the base name of the input (e.g. "flight" for "logs/flight.csv") and {dir} by its directory
+ */
+QString BatchProcessor::getOutputFilename(const QString &pattern, const QString &input)
+{
+    const QFileInfo info(input);
+
+    QString filename = pattern;
+
+    filename.replace("{name}", info.completeBaseName());
+    filename.replace("{dir}", info.absolutePath());
+
+    return filename;
+}
+
+
+QSharedPointer<QMutex> BatchProcessor::getLock(const PluginBase *plugin) const
+{
+    return locks.value(plugin);
+}
+
+
+/*
+ * Select the importer of a file. If the plugin cannot create a separate instance for the file,
+ * the lock is set, and must be held while the importer is used.
+ */
+QSharedPointer<ImportPlugin> BatchProcessor::getImporter(const QString &filename, QSharedPointer<QMutex> &lock) const
+{
+    for (const auto &plugin : importers)
+    {
+        if (plugin.isNull() || !plugin->supportsFile(filename)) continue;
+
+        auto instance = plugin->createInstance();
+
+        if (!instance.isNull()) return instance;
+
+        lock = getLock(plugin.data());
+
+        return plugin;
+    }
+
+    return QSharedPointer<ImportPlugin>();
+}
+
+
+/*
+ * Select the exporter of a file (exporters are always used by one file at a time)
+ */
+QSharedPointer<ExportPlugin> BatchProcessor::getExporter(const QString &filename, QSharedPointer<QMutex> &lock) const
+{
+    const QString suffix = QFileInfo(filename).suffix();
+
+    for (const auto &plugin : exporters)
+    {
+        if (plugin.isNull() || !plugin->supportsFileType(suffix)) continue;
+
+        lock = getLock(plugin.data());
+
+        return plugin;
+    }
+
+    return QSharedPointer<ExportPlugin>();
+}
+
+
+/**
+ * @brief BatchProcessor::processFile - Import a file, compute the math traces of the job, and export the result
+ * @param job describes the processing
+ * @param input is the file to process
+ * @return the result of the file (which is not successful if any step fails)
+ */
+BatchProcessor::Result BatchProcessor::processFile(const Job &job, const QString &input)
+{
+    TRACE_SCOPE("Batch file", "batch");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+
+    result.input = input;
+    result.output = getOutputFilename(job.output, input);
+
+    QSharedPointer<QMutex> importLock;
+
+    auto importer = getImporter(input, importLock);
+
+    if (importer.isNull())
+    {
+        result.errors.append(QString("No importer supports %1").arg(input));
+        return result;
+    }
+
+    // Series by label (imported series, then math traces)
+    QMap<QString, DataSeriesPointer> series;
+    QList<DataSeriesPointer> ordered;
+
+    {
+        if (importLock) importLock->lock();
+
+        bool valid = importer->validateFile(input, result.errors);
+
+        if (valid)
+        {
+            // The options dialog is not shown (see ImportPlugin::beforeImport), so the default options are used
+            importer->setFilename(input);
+
+            valid = importer->importData(result.errors);
+
+            importer->afterImport();
+        }
+
+        if (valid)
+        {
+            for (const auto &s : importer->getDataSeries())
+            {
+                if (s.isNull()) continue;
+
+                series[s->getLabel()] = s;
+                ordered.append(s);
+            }
+        }
+
+        if (importLock) importLock->unlock();
+
+        if (!valid)
+        {
+            result.errors.prepend(QString("Could not import %1").arg(input));
+            return result;
+        }
+    }
+
+    for (const auto &math : job.math)
+    {
+        QMap<QString, DataSeriesPointer> mapping;
+
+        for (auto it = math.variables.begin(); it != math.variables.end(); ++it)
+        {
+            if (!series.contains(it.value()))
+            {
+                result.errors.append(QString("%1: no series '%2' for math trace '%3'").arg(input).arg(it.value()).arg(math.label));
+                return result;
+            }
+
+            mapping[it.key()] = series[it.value()];
+        }
+
+        MathDataSeriesPointer trace(new MathDataSeries(math.label, math.expression, mapping));
+
+        QString error;
+
+        // The trace is computed in this thread (its chunks are evaluated on the global thread pool)
+        MathTraceComputer computer;
+
+        QObject::connect(&computer, &MathTraceComputer::computationFailed, [&error](QString message) { error = message; });
+
+        computer.compute(math.expression, mapping, trace, math.maxGapSize);
+        computer.startComputation();
+
+        if (!error.isEmpty())
+        {
+            result.errors.append(QString("%1: math trace '%2' failed: %3").arg(input).arg(math.label).arg(error));
+            return result;
+        }
+
+        series[math.label] = trace;
+        ordered.append(trace);
+    }
+
+    QList<DataSeriesPointer> exported;
+
+    if (job.series.isEmpty())
+    {
+        exported = ordered;
+    }
+    else
+    {
+        for (const QString &label : job.series)
+        {
+            if (!series.contains(label))
+            {
+                result.errors.append(QString("%1: no series '%2' to export").arg(input).arg(label));
+                return result;
+            }
+
+            exported.append(series[label]);
+        }
+    }
+
+    QSharedPointer<QMutex> exportLock;
+
+    auto exporter = getExporter(result.output, exportLock);
+
+    if (exporter.isNull())
+    {
+        result.errors.append(QString("No exporter supports %1").arg(result.output));
+        return result;
+    }
+
+    QDir().mkpath(QFileInfo(result.output).absolutePath());
+
+    {
+        QMutexLocker lock(exportLock.data());
+
+        exporter->setFilename(result.output);
+        exporter->setScope(job.scope);
+
+        result.success = exporter->beforeExport() && exporter->exportData(exported, result.errors);
+
+        exporter->afterExport();
+    }
+
+    if (!result.success)
+    {
+        result.errors.prepend(QString("Could not export %1").arg(result.output));
+    }
+
+    result.seriesCount = exported.size();
+
+    for (const auto &s : exported)
+    {
+        result.sampleCount += s->size();
+    }
+
+    result.duration = timer.elapsed();
+
+    return result;
+}
+
+
+/**
+ * @brief BatchProcessor::run - Process every input of a job (concurrently)
+ * @return the result of each input (in the order of the inputs)
+ */
+QList<BatchProcessor::Result> BatchProcessor::run(const Job &job)
+{
+    const int parallel = job.parallel > 0 ? job.parallel : QThread::idealThreadCount();
+
+    // The calling thread also processes files (see parallelFor)
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, parallel - 1));
+
+    std::vector<Result> results(job.inputs.size());
+
+    std::atomic<int> complete{0};
+
+    parallelFor(job.inputs.size(), [&](size_t idx) {
+        results[idx] = processFile(job, job.inputs[idx]);
+
+        const Result &result = results[idx];
+
+        qInfo().noquote() << QString("[%1/%2] %3 %4 (%5 series, %6 samples, %7 ms)")
+                             .arg(++complete)
+                             .arg(job.inputs.size())
+                             .arg(result.success ? "OK    " : "FAILED")
+                             .arg(result.input)
+                             .arg(result.seriesCount)
+                             .arg(result.sampleCount)
+                             .arg(result.duration);
+
+        for (const QString &error : result.errors)
+        {
+            qWarning().noquote() << "   " << error;
+        }
+    }, parallel > 1 ? &pool : nullptr);
+
+    return QList<Result>(results.begin(), results.end());
+}
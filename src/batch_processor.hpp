@@ -0,0 +1,113 @@
+#ifndef BATCH_PROCESSOR_HPP
+#define BATCH_PROCESSOR_HPP
+
+#include <stdint.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "plugin_exporter.hpp"
+#include "plugin_importer.hpp"
+
+
+/**
+ * @brief The BatchProcessor class runs a batch job (lumberjack --batch job.json) without the GUI:
+ * each input file is imported, math traces are computed from its series, and the result is exported.
+ *
+ * A job is described by a JSON file (relative paths are relative to the job file):
+ *
+ *   {
+ *     "inputs": ["*.csv", "logs/flight.bin"],       // files (or wildcard patterns) to process
+ *     "output": "out/{name}.csv",                   // {name} is the base name of each input, {dir} its directory
+ *     "series": ["Channel 1", "diff"],              // series to export (optional, default every series)
+ *     "math": [{"label": "diff", "expression": "a - b", "variables": {"a": "Channel 1", "b": "Channel 2"}, "maxGap": 1000}],
+ *     "scope": {"mode": "resample", "rate": 100},   // optional (see ExportScope): all, resample or decimate
+ *     "parallel": 4                                 // files processed concurrently (optional, default one per core)
+ *   }
+ *
+ * Files are processed concurrently. Importers run with their default options (no options dialog is
+ * shown), and plugins which cannot create a separate instance for each file (see ImportPlugin::createInstance)
+ * are used by one file at a time. Math traces are computed in order (so a trace may use an earlier trace)
+ * by MathTraceComputer, which evaluates each trace on the global thread pool.
+ */
+class BatchProcessor
+{
+public:
+    struct MathTrace
+    {
+        QString label;
+        QString expression;
+
+        //! Series label of each variable of the expression
+        QMap<QString, QString> variables;
+
+        //! Maximum gap (ms) which is interpolated across
+        double maxGapSize = 1000;
+    };
+
+    struct Job
+    {
+        //! Files to process (patterns are expanded by parseJob)
+        QStringList inputs;
+
+        //! Output file for each input (see getOutputFilename)
+        QString output;
+
+        //! Series which are exported (empty to export every imported series and math trace)
+        QStringList series;
+
+        QList<MathTrace> math;
+
+        ExportScope scope;
+
+        //! Number of files processed concurrently (zero for one per core)
+        int parallel = 0;
+    };
+
+    struct Result
+    {
+        QString input;
+        QString output;
+
+        bool success = false;
+        QStringList errors;
+
+        //! Number of series and samples exported
+        int seriesCount = 0;
+        uint64_t sampleCount = 0;
+
+        //! Time taken to process the file (ms)
+        qint64 duration = 0;
+    };
+
+    BatchProcessor(const ImportPluginList &importers, const ExportPluginList &exporters);
+
+    static bool loadJob(const QString &filename, Job &job, QStringList &errors);
+    static bool parseJob(const QByteArray &json, const QDir &base, Job &job, QStringList &errors);
+
+    static QString getOutputFilename(const QString &pattern, const QString &input);
+
+    QList<Result> run(const Job &job);
+
+    Result processFile(const Job &job, const QString &input);
+
+protected:
+    QSharedPointer<ImportPlugin> getImporter(const QString &filename, QSharedPointer<QMutex> &lock) const;
+    QSharedPointer<ExportPlugin> getExporter(const QString &filename, QSharedPointer<QMutex> &lock) const;
+
+    QSharedPointer<QMutex> getLock(const PluginBase *plugin) const;
+
+    ImportPluginList importers;
+    ExportPluginList exporters;
+
+    //! Lock of each plugin, which is held while a plugin is used without a separate instance
+    QMap<const PluginBase*, QSharedPointer<QMutex>> locks;
+};
+
+#endif // BATCH_PROCESSOR_HPP
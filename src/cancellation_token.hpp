@@ -0,0 +1,27 @@
+#ifndef CANCELLATION_TOKEN_HPP
+#define CANCELLATION_TOKEN_HPP
+
+#include <atomic>
+#include <memory>
+
+
+/**
+ * @brief The CancellationToken class signals that a background job (e.g. an import) has been cancelled.
+ *
+ * The token is shared between the job and the code which performs it (see PluginBase::isCancelled).
+ * Checking the token is a relaxed atomic load, so it can be polled in any loop.
+ */
+class CancellationToken
+{
+public:
+    void cancel(void) { cancelled.store(true, std::memory_order_relaxed); }
+
+    bool isCancelled(void) const { return cancelled.load(std::memory_order_relaxed); }
+
+protected:
+    std::atomic<bool> cancelled{false};
+};
+
+typedef std::shared_ptr<CancellationToken> CancellationTokenPointer;
+
+#endif // CANCELLATION_TOKEN_HPP
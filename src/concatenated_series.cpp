@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <limits>
+
+#include <QMutexLocker>
+#include <QSet>
+
+#include "concatenated_series.hpp"
+#include "trace_recorder.hpp"
+
+
+ConcatenatedSeries::ConcatenatedSeries(QString label, QList<DataSeriesPointer> series) :
+    DataSeries(label),
+    inputs(series)
+{
+    for (const auto& input : inputs)
+    {
+        if (input.isNull()) continue;
+
+        connect(input.data(), &DataSeries::dataChanged, this, &ConcatenatedSeries::rebuild);
+
+        // The blocks are shared with the inputs, so they must not be moved to another store when the series is added
+        // to a source (see DataSource::addSeries)
+        if (!dataStore) dataStore = input->getDataStore();
+    }
+
+    rebuild();
+}
+
+
+/**
+ * @brief ConcatenatedSeries::rebuild - Assemble the block table from the current samples of the inputs.
+ * Only the block table is rebuilt (the samples are not copied), so this is cheap even for long series.
+ */
+void ConcatenatedSeries::rebuild()
+{
+    TRACE_SCOPE("Concatenate Series", "math");
+
+    struct Input
+    {
+        int index;
+        DataSnapshot snapshot;
+    };
+
+    std::vector<Input> sorted;
+
+    for (int idx = 0; idx < inputs.size(); idx++)
+    {
+        if (inputs[idx].isNull()) continue;
+
+        // The time window of each input applies, but not its filter
+        DataSnapshot snapshot = inputs[idx]->getRawSnapshot();
+
+        if (snapshot.isEmpty()) continue;
+
+        if (!sorted.empty())
+        {
+            const DataSnapshot& reference = sorted.front().snapshot;
+
+            // Only inputs with the same scaling can share a block table
+            if (snapshot.getScaler() != reference.getScaler() || snapshot.getOffset() != reference.getOffset() ||
+                snapshot.getTimeScale() != reference.getTimeScale() || snapshot.getTimeOffset() != reference.getTimeOffset())
+            {
+                qWarning() << "Cannot concatenate" << inputs[idx]->getLabel() << "- the scaling differs from the other inputs";
+                continue;
+            }
+        }
+
+        sorted.push_back({idx, snapshot});
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Input& a, const Input& b) {
+        return a.snapshot.getTimestamp(0) < b.snapshot.getTimestamp(0);
+    });
+
+    auto table = std::make_shared<DataBlockTable>();
+
+    QVector<Segment> updated;
+
+    uint64_t count = 0;
+    double t_end = -std::numeric_limits<double>::infinity();
+
+    for (size_t ii = 0; ii < sorted.size(); ii++)
+    {
+        DataSnapshot snapshot = sorted[ii].snapshot;
+
+        // Samples which overlap the previous segment are omitted
+        if (ii > 0)
+        {
+            snapshot = snapshot.getWindow(snapshot.upperBound(t_end), snapshot.size());
+        }
+
+        if (snapshot.isEmpty()) continue;
+
+        const DataBlockTable& blocks = *snapshot.getTable();
+
+        for (size_t bb = 0; bb < blocks.blocks.size() && blocks.offsets[bb] < snapshot.size(); bb++)
+        {
+            const auto& block = blocks.blocks[bb];
+
+            // The offsets (rather than the block sizes) bound each block, so a block which is cut off by the end of
+            // its segment (e.g. by a time window, or because the input is still growing) can be shared
+            table->offsets.push_back(count + blocks.offsets[bb]);
+            table->blocks.push_back(block);
+        }
+
+        Segment segment;
+
+        segment.input = sorted[ii].index;
+        segment.idx_first = count;
+        segment.idx_last = count + snapshot.size();
+        segment.t_first = snapshot.getTimestamp(0);
+        segment.t_last = snapshot.getTimestamp(snapshot.size() - 1);
+
+        updated.append(segment);
+
+        count = segment.idx_last;
+        t_end = segment.t_last;
+    }
+
+    // Except for the final block, whose size is the size of the series, so it is copied if it is cut off
+    if (!table->blocks.empty())
+    {
+        auto& block = table->blocks.back();
+        const size_t length = count - table->offsets.back();
+
+        if (length < block->size())
+        {
+            // The previous copy is still valid unless the final block (or its length) has changed
+            if (block != tailSource || length != tailLength)
+            {
+                tailSource = block;
+                tailLength = length;
+                tail = std::make_shared<DataBlock>(*block, 0, length, length);
+            }
+
+            block = tail;
+        }
+        else
+        {
+            tail.reset();
+            tailSource.reset();
+            tailLength = 0;
+        }
+    }
+
+    if (!sorted.empty())
+    {
+        // Blocks store raw samples, so the scaling of the inputs is retained
+        const DataSnapshot& reference = sorted.front().snapshot;
+
+        Scaling updated;
+
+        updated.scaler = reference.getScaler();
+        updated.offset = reference.getOffset();
+        updated.timeScale = reference.getTimeScale();
+        updated.timeOffset = reference.getTimeOffset();
+
+        scaling_mutex.lock();
+        setScaling(updated);
+        scaling_mutex.unlock();
+    }
+
+    data_mutex.lock();
+    publishBlockTable(table);
+    data_mutex.unlock();
+
+    {
+        QMutexLocker locker(&segments_mutex);
+        segments = updated;
+    }
+
+    invalidateBounds();
+    markChanged();
+
+    update();
+}
+
+
+QVector<ConcatenatedSeries::Segment> ConcatenatedSeries::getSegments() const
+{
+    QMutexLocker locker(&segments_mutex);
+
+    return segments;
+}
+
+
+/**
+ * @brief ConcatenatedSeries::getSegmentForIndex - Return the index of the segment which contains a sample (or -1)
+ */
+int ConcatenatedSeries::getSegmentForIndex(uint64_t idx) const
+{
+    QMutexLocker locker(&segments_mutex);
+
+    auto it = std::upper_bound(segments.begin(), segments.end(), idx, [](uint64_t index, const Segment& segment) {
+        return index < segment.idx_last;
+    });
+
+    return it == segments.end() ? -1 : (int) (it - segments.begin());
+}
+
+
+/**
+ * @brief ConcatenatedSeries::concatenateSources - Create a source which concatenates the series of several sources
+ * (e.g. the files of a test which was split across several logs), with one ConcatenatedSeries for each series label
+ * @param sources are the sources to concatenate (in any order)
+ * @param errors is appended with the reason if the sources cannot be concatenated
+ * @return the new source (which has not been added to the DataSourceManager), or null
+ */
+DataSourcePointer ConcatenatedSeries::concatenateSources(QList<DataSourcePointer> sources, QStringList &errors)
+{
+    sources.removeAll(DataSourcePointer());
+
+    if (sources.size() < 2)
+    {
+        errors.append("At least two sources are required");
+        return DataSourcePointer();
+    }
+
+    std::stable_sort(sources.begin(), sources.end(), [](const DataSourcePointer& a, const DataSourcePointer& b) {
+        return a->getLabel() < b->getLabel();
+    });
+
+    const auto& first = sources.front();
+
+    for (const auto& source : sources)
+    {
+        if (source->getTimeScale() != first->getTimeScale() || source->getTimeOffset() != first->getTimeOffset())
+        {
+            errors.append(QString("%1 is aligned differently to %2").arg(source->getLabel()).arg(first->getLabel()));
+            return DataSourcePointer();
+        }
+    }
+
+    DataSourcePointer result(new DataSource(
+                                 "Concatenated",
+                                 QString("%1 ... %2").arg(first->getLabel()).arg(sources.back()->getLabel()),
+                                 QString("Concatenation of %1 sources").arg(sources.size())));
+
+    result->setTimeScaling(first->getTimeScale(), first->getTimeOffset(), false);
+
+    // Series are matched by label, in the order they first appear
+    QStringList labels;
+    QSet<QString> found;
+
+    for (const auto& source : sources)
+    {
+        for (const auto& label : source->getSeriesLabels())
+        {
+            if (found.contains(label)) continue;
+
+            found.insert(label);
+            labels.append(label);
+        }
+    }
+
+    for (const auto& label : labels)
+    {
+        QList<DataSeriesPointer> inputs;
+
+        for (const auto& source : sources)
+        {
+            auto series = source->getSeriesByLabel(label);
+
+            if (!series.isNull()) inputs.append(series);
+        }
+
+        ConcatenatedSeriesPointer series(new ConcatenatedSeries(label, inputs));
+
+        const auto& input = inputs.front();
+
+        series->setGroup(input->getGroup());
+        series->setUnits(input->getUnits());
+        series->setColor(input->getColor());
+
+        result->addSeries(series, false);
+    }
+
+    return result;
+}
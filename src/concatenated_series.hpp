@@ -0,0 +1,80 @@
+#ifndef CONCATENATED_SERIES_HPP
+#define CONCATENATED_SERIES_HPP
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "data_series.hpp"
+#include "data_source.hpp"
+
+
+/**
+ * @brief The ConcatenatedSeries class presents several series (e.g. the same channel of each file of a test
+ * which was logged as run_001.csv, run_002.csv, ...) as a single, continuous series, without copying their samples.
+ *
+ * The block table of the series is assembled from the blocks of its inputs, in time order, so every block (and its
+ * summary pyramid) is shared with the input it came from. The sampler, statistics and range queries therefore see
+ * one channel, at the cost of a table entry per block. The table is rebuilt when an input changes (at the capped
+ * rate of DataSeries::dataChanged, so an input which is still being imported does not rebuild it for every sample).
+ *
+ * The series records the segment of each input (see getSegments), so a sample can be traced back to its input.
+ * Samples of an input which overlap the previous segment in time are omitted, so the series remains in time order.
+ *
+ * The series is read-only: samples must be added to the inputs (its blocks are shared with them).
+ */
+class ConcatenatedSeries : public DataSeries
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief The Segment struct describes the samples of one input within the concatenated series
+     */
+    struct Segment
+    {
+        //! Index of the input (see getInputs)
+        int input = 0;
+
+        //! Range of the samples, [idx_first, idx_last)
+        uint64_t idx_first = 0;
+        uint64_t idx_last = 0;
+
+        //! Timestamps of the first and last samples
+        double t_first = 0;
+        double t_last = 0;
+    };
+
+    ConcatenatedSeries(QString label, QList<DataSeriesPointer> inputs);
+
+    const QList<DataSeriesPointer>& getInputs(void) const { return inputs; }
+
+    QVector<Segment> getSegments(void) const;
+
+    int getSegmentForIndex(uint64_t idx) const;
+
+    static DataSourcePointer concatenateSources(QList<DataSourcePointer> sources, QStringList &errors);
+
+public slots:
+    void rebuild(void);
+
+protected:
+    QList<DataSeriesPointer> inputs;
+
+    //! Segment of each input which contributes samples, in time order (segments mutex must be held)
+    QVector<Segment> segments;
+
+    mutable QMutex segments_mutex;
+
+    //! Copy of the final block, if it is cut off, and the block and length it was copied from
+    //! (the copy is re-used until the final block grows, see rebuild)
+    DataBlockPointer tail;
+    DataBlockPointer tailSource;
+    size_t tailLength = 0;
+};
+
+typedef QSharedPointer<ConcatenatedSeries> ConcatenatedSeriesPointer;
+
+
+#endif // CONCATENATED_SERIES_HPP
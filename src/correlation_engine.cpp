@@ -0,0 +1,256 @@
+#include <algorithm>
+
+#include <QMetaObject>
+#include <QRunnable>
+
+#include "trace_recorder.hpp"
+
+#include "correlation_engine.hpp"
+
+
+const size_t CorrelationEngine::MAX_POINTS;
+const size_t CorrelationEngine::COHERENCE_SEGMENTS;
+const size_t CorrelationEngine::MAX_CACHED_SPECTRA;
+
+
+/*
+ * Thread pool task which analyses a single request
+ */
+class CorrelationTask : public QRunnable
+{
+public:
+    CorrelationTask(CorrelationEngine &e, const CorrelationEngine::Request &r) : engine(e), request(r) {}
+
+    virtual void run() override
+    {
+        engine.runRequest(request);
+    }
+
+protected:
+    CorrelationEngine &engine;
+    CorrelationEngine::Request request;
+};
+
+
+CorrelationEngine::CorrelationEngine(QObject *parent) : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+
+CorrelationEngine::~CorrelationEngine()
+{
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_mutex.unlock();
+
+    m_pool.waitForDone();
+}
+
+
+/**
+ * @brief CorrelationEngine::requestCorrelation - Correlate two series in the background.
+ * Any request which is still running is cancelled. resultUpdated is emitted once the result is available.
+ * @param reference - The series which is aligned to (e.g. a command)
+ * @param target - The series which is shifted (e.g. the response)
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range
+ */
+void CorrelationEngine::requestCorrelation(DataSeriesPointer reference, DataSeriesPointer target, double t_min, double t_max)
+{
+    Request request;
+
+    // Snapshots are taken immediately, so the result describes the series at the time of the request
+    request.referenceLabel = reference.isNull() ? QString() : reference->getLabel();
+    request.targetLabel = target.isNull() ? QString() : target->getLabel();
+    request.reference = reference.isNull() ? DataSnapshot() : reference->getSnapshot();
+    request.target = target.isNull() ? DataSnapshot() : target->getSnapshot();
+    request.t_min = std::min(t_min, t_max);
+    request.t_max = std::max(t_min, t_max);
+    request.token = std::make_shared<CancellationToken>();
+
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_token = request.token;
+    request.id = ++m_requestId;
+
+    m_mutex.unlock();
+
+    m_pool.start(new CorrelationTask(*this, request));
+}
+
+
+CorrelationResult CorrelationEngine::getResult() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_result;
+}
+
+
+/**
+ * @brief CorrelationEngine::isBusy - Determine if the most recent request has not completed
+ */
+bool CorrelationEngine::isBusy() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_resultId != m_requestId;
+}
+
+
+size_t CorrelationEngine::getCachedSpectrumCount() const
+{
+    QMutexLocker lock(&m_cacheMutex);
+
+    return m_cache.size();
+}
+
+
+/*
+ * Analyse a request (on the thread pool of the engine)
+ */
+void CorrelationEngine::runRequest(const Request &request)
+{
+    if (request.token->isCancelled()) return;
+
+    CorrelationResult result = computeCorrelation(request.reference, request.target, request.t_min, request.t_max, request.token.get());
+
+    if (request.token->isCancelled()) return;
+
+    result.referenceLabel = request.referenceLabel;
+    result.targetLabel = request.targetLabel;
+
+    m_mutex.lock();
+
+    m_pending = result;
+    m_pendingId = request.id;
+
+    m_mutex.unlock();
+
+    // The result is published on the thread of the engine
+    QMetaObject::invokeMethod(this, "onRequestComplete", Qt::QueuedConnection);
+}
+
+
+void CorrelationEngine::onRequestComplete()
+{
+    m_mutex.lock();
+
+    // The result of a superseded request is discarded
+    const bool current = m_pendingId == m_requestId && m_pendingId != m_resultId;
+
+    if (current)
+    {
+        m_result = m_pending;
+        m_resultId = m_pendingId;
+    }
+
+    m_mutex.unlock();
+
+    if (current)
+    {
+        emit resultUpdated();
+    }
+}
+
+
+/**
+ * @brief CorrelationEngine::computeCorrelation - Calculate the cross-correlation and coherence of two snapshots.
+ * Both snapshots are decimated onto a grid spanning the time range, with (at most) one point per sample.
+ * @param reference - Samples of the reference series
+ * @param target - Samples of the target series
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range
+ * @param token - Optional token which abandons the computation (the result is invalid)
+ */
+CorrelationResult CorrelationEngine::computeCorrelation(const DataSnapshot &reference, const DataSnapshot &target, double t_min, double t_max,
+                                                        const CancellationToken *token)
+{
+    TRACE_SCOPE("Correlation", "math");
+
+    CorrelationResult result;
+
+    if (reference.isEmpty() || target.isEmpty() || !(t_max > t_min)) return result;
+
+    // A grid point per sample (of the denser series), so the grid does not alias either series
+    const uint64_t samples = std::max(reference.upperBound(t_max) - reference.lowerBound(t_min),
+                                      target.upperBound(t_max) - target.lowerBound(t_min));
+
+    const size_t points = (size_t) std::min<uint64_t>(samples, MAX_POINTS);
+
+    if (points < 4) return result;
+
+    const double dt = (t_max - t_min) / points;
+
+    const TimeAlignment::Spectrum spectrum_a = getSpectrum(reference, t_min, dt, points);
+
+    if (token && token->isCancelled()) return result;
+
+    const TimeAlignment::Spectrum spectrum_b = getSpectrum(target, t_min, dt, points);
+
+    if (token && token->isCancelled()) return result;
+
+    result.correlation = TimeAlignment::correlate(spectrum_a, spectrum_b);
+
+    if (token && token->isCancelled()) return result;
+
+    // Largest power of two which fits several segments in the range (shorter segments trade resolution for variance)
+    size_t segment = 16;
+
+    while (segment * 2 * COHERENCE_SEGMENTS <= points && segment < 4 * TimeAlignment::DEFAULT_SEGMENT) segment <<= 1;
+
+    result.coherence = TimeAlignment::computeCoherence(reference, target, t_min, dt, points, segment);
+
+    return result;
+}
+
+
+/*
+ * Find the spectrum of a snapshot on a grid in the cache, or transform (and cache) it
+ */
+TimeAlignment::Spectrum CorrelationEngine::getSpectrum(const DataSnapshot &snapshot, double t0, double dt, size_t points)
+{
+    m_cacheMutex.lock();
+
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+    {
+        const TimeAlignment::Spectrum &spectrum = it->spectrum;
+
+        // The decimated values are scaled, so the scaling must match too
+        const bool same = it->snapshot.isIdentical(snapshot) && it->snapshot.getScaler() == snapshot.getScaler() && it->snapshot.getOffset() == snapshot.getOffset();
+
+        if (same && spectrum.t0 == t0 && spectrum.dt == dt && spectrum.points == points)
+        {
+            // Most recently used first
+            m_cache.splice(m_cache.begin(), m_cache, it);
+
+            TimeAlignment::Spectrum cached = m_cache.front().spectrum;
+
+            m_cacheMutex.unlock();
+
+            return cached;
+        }
+    }
+
+    m_cacheMutex.unlock();
+
+    CachedSpectrum entry;
+
+    entry.snapshot = snapshot;
+    entry.spectrum = TimeAlignment::transform(snapshot, t0, dt, points);
+
+    m_cacheMutex.lock();
+
+    m_cache.push_front(entry);
+
+    while (m_cache.size() > MAX_CACHED_SPECTRA) m_cache.pop_back();
+
+    m_cacheMutex.unlock();
+
+    return entry.spectrum;
+}
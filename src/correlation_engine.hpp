@@ -0,0 +1,129 @@
+#ifndef CORRELATION_ENGINE_HPP
+#define CORRELATION_ENGINE_HPP
+
+#include <list>
+
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+
+#include "cancellation_token.hpp"
+#include "data_series.hpp"
+#include "time_alignment.hpp"
+
+
+/**
+ * @brief The CorrelationResult struct holds the relationship between two series, within the range of a request
+ */
+struct CorrelationResult
+{
+    QString referenceLabel;
+    QString targetLabel;
+
+    //! Correlation at each offset of the target, and the offset at the peak
+    TimeAlignment::Correlation correlation;
+
+    //! Coherence at each frequency
+    TimeAlignment::Coherence coherence;
+
+    bool isValid(void) const { return correlation.peak.valid; }
+};
+
+
+/**
+ * @brief The CorrelationEngine class calculates the cross-correlation and coherence of two series in the background.
+ *
+ * Both series are decimated onto a common grid covering the requested range (see TimeAlignment), and correlated
+ * with an FFT, so the cost depends on the number of grid points rather than the number of samples. FFT plans are
+ * cached by the FFTEngine, and the spectrum of each decimated series is cached by the engine, so a series whose
+ * samples (and grid) have not changed is not transformed again (e.g. when the other series is replaced).
+ *
+ * Each request supersedes (and cancels) any request which is still running, and resultUpdated is
+ * only emitted (on the thread of the engine) for the most recent request.
+ */
+class CorrelationEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    CorrelationEngine(QObject *parent = nullptr);
+    virtual ~CorrelationEngine();
+
+    //! Maximum number of grid points (fewer are used if the range has fewer samples)
+    static const size_t MAX_POINTS = 1 << 14;
+
+    //! Number of coherence segments (of the grid) which fit in the range, without overlap
+    static const size_t COHERENCE_SEGMENTS = 8;
+
+    //! Number of cached spectra
+    static const size_t MAX_CACHED_SPECTRA = 8;
+
+    void requestCorrelation(DataSeriesPointer reference, DataSeriesPointer target, double t_min, double t_max);
+
+    //! Result of the most recent request which has completed
+    CorrelationResult getResult(void) const;
+
+    bool isBusy(void) const;
+
+    CorrelationResult computeCorrelation(const DataSnapshot &reference, const DataSnapshot &target, double t_min, double t_max,
+                                         const CancellationToken *token = nullptr);
+
+    size_t getCachedSpectrumCount(void) const;
+
+signals:
+    void resultUpdated(void);
+
+protected slots:
+    void onRequestComplete(void);
+
+protected:
+    struct Request
+    {
+        uint64_t id = 0;
+
+        QString referenceLabel;
+        QString targetLabel;
+
+        DataSnapshot reference;
+        DataSnapshot target;
+
+        double t_min = 0;
+        double t_max = 0;
+
+        CancellationTokenPointer token;
+    };
+
+    friend class CorrelationTask;
+
+    void runRequest(const Request &request);
+
+    TimeAlignment::Spectrum getSpectrum(const DataSnapshot &snapshot, double t0, double dt, size_t points);
+
+    //! Runs one request at a time (a superseded request is cancelled, and returns promptly)
+    QThreadPool m_pool;
+
+    mutable QMutex m_mutex;
+
+    uint64_t m_requestId = 0;
+    CancellationTokenPointer m_token;
+
+    CorrelationResult m_result;
+    uint64_t m_resultId = 0;
+
+    //! Completed result, which has not been published yet
+    CorrelationResult m_pending;
+    uint64_t m_pendingId = 0;
+
+    //! Spectra of recently correlated series (most recent first)
+    struct CachedSpectrum
+    {
+        DataSnapshot snapshot;
+        TimeAlignment::Spectrum spectrum;
+    };
+
+    mutable QMutex m_cacheMutex;
+    std::list<CachedSpectrum> m_cache;
+};
+
+
+#endif // CORRELATION_ENGINE_HPP
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cmath>
+
+#include <QDebug>
+#include <QMenu>
+#include <QMimeData>
+
+#include <qwt_symbol.h>
+#include <qwt_text.h>
+
+#include "correlation_widget.hpp"
+#include "data_source_manager.hpp"
+#include "lumberjack_settings.hpp"
+#include "plot_scheduler.hpp"
+
+
+CorrelationWidget::CorrelationWidget() : QwtPlot()
+{
+    curve = new QwtPlotCurve();
+    curve->setPen(QPen(Qt::darkBlue));
+    curve->attach(this);
+
+    marker = new QwtPlotMarker();
+    marker->setLineStyle(QwtPlotMarker::VLine);
+    marker->setLinePen(QPen(Qt::red, 1, Qt::DashLine));
+    marker->setSymbol(new QwtSymbol(QwtSymbol::Ellipse, QBrush(Qt::red), QPen(Qt::red), QSize(6, 6)));
+    marker->setVisible(false);
+    marker->attach(this);
+
+    mode = (Mode) LumberjackSettings::getInstance()->loadSetting("correlation", "mode", (int) Mode::Correlation).toInt();
+
+    if (mode != Mode::Coherence) mode = Mode::Correlation;
+
+    setContextMenuPolicy(Qt::CustomContextMenu);
+    setAcceptDrops(true);
+    setMinimumSize(200, 100);
+
+    connect(&engine, &CorrelationEngine::resultUpdated, this, &CorrelationWidget::onResultUpdated);
+    connect(this, &CorrelationWidget::customContextMenuRequested, this, &CorrelationWidget::onContextMenu);
+
+    updatePlot();
+}
+
+
+void CorrelationWidget::setMode(Mode m)
+{
+    if (m == mode) return;
+
+    mode = m;
+
+    LumberjackSettings::getInstance()->saveSetting("correlation", "mode", (int) mode);
+
+    // Both are computed for each request, so the current result is re-drawn
+    updatePlot();
+}
+
+
+/*
+ * Select the series to analyse (either may be null)
+ */
+void CorrelationWidget::setSeries(DataSeriesPointer r, DataSeriesPointer t)
+{
+    reference = r;
+    target = t;
+
+    requestCorrelation();
+}
+
+
+void CorrelationWidget::removeSeries(DataSeriesPointer series)
+{
+    if (series.isNull()) return;
+
+    if (series == reference)
+    {
+        // The target (if any) becomes the reference
+        setSeries(target, DataSeriesPointer());
+    }
+    else if (series == target)
+    {
+        setSeries(reference, DataSeriesPointer());
+    }
+}
+
+
+/*
+ * Update the analysed timespan when the visible interval changes
+ */
+void CorrelationWidget::updateInterval(const QwtInterval &view)
+{
+    interval = view;
+
+    requestCorrelation();
+}
+
+
+void CorrelationWidget::requestCorrelation()
+{
+    if (reference.isNull() || target.isNull())
+    {
+        // Cancels any request which is still running
+        engine.requestCorrelation(DataSeriesPointer(), DataSeriesPointer(), 0, 0);
+        return;
+    }
+
+    engine.requestCorrelation(reference, target, interval.minValue(), interval.maxValue());
+}
+
+
+void CorrelationWidget::onResultUpdated()
+{
+    updatePlot();
+}
+
+
+void CorrelationWidget::updatePlot()
+{
+    const CorrelationResult result = engine.getResult();
+
+    auto label = axisTitle(QwtPlot::xBottom);
+    auto font = label.font();
+
+    font.setPointSize(8);
+    label.setFont(font);
+
+    QVector<double> x;
+    QVector<double> y;
+
+    if (reference.isNull() || target.isNull())
+    {
+        setTitle(reference.isNull() ? tr("Drop a reference series here") : tr("Drop a target series here"));
+    }
+    else if (!result.isValid())
+    {
+        setTitle(tr("%1 / %2: no correlation").arg(result.referenceLabel, result.targetLabel));
+    }
+    else if (mode == Mode::Correlation)
+    {
+        const auto &correlation = result.correlation;
+
+        for (size_t idx = 0; idx < correlation.values.size(); idx++)
+        {
+            x.append(correlation.getOffset(idx));
+            y.append(correlation.values[idx]);
+        }
+
+        setTitle(tr("%1 / %2: offset %3 ms (r = %4)").arg(result.referenceLabel, result.targetLabel)
+                 .arg(correlation.peak.offset, 0, 'g', 4).arg(correlation.peak.correlation, 0, 'f', 3));
+    }
+    else
+    {
+        const auto &coherence = result.coherence;
+
+        for (size_t idx = 0; idx < coherence.coherence.size(); idx++)
+        {
+            x.append(coherence.frequency[idx]);
+            y.append(coherence.coherence[idx]);
+        }
+
+        setTitle(tr("%1 / %2: coherence (%3 segments)").arg(result.referenceLabel, result.targetLabel).arg(coherence.segments));
+    }
+
+    curve->setSamples(x, y);
+
+    // The peak is only marked on the correlation
+    const bool peak = mode == Mode::Correlation && !x.isEmpty();
+
+    marker->setVisible(peak);
+
+    if (peak)
+    {
+        marker->setValue(result.correlation.peak.offset, result.correlation.peak.correlation);
+    }
+
+    if (mode == Mode::Correlation)
+    {
+        label.setText("Offset [ms]");
+        setAxisScale(QwtPlot::yLeft, -1, 1);
+    }
+    else
+    {
+        label.setText("Frequency [Hz]");
+        setAxisScale(QwtPlot::yLeft, 0, 1);
+    }
+
+    setAxisTitle(QwtPlot::xBottom, label);
+    setAxisAutoScale(QwtPlot::xBottom);
+
+    PlotReplotScheduler::getInstance()->requestReplot(this);
+}
+
+
+void CorrelationWidget::onContextMenu(const QPoint &pos)
+{
+    QMenu menu(this);
+
+    QAction *correlation = menu.addAction(tr("Show Correlation"));
+    QAction *coherence = menu.addAction(tr("Show Coherence"));
+
+    correlation->setCheckable(true);
+    correlation->setChecked(mode == Mode::Correlation);
+    coherence->setCheckable(true);
+    coherence->setChecked(mode == Mode::Coherence);
+
+    menu.addSeparator();
+
+    QAction *swap = menu.addAction(tr("Swap Reference and Target"));
+    QAction *clear = menu.addAction(tr("Clear"));
+
+    swap->setEnabled(!reference.isNull() && !target.isNull());
+    clear->setEnabled(!reference.isNull());
+
+    QAction *action = menu.exec(mapToGlobal(pos));
+
+    if (action == correlation)
+    {
+        setMode(Mode::Correlation);
+    }
+    else if (action == coherence)
+    {
+        setMode(Mode::Coherence);
+    }
+    else if (action == swap)
+    {
+        setSeries(target, reference);
+    }
+    else if (action == clear)
+    {
+        setSeries(DataSeriesPointer(), DataSeriesPointer());
+    }
+}
+
+
+void CorrelationWidget::dragEnterEvent(QDragEnterEvent *event)
+{
+    auto *mime = event->mimeData();
+
+    // DataSeries is being dragged onto this widget
+    if (mime->hasFormat("source") && mime->hasFormat("series"))
+    {
+        event->acceptProposedAction();
+    }
+}
+
+
+void CorrelationWidget::dropEvent(QDropEvent *event)
+{
+    auto *mime = event->mimeData();
+    auto *manager = DataSourceManager::getInstance();
+
+    if (!mime || !manager) return;
+
+    if (mime->hasFormat("source") && mime->hasFormat("series"))
+    {
+        QString source_lbl = mime->data("source");
+        QString series_lbl = mime->data("series");
+
+        auto s = manager->findSeries(source_lbl, series_lbl);
+
+        if (s.isNull())
+        {
+            qCritical() << "Could not find graph matching" << source_lbl << ":" << series_lbl;
+            return;
+        }
+
+        // The first series is the reference, and later series replace the target
+        if (reference.isNull())
+        {
+            setSeries(s, DataSeriesPointer());
+        }
+        else if (s != reference)
+        {
+            setSeries(reference, s);
+        }
+
+        event->accept();
+    }
+}
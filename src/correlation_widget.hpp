@@ -0,0 +1,70 @@
+#ifndef CORRELATION_WIDGET_HPP
+#define CORRELATION_WIDGET_HPP
+
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QPoint>
+
+#include <qwt_interval.h>
+#include <qwt_plot.h>
+#include <qwt_plot_curve.h>
+#include <qwt_plot_marker.h>
+
+#include "correlation_engine.hpp"
+#include "data_series.hpp"
+
+
+/*
+ * Displays the cross-correlation (against the offset of the target) or the coherence (against frequency)
+ * of two series, over the visible timespan. The first series dropped onto the widget is the reference,
+ * and each subsequent series replaces the target.
+ */
+class CorrelationWidget : public QwtPlot
+{
+    Q_OBJECT
+
+public:
+    CorrelationWidget();
+
+    enum class Mode
+    {
+        Correlation,
+        Coherence,
+    };
+
+    void setMode(Mode mode);
+    Mode getMode(void) const { return mode; }
+
+    void updateInterval(const QwtInterval &interval);
+
+public slots:
+    void setSeries(DataSeriesPointer reference, DataSeriesPointer target);
+    void removeSeries(DataSeriesPointer series);
+
+protected slots:
+    void onResultUpdated(void);
+    void onContextMenu(const QPoint &pos);
+
+protected:
+    virtual void dragEnterEvent(QDragEnterEvent *event) override;
+    virtual void dropEvent(QDropEvent *event) override;
+
+    void requestCorrelation(void);
+    void updatePlot(void);
+
+    //! Analyses the series in the background (a new request cancels the previous one)
+    CorrelationEngine engine;
+
+    DataSeriesPointer reference;
+    DataSeriesPointer target;
+
+    QwtInterval interval;
+
+    Mode mode = Mode::Correlation;
+
+    //! Curve and peak marker (which are owned by the plot)
+    QwtPlotCurve *curve = nullptr;
+    QwtPlotMarker *marker = nullptr;
+};
+
+#endif // CORRELATION_WIDGET_HPP
@@ -0,0 +1,951 @@
+#include <math.h>
+#include <string.h>
+
+#include "data_block.hpp"
+#include "data_codec.hpp"
+#include "data_kernels.hpp"
+#include "data_store.hpp"
+
+const size_t DataBlock::CAPACITY;
+const size_t DataBlock::INITIAL_CAPACITY;
+const size_t DataBlock::SUMMARY_BASE;
+const size_t DataBlock::SUMMARY_FACTOR;
+const unsigned int DataBlock::SUMMARY_LEVELS;
+const size_t DataBlock::DECODE_CACHE_SIZE;
+
+
+/**
+ * @brief The DecodedColumns struct holds the decoded columns of a compressed block
+ */
+struct DecodedColumns
+{
+    std::unique_ptr<double[]> timestamps;
+    std::unique_ptr<double[]> values;
+    std::unique_ptr<float[]> valuesSingle;
+};
+
+
+/*
+ * Recently decoded blocks are kept alive, so that repeated access to the same region
+ * of a series (e.g. redrawing a plot) does not require the blocks to be decoded again
+ */
+static std::mutex decodeCacheMutex;
+static std::vector<std::shared_ptr<const void>> decodeCache(DataBlock::DECODE_CACHE_SIZE);
+static size_t decodeCacheIndex = 0;
+
+static void retainDecodedColumns(std::shared_ptr<const void> decoded)
+{
+    std::lock_guard<std::mutex> lock(decodeCacheMutex);
+
+    decodeCache[decodeCacheIndex] = decoded;
+    decodeCacheIndex = (decodeCacheIndex + 1) % decodeCache.size();
+}
+
+static void discardDecodedColumns(const std::shared_ptr<const void>& decoded)
+{
+    std::lock_guard<std::mutex> lock(decodeCacheMutex);
+
+    for (auto& entry : decodeCache)
+    {
+        if (entry == decoded) entry.reset();
+    }
+}
+
+
+//! Maximum deviation from a uniform sample interval (as a fraction of the interval)
+static const double UNIFORM_TOLERANCE = 1e-6;
+
+
+/*
+ * Determine whether the provided timestamps are evenly spaced (within UNIFORM_TOLERANCE).
+ * Small deviations (e.g. due to rounding when the timestamps were parsed) are tolerated,
+ * so timestamps calculated from (t0, dt) may differ from the originals by this amount.
+ */
+static bool detectUniformTimestamps(const double* timestamps, size_t n, double& t0, double& dt)
+{
+    if (n < 2) return false;
+
+    t0 = timestamps[0];
+    dt = (timestamps[n - 1] - t0) / (n - 1);
+
+    if (!(dt > 0) || !std::isfinite(dt)) return false;
+
+    const double tolerance = dt * UNIFORM_TOLERANCE;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        if (fabs(t0 + idx * dt - timestamps[idx]) > tolerance) return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Construct a new (empty) block, with storage for the specified number of samples
+ */
+DataBlock::DataBlock(size_t cap, bool single, DataStorePointer s) :
+    capacity(std::min(std::max<size_t>(cap, 1), CAPACITY)),
+    singlePrecision(single),
+    count(0),
+    store(s)
+{
+    allocate();
+}
+
+
+/*
+ * Construct a copy of another block, with the specified capacity, value precision and storage.
+ * The capacity is increased if required to hold all samples from the other block.
+ */
+DataBlock::DataBlock(const DataBlock &other, size_t cap, bool single, DataStorePointer s) :
+    capacity(std::min(std::max(cap, other.size()), CAPACITY)),
+    singlePrecision(single),
+    count(0),
+    store(s)
+{
+    allocate();
+
+    size_t n = other.size();
+
+    const Columns source = other.getColumns();
+
+    memcpy(timestamps.get(), source.timestamps, n * sizeof(double));
+
+    if (singlePrecision == other.singlePrecision)
+    {
+        if (singlePrecision)
+        {
+            memcpy(valuesSingle.get(), source.valuesSingle, n * sizeof(float));
+        }
+        else
+        {
+            memcpy(values.get(), source.values, n * sizeof(double));
+        }
+
+        for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+        {
+            size_t bucket_size = getSummaryBucketSize(lvl);
+
+            memcpy(summary[lvl].get(), other.summary[lvl].get(), ((n + bucket_size - 1) / bucket_size) * sizeof(Summary));
+        }
+
+        count.store(n, std::memory_order_release);
+    }
+    else
+    {
+        // Precision conversion requires the summary to be recalculated
+        for (size_t idx = 0; idx < n; idx++)
+        {
+            if (singlePrecision)
+            {
+                valuesSingle[idx] = (float) source.values[idx];
+            }
+            else
+            {
+                values[idx] = source.valuesSingle[idx];
+            }
+        }
+
+        count.store(n, std::memory_order_release);
+
+        rebuildSummary();
+    }
+
+    seal();
+}
+
+
+/*
+ * Construct a new block containing the samples [first, last) from another block,
+ * with the specified capacity (increased if required to hold the samples).
+ */
+DataBlock::DataBlock(const DataBlock &other, size_t first, size_t last, size_t cap) :
+    capacity(std::min(std::max(cap, last - first), CAPACITY)),
+    singlePrecision(other.singlePrecision),
+    count(0),
+    store(other.store)
+{
+    allocate();
+
+    size_t n = last - first;
+
+    const Columns source = other.getColumns();
+
+    memcpy(timestamps.get(), source.timestamps + first, n * sizeof(double));
+
+    if (singlePrecision)
+    {
+        memcpy(valuesSingle.get(), source.valuesSingle + first, n * sizeof(float));
+    }
+    else
+    {
+        memcpy(values.get(), source.values + first, n * sizeof(double));
+    }
+
+    count.store(n, std::memory_order_release);
+
+    rebuildSummary();
+
+    seal();
+}
+
+
+/*
+ * Construct a copy of another block, with the specified encoding.
+ * An encoded block cannot be appended to, so its capacity is reduced to the number of samples.
+ */
+DataBlock::DataBlock(const DataBlock &other, Encoding encoding) :
+    capacity(encoding == ENCODING_RAW ? other.getCapacity() : std::max<size_t>(other.size(), 1)),
+    singlePrecision(other.singlePrecision),
+    count(0),
+    store(other.store)
+{
+    size_t n = other.size();
+
+    const Columns source = other.getColumns();
+
+    if (encoding != ENCODING_RAW)
+    {
+        uniform = detectUniformTimestamps(source.timestamps, n, uniformStart, uniformInterval);
+    }
+
+    const bool compress = encoding == ENCODING_COMPRESSED && n > 0;
+
+    if (!uniform && !compress)
+    {
+        allocate();
+
+        memcpy(timestamps.get(), source.timestamps, n * sizeof(double));
+
+        if (singlePrecision)
+        {
+            memcpy(valuesSingle.get(), source.valuesSingle, n * sizeof(float));
+        }
+        else
+        {
+            memcpy(values.get(), source.values, n * sizeof(double));
+        }
+    }
+    else
+    {
+        allocateSummary();
+
+        encoded.reset(new Encoded);
+
+        if (uniform)
+        {
+            firstTimestamp = getUniformTimestamp(0);
+            lastTimestamp = getUniformTimestamp(n - 1);
+        }
+        else
+        {
+            DataCodec::encodeTimestamps(source.timestamps, n, encoded->timestamps);
+            encoded->timestamps.shrink_to_fit();
+
+            firstTimestamp = source.timestamps[0];
+            lastTimestamp = source.timestamps[n - 1];
+        }
+
+        if (compress && singlePrecision)
+        {
+            DataCodec::encodeValues(source.valuesSingle, n, encoded->values);
+            encoded->values.shrink_to_fit();
+        }
+        else if (compress)
+        {
+            DataCodec::encodeValues(source.values, n, encoded->values);
+            encoded->values.shrink_to_fit();
+        }
+        else if (singlePrecision)
+        {
+            valuesSingle = allocateColumn<float>();
+            memcpy(valuesSingle.get(), source.valuesSingle, n * sizeof(float));
+        }
+        else
+        {
+            values = allocateColumn<double>();
+            memcpy(values.get(), source.values, n * sizeof(double));
+        }
+    }
+
+    // The summary pyramid is retained as-is
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        size_t bucket_size = getSummaryBucketSize(lvl);
+
+        memcpy(summary[lvl].get(), other.summary[lvl].get(), ((n + bucket_size - 1) / bucket_size) * sizeof(Summary));
+    }
+
+    count.store(n, std::memory_order_release);
+
+    seal();
+}
+
+
+/*
+ * Construct a copy of a full block, which shares the (identical) timestamp column of another
+ * block (see canShareTimestamps), rather than storing its own copy of the timestamps.
+ */
+DataBlock::DataBlock(const DataBlock &other, std::shared_ptr<const DataBlock> owner) :
+    capacity(std::max<size_t>(other.size(), 1)),
+    singlePrecision(other.singlePrecision),
+    count(0),
+    store(other.store)
+{
+    size_t n = other.size();
+
+    const Columns source = other.getColumns(false);
+
+    // The column is retained by the block which allocated it (rather than by a chain of blocks)
+    timestampOwner = owner->timestampOwner ? owner->timestampOwner : owner;
+    timestampColumn = owner->timestampColumn;
+
+    firstTimestamp = timestampColumn[0];
+    lastTimestamp = timestampColumn[n - 1];
+
+    allocateSummary();
+
+    if (singlePrecision)
+    {
+        valuesSingle = allocateColumn<float>();
+        memcpy(valuesSingle.get(), source.valuesSingle, n * sizeof(float));
+    }
+    else
+    {
+        values = allocateColumn<double>();
+        memcpy(values.get(), source.values, n * sizeof(double));
+    }
+
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        size_t bucket_size = getSummaryBucketSize(lvl);
+
+        memcpy(summary[lvl].get(), other.summary[lvl].get(), ((n + bucket_size - 1) / bucket_size) * sizeof(Summary));
+    }
+
+    count.store(n, std::memory_order_release);
+
+    seal();
+}
+
+
+/*
+ * Determine whether this block can share the timestamp column of another block: both blocks must be
+ * full (so neither is appended to again), this block must store its own timestamps explicitly (rather
+ * than uniform or compressed timestamps), and the timestamps must be identical.
+ */
+bool DataBlock::canShareTimestamps(const DataBlock &other) const
+{
+    const size_t n = size();
+
+    if (this == &other || !isFull() || !other.isFull() || other.size() != n) return false;
+
+    if (!timestamps || !other.timestampColumn || timestampColumn == other.timestampColumn) return false;
+
+    return memcmp(timestampColumn, other.timestampColumn, n * sizeof(double)) == 0;
+}
+
+
+/*
+ * Return the decoded columns of a compressed block.
+ * The columns are decoded only if they are not already in use elsewhere (or held in the cache).
+ */
+DataBlock::Columns DataBlock::decodeColumns(bool needTimestamps) const
+{
+    Columns columns;
+
+    if (!encoded) return columns;
+
+    std::lock_guard<std::mutex> lock(encoded->mutex);
+
+    auto decoded = std::static_pointer_cast<const DecodedColumns>(encoded->decoded.lock());
+
+    // Uniform timestamps are only generated when the column is required
+    const bool generate = needTimestamps || !uniform;
+
+    if (!decoded || (generate && !decoded->timestamps))
+    {
+        size_t n = size();
+
+        auto result = std::make_shared<DecodedColumns>();
+
+        if (!timestampColumn && generate)
+        {
+            result->timestamps.reset(new double[n]);
+
+            if (uniform)
+            {
+                for (size_t idx = 0; idx < n; idx++)
+                {
+                    result->timestamps[idx] = getUniformTimestamp(idx);
+                }
+            }
+            else
+            {
+                DataCodec::decodeTimestamps(encoded->timestamps, n, result->timestamps.get());
+            }
+        }
+
+        if (!encoded->values.empty() && singlePrecision)
+        {
+            result->valuesSingle.reset(new float[n]);
+            DataCodec::decodeValues(encoded->values, n, result->valuesSingle.get());
+        }
+        else if (!encoded->values.empty())
+        {
+            result->values.reset(new double[n]);
+            DataCodec::decodeValues(encoded->values, n, result->values.get());
+        }
+
+        decoded = result;
+        encoded->decoded = decoded;
+
+        retainDecodedColumns(decoded);
+    }
+
+    // Columns which are stored explicitly are not copied
+    columns.timestamps = timestampColumn ? timestampColumn : decoded->timestamps.get();
+    columns.values = values ? values.get() : decoded->values.get();
+    columns.valuesSingle = valuesSingle ? valuesSingle.get() : decoded->valuesSingle.get();
+    columns.owner = decoded;
+    columns.uniformStart = uniformStart;
+    columns.uniformInterval = uniformInterval;
+
+    return columns;
+}
+
+
+size_t DataBlock::getEncodedSize() const
+{
+    if (!encoded) return 0;
+
+    return (encoded->timestamps.size() + encoded->values.size()) * sizeof(uint64_t);
+}
+
+
+/**
+ * @brief DataBlock::addMemoryUsage - Add the memory used by this block to the usage (see DataMemoryUsage).
+ * A block which is shared by several tables (or series) is counted by each of them,
+ * and a shared timestamp column is only counted by the block which owns it.
+ */
+void DataBlock::addMemoryUsage(DataMemoryUsage& usage) const
+{
+    const Column<double>* doubles[] = {&timestamps, &values};
+
+    for (const auto* column : doubles)
+    {
+        if (!*column) continue;
+
+        (column->get_deleter().store ? usage.mapped : usage.columns) += capacity * sizeof(double);
+    }
+
+    if (valuesSingle)
+    {
+        (valuesSingle.get_deleter().store ? usage.mapped : usage.columns) += capacity * sizeof(float);
+    }
+
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        if (!summary[lvl]) continue;
+
+        const size_t bucket_size = getSummaryBucketSize(lvl);
+
+        usage.summary += ((capacity + bucket_size - 1) / bucket_size) * sizeof(Summary);
+    }
+
+    if (!encoded) return;
+
+    usage.compressed += getEncodedSize();
+
+    std::lock_guard<std::mutex> lock(encoded->mutex);
+
+    auto decoded = std::static_pointer_cast<const DecodedColumns>(encoded->decoded.lock());
+
+    if (decoded)
+    {
+        const size_t n = size();
+
+        if (decoded->timestamps) usage.cache += n * sizeof(double);
+        if (decoded->values) usage.cache += n * sizeof(double);
+        if (decoded->valuesSingle) usage.cache += n * sizeof(float);
+    }
+}
+
+
+void DataBlock::releaseDecodedColumns() const
+{
+    if (!encoded) return;
+
+    std::shared_ptr<const void> decoded;
+
+    {
+        std::lock_guard<std::mutex> lock(encoded->mutex);
+
+        decoded = encoded->decoded.lock();
+    }
+
+    // Columns which are still in use (e.g. by a reader) are released when the reader is finished
+    if (decoded) discardDecodedColumns(decoded);
+}
+
+
+/*
+ * Return the number of samples summarised by each bucket at the specified summary level
+ */
+size_t DataBlock::getSummaryBucketSize(unsigned int level)
+{
+    size_t bucket_size = SUMMARY_BASE;
+
+    while (level-- > 0)
+    {
+        bucket_size *= SUMMARY_FACTOR;
+    }
+
+    return bucket_size;
+}
+
+
+void DataBlock::ColumnDeleter::operator()(double* ptr) const
+{
+    if (store)
+    {
+        store->release(ptr, bytes);
+    }
+    else
+    {
+        delete[] ptr;
+    }
+}
+
+
+void DataBlock::ColumnDeleter::operator()(float* ptr) const
+{
+    if (store)
+    {
+        store->release(ptr, bytes);
+    }
+    else
+    {
+        delete[] ptr;
+    }
+}
+
+
+/*
+ * Allocate a column with space for "capacity" elements.
+ * If the block has a store, the column is allocated from the store where possible.
+ */
+template<typename T>
+DataBlock::Column<T> DataBlock::allocateColumn() const
+{
+    ColumnDeleter deleter;
+
+    if (store)
+    {
+        size_t bytes = capacity * sizeof(T);
+        T* ptr = static_cast<T*>(store->allocate(bytes));
+
+        if (ptr)
+        {
+            deleter.store = store;
+            deleter.bytes = bytes;
+
+            return Column<T>(ptr, deleter);
+        }
+    }
+
+    return Column<T>(new T[capacity], deleter);
+}
+
+
+/*
+ * Allocate storage for the sample columns and summary pyramid
+ */
+void DataBlock::allocate()
+{
+    timestamps = allocateColumn<double>();
+    timestampColumn = timestamps.get();
+
+    if (singlePrecision)
+    {
+        valuesSingle = allocateColumn<float>();
+    }
+    else
+    {
+        values = allocateColumn<double>();
+    }
+
+    allocateSummary();
+}
+
+
+void DataBlock::allocateSummary()
+{
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        size_t bucket_size = getSummaryBucketSize(lvl);
+
+        summary[lvl].reset(new Summary[(capacity + bucket_size - 1) / bucket_size]);
+    }
+}
+
+
+/*
+ * Append a sample to the end of this block.
+ * It is the responsibility of the caller to ensure that:
+ * - The timestamp is in order
+ * - The block has space for the new sample
+ */
+void DataBlock::append(double t, double v)
+{
+    size_t idx = count.load(std::memory_order_relaxed);
+
+    if (idx >= capacity) return;
+
+    timestamps[idx] = t;
+
+    if (singlePrecision)
+    {
+        valuesSingle[idx] = (float) v;
+    }
+    else
+    {
+        values[idx] = v;
+    }
+
+    summariseSample(idx);
+
+    // Publish the new sample
+    count.store(idx + 1, std::memory_order_release);
+
+    seal();
+}
+
+
+/*
+ * Append multiple samples to the end of this block, up to the capacity of the block.
+ * It is the responsibility of the caller to ensure that the timestamps are in order.
+ * Returns the number of samples which were appended
+ */
+size_t DataBlock::append(const double* t, const double* v, size_t n)
+{
+    size_t start = count.load(std::memory_order_relaxed);
+
+    n = std::min(n, capacity - start);
+
+    if (n == 0) return 0;
+
+    memcpy(timestamps.get() + start, t, n * sizeof(double));
+
+    if (singlePrecision)
+    {
+        for (size_t idx = 0; idx < n; idx++)
+        {
+            valuesSingle[start + idx] = (float) v[idx];
+        }
+    }
+    else
+    {
+        memcpy(values.get() + start, v, n * sizeof(double));
+    }
+
+    // Only the buckets containing the new samples are recalculated
+    rebuildSummary(start, start + n);
+
+    // Publish the new samples
+    count.store(start + n, std::memory_order_release);
+
+    seal();
+
+    return n;
+}
+
+
+/*
+ * Insert a sample at the specified index within this block
+ */
+void DataBlock::insert(size_t idx, double t, double v)
+{
+    size_t n = size();
+
+    if (n >= capacity) return;
+
+    if (idx >= n)
+    {
+        append(t, v);
+        return;
+    }
+
+    memmove(timestamps.get() + idx + 1, timestamps.get() + idx, (n - idx) * sizeof(double));
+    timestamps[idx] = t;
+
+    if (singlePrecision)
+    {
+        memmove(valuesSingle.get() + idx + 1, valuesSingle.get() + idx, (n - idx) * sizeof(float));
+        valuesSingle[idx] = (float) v;
+    }
+    else
+    {
+        memmove(values.get() + idx + 1, values.get() + idx, (n - idx) * sizeof(double));
+        values[idx] = v;
+    }
+
+    count.store(n + 1, std::memory_order_release);
+
+    rebuildSummary(idx);
+}
+
+
+/*
+ * Once a block stored in a DataStore is full, its columns will not be modified again,
+ * and can be released from the working set (they are paged back in when next read)
+ */
+void DataBlock::seal()
+{
+    if (!store || !isFull()) return;
+
+    if (timestamps)
+    {
+        store->evict(timestamps.get(), timestamps.get_deleter().bytes);
+    }
+
+    if (values)
+    {
+        store->evict(values.get(), values.get_deleter().bytes);
+    }
+
+    if (valuesSingle)
+    {
+        store->evict(valuesSingle.get(), valuesSingle.get_deleter().bytes);
+    }
+}
+
+
+/*
+ * Return true if the samples in this block are evenly spaced in time (see ENCODING_UNIFORM)
+ */
+bool DataBlock::isEvenlySpaced() const
+{
+    if (uniform) return true;
+
+    double t0 = 0;
+    double dt = 0;
+
+    return detectUniformTimestamps(getColumns().timestamps, size(), t0, dt);
+}
+
+
+/*
+ * Estimate the index of the sample at (or just after) the specified time, for a block with uniform timestamps
+ */
+size_t DataBlock::getUniformIndex(double t, size_t length) const
+{
+    double idx = ceil((t - uniformStart) / uniformInterval);
+
+    if (!(idx > 0)) return 0;
+    if (idx >= length) return length;
+
+    return (size_t) idx;
+}
+
+
+/*
+ * Return the index of the first sample with timestamp >= t,
+ * considering only the first "length" samples
+ */
+size_t DataBlock::lowerBound(double t, size_t length) const
+{
+    if (uniform)
+    {
+        size_t idx = getUniformIndex(t, length);
+
+        // Correct for rounding, so the result is consistent with getTimestamp()
+        while (idx > 0 && getUniformTimestamp(idx - 1) >= t) idx--;
+        while (idx < length && getUniformTimestamp(idx) < t) idx++;
+
+        return idx;
+    }
+
+    const Columns columns = getColumns();
+
+    return DataKernels::lowerBound(columns.timestamps, length, t);
+}
+
+
+/*
+ * Return the index of the first sample with timestamp > t,
+ * considering only the first "length" samples
+ */
+size_t DataBlock::upperBound(double t, size_t length) const
+{
+    if (uniform)
+    {
+        size_t idx = getUniformIndex(t, length);
+
+        while (idx > 0 && getUniformTimestamp(idx - 1) > t) idx--;
+        while (idx < length && getUniformTimestamp(idx) <= t) idx++;
+
+        return idx;
+    }
+
+    const Columns columns = getColumns();
+
+    return DataKernels::upperBound(columns.timestamps, length, t);
+}
+
+
+/*
+ * Update the summary pyramid with a newly appended sample
+ */
+void DataBlock::summariseSample(size_t idx)
+{
+    double v = getValue(idx);
+
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        size_t bucket_size = getSummaryBucketSize(lvl);
+        size_t bucket = idx / bucket_size;
+
+        if (idx % bucket_size == 0)
+        {
+            summary[lvl][bucket] = Summary(v, idx);
+        }
+        else
+        {
+            summary[lvl][bucket].include(v, idx);
+        }
+    }
+}
+
+
+/*
+ * Sum of the squared deviations of n values from their mean
+ */
+template<typename T>
+static double squaredDeviations(const T* values, size_t n, double mean)
+{
+    double m2 = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        const double d = values[idx] - mean;
+        m2 += d * d;
+    }
+
+    return m2;
+}
+
+
+/*
+ * Summarise the n samples starting at the specified index, using the vectorised reduction kernels
+ */
+DataBlock::Summary DataBlock::summariseRange(size_t first, size_t n) const
+{
+    DataReduction reduction;
+    Summary s;
+
+    if (singlePrecision)
+    {
+        const float* v = valuesSingle.get() + first;
+
+        DataKernels::reduce(v, n, reduction);
+
+        s.idxMin = first + DataKernels::indexOf(v, n, reduction.min);
+        s.idxMax = first + DataKernels::indexOf(v, n, reduction.max);
+    }
+    else
+    {
+        const double* v = values.get() + first;
+
+        DataKernels::reduce(v, n, reduction);
+
+        s.idxMin = first + DataKernels::indexOf(v, n, reduction.min);
+        s.idxMax = first + DataKernels::indexOf(v, n, reduction.max);
+    }
+
+    s.min = reduction.min;
+    s.max = reduction.max;
+    s.sum = reduction.sum;
+    s.count = n;
+
+    // Squared deviations are summed about the mean (rather than derived from the sum of squares),
+    // so the variance of values with a large offset does not suffer from cancellation
+    const double mean = n > 0 ? reduction.sum / n : 0;
+
+    s.m2 = singlePrecision ? squaredDeviations(valuesSingle.get() + first, n, mean) : squaredDeviations(values.get() + first, n, mean);
+
+    return s;
+}
+
+
+/*
+ * Recalculate the summary pyramid, for all buckets which contain samples at or beyond the specified index.
+ * Buckets which cover only samples before this index are unaffected.
+ * The length specifies the number of valid samples (which may not yet have been published).
+ */
+void DataBlock::rebuildSummary(size_t from, size_t length)
+{
+    for (unsigned int lvl = 0; lvl < SUMMARY_LEVELS; lvl++)
+    {
+        auto& level = summary[lvl];
+
+        size_t bucket_size = getSummaryBucketSize(lvl);
+        size_t n_buckets = (length + bucket_size - 1) / bucket_size;
+
+        for (size_t bucket = from / bucket_size; bucket < n_buckets; bucket++)
+        {
+            if (lvl == 0)
+            {
+                // Lowest level is calculated from the raw samples
+                size_t idx = bucket * bucket_size;
+                size_t end = std::min(idx + bucket_size, length);
+
+                level[bucket] = summariseRange(idx, end - idx);
+            }
+            else
+            {
+                // Higher levels are combined from the level below
+                const auto& below = summary[lvl - 1];
+
+                size_t below_size = getSummaryBucketSize(lvl - 1);
+                size_t below_count = (length + below_size - 1) / below_size;
+
+                size_t child = bucket * SUMMARY_FACTOR;
+                size_t end = std::min(child + SUMMARY_FACTOR, below_count);
+
+                Summary s = below[child];
+
+                for (child++; child < end; child++)
+                {
+                    s.include(below[child]);
+                }
+
+                level[bucket] = s;
+            }
+        }
+    }
+}
+
+
+/*
+ * Recalculate the starting index of each block, from the specified block onwards
+ */
+void DataBlockTable::updateOffsets(size_t first)
+{
+    offsets.resize(blocks.size());
+
+    for (size_t ii = first; ii < blocks.size(); ii++)
+    {
+        offsets[ii] = (ii == 0) ? 0 : offsets[ii - 1] + blocks[ii - 1]->size();
+    }
+}
+
+
+/*
+ * Return the index of the block which contains the sample at the provided index
+ */
+size_t DataBlockTable::getBlockForIndex(uint64_t idx) const
+{
+    return DataKernels::upperBound(offsets.data(), offsets.size(), idx) - 1;
+}
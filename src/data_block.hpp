@@ -0,0 +1,550 @@
+#ifndef DATA_BLOCK_H
+#define DATA_BLOCK_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class DataStore;
+
+
+/**
+ * @brief The DataMemoryUsage struct describes the memory used to store samples (bytes), by category
+ */
+struct DataMemoryUsage
+{
+    //! Sample columns allocated on the heap
+    uint64_t columns = 0;
+
+    //! Sample columns allocated from a memory-mapped store (which need not be resident)
+    uint64_t mapped = 0;
+
+    //! Compressed columns (see DataCodec)
+    uint64_t compressed = 0;
+
+    //! Summary pyramids (used for down-sampling and statistics)
+    uint64_t summary = 0;
+
+    //! Block tables, and staged (out-of-order) samples
+    uint64_t index = 0;
+
+    //! Decoded columns of compressed blocks, which are cached while they are in use
+    uint64_t cache = 0;
+
+    //! Memory allocated on the heap (excluding mapped columns)
+    uint64_t getHeapBytes(void) const { return columns + compressed + summary + index + cache; }
+
+    uint64_t getTotalBytes(void) const { return getHeapBytes() + mapped; }
+
+    DataMemoryUsage& operator+=(const DataMemoryUsage& other)
+    {
+        columns += other.columns;
+        mapped += other.mapped;
+        compressed += other.compressed;
+        summary += other.summary;
+        index += other.index;
+        cache += other.cache;
+
+        return *this;
+    }
+};
+
+
+/**
+ * @brief The DataBlock class stores a contiguous run of samples in columnar form.
+ *
+ * Timestamps and values are held in separate arrays, so that operations which
+ * only need one column (e.g. searching for a timestamp) do not have to drag the
+ * other column through the cache.
+ *
+ * Values may optionally be stored in single precision, which halves the memory
+ * required for the value column of very large series.
+ *
+ * A DataSeries is composed of a sequence of blocks, each holding at most
+ * DataBlock::CAPACITY samples. Growing a series therefore never requires the
+ * entire dataset to be reallocated and copied.
+ *
+ * Each block also maintains a multi-resolution summary (a pyramid of buckets
+ * holding min / max / sum / sum-of-squares), which allows large ranges of samples
+ * to be down-sampled, or their statistics calculated, without visiting every sample. The lowest level summarises SUMMARY_BASE samples per
+ * bucket, and each subsequent level combines SUMMARY_FACTOR buckets of the
+ * level below. The top level summarises the entire block in a single bucket.
+ *
+ * Concurrency:
+ * Storage for a block is allocated once, and never reallocated. Once a block has
+ * been published (made visible to readers via a DataBlockTable) the only permitted
+ * modification is appending samples within the allocated capacity. The sample
+ * count is updated (with release semantics) only after the sample and its summary
+ * buckets have been written, so a reader can safely access any sample below the
+ * count it observed, without locking.
+ *
+ * Any other modification (insert, trim, split) is performed on a copy of the
+ * block, which is then published in place of the original.
+ *
+ * Storage:
+ * Sample columns are allocated on the heap, or from a memory-mapped DataStore
+ * (for datasets larger than available memory). Copies of a block are allocated
+ * from the same store as the original. The summary pyramid is always held on the heap.
+ *
+ * A full block may also be stored in compressed form (see DataCodec). The columns of
+ * a compressed block are decoded on demand by getColumns(), and a small number of
+ * recently decoded blocks are cached. The summary pyramid is not compressed, so
+ * down-sampling and statistics for large ranges do not require any decoding.
+ *
+ * If the samples in a full block are evenly spaced in time, the timestamp column is
+ * not stored at all; timestamps are calculated from the first timestamp and the
+ * sample interval, and timestamp searches are simple arithmetic.
+ *
+ * Series imported from the same table (e.g. the columns of a CSV file) usually have
+ * identical timestamps. A full block may share the (immutable) timestamp column of an
+ * identical block of another series, rather than storing its own copy; the other block
+ * is retained for as long as its column is in use (see DataSeries::shareTimestamps).
+ */
+class DataBlock
+{
+public:
+    //! Maximum number of samples stored in a single block
+    static const size_t CAPACITY = 32768;
+
+    //! Initial allocation for the first block in a series
+    static const size_t INITIAL_CAPACITY = 256;
+
+    //! Number of samples summarised by each bucket in the lowest summary level
+    static const size_t SUMMARY_BASE = 64;
+
+    //! Number of buckets combined into each bucket of the next summary level
+    static const size_t SUMMARY_FACTOR = 8;
+
+    //! Number of summary levels (64, 512, 4096, 32768 samples per bucket)
+    static const unsigned int SUMMARY_LEVELS = 4;
+
+    //! Number of decoded (compressed) blocks which are cached
+    static const size_t DECODE_CACHE_SIZE = 32;
+
+    static size_t getSummaryBucketSize(unsigned int level);
+
+    enum Encoding
+    {
+        //! Timestamp and value columns stored explicitly
+        ENCODING_RAW,
+
+        //! Timestamps are implicit if the samples are evenly spaced, values are stored explicitly
+        ENCODING_UNIFORM,
+
+        //! Timestamps are implicit if the samples are evenly spaced, all other columns are compressed
+        ENCODING_COMPRESSED,
+    };
+
+    /**
+     * @brief The Columns struct provides access to the sample columns of a block.
+     * For a compressed block, the decoded columns remain valid for as long as this object exists.
+     */
+    struct Columns
+    {
+        //! Timestamp column (nullptr if the timestamps were not requested, and are uniform)
+        const double* timestamps = nullptr;
+
+        //! Value column (nullptr if values are stored in single precision)
+        const double* values = nullptr;
+
+        //! Value column (nullptr if values are stored in double precision)
+        const float* valuesSingle = nullptr;
+
+        //! Decoded storage (empty for an uncompressed block)
+        std::shared_ptr<const void> owner;
+
+        //! Uniform timestamps (used if there is no timestamp column)
+        double uniformStart = 0;
+        double uniformInterval = 0;
+
+        double getTimestamp(size_t idx) const { return timestamps ? timestamps[idx] : uniformStart + idx * uniformInterval; }
+        double getValue(size_t idx) const { return values ? values[idx] : (double) valuesSingle[idx]; }
+    };
+
+    /**
+     * @brief The Summary struct describes the values within a range of samples
+     */
+    struct Summary
+    {
+        Summary() {}
+        Summary(double v, size_t idx) : min(v), max(v), sum(v), idxMin(idx), idxMax(idx), count(1) {}
+
+        double getMean(void) const { return count > 0 ? sum / count : 0; }
+
+        void include(double v, size_t idx)
+        {
+            if (v < min) { min = v; idxMin = idx; }
+            if (v > max) { max = v; idxMax = idx; }
+
+            // Welford's update, which is unaffected by the magnitude of the values
+            const double delta = v - getMean();
+
+            sum += v;
+            count++;
+            m2 += delta * (v - getMean());
+        }
+
+        void include(const Summary& other)
+        {
+            if (other.count == 0) return;
+
+            if (count == 0)
+            {
+                *this = other;
+                return;
+            }
+
+            if (other.min < min) { min = other.min; idxMin = other.idxMin; }
+            if (other.max > max) { max = other.max; idxMax = other.idxMax; }
+
+            // Pairwise combination of the squared deviations (Chan et al.)
+            const double delta = other.getMean() - getMean();
+            const double n = count;
+            const double n_other = other.count;
+
+            m2 += other.m2 + delta * delta * n * n_other / (n + n_other);
+            sum += other.sum;
+            count += other.count;
+        }
+
+        //! Minimum value within the range
+        double min = 0;
+
+        //! Maximum value within the range
+        double max = 0;
+
+        //! Sum of values within the range
+        double sum = 0;
+
+        //! Sum of squared deviations from the mean of the range
+        double m2 = 0;
+
+        //! Index (within the block) of the minimum value
+        uint32_t idxMin = 0;
+
+        //! Index (within the block) of the maximum value
+        uint32_t idxMax = 0;
+
+        //! Number of samples within the range
+        uint64_t count = 0;
+    };
+
+    DataBlock(size_t capacity, bool singlePrecision = false, std::shared_ptr<DataStore> store = nullptr);
+    DataBlock(const DataBlock& other, size_t capacity, bool singlePrecision, std::shared_ptr<DataStore> store);
+    DataBlock(const DataBlock& other, size_t capacity, bool singlePrecision) : DataBlock(other, capacity, singlePrecision, other.getStore()) {}
+    DataBlock(const DataBlock& other, size_t capacity) : DataBlock(other, capacity, other.isSinglePrecision()) {}
+    DataBlock(const DataBlock& other) : DataBlock(other, other.getCapacity()) {}
+    DataBlock(const DataBlock& other, size_t first, size_t last, size_t capacity);
+    DataBlock(const DataBlock& other, Encoding encoding);
+    DataBlock(const DataBlock& other, std::shared_ptr<const DataBlock> timestampOwner);
+
+    DataBlock& operator=(const DataBlock& other) = delete;
+
+    size_t size(void) const { return count.load(std::memory_order_acquire); }
+    bool isEmpty(void) const { return size() == 0; }
+
+    //! Number of samples which can be stored without reallocation
+    size_t getCapacity(void) const { return capacity; }
+    bool hasSpace(void) const { return size() < capacity; }
+
+    //! A block is "full" when it contains the maximum number of samples for any block
+    bool isFull(void) const { return size() >= CAPACITY; }
+
+    bool isSinglePrecision(void) const { return singlePrecision; }
+
+    bool isCompressed(void) const { return encoded && !encoded->values.empty(); }
+
+    //! Blocks with uniform timestamps do not store a timestamp column
+    bool hasUniformTimestamps(void) const { return uniform; }
+    double getUniformInterval(void) const { return uniform ? uniformInterval : 0; }
+
+    bool isEvenlySpaced(void) const;
+
+    //! True if the timestamp column is shared with another block (see canShareTimestamps)
+    bool hasSharedTimestamps(void) const { return (bool) timestampOwner; }
+
+    //! True if the block stores its own timestamp column (rather than uniform, compressed or shared timestamps)
+    bool hasTimestampColumn(void) const { return (bool) timestamps; }
+
+    bool canShareTimestamps(const DataBlock& other) const;
+
+    //! True if both blocks use the same timestamp storage (so the samples they have in common have identical timestamps)
+    bool hasSameTimestamps(const DataBlock& other) const
+    {
+        return this == &other ||
+               (timestampColumn && timestampColumn == other.timestampColumn) ||
+               (uniform && other.uniform && uniformStart == other.uniformStart && uniformInterval == other.uniformInterval);
+    }
+
+    //! Size (in bytes) of the compressed columns (zero for an uncompressed block)
+    size_t getEncodedSize(void) const;
+
+    void addMemoryUsage(DataMemoryUsage& usage) const;
+
+    //! Discard the decoded columns of a compressed block (they are decoded again when next required)
+    void releaseDecodedColumns(void) const;
+
+    //! Store from which the sample columns are allocated (nullptr for heap storage)
+    const std::shared_ptr<DataStore>& getStore(void) const { return store; }
+
+    /* Single sample access (for bulk access to a compressed block, use getColumns) */
+    double getTimestamp(size_t idx) const
+    {
+        if (timestampColumn) return timestampColumn[idx];
+        if (uniform) return getUniformTimestamp(idx);
+
+        return getColumns(false).getTimestamp(idx);
+    }
+
+    double getValue(size_t idx) const
+    {
+        if (values) return values[idx];
+        if (valuesSingle) return (double) valuesSingle[idx];
+
+        return getColumns(false).getValue(idx);
+    }
+
+    double getFirstTimestamp(void) const { return timestampColumn ? timestampColumn[0] : firstTimestamp; }
+    double getLastTimestamp(void) const { return timestampColumn ? timestampColumn[size() - 1] : lastTimestamp; }
+
+    //! Timestamp of the final sample within the first "length" samples
+    double getLastTimestamp(size_t length) const { return (timestampColumn || length < size()) ? getTimestamp(length - 1) : lastTimestamp; }
+
+    /**
+     * @brief getColumns - Return the sample columns, decoding them if necessary
+     * @param needTimestamps should be false if the timestamp column pointer is not required;
+     *        uniform timestamps are then calculated by Columns::getTimestamp, rather than decoded
+     */
+    Columns getColumns(bool needTimestamps = true) const
+    {
+        bool decode = encoded && (needTimestamps || !uniform || (!values && !valuesSingle));
+
+        if (decode) return decodeColumns(needTimestamps);
+
+        Columns columns;
+
+        columns.timestamps = timestampColumn;
+        columns.values = values.get();
+        columns.valuesSingle = valuesSingle.get();
+        columns.uniformStart = uniformStart;
+        columns.uniformInterval = uniformInterval;
+
+        return columns;
+    }
+
+    /* Append functions (safe on a published block) */
+    void append(double t, double v);
+    size_t append(const double* t, const double* v, size_t count);
+
+    /* Modification functions (must only be used on a block which has not been published) */
+    void insert(size_t idx, double t, double v);
+
+    size_t lowerBound(double t, size_t length) const;
+    size_t upperBound(double t, size_t length) const;
+
+    const Summary& getSummary(unsigned int level, size_t bucket) const { return summary[level][bucket]; }
+
+    /**
+     * @brief visitSummary - Summarise the samples in the range [first, last) using the coarsest
+     * available buckets, no larger than the specified summary level.
+     *
+     * Regions of the range which are not aligned to the selected level are summarised using
+     * finer levels, down to individual samples. A level of -1 visits every individual sample.
+     *
+     * @param first is the index of the first sample in the range
+     * @param last is the index one past the final sample in the range
+     * @param level is the coarsest summary level to use
+     * @param length is the number of samples in the block, as observed by the caller
+     * @param sealed should be true if no further samples will be appended to the block.
+     *        For a block which may still be growing, a partially filled bucket is never used.
+     * @param callback is called as callback(idx_first, idx_last, summary) for each bucket, in order
+     */
+    template<typename Callback>
+    void visitSummary(size_t first, size_t last, int level, size_t length, bool sealed, Callback callback) const
+    {
+        last = std::min(last, length);
+
+        if (first >= last) return;
+
+        if (level < 0)
+        {
+            const Columns columns = getColumns(false);
+
+            for (size_t idx = first; idx < last; idx++)
+            {
+                callback(idx, idx, Summary(columns.getValue(idx), idx));
+            }
+
+            return;
+        }
+
+        size_t bucket_size = getSummaryBucketSize(level);
+
+        // Range of whole buckets contained within [first, last)
+        // Note: the final bucket in a sealed block may be partially filled
+        size_t bucket_first = (first + bucket_size - 1) / bucket_size;
+        size_t bucket_last = (sealed && last == length) ? (length + bucket_size - 1) / bucket_size : last / bucket_size;
+
+        if (bucket_first >= bucket_last)
+        {
+            visitSummary(first, last, level - 1, length, sealed, callback);
+            return;
+        }
+
+        size_t aligned_first = bucket_first * bucket_size;
+        size_t aligned_last = std::min(bucket_last * bucket_size, length);
+
+        visitSummary(first, aligned_first, level - 1, length, sealed, callback);
+
+        for (size_t bucket = bucket_first; bucket < bucket_last; bucket++)
+        {
+            size_t idx = bucket * bucket_size;
+
+            callback(idx, std::min(idx + bucket_size, length) - 1, summary[level][bucket]);
+        }
+
+        visitSummary(aligned_last, last, level - 1, length, sealed, callback);
+    }
+
+protected:
+    /**
+     * @brief The ColumnDeleter struct returns column storage to the heap, or to the store it was allocated from
+     */
+    struct ColumnDeleter
+    {
+        ColumnDeleter() : bytes(0) {}
+
+        std::shared_ptr<DataStore> store;
+        size_t bytes;
+
+        void operator()(double* ptr) const;
+        void operator()(float* ptr) const;
+    };
+
+    template<typename T>
+    using Column = std::unique_ptr<T[], ColumnDeleter>;
+
+    /**
+     * @brief The Encoded struct holds the columns of a compressed block (or uniform block),
+     * which are decoded on demand
+     */
+    struct Encoded
+    {
+        //! Compressed timestamps (empty if uncompressed, or the timestamps are uniform)
+        std::vector<uint64_t> timestamps;
+
+        //! Compressed values (empty if uncompressed)
+        std::vector<uint64_t> values;
+
+        //! Guards access to the decoded columns
+        std::mutex mutex;
+
+        //! Most recently decoded columns (if still in use)
+        std::weak_ptr<const void> decoded;
+    };
+
+    Columns decodeColumns(bool needTimestamps) const;
+
+    template<typename T>
+    Column<T> allocateColumn(void) const;
+
+    double getUniformTimestamp(size_t idx) const { return uniformStart + idx * uniformInterval; }
+    size_t getUniformIndex(double t, size_t length) const;
+
+    void allocate(void);
+    void allocateSummary(void);
+    void seal(void);
+    void summariseSample(size_t idx);
+    void rebuildSummary(size_t from = 0) { rebuildSummary(from, size()); }
+    void rebuildSummary(size_t from, size_t length);
+
+    Summary summariseRange(size_t first, size_t n) const;
+
+    //! Number of samples allocated
+    const size_t capacity;
+
+    //! Selects which value column is in use
+    const bool singlePrecision;
+
+    //! Number of valid samples
+    std::atomic<size_t> count;
+
+    //! Memory-mapped column storage (nullptr for heap storage)
+    const std::shared_ptr<DataStore> store;
+
+    //! Timestamp column (nullptr if the timestamps are shared, uniform or compressed)
+    Column<double> timestamps;
+
+    //! Timestamp column in use: the column of this block, or of timestampOwner (nullptr if none)
+    const double* timestampColumn = nullptr;
+
+    //! Block whose timestamp column is shared by this block (nullptr if none)
+    std::shared_ptr<const DataBlock> timestampOwner;
+
+    //! Value column (double precision)
+    Column<double> values;
+
+    //! Value column (single precision)
+    Column<float> valuesSingle;
+
+    //! Compressed columns (nullptr if all columns are stored explicitly)
+    std::unique_ptr<Encoded> encoded;
+
+    //! First and last timestamps (available without decoding)
+    double firstTimestamp = 0;
+    double lastTimestamp = 0;
+
+    //! Timestamps are calculated as (uniformStart + idx * uniformInterval)
+    bool uniform = false;
+    double uniformStart = 0;
+    double uniformInterval = 0;
+
+    //! Summary pyramid, one array of buckets per level
+    std::unique_ptr<Summary[]> summary[SUMMARY_LEVELS];
+};
+
+typedef std::shared_ptr<DataBlock> DataBlockPointer;
+
+
+/**
+ * @brief The DataBlockTable struct describes the complete set of blocks which make up a DataSeries.
+ *
+ * A table is never modified after it has been published; any structural change to a series
+ * (adding a block, replacing a modified block, clearing data) creates a new table.
+ * Readers hold a reference to the table they observed, which keeps its blocks alive.
+ */
+struct DataBlockTable
+{
+    //! Time-ordered blocks of samples
+    std::vector<DataBlockPointer> blocks;
+
+    //! Index of the first sample contained in each block
+    std::vector<uint64_t> offsets;
+
+    void updateOffsets(size_t first = 0);
+
+    size_t getBlockForIndex(uint64_t idx) const;
+
+    //! Number of samples in the specified block, within the first "count" samples of the table
+    size_t getBlockLength(size_t block, uint64_t count) const
+    {
+        // The length of a block before the final block is fixed by the offset of the next block,
+        // as the block may be shared with another table in which it is still growing (see ConcatenatedSeries)
+        const uint64_t end = block + 1 < offsets.size() ? std::min(count, offsets[block + 1]) : count;
+
+        return std::min<uint64_t>(blocks[block]->size(), end - offsets[block]);
+    }
+
+    uint64_t size(void) const
+    {
+        return blocks.empty() ? 0 : offsets.back() + blocks.back()->size();
+    }
+};
+
+typedef std::shared_ptr<const DataBlockTable> DataBlockTablePointer;
+
+
+#endif // DATA_BLOCK_H
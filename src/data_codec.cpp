@@ -0,0 +1,515 @@
+#include <math.h>
+#include <string.h>
+
+#include "data_codec.hpp"
+#include "time_ticks.hpp"
+
+
+/*
+ * Write a stream of bits (most significant bit first) into 64-bit words
+ */
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint64_t>& out) : output(out) {}
+
+    //! Write the lowest n bits (1 <= n <= 64) of the provided value
+    void write(uint64_t bits, unsigned int n)
+    {
+        if (n < 64)
+        {
+            bits &= (1ULL << n) - 1;
+        }
+
+        if (used + n < 64)
+        {
+            word = (word << n) | bits;
+            used += n;
+        }
+        else
+        {
+            unsigned int rest = used + n - 64;
+
+            // Fill the current word with the upper bits, and start a new word with the remainder
+            output.push_back(used == 0 ? bits : (word << (64 - used)) | (bits >> rest));
+
+            word = rest > 0 ? bits & ((1ULL << rest) - 1) : 0;
+            used = rest;
+        }
+    }
+
+    void flush(void)
+    {
+        if (used > 0)
+        {
+            output.push_back(word << (64 - used));
+        }
+
+        word = 0;
+        used = 0;
+    }
+
+protected:
+    std::vector<uint64_t>& output;
+
+    uint64_t word = 0;
+    unsigned int used = 0;
+};
+
+
+/*
+ * Read a stream of bits written by BitWriter
+ */
+class BitReader
+{
+public:
+    BitReader(const std::vector<uint64_t>& in) : input(in) {}
+
+    //! Read n bits (1 <= n <= 64)
+    uint64_t read(unsigned int n)
+    {
+        uint64_t current = getWord(index);
+
+        if (offset + n <= 64)
+        {
+            uint64_t bits = (current << offset) >> (64 - n);
+
+            offset += n;
+
+            if (offset == 64)
+            {
+                index++;
+                offset = 0;
+            }
+
+            return bits;
+        }
+
+        unsigned int first = 64 - offset;
+        unsigned int rest = n - first;
+
+        uint64_t upper = current & ((1ULL << first) - 1);
+
+        index++;
+        offset = rest;
+
+        return (upper << rest) | (getWord(index) >> (64 - rest));
+    }
+
+    bool readBit(void) { return read(1) != 0; }
+
+protected:
+    //! A corrupt stream reads as zeros, rather than overrunning the buffer
+    uint64_t getWord(size_t idx) const { return idx < input.size() ? input[idx] : 0; }
+
+    const std::vector<uint64_t>& input;
+
+    size_t index = 0;
+    unsigned int offset = 0;
+};
+
+
+static inline unsigned int countLeadingZeros(uint64_t x, unsigned int bits)
+{
+    unsigned int n = 0;
+
+#if defined(__GNUC__)
+    n = (x == 0) ? 64 : __builtin_clzll(x);
+#else
+    for (uint64_t mask = 1ULL << 63; mask && !(x & mask); mask >>= 1) n++;
+#endif
+
+    // Account for narrower words stored in the low bits of a 64-bit value
+    return n - (64 - bits);
+}
+
+
+static inline unsigned int countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__)
+    return (x == 0) ? 64 : __builtin_ctzll(x);
+#else
+    unsigned int n = 0;
+
+    for (uint64_t mask = 1; mask && !(x & mask); mask <<= 1) n++;
+
+    return n;
+#endif
+}
+
+
+static inline uint64_t zigzag(int64_t x)
+{
+    return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+
+static inline int64_t unzigzag(uint64_t x)
+{
+    return (int64_t) (x >> 1) ^ -(int64_t) (x & 1);
+}
+
+
+static inline uint64_t doubleBits(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+
+static inline double bitsDouble(uint64_t bits)
+{
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+
+//! First word of a stream of integer ticks (a NaN, which is never the bit pattern of a timestamp)
+static const uint64_t TICKS_MARKER = 0x7FF854494B530000ULL;
+
+
+/*
+ * Delta-of-delta encoding of a sequence of words (timestamp bit patterns, or ticks), with variable length codes:
+ *
+ * '0'                  - delta-of-delta is zero
+ * '10'    + 3 bits     - zigzag value < 2^3 (rounding jitter in floating point timestamps)
+ * '110'   + 9 bits     - zigzag value < 2^9
+ * '1110'  + 12 bits    - zigzag value < 2^12
+ * '11110' + 32 bits    - zigzag value < 2^32
+ * '11111' + 64 bits    - any other value
+ */
+template<typename Word>
+static void encodeDeltas(size_t n, Word word, BitWriter& writer)
+{
+    uint64_t previous = 0;
+    uint64_t delta = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        uint64_t bits = word(idx);
+
+        if (idx == 0)
+        {
+            writer.write(bits, 64);
+        }
+        else if (idx == 1)
+        {
+            delta = bits - previous;
+            writer.write(delta, 64);
+        }
+        else
+        {
+            uint64_t d = bits - previous;
+            uint64_t z = zigzag((int64_t) (d - delta));
+
+            delta = d;
+
+            if (z == 0)
+            {
+                writer.write(0x0, 1);
+            }
+            else if (z < (1ULL << 3))
+            {
+                writer.write((0x2ULL << 3) | z, 5);
+            }
+            else if (z < (1ULL << 9))
+            {
+                writer.write((0x6ULL << 9) | z, 12);
+            }
+            else if (z < (1ULL << 12))
+            {
+                writer.write((0xEULL << 12) | z, 16);
+            }
+            else if (z < (1ULL << 32))
+            {
+                writer.write((0x1EULL << 32) | z, 37);
+            }
+            else
+            {
+                writer.write(0x1F, 5);
+                writer.write(z, 64);
+            }
+        }
+
+        previous = bits;
+    }
+}
+
+
+/*
+ * Decode a sequence written by encodeDeltas, whose first word has already been read
+ */
+template<typename Store>
+static void decodeDeltas(BitReader& reader, size_t n, uint64_t first, Store store)
+{
+    uint64_t previous = first;
+    uint64_t delta = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        if (idx == 1)
+        {
+            delta = reader.read(64);
+            previous += delta;
+        }
+        else if (idx > 1)
+        {
+            uint64_t z = 0;
+
+            if (!reader.readBit())
+            {
+                z = 0;
+            }
+            else if (!reader.readBit())
+            {
+                z = reader.read(3);
+            }
+            else if (!reader.readBit())
+            {
+                z = reader.read(9);
+            }
+            else if (!reader.readBit())
+            {
+                z = reader.read(12);
+            }
+            else if (!reader.readBit())
+            {
+                z = reader.read(32);
+            }
+            else
+            {
+                z = reader.read(64);
+            }
+
+            delta += (uint64_t) unzigzag(z);
+            previous += delta;
+        }
+
+        store(idx, previous);
+    }
+}
+
+
+/*
+ * Determine if every timestamp is exactly a whole number of ticks (as converted by TimeTicks::toSeconds)
+ */
+static bool isWholeTicks(const double* timestamps, size_t n)
+{
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        const double t = timestamps[idx];
+
+        if (!(fabs(t) < TimeTicks::MAX_SECONDS)) return false;
+
+        if (doubleBits(TimeTicks::toSeconds(TimeTicks::fromSeconds(t))) != doubleBits(t)) return false;
+    }
+
+    return true;
+}
+
+
+void DataCodec::encodeTimestamps(const double* timestamps, size_t n, std::vector<uint64_t>& output)
+{
+    BitWriter writer(output);
+
+    if (n > 1 && isWholeTicks(timestamps, n))
+    {
+        // The deltas of integer ticks are not disturbed by the rounding of the timestamps
+        writer.write(TICKS_MARKER, 64);
+
+        encodeDeltas(n, [timestamps](size_t idx) { return (uint64_t) TimeTicks::fromSeconds(timestamps[idx]); }, writer);
+    }
+    else
+    {
+        encodeDeltas(n, [timestamps](size_t idx) { return doubleBits(timestamps[idx]); }, writer);
+    }
+
+    writer.flush();
+}
+
+
+void DataCodec::decodeTimestamps(const std::vector<uint64_t>& input, size_t n, double* timestamps)
+{
+    if (n == 0) return;
+
+    BitReader reader(input);
+
+    const uint64_t first = reader.read(64);
+
+    if (first == TICKS_MARKER)
+    {
+        decodeDeltas(reader, n, reader.read(64), [timestamps](size_t idx, uint64_t ticks) {
+            timestamps[idx] = TimeTicks::toSeconds((int64_t) ticks);
+        });
+    }
+    else
+    {
+        decodeDeltas(reader, n, first, [timestamps](size_t idx, uint64_t bits) {
+            timestamps[idx] = bitsDouble(bits);
+        });
+    }
+}
+
+
+/*
+ * XOR encoding, for words of the specified number of bits (32 or 64):
+ *
+ * '0'                              - value is identical to the previous value
+ * '10' + meaningful bits           - XOR fits within the previous window of meaningful bits
+ * '11' + 5 bits (leading zeros)
+ *      + 5/6 bits (length - 1)
+ *      + meaningful bits           - new window of meaningful bits
+ */
+template<unsigned int BITS>
+static void encodeWords(const uint64_t* words, size_t n, BitWriter& writer)
+{
+    const unsigned int length_bits = BITS == 64 ? 6 : 5;
+
+    uint64_t previous = 0;
+
+    unsigned int leading = BITS + 1;
+    unsigned int trailing = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        uint64_t word = words[idx];
+
+        if (idx == 0)
+        {
+            writer.write(word, BITS);
+            previous = word;
+            continue;
+        }
+
+        uint64_t x = word ^ previous;
+
+        previous = word;
+
+        if (x == 0)
+        {
+            writer.write(0x0, 1);
+            continue;
+        }
+
+        unsigned int lz = countLeadingZeros(x, BITS);
+        unsigned int tz = countTrailingZeros(x);
+
+        // Leading zero count is stored in 5 bits
+        if (lz > 31) lz = 31;
+
+        if (leading <= BITS && lz >= leading && tz >= trailing)
+        {
+            writer.write(0x2, 2);
+            writer.write(x >> trailing, BITS - leading - trailing);
+        }
+        else
+        {
+            unsigned int meaningful = BITS - lz - tz;
+
+            writer.write(0x3, 2);
+            writer.write(lz, 5);
+            writer.write(meaningful - 1, length_bits);
+            writer.write(x >> tz, meaningful);
+
+            leading = lz;
+            trailing = tz;
+        }
+    }
+}
+
+
+template<unsigned int BITS>
+static void decodeWords(BitReader& reader, size_t n, uint64_t* words)
+{
+    const unsigned int length_bits = BITS == 64 ? 6 : 5;
+
+    uint64_t previous = 0;
+
+    unsigned int leading = 0;
+    unsigned int trailing = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        if (idx == 0)
+        {
+            previous = reader.read(BITS);
+        }
+        else if (reader.readBit())
+        {
+            if (reader.readBit())
+            {
+                leading = (unsigned int) reader.read(5);
+                trailing = BITS - leading - ((unsigned int) reader.read(length_bits) + 1);
+            }
+
+            previous ^= reader.read(BITS - leading - trailing) << trailing;
+        }
+
+        words[idx] = previous;
+    }
+}
+
+
+void DataCodec::encodeValues(const double* values, size_t n, std::vector<uint64_t>& output)
+{
+    std::vector<uint64_t> words(n);
+
+    // An empty vector (or column) may have a null pointer, which memcpy does not accept
+    if (n > 0) memcpy(words.data(), values, n * sizeof(double));
+
+    BitWriter writer(output);
+
+    encodeWords<64>(words.data(), n, writer);
+
+    writer.flush();
+}
+
+
+void DataCodec::encodeValues(const float* values, size_t n, std::vector<uint64_t>& output)
+{
+    std::vector<uint64_t> words(n);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        uint32_t bits;
+        memcpy(&bits, &values[idx], sizeof(bits));
+
+        words[idx] = bits;
+    }
+
+    BitWriter writer(output);
+
+    encodeWords<32>(words.data(), n, writer);
+
+    writer.flush();
+}
+
+
+void DataCodec::decodeValues(const std::vector<uint64_t>& input, size_t n, double* values)
+{
+    BitReader reader(input);
+
+    std::vector<uint64_t> words(n);
+
+    decodeWords<64>(reader, n, words.data());
+
+    if (n > 0) memcpy(values, words.data(), n * sizeof(double));
+}
+
+
+void DataCodec::decodeValues(const std::vector<uint64_t>& input, size_t n, float* values)
+{
+    BitReader reader(input);
+
+    std::vector<uint64_t> words(n);
+
+    decodeWords<32>(reader, n, words.data());
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        uint32_t bits = (uint32_t) words[idx];
+        memcpy(&values[idx], &bits, sizeof(bits));
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef DATA_CODEC_H
+#define DATA_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+/**
+ * @brief The DataCodec class implements lossless compression of sample columns.
+ *
+ * The encoding follows the scheme described for the Gorilla time series database:
+ *
+ * - Timestamps are stored as the delta-of-delta of successive values. For samples taken
+ *   at a fixed rate, the delta-of-delta is (almost always) zero, which is encoded in a single bit.
+ *   Timestamps are doubles, so the deltas are calculated on their (monotonic) bit patterns,
+ *   which keeps the encoding exact. If every timestamp of a column is a whole number of nanosecond
+ *   ticks (see TimeTicks), e.g. it was parsed from decimal text, the deltas are calculated on the
+ *   ticks instead, so that the rounding of the doubles does not add jitter to a fixed rate.
+ *
+ * - Values are stored as the XOR of successive values. Slowly changing values have many leading
+ *   and trailing zero bits in common, so only the "meaningful" bits of each XOR are stored.
+ *
+ * Encoded data are written as a stream of 64-bit words. The number of samples is not stored,
+ * and must be provided when decoding.
+ */
+class DataCodec
+{
+public:
+    static void encodeTimestamps(const double* timestamps, size_t n, std::vector<uint64_t>& output);
+    static void decodeTimestamps(const std::vector<uint64_t>& input, size_t n, double* timestamps);
+
+    static void encodeValues(const double* values, size_t n, std::vector<uint64_t>& output);
+    static void encodeValues(const float* values, size_t n, std::vector<uint64_t>& output);
+
+    static void decodeValues(const std::vector<uint64_t>& input, size_t n, double* values);
+    static void decodeValues(const std::vector<uint64_t>& input, size_t n, float* values);
+};
+
+
+#endif // DATA_CODEC_H
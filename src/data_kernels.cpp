@@ -0,0 +1,525 @@
+#include "data_kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DATA_KERNELS_AVX2
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define DATA_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+
+/*
+ * Scalar reduction (reference implementation, and fallback)
+ */
+template<typename T>
+static void reduceValues(const T* values, size_t n, DataReduction& result)
+{
+    if (n == 0) return;
+
+    double v_min = values[0];
+    double v_max = values[0];
+    double sum = 0;
+    double sum_squares = 0;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        double v = values[idx];
+
+        v_min = v < v_min ? v : v_min;
+        v_max = v > v_max ? v : v_max;
+
+        sum += v;
+        sum_squares += v * v;
+    }
+
+    result.min = v_min;
+    result.max = v_max;
+    result.sum = sum;
+    result.sumSquares = sum_squares;
+}
+
+
+/*
+ * Combine a partial (vectorised) reduction with any remaining values
+ */
+template<typename T>
+static void reduceRemainder(const T* values, size_t first, size_t n, DataReduction& result)
+{
+    for (size_t idx = first; idx < n; idx++)
+    {
+        double v = values[idx];
+
+        result.min = v < result.min ? v : result.min;
+        result.max = v > result.max ? v : result.max;
+
+        result.sum += v;
+        result.sumSquares += v * v;
+    }
+}
+
+
+/*
+ * Scalar histogram (reference implementation, and fallback).
+ * Values below the first bin are counted in the first bin, and values above the last bin in the last bin.
+ */
+template<typename T>
+static void histogramValues(const T* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    if (n == 0 || bins == 0) return;
+
+    const double top = (double) (bins - 1);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        double bin = ((double) values[idx] - lo) * scale;
+
+        bin = bin < 0 ? 0 : bin;
+        bin = bin > top ? top : bin;
+
+        counts[(uint32_t) bin]++;
+    }
+}
+
+
+#ifdef DATA_KERNELS_AVX2
+
+__attribute__((target("avx2")))
+static void reduceLanesAVX2(__m256d v_min, __m256d v_max, __m256d sum, __m256d sum_squares, DataReduction& result)
+{
+    alignas(32) double lanes_min[4];
+    alignas(32) double lanes_max[4];
+    alignas(32) double lanes_sum[4];
+    alignas(32) double lanes_sq[4];
+
+    _mm256_store_pd(lanes_min, v_min);
+    _mm256_store_pd(lanes_max, v_max);
+    _mm256_store_pd(lanes_sum, sum);
+    _mm256_store_pd(lanes_sq, sum_squares);
+
+    result.min = lanes_min[0];
+    result.max = lanes_max[0];
+    result.sum = 0;
+    result.sumSquares = 0;
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+        result.min = lanes_min[lane] < result.min ? lanes_min[lane] : result.min;
+        result.max = lanes_max[lane] > result.max ? lanes_max[lane] : result.max;
+
+        result.sum += lanes_sum[lane];
+        result.sumSquares += lanes_sq[lane];
+    }
+}
+
+
+__attribute__((target("avx2")))
+static void reduceDoubleAVX2(const double* values, size_t n, DataReduction& result)
+{
+    if (n < 4)
+    {
+        reduceValues(values, n, result);
+        return;
+    }
+
+    __m256d v_min = _mm256_loadu_pd(values);
+    __m256d v_max = v_min;
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sum_squares = _mm256_setzero_pd();
+
+    size_t idx = 0;
+
+    for (; idx + 4 <= n; idx += 4)
+    {
+        __m256d x = _mm256_loadu_pd(values + idx);
+
+        v_min = _mm256_min_pd(v_min, x);
+        v_max = _mm256_max_pd(v_max, x);
+        sum = _mm256_add_pd(sum, x);
+        sum_squares = _mm256_add_pd(sum_squares, _mm256_mul_pd(x, x));
+    }
+
+    reduceLanesAVX2(v_min, v_max, sum, sum_squares, result);
+    reduceRemainder(values, idx, n, result);
+}
+
+
+__attribute__((target("avx2")))
+static void reduceFloatAVX2(const float* values, size_t n, DataReduction& result)
+{
+    if (n < 4)
+    {
+        reduceValues(values, n, result);
+        return;
+    }
+
+    // Values are widened to double precision, to match the scalar implementation
+    __m256d v_min = _mm256_cvtps_pd(_mm_loadu_ps(values));
+    __m256d v_max = v_min;
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sum_squares = _mm256_setzero_pd();
+
+    size_t idx = 0;
+
+    for (; idx + 4 <= n; idx += 4)
+    {
+        __m256d x = _mm256_cvtps_pd(_mm_loadu_ps(values + idx));
+
+        v_min = _mm256_min_pd(v_min, x);
+        v_max = _mm256_max_pd(v_max, x);
+        sum = _mm256_add_pd(sum, x);
+        sum_squares = _mm256_add_pd(sum_squares, _mm256_mul_pd(x, x));
+    }
+
+    reduceLanesAVX2(v_min, v_max, sum, sum_squares, result);
+    reduceRemainder(values, idx, n, result);
+}
+
+/*
+ * Histograms calculate the bin of each value four at a time, and increment the counts from the calculated bins.
+ * Alternate values are counted in a second copy of the counts (on the stack), so that runs of values in the same bin
+ * (which are common, as signals are usually smooth) do not stall on the same counter.
+ */
+static const uint32_t HISTOGRAM_SPARE_BINS = 1024;
+
+
+__attribute__((target("avx2")))
+static inline void countBinsAVX2(__m256d bin, __m256d v_top, uint32_t* counts, uint32_t* spare)
+{
+    alignas(16) int32_t index[4];
+
+    bin = _mm256_min_pd(_mm256_max_pd(bin, _mm256_setzero_pd()), v_top);
+
+    _mm_store_si128((__m128i*) index, _mm256_cvttpd_epi32(bin));
+
+    counts[index[0]]++;
+    spare[index[1]]++;
+    counts[index[2]]++;
+    spare[index[3]]++;
+}
+
+
+__attribute__((target("avx2")))
+static void histogramDoubleAVX2(const double* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    // Very fine histograms are counted directly
+    if (n < 4 || bins == 0 || bins > HISTOGRAM_SPARE_BINS)
+    {
+        histogramValues(values, n, lo, scale, bins, counts);
+        return;
+    }
+
+    uint32_t spare[HISTOGRAM_SPARE_BINS] = {};
+
+    const __m256d v_lo = _mm256_set1_pd(lo);
+    const __m256d v_scale = _mm256_set1_pd(scale);
+    const __m256d v_top = _mm256_set1_pd((double) (bins - 1));
+
+    size_t idx = 0;
+
+    for (; idx + 4 <= n; idx += 4)
+    {
+        countBinsAVX2(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(values + idx), v_lo), v_scale), v_top, counts, spare);
+    }
+
+    histogramValues(values + idx, n - idx, lo, scale, bins, counts);
+
+    for (uint32_t bin = 0; bin < bins; bin++)
+    {
+        counts[bin] += spare[bin];
+    }
+}
+
+
+__attribute__((target("avx2")))
+static void histogramFloatAVX2(const float* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    if (n < 4 || bins == 0 || bins > HISTOGRAM_SPARE_BINS)
+    {
+        histogramValues(values, n, lo, scale, bins, counts);
+        return;
+    }
+
+    uint32_t spare[HISTOGRAM_SPARE_BINS] = {};
+
+    const __m256d v_lo = _mm256_set1_pd(lo);
+    const __m256d v_scale = _mm256_set1_pd(scale);
+    const __m256d v_top = _mm256_set1_pd((double) (bins - 1));
+
+    size_t idx = 0;
+
+    // Values are widened to double precision, to match the scalar implementation
+    for (; idx + 4 <= n; idx += 4)
+    {
+        countBinsAVX2(_mm256_mul_pd(_mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(values + idx)), v_lo), v_scale), v_top, counts, spare);
+    }
+
+    histogramValues(values + idx, n - idx, lo, scale, bins, counts);
+
+    for (uint32_t bin = 0; bin < bins; bin++)
+    {
+        counts[bin] += spare[bin];
+    }
+}
+
+#endif // DATA_KERNELS_AVX2
+
+
+#ifdef DATA_KERNELS_NEON
+
+static void reduceDoubleNEON(const double* values, size_t n, DataReduction& result)
+{
+    if (n < 2)
+    {
+        reduceValues(values, n, result);
+        return;
+    }
+
+    float64x2_t v_min = vld1q_f64(values);
+    float64x2_t v_max = v_min;
+    float64x2_t sum = vdupq_n_f64(0);
+    float64x2_t sum_squares = vdupq_n_f64(0);
+
+    size_t idx = 0;
+
+    for (; idx + 2 <= n; idx += 2)
+    {
+        float64x2_t x = vld1q_f64(values + idx);
+
+        v_min = vminq_f64(v_min, x);
+        v_max = vmaxq_f64(v_max, x);
+        sum = vaddq_f64(sum, x);
+        sum_squares = vfmaq_f64(sum_squares, x, x);
+    }
+
+    result.min = vminvq_f64(v_min);
+    result.max = vmaxvq_f64(v_max);
+    result.sum = vaddvq_f64(sum);
+    result.sumSquares = vaddvq_f64(sum_squares);
+
+    reduceRemainder(values, idx, n, result);
+}
+
+
+static void reduceFloatNEON(const float* values, size_t n, DataReduction& result)
+{
+    if (n < 4)
+    {
+        reduceValues(values, n, result);
+        return;
+    }
+
+    // Values are widened to double precision, to match the scalar implementation
+    float64x2_t v_min = vcvt_f64_f32(vld1_f32(values));
+    float64x2_t v_max = v_min;
+    float64x2_t sum = vdupq_n_f64(0);
+    float64x2_t sum_squares = vdupq_n_f64(0);
+
+    size_t idx = 0;
+
+    for (; idx + 4 <= n; idx += 4)
+    {
+        float32x4_t x = vld1q_f32(values + idx);
+
+        float64x2_t lo = vcvt_f64_f32(vget_low_f32(x));
+        float64x2_t hi = vcvt_high_f64_f32(x);
+
+        v_min = vminq_f64(v_min, vminq_f64(lo, hi));
+        v_max = vmaxq_f64(v_max, vmaxq_f64(lo, hi));
+        sum = vaddq_f64(sum, vaddq_f64(lo, hi));
+        sum_squares = vfmaq_f64(vfmaq_f64(sum_squares, lo, lo), hi, hi);
+    }
+
+    result.min = vminvq_f64(v_min);
+    result.max = vmaxvq_f64(v_max);
+    result.sum = vaddvq_f64(sum);
+    result.sumSquares = vaddvq_f64(sum_squares);
+
+    reduceRemainder(values, idx, n, result);
+}
+
+#endif // DATA_KERNELS_NEON
+
+
+typedef void (*ReduceDoubleFunction)(const double*, size_t, DataReduction&);
+typedef void (*ReduceFloatFunction)(const float*, size_t, DataReduction&);
+typedef void (*HistogramDoubleFunction)(const double*, size_t, double, double, uint32_t, uint32_t*);
+typedef void (*HistogramFloatFunction)(const float*, size_t, double, double, uint32_t, uint32_t*);
+
+struct KernelTable
+{
+    ReduceDoubleFunction reduceDouble;
+    ReduceFloatFunction reduceFloat;
+    HistogramDoubleFunction histogramDouble;
+    HistogramFloatFunction histogramFloat;
+    const char* name;
+};
+
+
+static KernelTable selectKernels(void)
+{
+#if defined(DATA_KERNELS_AVX2)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return {reduceDoubleAVX2, reduceFloatAVX2, histogramDoubleAVX2, histogramFloatAVX2, "AVX2"};
+    }
+#elif defined(DATA_KERNELS_NEON)
+    return {reduceDoubleNEON, reduceFloatNEON, DataKernels::histogramScalar, DataKernels::histogramScalar, "NEON"};
+#endif
+
+    return {DataKernels::reduceScalar, DataKernels::reduceScalar, DataKernels::histogramScalar, DataKernels::histogramScalar, "Scalar"};
+}
+
+
+/*
+ * Kernels are selected on first use
+ */
+static const KernelTable& getKernels(void)
+{
+    static const KernelTable kernels = selectKernels();
+
+    return kernels;
+}
+
+
+/*
+ * Calculate the min / max / sum / sum-of-squares of an array of values.
+ * If n is zero, the result is not modified.
+ */
+void DataKernels::reduce(const double* values, size_t n, DataReduction& result)
+{
+    getKernels().reduceDouble(values, n, result);
+}
+
+
+void DataKernels::reduce(const float* values, size_t n, DataReduction& result)
+{
+    getKernels().reduceFloat(values, n, result);
+}
+
+
+void DataKernels::reduceScalar(const double* values, size_t n, DataReduction& result)
+{
+    reduceValues(values, n, result);
+}
+
+
+void DataKernels::reduceScalar(const float* values, size_t n, DataReduction& result)
+{
+    reduceValues(values, n, result);
+}
+
+
+/*
+ * Count an array of values in "bins" bins of width 1 / scale, starting at lo (values outside the range are
+ * counted in the first or last bin). Each count is incremented: counts must hold "bins" elements.
+ */
+void DataKernels::histogram(const double* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    getKernels().histogramDouble(values, n, lo, scale, bins, counts);
+}
+
+
+void DataKernels::histogram(const float* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    getKernels().histogramFloat(values, n, lo, scale, bins, counts);
+}
+
+
+void DataKernels::histogramScalar(const double* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    histogramValues(values, n, lo, scale, bins, counts);
+}
+
+
+void DataKernels::histogramScalar(const float* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts)
+{
+    histogramValues(values, n, lo, scale, bins, counts);
+}
+
+
+/*
+ * Return the index of the first element equal to the specified value (or n if not found)
+ */
+size_t DataKernels::indexOf(const double* values, size_t n, double value)
+{
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        if (values[idx] == value) return idx;
+    }
+
+    return n;
+}
+
+
+size_t DataKernels::indexOf(const float* values, size_t n, double value)
+{
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        if ((double) values[idx] == value) return idx;
+    }
+
+    return n;
+}
+
+
+/*
+ * Binary search of a sorted array, returning the number of leading elements for which before(element) is true.
+ * The range is halved by a conditional move (the comparison is not predictable, so a branch would stall
+ * half of the time), and the number of steps depends only on n.
+ */
+template<typename T, typename Before>
+static inline size_t searchSorted(const T* values, size_t n, Before before)
+{
+    if (n == 0) return 0;
+
+    const T* base = values;
+
+    while (n > 1)
+    {
+        const size_t half = n / 2;
+
+        base = before(base[half]) ? base + half : base;
+        n -= half;
+    }
+
+    return (size_t) (base - values) + (before(*base) ? 1 : 0);
+}
+
+
+/*
+ * Return the index of the first element >= value (or n), for a sorted array
+ */
+size_t DataKernels::lowerBound(const double* values, size_t n, double value)
+{
+    return searchSorted(values, n, [value](double x) { return x < value; });
+}
+
+
+/*
+ * Return the index of the first element > value (or n), for a sorted array
+ */
+size_t DataKernels::upperBound(const double* values, size_t n, double value)
+{
+    return searchSorted(values, n, [value](double x) { return !(value < x); });
+}
+
+
+size_t DataKernels::lowerBound(const uint64_t* values, size_t n, uint64_t value)
+{
+    return searchSorted(values, n, [value](uint64_t x) { return x < value; });
+}
+
+
+size_t DataKernels::upperBound(const uint64_t* values, size_t n, uint64_t value)
+{
+    return searchSorted(values, n, [value](uint64_t x) { return x <= value; });
+}
+
+
+const char* DataKernels::getInstructionSet()
+{
+    return getKernels().name;
+}
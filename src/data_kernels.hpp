@@ -0,0 +1,69 @@
+#ifndef DATA_KERNELS_H
+#define DATA_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief The DataReduction struct holds the result of reducing a contiguous array of values
+ */
+struct DataReduction
+{
+    //! Minimum value
+    double min = 0;
+
+    //! Maximum value
+    double max = 0;
+
+    //! Sum of values
+    double sum = 0;
+
+    //! Sum of squared values
+    double sumSquares = 0;
+};
+
+
+/**
+ * @brief The DataKernels class provides vectorised reduction functions for sample columns.
+ *
+ * The implementation is selected once at runtime, based on the capabilities of the CPU:
+ * - AVX2 on x86 / x86_64 processors which support it
+ * - NEON on ARM64 processors (always available)
+ * - Scalar code otherwise
+ *
+ * Values must be finite (DataSeries discards NaN and inf values on insertion).
+ *
+ * Sorted columns (e.g. timestamps) are searched without branches: each step of the binary search
+ * selects the half with a conditional move, so the search does not stall on mispredicted branches.
+ */
+class DataKernels
+{
+public:
+    static void reduce(const double* values, size_t n, DataReduction& result);
+    static void reduce(const float* values, size_t n, DataReduction& result);
+
+    static void reduceScalar(const double* values, size_t n, DataReduction& result);
+    static void reduceScalar(const float* values, size_t n, DataReduction& result);
+
+    static size_t indexOf(const double* values, size_t n, double value);
+    static size_t indexOf(const float* values, size_t n, double value);
+
+    static size_t lowerBound(const double* values, size_t n, double value);
+    static size_t upperBound(const double* values, size_t n, double value);
+
+    static size_t lowerBound(const uint64_t* values, size_t n, uint64_t value);
+    static size_t upperBound(const uint64_t* values, size_t n, uint64_t value);
+
+    static void histogram(const double* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts);
+    static void histogram(const float* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts);
+
+    static void histogramScalar(const double* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts);
+    static void histogramScalar(const float* values, size_t n, double lo, double scale, uint32_t bins, uint32_t* counts);
+
+    //! Name of the instruction set selected at runtime
+    static const char* getInstructionSet(void);
+};
+
+
+#endif // DATA_KERNELS_H
@@ -1,7 +1,11 @@
 #include <math.h>
+#include <cmath>
+#include <string.h>
 #include <algorithm>
 
 #include "data_series.hpp"
+#include "data_store.hpp"
+#include "series_update_scheduler.hpp"
 
 const float DataSeries::LINE_WIDTH_MIN = 1.0f;
 const float DataSeries::LINE_WIDTH_MAX = 5.0f;
@@ -9,32 +13,7 @@ const float DataSeries::LINE_WIDTH_MAX = 5.0f;
 const int DataSeries::SYMBOL_SIZE_MIN = 3;
 const int DataSeries::SYMBOL_SIZE_MAX = 10;
 
-
-// Comparison operators for DataPoint and timestamps
-bool operator== (const DataPoint point, const double timestamp)
-{
-    return point.timestamp == timestamp;
-}
-
-bool operator< (const DataPoint point, const double timestamp)
-{
-    return point.timestamp < timestamp;
-}
-
-bool operator< (const double timestamp, const DataPoint point)
-{
-    return timestamp < point.timestamp;
-}
-
-bool operator> (const DataPoint point, const double timestamp)
-{
-    return point.timestamp > timestamp;
-}
-
-bool operator> (const double timestamp, const DataPoint point)
-{
-    return timestamp > point.timestamp;
-}
+const size_t DataSeries::STAGING_CAPACITY;
 
 
 DataSeries::~DataSeries()
@@ -46,7 +25,7 @@ DataSeries::~DataSeries()
 /*
  * Construct a new empty data series
  */
-DataSeries::DataSeries()
+DataSeries::DataSeries() : dataStore(DataStore::getDefault())
 {
     clearData();
 }
@@ -76,7 +55,32 @@ DataSeries::DataSeries(const DataSeries &other) : DataSeries()
     label = other.getLabel();
     units = other.getUnits();
 
-    data = other.getData();
+    valuePrecision = other.getValuePrecision();
+    compressionEnabled = other.isCompressionEnabled();
+    retention = other.getRetention();
+
+    // Timestamps are raw, so the time scaling of the other series is retained
+    Scaling copied;
+
+    copied.timeScale = other.getTimeScale();
+    copied.timeOffset = other.getTimeOffset();
+
+    setScaling(copied);
+
+    epochBase = other.getEpochBase();
+
+    windowStart = other.windowStart;
+    windowEnd = other.windowEnd;
+
+    other.load();
+
+    // Sample blocks are shared with the other series (see copyRange)
+    auto source = std::atomic_load(&other.blockTable);
+    auto table = copyRange(*source, 0, source->size(), false);
+
+    encodeBlocks(*table);
+
+    publishBlockTable(table);
 
     // TODO - What else needs copying?
 
@@ -86,7 +90,8 @@ DataSeries::DataSeries(const DataSeries &other) : DataSeries()
 
 /*
  * Construct a DataSeries by copying from another DataSeries,
- * within the specified time range
+ * within the specified time range.
+ * Blocks which lie entirely within the range are shared with the other series, rather than copied.
  */
 DataSeries::DataSeries(const DataSeries &other, int64_t t_min, int64_t t_max, unsigned int expand) : DataSeries()
 {
@@ -102,9 +107,12 @@ DataSeries::DataSeries(const DataSeries &other, int64_t t_min, int64_t t_max, un
         t_max = swap;
     }
 
+    // Shared blocks store raw (unfiltered) values (the range is of the stored samples)
+    auto snapshot = other.getStoredSnapshot();
+
     // Construct a subsection
-    auto idx_min = other.getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = other.getIndexForTimestamp(t_max, SEARCH_RIGHT_TO_LEFT);
+    auto idx_min = snapshot.lowerBound(t_min);
+    auto idx_max = snapshot.lowerBound(t_max);
 
     // Attempt to expand the indices by a single count on either side
     while (expand > 0)
@@ -114,7 +122,7 @@ DataSeries::DataSeries(const DataSeries &other, int64_t t_min, int64_t t_max, un
             idx_min--;
         }
 
-        if (idx_max < (other.size() - 1))
+        if (idx_max < (snapshot.size() - 1))
         {
             idx_max++;
         }
@@ -122,18 +130,23 @@ DataSeries::DataSeries(const DataSeries &other, int64_t t_min, int64_t t_max, un
         expand--;
     }
 
-    // Allocate memory
-    data.reserve(idx_max - idx_min);
+    valuePrecision = other.getValuePrecision();
 
-    auto length = other.size();
+    // Shared blocks store raw values, so the scaling of the other series is retained
+    Scaling copied;
 
-    for (uint64_t idx = idx_min; idx <= idx_max; idx++)
-    {
-        if (idx < length)
-        {
-            addData(other.getTimestamp(idx), other.getValue(idx));
-        }
-    }
+    copied.scaler = snapshot.getScaler();
+    copied.offset = snapshot.getOffset();
+    copied.timeScale = snapshot.getTimeScale();
+    copied.timeOffset = snapshot.getTimeOffset();
+
+    setScaling(copied);
+    epochBase = other.getEpochBase();
+
+    auto source = std::atomic_load(&other.blockTable);
+
+    // Samples in the range [idx_min, idx_max] (inclusive)
+    publishBlockTable(copyRange(*source, idx_min, std::min<uint64_t>(idx_max + 1, snapshot.size()), false));
 
     update();
 }
@@ -146,177 +159,166 @@ void DataSeries::setColor(QColor c)
 {
     color = c;
 
-    update();
-}
-
-
-/*
- * Return the size (number of samples) of this DataSeries
- */
-size_t DataSeries::size() const
-{
-    return data.size();
+    // The samples are unchanged, so the series is not resampled
+    updateStyle();
 }
 
 
 /*
- * Calculate the bounds of this DataSeries.
- * Returns a QRectF instance
+ * Notify that the samples of this DataSeries have changed.
+ * dataUpdated is emitted immediately, and dataChanged is emitted once the notification
+ * has been coalesced with any other updates (see SeriesUpdateScheduler).
  */
-QRectF DataSeries::getBounds() const
+void DataSeries::update()
 {
-    if (size() == 0) return QRectF();
-
-    auto oldest = getOldestDataPoint();
-    auto newest = getNewestDataPoint();
-
-    return QRectF(
-                oldest.timestamp,
-                qMax(oldest.value, newest.value),
-                newest.timestamp - newest.timestamp,
-                qMin(oldest.value, newest.value)
-                );
-}
-
+    emit dataUpdated();
 
-std::vector<DataPoint> DataSeries::getData(void) const
-{
-    return data;
+    SeriesUpdateScheduler::getInstance()->requestUpdate(this);
 }
 
 
-std::vector<DataPoint> DataSeries::getData(double t_min, double t_max) const
+void DataSeries::notifyChanged()
 {
-    // Ensure that the timestamps are the right way around!
-    if (t_min > t_max)
-    {
-        double swap = t_min;
-
-        t_min = t_max;
-        t_max = swap;
-    }
+    changed_mutex.lock();
 
-    // Subsection
-    auto idx_min = getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = getIndexForTimestamp(t_max, SEARCH_RIGHT_TO_LEFT);
+    double t_min = changed_min;
+    double t_max = changed_max;
 
-    // Construct a subset of the data
-    std::vector<DataPoint> subset;
+    changed_min = std::numeric_limits<double>::infinity();
+    changed_max = -std::numeric_limits<double>::infinity();
 
-    subset.resize(idx_max - idx_min + 2);
+    changed_mutex.unlock();
 
-    for (uint64_t idx = idx_min; idx <= idx_max; idx++)
+    // The series was updated without recording which samples changed
+    if (t_min > t_max)
     {
-        subset.push_back(data[idx]);
+        t_min = -std::numeric_limits<double>::infinity();
+        t_max = std::numeric_limits<double>::infinity();
     }
 
-    return subset;
+    emit dataChanged(t_min, t_max);
 }
 
 
-const DataPoint DataSeries::getDataPoint(uint64_t idx) const
+/*
+ * Record that the samples within [t_min, t_max] have changed (delivered by the next dataChanged notification)
+ */
+void DataSeries::markChanged(double t_min, double t_max)
 {
-    if (idx >= size())
-    {
-        throw std::out_of_range("data index out of range");
-    }
-
-    DataPoint dp = data[idx];
+    changed_mutex.lock();
 
-    dp.value *= scalerValue;
-    dp.value += offsetValue;
+    changed_min = std::min(changed_min, t_min);
+    changed_max = std::max(changed_max, t_max);
 
-    return dp;
+    changed_mutex.unlock();
 }
 
 
-double DataSeries::getTimestamp(uint64_t idx) const
+/*
+ * Return the size (number of samples) of this DataSeries
+ */
+size_t DataSeries::size() const
 {
-    return getDataPoint(idx).timestamp;
+    // A filter does not change the number of samples (or their timestamps)
+    return getRawSnapshot().size();
 }
 
 
-double DataSeries::getValue(uint64_t idx) const
+/*
+ * Return a consistent view of the data currently in this DataSeries.
+ * This does not block on the data mutex, and is safe to call while data are being added.
+ *
+ * A series which is loaded on demand is loaded first (see load).
+ * Any staged (out-of-order) samples are merged first, so that they are visible in the snapshot.
+ * If the mutex is held elsewhere (a writer is busy, or the caller is a modification function)
+ * the merge is left for later, rather than blocking the reader.
+ */
+DataSnapshot DataSeries::getStoredSnapshot() const
 {
-    return getDataPoint(idx).value;
+    if (loadPending.load())
+    {
+        load();
+    }
+
+    if (stagedCount.load() > 0 && data_mutex.tryLock())
+    {
+        // Merging does not change the logical contents of the series
+        const_cast<DataSeries*>(this)->mergeStagedSamples();
+
+        data_mutex.unlock();
+    }
+
+    // The scaling is read once, so the snapshot is consistent with a single update of it
+    const Scaling s = getScaling();
+
+    return DataSnapshot(std::atomic_load(&blockTable), s.scaler, s.offset, s.timeScale, s.timeOffset);
 }
 
 
 /*
- * Insert a new sample into this DataSeries.
- *
- * If the timestamp is "newer" than the most recent point in the series,
- * the new sample is simply appended to the dataset.
- * (This is a much more efficient operation).
- *
- * Otherwise, the sample is inserted into the series, which is more expensive.
+ * Return a snapshot of the samples within the time window of the series (see setTimeWindow), before they are filtered
  */
-void DataSeries::addData(DataPoint point, bool do_update)
+DataSnapshot DataSeries::getRawSnapshot() const
 {
-    // Ignore NaN values
-    if (isnan(point.value)) return;
+    const DataSnapshot stored = getStoredSnapshot();
 
-    // Ignore inf values
-    if (isinf(point.value)) return;
+    const double start = windowStart;
+    const double end = windowEnd;
 
-    data_mutex.lock();
+    if (!(start > -std::numeric_limits<double>::infinity() || end < std::numeric_limits<double>::infinity())) return stored;
 
-    // If the new datapoint is of equal or greater timestamp value, simply append!
-    if (size() == 0 || point.timestamp >= getNewestTimestamp())
+    auto cache = std::atomic_load(&windowCache);
+
+    if (cache && cache->stored.isIdentical(stored) && cache->start == start && cache->end == end &&
+        cache->window.getScaler() == stored.getScaler() && cache->window.getOffset() == stored.getOffset())
     {
-        data.push_back(point);
+        return cache->window;
     }
-    else
-    {
-        auto idx = getIndexForTimestamp(point.timestamp);
 
-        data.insert(data.begin() + idx, point);
-    }
+    auto updated = std::make_shared<WindowCache>();
 
-    if (do_update)
-    {
-        update();
-    }
+    updated->stored = stored;
+    updated->start = start;
+    updated->end = end;
+    updated->window = stored.getTimeWindow(stored.applyTimeScaling(start), stored.applyTimeScaling(end));
 
-    data_mutex.unlock();
+    std::atomic_store(&windowCache, std::shared_ptr<const WindowCache>(updated));
+
+    return updated->window;
 }
 
 
 /*
- * Add a single data point to the series
+ * Return a snapshot of the samples, which are passed through the filter of the series (if there is one)
  */
-void DataSeries::addData(double t, float value, bool do_update)
+DataSnapshot DataSeries::getSnapshot() const
 {
-    addData(DataPoint(t, value), do_update);
-}
-
+    auto f = std::atomic_load(&filter);
 
-void DataSeries::clipTimeRange(double t_min, double t_max, bool do_update)
-{
-    // Ensure that the timestamps are the right way around!
-    if (t_min > t_max)
+    if (f)
     {
-        double swap = t_min;
+        const DataSnapshot raw = getRawSnapshot();
 
-        t_min = t_max;
-        t_max = swap;
+        // Filters retain the (raw) timestamps, so the time scaling of the series applies to the filtered samples
+        return f->filterSnapshot(raw).withTimeScaling(raw.getTimeScale(), raw.getTimeOffset());
     }
 
-    auto idx_min = getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = getIndexForTimestamp(t_max, SEARCH_LEFT_TO_RIGHT);
+    return getRawSnapshot();
+}
+
 
-    // Construct a subset of the data
-    std::vector<DataPoint> subset;
+void DataSeries::setScaler(double s, bool do_update)
+{
+    scaling_mutex.lock();
 
-    subset.resize(idx_max - idx_min + 2);
+    Scaling updated = getScaling();
+    updated.scaler = s;
 
-    for (uint64_t idx = idx_min; idx <= idx_max; idx++)
-    {
-        subset.push_back(data[idx]);
-    }
+    setScaling(updated);
 
-    // Override original data
-    data = subset;
+    scaling_mutex.unlock();
+
+    markChanged();
 
     if (do_update)
     {
@@ -325,13 +327,18 @@ void DataSeries::clipTimeRange(double t_min, double t_max, bool do_update)
 }
 
 
-void DataSeries::clearData(bool do_update)
+void DataSeries::setOffset(double o, bool do_update)
 {
-    data_mutex.lock();
+    scaling_mutex.lock();
 
-    data.clear();
+    Scaling updated = getScaling();
+    updated.offset = o;
 
-    data_mutex.unlock();
+    setScaling(updated);
+
+    scaling_mutex.unlock();
+
+    markChanged();
 
     if (do_update)
     {
@@ -340,228 +347,2254 @@ void DataSeries::clearData(bool do_update)
 }
 
 
-const DataPoint DataSeries::getOldestDataPoint() const
+/**
+ * @brief DataSeries::setTimeScaling - Set the mapping from the raw timestamps of the series to the aligned time,
+ * t = raw * scale + offset. The samples are not modified: the mapping is applied when they are read.
+ * @param scale must be positive (so the order of the samples is unchanged)
+ */
+void DataSeries::setTimeScaling(double scale, double offset, bool do_update)
 {
-    if (size() > 0)
+    if (!(scale > 0) || !std::isfinite(scale) || !std::isfinite(offset))
     {
-        return getDataPoint(0);
-    }
-    else
-    {
-        throw std::out_of_range("getOldestDataPoint called on empty TimeSeries");
+        qWarning() << "Invalid time scaling:" << scale << offset;
+        return;
     }
-}
 
+    scaling_mutex.lock();
 
-double DataSeries::getOldestTimestamp() const
-{
-    return getOldestDataPoint().timestamp;
-}
+    Scaling updated = getScaling();
 
+    const bool changed = scale != updated.timeScale || offset != updated.timeOffset;
 
-double DataSeries::getOldestValue() const
-{
-    return getOldestDataPoint().value;
-}
+    updated.timeScale = scale;
+    updated.timeOffset = offset;
 
+    if (changed) setScaling(updated);
 
-const DataPoint DataSeries::getNewestDataPoint() const
-{
-    if (size() > 0)
-    {
-        return getDataPoint(size() - 1);
-    }
-    else
+    scaling_mutex.unlock();
+
+    if (!changed) return;
+
+    markChanged();
+
+    if (do_update)
     {
-        throw std::out_of_range("getNewestDataPoint called on empty TimeSeries");
+        update();
     }
 }
 
 
-double DataSeries::getNewestTimestamp() const
+/*
+ * Attach a filter to this DataSeries (or remove the filter, if f is nullptr).
+ * The filter must be set again (or update called) whenever it is modified, so the series is redrawn
+ */
+void DataSeries::setFilter(std::shared_ptr<DataSeriesFilter> f, bool do_update)
 {
-    return getNewestDataPoint().timestamp;
-}
+    std::atomic_store(&filter, f);
 
+    markChanged();
 
-double DataSeries::getNewestValue() const
-{
-    return getNewestDataPoint().value;
+    if (do_update)
+    {
+        update();
+    }
 }
 
 
-double DataSeries::getMinimumValue() const
+/*
+ * Load the samples of this DataSeries on demand, the first time it is read.
+ * Any existing samples are retained (the loaded samples are merged with them).
+ */
+void DataSeries::setLoader(Loader l)
 {
-    if (size() == 0) return 0.0;
-    return getMinimumValue(getOldestTimestamp(), getNewestTimestamp());
-}
+    load_mutex.lock();
 
+    loader = l;
+    loadPending.store((bool) loader);
 
-double DataSeries::getMinimumValue(double t_min, double t_max) const
-{
-    if (size() == 0) return 0;
+    load_mutex.unlock();
+}
 
-    auto idx_min = getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = getIndexForTimestamp(t_max, SEARCH_RIGHT_TO_LEFT);
 
-    double value = __DBL_MAX__;
+/*
+ * Produce the samples of a series which is loaded on demand (this has no effect once the series is loaded).
+ * Readers load the series implicitly (see getSnapshot). Concurrent readers wait until the samples
+ * have been added, so no reader can observe a partially loaded series.
+ */
+void DataSeries::load() const
+{
+    if (!loadPending.load()) return;
 
-    unsigned int length = size();
+    load_mutex.lock();
 
-    for (auto idx = idx_min + 1; idx <= idx_max && idx < size(); idx++)
+    // Another reader may have loaded the series while this one was waiting
+    if (loadPending.load())
     {
-        if (idx >= length) continue;
+        // Loading does not change the logical contents of the series
+        DataSeries* series = const_cast<DataSeries*>(this);
 
-        double v = getValue(idx);
+        std::vector<double> t;
+        std::vector<double> v;
 
-        if (v < value)
+        Loader pending;
+        std::swap(pending, loader);
+
+        if (!pending(t, v))
         {
-            value = v;
+            qWarning() << "Could not load series" << label;
+
+            t.clear();
+            v.clear();
         }
-    }
 
-    return value;
-}
+        series->addData(t, v, false);
 
+        loadPending.store(false);
+    }
 
-double DataSeries::getMaximumValue() const
-{
-    if (size() == 0) return 0.0;
-    return getMaximumValue(getOldestTimestamp(), getNewestTimestamp());
+    load_mutex.unlock();
 }
 
 
-double DataSeries::getMaximumValue(double t_min, double t_max) const
+/*
+ * Select the storage precision used for the values in this DataSeries.
+ * Any existing samples are converted to the new precision.
+ *
+ * Single precision storage halves the memory required for the value column,
+ * at the cost of ~7 significant digits of resolution.
+ */
+void DataSeries::setValuePrecision(ValuePrecision precision)
 {
-    if (size() == 0) return 0;
-
-    auto idx_min = getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = getIndexForTimestamp(t_max, SEARCH_RIGHT_TO_LEFT);
+    data_mutex.lock();
 
-    double value = __DBL_MIN__;
+    valuePrecision = precision;
 
-    unsigned int length = size();
+    auto table = std::make_shared<DataBlockTable>(*blockTable);
 
-    for (auto idx = idx_min + 1; idx <= idx_max && idx < size(); idx++)
+    for (auto& block : table->blocks)
     {
-        if (idx >= length) continue;
+        block = std::make_shared<DataBlock>(*block, block->getCapacity(), precision == SINGLE_PRECISION);
+    }
 
-        double v = getValue(idx);
+    encodeBlocks(*table);
 
-        if (v > value)
-        {
-            value = v;
-        }
-    }
+    publishBlockTable(table);
+
+    data_mutex.unlock();
+
+    markChanged();
 
-    return value;
+    update();
 }
 
 
-double DataSeries::getValueAtTime(double timestamp, InterpolationMode mode) const
+/*
+ * Select the store used for sample data in this DataSeries (nullptr for heap storage).
+ * Any existing samples are moved to the new store.
+ */
+void DataSeries::setDataStore(std::shared_ptr<DataStore> store)
 {
-    if (size() == 0)
-    {
-        return 0;
-    }
+    data_mutex.lock();
 
-    auto idx = getIndexForTimestamp(timestamp);
+    dataStore = store;
 
-    // Time is "before" the oldest timestamp
-    if (idx <= 0)
-    {
-        return getOldestValue();
-    }
+    auto table = std::make_shared<DataBlockTable>(*blockTable);
 
-    // Time is "after" the newest timestamp
-    if (idx >= size())
+    for (auto& block : table->blocks)
     {
-        return getNewestValue();
+        block = std::make_shared<DataBlock>(*block, block->getCapacity(), block->isSinglePrecision(), store);
     }
 
-    // Interpolate
-    auto point_a = getDataPoint(idx - 1);
-    auto point_b = getDataPoint(idx);
+    encodeBlocks(*table);
 
-    switch (mode)
-    {
-    case INTERPOLATE:
-        {
-            double dt = point_b.timestamp - point_a.timestamp;
-            double dv = point_b.value - point_a.value;
+    publishBlockTable(table);
 
-            return point_a.value + dv * (timestamp - point_a.timestamp) / dt;
-        }
-    case SAMPLE_HOLD:
-    default:
-        {
-            // Simply return the previous "most recent" value
-            return point_a.value;
-        }
-    }
+    data_mutex.unlock();
 }
 
 
-double DataSeries::getMeanValue(void) const
+/*
+ * Return the memory used by the samples of this DataSeries (see DataMemoryUsage).
+ * A series which is loaded on demand is not loaded to measure it.
+ */
+DataMemoryUsage DataSeries::getMemoryUsage() const
 {
-    if (size() == 0) return 0.0;
-    return getMeanValue(getOldestTimestamp(), getNewestTimestamp());
+    if (loadPending.load()) return DataMemoryUsage();
+
+    DataMemoryUsage usage = DataSnapshot(std::atomic_load(&blockTable), 1, 0).getMemoryUsage();
+
+    usage.index += stagedCount.load() * sizeof(DataPoint);
+
+    return usage;
 }
 
 
-double DataSeries::getMeanValue(double t_min, double t_max) const
+void DataSeries::releaseCaches()
 {
-    if (size() == 0) return 0;
+    auto table = std::atomic_load(&blockTable);
+
+    for (const auto& block : table->blocks)
+    {
+        block->releaseDecodedColumns();
+    }
+}
 
-    auto idx_min = getIndexForTimestamp(t_min, SEARCH_RIGHT_TO_LEFT);
-    auto idx_max = getIndexForTimestamp(t_max, SEARCH_RIGHT_TO_LEFT);
 
-    double accumulator = 0;
-    unsigned int count = 0;
+/*
+ * Enable or disable compressed storage for this DataSeries.
+ *
+ * When enabled, each block is compressed once it is full (the final block, which
+ * is still being appended to, is never compressed). Compression is lossless, and
+ * typically reduces memory use several times over for regularly sampled data.
+ * Compressed blocks are decoded on demand, when their samples are accessed.
+ */
+void DataSeries::setCompressionEnabled(bool enabled)
+{
+    data_mutex.lock();
+
+    compressionEnabled = enabled;
 
-    unsigned int length = size();
+    auto table = std::make_shared<DataBlockTable>(*blockTable);
 
-    for (size_t idx = idx_min; idx <= idx_max && idx < size(); idx++)
+    if (enabled)
+    {
+        encodeBlocks(*table);
+    }
+    else
     {
-        if (idx < length)
+        for (auto& block : table->blocks)
         {
-            accumulator += getValue(idx);
-            count += 1;
+            if (block->isCompressed())
+            {
+                block = std::make_shared<DataBlock>(*block, DataBlock::ENCODING_UNIFORM);
+            }
         }
     }
 
-    if (count == 0)
-    {
-        // Prevent divide-by-zero errors
-        return 0;
-    }
+    publishBlockTable(table);
 
-    return accumulator / count;
+    data_mutex.unlock();
 }
 
 
-uint64_t DataSeries::getIndexForTimestamp(double t, SearchDirection direction) const
+/**
+ * @brief DataSeries::shareTimestamps - Share the timestamp columns of another series (e.g. another column
+ * of the same table), for each full block whose timestamps are identical to the corresponding block of the
+ * other series. The samples of this series are unchanged, but only one copy of the timestamps is stored.
+ *
+ * Blocks are compared in order, for as long as the blocks of both series start at the same index.
+ * Blocks which are later copied (e.g. by setValuePrecision) store their own timestamps again.
+ *
+ * @param reference is the series whose timestamps are shared
+ * @return the number of blocks which now share the timestamps of the reference
+ */
+size_t DataSeries::shareTimestamps(const DataSeries& reference)
 {
-    if (size() == 0) return 0;
+    if (&reference == this) return 0;
 
-    if (t < getOldestTimestamp())
-    {
-        return 0;
-    }
+    const auto other = std::atomic_load(&reference.blockTable);
+
+    data_mutex.lock();
+
+    auto table = std::make_shared<DataBlockTable>(*blockTable);
 
-    else if (t > getNewestTimestamp())
+    size_t shared = 0;
+
+    for (size_t ii = 0; ii < table->blocks.size() && ii < other->blocks.size(); ii++)
     {
-        return size();
-    }
+        if (table->offsets[ii] != other->offsets[ii]) break;
+
+        auto& block = table->blocks[ii];
+        const auto& source = other->blocks[ii];
+
+        if (block->canShareTimestamps(*source))
+        {
+            block = std::make_shared<DataBlock>(*block, source);
+            shared++;
+        }
+    }
+
+    if (shared > 0)
+    {
+        publishBlockTable(table);
+    }
+
+    data_mutex.unlock();
+
+    return shared;
+}
+
+
+/*
+ * Return true if any full block of this series stores its own timestamp column (which could be shared, see shareTimestamps)
+ */
+bool DataSeries::hasTimestampColumns() const
+{
+    const auto table = std::atomic_load(&blockTable);
+
+    for (const auto& block : table->blocks)
+    {
+        if (block->isFull() && block->hasTimestampColumn()) return true;
+    }
+
+    return false;
+}
+
+
+/*
+ * Encode any full blocks in an (unpublished) table (see encodeBlock)
+ */
+void DataSeries::encodeBlocks(DataBlockTable& table) const
+{
+    for (size_t ii = 0; ii + 1 < table.blocks.size(); ii++)
+    {
+        encodeBlock(table.blocks[ii]);
+    }
+}
+
+
+/*
+ * Encode a full block, which will not be appended to again:
+ * - If the samples are evenly spaced, the timestamp column is discarded
+ * - If compression is enabled, the remaining columns are compressed
+ */
+void DataSeries::encodeBlock(DataBlockPointer& block) const
+{
+    if (!block->isFull()) return;
+
+    if (compressionEnabled && !block->isCompressed())
+    {
+        block = std::make_shared<DataBlock>(*block, DataBlock::ENCODING_COMPRESSED);
+    }
+    else if (!compressionEnabled && !block->isCompressed() && !block->hasUniformTimestamps() && block->isEvenlySpaced())
+    {
+        block = std::make_shared<DataBlock>(*block, DataBlock::ENCODING_UNIFORM);
+    }
+}
+
+
+/*
+ * Calculate the bounds of this DataSeries (the timespan and the range of values).
+ * Returns a QRectF instance, with top() as the minimum value and bottom() as the maximum value
+ */
+QRectF DataSeries::getBounds() const
+{
+    double min = 0;
+    double max = 0;
+
+    if (!getValueRange(min, max)) return QRectF();
+
+    const double t_oldest = getOldestTimestamp();
+    const double t_newest = getNewestTimestamp();
+
+    return QRectF(t_oldest, min, t_newest - t_oldest, max - min);
+}
+
+
+/**
+ * @brief DataSeries::getValueRange - Return the range of (scaled) values of every sample.
+ *
+ * The range of the raw values is retained, along with the snapshot it describes. When samples
+ * have only been appended since, only the new samples are summarised, so the range is maintained
+ * at the cost of the appended samples rather than the whole series. Clipping or clearing the series
+ * discards the retained range.
+ *
+ * @param min - Set to the minimum value
+ * @param max - Set to the maximum value
+ * @return false if the series has no samples
+ */
+bool DataSeries::getValueRange(double& min, double& max) const
+{
+    const DataSnapshot snapshot = getSnapshot();
+
+    if (snapshot.isEmpty()) return false;
+
+    const DataSnapshot raw = snapshot.getUnscaled();
+
+    bounds_mutex.lock();
+
+    if (!raw.isIdentical(boundsSnapshot))
+    {
+        uint64_t idx_first = 0;
+        uint64_t idx_last = 0;
+
+        // Every sample of the previous snapshot is retained, so only the appended samples are summarised
+        if (raw.getCommonRange(boundsSnapshot, idx_first, idx_last) && idx_first == 0 && idx_last == boundsSnapshot.size())
+        {
+            if (idx_last < raw.size())
+            {
+                const auto stats = raw.getStatistics(idx_last, raw.size());
+
+                boundsMin = std::min(boundsMin, stats.min);
+                boundsMax = std::max(boundsMax, stats.max);
+            }
+        }
+        else
+        {
+            const auto stats = raw.getStatistics(0, raw.size());
+
+            boundsMin = stats.min;
+            boundsMax = stats.max;
+        }
+
+        boundsSnapshot = raw;
+    }
+
+    const double raw_min = boundsMin;
+    const double raw_max = boundsMax;
+
+    bounds_mutex.unlock();
+
+    // A negative scaler swaps the extreme values
+    min = snapshot.applyScaling(snapshot.getScaler() < 0 ? raw_max : raw_min);
+    max = snapshot.applyScaling(snapshot.getScaler() < 0 ? raw_min : raw_max);
+
+    return true;
+}
+
+
+/*
+ * Discard the retained range of values (e.g. after samples have been removed)
+ */
+void DataSeries::invalidateBounds()
+{
+    QMutexLocker lock(&bounds_mutex);
+
+    boundsSnapshot = DataSnapshot();
+}
+
+
+std::vector<DataPoint> DataSeries::getData(void) const
+{
+    auto view = getView();
+
+    return std::vector<DataPoint>(view.begin(), view.end());
+}
+
+
+/*
+ * Return a copy of the samples with timestamps in the range [t_min, t_max].
+ * Note: prefer getView() which does not copy the samples
+ */
+std::vector<DataPoint> DataSeries::getData(double t_min, double t_max) const
+{
+    auto view = getView(t_min, t_max);
+
+    return std::vector<DataPoint>(view.begin(), view.end());
+}
+
+
+/*
+ * Return a view of all samples in this DataSeries
+ */
+DataView DataSeries::getView(void) const
+{
+    return getSnapshot().getView();
+}
+
+
+/*
+ * Return a view of the samples with timestamps in the range [t_min, t_max]
+ */
+DataView DataSeries::getView(double t_min, double t_max) const
+{
+    // Ensure that the timestamps are the right way around!
+    if (t_min > t_max)
+    {
+        double swap = t_min;
+
+        t_min = t_max;
+        t_max = swap;
+    }
+
+    auto snapshot = getSnapshot();
+
+    return snapshot.getView(snapshot.lowerBound(t_min), snapshot.upperBound(t_max));
+}
+
+
+const DataPoint DataSeries::getDataPoint(uint64_t idx) const
+{
+    return getSnapshot().getDataPoint(idx);
+}
+
+
+double DataSeries::getTimestamp(uint64_t idx) const
+{
+    return getDataPoint(idx).timestamp;
+}
+
+
+double DataSeries::getValue(uint64_t idx) const
+{
+    return getDataPoint(idx).value;
+}
+
+
+/*
+ * Insert a new sample into this DataSeries.
+ *
+ * If the timestamp is "newer" than the most recent point in the series,
+ * the new sample is simply appended to the dataset.
+ * (This is a much more efficient operation).
+ *
+ * Otherwise, the sample is staged, and merged into the series with any other
+ * late samples (see mergeStagedSamples). This avoids copying a block for every
+ * out-of-order sample, which is very expensive for jittery or interleaved logs.
+ */
+void DataSeries::addData(DataPoint point, bool do_update)
+{
+    // Ignore NaN values
+    if (isnan(point.value)) return;
+
+    // Ignore inf values
+    if (isinf(point.value)) return;
+
+    data_mutex.lock();
+
+    const auto& blocks = blockTable->blocks;
+
+    // If the new datapoint is of equal or greater timestamp value, simply append!
+    if (blocks.empty() || point.timestamp >= blocks.back()->getLastTimestamp())
+    {
+        appendSamples(&point.timestamp, &point.value, 1);
+    }
+    else
+    {
+        stagedSamples.push_back(point);
+        stagedCount.store(stagedSamples.size());
+
+        if (stagedSamples.size() >= STAGING_CAPACITY)
+        {
+            mergeStagedSamples();
+        }
+    }
+
+    applyRetention();
+
+    data_mutex.unlock();
+
+    markChanged(point.timestamp, point.timestamp);
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+/*
+ * Add a single data point to the series
+ */
+void DataSeries::addData(double t, double value, bool do_update)
+{
+    addData(DataPoint(t, value), do_update);
+}
+
+
+/*
+ * Insert a batch of samples into this DataSeries.
+ *
+ * This is much more efficient than adding samples individually:
+ * - The data mutex is only locked once for the entire batch
+ * - Non-finite values are discarded in a single pass
+ * - If the batch is not in timestamp order, it is sorted once
+ * - If the batch overlaps existing data, only the blocks which overlap the batch are rewritten
+ */
+void DataSeries::addData(const double *t, const double *v, size_t count, bool do_update)
+{
+    if (count == 0) return;
+
+    std::vector<double> t_batch(count);
+    std::vector<double> v_batch(count);
+
+    // Discard NaN and inf values (branch-free, so the compiler can vectorize the loop)
+    size_t n = 0;
+    bool ordered = true;
+
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        t_batch[n] = t[idx];
+        v_batch[n] = v[idx];
+
+        // (x - x) is NaN for both NaN and inf
+        n += (v[idx] - v[idx]) == 0;
+    }
+
+    t_batch.resize(n);
+    v_batch.resize(n);
+
+    if (n == 0) return;
+
+    for (size_t idx = 1; idx < n; idx++)
+    {
+        ordered &= t_batch[idx] >= t_batch[idx - 1];
+    }
+
+    // Sort the batch by timestamp, preserving the order of samples with equal timestamps
+    if (!ordered)
+    {
+        std::vector<size_t> order(n);
+
+        for (size_t idx = 0; idx < n; idx++)
+        {
+            order[idx] = idx;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&t_batch](size_t a, size_t b) {
+            return t_batch[a] < t_batch[b];
+        });
+
+        std::vector<double> t_sorted(n);
+        std::vector<double> v_sorted(n);
+
+        for (size_t idx = 0; idx < n; idx++)
+        {
+            t_sorted[idx] = t_batch[order[idx]];
+            v_sorted[idx] = v_batch[order[idx]];
+        }
+
+        t_batch.swap(t_sorted);
+        v_batch.swap(v_sorted);
+    }
+
+    data_mutex.lock();
+
+    const auto& blocks = blockTable->blocks;
+
+    if (blocks.empty() || t_batch.front() >= blocks.back()->getLastTimestamp())
+    {
+        // Simple case - entire batch is appended
+        appendSamples(t_batch.data(), v_batch.data(), n);
+    }
+    else
+    {
+        mergeSamples(t_batch.data(), v_batch.data(), n);
+    }
+
+    applyRetention();
+
+    data_mutex.unlock();
+
+    markChanged(t_batch.front(), t_batch.back());
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+/*
+ * Insert a batch of samples into this DataSeries.
+ * The timestamp and value vectors must be the same length.
+ */
+void DataSeries::addData(const std::vector<double> &t, const std::vector<double> &v, bool do_update)
+{
+    if (t.size() != v.size())
+    {
+        qWarning() << "DataSeries::addData - timestamp and value counts do not match:" << t.size() << v.size();
+    }
+
+    addData(t.data(), v.data(), std::min(t.size(), v.size()), do_update);
+}
+
+
+/*
+ * Discard the samples outside the range [t_min, t_max] (see setTimeWindow to hide them instead)
+ */
+void DataSeries::clipTimeRange(double t_min, double t_max, bool do_update)
+{
+    // Ensure that the timestamps are the right way around!
+    if (t_min > t_max)
+    {
+        double swap = t_min;
+
+        t_min = t_max;
+        t_max = swap;
+    }
+
+    // Loading adds the samples (which requires the data mutex)
+    load();
+
+    data_mutex.lock();
+
+    // Staged samples within the range are retained
+    mergeStagedSamples();
+
+    // The time window does not apply to the stored samples
+    const DataSnapshot stored = getStoredSnapshot();
+
+    auto idx_min = stored.lowerBound(t_min);
+    auto idx_max = stored.upperBound(t_max);
+
+    // Discard any samples outside the range [idx_min, idx_max)
+    publishBlockTable(copyRange(idx_min, idx_max));
+
+    data_mutex.unlock();
+
+    invalidateBounds();
+    markChanged();
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+/**
+ * @brief DataSeries::setTimeWindow - Restrict the samples which are read from the series to t_min <= t <= t_max
+ * (aligned time). The stored samples are not modified, so the window can be changed or removed (see clearTimeWindow).
+ */
+void DataSeries::setTimeWindow(double t_min, double t_max, bool do_update)
+{
+    // Ensure that the timestamps are the right way around!
+    if (t_min > t_max)
+    {
+        std::swap(t_min, t_max);
+    }
+
+    const Scaling s = getScaling();
+
+    const double start = (t_min - s.timeOffset) / s.timeScale;
+    const double end = (t_max - s.timeOffset) / s.timeScale;
+
+    if (start == windowStart && end == windowEnd) return;
+
+    windowStart = start;
+    windowEnd = end;
+
+    invalidateBounds();
+    markChanged();
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+void DataSeries::clearTimeWindow(bool do_update)
+{
+    if (!hasTimeWindow()) return;
+
+    windowStart = -std::numeric_limits<double>::infinity();
+    windowEnd = std::numeric_limits<double>::infinity();
+
+    std::atomic_store(&windowCache, std::shared_ptr<const WindowCache>());
+
+    invalidateBounds();
+    markChanged();
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+/*
+ * Discard the newest samples of the series, from the specified time onwards.
+ * Blocks before the cut are shared with the current table, so readers of the
+ * retained samples see no change (see DataSnapshot::getCommonRange).
+ */
+void DataSeries::truncate(double t, bool do_update)
+{
+    // Loading adds the samples (which requires the data mutex)
+    load();
+
+    data_mutex.lock();
+
+    mergeStagedSamples();
+
+    // The time window does not apply to the stored samples
+    const DataSnapshot stored = getStoredSnapshot();
+
+    auto idx_last = stored.lowerBound(t);
+
+    // Retain the samples [0, idx_last)
+    if (idx_last < stored.size())
+    {
+        publishBlockTable(copyRange(0, idx_last));
+    }
+
+    data_mutex.unlock();
+
+    invalidateBounds();
+    markChanged(t, std::numeric_limits<double>::infinity());
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+/*
+ * Limit the timespan of samples retained by this series, relative to the newest sample.
+ * A series with a retention limit behaves as a bounded ring buffer, so an unbounded live feed
+ * can be plotted indefinitely. A span of zero (the default) retains every sample.
+ */
+void DataSeries::setRetention(double span, bool do_update)
+{
+    data_mutex.lock();
+
+    retention = std::max(span, 0.0);
+
+    applyRetention();
+
+    data_mutex.unlock();
+
+    markChanged();
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+/*
+ * Discard the oldest blocks, once every sample they contain has expired (data mutex must be held).
+ *
+ * Samples are discarded a whole block at a time: the remaining blocks are shared with the
+ * previous table, so no samples are copied, and the storage of the expired blocks is released
+ * once no snapshot refers to them. Up to one block of expired samples may be retained.
+ */
+void DataSeries::applyRetention()
+{
+    if (retention <= 0) return;
+
+    const auto& blocks = blockTable->blocks;
+
+    // The final block is never discarded
+    if (blocks.size() < 2) return;
+
+    const double cutoff = blocks.back()->getLastTimestamp() - retention;
+
+    size_t expired = 0;
+
+    while (expired + 1 < blocks.size() && blocks[expired]->getLastTimestamp() < cutoff)
+    {
+        expired++;
+    }
+
+    if (expired == 0) return;
+
+    const Scaling s = getScaling();
+
+    markChanged(-std::numeric_limits<double>::infinity(), blocks[expired - 1]->getLastTimestamp() * s.timeScale + s.timeOffset);
+
+    auto table = std::make_shared<DataBlockTable>();
+
+    table->blocks.assign(blocks.begin() + expired, blocks.end());
+    table->updateOffsets();
+
+    publishBlockTable(table);
+}
+
+
+/*
+ * Merge any staged (out-of-order) samples into the series.
+ * Importers should call this once an import is complete; otherwise the merge
+ * happens when the staging buffer fills, or when the series is next read.
+ */
+void DataSeries::flush(bool do_update)
+{
+    data_mutex.lock();
+
+    bool merged = !stagedSamples.empty();
+
+    mergeStagedSamples();
+
+    data_mutex.unlock();
+
+    if (do_update && merged)
+    {
+        update();
+    }
+}
+
+
+void DataSeries::clearData(bool do_update)
+{
+    // A series which has not been loaded yet is discarded unread
+    load_mutex.lock();
+
+    loader = Loader();
+    loadPending.store(false);
+
+    load_mutex.unlock();
+
+    data_mutex.lock();
+
+    stagedSamples.clear();
+    stagedCount.store(0);
+
+    publishBlockTable(std::make_shared<DataBlockTable>());
+
+    data_mutex.unlock();
+
+    invalidateBounds();
+    markChanged();
+
+    if (do_update)
+    {
+        update();
+    }
+}
+
+
+const DataPoint DataSeries::getOldestDataPoint() const
+{
+    auto snapshot = getSnapshot();
+
+    if (snapshot.size() > 0)
+    {
+        return snapshot.getDataPoint(0);
+    }
+    else
+    {
+        throw std::out_of_range("getOldestDataPoint called on empty TimeSeries");
+    }
+}
+
+
+double DataSeries::getOldestTimestamp() const
+{
+    return getOldestDataPoint().timestamp;
+}
+
+
+double DataSeries::getOldestValue() const
+{
+    return getOldestDataPoint().value;
+}
+
+
+const DataPoint DataSeries::getNewestDataPoint() const
+{
+    auto snapshot = getSnapshot();
+
+    if (snapshot.size() > 0)
+    {
+        return snapshot.getDataPoint(snapshot.size() - 1);
+    }
+    else
+    {
+        throw std::out_of_range("getNewestDataPoint called on empty TimeSeries");
+    }
+}
+
+
+double DataSeries::getNewestTimestamp() const
+{
+    return getNewestDataPoint().timestamp;
+}
+
+
+double DataSeries::getNewestValue() const
+{
+    return getNewestDataPoint().value;
+}
+
+
+/*
+ * Range statistics (min / max / mean / standard deviation) are calculated from the
+ * summary pyramid of each block, so the cost is proportional to the number of
+ * blocks spanned by the range, rather than the number of samples.
+ * Samples with timestamps in the range [t_min, t_max] (inclusive) are considered.
+ */
+DataSnapshot::Statistics DataSeries::getStatistics() const
+{
+    auto snapshot = getSnapshot();
+
+    return snapshot.getStatistics(0, snapshot.size());
+}
+
+
+DataSnapshot::Statistics DataSeries::getStatistics(double t_min, double t_max) const
+{
+    // Ensure that the timestamps are the right way around!
+    if (t_min > t_max)
+    {
+        double swap = t_min;
+
+        t_min = t_max;
+        t_max = swap;
+    }
+
+    auto snapshot = getSnapshot();
+
+    return snapshot.getStatistics(snapshot.lowerBound(t_min), snapshot.upperBound(t_max));
+}
+
+
+double DataSeries::getMinimumValue() const
+{
+    double min = 0;
+    double max = 0;
+
+    getValueRange(min, max);
+
+    return min;
+}
+
+
+double DataSeries::getMinimumValue(double t_min, double t_max) const
+{
+    return getStatistics(t_min, t_max).min;
+}
+
+
+double DataSeries::getMaximumValue() const
+{
+    double min = 0;
+    double max = 0;
+
+    getValueRange(min, max);
+
+    return max;
+}
+
+
+double DataSeries::getMaximumValue(double t_min, double t_max) const
+{
+    return getStatistics(t_min, t_max).max;
+}
+
+
+double DataSeries::getValueAtTime(double timestamp, InterpolationMode mode) const
+{
+    // Note: for a sequence of lookups, use a cursor (see getCursor)
+    DataCursor cursor = getCursor();
+
+    switch (mode)
+    {
+    case INTERPOLATE:
+        return cursor.interpolate(timestamp);
+    case SAMPLE_HOLD:
+    default:
+        // Simply return the previous "most recent" value
+        return cursor.sampleHold(timestamp);
+    }
+}
+
+
+double DataSeries::getMeanValue(void) const
+{
+    return getStatistics().getMean();
+}
+
+
+double DataSeries::getMeanValue(double t_min, double t_max) const
+{
+    return getStatistics(t_min, t_max).getMean();
+}
+
+
+double DataSeries::getStdDevValue(void) const
+{
+    return getStatistics().getStdDev();
+}
+
+
+double DataSeries::getStdDevValue(double t_min, double t_max) const
+{
+    return getStatistics(t_min, t_max).getStdDev();
+}
+
+
+uint64_t DataSeries::getIndexForTimestamp(double t, SearchDirection direction) const
+{
+    auto snapshot = getRawSnapshot();
 
     if (direction == SEARCH_LEFT_TO_RIGHT)
     {
-        auto upper= std::upper_bound(data.begin(), data.end(), t);
-        return std::distance(data.begin(), upper);
+        return snapshot.upperBound(t);
+    }
+    else
+    {
+        return snapshot.lowerBound(t);
+    }
+}
+
+
+/*
+ * Atomically replace the published block table.
+ * Readers which already hold a snapshot of the previous table are unaffected.
+ */
+void DataSeries::publishBlockTable(std::shared_ptr<DataBlockTable> table)
+{
+    std::atomic_store(&blockTable, DataBlockTablePointer(table));
+}
+
+
+/*
+ * Append multiple samples to the end of the series.
+ * It is the responsibility of the caller to ensure that the timestamps are in order.
+ *
+ * If the samples fit within the allocated capacity of the final block, they are
+ * appended in place, and become visible to readers without publishing a new table.
+ */
+void DataSeries::appendSamples(const double* t, const double* v, size_t count)
+{
+    const auto& blocks = blockTable->blocks;
+
+    if (!blocks.empty() && blocks.back()->getCapacity() - blocks.back()->size() >= count)
+    {
+        blocks.back()->append(t, v, count);
+        return;
+    }
+
+    auto table = std::make_shared<DataBlockTable>(*blockTable);
+
+    appendSamples(*table, t, v, count);
+
+    publishBlockTable(table);
+}
+
+
+/*
+ * Append multiple samples to the end of an (unpublished) block table.
+ * - A new block is started when the final block is full
+ * - A final block which has run out of allocated space is replaced by a larger copy
+ */
+void DataSeries::appendSamples(DataBlockTable& table, const double* t, const double* v, size_t count) const
+{
+    const bool single = valuePrecision == SINGLE_PRECISION;
+
+    while (count > 0)
+    {
+        if (table.blocks.empty() || table.blocks.back()->isFull())
+        {
+            // Small series start with a small allocation
+            size_t capacity = table.blocks.empty() ? DataBlock::INITIAL_CAPACITY : DataBlock::CAPACITY;
+
+            // The previous block will not be appended to again
+            if (!table.blocks.empty())
+            {
+                encodeBlock(table.blocks.back());
+            }
+
+            table.offsets.push_back(table.size());
+            table.blocks.push_back(std::make_shared<DataBlock>(std::max(capacity, count), single, dataStore));
+        }
+        else if (!table.blocks.back()->hasSpace())
+        {
+            const DataBlock& tail = *table.blocks.back();
+
+            table.blocks.back() = std::make_shared<DataBlock>(tail, std::max(tail.getCapacity() * 2, tail.size() + count));
+        }
+
+        size_t n = table.blocks.back()->append(t, v, count);
+
+        t += n;
+        v += n;
+        count -= n;
+    }
+}
+
+
+/*
+ * Merge samples (in timestamp order) into the series.
+ * Only the blocks which the samples fall within are rewritten; all other blocks are shared
+ * with the current table, and the merged table is published once.
+ *
+ * Each sample belongs to the first block whose final timestamp is greater than its own
+ * (or to the final block). Existing samples take priority over new samples with the same timestamp.
+ */
+void DataSeries::mergeSamples(const double* t, const double* v, size_t count)
+{
+    // Hold a reference to the current table, as it is replaced below
+    DataBlockTablePointer current = blockTable;
+
+    const auto& blocks = current->blocks;
+
+    const bool single = valuePrecision == SINGLE_PRECISION;
+
+    auto table = std::make_shared<DataBlockTable>();
+
+    table->blocks.reserve(blocks.size() + 1);
+
+    std::vector<double> t_merged;
+    std::vector<double> v_merged;
+
+    size_t jj = 0;
+
+    for (size_t ii = 0; ii < blocks.size(); ii++)
+    {
+        const DataBlockPointer& block = blocks[ii];
+        const bool is_tail = ii + 1 == blocks.size();
+
+        size_t end = is_tail ? count : std::lower_bound(t + jj, t + count, block->getLastTimestamp()) - t;
+
+        if (end == jj)
+        {
+            table->blocks.push_back(block);
+            continue;
+        }
+
+        const size_t length = block->size();
+
+        t_merged.clear();
+        v_merged.clear();
+
+        t_merged.reserve(length + end - jj);
+        v_merged.reserve(length + end - jj);
+
+        DataBlock::Columns columns = block->getColumns(false);
+
+        size_t local = 0;
+
+        while (local < length || jj < end)
+        {
+            if (local < length && (jj >= end || columns.getTimestamp(local) <= t[jj]))
+            {
+                t_merged.push_back(columns.getTimestamp(local));
+                v_merged.push_back(columns.getValue(local));
+                local++;
+            }
+            else
+            {
+                t_merged.push_back(t[jj]);
+                v_merged.push_back(v[jj]);
+                jj++;
+            }
+        }
+
+        // Rewritten samples are split into full blocks, followed by any remainder
+        const size_t total = t_merged.size();
+
+        for (size_t first = 0; first < total; first += DataBlock::CAPACITY)
+        {
+            size_t n = std::min(total - first, DataBlock::CAPACITY);
+
+            // The final block retains its spare capacity, so that appending can continue in place
+            size_t capacity = (is_tail && first + n == total) ? std::max(block->getCapacity(), n) : n;
+
+            auto merged = std::make_shared<DataBlock>(capacity, single, dataStore);
+
+            merged->append(t_merged.data() + first, v_merged.data() + first, n);
+
+            if (!is_tail || first + n < total)
+            {
+                encodeBlock(merged);
+            }
+
+            table->blocks.push_back(merged);
+        }
+    }
+
+    table->updateOffsets();
+
+    // Series was empty
+    if (jj < count)
+    {
+        appendSamples(*table, t + jj, v + jj, count - jj);
+    }
+
+    publishBlockTable(table);
+}
+
+
+/*
+ * Merge the staging buffer into the series (see addData)
+ */
+void DataSeries::mergeStagedSamples()
+{
+    if (stagedSamples.empty()) return;
+
+    // Preserve the arrival order of samples with equal timestamps
+    std::stable_sort(stagedSamples.begin(), stagedSamples.end(), [](const DataPoint& a, const DataPoint& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    const size_t n = stagedSamples.size();
+
+    std::vector<double> t(n);
+    std::vector<double> v(n);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        t[idx] = stagedSamples[idx].timestamp;
+        v[idx] = stagedSamples[idx].value;
+    }
+
+    stagedSamples.clear();
+    stagedCount.store(0);
+
+    mergeSamples(t.data(), v.data(), n);
+}
+
+
+/*
+ * Construct a new (unpublished) block table containing only the samples in the index range [idx_first, idx_last).
+ * Blocks which lie entirely within the range are shared with the current table.
+ */
+std::shared_ptr<DataBlockTable> DataSeries::copyRange(uint64_t idx_first, uint64_t idx_last) const
+{
+    return copyRange(*blockTable, idx_first, idx_last, true);
+}
+
+
+/*
+ * Construct a new (unpublished) block table containing the samples in the index range [idx_first, idx_last)
+ * of the provided table (which may belong to another series).
+ *
+ * Blocks are immutable once they are no longer the final block of a series, so blocks which
+ * lie entirely within the range are shared rather than copied. The final block of the source
+ * may still be appended to in place; it is only shared if share_tail is set (i.e. when the new
+ * table replaces the source table in the same series).
+ */
+std::shared_ptr<DataBlockTable> DataSeries::copyRange(const DataBlockTable& current, uint64_t idx_first, uint64_t idx_last, bool share_tail) const
+{
+    auto table = std::make_shared<DataBlockTable>();
+
+    idx_last = std::min(idx_last, current.size());
+
+    if (idx_first >= idx_last)
+    {
+        return table;
+    }
+
+    for (size_t ii = current.getBlockForIndex(idx_first); ii < current.blocks.size() && current.offsets[ii] < idx_last; ii++)
+    {
+        const auto& block = current.blocks[ii];
+        const uint64_t base = current.offsets[ii];
+
+        const size_t length = current.getBlockLength(ii, current.size());
+
+        size_t first = idx_first > base ? idx_first - base : 0;
+        size_t last = std::min<uint64_t>(idx_last - base, length);
+
+        const bool is_tail = ii + 1 == current.blocks.size();
+
+        if (first == 0 && last == block->size() && (share_tail || !is_tail))
+        {
+            table->blocks.push_back(block);
+        }
+        else
+        {
+            table->blocks.push_back(std::make_shared<DataBlock>(*block, first, last, last - first));
+        }
+    }
+
+    table->updateOffsets();
+
+    return table;
+}
+
+
+DataSnapshot::DataSnapshot(DataBlockTablePointer blockTable, double s, double o, double ts, double to) :
+    table(blockTable),
+    scaler(s),
+    offset(o),
+    timeScale(ts),
+    timeOffset(to)
+{
+    if (table && !table->blocks.empty())
+    {
+        // The final block may still be growing, so its length is sampled exactly once
+        count = table->offsets.back() + table->blocks.back()->size();
+    }
+}
+
+
+const DataPoint DataSnapshot::getDataPoint(uint64_t idx) const
+{
+    if (idx >= count)
+    {
+        throw std::out_of_range("data index out of range");
+    }
+
+    auto block = table->getBlockForIndex(idx);
+    auto local = idx - table->offsets[block];
+
+    const DataBlock& b = *table->blocks[block];
+
+    return DataPoint(applyTimeScaling(b.getTimestamp(local)), b.getValue(local) * scaler + offset);
+}
+
+
+double DataSnapshot::getTimestamp(uint64_t idx) const
+{
+    return getDataPoint(idx).timestamp;
+}
+
+
+double DataSnapshot::getValue(uint64_t idx) const
+{
+    return getDataPoint(idx).value;
+}
+
+
+/*
+ * Return the index of the first sample with a timestamp >= t
+ * (or size() if there is no such sample)
+ */
+uint64_t DataSnapshot::lowerBound(double t) const
+{
+    if (count == 0) return 0;
+
+    t = removeTimeScaling(t);
+
+    const auto& blocks = table->blocks;
+
+    // Find the first block which contains a timestamp greater than or equal to t
+    size_t lo = 0;
+    size_t hi = blocks.size();
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (blocks[mid]->getLastTimestamp(getBlockLength(mid)) < t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo >= blocks.size()) return count;
+
+    return table->offsets[lo] + blocks[lo]->lowerBound(t, getBlockLength(lo));
+}
+
+
+/*
+ * Return the index of the first sample with a timestamp > t
+ * (or size() if there is no such sample)
+ */
+uint64_t DataSnapshot::upperBound(double t) const
+{
+    if (count == 0) return 0;
+
+    t = removeTimeScaling(t);
+
+    const auto& blocks = table->blocks;
+
+    // Find the first block which contains a timestamp greater than t
+    size_t lo = 0;
+    size_t hi = blocks.size();
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (blocks[mid]->getLastTimestamp(getBlockLength(mid)) <= t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo >= blocks.size()) return count;
+
+    return table->offsets[lo] + blocks[lo]->upperBound(t, getBlockLength(lo));
+}
+
+
+const DataPoint DataSnapshot::getNearestPoint(double t) const
+{
+    const uint64_t idx = lowerBound(t);
+
+    if (idx >= count) return getDataPoint(count - 1);
+    if (idx == 0) return getDataPoint(0);
+
+    const DataPoint before = getDataPoint(idx - 1);
+    const DataPoint after = getDataPoint(idx);
+
+    return (t - before.timestamp) <= (after.timestamp - t) ? before : after;
+}
+
+
+/**
+ * @brief DataSnapshot::getExtremePoint - Find the sample with the minimum (or maximum) value in the index range [idx_first, idx_last).
+ * The summary pyramid records the position of the extreme value of each bucket, so the sample is found
+ * without visiting the samples of any complete bucket.
+ * @param idx_first - Index of the first sample
+ * @param idx_last - Index one past the last sample
+ * @param maximum - Find the maximum (rather than the minimum) value
+ * @return the sample (scaled), or the sample at idx_first (if the range is empty)
+ */
+const DataPoint DataSnapshot::getExtremePoint(uint64_t idx_first, uint64_t idx_last, bool maximum) const
+{
+    DataPoint extreme;
+    bool found = false;
+
+    visitBuckets(idx_first, idx_last, DataBlock::SUMMARY_LEVELS - 1, [&](const Bucket& bucket) {
+        const DataPoint& point = maximum ? bucket.max : bucket.min;
+
+        if (!found || (maximum ? point.value > extreme.value : point.value < extreme.value))
+        {
+            extreme = point;
+            found = true;
+        }
+    });
+
+    if (!found && count > 0) return getDataPoint(std::min(idx_first, count - 1));
+
+    return extreme;
+}
+
+
+/*
+ * Calculate statistics for the samples in the index range [idx_first, idx_last)
+ */
+DataSnapshot::Statistics DataSnapshot::getStatistics(uint64_t idx_first, uint64_t idx_last) const
+{
+    Statistics stats;
+
+    idx_last = std::min(idx_last, count);
+
+    if (idx_first >= idx_last) return stats;
+
+    DataBlock::Summary total;
+    bool first_summary = true;
+
+    const auto& blocks = table->blocks;
+
+    for (size_t ii = table->getBlockForIndex(idx_first); ii < blocks.size() && table->offsets[ii] < idx_last; ii++)
+    {
+        const DataBlock& block = *blocks[ii];
+        const uint64_t base = table->offsets[ii];
+        const size_t length = getBlockLength(ii);
+        const bool sealed = ((ii + 1 < blocks.size()) || (length >= block.getCapacity())) && length == block.size();
+
+        size_t first = idx_first > base ? idx_first - base : 0;
+        size_t last = std::min<uint64_t>(idx_last - base, length);
+
+        block.visitSummary(first, last, DataBlock::SUMMARY_LEVELS - 1, length, sealed, [&](size_t, size_t, const DataBlock::Summary& summary) {
+            if (first_summary)
+            {
+                total = summary;
+                first_summary = false;
+            }
+            else
+            {
+                total.include(summary);
+            }
+        });
+    }
+
+    const double n = idx_last - idx_first;
+
+    stats.count = idx_last - idx_first;
+
+    // Apply scaler and offset: sum(s*v + o), and the deviations from the mean are scaled (the offset cancels)
+    stats.min = total.min * scaler + offset;
+    stats.max = total.max * scaler + offset;
+    stats.sum = total.sum * scaler + offset * n;
+    stats.m2 = total.m2 * scaler * scaler;
+
+    // A negative scaler swaps the extreme values
+    if (scaler < 0)
+    {
+        std::swap(stats.min, stats.max);
+    }
+
+    return stats;
+}
+
+
+/**
+ * @brief DataSnapshot::aggregate - Calculate statistics of the samples within each of a number of equal time buckets
+ * (e.g. one per pixel of a plot, or one per row of a resampled export).
+ *
+ * The samples of each bucket are located by binary search, and their statistics are read from the
+ * summary pyramid (see getStatistics), so the cost is O(buckets * log(n)), regardless of the number of samples.
+ *
+ * @param t_min is the start of the first bucket
+ * @param t_max is the end of the last bucket
+ * @param buckets is the number of buckets
+ * @param statistics are the statistics to calculate (see AggregateStatistic)
+ */
+DataSnapshot::Aggregate DataSnapshot::aggregate(double t_min, double t_max, size_t buckets, int statistics) const
+{
+    Aggregate result;
+
+    if (t_min > t_max) std::swap(t_min, t_max);
+
+    result.t_min = t_min;
+    result.t_max = t_max;
+    result.statistics = statistics;
+
+    if (buckets == 0 || !std::isfinite(t_min) || !std::isfinite(t_max)) return result;
+
+    result.buckets = buckets;
+    result.width = (t_max - t_min) / buckets;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    if (statistics & AGGREGATE_COUNT) result.count.assign(buckets, 0);
+    if (statistics & AGGREGATE_MIN) result.min.assign(buckets, nan);
+    if (statistics & AGGREGATE_MAX) result.max.assign(buckets, nan);
+    if (statistics & AGGREGATE_MEAN) result.mean.assign(buckets, nan);
+    if (statistics & AGGREGATE_STDDEV) result.stddev.assign(buckets, nan);
+    if (statistics & AGGREGATE_FIRST) result.first.assign(buckets, nan);
+    if (statistics & AGGREGATE_LAST) result.last.assign(buckets, nan);
+
+    // The summaries are only read if a statistic requires them
+    const bool summarise = (statistics & (AGGREGATE_MIN | AGGREGATE_MAX | AGGREGATE_MEAN | AGGREGATE_STDDEV)) != 0;
+
+    uint64_t idx_first = lowerBound(t_min);
+
+    for (size_t ii = 0; ii < buckets && idx_first < count; ii++)
+    {
+        const uint64_t idx_last = ii + 1 == buckets ? upperBound(t_max) : lowerBound(t_min + (ii + 1) * result.width);
+
+        if (idx_last <= idx_first) continue;
+
+        if (statistics & AGGREGATE_COUNT) result.count[ii] = idx_last - idx_first;
+        if (statistics & AGGREGATE_FIRST) result.first[ii] = getValue(idx_first);
+        if (statistics & AGGREGATE_LAST) result.last[ii] = getValue(idx_last - 1);
+
+        if (summarise)
+        {
+            const Statistics stats = getStatistics(idx_first, idx_last);
+
+            if (statistics & AGGREGATE_MIN) result.min[ii] = stats.min;
+            if (statistics & AGGREGATE_MAX) result.max[ii] = stats.max;
+            if (statistics & AGGREGATE_MEAN) result.mean[ii] = stats.getMean();
+            if (statistics & AGGREGATE_STDDEV) result.stddev[ii] = stats.getStdDev();
+        }
+
+        idx_first = idx_last;
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief DataSnapshot::Statistics::include - Combine with the statistics of another (disjoint) range of samples
+ */
+void DataSnapshot::Statistics::include(const Statistics& other)
+{
+    if (other.count == 0) return;
+
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    // Pairwise combination of the squared deviations (see DataBlock::Summary)
+    const double delta = other.getMean() - getMean();
+    const double n = count;
+    const double n_other = other.count;
+
+    m2 += other.m2 + delta * delta * n * n_other / (n + n_other);
+
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+}
+
+
+double DataSnapshot::Statistics::getVariance() const
+{
+    return count > 0 ? std::max(0.0, m2 / count) : 0;
+}
+
+
+double DataSnapshot::Statistics::getStdDev() const
+{
+    return sqrt(getVariance());
+}
+
+
+double DataSnapshot::Statistics::getRms() const
+{
+    if (count == 0) return 0;
+
+    const double mean = getMean();
+
+    return sqrt(getVariance() + mean * mean);
+}
+
+
+DataView DataSnapshot::getView(void) const
+{
+    return DataView(*this, 0, count);
+}
+
+
+/*
+ * Return a view of the samples in the index range [idx_first, idx_last)
+ */
+DataView DataSnapshot::getView(uint64_t idx_first, uint64_t idx_last) const
+{
+    return DataView(*this, idx_first, idx_last);
+}
+
+
+DataView::DataView(const DataSnapshot &s, uint64_t idx_first, uint64_t idx_last) :
+    snapshot(s),
+    first(std::min(idx_first, s.size())),
+    last(std::min(idx_last, s.size()))
+{
+    if (last < first)
+    {
+        last = first;
+    }
+}
+
+
+const DataPoint DataView::getDataPoint(uint64_t idx) const
+{
+    if (idx >= size())
+    {
+        throw std::out_of_range("view index out of range");
+    }
+
+    return snapshot.getDataPoint(first + idx);
+}
+
+
+DataView::const_iterator DataView::begin() const
+{
+    if (isEmpty()) return end();
+
+    const_iterator it;
+
+    it.table = snapshot.table.get();
+    it.count = snapshot.count;
+    it.scaler = snapshot.scaler;
+    it.offset = snapshot.offset;
+    it.timeScale = snapshot.timeScale;
+    it.timeOffset = snapshot.timeOffset;
+
+    it.block = it.table->getBlockForIndex(first);
+    it.columns = it.table->blocks[it.block]->getColumns(false);
+    it.length = it.table->getBlockLength(it.block, it.count);
+    it.local = first - it.table->offsets[it.block];
+    it.index = first;
+
+    return it;
+}
+
+
+DataView::const_iterator DataView::end() const
+{
+    const_iterator it;
+
+    it.index = last;
+
+    return it;
+}
+
+
+/*
+ * Apply the scaler and offset of this snapshot to an array of raw values, in place
+ */
+void DataSnapshot::applyScaling(double* values, size_t n) const
+{
+    if (scaler == 1.0 && offset == 0.0) return;
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        values[idx] = values[idx] * scaler + offset;
+    }
+}
+
+
+/*
+ * Return true if both snapshots hold the same timestamps (with the same time scaling).
+ * Blocks which share their timestamp storage are not compared sample by sample,
+ * so this is cheap for series which share timestamps (see DataSeries::shareTimestamps).
+ */
+bool DataSnapshot::hasSameTimestamps(const DataSnapshot& other) const
+{
+    if (count != other.count || timeScale != other.timeScale || timeOffset != other.timeOffset) return false;
+
+    if (count == 0 || table == other.table) return true;
+
+    const auto& blocks = table->blocks;
+    const auto& others = other.table->blocks;
+
+    for (size_t ii = 0; ii < blocks.size() && table->offsets[ii] < count; ii++)
+    {
+        if (ii >= others.size() || table->offsets[ii] != other.table->offsets[ii]) return false;
+
+        const size_t length = getBlockLength(ii);
+
+        if (length != other.getBlockLength(ii)) return false;
+
+        if (blocks[ii]->hasSameTimestamps(*others[ii])) continue;
+
+        // The final block (which is still being appended to) is never shared, so it is compared by value
+        const bool last = ii + 1 == blocks.size() && ii + 1 == others.size();
+
+        if (!last) return false;
+
+        const auto columns = blocks[ii]->getColumns();
+        const auto other_columns = others[ii]->getColumns();
+
+        if (memcmp(columns.timestamps, other_columns.timestamps, length * sizeof(double)) != 0) return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief DataSnapshot::getCommonRange - Find the samples which are unchanged since an earlier snapshot of the same series.
+ *
+ * Blocks are shared between successive tables, and only the final block is appended to in place,
+ * so the comparison is made per block rather than per sample. This handles the common cases of
+ * samples being appended, and of the oldest blocks being discarded (see DataSeries::setRetention).
+ *
+ * @param previous is an earlier snapshot of the same series
+ * @param idx_first is set to the index (in this snapshot) of the first common sample
+ * @param idx_last is set to the index (in this snapshot) one past the last common sample
+ * @return true if the snapshots have any samples in common
+ */
+bool DataSnapshot::getCommonRange(const DataSnapshot& previous, uint64_t& idx_first, uint64_t& idx_last) const
+{
+    if (isEmpty() || previous.isEmpty()) return false;
+
+    // Every sample has moved in time
+    if (timeScale != previous.timeScale || timeOffset != previous.timeOffset) return false;
+
+    const auto& blocks = table->blocks;
+    const auto& other = previous.table->blocks;
+
+    size_t ii = 0;
+    size_t jj = 0;
+
+    // Either the first block of this snapshot is in the previous snapshot, or vice versa
+    auto it = std::find(other.begin(), other.end(), blocks.front());
+
+    if (it != other.end())
+    {
+        jj = it - other.begin();
     }
     else
     {
-        auto lower = std::lower_bound(data.begin(), data.end(), t);
-        return std::distance(data.begin(), lower);
+        auto found = std::find(blocks.begin(), blocks.end(), other.front());
+
+        if (found == blocks.end()) return false;
+
+        ii = found - blocks.begin();
+    }
+
+    idx_first = table->offsets[ii];
+    idx_last = idx_first;
+
+    for ( ; ii < blocks.size() && jj < other.size() && blocks[ii] == other[jj]; ii++, jj++)
+    {
+        const size_t length = getBlockLength(ii);
+        const size_t length_previous = previous.getBlockLength(jj);
+
+        idx_last = table->offsets[ii] + std::min(length, length_previous);
+
+        // The common run ends at the end of either snapshot (a block which has since been appended to)
+        if (length != length_previous) break;
+    }
+
+    return idx_last > idx_first;
+}
+
+
+/*
+ * Return a copy of this snapshot which returns raw (unscaled) values.
+ * Hot paths can operate on raw values, and apply the scaling once to the result.
+ */
+DataSnapshot DataSnapshot::getUnscaled() const
+{
+    DataSnapshot raw(*this);
+
+    raw.scaler = 1.0;
+    raw.offset = 0.0;
+
+    return raw;
+}
+
+
+/*
+ * Return a copy of this snapshot with the specified time scaling (see DataSeries::setTimeScaling)
+ */
+DataSnapshot DataSnapshot::withTimeScaling(double scale, double offset) const
+{
+    DataSnapshot scaled(*this);
+
+    scaled.timeScale = scale;
+    scaled.timeOffset = offset;
+
+    return scaled;
+}
+
+
+/**
+ * @brief DataSnapshot::getWindow - Return a snapshot of the samples [idx_first, idx_last) of this snapshot.
+ * Blocks which start within the range are shared (a shared final block is cut off by the size of the window),
+ * so only the samples of the first block before the start of the range are copied.
+ */
+DataSnapshot DataSnapshot::getWindow(uint64_t idx_first, uint64_t idx_last) const
+{
+    idx_last = std::min(idx_last, count);
+
+    DataSnapshot window(*this);
+
+    if (idx_first == 0 && idx_last == count) return window;
+
+    auto blocks = std::make_shared<DataBlockTable>();
+
+    window.table = blocks;
+    window.count = 0;
+
+    if (idx_first >= idx_last) return window;
+
+    for (size_t ii = table->getBlockForIndex(idx_first); ii < table->blocks.size() && table->offsets[ii] < idx_last; ii++)
+    {
+        const auto& block = table->blocks[ii];
+        const uint64_t base = table->offsets[ii];
+
+        if (idx_first > base)
+        {
+            const size_t last = std::min<uint64_t>(idx_last - base, getBlockLength(ii));
+
+            blocks->blocks.push_back(std::make_shared<DataBlock>(*block, idx_first - base, last, last - (idx_first - base)));
+        }
+        else
+        {
+            blocks->blocks.push_back(block);
+        }
+    }
+
+    blocks->updateOffsets();
+
+    window.count = idx_last - idx_first;
+
+    return window;
+}
+
+
+/**
+ * @brief DataSnapshot::getTimeWindow - Return a snapshot of the samples with t_min <= t <= t_max (see getWindow)
+ */
+DataSnapshot DataSnapshot::getTimeWindow(double t_min, double t_max) const
+{
+    return getWindow(lowerBound(t_min), upperBound(t_max));
+}
+
+
+/**
+ * @brief DataSnapshot::getMemoryUsage - Memory used by the blocks observed by the snapshot (and its block table)
+ */
+DataMemoryUsage DataSnapshot::getMemoryUsage() const
+{
+    DataMemoryUsage usage;
+
+    if (!table) return usage;
+
+    for (const auto& block : table->blocks)
+    {
+        block->addMemoryUsage(usage);
+    }
+
+    usage.index += sizeof(DataBlockTable);
+    usage.index += table->blocks.capacity() * sizeof(DataBlockPointer);
+    usage.index += table->offsets.capacity() * sizeof(uint64_t);
+
+    return usage;
+}
+
+
+/*
+ * Copy the timestamps of all samples in this view into the provided array.
+ * Unless raw timestamps are requested, the time scaling of the snapshot is applied.
+ */
+void DataView::copyTimestamps(double* dest, bool raw) const
+{
+    visitSegments([dest](const Segment& segment) {
+        memcpy(dest + segment.index, segment.timestamps, segment.length * sizeof(double));
+    });
+
+    if (!raw && snapshot.hasTimeScaling())
+    {
+        const uint64_t n = size();
+
+        for (uint64_t idx = 0; idx < n; idx++)
+        {
+            dest[idx] = snapshot.applyTimeScaling(dest[idx]);
+        }
+    }
+}
+
+
+/*
+ * Copy the values of all samples in this view into the provided array.
+ * Unless raw values are requested, the snapshot scaler and offset are applied.
+ */
+void DataView::copyValues(double* dest, bool raw) const
+{
+    visitSegments([dest](const Segment& segment) {
+        double* out = dest + segment.index;
+
+        if (segment.values)
+        {
+            memcpy(out, segment.values, segment.length * sizeof(double));
+        }
+        else
+        {
+            for (size_t idx = 0; idx < segment.length; idx++)
+            {
+                out[idx] = segment.valuesSingle[idx];
+            }
+        }
+    });
+
+    if (!raw)
+    {
+        snapshot.applyScaling(dest, size());
+    }
+}
+
+
+/*
+ * Construct a cursor for the provided snapshot.
+ * No block is selected until the first lookup, which may be anywhere within the snapshot.
+ */
+DataCursor::DataCursor(const DataSnapshot& s) : snapshot(s),
+    lower(INFINITY),
+    upper(INFINITY)
+{
+}
+
+
+/*
+ * Move the cursor to the specified block, and calculate the range of timestamps which resolve to it
+ */
+void DataCursor::selectBlock(size_t idx)
+{
+    const DataBlockTable& table = *snapshot.table;
+
+    block = idx;
+    base = table.offsets[idx];
+    length = snapshot.getBlockLength(idx);
+    columns = table.blocks[idx]->getColumns(false);
+
+    lower = idx > 0 ? table.blocks[idx - 1]->getLastTimestamp(snapshot.getBlockLength(idx - 1)) : -INFINITY;
+    upper = idx + 1 < table.blocks.size() ? table.blocks[idx]->getLastTimestamp(length) : INFINITY;
+}
+
+
+/*
+ * Return the index of the first sample with a raw timestamp greater than t (see DataSnapshot::upperBound)
+ */
+uint64_t DataCursor::seekRaw(double t)
+{
+    if (snapshot.isEmpty()) return 0;
+
+    if (t < lower || t >= upper)
+    {
+        const auto& blocks = snapshot.table->blocks;
+
+        const size_t previous = block;
+
+        // Sequential lookups usually move into the following block (if there is one, as t may be infinite)
+        if (t >= upper && block + 1 < blocks.size() && (block + 2 >= blocks.size() || t < blocks[block + 1]->getLastTimestamp(snapshot.getBlockLength(block + 1))))
+        {
+            selectBlock(block + 1);
+        }
+        else
+        {
+            // Find the first block which contains a timestamp greater than t (or the final block)
+            size_t lo = 0;
+            size_t hi = blocks.size() - 1;
+
+            while (lo < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+
+                if (blocks[mid]->getLastTimestamp(snapshot.getBlockLength(mid)) <= t)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+
+            selectBlock(lo);
+        }
+
+        local = block > previous ? 0 : length;
+    }
+
+    if (local < length && columns.getTimestamp(local) <= t)
+    {
+        // Gallop forwards, keeping columns[lo] <= t
+        size_t lo = local;
+        size_t step = 1;
+
+        while (lo + step < length && columns.getTimestamp(lo + step) <= t)
+        {
+            lo += step;
+            step *= 2;
+        }
+
+        size_t hi = std::min(lo + step, length);
+
+        lo++;
+
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+
+            if (columns.getTimestamp(mid) <= t) lo = mid + 1;
+            else hi = mid;
+        }
+
+        local = lo;
+    }
+    else if (local > 0 && columns.getTimestamp(local - 1) > t)
+    {
+        // Gallop backwards, keeping columns[hi] > t
+        size_t hi = local - 1;
+        size_t step = 1;
+
+        while (hi >= step && columns.getTimestamp(hi - step) > t)
+        {
+            hi -= step;
+            step *= 2;
+        }
+
+        size_t lo = hi >= step ? hi - step + 1 : 0;
+
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+
+            if (columns.getTimestamp(mid) <= t) lo = mid + 1;
+            else hi = mid;
+        }
+
+        local = lo;
+    }
+
+    return base + local;
+}
+
+
+const DataPoint DataCursor::getDataPoint(uint64_t idx) const
+{
+    if (idx >= base && idx - base < length)
+    {
+        size_t n = idx - base;
+
+        return DataPoint(snapshot.applyTimeScaling(columns.getTimestamp(n)), snapshot.applyScaling(columns.getValue(n)));
+    }
+
+    return snapshot.getDataPoint(idx);
+}
+
+
+double DataCursor::interpolate(double t)
+{
+    if (snapshot.isEmpty()) return 0;
+
+    uint64_t idx = seek(t);
+
+    // Time is outside the range of the samples
+    if (idx == 0) return getDataPoint(0).value;
+    if (idx >= snapshot.size()) return getDataPoint(snapshot.size() - 1).value;
+
+    auto point_a = getDataPoint(idx - 1);
+    auto point_b = getDataPoint(idx);
+
+    double dt = point_b.timestamp - point_a.timestamp;
+    double dv = point_b.value - point_a.value;
+
+    return point_a.value + dv * (t - point_a.timestamp) / dt;
+}
+
+
+double DataCursor::sampleHold(double t)
+{
+    if (snapshot.isEmpty()) return 0;
+
+    uint64_t idx = seek(t);
+
+    return getDataPoint(idx > 0 ? idx - 1 : 0).value;
+}
+
+
+/**
+ * @brief DataCursor::resample - Sample the series on a uniform grid, t0 + ii * dt (dt > 0)
+ *
+ * Equivalent to calling interpolate (or sampleHold) for each point, but the grid is traversed
+ * in a single forward pass: within a block, each grid point only compares against the next sample.
+ *
+ * @param t0 is the time of the first point
+ * @param dt is the spacing of the grid
+ * @param n is the number of points
+ * @param output receives n (scaled) values
+ * @param mode selects linear interpolation or sample-and-hold (see ResampleMode)
+ */
+void DataCursor::resample(double t0, double dt, size_t n, double* output, int mode)
+{
+    const bool hold = mode == RESAMPLE_HOLD;
+
+    // The grid is traversed in raw time
+    const double t0_raw = snapshot.removeTimeScaling(t0);
+    const double dt_raw = dt / snapshot.getTimeScale();
+
+    size_t ii = 0;
+
+    while (ii < n)
+    {
+        const double t = t0_raw + ii * dt_raw;
+        const uint64_t idx = seekRaw(t);
+
+        // Outside the range of the samples, or the previous sample lies in the previous block
+        if (idx == 0 || idx >= snapshot.size() || local == 0)
+        {
+            output[ii] = hold ? sampleHold(t0 + ii * dt) : interpolate(t0 + ii * dt);
+            ii++;
+            continue;
+        }
+
+        size_t k = local;
+
+        double t_a = columns.getTimestamp(k - 1);
+        double t_b = columns.getTimestamp(k);
+        double v_a = columns.getValue(k - 1);
+        double v_b = columns.getValue(k);
+
+        // Grid points between samples [k - 1] and [k], until the next sample is in the following block
+        while (ii < n)
+        {
+            const double tt = t0_raw + ii * dt_raw;
+
+            if (tt >= t_b)
+            {
+                while (k < length && columns.getTimestamp(k) <= tt) k++;
+
+                if (k >= length) break;
+
+                t_a = columns.getTimestamp(k - 1);
+                t_b = columns.getTimestamp(k);
+                v_a = columns.getValue(k - 1);
+                v_b = columns.getValue(k);
+            }
+
+            const double raw = hold ? v_a : v_a + (v_b - v_a) * (tt - t_a) / (t_b - t_a);
+
+            output[ii++] = snapshot.applyScaling(raw);
+        }
+
+        local = k;
     }
 }
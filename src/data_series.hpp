@@ -5,10 +5,15 @@
 #include <qobject.h>
 #include <qvector.h>
 #include <vector>
+#include <iterator>
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <qmutex.h>
 #include <QRectF>
 #include <QColor>
 
+#include "data_block.hpp"
 
 /**
  * @brief The DataPoint class represents a single <x, y> point of data
@@ -27,8 +32,550 @@ public:
 };
 
 
+class DataView;
+
+
+/**
+ * @brief The DataSnapshot class provides a consistent, read-only view of a DataSeries.
+ *
+ * Taking a snapshot is cheap: no samples are copied, and no lock is taken.
+ * The snapshot holds a reference to the block table which was published when it
+ * was taken, so it is unaffected by any subsequent modification of the series,
+ * and remains valid for as long as it is held (even if the series is cleared).
+ *
+ * Values returned by the snapshot have the series scaler and offset applied.
+ */
+class DataSnapshot
+{
+public:
+    /**
+     * @brief The Bucket struct summarises a contiguous run of samples within the series.
+     * Values have the series scaler and offset applied.
+     */
+    struct Bucket
+    {
+        //! First (oldest) sample in the bucket
+        DataPoint first;
+
+        //! Sample with the minimum value
+        DataPoint min;
+
+        //! Sample with the maximum value
+        DataPoint max;
+
+        //! Last (newest) sample in the bucket
+        DataPoint last;
+
+        //! Number of samples in the bucket
+        uint64_t count = 0;
+
+        //! Sum of the values in the bucket
+        double sum = 0;
+    };
+
+    /**
+     * @brief The Statistics struct describes the values within a range of samples.
+     * Values have the series scaler and offset applied.
+     */
+    struct Statistics
+    {
+        //! Number of samples in the range
+        uint64_t count = 0;
+
+        //! Minimum value
+        double min = 0;
+
+        //! Maximum value
+        double max = 0;
+
+        //! Sum of values
+        double sum = 0;
+
+        //! Sum of squared deviations from the mean
+        double m2 = 0;
+
+        void include(const Statistics& other);
+
+        double getMean(void) const { return count > 0 ? sum / count : 0; }
+        double getVariance(void) const;
+        double getStdDev(void) const;
+        double getRms(void) const;
+    };
+
+    //! Statistics calculated by aggregate (any combination)
+    enum AggregateStatistic
+    {
+        AGGREGATE_COUNT = 0x01,
+        AGGREGATE_MIN = 0x02,
+        AGGREGATE_MAX = 0x04,
+        AGGREGATE_MEAN = 0x08,
+        AGGREGATE_STDDEV = 0x10,
+        AGGREGATE_FIRST = 0x20,
+        AGGREGATE_LAST = 0x40,
+
+        AGGREGATE_ALL = 0x7F,
+    };
+
+    /**
+     * @brief The Aggregate struct holds the statistics of a series within each of a number of equal time
+     * buckets (see aggregate), as a column for each statistic which was requested (others are empty).
+     * Values of a bucket which contains no samples are NaN.
+     */
+    struct Aggregate
+    {
+        //! Range of each bucket, [t_min + ii * width, t_min + (ii + 1) * width) (the last bucket includes t_max)
+        double t_min = 0;
+        double t_max = 0;
+        double width = 0;
+
+        //! Number of buckets
+        size_t buckets = 0;
+
+        int statistics = 0;
+
+        std::vector<uint64_t> count;
+        std::vector<double> min;
+        std::vector<double> max;
+        std::vector<double> mean;
+        std::vector<double> stddev;
+        std::vector<double> first;
+        std::vector<double> last;
+
+        size_t size(void) const { return buckets; }
+
+        double getBucketStart(size_t idx) const { return t_min + idx * width; }
+        double getBucketCentre(size_t idx) const { return t_min + (idx + 0.5) * width; }
+    };
+
+    DataSnapshot() {}
+    DataSnapshot(DataBlockTablePointer table, double scaler, double offset, double timeScale = 1.0, double timeOffset = 0.0);
+
+    uint64_t size(void) const { return count; }
+    bool isEmpty(void) const { return count == 0; }
+
+    //! Returns true if both snapshots observe exactly the same samples, at the same times (ignoring value scaling)
+    bool isIdentical(const DataSnapshot& other) const
+    {
+        return table == other.table && count == other.count && timeScale == other.timeScale && timeOffset == other.timeOffset;
+    }
+
+    bool getCommonRange(const DataSnapshot& previous, uint64_t& idx_first, uint64_t& idx_last) const;
+
+    //! Returns true if both snapshots have the same timestamps, because they share the storage of their timestamps (see DataSeries::shareTimestamps)
+    bool hasSameTimestamps(const DataSnapshot& other) const;
+
+    //! Block table observed by the snapshot (identifies the version of the series, along with the size)
+    const DataBlockTablePointer& getTable(void) const { return table; }
+
+    double getScaler(void) const { return scaler; }
+    double getOffset(void) const { return offset; }
+
+    /**
+     * @brief applyScaling - Apply the scaler and offset of this snapshot to a raw value.
+     * Note: for a negative scaler, the minimum raw value maps to the maximum scaled value
+     */
+    double applyScaling(double raw) const { return raw * scaler + offset; }
+    void applyScaling(double* values, size_t n) const;
+
+    DataSnapshot getUnscaled(void) const;
+
+    /*
+     * Timestamps are stored in the time base of their source, and mapped to the aligned time
+     * t = raw * timeScale + timeOffset (timeScale > 0) when they are read (see DataSource::setTimeScaling).
+     * Every timestamp passed to (or returned by) the snapshot is aligned, except the raw columns
+     * of DataView::Segment.
+     */
+    double getTimeScale(void) const { return timeScale; }
+    double getTimeOffset(void) const { return timeOffset; }
+
+    bool hasTimeScaling(void) const { return timeScale != 1.0 || timeOffset != 0.0; }
+
+    double applyTimeScaling(double raw) const { return raw * timeScale + timeOffset; }
+    double removeTimeScaling(double t) const { return (t - timeOffset) / timeScale; }
+
+    DataSnapshot withTimeScaling(double scale, double offset) const;
+
+    DataSnapshot getWindow(uint64_t idx_first, uint64_t idx_last) const;
+    DataSnapshot getTimeWindow(double t_min, double t_max) const;
+
+    DataMemoryUsage getMemoryUsage(void) const;
+
+    const DataPoint getDataPoint(uint64_t idx) const;
+    double getTimestamp(uint64_t idx) const;
+    double getValue(uint64_t idx) const;
+
+    uint64_t lowerBound(double t) const;
+    uint64_t upperBound(double t) const;
+
+    Statistics getStatistics(uint64_t idx_first, uint64_t idx_last) const;
+
+    Aggregate aggregate(double t_min, double t_max, size_t buckets, int statistics = AGGREGATE_ALL) const;
+
+    //! Sample nearest to the specified time (the snapshot must not be empty)
+    const DataPoint getNearestPoint(double t) const;
+
+    const DataPoint getExtremePoint(uint64_t idx_first, uint64_t idx_last, bool maximum) const;
+
+    DataView getView(void) const;
+    DataView getView(uint64_t idx_first, uint64_t idx_last) const;
+
+    /**
+     * @brief visitBuckets - Summarise the samples in the range [idx_first, idx_last), in timestamp order,
+     * using buckets from the summary pyramid no coarser than the specified level.
+     * A level of -1 visits each individual sample as a separate bucket.
+     * @param idx_first is the index of the first sample
+     * @param idx_last is the index one past the last sample
+     * @param level is the coarsest summary level to use (see DataBlock::getSummaryBucketSize)
+     * @param callback is called with each DataSnapshot::Bucket, in order
+     */
+    template<typename Callback>
+    void visitBuckets(uint64_t idx_first, uint64_t idx_last, int level, Callback callback) const
+    {
+        idx_last = std::min<uint64_t>(idx_last, count);
+
+        if (idx_first >= idx_last) return;
+
+        const auto& blocks = table->blocks;
+
+        for (size_t ii = table->getBlockForIndex(idx_first); ii < blocks.size() && table->offsets[ii] < idx_last; ii++)
+        {
+            const DataBlock& block = *blocks[ii];
+            const uint64_t base = table->offsets[ii];
+            const size_t length = getBlockLength(ii);
+
+            // Only the final block can still be growing (a block which is cut off by the next block is not sealed)
+            const bool sealed = ((ii + 1 < blocks.size()) || (length >= block.getCapacity())) && length == block.size();
+
+            size_t first = idx_first > base ? idx_first - base : 0;
+            size_t last = std::min<uint64_t>(idx_last - base, length);
+
+            const DataBlock::Columns columns = block.getColumns(false);
+
+            block.visitSummary(first, last, level, length, sealed, [&](size_t a, size_t b, const DataBlock::Summary& summary) {
+                Bucket bucket;
+
+                bucket.first = DataPoint(applyTimeScaling(columns.getTimestamp(a)), columns.getValue(a) * scaler + offset);
+                bucket.last = DataPoint(applyTimeScaling(columns.getTimestamp(b)), columns.getValue(b) * scaler + offset);
+                bucket.min = DataPoint(applyTimeScaling(columns.getTimestamp(summary.idxMin)), summary.min * scaler + offset);
+                bucket.max = DataPoint(applyTimeScaling(columns.getTimestamp(summary.idxMax)), summary.max * scaler + offset);
+                bucket.count = b - a + 1;
+                bucket.sum = summary.sum * scaler + offset * bucket.count;
+
+                // A negative scaler swaps the extreme values
+                if (scaler < 0)
+                {
+                    std::swap(bucket.min, bucket.max);
+                }
+
+                callback(bucket);
+            });
+        }
+    }
+
+protected:
+    friend class DataView;
+    friend class DataCursor;
+
+    size_t getBlockLength(size_t block) const { return table->getBlockLength(block, count); }
+
+    //! Block table observed when the snapshot was taken
+    DataBlockTablePointer table;
+
+    //! Number of samples visible to this snapshot
+    uint64_t count = 0;
+
+    //! Series scaler when the snapshot was taken
+    double scaler = 1.0;
+
+    //! Series offset when the snapshot was taken
+    double offset = 0.0;
+
+    //! Time scaling of the series when the snapshot was taken
+    double timeScale = 1.0;
+    double timeOffset = 0.0;
+};
+
+
+/**
+ * @brief The DataView class provides zero-copy access to a range of samples within a DataSnapshot.
+ *
+ * A view holds a reference to the underlying snapshot, so the samples remain valid
+ * for as long as the view exists. Samples can be read one at a time using the
+ * (forward) iterator, which yields DataPoint values with the scaler and offset applied,
+ * or a block at a time using visitSegments, which provides direct access to the raw
+ * sample columns.
+ */
+class DataView
+{
+public:
+    /**
+     * @brief The Segment struct describes a contiguous run of samples within a single block.
+     * Timestamps and values are raw; the time scaling, scaler and offset of the series are *not* applied.
+     */
+    struct Segment
+    {
+        //! Index (within the view) of the first sample in the segment
+        uint64_t index = 0;
+
+        //! Number of samples in the segment
+        size_t length = 0;
+
+        //! Timestamp column
+        const double* timestamps = nullptr;
+
+        //! Value column (nullptr if values are stored in single precision)
+        const double* values = nullptr;
+
+        //! Value column (nullptr if values are stored in double precision)
+        const float* valuesSingle = nullptr;
+
+        //! Decoded storage of a compressed block (the columns remain valid while a copy of the segment, and the view, is held)
+        std::shared_ptr<const void> owner;
+
+        double getTimestamp(size_t idx) const { return timestamps[idx]; }
+        double getValue(size_t idx) const { return values ? values[idx] : (double) valuesSingle[idx]; }
+    };
+
+    /**
+     * @brief The const_iterator class iterates through the samples in a view, in timestamp order
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef DataPoint value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const DataPoint* pointer;
+        typedef DataPoint reference;
+
+        const_iterator() {}
+
+        DataPoint operator*() const
+        {
+            return DataPoint(columns.getTimestamp(local) * timeScale + timeOffset, columns.getValue(local) * scaler + offset);
+        }
+
+        const_iterator& operator++()
+        {
+            index++;
+
+            if (++local >= length && index < count)
+            {
+                columns = table->blocks[++block]->getColumns(false);
+                length = table->getBlockLength(block, count);
+                local = 0;
+            }
+
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator it = *this;
+            ++(*this);
+            return it;
+        }
+
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+        double getTimestamp(void) const { return columns.getTimestamp(local) * timeScale + timeOffset; }
+
+    protected:
+        friend class DataView;
+
+        const DataBlockTable* table = nullptr;
+
+        //! Columns of the current block
+        DataBlock::Columns columns;
+
+        size_t block = 0;
+        size_t local = 0;
+        size_t length = 0;
+
+        //! Index of the current sample (within the snapshot)
+        uint64_t index = 0;
+
+        //! Number of samples in the snapshot
+        uint64_t count = 0;
+
+        double scaler = 1.0;
+        double offset = 0.0;
+
+        double timeScale = 1.0;
+        double timeOffset = 0.0;
+    };
+
+    DataView() {}
+    DataView(const DataSnapshot& snapshot, uint64_t idx_first, uint64_t idx_last);
+
+    uint64_t size(void) const { return last - first; }
+    bool isEmpty(void) const { return last == first; }
+
+    //! Index (within the snapshot) of the first sample in this view
+    uint64_t getFirstIndex(void) const { return first; }
+
+    const DataSnapshot& getSnapshot(void) const { return snapshot; }
+
+    const DataPoint getDataPoint(uint64_t idx) const;
+    double getTimestamp(uint64_t idx) const { return getDataPoint(idx).timestamp; }
+    double getValue(uint64_t idx) const { return getDataPoint(idx).value; }
+
+    /* Bulk copy functions (dest must have space for size() samples) */
+    void copyTimestamps(double* dest, bool raw = false) const;
+    void copyValues(double* dest, bool raw = false) const;
+
+    const_iterator begin(void) const;
+    const_iterator end(void) const;
+
+    /**
+     * @brief visitSegments - Visit the samples in this view, one contiguous segment (block) at a time.
+     * The column pointers of a segment are only valid for the duration of the callback, unless the segment
+     * (which holds any decoded columns) is copied, and the view is retained (see SeriesBuffer).
+     * @param callback is called with each DataView::Segment, in order
+     */
+    template<typename Callback>
+    void visitSegments(Callback callback) const
+    {
+        if (isEmpty()) return;
+
+        const DataBlockTable& table = *snapshot.table;
+
+        for (size_t ii = table.getBlockForIndex(first); ii < table.blocks.size() && table.offsets[ii] < last; ii++)
+        {
+            const DataBlock& block = *table.blocks[ii];
+            const uint64_t base = table.offsets[ii];
+
+            size_t a = first > base ? first - base : 0;
+            size_t b = std::min<uint64_t>(last - base, snapshot.getBlockLength(ii));
+
+            const DataBlock::Columns columns = block.getColumns();
+
+            Segment segment;
+
+            segment.index = base + a - first;
+            segment.length = b - a;
+            segment.timestamps = columns.timestamps + a;
+            segment.values = columns.values ? columns.values + a : nullptr;
+            segment.valuesSingle = columns.valuesSingle ? columns.valuesSingle + a : nullptr;
+            segment.owner = columns.owner;
+
+            callback(segment);
+        }
+    }
+
+protected:
+    DataSnapshot snapshot;
+
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+
+
+/**
+ * @brief The DataCursor class provides fast lookups for a sequence of nearby timestamps within a DataSnapshot.
+ *
+ * The cursor remembers the position of the previous lookup. Each new lookup gallops
+ * outwards from that position (1, 2, 4, 8... samples) and then binary searches the
+ * bracketed range, so a monotonic sequence of lookups costs amortised O(1) each,
+ * rather than O(log n). Lookups in any order return the same results as DataSnapshot.
+ *
+ * Values returned by the cursor have the series scaler and offset applied.
+ */
+class DataCursor
+{
+public:
+    DataCursor() {}
+    DataCursor(const DataSnapshot& snapshot);
+
+    const DataSnapshot& getSnapshot(void) const { return snapshot; }
+
+    uint64_t seek(double t) { return seekRaw(snapshot.removeTimeScaling(t)); }
+
+    const DataPoint getDataPoint(uint64_t idx) const;
+
+    //! Value at the specified time, linearly interpolated between the neighbouring samples
+    double interpolate(double t);
+
+    //! Value of the most recent sample at (or before) the specified time
+    double sampleHold(double t);
+
+    enum ResampleMode
+    {
+        RESAMPLE_LINEAR = 0,
+        RESAMPLE_HOLD = 1,
+    };
+
+    void resample(double t0, double dt, size_t n, double* output, int mode = RESAMPLE_LINEAR);
+
+protected:
+    void selectBlock(size_t idx);
+
+    //! Lookup of a raw timestamp (see seek)
+    uint64_t seekRaw(double t);
+
+    DataSnapshot snapshot;
+
+    //! Columns of the current block
+    DataBlock::Columns columns;
+
+    //! Index of the current block (within the block table)
+    size_t block = 0;
+
+    //! Number of samples in the current block (visible to the snapshot)
+    size_t length = 0;
+
+    //! Index (within the snapshot) of the first sample in the current block
+    uint64_t base = 0;
+
+    //! Lookups for timestamps in the range [lower, upper) resolve to the current block
+    double lower = 0;
+    double upper = 0;
+
+    //! Result of the previous lookup (within the current block)
+    size_t local = 0;
+};
+
+
+/**
+ * @brief The DataSeriesFilter class transforms the samples of a series as they are read (see DataSeries::setFilter).
+ *
+ * The raw samples are never modified, so a filter can be changed (or removed) at any time.
+ * Every snapshot of a filtered series is passed through the filter, which returns a snapshot of the
+ * filtered samples (with the same timestamps), so every reader of the series sees the filtered values.
+ */
+class DataSeriesFilter
+{
+public:
+    virtual ~DataSeriesFilter() = default;
+
+    // Return a snapshot of the filtered samples. Called from any thread, whenever the series is read
+    virtual DataSnapshot filterSnapshot(const DataSnapshot& samples) = 0;
+};
+
+
 /**
  * @brief The DataSeries class represents a timeseries vector of DataPoint objects
+ *
+ * Samples are stored in columnar form (separate timestamp and value arrays),
+ * split across a sequence of DataBlock objects.
+ *
+ * Modifications are serialised by the data mutex, but reading never blocks:
+ * the set of blocks is described by an immutable DataBlockTable, which is
+ * atomically replaced whenever the structure of the series changes. Readers
+ * (including all of the data access functions below) operate on a DataSnapshot,
+ * so a series can be resampled while an import is still appending to it.
+ *
+ * Samples which arrive out of order are not inserted individually. They are
+ * collected in a small staging buffer, and merged into the blocks in bulk when
+ * the buffer fills, when flush() is called, or when the series is next read.
+ *
+ * A series can also be loaded on demand (see setLoader): the samples are only
+ * produced when the series is first read, so that an importer need not parse
+ * every series in a file which is never plotted.
+ *
+ * A filter (e.g. a FilterChain) can be attached to a series (see setFilter), in which case
+ * the samples are filtered as they are read, and the raw samples are available via getRawSnapshot.
  */
 class DataSeries : public QObject
 {
@@ -55,12 +602,31 @@ public:
         SAMPLE_HOLD,
     };
 
+    enum ValuePrecision
+    {
+        DOUBLE_PRECISION,
+        SINGLE_PRECISION,
+    };
+
+    typedef DataSnapshot::Bucket Bucket;
+    typedef DataCursor Cursor;
+
+    /**
+     * @brief Loader produces the samples of a series which is loaded on demand.
+     * It is called (once) from whichever thread first reads the series, and must not access the series.
+     * Returns false if the samples could not be loaded.
+     */
+    typedef std::function<bool(std::vector<double>& t_ms, std::vector<double>& values)> Loader;
+
     static const float LINE_WIDTH_MIN;
     static const float LINE_WIDTH_MAX;
 
     static const int SYMBOL_SIZE_MIN;
     static const int SYMBOL_SIZE_MAX;
 
+    //! Out-of-order samples are merged in bulk once this many have been staged
+    static const size_t STAGING_CAPACITY = 4096;
+
     const QString& getGroup(void) const { return group; }
     void setGroup(QString g) { group = g; }
 
@@ -70,27 +636,36 @@ public:
     const QString& getUnits(void) const { return units; }
     void setUnits(QString u) { units = u; }
 
-    double getScaler(void) const { return scalerValue; }
-    void setScaler(double s, bool update = true)
+    /**
+     * @brief The Scaling struct holds the value and time scaling of a series. It is replaced as a whole
+     * (rather than modified), so a reader never combines the scaling of different updates.
+     */
+    struct Scaling
     {
-        scalerValue = s;
+        double scaler = 1.0;
+        double offset = 0.0;
 
-        if (update)
-        {
-            emit dataUpdated();
-        }
-    }
+        //! Time scaling (t = raw * timeScale + timeOffset)
+        double timeScale = 1.0;
+        double timeOffset = 0.0;
+    };
 
-    double getOffset(void) const { return offsetValue; }
-    void setOffset(double o, bool update = true)
-    {
-        offsetValue = o;
+    Scaling getScaling(void) const { return *std::atomic_load(&scaling); }
 
-        if (update)
-        {
-            emit dataUpdated();
-        }
-    }
+    double getScaler(void) const { return getScaling().scaler; }
+    void setScaler(double s, bool update = true);
+
+    double getOffset(void) const { return getScaling().offset; }
+    void setOffset(double o, bool update = true);
+
+    //! Mapping from the raw timestamps to the aligned time (normally set by the source, see DataSource::setTimeScaling)
+    double getTimeScale(void) const { return getScaling().timeScale; }
+    double getTimeOffset(void) const { return getScaling().timeOffset; }
+    void setTimeScaling(double scale, double offset, bool update = true);
+
+    //! Timestamps are relative to this base (nanoseconds since the Unix epoch), for a series imported with exact timestamps (see TimeTicks)
+    int64_t getEpochBase(void) const { return epochBase; }
+    void setEpochBase(int64_t base) { epochBase = base; }
 
     QColor getColor(void) const { return color; }
     void setColor(QColor c);
@@ -124,6 +699,24 @@ public:
         symbolStyle = style;
     }
 
+    ValuePrecision getValuePrecision(void) const { return valuePrecision; }
+    void setValuePrecision(ValuePrecision precision);
+
+    //! Full blocks (other than the final block) are stored in compressed form
+    bool isCompressionEnabled(void) const { return compressionEnabled; }
+    void setCompressionEnabled(bool enabled);
+
+    size_t shareTimestamps(const DataSeries& reference);
+    bool hasTimestampColumns(void) const;
+
+    //! Samples older than (newest - retention) are discarded (zero to retain every sample)
+    double getRetention(void) const { return retention; }
+    void setRetention(double span, bool update=true);
+
+    //! Memory-mapped store for sample data (nullptr if sample data are stored on the heap)
+    std::shared_ptr<DataStore> getDataStore(void) const { return dataStore; }
+    void setDataStore(std::shared_ptr<DataStore> store);
+
     int getSymbolSize(void) const { return symbolSize; }
     void setSymbolSize(int s)
     {
@@ -139,12 +732,47 @@ public:
         symbolSize = s;
     }
 
+    //! Filter applied to the samples when they are read (nullptr if the samples are not filtered)
+    std::shared_ptr<DataSeriesFilter> getFilter(void) const { return std::atomic_load(&filter); }
+    void setFilter(std::shared_ptr<DataSeriesFilter> f, bool update = true);
+
+    //! Samples are produced by the loader when the series is first read (see load)
+    void setLoader(Loader loader);
+
+    //! Returns false if the series is waiting to be loaded on demand
+    bool isLoaded(void) const { return !loadPending.load(); }
+
+    void load(void) const;
+
     /* Data insertion functions */
     void addData(DataPoint point, bool update=true);
-    void addData(double t_ms, float value, bool update=true);
+    void addData(double t_ms, double value, bool update=true);
+    void addData(const double* t_ms, const double* values, size_t count, bool update=true);
+    void addData(const std::vector<double>& t_ms, const std::vector<double>& values, bool update=true);
 
     void clipTimeRange(double t_min, double t_max, bool update=true);
 
+    /*
+     * The time window of a series restricts every read (snapshots, statistics, plots and exports) to the samples
+     * with t_min <= t <= t_max, without modifying the stored samples, so a series can be cropped (e.g. to a test phase)
+     * instantly, and the crop can be removed again. The window is specified in the aligned time, and is stored in
+     * the raw time base of the series, so it moves with the samples if the series is realigned (see setTimeScaling).
+     */
+    void setTimeWindow(double t_min, double t_max, bool update=true);
+    void clearTimeWindow(bool update=true);
+
+    bool hasTimeWindow(void) const { return windowStart > -std::numeric_limits<double>::infinity() || windowEnd < std::numeric_limits<double>::infinity(); }
+
+    //! Aligned time of the start and end of the time window (-inf and inf if there is no window)
+    double getTimeWindowStart(void) const { const Scaling s = getScaling(); return windowStart * s.timeScale + s.timeOffset; }
+    double getTimeWindowEnd(void) const { const Scaling s = getScaling(); return windowEnd * s.timeScale + s.timeOffset; }
+
+    //! Discard every sample at or after the specified time
+    void truncate(double t, bool update=true);
+
+    //! Merge any staged (out-of-order) samples into the series
+    void flush(bool update=true);
+
     /* Data removal functions */
     void clearData(bool update=true);
 
@@ -153,9 +781,14 @@ public:
 
     QRectF getBounds(void) const;
 
+    bool getValueRange(double& min, double& max) const;
+
     std::vector<DataPoint> getData() const;
     std::vector<DataPoint> getData(double t_min, double t_max) const;
 
+    DataView getView(void) const;
+    DataView getView(double t_min, double t_max) const;
+
     const DataPoint getDataPoint(uint64_t idx) const;
     double getTimestamp(uint64_t idx) const;
     double getValue(uint64_t idx) const;
@@ -179,13 +812,52 @@ public:
     double getMeanValue(void) const;
     double getMeanValue(double t_min, double t_max) const;
 
+    double getStdDevValue(void) const;
+    double getStdDevValue(double t_min, double t_max) const;
+
+    DataSnapshot::Statistics getStatistics(void) const;
+    DataSnapshot::Statistics getStatistics(double t_min, double t_max) const;
+
+    //! Convenience wrapper for DataSnapshot::aggregate (see getSnapshot)
+    DataSnapshot::Aggregate aggregate(double t_min, double t_max, size_t buckets, int statistics = DataSnapshot::AGGREGATE_ALL) const
+    {
+        return getSnapshot().aggregate(t_min, t_max, buckets, statistics);
+    }
+
     uint64_t getIndexForTimestamp(double t, SearchDirection direction=SEARCH_LEFT_TO_RIGHT) const;
 
+    DataSnapshot getSnapshot(void) const;
+
+    //! Memory used by the samples of the series (a series which is not loaded uses none)
+    DataMemoryUsage getMemoryUsage(void) const;
+
+    //! Discard the cached (decoded) columns of the series
+    void releaseCaches(void);
+
+    //! Snapshot of the samples before they are filtered (see setFilter)
+    DataSnapshot getRawSnapshot(void) const;
+
+    //! Snapshot of every stored sample, ignoring the time window (see setTimeWindow)
+    DataSnapshot getStoredSnapshot(void) const;
+
+    //! Cursor for a sequence of timestamp lookups (see DataCursor)
+    DataCursor getCursor(void) const { return DataCursor(getSnapshot()); }
+
+    //! Convenience wrapper for DataSnapshot::visitBuckets (see getSnapshot)
+    template<typename Callback>
+    void visitBuckets(uint64_t idx_first, uint64_t idx_last, int level, Callback callback) const
+    {
+        getSnapshot().visitBuckets(idx_first, idx_last, level, callback);
+    }
+
     /* Status Functions */
     bool hasData() const { return size() > 0; }
 
+    //! Emit dataChanged with the interval which has changed since the previous notification (see SeriesUpdateScheduler)
+    void notifyChanged(void);
+
 public slots:
-    void update(void) { emit dataUpdated(); }
+    void update(void);
     void updateStyle(void) { emit styleUpdated(); }
 
 signals:
@@ -193,13 +865,84 @@ signals:
     void dataUpdated();
     void styleUpdated();
 
+    // Emitted (at a capped rate) after the data are updated, with the interval of the samples which have changed
+    void dataChanged(double t_min, double t_max);
+
 protected:
+    friend class SeriesUpdateScheduler;
+
+    //! Replace the scaling of the series (readers see either the previous or the new scaling)
+    void setScaling(const Scaling& s) { std::atomic_store(&scaling, std::make_shared<const Scaling>(s)); }
+
+    /* Modification functions (data mutex must be held) */
+    void appendSamples(const double* t, const double* v, size_t count);
+    void appendSamples(DataBlockTable& table, const double* t, const double* v, size_t count) const;
+    void mergeSamples(const double* t, const double* v, size_t count);
+    void mergeStagedSamples(void);
+
+    std::shared_ptr<DataBlockTable> copyRange(uint64_t idx_first, uint64_t idx_last) const;
+    std::shared_ptr<DataBlockTable> copyRange(const DataBlockTable& source, uint64_t idx_first, uint64_t idx_last, bool share_tail) const;
+
+    void applyRetention(void);
+
+    void invalidateBounds(void);
+
+    void markChanged(double t_min, double t_max);
+    void markChanged(void) { markChanged(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()); }
+
+    void encodeBlocks(DataBlockTable& table) const;
+    void encodeBlock(DataBlockPointer& block) const;
+    void publishBlockTable(std::shared_ptr<DataBlockTable> table);
+
+    //! Columnar sample storage (published table, replaced atomically)
+    DataBlockTablePointer blockTable = std::make_shared<DataBlockTable>();
+
+    //! Storage precision for sample values
+    ValuePrecision valuePrecision = DOUBLE_PRECISION;
+
+    //! Compress full blocks which are no longer being appended to
+    bool compressionEnabled = false;
+
+    //! Timespan of samples to retain, relative to the newest sample (zero to retain every sample)
+    double retention = 0;
+
+    //! Store used when allocating new blocks (see DataStore::getDefault)
+    std::shared_ptr<DataStore> dataStore;
 
-    std::vector<DataPoint> data;
+    //! Out-of-order samples waiting to be merged (data mutex must be held)
+    std::vector<DataPoint> stagedSamples;
+
+    //! Number of staged samples (may be read without the data mutex)
+    std::atomic<size_t> stagedCount{0};
 
     //! mutex for controlling data access
     mutable QMutex data_mutex;
 
+    //! Snapshot for which the range of raw values was last computed (see getValueRange, bounds mutex must be held)
+    mutable DataSnapshot boundsSnapshot;
+    mutable double boundsMin = 0;
+    mutable double boundsMax = 0;
+
+    mutable QMutex bounds_mutex;
+
+    //! Interval of the samples changed since the previous notification (empty if t_min > t_max, changed mutex must be held)
+    double changed_min = std::numeric_limits<double>::infinity();
+    double changed_max = -std::numeric_limits<double>::infinity();
+
+    QMutex changed_mutex;
+
+    //! Set while the series is queued for notification (see SeriesUpdateScheduler::requestUpdate)
+    std::atomic<bool> updateQueued{false};
+
+    //! Produces the samples of a series which is loaded on demand (load mutex must be held)
+    mutable Loader loader;
+
+    //! The loader has not been called yet (may be read without the load mutex)
+    mutable std::atomic<bool> loadPending{false};
+
+    //! Serialises loading, so that concurrent readers wait for the samples
+    mutable QMutex load_mutex;
+
     //! Group string for this DataSeries
     QString group;
 
@@ -222,11 +965,34 @@ protected:
 
     unsigned int symbolSize = 5;
 
-    //! Scaler value for this DataSeries
-    double scalerValue = 1.0f;
+    //! Value and time scaling for this DataSeries (accessed atomically, and only replaced with the scaling mutex held)
+    std::shared_ptr<const Scaling> scaling = std::make_shared<const Scaling>();
+
+    QMutex scaling_mutex;
+
+    int64_t epochBase = 0;
+
+    //! Filter applied to the samples when they are read (accessed atomically)
+    std::shared_ptr<DataSeriesFilter> filter;
+
+    //! Time window, in the raw time base (see setTimeWindow)
+    double windowStart = -std::numeric_limits<double>::infinity();
+    double windowEnd = std::numeric_limits<double>::infinity();
+
+    /**
+     * @brief The WindowCache struct holds the window of the most recent snapshot, so that reading a windowed series
+     * repeatedly does not rebuild the window until the samples (or the window) change
+     */
+    struct WindowCache
+    {
+        DataSnapshot stored;
+        double start;
+        double end;
+        DataSnapshot window;
+    };
 
-    //! Offset value for this DataSeries
-    double offsetValue = 0.0f;
+    //! Accessed atomically
+    mutable std::shared_ptr<const WindowCache> windowCache;
 
 };
 
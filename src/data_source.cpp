@@ -1,9 +1,15 @@
-#include <QRegularExpression>
+#include <cmath>
+
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 
 #include "data_source.hpp"
+#include "data_store.hpp"
+#include "trace_recorder.hpp"
+
+
+const int DataSource::MAX_TIMESTAMP_REFERENCES;
 
 
 DataSource::DataSource(QString source, QString label, QString description) :
@@ -79,60 +85,27 @@ QColor DataSource::getNextColor()
 
 /**
  * @brief DataSource::getSeriesLabels returns a list of labels for the DataSeries contained within this source
- * @param filter_string an (optional) wildcard filter to limit the returned labels
+ * @param filter_string an (optional) wildcard filter to limit the returned labels (see SeriesSearchIndex)
  * @return a list of zero or more labels
  */
 QStringList DataSource::getSeriesLabels(QString filter_string) const
 {
-    QStringList labels;
-
-    QList<QRegularExpression> patterns;
-
-    for (QString pattern : filter_string.trimmed().split(" "))
+    // The index is rebuilt after series are added or removed, rather than for each filter
+    if (!searchIndexValid)
     {
-        if (!pattern.startsWith("*"))
-        {
-            pattern.prepend("*");
-        }
+        searchIndex.clear();
 
-        if (!pattern.endsWith("*"))
+        for (auto series : data_series)
         {
-            pattern.append("*");
-        }
+            if (series.isNull()) continue;
 
-        // Convert from wildcard to regular expression
-        QString re_pattern = QRegularExpression::wildcardToRegularExpression(pattern);
-        patterns.append(QRegularExpression(re_pattern, QRegularExpression::CaseInsensitiveOption));
-    }
-
-    for (auto series : data_series)
-    {
-        if (series.isNull())
-        {
-            continue;
+            searchIndex.append(series->getLabel(), series->getGroup());
         }
 
-        QString label = (*series).getLabel();
-
-        // Test if the label matches *ALL* the filters
-        bool matches_all = true;
-
-        for (auto pattern : patterns)
-        {
-            if (!pattern.match(label).hasMatch())
-            {
-                matches_all = false;
-                break;
-            }
-        }
-
-        if (matches_all)
-        {
-            labels.append(label);
-        }
+        searchIndexValid = true;
     }
 
-    return labels;
+    return searchIndex.search(filter_string);
 }
 
 
@@ -150,22 +123,34 @@ bool DataSource::addSeries(DataSeriesPointer series, bool auto_color)
         return false;
     }
 
-    for (auto s : data_series.values())
+    if (containsSeries(series))
     {
-        if (s == series)
-        {
-            qWarning() << "Attempting to add duplicate DataSeries";
-            return false;
-        }
+        qWarning() << "Attempting to add duplicate DataSeries";
+        return false;
+    }
+
+    // Series created elsewhere (e.g. by an importer plugin) are moved to the application data store
+    auto store = DataStore::getDefault();
+
+    if (store && series->getDataStore() != store)
+    {
+        series->setDataStore(store);
     }
 
-    data_series[series->getLabel()] = series;
+    insertSeries(series);
 
     if (auto_color)
     {
         series->setColor(getNextColor());
     }
 
+    series->setTimeScaling(m_timeScale, m_timeOffset, false);
+
+    if (hasTimeWindow())
+    {
+        series->setTimeWindow(getTimeWindowStart(), getTimeWindowEnd(), false);
+    }
+
     emit dataChanged();
 
     return true;
@@ -199,11 +184,23 @@ bool DataSource::addSeries(QString label, bool auto_color)
  */
 DataSeriesPointer DataSource::getSeriesByIndex(unsigned int index)
 {
-    QList<QString> keys = data_series.keys();
+    // The order is rebuilt after series are added or removed, rather than for each index
+    if (!seriesOrderValid)
+    {
+        seriesOrder.clear();
+        seriesOrder.reserve(data_series.size());
 
-    if (index < (unsigned int) keys.length())
+        for (auto it = data_series.constBegin(); it != data_series.constEnd(); ++it)
+        {
+            seriesOrder.append(it.value());
+        }
+
+        seriesOrderValid = true;
+    }
+
+    if (index < (unsigned int) seriesOrder.size())
     {
-        return data_series[keys[index]];
+        return seriesOrder[index];
     }
 
     // No match found
@@ -211,25 +208,77 @@ DataSeriesPointer DataSource::getSeriesByIndex(unsigned int index)
 }
 
 
+/*
+ * Return true if the series belongs to this source
+ */
+bool DataSource::containsSeries(const DataSeriesPointer& series) const
+{
+    if (series.isNull()) return false;
+
+    const auto id = LabelRegistry::getInstance()->find(series->getLabel());
+
+    if (id != LabelRegistry::INVALID_ID && seriesById.value(id) == series) return true;
+
+    // The series may have been renamed since it was added
+    for (auto it = data_series.constBegin(); it != data_series.constEnd(); ++it)
+    {
+        if (it.value() == series) return true;
+    }
+
+    return false;
+}
+
+
 bool DataSource::removeSeries(DataSeriesPointer series, bool update)
 {
-    for (QString label : data_series.keys())
+    if (series.isNull()) return false;
+
+    QString label = series->getLabel();
+
+    // The series may have been renamed since it was added
+    if (data_series.value(label) != series)
     {
-        if (data_series.value(label) == series)
-        {
-            data_series.remove(label);
+        label = data_series.key(series);
 
-            if (update)
-            {
-                emit dataChanged();
-            }
+        if (label.isNull()) return false;
+    }
 
-            return true;
-        }
+    eraseSeries(label);
+
+    if (update)
+    {
+        emit dataChanged();
     }
 
-    // No matching series found
-    return false;
+    return true;
+}
+
+
+/*
+ * Add a series to the lookup tables (replacing any series with the same label)
+ */
+void DataSource::insertSeries(const DataSeriesPointer& series)
+{
+    const QString label = series->getLabel();
+
+    data_series[label] = series;
+    seriesById[LabelRegistry::getInstance()->intern(label)] = series;
+
+    searchIndexValid = false;
+    seriesOrderValid = false;
+}
+
+
+/*
+ * Remove the series with the specified label from the lookup tables
+ */
+void DataSource::eraseSeries(const QString& label)
+{
+    data_series.remove(label);
+    seriesById.remove(LabelRegistry::getInstance()->find(label));
+
+    searchIndexValid = false;
+    seriesOrderValid = false;
 }
 
 
@@ -240,9 +289,11 @@ bool DataSource::removeSeries(DataSeriesPointer series, bool update)
  */
 DataSeriesPointer DataSource::getSeriesByLabel(QString label)
 {
-    if (data_series.contains(label))
+    const auto id = LabelRegistry::getInstance()->find(label);
+
+    if (id != LabelRegistry::INVALID_ID)
     {
-        return data_series[label];
+        return seriesById.value(id);
     }
 
     // No match found - return a null series
@@ -254,7 +305,7 @@ bool DataSource::removeSeriesByLabel(QString label, bool update)
 {
     if (data_series.contains(label))
     {
-        data_series.remove(label);
+        eraseSeries(label);
 
         if (update)
         {
@@ -273,6 +324,10 @@ bool DataSource::removeSeriesByLabel(QString label, bool update)
 void DataSource::removeAllSeries(bool update)
 {
     data_series.clear();
+    seriesById.clear();
+
+    searchIndexValid = false;
+    seriesOrderValid = false;
 
     if (update)
     {
@@ -300,3 +355,176 @@ QStringList DataSource::getGroupLabels() const
 }
 
 
+/*
+ * Return the total memory used by the series of this source (see DataSeries::getMemoryUsage)
+ */
+DataMemoryUsage DataSource::getMemoryUsage() const
+{
+    DataMemoryUsage usage;
+
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) usage += series->getMemoryUsage();
+    }
+
+    return usage;
+}
+
+
+/**
+ * @brief DataSource::setTimeScaling - Map the time base of this source onto the aligned time of the plots,
+ * t = raw * scale + offset (e.g. to align logs recorded by devices with different clocks). The samples are not
+ * modified: the mapping is applied to every series of the source (including series added later) as it is read.
+ * @param scale is the clock rate of the aligned time relative to the source (must be positive)
+ * @param offset is the aligned time of a raw timestamp of zero (ms)
+ * @return false if the scaling is invalid
+ */
+bool DataSource::setTimeScaling(double scale, double offset, bool update)
+{
+    if (!(scale > 0) || !std::isfinite(scale) || !std::isfinite(offset)) return false;
+
+    m_timeScale = scale;
+    m_timeOffset = offset;
+
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) series->setTimeScaling(scale, offset, update);
+    }
+
+    if (update)
+    {
+        emit dataChanged();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief DataSource::setTimeWindow - Crop every series of the source (including series added later) to the samples
+ * with t_min <= t <= t_max (aligned time), e.g. to a single test phase of a long log. The samples are not modified
+ * (see DataSeries::setTimeWindow), so the crop is immediate, and can be removed with clearTimeWindow.
+ */
+void DataSource::setTimeWindow(double t_min, double t_max, bool update)
+{
+    if (t_min > t_max) std::swap(t_min, t_max);
+
+    // Stored in the time base of the source, so the window moves with the samples if the source is realigned
+    m_windowStart = (t_min - m_timeOffset) / m_timeScale;
+    m_windowEnd = (t_max - m_timeOffset) / m_timeScale;
+
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) series->setTimeWindow(t_min, t_max, update);
+    }
+
+    if (update)
+    {
+        emit dataChanged();
+    }
+}
+
+
+void DataSource::clearTimeWindow(bool update)
+{
+    m_windowStart = -std::numeric_limits<double>::infinity();
+    m_windowEnd = std::numeric_limits<double>::infinity();
+
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) series->clearTimeWindow(update);
+    }
+
+    if (update)
+    {
+        emit dataChanged();
+    }
+}
+
+
+/*
+ * Discard the cached (decoded) columns of every series of this source
+ */
+void DataSource::releaseCaches()
+{
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) series->releaseCaches();
+    }
+}
+
+
+/*
+ * Enable compressed storage for every series of this source (see DataSeries::setCompressionEnabled)
+ */
+void DataSource::compressSeries()
+{
+    for (const auto& series : data_series)
+    {
+        if (!series.isNull()) series->setCompressionEnabled(true);
+    }
+}
+
+
+/*
+ * Share the timestamp columns of the series of this source which have identical timestamps (e.g. the
+ * columns of a table, see DataSeries::shareTimestamps). Each series is compared with (a limited number of)
+ * reference series, and becomes a reference itself if any of its timestamp columns are still unshared.
+ * Returns the number of blocks which were shared.
+ */
+size_t DataSource::shareTimestamps()
+{
+    TRACE_SCOPE("Share timestamps", "import");
+
+    QList<DataSeriesPointer> references;
+
+    size_t shared = 0;
+
+    for (const auto& series : data_series)
+    {
+        // A series which is loaded on demand is not loaded to compare it
+        if (series.isNull() || !series->isLoaded() || series->size() < DataBlock::CAPACITY) continue;
+
+        for (const auto& reference : references)
+        {
+            if (!series->hasTimestampColumns()) break;
+
+            shared += series->shareTimestamps(*reference);
+        }
+
+        if (series->hasTimestampColumns() && references.size() < MAX_TIMESTAMP_REFERENCES)
+        {
+            references.append(series);
+        }
+    }
+
+    return shared;
+}
+
+
+/*
+ * Move the samples of every series of this source to a memory-mapped store, so that they consume
+ * address space rather than heap. The default store is used if there is one (see DataStore::getDefault),
+ * otherwise a scratch file is created for the source (a series which is not loaded yet is loaded into the store).
+ * Returns false if the scratch file could not be created.
+ */
+bool DataSource::spillToStore()
+{
+    auto store = DataStore::getDefault();
+
+    if (!store)
+    {
+        store = std::make_shared<DataStore>();
+
+        if (!store->isValid()) return false;
+    }
+
+    for (const auto& series : data_series)
+    {
+        if (series.isNull() || series->getDataStore() == store) continue;
+
+        series->setDataStore(store);
+    }
+
+    return true;
+}
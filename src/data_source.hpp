@@ -6,7 +6,11 @@
 #include <qvector.h>
 #include <QFileInfo>
 
+#include <limits>
+
 #include "data_series.hpp"
+#include "label_registry.hpp"
+#include "series_search_index.hpp"
 
 
 /**
@@ -29,6 +33,9 @@ public:
     DataSource(QString source, QString label, QString description = QString());
     virtual ~DataSource();
 
+    //! Maximum number of distinct timestamp columns with which each series is compared (see shareTimestamps)
+    static const int MAX_TIMESTAMP_REFERENCES = 8;
+
     QString getIdentifier(void) const;
 
     QString getSource(void) const { return m_source; }
@@ -42,6 +49,9 @@ public:
     int getSeriesCount(void) const { return data_series.size(); }
     QStringList getSeriesLabels(QString filter_string=QString()) const;
 
+    //! Rebuild the search index when it is next used (e.g. after the group of a series is changed)
+    void invalidateSearchIndex(void) { searchIndexValid = false; }
+
     QStringList getGroupLabels(void) const;
 
     bool addSeries(DataSeriesPointer series, bool auto_color = true);
@@ -50,12 +60,38 @@ public:
 
     DataSeriesPointer getSeriesByIndex(unsigned int index);
     DataSeriesPointer getSeriesByLabel(QString label);
+    DataSeriesPointer getSeriesById(LabelRegistry::Id id) const { return seriesById.value(id); }
+
+    bool containsSeries(const DataSeriesPointer& series) const;
 
     bool removeSeries(DataSeriesPointer series, bool update = true);
     bool removeSeriesByLabel(QString label, bool update = true);
 
     void removeAllSeries(bool update = true);
 
+    /* Time alignment (applied to every series of the source, see DataSeries::setTimeScaling) */
+    double getTimeScale(void) const { return m_timeScale; }
+    double getTimeOffset(void) const { return m_timeOffset; }
+    bool setTimeScaling(double scale, double offset, bool update = true);
+
+    /* Time window (applied to every series of the source, see DataSeries::setTimeWindow) */
+    void setTimeWindow(double t_min, double t_max, bool update = true);
+    void clearTimeWindow(bool update = true);
+
+    bool hasTimeWindow(void) const { return m_windowStart > -std::numeric_limits<double>::infinity() || m_windowEnd < std::numeric_limits<double>::infinity(); }
+
+    //! Aligned time of the start and end of the time window (-inf and inf if there is no window)
+    double getTimeWindowStart(void) const { return m_windowStart * m_timeScale + m_timeOffset; }
+    double getTimeWindowEnd(void) const { return m_windowEnd * m_timeScale + m_timeOffset; }
+
+    /* Memory management functions */
+    DataMemoryUsage getMemoryUsage(void) const;
+
+    void releaseCaches(void);
+    void compressSeries(void);
+    size_t shareTimestamps(void);
+    bool spillToStore(void);
+
 signals:
     void dataChanged(void);
 
@@ -70,6 +106,14 @@ protected:
     //! Text description associated with this DataSource
     QString m_description;
 
+    //! Mapping from the time base of the source to the aligned time (t = raw * m_timeScale + m_timeOffset)
+    double m_timeScale = 1.0;
+    double m_timeOffset = 0.0;
+
+    //! Time window of the series, in the time base of the source (see setTimeWindow)
+    double m_windowStart = -std::numeric_limits<double>::infinity();
+    double m_windowEnd = std::numeric_limits<double>::infinity();
+
     //! Circular list of colors to auto-assign to new series
     virtual QList<QColor> getColorWheel(void);
 
@@ -78,8 +122,22 @@ protected:
     //! Cursor for selecting next color
     int color_wheel_cursor = 0;
 
-    // Keep a map of label:series for efficient lookup
+    // Keep a map of label:series (in label order)
     QMap<QString, DataSeriesPointer> data_series;
+
+    //! Series by the ID of their label (see LabelRegistry), for lookups which do not compare labels
+    QHash<LabelRegistry::Id, DataSeriesPointer> seriesById;
+
+    //! Series in label order (see getSeriesByIndex), rebuilt after series are added or removed
+    mutable QVector<DataSeriesPointer> seriesOrder;
+    mutable bool seriesOrderValid = false;
+
+    void insertSeries(const DataSeriesPointer& series);
+    void eraseSeries(const QString& label);
+
+    //! Index of the series labels and groups (see getSeriesLabels)
+    mutable SeriesSearchIndex searchIndex;
+    mutable bool searchIndexValid = false;
 };
 
 
@@ -1,89 +1,194 @@
+#include <algorithm>
+
 #include <QDir>
 #include <QFileInfo>
-#include <QProgressDialog>
-#include <QApplication>
-#include <QThread>
 
 #include "data_source_manager.hpp"
+#include "import_cache.hpp"
+#include "trace_recorder.hpp"
 
 #include "plugin_registry.hpp"
 #include "lumberjack_settings.hpp"
 
 
 
-DataImportWorker::DataImportWorker(QSharedPointer<ImportPlugin> plugin) : m_plugin(plugin)
+DataIOJob::DataIOJob() : m_token(std::make_shared<CancellationToken>())
 {
+    // The job is deleted by its owner, once it has completed
+    setAutoDelete(false);
+
+    connect(&progressTimer, &QTimer::timeout, this, &DataIOJob::updateProgress);
 }
 
 
-void DataImportWorker::runImport()
+DataIOJob::~DataIOJob()
 {
-    m_errors.clear();
+    wait();
+}
+
+
+/**
+ * @brief DataIOJob::start - Run the job (once) on a thread pool
+ */
+void DataIOJob::start(QThreadPool *pool)
+{
+    m_mutex.lock();
+    m_running = true;
+    m_mutex.unlock();
+
+    progressTimer.start(PROGRESS_INTERVAL);
+
+    pool->start(this);
+}
+
+
+/**
+ * @brief DataIOJob::cancel - Request that the job stops (it still completes, with the result so far)
+ */
+void DataIOJob::cancel(void)
+{
+    if (m_token->isCancelled()) return;
+
+    m_token->cancel();
+
+    onCancelled();
+}
+
 
-    if (m_plugin)
+/**
+ * @brief DataIOJob::wait - Block until the job has returned (if it is running)
+ */
+void DataIOJob::wait(void)
+{
+    m_mutex.lock();
+
+    while (m_running)
     {
-        m_result = m_plugin->importData(m_errors);
+        m_returned.wait(&m_mutex);
     }
-    else
+
+    m_mutex.unlock();
+}
+
+
+void DataIOJob::run(void)
+{
+    m_errors.clear();
+
+    m_result = execute(m_errors);
+
+    if (m_token->isCancelled())
     {
         m_result = false;
     }
 
     m_complete = true;
 
-    emit importCompleted();
+    // Completion is signalled by the owning thread
+    QMetaObject::invokeMethod(this, &DataIOJob::onReturned, Qt::QueuedConnection);
+
+    m_mutex.lock();
+    m_running = false;
+    m_returned.wakeAll();
+    m_mutex.unlock();
 }
 
 
-void DataImportWorker::cancelImport()
+void DataIOJob::updateProgress(void)
 {
-    if (m_plugin)
+    const int progress = getProgress();
+
+    if (progress != m_progress)
     {
-        m_plugin->cancelImport();
-        m_result = false;
+        m_progress = progress;
+
+        emit progressChanged(progress);
     }
+}
 
-    m_errors.append(tr("Import process cancelled"));
 
-    m_complete = true;
+void DataIOJob::onReturned(void)
+{
+    // The pool thread may still be releasing the job
+    wait();
+
+    progressTimer.stop();
+
+    emit completed(m_result);
 }
 
 
-DataExportWorker::DataExportWorker(QSharedPointer<ExportPlugin> plugin, QList<DataSeriesPointer> &series)
-    : m_plugin(plugin), m_series(series)
+DataImportJob::DataImportJob(QSharedPointer<ImportPlugin> plugin) : m_plugin(plugin)
 {
 }
 
 
-void DataExportWorker::runExport()
+int DataImportJob::getProgress(void) const
 {
-    m_errors.clear();
+    return m_plugin ? m_plugin->getImportProgress() : 0;
+}
 
-    if (m_plugin)
-    {
-        m_result = m_plugin->exportData(m_series, m_errors);
-    }
-    else
+
+bool DataImportJob::execute(QStringList &errors)
+{
+    if (!m_plugin) return false;
+
+    TRACE_SCOPE("Import", "import");
+
+    m_plugin->setCancellationToken(m_token);
+
+    const bool result = m_plugin->importData(errors);
+
+    if (isCancelled())
     {
-        m_result = false;
+        errors.append(tr("Import process cancelled"));
     }
 
-    m_complete = true;
-    emit exportCompleted();
+    return result;
+}
+
+
+void DataImportJob::onCancelled(void)
+{
+    // Plugins which do not poll the token are cancelled directly
+    if (m_plugin) m_plugin->cancelImport();
+}
+
+
+DataExportJob::DataExportJob(QSharedPointer<ExportPlugin> plugin, QList<DataSeriesPointer> &series)
+    : m_plugin(plugin), m_series(series)
+{
 }
 
 
-void DataExportWorker::cancelExport()
+int DataExportJob::getProgress(void) const
 {
-    if (m_plugin)
+    return m_plugin ? m_plugin->getExportProgress() : 0;
+}
+
+
+bool DataExportJob::execute(QStringList &errors)
+{
+    if (!m_plugin) return false;
+
+    TRACE_SCOPE("Export", "export");
+
+    m_plugin->setCancellationToken(m_token);
+
+    const bool result = m_plugin->exportData(m_series, errors);
+
+    if (isCancelled())
     {
-        m_plugin->cancelExport();
-        m_result = false;
+        errors.append(tr("Export process cancelled"));
     }
 
-    m_errors.append(tr("Export process cancelled"));
+    return result;
+}
 
-    m_complete = true;
+
+void DataExportJob::onCancelled(void)
+{
+    if (m_plugin) m_plugin->cancelExport();
 }
 
 
@@ -92,11 +197,43 @@ DataSourceManager *DataSourceManager::instance = 0;
 
 DataSourceManager::DataSourceManager()
 {
+    connect(&importTimer, &QTimer::timeout, this, &DataSourceManager::updateImports);
+
+    followTimer.setSingleShot(true);
+
+    connect(&followTimer, &QTimer::timeout, this, &DataSourceManager::updateFollowedFiles);
+    connect(&fileWatcher, &QFileSystemWatcher::fileChanged, this, &DataSourceManager::onFileChanged);
 }
 
 
 DataSourceManager::~DataSourceManager()
 {
+    cancelImports(true);
+    cancelExports(true);
+
+    for (auto session : imports)
+    {
+        session->release();
+
+        delete session->job;
+    }
+
+    imports.clear();
+
+    for (auto session : exports)
+    {
+        delete session->job;
+    }
+
+    exports.clear();
+
+    for (auto session : follows)
+    {
+        session->release();
+    }
+
+    follows.clear();
+
     removeAllSources(false);
 }
 
@@ -111,6 +248,37 @@ DataSeriesPointer DataSourceManager::findSeries(QString source_label, QString se
 }
 
 
+/**
+ * @brief DataSourceManager::findSeries - Find a series by the IDs of its labels (see LabelRegistry::intern),
+ * which does not compare (or hash) the labels
+ */
+DataSeriesPointer DataSourceManager::findSeries(LabelRegistry::Id source_id, LabelRegistry::Id series_id)
+{
+    auto source = getSourceById(source_id);
+
+    if (source.isNull()) return DataSeriesPointer(nullptr);
+
+    return source->getSeriesById(series_id);
+}
+
+
+/**
+ * @brief DataSourceManager::findSource - Find the source which contains a series
+ * @return the source, or nullptr if the series is not part of any source
+ */
+DataSourcePointer DataSourceManager::findSource(DataSeriesPointer series)
+{
+    if (series.isNull()) return DataSourcePointer(nullptr);
+
+    for (auto src : sources)
+    {
+        if (!src.isNull() && src->containsSeries(series)) return src;
+    }
+
+    return DataSourcePointer(nullptr);
+}
+
+
 QStringList DataSourceManager::getSourceLabels() const
 {
     QStringList labels;
@@ -136,17 +304,36 @@ DataSourcePointer DataSourceManager::getSourceByIndex(unsigned int idx)
 
 DataSourcePointer DataSourceManager::getSourceByLabel(QString label)
 {
+    const auto id = LabelRegistry::getInstance()->find(label);
+
+    if (id == LabelRegistry::INVALID_ID) return DataSourcePointer(nullptr);
+
+    return getSourceById(id);
+}
+
+
+/*
+ * Update the lookup table after a source is removed (another source may have the same label)
+ */
+void DataSourceManager::unindexSource(DataSourcePointer source)
+{
+    if (source.isNull()) return;
+
+    const QString label = source->getLabel();
+    const auto id = LabelRegistry::getInstance()->find(label);
+
+    if (sourcesById.value(id) != source) return;
+
+    sourcesById.remove(id);
+
     for (auto src : sources)
     {
-        if (src.isNull()) continue;
-
-        if (src->getLabel() == label)
+        if (!src.isNull() && src->getLabel() == label)
         {
-            return src;
+            sourcesById.insert(id, src);
+            break;
         }
     }
-
-    return DataSourcePointer(nullptr);
 }
 
 
@@ -170,6 +357,13 @@ bool DataSourceManager::addSource(DataSourcePointer source)
 
     sources.push_back(source);
 
+    const auto id = LabelRegistry::getInstance()->intern(source->getLabel());
+
+    if (!sourcesById.contains(id))
+    {
+        sourcesById.insert(id, source);
+    }
+
     connect(source.data(), &DataSource::dataChanged, this, &DataSourceManager::onDataChanged);
 
     emit sourcesChanged();
@@ -209,6 +403,8 @@ bool DataSourceManager::removeSource(DataSourcePointer source)
         if (src == source)
         {
             sources.removeAt(idx);
+            unindexSource(src);
+
             emit sourcesChanged();
             return true;
         }
@@ -228,7 +424,10 @@ bool DataSourceManager::removeSourceByIndex(unsigned int idx, bool update)
 {
     if (idx < sources.size())
     {
+        auto src = sources.at(idx);
+
         sources.removeAt(idx);
+        unindexSource(src);
 
         if (update)
         {
@@ -282,17 +481,80 @@ void DataSourceManager::removeAllSources(bool update)
 }
 
 
+/**
+ * @brief DataSourceManager::importData - Import data from a file (or from files selected by the user)
+ * @param filename - The file to import, or empty to select files
+ * @return true if any file is imported (the import continues in the background)
+ */
 bool DataSourceManager::importData(QString filename)
 {
-    auto registry = PluginRegistry::getInstance();
-    auto settings = LumberjackSettings::getInstance();
+    QStringList filenames;
 
     if (filename.isEmpty())
     {
-        filename = registry->getFilenameForImport();
+        filenames = PluginRegistry::getInstance()->getFilenamesForImport();
+    }
+    else
+    {
+        filenames.append(filename);
+    }
+
+    return importFiles(filenames) > 0;
+}
+
+
+/**
+ * @brief DataSourceManager::importFiles - Import data from a list of files (e.g. files dropped onto the window).
+ * The import options are only requested once for files which have the same layout (see ImportPlugin::reuseImportOptions).
+ * Files are imported concurrently, but only a limited number at once (see getMaxConcurrentImports); the rest are queued.
+ * @param filenames
+ * @return the number of files which are imported (or queued for import)
+ */
+int DataSourceManager::importFiles(QStringList filenames)
+{
+    // Importers which have requested options from the user in this batch
+    QList<QSharedPointer<ImportPlugin>> configured;
+
+    int count = 0;
+
+    for (const QString &filename : filenames)
+    {
+        QSharedPointer<DataImportSession> session;
+
+        if (!prepareImport(filename, configured, session))
+        {
+            continue;
+        }
+
+        count++;
+
+        // Otherwise the series were loaded from the cache
+        if (!session.isNull())
+        {
+            pendingImports.append(session);
+            importTotal++;
+        }
     }
 
-    // Still empty? No further actions
+    startPendingImports();
+
+    return count;
+}
+
+
+/**
+ * @brief DataSourceManager::prepareImport - Select an importer for a file, and configure the import
+ * @param filename - The file to import
+ * @param configured - Importers which have already been configured by the user (the list is extended)
+ * @param session - Set to the import session, unless the series were loaded from the cache
+ * @return true if the file is imported
+ */
+bool DataSourceManager::prepareImport(QString filename, QList<QSharedPointer<ImportPlugin>> &configured, QSharedPointer<DataImportSession> &session)
+{
+    auto registry = PluginRegistry::getInstance();
+    auto settings = LumberjackSettings::getInstance();
+
+    // Empty? No further actions
     if (filename.isEmpty())
     {
         return false;
@@ -315,7 +577,7 @@ bool DataSourceManager::importData(QString filename)
     {
         if (plugin.isNull()) continue;
 
-        if (plugin->supportsFileType(fi.suffix()))
+        if (plugin->supportsFile(filename))
         {
             importers.append(plugin);
         }
@@ -339,6 +601,24 @@ bool DataSourceManager::importData(QString filename)
         importer = importers.first();
     }
 
+    // Each import has its own instance of the importer, if the plugin supports it
+    auto instance = importer->createInstance();
+
+    if (!instance.isNull())
+    {
+        importer = instance;
+    }
+
+    // Otherwise the importer only imports one file at a time
+    for (auto other : imports + pendingImports + follows)
+    {
+        if (other->importer == importer)
+        {
+            qWarning() << "Import already running with" << importer->pluginName() << "- cannot import" << filename;
+            return false;
+        }
+    }
+
     QStringList errors;
 
     if (!importer->validateFile(filename, errors))
@@ -351,89 +631,534 @@ bool DataSourceManager::importData(QString filename)
 
     importer->setFilename(filename);
 
-    if (!importer->beforeImport())
+    // The user is only asked for options once, for files with the same layout
+    bool reused = false;
+
+    for (auto previous : configured)
     {
-        // TODO: error message?
-        return false;
+        if (previous->pluginName() == importer->pluginName() && importer->reuseImportOptions(*previous))
+        {
+            reused = true;
+            break;
+        }
+    }
+
+    if (!reused)
+    {
+        if (!importer->beforeImport())
+        {
+            // TODO: error message?
+            return false;
+        }
+
+        configured.append(importer);
+    }
+
+    // A file which is followed is imported from the file itself, as it is expected to change
+    const bool follow = importer->isFollowEnabled();
+
+    // Series from a previous import of the same file (with the same options) are re-used
+    const bool useCache = !follow && settings->loadBoolean("import", "cache", true);
+
+    const QByteArray cacheKey = ImportCache::getKey(
+        fi.absoluteFilePath(),
+        importer->pluginName() + " " + importer->pluginVersion(),
+        importer->getOptionsKey()
+    );
+
+    QList<DataSeriesPointer> cachedSeries;
+
+    if (useCache && ImportCache::load(fi.absoluteFilePath(), cacheKey, cachedSeries) && cachedSeries.count() > 0)
+    {
+        qDebug() << "Loaded cached data for" << filename;
+
+        DataSource *source = new DataSource(
+            importer->pluginName(),
+            fi.fileName(),
+            fi.absoluteFilePath()
+        );
+
+        for (auto series : cachedSeries)
+        {
+            source->addSeries(series);
+        }
+
+        source->shareTimestamps();
+
+        addSource(source);
+
+        return true;
+    }
+
+    session = QSharedPointer<DataImportSession>(new DataImportSession);
+
+    session->importer = importer;
+    session->filename = fi.absoluteFilePath();
+    session->cacheKey = cacheKey;
+    session->useCache = useCache;
+    session->follow = follow;
+
+    // The source is displayed once the import starts, and its series as they are created (see updateImports)
+    session->source = DataSourcePointer(new DataSource(
+        importer->pluginName(),
+        fi.fileName(),
+        fi.absoluteFilePath()
+    ));
+
+    return true;
+}
+
+
+/**
+ * @brief DataSourceManager::getMaxConcurrentImports - The number of files which are imported at once
+ */
+int DataSourceManager::getMaxConcurrentImports(void) const
+{
+    auto settings = LumberjackSettings::getInstance();
+
+    return std::max(1, settings->loadSetting("import", "maxConcurrent", DEFAULT_CONCURRENT_IMPORTS).toInt());
+}
+
+
+/**
+ * @brief DataSourceManager::startPendingImports - Start queued imports, while fewer than the maximum are running
+ */
+void DataSourceManager::startPendingImports(void)
+{
+    const int maxImports = getMaxConcurrentImports();
+
+    while (!pendingImports.isEmpty() && imports.count() < maxImports)
+    {
+        startImport(pendingImports.takeFirst());
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::startImport - Start an import in the background
+ */
+void DataSourceManager::startImport(QSharedPointer<DataImportSession> session)
+{
+    if (!addSource(session->source))
+    {
+        importDone++;
+
+        session->release();
+
+        emit importFinished(session->filename, false);
+        return;
+    }
+
+    // The samples of the import are stored by the sink, if the importer supports it
+    if (session->importer->supportsImportSink())
+    {
+        auto settings = LumberjackSettings::getInstance();
+
+        session->sink = QSharedPointer<SeriesImportSink>(new SeriesImportSink());
+        session->sink->setCompressionEnabled(settings->loadBoolean("import", "compression", false));
+
+        session->importer->setImportSink(session->sink.data());
+    }
+
+    // The import runs on the shared thread pool
+    session->job = new DataImportJob(session->importer);
+
+    // Completion is handled by the GUI thread, once the job has returned
+    connect(session->job, &DataIOJob::completed, this, [this, session]() {
+        finishImport(session);
+    });
+
+    connect(session->job, &DataIOJob::progressChanged, this, [this, session](int progress) {
+        emit importProgress(session->filename, progress);
+    });
+
+    imports.append(session);
+
+    if (!importTimer.isActive())
+    {
+        importTimer.start(IMPORT_UPDATE_INTERVAL);
+    }
+
+    qDebug() << "Importing data from" << session->filename;
+
+    session->job->start();
+}
+
+
+/**
+ * @brief DataSourceManager::isImporting - Determine if any import is running
+ */
+bool DataSourceManager::isImporting(void) const
+{
+    return !imports.isEmpty() || !pendingImports.isEmpty();
+}
+
+
+/**
+ * @brief DataSourceManager::cancelImports - Cancel every running import
+ * @param wait - If true, wait for each import to stop (otherwise each import completes in the background)
+ */
+void DataSourceManager::cancelImports(bool wait)
+{
+    for (auto session : QList<QSharedPointer<DataImportSession>>(pendingImports))
+    {
+        cancelImport(session->filename);
+    }
+
+    for (auto session : imports)
+    {
+        session->cancelled = true;
+        session->job->cancel();
+
+        if (wait)
+        {
+            session->job->wait();
+        }
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::cancelImport - Cancel the import of a file (which is running, or queued)
+ * @param filename - The file, as returned by getImportFilenames
+ */
+void DataSourceManager::cancelImport(QString filename)
+{
+    for (auto session : pendingImports)
+    {
+        if (session->filename != filename) continue;
+
+        pendingImports.removeAll(session);
+        importDone++;
+
+        session->release();
+
+        emit importFinished(filename, false);
+
+        resetImportProgress();
+        return;
+    }
+
+    for (auto session : imports)
+    {
+        if (session->filename != filename || session->cancelled) continue;
+
+        session->cancelled = true;
+        session->job->cancel();
+        return;
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::getImportFilenames - The files which are being imported, followed by those which are queued
+ */
+QStringList DataSourceManager::getImportFilenames(void) const
+{
+    QStringList filenames;
+
+    for (auto session : imports + pendingImports)
+    {
+        filenames.append(session->filename);
+    }
+
+    return filenames;
+}
+
+
+/**
+ * @brief DataSourceManager::getImportProgress - The progress of the import of a file
+ * @return the percentage {0:100}, or -1 if the import is queued (or the file is not being imported)
+ */
+int DataSourceManager::getImportProgress(QString filename) const
+{
+    for (auto session : imports)
+    {
+        if (session->filename == filename) return session->importer->getImportProgress();
     }
 
-    QProgressDialog progress;
+    return -1;
+}
 
-    progress.setWindowTitle(tr("Importing Data"));
-    progress.setMinimum(0);
-    progress.setMaximum(100);
-    progress.setValue(0);
-    progress.setLabelText(tr("Importing data from file"));
 
-    progress.show();
+/**
+ * @brief DataSourceManager::getTotalImportProgress - The progress of every file in the current batch of imports
+ * @return the percentage {0:100}
+ */
+int DataSourceManager::getTotalImportProgress(void) const
+{
+    if (importTotal <= 0) return 0;
 
-    QApplication::processEvents();
+    int progress = importDone * 100;
 
-    // Spawn a new thread for importing
-    auto worker = DataImportWorker(importer);
-    auto *thread = new QThread;
+    for (auto session : imports)
+    {
+        progress += session->importer->getImportProgress();
+    }
 
-    worker.moveToThread(thread);
+    return std::min(100, progress / importTotal);
+}
 
-    connect(&worker, &DataImportWorker::importCompleted, thread, &QThread::quit);
-    connect(thread, &QThread::started, &worker, &DataImportWorker::runImport);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
 
-    thread->start();
+/*
+ * Once every import has finished, the next import starts a new batch
+ */
+void DataSourceManager::resetImportProgress(void)
+{
+    if (imports.isEmpty() && pendingImports.isEmpty())
+    {
+        importTotal = 0;
+        importDone = 0;
+    }
+}
 
-    qDebug() << "Importing data from" << filename;
 
-    while (!thread->isFinished() && !worker.isComplete())
+/**
+ * @brief DataSourceManager::updateImports - Publish the progress of each running import.
+ * Called periodically (every IMPORT_UPDATE_INTERVAL) while any import is running:
+ * - Series which the importer has created since the last update are added to the source
+ * - Series which have grown are updated, so that any plot of the series is re-drawn (see PlotWidget::scheduleDataUpdate)
+ * - An import is cancelled if its source has been removed
+ */
+void DataSourceManager::updateImports()
+{
+    for (auto session : imports)
     {
-        // Check for manual cancel of import process
-        if (progress.wasCanceled())
+        if (session->cancelled) continue;
+
+        if (!sources.contains(session->source))
         {
-            worker.cancelImport();
-            thread->wait();
+            qInfo() << "Cancelling import of removed source:" << session->source->getLabel();
+
+            session->cancelled = true;
+            session->job->cancel();
+            continue;
         }
 
-        progress.setValue(importer->getImportProgress());
+        publishImport(*session);
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::publishImport - Add any new series to the source of an import, and update any series which have grown
+ */
+void DataSourceManager::publishImport(DataImportSession &session)
+{
+    TRACE_SCOPE("Publish Import", "import");
+
+    bool added = false;
+
+    // Adding many series (e.g. one per column) only refreshes the data view once
+    session.source->blockSignals(true);
+
+    for (auto series : session.getDataSeries())
+    {
+        if (series.isNull() || session.sizes.contains(series.data())) continue;
+
+        session.source->addSeries(series);
+        session.sizes.insert(series.data(), 0);
 
-        QApplication::processEvents();
-        QThread::msleep(100);
+        added = true;
     }
 
-    progress.cancel();
-    progress.close();
+    session.source->blockSignals(false);
 
-    for (QString err : worker.getErrors())
+    if (added)
+    {
+        emit sourcesChanged();
+    }
+
+    for (auto series : session.source->getSeriesLabels())
+    {
+        auto s = session.source->getSeriesByLabel(series);
+
+        // A series which is loaded on demand is not loaded just to check its size
+        if (s.isNull() || !s->isLoaded() || !session.sizes.contains(s.data())) continue;
+
+        const size_t n = s->size();
+
+        if (n != session.sizes.value(s.data()))
+        {
+            session.sizes[s.data()] = n;
+
+            s->update();
+        }
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::finishImport - Complete an import, once the job has returned
+ */
+void DataSourceManager::finishImport(QSharedPointer<DataImportSession> session)
+{
+    const bool result = session->job->getResult() && !session->cancelled;
+
+    for (QString err : session->job->getErrors())
     {
         // TODO: Display these better?
         qWarning() << "Import err:" << err;
     }
 
-    if (worker.getResult())
+    // The job is still emitting completed
+    session->job->deleteLater();
+    session->job = nullptr;
+
+    imports.removeAll(session);
+    importDone++;
+
+    // The next queued file is imported in place of this one
+    startPendingImports();
+
+    if (imports.isEmpty())
     {
-        // Create a new instance of the provided importer
-        DataSource *source = new DataSource(
-            importer->pluginName(),
-            fi.fileName(),
-            fi.absoluteFilePath()
-        );
+        importTimer.stop();
+    }
 
+    if (sources.contains(session->source))
+    {
+        publishImport(*session);
 
-        auto seriesList = importer->getDataSeries();
+        // Columns of the same table share one copy of their timestamps
+        session->source->shareTimestamps();
 
-        if (seriesList.count() == 0)
+        // A cancelled import retains the series imported so far
+        if (session->source->getSeriesCount() == 0)
         {
-            delete source;
-            return false;
+            removeSource(session->source);
         }
+        else if (result && session->useCache)
+        {
+            auto seriesList = session->getDataSeries();
+
+            // Series which are loaded on demand are not cached (storing them would load every series)
+            bool loaded = true;
+
+            for (const auto& series : seriesList)
+            {
+                loaded &= series->isLoaded();
+            }
+
+            if (loaded)
+            {
+                ImportCache::store(session->filename, session->cacheKey, seriesList);
+            }
+        }
+    }
+
+    // The importer retains its state, so that appended data can be imported
+    if (result && session->follow && sources.contains(session->source))
+    {
+        follows.append(session);
+
+        fileWatcher.addPath(session->filename);
+        followTimer.start(FOLLOW_POLL_INTERVAL);
+    }
+    else
+    {
+        session->release();
+    }
+
+    emit importFinished(session->filename, result);
+
+    resetImportProgress();
+}
+
+
+/**
+ * @brief DataSourceManager::isFollowing - Determine if data appended to the file of a source are imported
+ */
+bool DataSourceManager::isFollowing(DataSourcePointer source) const
+{
+    for (auto session : follows)
+    {
+        if (session->source == source) return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief DataSourceManager::stopFollowing - Stop importing data appended to the file of a source
+ */
+void DataSourceManager::stopFollowing(DataSourcePointer source)
+{
+    for (auto session : follows)
+    {
+        if (session->source != source) continue;
+
+        follows.removeAll(session);
+
+        fileWatcher.removePath(session->filename);
+
+        session->release();
+
+        qInfo() << "Stopped following" << session->filename;
+
+        return;
+    }
+}
+
 
-        for (auto series : importer->getDataSeries())
+/*
+ * Callback when a followed file is modified.
+ * A file which is being written changes continuously, so the appended data are imported after a short delay.
+ */
+void DataSourceManager::onFileChanged(const QString &path)
+{
+    Q_UNUSED(path);
+
+    if (!followTimer.isActive() || followTimer.remainingTime() > FOLLOW_INTERVAL)
+    {
+        followTimer.start(FOLLOW_INTERVAL);
+    }
+}
+
+
+/**
+ * @brief DataSourceManager::updateFollowedFiles - Import any data appended to each followed file.
+ * Each importer only parses the new (complete) lines, and adds the samples to the existing series.
+ */
+void DataSourceManager::updateFollowedFiles()
+{
+    for (auto session : QList<QSharedPointer<DataImportSession>>(follows))
+    {
+        if (!sources.contains(session->source))
         {
-            source->addSeries(series);
+            stopFollowing(session->source);
+            continue;
         }
 
-        addSource(source);
+        QStringList errors;
+
+        const bool result = session->importer->importAppendedData(errors);
+
+        for (QString err : errors)
+        {
+            qWarning() << "Import err:" << err;
+        }
+
+        publishImport(*session);
+
+        if (!result)
+        {
+            stopFollowing(session->source);
+            continue;
+        }
+
+        // A file which is replaced (e.g. by moving a new file into place) is no longer watched
+        if (!fileWatcher.files().contains(session->filename))
+        {
+            fileWatcher.addPath(session->filename);
+        }
     }
 
-    return true;
+    if (!follows.isEmpty())
+    {
+        followTimer.start(FOLLOW_POLL_INTERVAL);
+    }
 }
 
 
@@ -441,9 +1166,10 @@ bool DataSourceManager::importData(QString filename)
  * @brief DataSourceManager::exportData - Export a set of data series to a file
  * @param series
  * @param filename
+ * @param scope - Samples of each series to export (e.g. only those within the visible time range)
  * @return
  */
-bool DataSourceManager::exportData(QList<DataSeriesPointer> &series, QString filename)
+bool DataSourceManager::exportData(QList<DataSeriesPointer> &series, QString filename, const ExportScope &scope)
 {
     auto registry = PluginRegistry::getInstance();
     auto settings = LumberjackSettings::getInstance();
@@ -494,7 +1220,18 @@ bool DataSourceManager::exportData(QList<DataSeriesPointer> &series, QString fil
         exporter = exporters.first();
     }
 
+    // The exporter only exports one set of series at a time
+    for (auto other : exports)
+    {
+        if (other->exporter == exporter)
+        {
+            qWarning() << "Export already running with" << exporter->pluginName() << "- cannot export" << filename;
+            return false;
+        }
+    }
+
     exporter->setFilename(filename);
+    exporter->setScope(scope);
 
     if (!exporter->beforeExport())
     {
@@ -502,56 +1239,78 @@ bool DataSourceManager::exportData(QList<DataSeriesPointer> &series, QString fil
         return false;
     }
 
-    QProgressDialog progress;
+    auto session = QSharedPointer<DataExportSession>(new DataExportSession);
 
-    progress.setWindowTitle(tr("Importing Data"));
-    progress.setMinimum(0);
-    progress.setMaximum(100);
-    progress.setValue(0);
-    progress.setLabelText(tr("Importing data from file"));
+    session->exporter = exporter;
+    session->filename = filename;
 
-    progress.show();
+    // The export runs on the shared thread pool (the series are read through snapshots)
+    session->job = new DataExportJob(exporter, series);
 
-    QApplication::processEvents();
+    connect(session->job, &DataIOJob::completed, this, [this, session]() {
+        finishExport(session);
+    });
 
-    // Spawn a new thread for data export
-    auto worker = DataExportWorker(exporter, series);
-    auto *thread = new QThread();
+    connect(session->job, &DataIOJob::progressChanged, this, [this, session](int progress) {
+        emit exportProgress(session->filename, progress);
+    });
 
-    worker.moveToThread(thread);
+    exports.append(session);
 
-    connect(&worker, &DataExportWorker::exportCompleted, thread, &QThread::quit);
-    connect(thread, &QThread::started, &worker, &DataExportWorker::runExport);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    qDebug() << "Exporting data to" << filename;
 
-    thread->start();
+    session->job->start();
+
+    return true;
+}
+
+
+/**
+ * @brief DataSourceManager::isExporting - Determine if any export is running
+ */
+bool DataSourceManager::isExporting(void) const
+{
+    return !exports.isEmpty();
+}
 
-    qDebug() << "Exporting data to" << filename;
 
-    while (!thread->isFinished() && !worker.isComplete())
+/**
+ * @brief DataSourceManager::cancelExports - Cancel every running export
+ * @param wait - If true, wait for each export to stop (otherwise each export completes in the background)
+ */
+void DataSourceManager::cancelExports(bool wait)
+{
+    for (auto session : exports)
     {
-        if (progress.wasCanceled())
+        session->job->cancel();
+
+        if (wait)
         {
-            worker.cancelExport();
-            thread->wait();
+            session->job->wait();
         }
-
-        progress.setValue(exporter->getExportProgress());
-
-        QApplication::processEvents();
-        QThread::msleep(100);
     }
+}
 
-    progress.cancel();
-    progress.close();
 
-    for (QString err : worker.getErrors())
+/**
+ * @brief DataSourceManager::finishExport - Complete an export, once the job has returned
+ */
+void DataSourceManager::finishExport(QSharedPointer<DataExportSession> session)
+{
+    const bool result = session->job->getResult();
+
+    for (QString err : session->job->getErrors())
     {
         // TODO: Display these better?
         qWarning() << "Export err:" << err;
     }
 
-    bool result = worker.getResult();
+    session->job->deleteLater();
+    session->job = nullptr;
 
-    return result;
+    exports.removeAll(session);
+
+    session->exporter->afterExport();
+
+    emit exportFinished(session->filename, result);
 }
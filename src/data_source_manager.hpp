@@ -1,20 +1,79 @@
 #ifndef DATA_SOURCE_MANAGER_HPP
 #define DATA_SOURCE_MANAGER_HPP
 
-#include <QThread>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWaitCondition>
 
 #include "data_source.hpp"
+#include "import_sink.hpp"
 #include "plugin_importer.hpp"
 #include "plugin_exporter.hpp"
 
 
-class DataIOWorker : public QObject
+/**
+ * @brief The DataIOJob class runs an import or export on the shared thread pool.
+ *
+ * The job is owned by (and signals) the thread which starts it:
+ * - progressChanged is emitted periodically while the job runs, if the progress has changed
+ * - completed is emitted once the job has returned, and its result and errors are available
+ *
+ * Cancelling the job sets its cancellation token, which the plugin can poll (see PluginBase::isCancelled).
+ */
+class DataIOJob : public QObject, public QRunnable
 {
+    Q_OBJECT
+
 public:
+    DataIOJob();
+    virtual ~DataIOJob();
+
+    void start(QThreadPool *pool = QThreadPool::globalInstance());
+    void cancel(void);
+    void wait(void);
+
     bool getResult(void) const { return m_result; }
     QStringList getErrors(void) const { return m_errors; }
     bool isComplete(void) const { return m_complete; }
+    bool isCancelled(void) const { return m_token->isCancelled(); }
+
+    // Return the progress of the job (as a percentage {0:100})
+    virtual int getProgress(void) const = 0;
+
+    //! Interval between progress updates (ms)
+    static const int PROGRESS_INTERVAL = 250;
+
+signals:
+    void progressChanged(int progress);
+    void completed(bool result);
+
+protected slots:
+    void updateProgress(void);
+    void onReturned(void);
+
 protected:
+    virtual void run(void) override;
+
+    // Perform the job (in a pool thread)
+    virtual bool execute(QStringList &errors) = 0;
+
+    // Called (in the owning thread) when the job is cancelled
+    virtual void onCancelled(void) {}
+
+    CancellationTokenPointer m_token;
+
+    QTimer progressTimer;
+    int m_progress = -1;
+
+    //! Signalled once run() has finished with the job
+    QMutex m_mutex;
+    QWaitCondition m_returned;
+    bool m_running = false;
+
     QStringList m_errors;
     bool m_complete = false;
     bool m_result = false;
@@ -22,47 +81,105 @@ protected:
 
 
 /**
- * @brief The DataImportWorker class manages a data import session
+ * @brief The DataImportJob class imports a file with an import plugin
  */
-class DataImportWorker : public DataIOWorker
+class DataImportJob : public DataIOJob
 {
     Q_OBJECT
 
 public:
-    DataImportWorker(QSharedPointer<ImportPlugin> plugin);
+    DataImportJob(QSharedPointer<ImportPlugin> plugin);
 
-public slots:
-    void runImport(void);
-    void cancelImport(void);
-
-signals:
-    void importCompleted(void);
+    virtual int getProgress(void) const override;
 
 protected:
+    virtual bool execute(QStringList &errors) override;
+    virtual void onCancelled(void) override;
+
     QSharedPointer<ImportPlugin> m_plugin;
 };
 
 
-class DataExportWorker : public DataIOWorker
+/**
+ * @brief The DataExportJob class exports a set of series with an export plugin
+ */
+class DataExportJob : public DataIOJob
 {
     Q_OBJECT
 
 public:
-    DataExportWorker(QSharedPointer<ExportPlugin> plugin, QList<DataSeriesPointer> &series);
-
-public slots:
-    void runExport(void);
-    void cancelExport(void);
+    DataExportJob(QSharedPointer<ExportPlugin> plugin, QList<DataSeriesPointer> &series);
 
-signals:
-    void exportCompleted(void);
+    virtual int getProgress(void) const override;
 
 protected:
+    virtual bool execute(QStringList &errors) override;
+    virtual void onCancelled(void) override;
+
     QSharedPointer<ExportPlugin> m_plugin;
     QList<DataSeriesPointer> m_series;
 };
 
 
+/**
+ * @brief The DataImportSession struct tracks an import which is running in the background.
+ * The source is displayed as soon as the import starts, and is populated as the file is read.
+ */
+struct DataImportSession
+{
+    QSharedPointer<ImportPlugin> importer;
+
+    //! Receives the samples of an importer which supports it (see ImportPlugin::supportsImportSink)
+    QSharedPointer<SeriesImportSink> sink;
+
+    //! Job which runs the import (nullptr until the import starts, and once it is complete)
+    DataImportJob *job = nullptr;
+
+    //! Source which receives the imported series
+    DataSourcePointer source;
+
+    QString filename;
+
+    //! Imported series are cached on completion (see ImportCache)
+    QByteArray cacheKey;
+    bool useCache = false;
+
+    bool cancelled = false;
+
+    //! Data appended to the file are imported after the import is complete (see ImportPlugin::isFollowEnabled)
+    bool follow = false;
+
+    //! Number of samples in each series when it was last updated (see DataSourceManager::publishImport)
+    QHash<DataSeries*, size_t> sizes;
+
+    //! Series of the import, from the sink or from the importer itself
+    QList<DataSeriesPointer> getDataSeries(void) const
+    {
+        return sink.isNull() ? importer->getDataSeries() : sink->getDataSeries();
+    }
+
+    //! Release the importer (and the sink, which is no longer valid) once the import is complete
+    void release(void)
+    {
+        importer->afterImport();
+        importer->setImportSink(nullptr);
+    }
+};
+
+
+/**
+ * @brief The DataExportSession struct tracks an export which is running in the background
+ */
+struct DataExportSession
+{
+    QSharedPointer<ExportPlugin> exporter;
+
+    DataExportJob *job = nullptr;
+
+    QString filename;
+};
+
+
 /*
  * Data source manager class:
  * - Manages all data sources
@@ -100,12 +217,15 @@ public:
 public slots:
 
     DataSeriesPointer findSeries(QString source_label, QString series_label);
+    DataSeriesPointer findSeries(LabelRegistry::Id source_id, LabelRegistry::Id series_id);
+    DataSourcePointer findSource(DataSeriesPointer series);
 
     int getSourceCount(void) const { return sources.size(); }
     QStringList getSourceLabels(void) const;
 
     DataSourcePointer getSourceByIndex(unsigned int idx);
     DataSourcePointer getSourceByLabel(QString label);
+    DataSourcePointer getSourceById(LabelRegistry::Id id) { return sourcesById.value(id); }
 
     bool addSource(DataSourcePointer source);
     bool addSource(DataSource* source) { return addSource(DataSourcePointer(source)); }
@@ -119,22 +239,104 @@ public slots:
 
     void removeAllSources(bool update = true);
 
-    // Data import functionality
+    // Data import functionality (the import continues in the background, see importFinished)
     bool importData(QString filename = QString());
+    int importFiles(QStringList filenames);
 
-    // Data export functionality
-    bool exportData(QList<DataSeriesPointer> &series, QString filename = QString());
+    bool isImporting(void) const;
+    void cancelImports(bool wait = false);
+    void cancelImport(QString filename);
+
+    // Files which are being imported (or are queued for import), and their progress
+    QStringList getImportFilenames(void) const;
+    int getImportProgress(QString filename) const;
+    int getTotalImportProgress(void) const;
+
+    // Files which continue to be imported as they grow
+    bool isFollowing(DataSourcePointer source) const;
+    void stopFollowing(DataSourcePointer source);
+
+    // Data export functionality (the export continues in the background, see exportFinished)
+    bool exportData(QList<DataSeriesPointer> &series, QString filename = QString(), const ExportScope &scope = ExportScope());
+
+    bool isExporting(void) const;
+    void cancelExports(bool wait = false);
 
     void update(void) { emit sourcesChanged(); }
 
 signals:
     void sourcesChanged();
 
+    //! Emitted periodically while a file is being imported (percentage {0:100})
+    void importProgress(QString filename, int progress);
+
+    //! Emitted when the import of a file is complete (or cancelled)
+    void importFinished(QString filename, bool result);
+
+    //! Emitted when the progress of an export changes (percentage {0:100})
+    void exportProgress(QString filename, int progress);
+
+    //! Emitted when an export is complete (or cancelled)
+    void exportFinished(QString filename, bool result);
+
 protected slots:
     void onDataChanged() { emit sourcesChanged(); }
 
+    void updateImports(void);
+
+    void onFileChanged(const QString &path);
+    void updateFollowedFiles(void);
+
 protected:
+    bool prepareImport(QString filename, QList<QSharedPointer<ImportPlugin>> &configured, QSharedPointer<DataImportSession> &session);
+    void startImport(QSharedPointer<DataImportSession> session);
+    void startPendingImports(void);
+    void publishImport(DataImportSession &session);
+    void finishImport(QSharedPointer<DataImportSession> session);
+    void finishExport(QSharedPointer<DataExportSession> session);
+    void resetImportProgress(void);
+
+    int getMaxConcurrentImports(void) const;
+
     QVector<DataSourcePointer> sources;
+
+    //! First source with each label, by the ID of the label (see LabelRegistry)
+    QHash<LabelRegistry::Id, DataSourcePointer> sourcesById;
+
+    void unindexSource(DataSourcePointer source);
+
+    //! Interval between publishing the progress of running imports (ms)
+    static const int IMPORT_UPDATE_INTERVAL = 250;
+
+    //! Default number of files which are imported at once (each import also parses its file in parallel)
+    static const int DEFAULT_CONCURRENT_IMPORTS = 2;
+
+    //! Imports which are running in the background
+    QList<QSharedPointer<DataImportSession>> imports;
+
+    //! Imports which are queued until fewer imports are running (see getMaxConcurrentImports)
+    QList<QSharedPointer<DataImportSession>> pendingImports;
+
+    //! Number of files in the current batch of imports, and the number which have finished (see getTotalImportProgress)
+    int importTotal = 0;
+    int importDone = 0;
+
+    QTimer importTimer;
+
+    //! Delay between a followed file changing and importing the appended data (ms)
+    static const int FOLLOW_INTERVAL = 100;
+
+    //! Followed files are also checked at this interval, in case the file system does not report changes (ms)
+    static const int FOLLOW_POLL_INTERVAL = 1000;
+
+    //! Completed imports of files which are followed
+    QList<QSharedPointer<DataImportSession>> follows;
+
+    QFileSystemWatcher fileWatcher;
+    QTimer followTimer;
+
+    //! Exports which are running in the background
+    QList<QSharedPointer<DataExportSession>> exports;
 };
 
 
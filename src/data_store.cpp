@@ -0,0 +1,205 @@
+#include <QDir>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "data_store.hpp"
+
+const size_t DataStore::SEGMENT_SIZE;
+const size_t DataStore::MIN_ALLOCATION;
+
+
+static DataStorePointer defaultStore;
+
+
+/*
+ * Create a new store, with a scratch file in the specified directory.
+ * If no directory is provided, the system temporary directory is used.
+ */
+DataStore::DataStore(QString directory)
+{
+    if (directory.isEmpty())
+    {
+        directory = QDir::tempPath();
+    }
+
+    file.setFileTemplate(directory + QDir::separator() + "lumberjack_XXXXXX.scratch");
+
+    valid = file.open();
+
+    if (!valid)
+    {
+        qWarning() << "Could not create scratch file in" << directory << ":" << file.errorString();
+    }
+}
+
+
+DataStore::~DataStore()
+{
+    for (auto segment : segments)
+    {
+        file.unmap(segment);
+    }
+
+    file.close();
+}
+
+
+/*
+ * Return the store used for new DataSeries (nullptr if sample data are stored on the heap)
+ */
+DataStorePointer DataStore::getDefault()
+{
+    return std::atomic_load(&defaultStore);
+}
+
+
+/*
+ * Select the store used for new DataSeries (nullptr to store sample data on the heap)
+ */
+void DataStore::setDefault(DataStorePointer store)
+{
+    std::atomic_store(&defaultStore, store);
+}
+
+
+/*
+ * Allocations are rounded up to a power of two, to allow released space to be re-used
+ */
+size_t DataStore::getAllocationSize(size_t bytes)
+{
+    size_t size = MIN_ALLOCATION;
+
+    while (size < bytes)
+    {
+        size *= 2;
+    }
+
+    return size;
+}
+
+
+unsigned int DataStore::getSizeClass(size_t bytes)
+{
+    unsigned int size_class = 0;
+
+    for (size_t size = MIN_ALLOCATION; size < bytes; size *= 2)
+    {
+        size_class++;
+    }
+
+    return size_class;
+}
+
+
+/*
+ * Extend the scratch file, and map the new region into memory
+ */
+bool DataStore::addSegment()
+{
+    qint64 offset = (qint64) getMappedBytes();
+
+    if (!file.resize(offset + (qint64) SEGMENT_SIZE))
+    {
+        qWarning() << "Could not extend scratch file" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    uchar* segment = file.map(offset, SEGMENT_SIZE);
+
+    if (!segment)
+    {
+        qWarning() << "Could not map scratch file" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    segments.push_back(segment);
+    segmentUsed = 0;
+
+    return true;
+}
+
+
+/*
+ * Allocate space for a column of the specified size.
+ * Returns nullptr if the space could not be allocated (the caller should fall back to the heap).
+ */
+void* DataStore::allocate(size_t bytes)
+{
+    if (!valid || bytes < MIN_ALLOCATION || bytes > SEGMENT_SIZE) return nullptr;
+
+    QMutexLocker lock(&mutex);
+
+    unsigned int size_class = getSizeClass(bytes);
+
+    if (size_class < freeLists.size() && !freeLists[size_class].empty())
+    {
+        void* ptr = freeLists[size_class].back();
+        freeLists[size_class].pop_back();
+
+        return ptr;
+    }
+
+    size_t size = getAllocationSize(bytes);
+
+    if (segments.empty() || segmentUsed + size > SEGMENT_SIZE)
+    {
+        if (!addSegment()) return nullptr;
+    }
+
+    void* ptr = segments.back() + segmentUsed;
+
+    segmentUsed += size;
+
+    return ptr;
+}
+
+
+/*
+ * Return an allocation to the store, for re-use
+ */
+void DataStore::release(void* ptr, size_t bytes)
+{
+    if (!ptr) return;
+
+    // Released space does not need to remain resident
+    evict(ptr, bytes);
+
+    QMutexLocker lock(&mutex);
+
+    unsigned int size_class = getSizeClass(bytes);
+
+    if (freeLists.size() <= size_class)
+    {
+        freeLists.resize(size_class + 1);
+    }
+
+    freeLists[size_class].push_back(ptr);
+}
+
+
+/*
+ * Remove an allocation from the working set of the process.
+ * The contents are retained, and will be paged back in on the next access.
+ */
+void DataStore::evict(const void* ptr, size_t bytes)
+{
+#if defined(Q_OS_LINUX)
+    // Only whole pages can be released
+    static const uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+
+    uintptr_t first = ((uintptr_t) ptr + page - 1) & ~(page - 1);
+    uintptr_t last = ((uintptr_t) ptr + bytes) & ~(page - 1);
+
+    if (last > first)
+    {
+        madvise((void*) first, last - first, MADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(ptr);
+    Q_UNUSED(bytes);
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef DATA_STORE_H
+#define DATA_STORE_H
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include <qmutex.h>
+#include <QTemporaryFile>
+
+
+/**
+ * @brief The DataStore class provides memory-mapped storage for DataBlock sample columns.
+ *
+ * Sample columns are allocated from a scratch file (deleted when the store is destroyed),
+ * which is mapped into memory in large segments. Columns therefore consume address space
+ * rather than heap, and the operating system page cache decides which parts of a very
+ * large dataset are resident.
+ *
+ * Once a block is full (and can no longer change) its columns are released from the
+ * working set of the process. The contents remain in the page cache (or on disk), and
+ * are faulted back in transparently when the samples are next read.
+ *
+ * The summary pyramid for each block is always kept on the heap, so down-sampling and
+ * statistics for large ranges of data do not touch the mapped columns.
+ *
+ * A store is shared (via DataStorePointer) by every block allocated from it, so it remains
+ * valid for as long as any snapshot of those blocks exists. The store is thread safe.
+ */
+class DataStore
+{
+public:
+    //! Size of each mapped region of the scratch file
+    static const size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+
+    //! Allocations smaller than this are not worth mapping, and are made on the heap
+    static const size_t MIN_ALLOCATION = 4096;
+
+    DataStore(QString directory = QString());
+    virtual ~DataStore();
+
+    DataStore(const DataStore& other) = delete;
+    DataStore& operator=(const DataStore& other) = delete;
+
+    bool isValid(void) const { return valid; }
+
+    QString getFileName(void) const { return file.fileName(); }
+
+    void* allocate(size_t bytes);
+    void release(void* ptr, size_t bytes);
+    void evict(const void* ptr, size_t bytes);
+
+    //! Total size of the scratch file
+    size_t getMappedBytes(void) const { return segments.size() * SEGMENT_SIZE; }
+
+    static std::shared_ptr<DataStore> getDefault(void);
+    static void setDefault(std::shared_ptr<DataStore> store);
+
+protected:
+    static size_t getAllocationSize(size_t bytes);
+    static unsigned int getSizeClass(size_t bytes);
+
+    bool addSegment(void);
+
+    mutable QMutex mutex;
+
+    //! Backing file for all mapped columns
+    QTemporaryFile file;
+
+    bool valid = false;
+
+    //! Mapped regions of the file, each SEGMENT_SIZE bytes
+    std::vector<uchar*> segments;
+
+    //! Number of bytes used in the newest segment
+    size_t segmentUsed = 0;
+
+    //! Released allocations, available for re-use (one list per power-of-two size class)
+    std::vector<std::vector<void*>> freeLists;
+};
+
+typedef std::shared_ptr<DataStore> DataStorePointer;
+
+
+#endif // DATA_STORE_H
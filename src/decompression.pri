@@ -0,0 +1,20 @@
+# Libraries for reading compressed files (see DecompressionDevice)
+# Each format is only supported if its library is found
+
+packagesExist(zlib) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += zlib
+    DEFINES += DECOMPRESS_ZLIB
+}
+
+packagesExist(libzstd) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+    DEFINES += DECOMPRESS_ZSTD
+}
+
+packagesExist(liblzma) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liblzma
+    DEFINES += DECOMPRESS_LZMA
+}
@@ -0,0 +1,645 @@
+#include <string.h>
+
+#include <algorithm>
+
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+
+#ifdef DECOMPRESS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef DECOMPRESS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef DECOMPRESS_LZMA
+#include <lzma.h>
+#endif
+
+#include "decompression_device.hpp"
+#include "parallel_for.hpp"
+
+
+const qint64 DecompressionDevice::INPUT_SIZE;
+const uint64_t DecompressionDevice::MAX_FRAME_SIZE;
+
+//! Decoded data are produced in blocks of (at least) this size
+static const size_t OUTPUT_SIZE = 1 << 20;
+
+
+/*
+ * Decoder state for each format (only the members for the compiled formats exist)
+ */
+struct DecompressionDevice::Decoder
+{
+#ifdef DECOMPRESS_ZLIB
+    z_stream zlib;
+    bool zlibInit = false;
+#endif
+
+#ifdef DECOMPRESS_ZSTD
+    ZSTD_DCtx* zstd = nullptr;
+
+    //! A frame is partially decoded (as a stream)
+    bool zstdInFrame = false;
+#endif
+
+#ifdef DECOMPRESS_LZMA
+    lzma_stream lzma = LZMA_STREAM_INIT;
+    bool lzmaInit = false;
+#endif
+
+    ~Decoder()
+    {
+#ifdef DECOMPRESS_ZLIB
+        if (zlibInit) inflateEnd(&zlib);
+#endif
+
+#ifdef DECOMPRESS_ZSTD
+        if (zstd) ZSTD_freeDCtx(zstd);
+#endif
+
+#ifdef DECOMPRESS_LZMA
+        if (lzmaInit) lzma_end(&lzma);
+#endif
+    }
+};
+
+
+/**
+ * @brief DecompressionDevice::getFormat - Determine the compression format of a file from its suffix
+ * @param filename e.g. "log.csv.gz"
+ * @return the format (FORMAT_NONE if the file is not compressed)
+ */
+DecompressionDevice::Format DecompressionDevice::getFormat(const QString& filename)
+{
+    const QString suffix = QFileInfo(filename).suffix().toLower();
+
+    if (suffix == "gz") return FORMAT_GZIP;
+    if (suffix == "zst") return FORMAT_ZSTD;
+    if (suffix == "xz") return FORMAT_XZ;
+
+    return FORMAT_NONE;
+}
+
+
+/**
+ * @brief DecompressionDevice::isSupported - Determine if a format can be decompressed by this build
+ */
+bool DecompressionDevice::isSupported(Format format)
+{
+    switch (format)
+    {
+    case FORMAT_NONE:
+        return true;
+#ifdef DECOMPRESS_ZLIB
+    case FORMAT_GZIP:
+        return true;
+#endif
+#ifdef DECOMPRESS_ZSTD
+    case FORMAT_ZSTD:
+        return true;
+#endif
+#ifdef DECOMPRESS_LZMA
+    case FORMAT_XZ:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+
+/**
+ * @brief DecompressionDevice::getSupportedSuffixes - The suffixes of the formats supported by this build
+ * @return e.g. {"gz", "zst", "xz"}
+ */
+QStringList DecompressionDevice::getSupportedSuffixes(void)
+{
+    QStringList suffixes;
+
+    if (isSupported(FORMAT_GZIP)) suffixes.append("gz");
+    if (isSupported(FORMAT_ZSTD)) suffixes.append("zst");
+    if (isSupported(FORMAT_XZ)) suffixes.append("xz");
+
+    return suffixes;
+}
+
+
+/**
+ * @brief DecompressionDevice::getUncompressedName - Strip any compression suffix from a filename
+ * @param filename e.g. "log.csv.gz"
+ * @return e.g. "log.csv" (or the filename itself, if it is not compressed)
+ */
+QString DecompressionDevice::getUncompressedName(const QString& filename)
+{
+    if (getFormat(filename) == FORMAT_NONE) return filename;
+
+    return filename.left(filename.lastIndexOf('.'));
+}
+
+
+DecompressionDevice::DecompressionDevice(QIODevice* source, Format format, QObject* parent) :
+    QIODevice(parent),
+    source(source),
+    format(format)
+{
+}
+
+
+DecompressionDevice::~DecompressionDevice()
+{
+    close();
+}
+
+
+/**
+ * @brief DecompressionDevice::open - Open the device for reading (the source must already be open)
+ * @param mode must be ReadOnly
+ * @return true if the decoder was initialized
+ */
+bool DecompressionDevice::open(OpenMode mode)
+{
+    if ((mode & ReadWrite) != ReadOnly || !source || !source->isReadable())
+    {
+        setErrorString(tr("Invalid source for decompression"));
+        return false;
+    }
+
+    if (format == FORMAT_NONE || !isSupported(format))
+    {
+        setErrorString(tr("Unsupported compression format"));
+        return false;
+    }
+
+    decoder.reset(new Decoder());
+
+    bool valid = false;
+
+    switch (format)
+    {
+#ifdef DECOMPRESS_ZLIB
+    case FORMAT_GZIP:
+        memset(&decoder->zlib, 0, sizeof(decoder->zlib));
+
+        // Detect the gzip (or zlib) header automatically
+        valid = inflateInit2(&decoder->zlib, 15 + 32) == Z_OK;
+        decoder->zlibInit = valid;
+        break;
+#endif
+#ifdef DECOMPRESS_ZSTD
+    case FORMAT_ZSTD:
+        decoder->zstd = ZSTD_createDCtx();
+        valid = decoder->zstd != nullptr;
+        break;
+#endif
+#ifdef DECOMPRESS_LZMA
+    case FORMAT_XZ:
+    {
+#if LZMA_VERSION >= 50040000
+        lzma_mt mt;
+        memset(&mt, 0, sizeof(mt));
+
+        mt.flags = LZMA_CONCATENATED;
+        mt.threads = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+        mt.memlimit_threading = lzma_physmem() / 4;
+        mt.memlimit_stop = UINT64_MAX;
+
+        valid = lzma_stream_decoder_mt(&decoder->lzma, &mt) == LZMA_OK;
+#endif
+        // Fall back to the (single threaded) stream decoder
+        if (!valid)
+        {
+            valid = lzma_stream_decoder(&decoder->lzma, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+        }
+
+        decoder->lzmaInit = valid;
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+
+    if (!valid)
+    {
+        decoder.reset();
+        setErrorString(tr("Could not initialize decompression"));
+        return false;
+    }
+
+    input.resize(INPUT_SIZE);
+    inputPos = 0;
+    inputEnd = 0;
+    sourceFinished = false;
+
+    output.clear();
+    outputPos = 0;
+    finished = false;
+
+    failed = false;
+
+    bytesRead = 0;
+
+    // Data are already buffered here
+    return QIODevice::open(mode | Unbuffered);
+}
+
+
+void DecompressionDevice::close(void)
+{
+    if (!isOpen()) return;
+
+    QIODevice::close();
+
+    decoder.reset();
+
+    std::vector<char>().swap(input);
+    std::vector<char>().swap(output);
+}
+
+
+bool DecompressionDevice::atEnd(void) const
+{
+    return finished && outputPos >= output.size();
+}
+
+
+qint64 DecompressionDevice::bytesAvailable(void) const
+{
+    return (qint64) (output.size() - outputPos) + QIODevice::bytesAvailable();
+}
+
+
+/**
+ * @brief DecompressionDevice::getCompressedPosition - The number of compressed bytes consumed from the source
+ */
+qint64 DecompressionDevice::getCompressedPosition(void) const
+{
+    return bytesRead - (qint64) (inputEnd - inputPos);
+}
+
+
+qint64 DecompressionDevice::readData(char* data, qint64 maxSize)
+{
+    qint64 copied = 0;
+
+    // Fill the request, unless the end of the data is reached
+    while (copied < maxSize)
+    {
+        if (outputPos >= output.size())
+        {
+            if (finished) break;
+
+            output.clear();
+            outputPos = 0;
+
+            // Anything decoded before an error is still returned
+            if (!decode())
+            {
+                failed = true;
+                finished = true;
+
+                if (copied == 0 && output.empty()) return -1;
+            }
+
+            continue;
+        }
+
+        const size_t n = std::min<size_t>(maxSize - copied, output.size() - outputPos);
+
+        memcpy(data + copied, output.data() + outputPos, n);
+
+        outputPos += n;
+        copied += n;
+    }
+
+    return copied;
+}
+
+
+qint64 DecompressionDevice::writeData(const char* data, qint64 maxSize)
+{
+    return -1;
+}
+
+
+/**
+ * @brief DecompressionDevice::fillInput - Move any unconsumed input to the start of the buffer, and read more
+ * @return true if there is any input available
+ */
+bool DecompressionDevice::fillInput(void)
+{
+    if (inputPos > 0)
+    {
+        memmove(input.data(), input.data() + inputPos, inputEnd - inputPos);
+        inputEnd -= inputPos;
+        inputPos = 0;
+    }
+
+    while (!sourceFinished && inputEnd < input.size())
+    {
+        const qint64 n = source->read(input.data() + inputEnd, (qint64) (input.size() - inputEnd));
+
+        if (n <= 0)
+        {
+            sourceFinished = true;
+            break;
+        }
+
+        inputEnd += n;
+        bytesRead += n;
+    }
+
+    return inputEnd > inputPos;
+}
+
+
+/**
+ * @brief DecompressionDevice::decode - Decode (at least) some of the input into the (empty) output buffer
+ * @return false if the data are invalid
+ */
+bool DecompressionDevice::decode(void)
+{
+    bool valid = false;
+
+    switch (format)
+    {
+    case FORMAT_GZIP:
+        valid = decodeGzip();
+        break;
+    case FORMAT_ZSTD:
+        valid = decodeZstd();
+        break;
+    case FORMAT_XZ:
+        valid = decodeXz();
+        break;
+    default:
+        break;
+    }
+
+    if (!valid) setErrorString(tr("Invalid compressed data"));
+
+    return valid;
+}
+
+
+/*
+ * Each gzip member is decoded in turn, until the input is exhausted
+ */
+bool DecompressionDevice::decodeGzip(void)
+{
+#ifdef DECOMPRESS_ZLIB
+    z_stream& zs = decoder->zlib;
+
+    output.resize(OUTPUT_SIZE);
+
+    size_t produced = 0;
+
+    while (produced < output.size())
+    {
+        // The data are truncated
+        if (inputPos >= inputEnd && !fillInput())
+        {
+            output.resize(produced);
+            return false;
+        }
+
+        zs.next_in = (Bytef*) input.data() + inputPos;
+        zs.avail_in = (uInt) (inputEnd - inputPos);
+        zs.next_out = (Bytef*) output.data() + produced;
+        zs.avail_out = (uInt) (output.size() - produced);
+
+        const int result = inflate(&zs, Z_NO_FLUSH);
+
+        inputPos = inputEnd - zs.avail_in;
+        produced = output.size() - zs.avail_out;
+
+        if (result == Z_STREAM_END)
+        {
+            // Another member may follow
+            if (inputPos >= inputEnd && !fillInput())
+            {
+                finished = true;
+                break;
+            }
+
+            inflateReset(&zs);
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            output.resize(produced);
+            return false;
+        }
+    }
+
+    output.resize(produced);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/*
+ * Complete frames are decoded together (see decodeZstdFrames), otherwise the next frame is decoded as a stream
+ */
+bool DecompressionDevice::decodeZstd(void)
+{
+#ifdef DECOMPRESS_ZSTD
+    if (!decoder->zstdInFrame)
+    {
+        if (inputEnd - inputPos < input.size() / 2) fillInput();
+
+        if (inputPos >= inputEnd)
+        {
+            finished = true;
+            return true;
+        }
+
+        if (decodeZstdFrames()) return true;
+    }
+
+    output.resize(OUTPUT_SIZE);
+
+    size_t produced = 0;
+
+    while (produced < output.size())
+    {
+        if (inputPos >= inputEnd && !fillInput())
+        {
+            // The last frame is incomplete
+            if (decoder->zstdInFrame)
+            {
+                output.resize(produced);
+                return false;
+            }
+
+            finished = true;
+            break;
+        }
+
+        ZSTD_inBuffer in = {input.data(), inputEnd, inputPos};
+        ZSTD_outBuffer out = {output.data(), output.size(), produced};
+
+        const size_t result = ZSTD_decompressStream(decoder->zstd, &out, &in);
+
+        inputPos = in.pos;
+        produced = out.pos;
+
+        if (ZSTD_isError(result))
+        {
+            output.resize(produced);
+            return false;
+        }
+
+        decoder->zstdInFrame = result != 0;
+
+        // The frame is complete, so the next frame(s) may be decoded in parallel
+        if (!decoder->zstdInFrame) break;
+    }
+
+    output.resize(produced);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief DecompressionDevice::decodeZstdFrames - Decode the complete frames at the start of the input in parallel
+ * @return true if any frames were decoded (otherwise the next frame should be decoded as a stream)
+ */
+bool DecompressionDevice::decodeZstdFrames(void)
+{
+#ifdef DECOMPRESS_ZSTD
+    struct Frame
+    {
+        size_t offset;
+        size_t size;
+        size_t output;
+        size_t contentSize;
+    };
+
+    std::vector<Frame> frames;
+
+    size_t offset = inputPos;
+    size_t total = 0;
+
+    while (offset < inputEnd)
+    {
+        const size_t size = ZSTD_findFrameCompressedSize(input.data() + offset, inputEnd - offset);
+
+        // The frame is incomplete
+        if (ZSTD_isError(size)) break;
+
+        const unsigned long long content = ZSTD_getFrameContentSize(input.data() + offset, size);
+
+        // The content size must be known (and reasonable) to decode the frame directly
+        if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR || content > MAX_FRAME_SIZE) break;
+
+        if (!frames.empty() && total + content > MAX_FRAME_SIZE) break;
+
+        frames.push_back({offset, size, total, (size_t) content});
+
+        offset += size;
+        total += content;
+    }
+
+    // A single frame is only worth decoding directly if it is small (and already complete)
+    if (frames.empty() || (frames.size() == 1 && total > OUTPUT_SIZE)) return false;
+
+    output.resize(total);
+
+    std::vector<size_t> results(frames.size(), 0);
+
+    auto decodeFrame = [&](size_t idx) {
+        const Frame& frame = frames[idx];
+
+        ZSTD_DCtx* context = ZSTD_createDCtx();
+
+        results[idx] = ZSTD_decompressDCtx(context,
+                                           output.data() + frame.output, frame.contentSize,
+                                           input.data() + frame.offset, frame.size);
+
+        ZSTD_freeDCtx(context);
+    };
+
+    if (frames.size() > 1)
+    {
+        parallelFor(frames.size(), decodeFrame, QThreadPool::globalInstance());
+    }
+    else
+    {
+        decodeFrame(0);
+    }
+
+    for (size_t idx = 0; idx < frames.size(); idx++)
+    {
+        if (ZSTD_isError(results[idx]) || results[idx] != frames[idx].contentSize)
+        {
+            // Fall back to decoding the frames as a stream, which reports any error
+            output.clear();
+            return false;
+        }
+    }
+
+    inputPos = offset;
+
+    if (inputPos >= inputEnd && !fillInput()) finished = true;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool DecompressionDevice::decodeXz(void)
+{
+#ifdef DECOMPRESS_LZMA
+    lzma_stream& ls = decoder->lzma;
+
+    output.resize(OUTPUT_SIZE);
+
+    size_t produced = 0;
+
+    while (produced < output.size())
+    {
+        if (inputPos >= inputEnd) fillInput();
+
+        ls.next_in = (const uint8_t*) input.data() + inputPos;
+        ls.avail_in = inputEnd - inputPos;
+        ls.next_out = (uint8_t*) output.data() + produced;
+        ls.avail_out = output.size() - produced;
+
+        const lzma_ret result = lzma_code(&ls, sourceFinished && ls.avail_in == 0 ? LZMA_FINISH : LZMA_RUN);
+
+        inputPos = inputEnd - ls.avail_in;
+        produced = output.size() - ls.avail_out;
+
+        if (result == LZMA_STREAM_END)
+        {
+            finished = true;
+            break;
+        }
+
+        if (result != LZMA_OK)
+        {
+            output.resize(produced);
+            return false;
+        }
+    }
+
+    output.resize(produced);
+
+    return true;
+#else
+    return false;
+#endif
+}
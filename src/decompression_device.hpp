@@ -0,0 +1,109 @@
+#ifndef DECOMPRESSION_DEVICE_HPP
+#define DECOMPRESSION_DEVICE_HPP
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <QIODevice>
+#include <QStringList>
+
+
+/**
+ * @brief The DecompressionDevice class decompresses a compressed file as it is read, so that an
+ * importer can parse a compressed log (e.g. log.csv.gz) without decompressing it to disk first.
+ *
+ * The device is read-only and sequential. Compressed data are read from the source device a block
+ * at a time, and decoded into an output buffer which is consumed by read().
+ *
+ * Each format is only available if the corresponding library was found when building (see decompression.pri):
+ * - gzip (.gz), using zlib. Concatenated gzip members are decoded in sequence.
+ * - zstd (.zst), using libzstd. Consecutive frames whose content size is known (e.g. as written by pzstd)
+ *   are decoded in parallel. Any other frame is decoded as a stream.
+ * - xz (.xz), using liblzma. The multi-threaded decoder is used, if available.
+ */
+class DecompressionDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    enum Format
+    {
+        FORMAT_NONE = 0,
+        FORMAT_GZIP,
+        FORMAT_ZSTD,
+        FORMAT_XZ,
+    };
+
+    //! Compressed data are read from the source in blocks of this size
+    static const qint64 INPUT_SIZE = 8 << 20;
+
+    //! A zstd frame is only decoded in parallel if its content is no larger than this
+    static const uint64_t MAX_FRAME_SIZE = 64 << 20;
+
+    static Format getFormat(const QString& filename);
+    static bool isSupported(Format format);
+
+    static QStringList getSupportedSuffixes(void);
+
+    static QString getUncompressedName(const QString& filename);
+
+    DecompressionDevice(QIODevice* source, Format format, QObject* parent = nullptr);
+    virtual ~DecompressionDevice();
+
+    virtual bool open(OpenMode mode) override;
+    virtual void close(void) override;
+
+    virtual bool isSequential(void) const override { return true; }
+    virtual bool atEnd(void) const override;
+    virtual qint64 bytesAvailable(void) const override;
+
+    qint64 getCompressedPosition(void) const;
+
+    //! The compressed data were invalid (or truncated), see errorString()
+    bool hasFailed(void) const { return failed; }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize) override;
+    virtual qint64 writeData(const char* data, qint64 maxSize) override;
+
+    bool fillInput(void);
+    bool decode(void);
+
+    bool decodeGzip(void);
+    bool decodeZstd(void);
+    bool decodeZstdFrames(void);
+    bool decodeXz(void);
+
+    struct Decoder;
+
+    //! Decoder state for the format (see decompression_device.cpp)
+    std::unique_ptr<Decoder> decoder;
+
+    QIODevice* source = nullptr;
+
+    Format format = FORMAT_NONE;
+
+    //! Compressed data, in the range [inputPos, inputEnd)
+    std::vector<char> input;
+    size_t inputPos = 0;
+    size_t inputEnd = 0;
+
+    //! Every compressed byte has been read from the source
+    bool sourceFinished = false;
+
+    //! Decoded data, in the range [outputPos, output.size())
+    std::vector<char> output;
+    size_t outputPos = 0;
+
+    //! Every decoded byte has been produced
+    bool finished = false;
+
+    bool failed = false;
+
+    //! Number of bytes read from the source
+    qint64 bytesRead = 0;
+};
+
+#endif // DECOMPRESSION_DEVICE_HPP
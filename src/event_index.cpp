@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <cmath>
+
+#include "event_index.hpp"
+#include "trace_recorder.hpp"
+
+
+namespace
+{
+
+/*
+ * Merges consecutive spans of samples with the same state into intervals
+ */
+struct RunBuilder
+{
+    RunBuilder(std::vector<EventIndex::Interval> &output, bool keepAll) : output(output), keepAll(keepAll) {}
+
+    std::vector<EventIndex::Interval> &output;
+
+    //! Keep the runs of every state (rather than only those of state 1)
+    bool keepAll;
+
+    bool open = false;
+    double state = 0;
+
+    EventIndex::Interval run;
+
+    void add(uint64_t idx_first, uint64_t idx_last, double t_first, double t_last, double s)
+    {
+        if (open && s == state)
+        {
+            run.idx_last = idx_last;
+            run.t_end = t_last;
+            return;
+        }
+
+        close();
+
+        open = true;
+        state = s;
+
+        run.idx_first = idx_first;
+        run.idx_last = idx_last;
+        run.t_start = t_first;
+        run.t_end = t_last;
+        run.value = s;
+    }
+
+    void close(void)
+    {
+        if (open && (keepAll || state != 0)) output.push_back(run);
+
+        open = false;
+    }
+};
+
+
+/*
+ * State of a sample (or of every sample in a bucket) for a condition
+ */
+struct Classifier
+{
+    int condition;
+    double threshold;
+
+    double getState(double v) const
+    {
+        switch (condition)
+        {
+        case EventIndex::CONDITION_ABOVE:
+            return v > threshold ? 1 : 0;
+        case EventIndex::CONDITION_BELOW:
+            return v < threshold ? 1 : 0;
+        default:
+            return v;
+        }
+    }
+
+    //! Returns true (and the state) if every sample in the bucket has the same state
+    bool getState(const DataSnapshot::Bucket &bucket, double &state) const
+    {
+        if (bucket.count == 1)
+        {
+            state = getState(bucket.first.value);
+            return true;
+        }
+
+        switch (condition)
+        {
+        case EventIndex::CONDITION_ABOVE:
+            if (bucket.min.value > threshold) { state = 1; return true; }
+            if (bucket.max.value <= threshold) { state = 0; return true; }
+            return false;
+        case EventIndex::CONDITION_BELOW:
+            if (bucket.max.value < threshold) { state = 1; return true; }
+            if (bucket.min.value >= threshold) { state = 0; return true; }
+            return false;
+        default:
+            state = bucket.min.value;
+            return bucket.min.value == bucket.max.value;
+        }
+    }
+};
+
+
+//! Finest summary level with buckets smaller than the specified number of samples (or -1 for individual samples)
+int getFinerLevel(uint64_t count)
+{
+    for (int level = DataBlock::SUMMARY_LEVELS - 1; level >= 0; level--)
+    {
+        if (DataBlock::getSummaryBucketSize(level) < count) return level;
+    }
+
+    return -1;
+}
+
+
+void scanStates(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last, int level, const Classifier &classifier, RunBuilder &runs)
+{
+    if (level < 0)
+    {
+        snapshot.getView(idx_first, idx_last).visitSegments([&](const DataView::Segment &segment) {
+            for (size_t ii = 0; ii < segment.length; ii++)
+            {
+                const uint64_t idx = idx_first + segment.index + ii;
+                const double t = snapshot.applyTimeScaling(segment.getTimestamp(ii));
+
+                runs.add(idx, idx + 1, t, t, classifier.getState(snapshot.applyScaling(segment.getValue(ii))));
+            }
+        });
+
+        return;
+    }
+
+    uint64_t idx = idx_first;
+
+    snapshot.visitBuckets(idx_first, idx_last, level, [&](const DataSnapshot::Bucket &bucket) {
+        double state = 0;
+
+        if (classifier.getState(bucket, state))
+        {
+            runs.add(idx, idx + bucket.count, bucket.first.timestamp, bucket.last.timestamp, state);
+        }
+        else
+        {
+            // The state changes within the bucket
+            scanStates(snapshot, idx, idx + bucket.count, getFinerLevel(bucket.count), classifier, runs);
+        }
+
+        idx += bucket.count;
+    });
+}
+
+
+void scanGaps(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last, int level, double spacing,
+              double &t_previous, bool &first, std::vector<EventIndex::Interval> &output)
+{
+    auto addSample = [&](uint64_t idx, double t) {
+        if (!first && t - t_previous > spacing)
+        {
+            EventIndex::Interval gap;
+
+            gap.idx_first = idx;
+            gap.idx_last = idx;
+            gap.t_start = t_previous;
+            gap.t_end = t;
+
+            output.push_back(gap);
+        }
+
+        t_previous = t;
+        first = false;
+    };
+
+    if (level < 0)
+    {
+        snapshot.getView(idx_first, idx_last).visitSegments([&](const DataView::Segment &segment) {
+            for (size_t ii = 0; ii < segment.length; ii++)
+            {
+                addSample(idx_first + segment.index + ii, snapshot.applyTimeScaling(segment.getTimestamp(ii)));
+            }
+        });
+
+        return;
+    }
+
+    uint64_t idx = idx_first;
+
+    snapshot.visitBuckets(idx_first, idx_last, level, [&](const DataSnapshot::Bucket &bucket) {
+        addSample(idx, bucket.first.timestamp);
+
+        // A bucket which spans no more than the spacing cannot contain a gap
+        if (bucket.last.timestamp - bucket.first.timestamp <= spacing)
+        {
+            t_previous = bucket.last.timestamp;
+        }
+        else
+        {
+            scanGaps(snapshot, idx, idx + bucket.count, getFinerLevel(bucket.count), spacing, t_previous, first, output);
+        }
+
+        idx += bucket.count;
+    });
+}
+
+}
+
+
+/**
+ * @brief EventIndex::build - Find the intervals of a series which satisfy a condition
+ * @param snapshot - Samples of the series
+ * @param condition - Condition the samples must satisfy (see EventIndex::Condition)
+ * @param threshold - Threshold value (CONDITION_ABOVE and CONDITION_BELOW), or the largest spacing
+ *   between samples (ms) which is not a gap (CONDITION_GAPS)
+ *
+ * DataSeries discards NaN samples when they are added, so a run of NaN samples in a log is a gap
+ * between the samples of the series. The interval of a gap contains no samples (idx_first = idx_last
+ * is the sample after the gap), and spans the time between the samples either side of it.
+ */
+std::shared_ptr<EventIndex> EventIndex::build(const DataSnapshot &snapshot, int condition, double threshold)
+{
+    TRACE_SCOPE("Event index", "math");
+
+    auto index = std::make_shared<EventIndex>();
+
+    index->condition = condition;
+    index->threshold = threshold;
+
+    if (snapshot.isEmpty()) return index;
+
+    if (condition == CONDITION_GAPS)
+    {
+        double t_previous = 0;
+        bool first = true;
+
+        scanGaps(snapshot, 0, snapshot.size(), DataBlock::SUMMARY_LEVELS - 1, std::max(threshold, 0.0), t_previous, first, index->intervals);
+    }
+    else
+    {
+        Classifier classifier = {condition, threshold};
+        RunBuilder runs(index->intervals, condition == CONDITION_CHANGES);
+
+        scanStates(snapshot, 0, snapshot.size(), DataBlock::SUMMARY_LEVELS - 1, classifier, runs);
+
+        runs.close();
+    }
+
+    return index;
+}
+
+
+size_t EventIndex::lowerBound(double t) const
+{
+    return std::lower_bound(intervals.begin(), intervals.end(), t, [](const Interval &interval, double t) {
+        return interval.t_start < t;
+    }) - intervals.begin();
+}
+
+
+//! First interval which starts after time t (or nullptr)
+const EventIndex::Interval* EventIndex::next(double t) const
+{
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), t, [](double t, const Interval &interval) {
+        return t < interval.t_start;
+    });
+
+    return it == intervals.end() ? nullptr : &(*it);
+}
+
+
+//! Last interval which starts before time t (or nullptr)
+const EventIndex::Interval* EventIndex::previous(double t) const
+{
+    const size_t idx = lowerBound(t);
+
+    return idx == 0 ? nullptr : &intervals[idx - 1];
+}
+
+
+double EventIndex::getDuration() const
+{
+    double duration = 0;
+
+    for (const auto &interval : intervals)
+    {
+        duration += interval.duration();
+    }
+
+    return duration;
+}
+
+
+/**
+ * @brief EventIndex::getStatistics - Combined statistics of the samples within the intervals
+ * @param snapshot - Samples of the series (normally the series the index was built from)
+ */
+DataSnapshot::Statistics EventIndex::getStatistics(const DataSnapshot &snapshot) const
+{
+    DataSnapshot::Statistics total;
+
+    for (const auto &interval : intervals)
+    {
+        total.include(snapshot.getStatistics(interval.idx_first, interval.idx_last));
+    }
+
+    return total;
+}
+
+
+/**
+ * @brief EventIndex::toEventStore - Create an event at the start of each interval (e.g. to overlay on a plot)
+ * @param label - Prefix of the label of each event
+ */
+std::shared_ptr<EventStore> EventIndex::toEventStore(const QString &label) const
+{
+    auto store = std::make_shared<EventStore>();
+
+    std::vector<EventStore::Event> events;
+    events.reserve(intervals.size());
+
+    const QString prefix = label.isEmpty() ? QString() : label + " ";
+
+    for (const auto &interval : intervals)
+    {
+        EventStore::Event event;
+
+        event.timestamp = interval.t_start;
+
+        switch (condition)
+        {
+        case CONDITION_ABOVE:
+            event.label = prefix + "> " + QString::number(threshold);
+            break;
+        case CONDITION_BELOW:
+            event.label = prefix + "< " + QString::number(threshold);
+            break;
+        case CONDITION_CHANGES:
+            event.label = label.isEmpty() ? QString::number(interval.value) : label + " = " + QString::number(interval.value);
+            break;
+        default:
+            event.label = prefix + "gap";
+            break;
+        }
+
+        events.push_back(event);
+    }
+
+    store->addEvents(events);
+
+    return store;
+}
+
+
+QString EventIndex::getConditionName(int condition)
+{
+    switch (condition)
+    {
+    case CONDITION_ABOVE:
+        return "Above Threshold";
+    case CONDITION_BELOW:
+        return "Below Threshold";
+    case CONDITION_CHANGES:
+        return "Value Changes";
+    case CONDITION_GAPS:
+        return "Gaps (Missing Samples)";
+    default:
+        return QString();
+    }
+}
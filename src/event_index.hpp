@@ -0,0 +1,105 @@
+#ifndef EVENT_INDEX_HPP
+#define EVENT_INDEX_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include <QString>
+
+#include "data_series.hpp"
+#include "event_store.hpp"
+
+
+/**
+ * @brief The EventIndex class holds the intervals of a series which satisfy a condition (e.g. every interval
+ * in which the motor current exceeds 40 A, each state of a mode, or each gap in the samples), in time order,
+ * so a plot can step between them.
+ *
+ * The index is built in a single pass over the summary pyramid of the series: a bucket whose summary shows
+ * that the condition cannot change within it (e.g. its minimum is above the threshold) is included (or skipped)
+ * as a whole, and only the buckets which contain a change are refined, down to the individual samples.
+ * A series which rarely crosses the threshold is therefore indexed without visiting most of its samples.
+ *
+ * Intervals are located by binary search (see next and previous), and the statistics of a series within
+ * the intervals are calculated from its summaries (see getStatistics).
+ */
+class EventIndex
+{
+public:
+    enum Condition
+    {
+        //! Samples with a value greater than the threshold
+        CONDITION_ABOVE = 0,
+
+        //! Samples with a value less than the threshold
+        CONDITION_BELOW,
+
+        //! Runs of samples with the same value (e.g. each state of a mode)
+        CONDITION_CHANGES,
+
+        //! Gaps between samples which are longer than the threshold (e.g. NaN samples, which are not stored)
+        CONDITION_GAPS,
+    };
+
+    /**
+     * @brief The Interval struct describes a run of consecutive samples which satisfy the condition
+     */
+    struct Interval
+    {
+        //! Index of the first sample
+        uint64_t idx_first = 0;
+
+        //! Index one past the last sample
+        uint64_t idx_last = 0;
+
+        //! Timestamps of the first and last samples
+        double t_start = 0;
+        double t_end = 0;
+
+        //! Value of the samples (CONDITION_CHANGES only)
+        double value = 0;
+
+        uint64_t count(void) const { return idx_last - idx_first; }
+        double duration(void) const { return t_end - t_start; }
+    };
+
+    static std::shared_ptr<EventIndex> build(const DataSnapshot &snapshot, int condition, double threshold = 0);
+
+    int getCondition(void) const { return condition; }
+    double getThreshold(void) const { return threshold; }
+
+    size_t size(void) const { return intervals.size(); }
+    bool isEmpty(void) const { return intervals.empty(); }
+
+    const Interval& getInterval(size_t idx) const { return intervals[idx]; }
+
+    //! Number of intervals which start before the specified time
+    size_t lowerBound(double t) const;
+
+    const Interval* next(double t) const;
+    const Interval* previous(double t) const;
+
+    //! Total duration of the intervals
+    double getDuration(void) const;
+
+    DataSnapshot::Statistics getStatistics(const DataSnapshot &snapshot) const;
+
+    std::shared_ptr<EventStore> toEventStore(const QString &label = QString()) const;
+
+    static QString getConditionName(int condition);
+
+protected:
+    int condition = CONDITION_ABOVE;
+    double threshold = 0;
+
+    //! Intervals, in time order (intervals do not overlap)
+    std::vector<Interval> intervals;
+};
+
+typedef std::shared_ptr<const EventIndex> EventIndexPointer;
+
+
+#endif // EVENT_INDEX_HPP
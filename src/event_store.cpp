@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cmath>
+
+#include "event_store.hpp"
+
+
+/**
+ * @brief EventStore::addEvent - Add a single event (events may be added in any order)
+ */
+void EventStore::addEvent(double timestamp, const QString &label)
+{
+    Event event;
+
+    event.timestamp = timestamp;
+    event.label = label;
+
+    // Events are usually added in time order
+    auto it = std::upper_bound(events.begin(), events.end(), timestamp, [](double t, const Event &e) {
+        return t < e.timestamp;
+    });
+
+    events.insert(it, event);
+}
+
+
+/**
+ * @brief EventStore::addEvents - Add multiple events (sorting once, rather than for each event)
+ */
+void EventStore::addEvents(const std::vector<Event> &e)
+{
+    const size_t n = events.size();
+
+    events.insert(events.end(), e.begin(), e.end());
+
+    auto byTime = [](const Event &a, const Event &b) { return a.timestamp < b.timestamp; };
+
+    std::stable_sort(events.begin() + n, events.end(), byTime);
+    std::inplace_merge(events.begin(), events.begin() + n, events.end(), byTime);
+}
+
+
+//! Index of the first event at or after time t
+size_t EventStore::lowerBound(double t) const
+{
+    return std::lower_bound(events.begin(), events.end(), t, [](const Event &e, double t) {
+        return e.timestamp < t;
+    }) - events.begin();
+}
+
+
+//! Index of the first event after time t
+size_t EventStore::upperBound(double t) const
+{
+    return std::upper_bound(events.begin(), events.end(), t, [](double t, const Event &e) {
+        return t < e.timestamp;
+    }) - events.begin();
+}
+
+
+/**
+ * @brief EventStore::getClusters - Group the events within a time range into clusters.
+ * Each cluster contains the events within the specified spacing of its first event, so that (with the
+ * spacing set to a few pixels) every cluster can be drawn separately. Each cluster is located by binary
+ * search from the previous cluster, without visiting the events it contains.
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range (inclusive)
+ * @param spacing - Minimum time between the first events of successive clusters
+ */
+std::vector<EventStore::Cluster> EventStore::getClusters(double t_min, double t_max, double spacing) const
+{
+    std::vector<Cluster> clusters;
+
+    size_t idx = lowerBound(t_min);
+    const size_t last = upperBound(t_max);
+
+    while (idx < last)
+    {
+        Cluster cluster;
+
+        cluster.index = idx;
+        cluster.t_first = events[idx].timestamp;
+
+        size_t next = std::min(last, upperBound(cluster.t_first + std::max(spacing, 0.0)));
+
+        // Always advance, even if the spacing is too small to be represented
+        next = std::max(next, idx + 1);
+
+        cluster.count = next - idx;
+        cluster.t_last = events[next - 1].timestamp;
+
+        clusters.push_back(cluster);
+
+        idx = next;
+    }
+
+    return clusters;
+}
+
+
+/**
+ * @brief EventStore::fromChanges - Create an event for each change of value of a series (e.g. a flag or a mode).
+ * The first sample is also an event.
+ * @param snapshot - Samples of the series
+ * @param label - Prefix of the label of each event (followed by the new value)
+ */
+std::shared_ptr<EventStore> EventStore::fromChanges(const DataSnapshot &snapshot, const QString &label)
+{
+    auto store = std::make_shared<EventStore>();
+
+    std::vector<Event> changes;
+
+    bool first = true;
+    double previous = 0;
+
+    for (const DataPoint point : snapshot.getView())
+    {
+        if (first || (point.value != previous && !(std::isnan(point.value) && std::isnan(previous))))
+        {
+            Event event;
+
+            event.timestamp = point.timestamp;
+            event.label = label.isEmpty() ? QString::number(point.value) : label + " = " + QString::number(point.value);
+
+            changes.push_back(event);
+        }
+
+        previous = point.value;
+        first = false;
+    }
+
+    // The samples of a series are in time order
+    store->events.swap(changes);
+
+    return store;
+}
@@ -0,0 +1,72 @@
+#ifndef EVENT_STORE_HPP
+#define EVENT_STORE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include <QString>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The EventStore class holds a set of timestamped events (e.g. every fault flag of a log), in time order.
+ *
+ * Events are located by binary search, so the events within any interval are found without visiting
+ * the others. Dense events are grouped into clusters (see getClusters), at a cost proportional to
+ * the number of clusters rather than the number of events, so a plot can overlay a very large
+ * number of events.
+ */
+class EventStore
+{
+public:
+    struct Event
+    {
+        double timestamp = 0;
+        QString label;
+    };
+
+    /**
+     * @brief The Cluster struct describes a run of consecutive events, which are drawn as one
+     */
+    struct Cluster
+    {
+        //! Index of the first event
+        size_t index = 0;
+
+        //! Number of events
+        size_t count = 0;
+
+        double t_first = 0;
+        double t_last = 0;
+    };
+
+    size_t size(void) const { return events.size(); }
+    bool isEmpty(void) const { return events.empty(); }
+
+    void clear(void) { events.clear(); }
+
+    void addEvent(double timestamp, const QString &label = QString());
+    void addEvents(const std::vector<Event> &e);
+
+    const Event& getEvent(size_t idx) const { return events[idx]; }
+
+    size_t lowerBound(double t) const;
+    size_t upperBound(double t) const;
+
+    std::vector<Cluster> getClusters(double t_min, double t_max, double spacing) const;
+
+    static std::shared_ptr<EventStore> fromChanges(const DataSnapshot &snapshot, const QString &label = QString());
+
+protected:
+    //! Events, in timestamp order (events with equal timestamps are kept in the order they were added)
+    std::vector<Event> events;
+};
+
+typedef std::shared_ptr<const EventStore> EventStorePointer;
+
+
+#endif // EVENT_STORE_HPP
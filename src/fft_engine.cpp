@@ -0,0 +1,591 @@
+#include <algorithm>
+#include <cmath>
+
+#include "fft_engine.hpp"
+
+
+const size_t FFTPlan::MAX_RADIX;
+const size_t FFTEngine::PLAN_CACHE_SIZE;
+const size_t FFTEngine::FILTER_TAPS_PER_FACTOR;
+
+QMutex FFTEngine::cacheMutex;
+
+std::list<std::shared_ptr<const FFTPlan>> FFTEngine::plans;
+std::list<std::shared_ptr<const RealFFTPlan>> FFTEngine::realPlans;
+
+
+FFTPlan::FFTPlan(size_t size) : n(size)
+{
+    if (n == 0) return;
+
+    // Factor into radix-4 stages first, then radix-2, then odd factors
+    size_t remaining = n;
+    size_t p = 4;
+
+    while (remaining > 1)
+    {
+        while (remaining % p)
+        {
+            switch (p)
+            {
+            case 4: p = 2; break;
+            case 2: p = 3; break;
+            default: p += 2; break;
+            }
+
+            if (p * p > remaining) p = remaining;
+        }
+
+        remaining /= p;
+
+        Stage stage;
+
+        stage.p = p;
+        stage.m = remaining;
+        stage.twiddles = 0;
+
+        stages.push_back(stage);
+
+        if (p > MAX_RADIX) bluestein = true;
+    }
+
+    if (!bluestein)
+    {
+        roots.resize(MAX_RADIX + 1);
+
+        for (auto& stage : stages)
+        {
+            stage.twiddles = twiddles.size();
+
+            const size_t length = stage.p * stage.m;
+
+            for (size_t q = 1; q < stage.p; q++)
+            {
+                for (size_t k = 0; k < stage.m; k++)
+                {
+                    twiddles.push_back(std::polar(1.0, -2 * M_PI * (double) (q * k) / length));
+                }
+            }
+
+            if (stage.p != 2 && stage.p != 4 && roots[stage.p].empty())
+            {
+                for (size_t k = 0; k < stage.p; k++)
+                {
+                    roots[stage.p].push_back(std::polar(1.0, -2 * M_PI * k / stage.p));
+                }
+            }
+        }
+
+        return;
+    }
+
+    stages.clear();
+
+    // Convolution length (power of two, at least 2n - 1)
+    size_t m = 1;
+
+    while (m < 2 * n - 1) m <<= 1;
+
+    convolution = FFTEngine::getPlan(m);
+
+    chirp.resize(n);
+
+    for (size_t k = 0; k < n; k++)
+    {
+        // k^2 is reduced modulo 2n, retaining precision for large sizes
+        const size_t k2 = (size_t) ((unsigned long long) k * k % (2 * n));
+
+        chirp[k] = std::polar(1.0, -M_PI * k2 / n);
+    }
+
+    std::vector<FFTComplex> b(m, FFTComplex(0, 0));
+
+    b[0] = std::conj(chirp[0]);
+
+    for (size_t k = 1; k < n; k++)
+    {
+        b[k] = b[m - k] = std::conj(chirp[k]);
+    }
+
+    chirpSpectrum.resize(m);
+    convolution->transform(b.data(), chirpSpectrum.data());
+
+    // The inverse transform is computed as a forward transform of the conjugate, divided by m
+    for (auto& value : chirpSpectrum)
+    {
+        value /= (double) m;
+    }
+}
+
+
+/**
+ * @brief FFTPlan::transform - Compute the forward transform
+ * @param input points to n complex samples
+ * @param output points to n complex bins (must not overlap the input)
+ */
+void FFTPlan::transform(const FFTComplex* input, FFTComplex* output) const
+{
+    if (n == 0) return;
+
+    if (n == 1)
+    {
+        output[0] = input[0];
+        return;
+    }
+
+    if (bluestein)
+    {
+        transformBluestein(input, output);
+        return;
+    }
+
+    work(output, input, 1, 0);
+}
+
+
+/*
+ * Decimation in time: the sub-transforms (of every p-th sample) are computed into consecutive
+ * blocks of the output, and then combined in place by the butterflies for this stage.
+ */
+void FFTPlan::work(FFTComplex* output, const FFTComplex* input, size_t stride, size_t stage) const
+{
+    const size_t p = stages[stage].p;
+    const size_t m = stages[stage].m;
+
+    if (m == 1)
+    {
+        for (size_t ii = 0; ii < p; ii++)
+        {
+            output[ii] = input[ii * stride];
+        }
+    }
+    else
+    {
+        for (size_t ii = 0; ii < p; ii++)
+        {
+            work(output + ii * m, input + ii * stride, stride * p, stage + 1);
+        }
+    }
+
+    const FFTComplex* tw = twiddles.data() + stages[stage].twiddles;
+
+    switch (p)
+    {
+    case 2:
+        butterfly2(output, tw, m);
+        break;
+    case 4:
+        butterfly4(output, tw, m);
+        break;
+    default:
+        butterflyGeneric(output, tw, m, p);
+        break;
+    }
+}
+
+
+void FFTPlan::butterfly2(FFTComplex* output, const FFTComplex* tw, size_t m) const
+{
+    FFTComplex* output2 = output + m;
+
+    for (size_t k = 0; k < m; k++)
+    {
+        const FFTComplex t = output2[k] * tw[k];
+
+        output2[k] = output[k] - t;
+        output[k] += t;
+    }
+}
+
+
+void FFTPlan::butterfly4(FFTComplex* output, const FFTComplex* tw, size_t m) const
+{
+    for (size_t k = 0; k < m; k++)
+    {
+        const FFTComplex s0 = output[k + m] * tw[k];
+        const FFTComplex s1 = output[k + 2 * m] * tw[k + m];
+        const FFTComplex s2 = output[k + 3 * m] * tw[k + 2 * m];
+
+        const FFTComplex s5 = output[k] - s1;
+        const FFTComplex s3 = s0 + s2;
+        const FFTComplex s4 = s0 - s2;
+
+        output[k] += s1;
+
+        output[k + 2 * m] = output[k] - s3;
+        output[k] += s3;
+
+        // Multiplication of s4 by -i
+        output[k + m] = FFTComplex(s5.real() + s4.imag(), s5.imag() - s4.real());
+        output[k + 3 * m] = FFTComplex(s5.real() - s4.imag(), s5.imag() + s4.real());
+    }
+}
+
+
+/*
+ * The sub-transform outputs are multiplied by the stage twiddles, followed by a (naive) DFT of length p
+ */
+void FFTPlan::butterflyGeneric(FFTComplex* output, const FFTComplex* tw, size_t m, size_t p) const
+{
+    const FFTComplex* root = roots[p].data();
+
+    FFTComplex scratch[MAX_RADIX];
+
+    for (size_t k = 0; k < m; k++)
+    {
+        scratch[0] = output[k];
+
+        for (size_t q = 1; q < p; q++)
+        {
+            scratch[q] = output[k + q * m] * tw[(q - 1) * m + k];
+        }
+
+        for (size_t q1 = 0; q1 < p; q1++)
+        {
+            FFTComplex sum = scratch[0];
+
+            size_t idx = 0;
+
+            for (size_t q = 1; q < p; q++)
+            {
+                idx += q1;
+
+                if (idx >= p) idx -= p;
+
+                sum += scratch[q] * root[idx];
+            }
+
+            output[k + q1 * m] = sum;
+        }
+    }
+}
+
+
+/*
+ * X[k] = chirp[k] * (a * b)[k], where a[k] = x[k] * chirp[k] and b[k] = conj(chirp[k])
+ */
+void FFTPlan::transformBluestein(const FFTComplex* input, FFTComplex* output) const
+{
+    const size_t m = convolution->size();
+
+    std::vector<FFTComplex> a(m, FFTComplex(0, 0));
+    std::vector<FFTComplex> spectrum(m);
+
+    for (size_t k = 0; k < n; k++)
+    {
+        a[k] = input[k] * chirp[k];
+    }
+
+    convolution->transform(a.data(), spectrum.data());
+
+    for (size_t k = 0; k < m; k++)
+    {
+        spectrum[k] = std::conj(spectrum[k] * chirpSpectrum[k]);
+    }
+
+    convolution->transform(spectrum.data(), a.data());
+
+    for (size_t k = 0; k < n; k++)
+    {
+        output[k] = std::conj(a[k]) * chirp[k];
+    }
+}
+
+
+RealFFTPlan::RealFFTPlan(size_t size) : n(size)
+{
+    if (n == 0) return;
+
+    if (n % 2)
+    {
+        plan = FFTEngine::getPlan(n);
+        return;
+    }
+
+    plan = FFTEngine::getPlan(n / 2);
+
+    twiddles.resize(n / 2 + 1);
+
+    for (size_t k = 0; k <= n / 2; k++)
+    {
+        twiddles[k] = std::polar(1.0, -2 * M_PI * k / n);
+    }
+}
+
+
+/**
+ * @brief RealFFTPlan::transform - Compute the spectrum of real samples
+ * @param input points to n samples
+ * @param output points to getBinCount() complex bins
+ */
+void RealFFTPlan::transform(const double* input, FFTComplex* output) const
+{
+    if (n == 0) return;
+
+    if (n % 2)
+    {
+        std::vector<FFTComplex> data(input, input + n);
+        std::vector<FFTComplex> spectrum(n);
+
+        plan->transform(data.data(), spectrum.data());
+
+        std::copy(spectrum.begin(), spectrum.begin() + getBinCount(), output);
+        return;
+    }
+
+    const size_t half = n / 2;
+
+    // Even samples are packed into the real part, odd samples into the imaginary part
+    std::vector<FFTComplex> packed(half);
+    std::vector<FFTComplex> z(half);
+
+    for (size_t k = 0; k < half; k++)
+    {
+        packed[k] = FFTComplex(input[2 * k], input[2 * k + 1]);
+    }
+
+    plan->transform(packed.data(), z.data());
+
+    for (size_t k = 0; k <= half; k++)
+    {
+        const FFTComplex zk = z[k % half];
+        const FFTComplex zc = std::conj(z[(half - k) % half]);
+
+        // Spectra of the even and odd samples
+        const FFTComplex even = (zk + zc) * 0.5;
+        const FFTComplex odd = (zk - zc) * FFTComplex(0, -0.5);
+
+        output[k] = even + twiddles[k] * odd;
+    }
+}
+
+
+/*
+ * Return a cached plan for the specified size (the plan is created if required)
+ */
+std::shared_ptr<const FFTPlan> FFTEngine::getPlan(size_t n)
+{
+    {
+        QMutexLocker lock(&cacheMutex);
+
+        for (auto it = plans.begin(); it != plans.end(); it++)
+        {
+            if ((*it)->size() == n)
+            {
+                plans.splice(plans.begin(), plans, it);
+                return plans.front();
+            }
+        }
+    }
+
+    // Plans are created without holding the lock (a Bluestein plan requires a second plan)
+    auto plan = std::make_shared<const FFTPlan>(n);
+
+    QMutexLocker lock(&cacheMutex);
+
+    plans.push_front(plan);
+
+    if (plans.size() > PLAN_CACHE_SIZE) plans.pop_back();
+
+    return plan;
+}
+
+
+std::shared_ptr<const RealFFTPlan> FFTEngine::getRealPlan(size_t n)
+{
+    {
+        QMutexLocker lock(&cacheMutex);
+
+        for (auto it = realPlans.begin(); it != realPlans.end(); it++)
+        {
+            if ((*it)->size() == n)
+            {
+                realPlans.splice(realPlans.begin(), realPlans, it);
+                return realPlans.front();
+            }
+        }
+    }
+
+    auto plan = std::make_shared<const RealFFTPlan>(n);
+
+    QMutexLocker lock(&cacheMutex);
+
+    realPlans.push_front(plan);
+
+    if (realPlans.size() > PLAN_CACHE_SIZE) realPlans.pop_back();
+
+    return plan;
+}
+
+
+/*
+ * Return the largest size (not exceeding n) which has no prime factors larger than 7.
+ * Such sizes are transformed by small butterflies only; the gap to n is at most a few percent.
+ */
+size_t FFTEngine::getEfficientSize(size_t n)
+{
+    for (size_t size = n; size > 1; size--)
+    {
+        size_t remaining = size;
+
+        for (size_t p : {2, 3, 5, 7})
+        {
+            while (remaining % p == 0) remaining /= p;
+        }
+
+        if (remaining == 1) return size;
+    }
+
+    return n;
+}
+
+
+/*
+ * Periodic window coefficients (as used for spectral analysis)
+ */
+double FFTEngine::getWindowValue(int window, size_t idx, size_t n)
+{
+    const double x = 2 * M_PI * idx / n;
+
+    switch (window)
+    {
+    case WINDOW_HANN:
+        return 0.5 - 0.5 * std::cos(x);
+    case WINDOW_BLACKMAN:
+        return 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x);
+    default:
+        return 1.0;
+    }
+}
+
+
+/**
+ * @brief FFTEngine::applyWindow - Multiply the samples by the selected window function
+ * @return the coherent gain of the window (the mean coefficient), to correct amplitudes
+ */
+double FFTEngine::applyWindow(double* data, size_t n, int window)
+{
+    if (n == 0 || window == WINDOW_RECTANGULAR) return 1.0;
+
+    // cos(2 pi idx / n) is computed by rotating a phasor, which is re-calculated exactly every
+    // WINDOW_BLOCK samples (calling std::cos for every sample of a long window is expensive)
+    const size_t WINDOW_BLOCK = 1024;
+
+    const FFTComplex step = std::polar(1.0, 2 * M_PI / n);
+
+    double sum = 0;
+
+    for (size_t block = 0; block < n; block += WINDOW_BLOCK)
+    {
+        FFTComplex phasor = std::polar(1.0, 2 * M_PI * block / n);
+
+        const size_t end = std::min(n, block + WINDOW_BLOCK);
+
+        for (size_t idx = block; idx < end; idx++)
+        {
+            const double c = phasor.real();
+
+            // cos(2x) = 2 cos^2(x) - 1
+            const double w = window == WINDOW_HANN ? 0.5 - 0.5 * c : 0.42 - 0.5 * c + 0.08 * (2 * c * c - 1);
+
+            data[idx] *= w;
+            sum += w;
+
+            phasor *= step;
+        }
+    }
+
+    return sum / n;
+}
+
+
+/*
+ * Half-width of the main lobe of the window, in bins (a tone spreads into this many bins either side)
+ */
+size_t FFTEngine::getMainLobeWidth(int window)
+{
+    switch (window)
+    {
+    case WINDOW_HANN:
+        return 2;
+    case WINDOW_BLACKMAN:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+
+/*
+ * Return the window coefficients for a segment of n samples (to be re-used for many segments)
+ */
+std::vector<double> FFTEngine::getWindowCoefficients(int window, size_t n)
+{
+    std::vector<double> coefficients(n, 1.0);
+
+    applyWindow(coefficients.data(), n, window);
+
+    return coefficients;
+}
+
+
+/*
+ * Design an anti-alias filter for decimation by the specified factor (a Blackman windowed sinc,
+ * with unity gain at DC). The filter has an odd number of taps, and is symmetric about the centre tap.
+ */
+std::vector<double> FFTEngine::getLowPassFilter(size_t factor)
+{
+    const size_t half = FILTER_TAPS_PER_FACTOR * factor;
+    const size_t n = 2 * half + 1;
+
+    // Cutoff slightly below the decimated Nyquist frequency (cycles per input sample)
+    const double fc = 0.45 / factor;
+
+    std::vector<double> taps(n);
+
+    double sum = 0;
+
+    for (size_t k = 0; k < n; k++)
+    {
+        const double x = (double) k - (double) half;
+        const double sinc = x == 0 ? 2 * fc : std::sin(2 * M_PI * fc * x) / (M_PI * x);
+        const double w = 0.42 - 0.5 * std::cos(2 * M_PI * k / (n - 1)) + 0.08 * std::cos(4 * M_PI * k / (n - 1));
+
+        taps[k] = sinc * w;
+        sum += taps[k];
+    }
+
+    for (auto& tap : taps)
+    {
+        tap /= sum;
+    }
+
+    return taps;
+}
+
+
+/**
+ * @brief FFTEngine::accumulatePower - Window and transform a segment, adding the power of each bin
+ * @param plan is the transform for the segment length
+ * @param samples is the segment (the window is applied in place)
+ * @param coefficients are the window coefficients (see getWindowCoefficients)
+ * @param bins is scratch space for the transform
+ * @param power points to plan.getBinCount() values, to which |X[k]|^2 is added
+ */
+void FFTEngine::accumulatePower(const RealFFTPlan& plan, double* samples, const std::vector<double>& coefficients,
+                                std::vector<FFTComplex>& bins, double* power)
+{
+    bins.resize(plan.getBinCount());
+
+    for (size_t idx = 0; idx < plan.size(); idx++)
+    {
+        samples[idx] *= coefficients[idx];
+    }
+
+    plan.transform(samples, bins.data());
+
+    for (size_t k = 0; k < bins.size(); k++)
+    {
+        power[k] += std::norm(bins[k]);
+    }
+}
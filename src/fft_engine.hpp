@@ -0,0 +1,152 @@
+#ifndef FFT_ENGINE_HPP
+#define FFT_ENGINE_HPP
+
+#include <complex>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+
+
+typedef std::complex<double> FFTComplex;
+
+
+/**
+ * @brief The FFTPlan class computes the (forward) discrete Fourier transform of a fixed size.
+ *
+ * Any size is supported: the size is factored into radix-4, radix-2 and (small odd) generic
+ * butterflies, using twiddle factors computed once when the plan is created.
+ * Sizes with a large prime factor are computed with Bluestein's algorithm, as a convolution
+ * using a power-of-two plan.
+ *
+ * Plans are immutable once created, so a single plan may be used from many threads at once.
+ */
+class FFTPlan
+{
+public:
+    explicit FFTPlan(size_t n);
+
+    //! Factors larger than this are computed with Bluestein's algorithm
+    static const size_t MAX_RADIX = 31;
+
+    size_t size(void) const { return n; }
+
+    void transform(const FFTComplex* input, FFTComplex* output) const;
+
+protected:
+    void work(FFTComplex* output, const FFTComplex* input, size_t stride, size_t stage) const;
+
+    void butterfly2(FFTComplex* output, const FFTComplex* tw, size_t m) const;
+    void butterfly4(FFTComplex* output, const FFTComplex* tw, size_t m) const;
+    void butterflyGeneric(FFTComplex* output, const FFTComplex* tw, size_t m, size_t p) const;
+
+    void transformBluestein(const FFTComplex* input, FFTComplex* output) const;
+
+    size_t n = 0;
+
+    struct Stage
+    {
+        //! Radix
+        size_t p;
+
+        //! Length of the sub-transforms
+        size_t m;
+
+        //! Offset of the stage twiddles, exp(-2 pi i q k / (p m)) for q = 1 .. p-1, k = 0 .. m-1
+        size_t twiddles;
+    };
+
+    std::vector<Stage> stages;
+
+    //! Twiddle factors for every stage (stored contiguously, in the order they are used)
+    std::vector<FFTComplex> twiddles;
+
+    //! exp(-2 pi i k / p), for the generic butterfly of each radix
+    std::vector<std::vector<FFTComplex>> roots;
+
+    bool bluestein = false;
+
+    //! Power-of-two plan used for the Bluestein convolution
+    std::shared_ptr<const FFTPlan> convolution;
+
+    //! exp(-pi i k^2 / n)
+    std::vector<FFTComplex> chirp;
+
+    //! Transform of the conjugate chirp (scaled for the inverse transform)
+    std::vector<FFTComplex> chirpSpectrum;
+};
+
+
+/**
+ * @brief The RealFFTPlan class computes the spectrum of real-valued samples.
+ *
+ * Even sizes are computed as a complex transform of half the size (packing pairs of samples
+ * into a single complex value), which is twice as fast as a complex transform of the full size.
+ * Only the non-negative frequency bins (n / 2 + 1) are returned.
+ */
+class RealFFTPlan
+{
+public:
+    explicit RealFFTPlan(size_t n);
+
+    size_t size(void) const { return n; }
+    size_t getBinCount(void) const { return n / 2 + 1; }
+
+    void transform(const double* input, FFTComplex* output) const;
+
+protected:
+    size_t n = 0;
+
+    std::shared_ptr<const FFTPlan> plan;
+
+    //! exp(-2 pi i k / n), to unpack the half-size transform
+    std::vector<FFTComplex> twiddles;
+};
+
+
+/*
+ * Plan cache and window functions shared by spectrum calculations
+ */
+class FFTEngine
+{
+public:
+    enum Window
+    {
+        WINDOW_RECTANGULAR = 0,
+        WINDOW_HANN = 1,
+        WINDOW_BLACKMAN = 2,
+    };
+
+    //! Number of plans of each type retained (least recently used plans are discarded)
+    static const size_t PLAN_CACHE_SIZE = 16;
+
+    static std::shared_ptr<const FFTPlan> getPlan(size_t n);
+    static std::shared_ptr<const RealFFTPlan> getRealPlan(size_t n);
+
+    static size_t getEfficientSize(size_t n);
+
+    static double getWindowValue(int window, size_t idx, size_t n);
+    static double applyWindow(double* data, size_t n, int window);
+
+    static size_t getMainLobeWidth(int window);
+
+    static std::vector<double> getWindowCoefficients(int window, size_t n);
+
+    //! Taps (either side of the centre tap) per unit of decimation, for getLowPassFilter
+    static const size_t FILTER_TAPS_PER_FACTOR = 4;
+
+    static std::vector<double> getLowPassFilter(size_t factor);
+
+    static void accumulatePower(const RealFFTPlan& plan, double* samples, const std::vector<double>& coefficients,
+                                std::vector<FFTComplex>& bins, double* power);
+
+protected:
+    static QMutex cacheMutex;
+
+    static std::list<std::shared_ptr<const FFTPlan>> plans;
+    static std::list<std::shared_ptr<const RealFFTPlan>> realPlans;
+};
+
+
+#endif // FFT_ENGINE_HPP
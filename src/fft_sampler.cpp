@@ -1,17 +1,27 @@
+#include <algorithm>
+#include <iterator>
+
 #include <qmath.h>
 #include <qglobal.h>
-#include <qelapsedtimer.h>
 
 #include "fft_sampler.hpp"
+#include "parallel_for.hpp"
+#include "trace_recorder.hpp"
 
-#define __USE_SQUARE_BRACKETS_FOR_ELEMENT_ACCESS_OPERATOR
 
-#include "fft/include/simple_fft/fft_settings.h"
-#include "fft/include/simple_fft/fft.h"
+const uint64_t FFTCurveUpdater::MAX_FFT_BINS;
+const uint64_t FFTCurveUpdater::MIN_FFT_SAMPLES;
+const uint64_t FFTCurveUpdater::WELCH_SEGMENT_SIZE;
+const uint64_t FFTCurveUpdater::WELCH_MIN_SAMPLES;
+const uint64_t FFTCurveUpdater::WELCH_CHUNKS;
+const size_t FFTCurveUpdater::MAX_CACHED_SEGMENTS;
+const uint64_t FFTCurveUpdater::MAX_FFT_LENGTH;
+const size_t FFTCurveUpdater::SPECTRUM_CACHE_MEMORY;
 
+QMutex FFTCurveUpdater::spectrumMutex;
 
-typedef std::vector<real_type> RealArray1D;
-typedef std::vector<complex_type> ComplexArray1D;
+std::list<FFTCurveUpdater::CachedSpectrum> FFTCurveUpdater::spectrumCache;
+size_t FFTCurveUpdater::spectrumCacheMemory = 0;
 
 
 FFTCurveUpdater::FFTCurveUpdater(DataSeries &data_series) : PlotCurveUpdater(data_series)
@@ -20,6 +30,372 @@ FFTCurveUpdater::FFTCurveUpdater(DataSeries &data_series) : PlotCurveUpdater(dat
 }
 
 
+/*
+ * A running request uses the segment cache, so it must finish before the members are destroyed
+ * (the base class destructor runs too late)
+ */
+FFTCurveUpdater::~FFTCurveUpdater()
+{
+    cancelRequests();
+    waitForRequests();
+}
+
+
+/*
+ * Select the window function applied to the samples (the spectrum is recomputed on the next request)
+ */
+void FFTCurveUpdater::setWindow(int w)
+{
+    window.store(w);
+}
+
+
+bool FFTCurveUpdater::SpectrumKey::matches(const SpectrumKey& other) const
+{
+    if (series != other.series || count != other.count || scaler != other.scaler || offset != other.offset ||
+        idx_min != other.idx_min || idx_max != other.idx_max || window != other.window ||
+        welch != other.welch || decimation != other.decimation || resample != other.resample)
+    {
+        return false;
+    }
+
+    const auto current = table.lock();
+
+    return current && current == other.table.lock();
+}
+
+
+/*
+ * Return a previously computed spectrum (or nullptr if not cached)
+ */
+PlotSamplesPointer FFTCurveUpdater::findSpectrum(const SpectrumKey& key)
+{
+    QMutexLocker lock(&spectrumMutex);
+
+    for (auto it = spectrumCache.begin(); it != spectrumCache.end(); it++)
+    {
+        if (it->key.matches(key))
+        {
+            spectrumCache.splice(spectrumCache.begin(), spectrumCache, it);
+            return spectrumCache.front().samples;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Retain a computed spectrum, discarding the least recently used spectra (and any spectra
+ * of samples which no longer exist) to limit memory use
+ */
+void FFTCurveUpdater::cacheSpectrum(const SpectrumKey& key, PlotSamplesPointer samples)
+{
+    CachedSpectrum entry;
+
+    entry.key = key;
+    entry.samples = samples;
+
+    if (entry.getMemory() > SPECTRUM_CACHE_MEMORY) return;
+
+    QMutexLocker lock(&spectrumMutex);
+
+    for (auto it = spectrumCache.begin(); it != spectrumCache.end();)
+    {
+        if (it->key.table.expired())
+        {
+            spectrumCacheMemory -= it->getMemory();
+            it = spectrumCache.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    spectrumCacheMemory += entry.getMemory();
+    spectrumCache.push_front(entry);
+
+    while (spectrumCacheMemory > SPECTRUM_CACHE_MEMORY)
+    {
+        spectrumCacheMemory -= spectrumCache.back().getMemory();
+        spectrumCache.pop_back();
+    }
+}
+
+
+void FFTCurveUpdater::clearSpectrumCache()
+{
+    QMutexLocker lock(&spectrumMutex);
+
+    spectrumCache.clear();
+    spectrumCacheMemory = 0;
+}
+
+
+/**
+ * @brief FFTCurveUpdater::readUniform - Read consecutive points of the uniform grid
+ * @param cursor is used to read the samples (sequential reads are fastest)
+ * @param grid describes the grid (and any decimation)
+ * @param first is the index of the first point
+ * @param n is the number of points
+ * @param output receives the values
+ */
+void FFTCurveUpdater::readUniform(DataCursor& cursor, const UniformGrid& grid, uint64_t first, uint64_t n, double* output) const
+{
+    const int mode = resample_latest;
+
+    if (grid.decimation <= 1)
+    {
+        cursor.resample(grid.t0 + first * grid.dt, grid.dt, n, output, mode);
+        return;
+    }
+
+    // Points are filtered from the full rate grid, one block at a time
+    const uint64_t D = grid.decimation;
+    const uint64_t half = grid.filter.size() / 2;
+    const uint64_t BLOCK = 0x1000;
+
+    std::vector<double> input;
+
+    for (uint64_t block = 0; block < n; block += BLOCK)
+    {
+        const uint64_t count = std::min(BLOCK, n - block);
+
+        // First full rate point (centre of the filter for output point zero, less the filter half-width)
+        const int64_t start = (int64_t) ((first + block) * D) - (int64_t) half;
+
+        input.resize((count - 1) * D + grid.filter.size());
+
+        cursor.resample(grid.t0 + start * grid.dt, grid.dt, input.size(), input.data(), mode);
+
+        for (uint64_t ii = 0; ii < count; ii++)
+        {
+            const double* x = input.data() + ii * D;
+
+            double sum = 0;
+
+            for (size_t k = 0; k < grid.filter.size(); k++)
+            {
+                sum += grid.filter[k] * x[k];
+            }
+
+            output[block + ii] = sum;
+        }
+    }
+}
+
+
+/*
+ * Compute the Welch spectrum (the square root of the mean power of each bin, over segments with 50% overlap).
+ *
+ * Segments are aligned to a fixed time grid rather than to the start of the view, and the power of each
+ * segment is retained: when the view is panned only the newly exposed segments are transformed (a large
+ * shift exposes every segment, which is equivalent to a full recompute). Segments are transformed in
+ * parallel, using the curve thread pool. The grid is updated to the segment grid.
+ *
+ * Returns false if abandoned in favour of a newer request.
+ */
+bool FFTCurveUpdater::computeWelchSpectrum(const DataSnapshot& snapshot, double t_min, double t_max, UniformGrid& grid, int w, std::vector<double>& magnitude)
+{
+    magnitude.clear();
+
+    // The segment grid is determined by the sample period, so it is only estimated once
+    if (welch_dt <= 0 || segmentCache.empty())
+    {
+        welch_dt = (snapshot.getTimestamp(snapshot.size() - 1) - snapshot.getTimestamp(0)) / (snapshot.size() - 1);
+    }
+
+    if (!(welch_dt > 0)) return true;
+
+    grid.dt = welch_dt;
+
+    updateSegmentCache(snapshot, grid, w);
+
+    const uint64_t hop = WELCH_SEGMENT_SIZE / 2;
+    const double t_hop = hop * grid.getPeriod();
+    const double t_segment = WELCH_SEGMENT_SIZE * grid.getPeriod();
+
+    // Segments which lie entirely within the view
+    const int64_t k_first = (int64_t) std::ceil(t_min / t_hop);
+    const int64_t k_last = (int64_t) std::floor((t_max - t_segment) / t_hop);
+
+    if (k_last < k_first) return true;
+
+    const uint64_t n_segments = k_last - k_first + 1;
+
+    grid.t0 = k_first * t_hop;
+
+    // Views with too many segments to retain are recomputed in full
+    const bool retain = n_segments <= MAX_CACHED_SEGMENTS;
+
+    if (!retain) segmentCache.clear();
+
+    std::vector<int64_t> missing;
+
+    for (int64_t k = k_first; k <= k_last; k++)
+    {
+        if (segmentCache.find(k) == segmentCache.end()) missing.push_back(k);
+    }
+
+    const auto plan = FFTEngine::getRealPlan(WELCH_SEGMENT_SIZE);
+    const size_t n_bins = plan->getBinCount();
+
+    magnitude.assign(n_bins, 0);
+
+    if (!missing.empty())
+    {
+        const auto coefficients = FFTEngine::getWindowCoefficients(w, WELCH_SEGMENT_SIZE);
+
+        // Each chunk transforms a run of consecutive segments (which are read sequentially), and either
+        // retains the power of each segment, or accumulates the power of the entire chunk
+        const uint64_t n_chunks = std::min<uint64_t>(missing.size(), WELCH_CHUNKS);
+
+        std::vector<std::vector<float>> results(retain ? missing.size() : 0);
+        std::vector<std::vector<double>> power(n_chunks);
+
+        parallelFor(n_chunks, [&](size_t chunk) {
+            DataCursor cursor(snapshot);
+
+            std::vector<double> segment(WELCH_SEGMENT_SIZE);
+            std::vector<FFTComplex> bins;
+
+            power[chunk].assign(n_bins, 0);
+
+            for (size_t ii = chunk * missing.size() / n_chunks; ii < (chunk + 1) * missing.size() / n_chunks; ii++)
+            {
+                if (isSuperseded()) return;
+
+                readUniform(cursor, grid, (missing[ii] - k_first) * hop, WELCH_SEGMENT_SIZE, segment.data());
+
+                if (retain) std::fill(power[chunk].begin(), power[chunk].end(), 0);
+
+                FFTEngine::accumulatePower(*plan, segment.data(), coefficients, bins, power[chunk].data());
+
+                if (retain) results[ii].assign(power[chunk].begin(), power[chunk].end());
+            }
+        }, getThreadPool());
+
+        // Segments computed by an abandoned pass are discarded (some may be incomplete)
+        if (isSuperseded()) return false;
+
+        computedSegments += missing.size();
+
+        if (retain)
+        {
+            for (size_t ii = 0; ii < missing.size(); ii++)
+            {
+                segmentCache[missing[ii]].swap(results[ii]);
+            }
+        }
+        else
+        {
+            for (const auto& chunk : power)
+            {
+                for (size_t bin = 0; bin < n_bins; bin++)
+                {
+                    magnitude[bin] += chunk[bin];
+                }
+            }
+        }
+    }
+
+    if (retain)
+    {
+        for (int64_t k = k_first; k <= k_last; k++)
+        {
+            const auto& segment = segmentCache[k];
+
+            for (size_t bin = 0; bin < n_bins; bin++)
+            {
+                magnitude[bin] += segment[bin];
+            }
+        }
+    }
+
+    for (auto& value : magnitude)
+    {
+        value = std::sqrt(value / n_segments);
+    }
+
+    trimSegmentCache((k_first + k_last) / 2);
+
+    return true;
+}
+
+
+/*
+ * Discard any cached segments which are no longer valid: the sample period, decimation, window or scaling
+ * has changed, or the samples within the segment have changed (e.g. the oldest samples have been discarded).
+ */
+void FFTCurveUpdater::updateSegmentCache(const DataSnapshot& snapshot, const UniformGrid& grid, int w)
+{
+    const bool compatible = grid.getPeriod() == segment_period && w == segment_window &&
+                            resample_latest == segment_resample &&
+                            snapshot.getScaler() == segment_snapshot.getScaler() &&
+                            snapshot.getOffset() == segment_snapshot.getOffset();
+
+    uint64_t idx_first = 0;
+    uint64_t idx_last = 0;
+
+    if (!compatible || !snapshot.getCommonRange(segment_snapshot, idx_first, idx_last) || idx_last - idx_first < 4)
+    {
+        segmentCache.clear();
+    }
+    else if (!snapshot.isIdentical(segment_snapshot))
+    {
+        // Segments which lie strictly within the common range (including the interpolated neighbours,
+        // and the span of the anti-alias filter) are unchanged
+        const double margin = (grid.filter.size() / 2) * grid.dt;
+        const double t_hop = (WELCH_SEGMENT_SIZE / 2) * grid.getPeriod();
+        const double t_segment = WELCH_SEGMENT_SIZE * grid.getPeriod();
+
+        const double t_first = snapshot.getTimestamp(idx_first + 1) + margin;
+        const double t_last = snapshot.getTimestamp(idx_last - 2) - margin;
+
+        for (auto it = segmentCache.begin(); it != segmentCache.end();)
+        {
+            const double t = it->first * t_hop;
+
+            if (t < t_first || t + t_segment > t_last)
+            {
+                it = segmentCache.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+    segment_snapshot = snapshot;
+    segment_period = grid.getPeriod();
+    segment_window = w;
+    segment_resample = resample_latest;
+}
+
+
+/*
+ * Discard the cached segments furthest from the specified segment, to limit memory use
+ */
+void FFTCurveUpdater::trimSegmentCache(int64_t center)
+{
+    while (segmentCache.size() > MAX_CACHED_SEGMENTS)
+    {
+        auto first = segmentCache.begin();
+        auto last = std::prev(segmentCache.end());
+
+        if (center - first->first > last->first - center)
+        {
+            segmentCache.erase(first);
+        }
+        else
+        {
+            segmentCache.erase(last);
+        }
+    }
+}
+
 
 /*
  * Custom curve updater method which calculates the FFT for the provided data.
@@ -28,126 +404,188 @@ void FFTCurveUpdater::updateCurveSamples(double t_min, double t_max, unsigned in
 {
     Q_UNUSED(n_pixels);
 
-    QElapsedTimer fft_timer;
-    fft_timer.restart();
+    TRACE_SCOPE("FFT", "fft");
 
-    // Initialize empty arrays
-    QVector<double> x_data;
-    QVector<double> y_data;
+    // Initialize empty output
+    auto output = acquireBuffer();
 
     if (series.size() == 0)
     {
-        emit sampleComplete(x_data, y_data);
+        emit sampleComplete(output, 1.0, 0.0);
         return;
     }
 
+    const int w = window.load();
+    const bool welch_enabled = welchEnabled.load();
+    const bool decimation_enabled = decimationEnabled.load();
+    const int resample_mode = resampleMode.load();
+
     // If the arguments are the same as last time, ignore
-    if (t_min == t_min_latest && t_max == t_max_latest)
+    if (t_min == t_min_latest && t_max == t_max_latest && w == window_latest && welch_enabled == welch_latest &&
+        decimation_enabled == decimation_latest && resample_mode == resample_latest)
     {
         return;
     }
 
     t_min_latest = t_min;
     t_max_latest = t_max;
+    window_latest = w;
+    welch_latest = welch_enabled;
+    decimation_latest = decimation_enabled;
+    resample_latest = resample_mode;
+
 
+    // All samples are read from a single snapshot, without copying the series
+    const auto snapshot = series.getSnapshot();
+
+    if (snapshot.isEmpty())
+    {
+        emit sampleComplete(output, 1.0, 0.0);
+        return;
+    }
 
     // Extract *all* data between the required points
-    auto idx_min = series.getIndexForTimestamp(t_min);
-    auto idx_max = series.getIndexForTimestamp(t_max);
+    auto idx_min = snapshot.upperBound(t_min);
+    auto idx_max = snapshot.upperBound(t_max);
 
     if (idx_min <= 0) idx_min = 0;
-    if (idx_max >= series.size()) idx_max = series.size() - 1;
+    if (idx_max >= snapshot.size()) idx_max = snapshot.size() - 1;
 
     // Recalculate endpoint timestamps
-    t_min = series.getDataPoint(idx_min).timestamp;
-    t_max = series.getDataPoint(idx_max).timestamp;
-
-    auto n_samples = idx_max - idx_min;
+    t_min = snapshot.getTimestamp(idx_min);
+    t_max = snapshot.getTimestamp(idx_max);
 
-    // TODO: Implement a data-pruning algorithm when there are too many samples
-    const uint64_t MAX_FFT_SAMPLES = 0x10000;
-    const uint64_t MIN_FFT_SAMPLES = 0x80;
+    const uint64_t n_samples = idx_max - idx_min;
 
     if (n_samples < MIN_FFT_SAMPLES)
     {
-        emit sampleComplete(x_data, y_data);
+        emit sampleComplete(output, 1.0, 0.0);
         return;
     }
 
-    // For the FFT to work, we assume that the samples are at fixed frequency
-    double timespan = qAbs<double>(t_max - t_min);
-    double dt = timespan / n_samples;
+    // Spectra are cached (across every curve), so returning to an earlier view is immediate
+    SpectrumKey key;
+
+    key.series = &series;
+    key.table = snapshot.getTable();
+    key.count = snapshot.size();
+    key.scaler = snapshot.getScaler();
+    key.offset = snapshot.getOffset();
+    key.idx_min = idx_min;
+    key.idx_max = idx_max;
+    key.window = w;
+    key.welch = welch_enabled;
+    key.decimation = decimation_enabled;
+    key.resample = resample_mode;
+
+    if (auto cached = findSpectrum(key))
+    {
+        emit sampleComplete(cached, 1.0, 0.0);
+        return;
+    }
+
+    // The spectrum is retained by the cache, so it is not written to a re-usable buffer
+    auto spectrum = std::make_shared<PlotSamples>();
 
-    // Calculate the "maximum" frequency we can measure
-    double f_max = 0.5 / dt;
+    // Samples are resampled onto a uniform grid (the average sample period), as irregular
+    // sample spacing (e.g. jitter or gaps) would otherwise distort the spectrum
+    UniformGrid grid;
 
-    uint64_t N = 2;
+    grid.t0 = t_min;
+    grid.dt = qAbs<double>(t_max - t_min) / n_samples;
+    grid.n = n_samples;
 
-    // Calculate a "power of 2" sample size
-    while (N < n_samples && N < MAX_FFT_SAMPLES)
+    // Optionally, very long windows are low-pass filtered and decimated (limiting the maximum frequency)
+    if (decimation_enabled && n_samples > MAX_FFT_LENGTH)
     {
-        N <<= 1;
+        grid.decimation = (n_samples + MAX_FFT_LENGTH - 1) / MAX_FFT_LENGTH;
+        grid.filter = FFTEngine::getLowPassFilter(grid.decimation);
+        grid.n = n_samples / grid.decimation;
     }
 
-    RealArray1D data_in(N);
-    ComplexArray1D data_out(N);
+    // Long windows are averaged over overlapping segments (Welch's method), which limits the
+    // frequency resolution but reduces the variance of the spectrum
+    const bool welch = welch_enabled && grid.n >= WELCH_MIN_SAMPLES;
 
-    // Copy across the data
-    for (uint64_t ii = 0; ii < N; ii++)
+    uint64_t N = 0;
+    std::vector<double> magnitude;
+
+    if (welch)
     {
-        uint64_t wrapped_idx = ii % n_samples;
+        N = WELCH_SEGMENT_SIZE;
 
-        // If we have to pad out the data, wrap it around on itself
-        data_in[ii] = series.getDataPoint(idx_min + wrapped_idx).value;
+        if (!computeWelchSpectrum(snapshot, t_min, t_max, grid, w, magnitude)) return;
     }
+    else
+    {
+        // The data is not padded: any size can be transformed, although the final few samples
+        // may be omitted to select a size with small factors (which is much faster to transform)
+        N = FFTEngine::getEfficientSize(grid.n);
 
-    const char* error;
+        std::vector<double> data_in(N);
 
-    bool result = simple_fft::FFT<RealArray1D, ComplexArray1D>(data_in, data_out, N, error);
+        DataCursor cursor(snapshot);
 
+        readUniform(cursor, grid, 0, N, data_in.data());
 
-    if (!result)
-    {
-        qWarning() << "Error calculating FFT data:" << QString(error);
-        emit sampleComplete(x_data, y_data);
-        return;
+        FFTEngine::applyWindow(data_in.data(), N, w);
+
+        if (isSuperseded()) return;
+
+        const auto plan = FFTEngine::getRealPlan(N);
+
+        std::vector<FFTComplex> data_out(plan->getBinCount());
+
+        plan->transform(data_in.data(), data_out.data());
+
+        magnitude.resize(data_out.size());
+
+        for (uint64_t ii = 0; ii < data_out.size(); ii++)
+        {
+            magnitude[ii] = std::abs(data_out[ii]);
+        }
     }
 
-    double y_max = 0;
+    if (isSuperseded()) return;
 
-    RealArray1D real_out(N);
+    const uint64_t n_bins = magnitude.size();
 
-    x_data.reserve(N);
-    y_data.reserve(N);
+    // Prevent the DC value (and its leakage through the window main lobe) from swamping the overall data
+    double y_max = 0;
 
-    // Calculate max values to normalize
-    for (uint64_t ii = 0; ii < N; ii++)
+    for (uint64_t ii = FFTEngine::getMainLobeWidth(w); ii < n_bins; ii++)
     {
-        double real = data_out[ii].real();
-        double imag = data_out[ii].imag();
+        y_max = qMax<double>(y_max, magnitude[ii]);
+    }
 
-        double out = qSqrt(real*real + imag*imag);
+    if (y_max <= 0) y_max = 1;
 
-        real_out[ii] = out;
+    // Large spectra are reduced to the peak bin of each group
+    const uint64_t group = (n_bins + MAX_FFT_BINS - 1) / MAX_FFT_BINS;
 
-        // Prevent the DC value from swamping the overall data
-        if (ii > 0)
+    spectrum->timestamps.reserve(n_bins / group + 1);
+    spectrum->values.reserve(n_bins / group + 1);
+
+    for (uint64_t jj = 0; jj < n_bins; jj += group)
+    {
+        uint64_t peak = jj;
+
+        for (uint64_t kk = jj + 1; kk < std::min(jj + group, n_bins); kk++)
         {
-            y_max = qMax<double>(y_max, out);
+            if (magnitude[kk] > magnitude[peak]) peak = kk;
         }
+
+        spectrum->timestamps.push_back(peak / grid.getPeriod() / N);
+        spectrum->values.push_back(magnitude[peak] / y_max);
     }
 
-    for (uint64_t jj = 0; jj < N/2; jj++)
-    {
-        double f = jj / dt / N;
+    spectrum->updateRange();
 
-        // Ignore frequencies above the nyquist frequency
-        if (f > f_max) break;
+    cacheSpectrum(key, spectrum);
 
-        x_data.append(f);
-        y_data.append(real_out[jj] / y_max);
-    }
+    // A newer request is waiting
+    if (isSuperseded()) return;
 
-    emit sampleComplete(x_data, y_data);
+    emit sampleComplete(spectrum, 1.0, 0.0);
 
 }
@@ -1,6 +1,14 @@
 #ifndef FFT_SAMPLER_H
 #define FFT_SAMPLER_H
 
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+
+#include <QMutex>
+
+#include "fft_engine.hpp"
 #include "plot_sampler.hpp"
 
 class FFTCurveUpdater : public PlotCurveUpdater
@@ -9,9 +17,150 @@ class FFTCurveUpdater : public PlotCurveUpdater
 
 public:
     FFTCurveUpdater(DataSeries &data_series);
+    virtual ~FFTCurveUpdater();
+
+    //! Spectra with more bins than this are reduced (retaining the peak of each group of bins)
+    static const uint64_t MAX_FFT_BINS = 0x10000;
+
+    //! Minimum number of samples required to compute a spectrum
+    static const uint64_t MIN_FFT_SAMPLES = 0x80;
+
+    //! Segment length of the Welch spectrum
+    static const uint64_t WELCH_SEGMENT_SIZE = 0x10000;
+
+    //! Windows with at least this many samples are averaged over segments (see computeWelchSpectrum)
+    static const uint64_t WELCH_MIN_SAMPLES = 4 * WELCH_SEGMENT_SIZE;
+
+    //! Maximum number of chunks of segments which are transformed in parallel
+    static const uint64_t WELCH_CHUNKS = 64;
+
+    //! Welch segment spectra retained for panning, per curve (views with more segments are recomputed in full)
+    static const size_t MAX_CACHED_SEGMENTS = 128;
+
+    //! Windows with more samples than this are decimated, if enabled (see setDecimationEnabled)
+    static const uint64_t MAX_FFT_LENGTH = 1 << 22;
+
+    //! Memory used by cached spectra, shared by every curve (bytes)
+    static const size_t SPECTRUM_CACHE_MEMORY = 64 << 20;
+
+    static void clearSpectrumCache(void);
+
+    int getWindow(void) const { return window.load(); }
+    void setWindow(int w);
+
+    bool isWelchEnabled(void) const { return welchEnabled.load(); }
+    void setWelchEnabled(bool enable) { welchEnabled.store(enable); }
+
+    bool isDecimationEnabled(void) const { return decimationEnabled.load(); }
+    void setDecimationEnabled(bool enable) { decimationEnabled.store(enable); }
+
+    //! Interpolation used to resample onto a uniform grid (see DataCursor::ResampleMode)
+    int getResampleMode(void) const { return resampleMode.load(); }
+    void setResampleMode(int mode) { resampleMode.store(mode); }
+
+    //! Total number of Welch segments transformed (cached segments are not counted)
+    uint64_t getComputedSegmentCount(void) const { return computedSegments.load(); }
 
 public slots:
     virtual void updateCurveSamples(double t_min, double t_max, unsigned int n_pixels) override;
+
+protected:
+    //! Spectra are not resampled from pixel columns
+    virtual bool isPrefetchSupported(void) const override { return false; }
+
+    //! Uniformly spaced points, t0 + ii * dt * decimation (ii < n)
+    struct UniformGrid
+    {
+        double t0 = 0;
+
+        //! Spacing of the full rate grid
+        double dt = 0;
+
+        uint64_t n = 0;
+
+        uint64_t decimation = 1;
+
+        //! Anti-alias filter applied to the full rate grid (if decimated)
+        std::vector<double> filter;
+
+        double getPeriod(void) const { return dt * decimation; }
+    };
+
+    void readUniform(DataCursor& cursor, const UniformGrid& grid, uint64_t first, uint64_t n, double* output) const;
+
+    bool computeWelchSpectrum(const DataSnapshot& snapshot, double t_min, double t_max, UniformGrid& grid, int w, std::vector<double>& magnitude);
+
+    void updateSegmentCache(const DataSnapshot& snapshot, const UniformGrid& grid, int w);
+    void trimSegmentCache(int64_t center);
+
+    /*
+     * Identifies a computed spectrum: the samples it was computed from, and the options used.
+     * The table is held weakly, so that the cache does not retain discarded samples
+     * (and an expired table can not be mistaken for a newer table at the same address).
+     */
+    struct SpectrumKey
+    {
+        const DataSeries* series = nullptr;
+        std::weak_ptr<const DataBlockTable> table;
+        uint64_t count = 0;
+        double scaler = 1.0;
+        double offset = 0.0;
+
+        uint64_t idx_min = 0;
+        uint64_t idx_max = 0;
+
+        int window = 0;
+        bool welch = false;
+        bool decimation = false;
+        int resample = 0;
+
+        bool matches(const SpectrumKey& other) const;
+    };
+
+    struct CachedSpectrum
+    {
+        SpectrumKey key;
+        PlotSamplesPointer samples;
+
+        size_t getMemory(void) const { return samples ? 2 * samples->size() * sizeof(double) : 0; }
+    };
+
+    static PlotSamplesPointer findSpectrum(const SpectrumKey& key);
+    static void cacheSpectrum(const SpectrumKey& key, PlotSamplesPointer samples);
+
+    static QMutex spectrumMutex;
+
+    //! Most recently used spectra first
+    static std::list<CachedSpectrum> spectrumCache;
+    static size_t spectrumCacheMemory;
+
+    //! Window function applied to the samples (see FFTEngine::Window)
+    std::atomic<int> window{FFTEngine::WINDOW_HANN};
+
+    //! Average long windows over segments, rather than transforming every sample at once
+    std::atomic<bool> welchEnabled{true};
+
+    std::atomic<bool> decimationEnabled{false};
+    std::atomic<int> resampleMode{DataCursor::RESAMPLE_LINEAR};
+
+    //! Estimated sample period (from the entire series), which determines the Welch segment grid
+    double welch_dt = 0;
+
+    //! Samples and options from which the cached segments were computed
+    DataSnapshot segment_snapshot;
+    double segment_period = 0;
+    int segment_window = -1;
+    int segment_resample = -1;
+
+    //! Power spectra of Welch segments (by grid index, segment k starts at k * hop)
+    std::map<int64_t, std::vector<float>> segmentCache;
+
+    std::atomic<uint64_t> computedSegments{0};
+
+    int window_latest = -1;
+    bool welch_latest = true;
+    bool decimation_latest = false;
+    int resample_latest = DataCursor::RESAMPLE_LINEAR;
 };
 
 
@@ -7,6 +7,7 @@
 #include <qwt_text_label.h>
 #include <qwt_plot_curve.h>
 
+#include "lumberjack_settings.hpp"
 #include "plot_curve.hpp"
 #include "fft_sampler.hpp"
 #include "fft_widget.hpp"
@@ -46,7 +47,16 @@ void FFTWidget::initAxes()
  */
 PlotCurveUpdater* FFTWidget::generateNewWorker(DataSeriesPointer series)
 {
-    return new FFTCurveUpdater(*series);
+    auto *updater = new FFTCurveUpdater(*series);
+
+    auto *settings = LumberjackSettings::getInstance();
+
+    updater->setWindow(settings->loadSetting("fft", "window", FFTEngine::WINDOW_HANN).toInt());
+    updater->setWelchEnabled(settings->loadBoolean("fft", "welch", true));
+    updater->setDecimationEnabled(settings->loadBoolean("fft", "decimate", false));
+    updater->setResampleMode(settings->loadSetting("fft", "resampleMode", DataCursor::RESAMPLE_LINEAR).toInt());
+
+    return updater;
 }
 
 
@@ -0,0 +1,328 @@
+#include "parallel_for.hpp"
+
+#include "filter_chain.hpp"
+
+
+FilterChain::FilterChain(QThreadPool *pool) : m_pool(pool)
+{
+}
+
+
+void FilterChain::appendFilter(QSharedPointer<FilterPlugin> filter)
+{
+    insertFilter(size(), filter);
+}
+
+
+void FilterChain::insertFilter(int index, QSharedPointer<FilterPlugin> filter)
+{
+    if (filter.isNull()) return;
+
+    m_mutex.lock();
+
+    m_filters.insert(std::max(0, std::min(index, (int) m_filters.size())), filter);
+
+    m_mutex.unlock();
+
+    invalidate();
+}
+
+
+void FilterChain::removeFilter(int index)
+{
+    m_mutex.lock();
+
+    if (index >= 0 && index < m_filters.size())
+    {
+        m_filters.removeAt(index);
+    }
+
+    m_mutex.unlock();
+
+    invalidate();
+}
+
+
+void FilterChain::clear()
+{
+    m_mutex.lock();
+
+    m_filters.clear();
+
+    m_mutex.unlock();
+
+    invalidate();
+}
+
+
+FilterPluginList FilterChain::getFilters() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_filters;
+}
+
+
+int FilterChain::size() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_filters.size();
+}
+
+
+void FilterChain::invalidate()
+{
+    QMutexLocker lock(&m_mutex);
+
+    m_compiled = false;
+
+    m_cache.clear();
+
+    m_source = DataSnapshot();
+    m_result = DataSnapshot();
+}
+
+
+/**
+ * @brief FilterChain::compile - Compile the filters into stages, fusing adjacent affine filters (mutex must be held)
+ */
+void FilterChain::compile()
+{
+    m_stages.clear();
+    m_stateless = true;
+
+    m_scaler = 1.0;
+    m_offset = 0.0;
+
+    for (const auto &filter : m_filters)
+    {
+        double scaler = 1.0;
+        double offset = 0.0;
+
+        if (filter->getAffine(scaler, offset))
+        {
+            if (m_stages.empty())
+            {
+                // Applied as the scaling of the snapshot
+                m_scaler *= scaler;
+                m_offset = m_offset * scaler + offset;
+            }
+            else if (m_stages.back().filter.isNull())
+            {
+                Stage &stage = m_stages.back();
+
+                stage.scaler *= scaler;
+                stage.offset = stage.offset * scaler + offset;
+            }
+            else
+            {
+                Stage stage;
+
+                stage.scaler = scaler;
+                stage.offset = offset;
+
+                m_stages.push_back(stage);
+            }
+        }
+        else
+        {
+            Stage stage;
+
+            stage.filter = filter;
+
+            m_stages.push_back(stage);
+
+            m_stateless &= filter->isStateless();
+        }
+    }
+
+    m_compiled = true;
+}
+
+
+/**
+ * @brief FilterChain::filterSnapshot - Return a snapshot of the filtered samples.
+ * Filtered blocks which are cached (for the same raw block, length and scaling) are reused.
+ * @param samples - Snapshot of the raw samples of the series
+ */
+DataSnapshot FilterChain::filterSnapshot(const DataSnapshot &samples)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_compiled) compile();
+
+    // Scaling of the series, followed by any leading affine filters
+    const double scaler = samples.getScaler() * m_scaler;
+    const double offset = samples.getOffset() * m_scaler + m_offset;
+
+    if (m_stages.empty() || samples.isEmpty())
+    {
+        return DataSnapshot(samples.getTable(), scaler, offset);
+    }
+
+    if (scaler == m_cacheScaler && offset == m_cacheOffset && samples.isIdentical(m_source))
+    {
+        return m_result;
+    }
+
+    // Each block of a stateful chain depends on every earlier block
+    if (scaler != m_cacheScaler || offset != m_cacheOffset || !m_stateless)
+    {
+        m_cache.clear();
+    }
+
+    m_cacheScaler = scaler;
+    m_cacheOffset = offset;
+
+    const DataBlockTable &table = *samples.getTable();
+    const size_t blockCount = table.blocks.size();
+
+    std::map<const DataBlock*, CachedBlock> cache;
+
+    // Blocks which must be filtered (the entries of the map are not moved as it grows)
+    std::vector<std::pair<size_t, CachedBlock*>> pending;
+
+    for (size_t ii = 0; ii < blockCount; ii++)
+    {
+        const DataBlockPointer &block = table.blocks[ii];
+        const size_t length = table.getBlockLength(ii, samples.size());
+
+        auto it = m_cache.find(block.get());
+
+        if (it != m_cache.end() && it->second.length == length)
+        {
+            cache[block.get()] = it->second;
+        }
+        else
+        {
+            CachedBlock &cached = cache[block.get()];
+
+            cached.raw = block;
+            cached.length = length;
+
+            pending.push_back(std::make_pair(ii, &cached));
+        }
+    }
+
+    const DataView view = samples.getView();
+
+    for (const auto &stage : m_stages)
+    {
+        if (!stage.filter.isNull() && !stage.filter->beginFilter(view))
+        {
+            qWarning() << "FilterChain - samples could not be filtered by" << stage.filter->pluginName();
+        }
+    }
+
+    auto filterOne = [&](size_t idx) {
+        const size_t ii = pending[idx].first;
+        CachedBlock &cached = *pending[idx].second;
+
+        cached.filtered = filterBlock(*cached.raw, cached.length, table.offsets[ii], samples.size(), scaler, offset);
+    };
+
+    if (m_stateless)
+    {
+        parallelFor(pending.size(), filterOne, m_pool);
+    }
+    else
+    {
+        for (size_t idx = 0; idx < pending.size(); idx++)
+        {
+            filterOne(idx);
+        }
+    }
+
+    for (const auto &stage : m_stages)
+    {
+        if (!stage.filter.isNull()) stage.filter->endFilter();
+    }
+
+    m_blocksFiltered += pending.size();
+
+    auto filtered = std::make_shared<DataBlockTable>();
+
+    for (size_t ii = 0; ii < blockCount; ii++)
+    {
+        filtered->blocks.push_back(cache[table.blocks[ii].get()].filtered);
+    }
+
+    filtered->updateOffsets();
+
+    // Only the blocks of the current snapshot are retained
+    m_cache.swap(cache);
+
+    m_source = samples;
+    m_result = DataSnapshot(filtered, 1.0, 0.0);
+
+    return m_result;
+}
+
+
+/**
+ * @brief FilterChain::filterBlock - Pass the samples of a raw block through every stage of the chain
+ * @param block - The raw block
+ * @param length - Number of samples (from the start of the block) to filter
+ * @param index - Index (within the series) of the first sample of the block
+ * @param count - Number of samples in the series
+ * @param scaler - Scaling applied to the raw values before they are filtered
+ * @param offset - Offset applied to the raw values before they are filtered
+ * @return a new block of the filtered samples, encoded in the same way as the raw block
+ */
+DataBlockPointer FilterChain::filterBlock(const DataBlock &block, size_t length, uint64_t index, uint64_t count, double scaler, double offset) const
+{
+    const DataBlock::Columns columns = block.getColumns();
+
+    std::vector<double> values(length);
+
+    for (size_t ii = 0; ii < length; ii++)
+    {
+        values[ii] = columns.getValue(ii) * scaler + offset;
+    }
+
+    FilterChunk chunk;
+
+    chunk.index = index;
+    chunk.length = length;
+    chunk.count = count;
+    chunk.timestamps = columns.timestamps;
+    chunk.input = values.data();
+    chunk.output = values.data();
+
+    for (const auto &stage : m_stages)
+    {
+        if (!stage.filter.isNull())
+        {
+            stage.filter->filterChunk(chunk);
+        }
+        else
+        {
+            const double a = stage.scaler;
+            const double b = stage.offset;
+
+            for (size_t ii = 0; ii < length; ii++)
+            {
+                values[ii] = values[ii] * a + b;
+            }
+        }
+    }
+
+    auto filtered = std::make_shared<DataBlock>(std::max<size_t>(length, 1), block.isSinglePrecision(), block.getStore());
+
+    filtered->append(columns.timestamps, values.data(), length);
+
+    if (filtered->isFull())
+    {
+        if (block.isCompressed())
+        {
+            filtered = std::make_shared<DataBlock>(*filtered, DataBlock::ENCODING_COMPRESSED);
+        }
+        else if (block.hasUniformTimestamps() && filtered->isEvenlySpaced())
+        {
+            filtered = std::make_shared<DataBlock>(*filtered, DataBlock::ENCODING_UNIFORM);
+        }
+    }
+
+    return filtered;
+}
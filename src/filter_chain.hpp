@@ -0,0 +1,111 @@
+#ifndef FILTER_CHAIN_HPP
+#define FILTER_CHAIN_HPP
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QThreadPool>
+
+#include "data_series.hpp"
+#include "plugin_filter.hpp"
+
+
+/**
+ * @brief The FilterChain class applies a sequence of filters to a series, as the series is read
+ * (see DataSeries::setFilter). No copy of the samples is made for each filter.
+ *
+ * The filters are compiled into a list of stages. Adjacent affine filters (e.g. an offset and a scaler)
+ * are fused into a single multiply-add, and any affine filters at the start of the chain are folded into
+ * the scaling of the snapshot, so a chain of only affine filters costs nothing at all.
+ *
+ * Otherwise, each block of the series is passed through every stage in turn (in place, in a single buffer),
+ * and the filtered blocks are cached, keyed by the raw block they were calculated from. As a series is
+ * appended to, only the final block (and any new blocks) are filtered again. Blocks are filtered concurrently
+ * if every filter is stateless, whereas a chain containing a stateful filter is re-run, in order, whenever
+ * the series changes (as each filtered block then depends on every earlier block).
+ */
+class FilterChain : public DataSeriesFilter
+{
+public:
+    explicit FilterChain(QThreadPool *pool = QThreadPool::globalInstance());
+
+    void appendFilter(QSharedPointer<FilterPlugin> filter);
+    void insertFilter(int index, QSharedPointer<FilterPlugin> filter);
+    void removeFilter(int index);
+    void clear(void);
+
+    FilterPluginList getFilters(void) const;
+    int size(void) const;
+    bool isEmpty(void) const { return size() == 0; }
+
+    // Discard the filtered samples (must be called whenever a filter in the chain is modified)
+    void invalidate(void);
+
+    virtual DataSnapshot filterSnapshot(const DataSnapshot &samples) override;
+
+    //! Number of blocks which have been filtered (cached blocks are not filtered again)
+    uint64_t getBlocksFiltered(void) const { return m_blocksFiltered.load(); }
+
+protected:
+    /**
+     * @brief The Stage struct is a step of the compiled chain: a filter, or a (fused) multiply-add
+     */
+    struct Stage
+    {
+        //! Filter which is applied (nullptr for a multiply-add)
+        QSharedPointer<FilterPlugin> filter;
+
+        double scaler = 1.0;
+        double offset = 0.0;
+    };
+
+    /**
+     * @brief The CachedBlock struct is a filtered block, and the raw block it was calculated from
+     */
+    struct CachedBlock
+    {
+        //! Held so that the address of the raw block (the cache key) cannot be reused
+        DataBlockPointer raw;
+
+        //! Number of raw samples which were filtered (the final block of a series may still be growing)
+        size_t length = 0;
+
+        DataBlockPointer filtered;
+    };
+
+    void compile(void);
+
+    DataBlockPointer filterBlock(const DataBlock &block, size_t length, uint64_t index, uint64_t count, double scaler, double offset) const;
+
+    QThreadPool *m_pool;
+
+    //! Held while the chain is modified, or the samples are filtered
+    mutable QMutex m_mutex;
+
+    FilterPluginList m_filters;
+
+    //! Compiled stages (see compile), which are rebuilt when the chain is modified
+    bool m_compiled = false;
+    std::vector<Stage> m_stages;
+    bool m_stateless = true;
+
+    //! Affine filters at the start of the chain, which are applied as the scaling of the snapshot
+    double m_scaler = 1.0;
+    double m_offset = 0.0;
+
+    //! Filtered blocks, and the raw scaling they were calculated with
+    std::map<const DataBlock*, CachedBlock> m_cache;
+    double m_cacheScaler = 1.0;
+    double m_cacheOffset = 0.0;
+
+    //! The most recently filtered snapshot, and the result
+    DataSnapshot m_source;
+    DataSnapshot m_result;
+
+    std::atomic<uint64_t> m_blocksFiltered{0};
+};
+
+
+#endif // FILTER_CHAIN_HPP
@@ -0,0 +1,734 @@
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMetaObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QSurfaceFormat>
+
+#include "trace_recorder.hpp"
+
+#include "gpu_compute.hpp"
+
+
+const uint64_t GpuCompute::MIN_SAMPLES;
+const size_t GpuCompute::PAGE_BLOCKS;
+const size_t GpuCompute::RESIDENT_MEMORY_LIMIT;
+const unsigned int GpuCompute::WORKGROUP_SIZE;
+
+
+//! Number of resident buffers which fit within the memory limit
+static const size_t MAX_PAGES = GpuCompute::RESIDENT_MEMORY_LIMIT / (GpuCompute::PAGE_BLOCKS * DataBlock::CAPACITY * sizeof(float));
+
+//! Maximum number of work groups in a single dispatch (the minimum which every implementation supports)
+static const size_t MAX_DISPATCH = 65535;
+
+
+/*
+ * Each work group finds the extreme values of a single segment [first, last) of a resident buffer.
+ * Invocations stride through the segment, then the results are combined by a reduction in shared memory.
+ * Ties select the earliest sample (as DataBlock::Summary does).
+ */
+static const char* REDUCE_SHADER =
+        "layout(local_size_x = WORKGROUP_SIZE) in;\n"
+        "layout(std430, binding = 0) readonly buffer Values { float values[]; };\n"
+        "layout(std430, binding = 1) readonly buffer Segments { uvec2 segments[]; };\n"
+        "layout(std430, binding = 2) writeonly buffer Extremes { uvec2 extremes[]; };\n"
+        "shared float minValue[WORKGROUP_SIZE];\n"
+        "shared float maxValue[WORKGROUP_SIZE];\n"
+        "shared uint minIndex[WORKGROUP_SIZE];\n"
+        "shared uint maxIndex[WORKGROUP_SIZE];\n"
+        "void main()\n"
+        "{\n"
+        "    uint lane = gl_LocalInvocationID.x;\n"
+        "    uvec2 segment = segments[gl_WorkGroupID.x];\n"
+        "    float lo = uintBitsToFloat(0x7F800000u);\n"
+        "    float hi = -lo;\n"
+        "    uint idxLo = segment.x;\n"
+        "    uint idxHi = segment.x;\n"
+        "    for (uint idx = segment.x + lane; idx < segment.y; idx += uint(WORKGROUP_SIZE))\n"
+        "    {\n"
+        "        float v = values[idx];\n"
+        "        if (v < lo) { lo = v; idxLo = idx; }\n"
+        "        if (v > hi) { hi = v; idxHi = idx; }\n"
+        "    }\n"
+        "    minValue[lane] = lo;\n"
+        "    maxValue[lane] = hi;\n"
+        "    minIndex[lane] = idxLo;\n"
+        "    maxIndex[lane] = idxHi;\n"
+        "    barrier();\n"
+        "    for (uint stride = uint(WORKGROUP_SIZE) / 2u; stride > 0u; stride /= 2u)\n"
+        "    {\n"
+        "        if (lane < stride)\n"
+        "        {\n"
+        "            uint other = lane + stride;\n"
+        "            if (minValue[other] < minValue[lane] || (minValue[other] == minValue[lane] && minIndex[other] < minIndex[lane]))\n"
+        "            {\n"
+        "                minValue[lane] = minValue[other];\n"
+        "                minIndex[lane] = minIndex[other];\n"
+        "            }\n"
+        "            if (maxValue[other] > maxValue[lane] || (maxValue[other] == maxValue[lane] && maxIndex[other] < maxIndex[lane]))\n"
+        "            {\n"
+        "                maxValue[lane] = maxValue[other];\n"
+        "                maxIndex[lane] = maxIndex[other];\n"
+        "            }\n"
+        "        }\n"
+        "        barrier();\n"
+        "    }\n"
+        "    if (lane == 0u)\n"
+        "    {\n"
+        "        extremes[gl_WorkGroupID.x] = uvec2(minIndex[0], maxIndex[0]);\n"
+        "    }\n"
+        "}\n";
+
+
+GpuCompute* GpuCompute::getInstance()
+{
+    static GpuCompute compute;
+
+    return &compute;
+}
+
+
+GpuCompute::GpuCompute()
+{
+}
+
+
+GpuCompute::~GpuCompute()
+{
+    shutdown();
+}
+
+
+/**
+ * @brief GpuCompute::initialise - Create the compute context (must be called on the GUI thread).
+ * Has no effect if the backend has already been initialised.
+ * @return true if the backend is available
+ */
+bool GpuCompute::initialise()
+{
+    if (initialised) return available.load();
+
+    initialised = true;
+
+    QSurfaceFormat format;
+
+    if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES)
+    {
+        format.setRenderableType(QSurfaceFormat::OpenGLES);
+        format.setVersion(3, 1);
+    }
+    else
+    {
+        format.setVersion(4, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+    }
+
+    surface = new QOffscreenSurface();
+    surface->setFormat(format);
+    surface->create();
+
+    context = new QOpenGLContext();
+    context->setFormat(format);
+
+    if (!surface->isValid() || !context->create() || context->format().version() < format.version())
+    {
+        qWarning() << "GPU compute is not available: could not create an OpenGL" << format.majorVersion() << "." << format.minorVersion() << "context";
+
+        delete context;
+        context = nullptr;
+
+        delete surface;
+        surface = nullptr;
+
+        return false;
+    }
+
+    // The context is only ever made current on the compute thread
+    worker = new QObject();
+    worker->moveToThread(&thread);
+    context->moveToThread(&thread);
+
+    thread.setObjectName("GpuCompute");
+    thread.start();
+
+    bool ok = false;
+
+    QMetaObject::invokeMethod(worker, [this, &ok]() { ok = setup(); }, Qt::BlockingQueuedConnection);
+
+    if (!ok)
+    {
+        shutdown();
+
+        return false;
+    }
+
+    if (QCoreApplication::instance())
+    {
+        // GL resources must be released while the surface still exists
+        QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [this]() { shutdown(); });
+    }
+
+    available.store(true);
+
+    qInfo() << "GPU compute is available:" << renderer;
+
+    return true;
+}
+
+
+/*
+ * Release every GL resource, and stop the compute thread (the backend is then unavailable)
+ */
+void GpuCompute::shutdown()
+{
+    QMutexLocker lock(&mutex);
+
+    if (!available.exchange(false) && !thread.isRunning()) return;
+
+    QMetaObject::invokeMethod(worker, [this]() { release(); }, Qt::BlockingQueuedConnection);
+
+    thread.quit();
+    thread.wait();
+
+    delete worker;
+    worker = nullptr;
+
+    delete surface;
+    surface = nullptr;
+}
+
+
+/**
+ * @brief GpuCompute::setEnabled - Select (or deselect) the backend (must be called on the GUI thread).
+ * The backend is initialised when it is first selected.
+ */
+void GpuCompute::setEnabled(bool enable)
+{
+    enabled.store(enable);
+
+    if (enable)
+    {
+        initialise();
+    }
+    else
+    {
+        // Resident columns are no longer required
+        releaseResident();
+    }
+}
+
+
+QString GpuCompute::getRenderer() const
+{
+    QMutexLocker lock(&mutex);
+
+    return renderer;
+}
+
+
+size_t GpuCompute::getResidentBlocks() const
+{
+    QMutexLocker lock(&mutex);
+
+    return resident.size();
+}
+
+
+size_t GpuCompute::getResidentBytes() const
+{
+    QMutexLocker lock(&mutex);
+
+    return pages.size() * PAGE_BLOCKS * DataBlock::CAPACITY * sizeof(float);
+}
+
+
+/*
+ * Discard every resident value column (they are uploaded again when next required)
+ */
+void GpuCompute::releaseResident()
+{
+    QMutexLocker lock(&mutex);
+
+    if (!available.load()) return;
+
+    QMetaObject::invokeMethod(worker, [this]() {
+        if (!context->makeCurrent(surface)) return;
+
+        QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+        if (!pages.empty()) gl->glDeleteBuffers((int) pages.size(), pages.data());
+
+        pages.clear();
+        freeSlots.clear();
+        resident.clear();
+        residentIndex.clear();
+    }, Qt::BlockingQueuedConnection);
+}
+
+
+/*
+ * Build the reduction kernel, and the buffers for each dispatch (on the compute thread)
+ */
+bool GpuCompute::setup()
+{
+    if (!context->makeCurrent(surface)) return false;
+
+    if (!QOpenGLShader::hasOpenGLShaders(QOpenGLShader::Compute, context)) return false;
+
+    QByteArray source = context->isOpenGLES() ? "#version 310 es\nprecision highp float;\n" : "#version 430\n";
+
+    source += "#define WORKGROUP_SIZE " + QByteArray::number(WORKGROUP_SIZE) + "\n";
+    source += REDUCE_SHADER;
+
+    program = new QOpenGLShaderProgram();
+
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, source) || !program->link())
+    {
+        qWarning() << "Could not build GPU compute shader:" << program->log();
+
+        delete program;
+        program = nullptr;
+
+        return false;
+    }
+
+    QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+    gl->glGenBuffers(1, &segmentBuffer);
+    gl->glGenBuffers(1, &extremesBuffer);
+
+    renderer = QString::fromLatin1((const char*) gl->glGetString(GL_RENDERER));
+
+    return true;
+}
+
+
+/*
+ * Release every GL resource (on the compute thread)
+ */
+void GpuCompute::release()
+{
+    if (context && context->makeCurrent(surface))
+    {
+        QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+        if (!pages.empty()) gl->glDeleteBuffers((int) pages.size(), pages.data());
+        if (segmentBuffer) gl->glDeleteBuffers(1, &segmentBuffer);
+        if (extremesBuffer) gl->glDeleteBuffers(1, &extremesBuffer);
+
+        delete program;
+
+        context->doneCurrent();
+    }
+
+    program = nullptr;
+    segmentBuffer = 0;
+    extremesBuffer = 0;
+
+    pages.clear();
+    freeSlots.clear();
+    resident.clear();
+    residentIndex.clear();
+
+    delete context;
+    context = nullptr;
+}
+
+
+/**
+ * @brief GpuCompute::planSegments - Split pixel columns at block boundaries.
+ * Segments are ordered by column (and so also by block), i.e. in timestamp order.
+ * @param snapshot is the resampled series
+ * @param bounds are the sample indices at which each column starts, followed by the end of the final column
+ * @param segments is the output (empty columns have no segments)
+ */
+void GpuCompute::planSegments(const DataSnapshot& snapshot, const std::vector<uint64_t>& bounds, std::vector<Segment>& segments)
+{
+    segments.clear();
+
+    if (snapshot.isEmpty() || bounds.size() < 2) return;
+
+    const DataBlockTable& table = *snapshot.getTable();
+    const uint64_t count = snapshot.size();
+
+    for (size_t column = 0; column + 1 < bounds.size(); column++)
+    {
+        const uint64_t end = std::min(bounds[column + 1], count);
+
+        for (uint64_t idx = bounds[column]; idx < end; )
+        {
+            const size_t block = table.getBlockForIndex(idx);
+            const uint64_t base = table.offsets[block];
+            const uint64_t last = std::min<uint64_t>(base + table.getBlockLength(block, count), end);
+
+            if (last <= idx) break;
+
+            Segment segment;
+
+            segment.column = column;
+            segment.block = block;
+            segment.first = (uint32_t) (idx - base);
+            segment.last = (uint32_t) (last - base);
+
+            segments.push_back(segment);
+
+            idx = last;
+        }
+    }
+}
+
+
+/**
+ * @brief GpuCompute::getBucket - Summarise a segment, from the exact samples at its extreme indices.
+ * The sum of the bucket is not calculated.
+ * @param snapshot is the resampled series (the time scaling, scaler and offset of which are applied)
+ * @param columns are the sample columns of the block which contains the segment
+ * @param segment is the range of samples
+ * @param extremes are the indices of the minimum and maximum raw values
+ */
+DataSnapshot::Bucket GpuCompute::getBucket(const DataSnapshot& snapshot, const DataBlock::Columns& columns, const Segment& segment, const Extremes& extremes)
+{
+    const double scaler = snapshot.getScaler();
+    const double offset = snapshot.getOffset();
+
+    auto point = [&](size_t idx) {
+        return DataPoint(snapshot.applyTimeScaling(columns.getTimestamp(idx)), columns.getValue(idx) * scaler + offset);
+    };
+
+    DataSnapshot::Bucket bucket;
+
+    bucket.first = point(segment.first);
+    bucket.last = point(segment.last - 1);
+    bucket.min = point(extremes.min);
+    bucket.max = point(extremes.max);
+    bucket.count = segment.last - segment.first;
+
+    // A negative scaler swaps the extreme values
+    if (scaler < 0)
+    {
+        std::swap(bucket.min, bucket.max);
+    }
+
+    return bucket;
+}
+
+
+/**
+ * @brief GpuCompute::visitColumns - Summarise a run of pixel columns on the GPU.
+ * Nothing is visited unless every column is summarised, so the caller may fall back to the CPU.
+ * @param snapshot is the resampled series
+ * @param bounds are the sample indices at which each column starts, followed by the end of the final column
+ * @param callback is called as callback(column, bucket) for each block within each column, in timestamp order
+ * @param cancelled optionally abandons the reduction (checked between dispatches)
+ * @return false if the columns were not summarised (the backend is not active, the samples do not fit
+ *         within the resident memory, or the reduction was cancelled)
+ */
+bool GpuCompute::visitColumns(const DataSnapshot& snapshot, const std::vector<uint64_t>& bounds,
+                              const std::function<void(size_t, const DataSnapshot::Bucket&)>& callback,
+                              const std::function<bool(void)>& cancelled)
+{
+    if (!isActive() || QThread::currentThread() == &thread) return false;
+
+    TRACE_SCOPE("GpuReduce", "plot");
+
+    std::vector<Segment> segments;
+
+    planSegments(snapshot, bounds, segments);
+
+    if (segments.empty()) return true;
+
+    std::vector<Extremes> extremes(segments.size());
+
+    bool ok = false;
+
+    {
+        // Passes are serialised, and the backend can not be shut down during a pass
+        QMutexLocker lock(&mutex);
+
+        if (!available.load()) return false;
+
+        QMetaObject::invokeMethod(worker, [&]() { ok = reduce(snapshot, segments, extremes, cancelled); }, Qt::BlockingQueuedConnection);
+    }
+
+    if (!ok) return false;
+
+    // The extreme samples are read from the series, so the columns hold exact values
+    const auto& blocks = snapshot.getTable()->blocks;
+
+    size_t block = blocks.size();
+    DataBlock::Columns columns;
+
+    for (size_t ii = 0; ii < segments.size(); ii++)
+    {
+        if (segments[ii].block != block)
+        {
+            block = segments[ii].block;
+            columns = blocks[block]->getColumns(false);
+        }
+
+        callback(segments[ii].column, getBucket(snapshot, columns, segments[ii], extremes[ii]));
+    }
+
+    return true;
+}
+
+
+/*
+ * Find the extremes of every segment (on the compute thread, with the mutex held by the caller).
+ * Blocks which are not resident are uploaded first.
+ */
+bool GpuCompute::reduce(const DataSnapshot& snapshot, const std::vector<Segment>& segments, std::vector<Extremes>& extremes,
+                        const std::function<bool(void)>& cancelled)
+{
+    if (!context || !program || !context->makeCurrent(surface)) return false;
+
+    const DataBlockTable& table = *snapshot.getTable();
+
+    // Every block visited by the pass must be resident at once
+    const size_t n_blocks = segments.back().block - segments.front().block + 1;
+
+    if (n_blocks > MAX_PAGES * PAGE_BLOCKS) return false;
+
+    // Resident location of each segment (segments are ordered by block)
+    std::vector<ResidentIterator> locations(segments.size());
+
+    for (size_t ii = 0; ii < segments.size(); ii++)
+    {
+        if (ii > 0 && segments[ii].block == segments[ii - 1].block)
+        {
+            locations[ii] = locations[ii - 1];
+            continue;
+        }
+
+        const size_t block = segments[ii].block;
+        const DataBlockPointer& pointer = table.blocks[block];
+
+        locations[ii] = makeResident(*pointer, pointer, table.getBlockLength(block, snapshot.size()));
+
+        if (locations[ii] == resident.end()) return false;
+    }
+
+    QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+    program->bind();
+
+    // Segments within the same resident buffer are reduced by a single dispatch
+    std::vector<std::vector<size_t>> byPage(pages.size());
+
+    for (size_t ii = 0; ii < segments.size(); ii++)
+    {
+        byPage[locations[ii]->page].push_back(ii);
+    }
+
+    std::vector<uint32_t> ranges;
+
+    for (size_t page = 0; page < byPage.size(); page++)
+    {
+        const std::vector<size_t>& indices = byPage[page];
+
+        for (size_t start = 0; start < indices.size(); start += MAX_DISPATCH)
+        {
+            if (cancelled && cancelled())
+            {
+                program->release();
+                return false;
+            }
+
+            const size_t n = std::min(indices.size() - start, MAX_DISPATCH);
+
+            // Segments are addressed within the resident buffer
+            ranges.resize(n * 2);
+
+            for (size_t jj = 0; jj < n; jj++)
+            {
+                const size_t ii = indices[start + jj];
+                const uint32_t base = (uint32_t) (locations[ii]->slot * DataBlock::CAPACITY);
+
+                ranges[jj * 2] = base + segments[ii].first;
+                ranges[jj * 2 + 1] = base + segments[ii].last;
+            }
+
+            gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, segmentBuffer);
+            gl->glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (ranges.size() * sizeof(uint32_t)), ranges.data(), GL_STREAM_DRAW);
+
+            gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, extremesBuffer);
+            gl->glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (ranges.size() * sizeof(uint32_t)), nullptr, GL_STREAM_READ);
+
+            gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pages[page]);
+            gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, segmentBuffer);
+            gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, extremesBuffer);
+
+            gl->glDispatchCompute((GLuint) n, 1, 1);
+            gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+            gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, extremesBuffer);
+
+            const uint32_t* result = (const uint32_t*) gl->glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) (ranges.size() * sizeof(uint32_t)), GL_MAP_READ_BIT);
+
+            if (!result)
+            {
+                program->release();
+                return false;
+            }
+
+            for (size_t jj = 0; jj < n; jj++)
+            {
+                const size_t ii = indices[start + jj];
+                const uint32_t base = (uint32_t) (locations[ii]->slot * DataBlock::CAPACITY);
+
+                extremes[ii].min = result[jj * 2] - base;
+                extremes[ii].max = result[jj * 2 + 1] - base;
+            }
+
+            gl->glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        }
+    }
+
+    gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    program->release();
+
+    return gl->glGetError() == GL_NO_ERROR;
+}
+
+
+/*
+ * Locate the resident value column of a block, uploading any samples which are not yet resident.
+ * Returns the end of the resident list if the block could not be uploaded.
+ */
+GpuCompute::ResidentIterator GpuCompute::makeResident(const DataBlock& block, const DataBlockPointer& pointer, size_t length)
+{
+    if (length > DataBlock::CAPACITY) return resident.end();
+
+    auto found = residentIndex.find(&block);
+
+    ResidentIterator it = resident.end();
+
+    if (found != residentIndex.end())
+    {
+        // A block which has been freed may have been replaced by another block at the same address
+        if (found->second->block.lock().get() == pointer.get())
+        {
+            it = found->second;
+            resident.splice(resident.begin(), resident, it);
+        }
+        else
+        {
+            evict(found->second);
+        }
+    }
+
+    if (it == resident.end())
+    {
+        Resident entry;
+
+        // The least recently used columns are evicted (the columns used by the current pass are more recent)
+        while (!allocateSlot(entry.page, entry.slot))
+        {
+            if (resident.empty()) return resident.end();
+
+            evict(std::prev(resident.end()));
+        }
+
+        entry.block = pointer;
+        entry.address = &block;
+        entry.reference = length > 0 ? block.getValue(0) : 0;
+
+        resident.push_front(entry);
+        residentIndex[&block] = resident.begin();
+
+        it = resident.begin();
+    }
+
+    // Samples appended to a block since it was uploaded (uploaded samples never change)
+    if (it->length < length)
+    {
+        const DataBlock::Columns columns = block.getColumns(false);
+
+        std::vector<float> values(length - it->length);
+
+        for (size_t idx = it->length; idx < length; idx++)
+        {
+            values[idx - it->length] = (float) (columns.getValue(idx) - it->reference);
+        }
+
+        QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+        const size_t offset = it->slot * DataBlock::CAPACITY + it->length;
+
+        gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, pages[it->page]);
+        gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr) (offset * sizeof(float)), (GLsizeiptr) (values.size() * sizeof(float)), values.data());
+
+        it->length = length;
+    }
+
+    return it;
+}
+
+
+/*
+ * Find an unused slot, creating a new resident buffer if the memory limit allows
+ */
+bool GpuCompute::allocateSlot(size_t& page, size_t& slot)
+{
+    for (size_t ii = 0; ii < freeSlots.size(); ii++)
+    {
+        if (!freeSlots[ii].empty())
+        {
+            page = ii;
+            slot = freeSlots[ii].back();
+            freeSlots[ii].pop_back();
+
+            return true;
+        }
+    }
+
+    if (pages.size() >= MAX_PAGES) return false;
+
+    QOpenGLExtraFunctions* gl = context->extraFunctions();
+
+    unsigned int buffer = 0;
+
+    gl->glGenBuffers(1, &buffer);
+    gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    gl->glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (PAGE_BLOCKS * DataBlock::CAPACITY * sizeof(float)), nullptr, GL_DYNAMIC_DRAW);
+
+    // The device may not have as much memory as the limit
+    if (gl->glGetError() != GL_NO_ERROR)
+    {
+        gl->glDeleteBuffers(1, &buffer);
+        return false;
+    }
+
+    pages.push_back(buffer);
+    freeSlots.push_back(std::vector<size_t>());
+
+    page = pages.size() - 1;
+
+    for (size_t ii = PAGE_BLOCKS; ii > 1; ii--)
+    {
+        freeSlots.back().push_back(ii - 1);
+    }
+
+    slot = 0;
+
+    return true;
+}
+
+
+void GpuCompute::evict(ResidentIterator it)
+{
+    freeSlots[it->page].push_back(it->slot);
+
+    auto found = residentIndex.find(it->address);
+
+    // The index refers to another column if the address has been re-used by a newer block
+    if (found != residentIndex.end() && found->second == it) residentIndex.erase(found);
+
+    resident.erase(it);
+}
@@ -0,0 +1,171 @@
+#ifndef GPU_COMPUTE_HPP
+#define GPU_COMPUTE_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+
+#include "data_series.hpp"
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLShaderProgram;
+
+
+/**
+ * @brief The GpuCompute class reduces pixel columns of very large series on the GPU (opt-in, see setEnabled).
+ *
+ * The value column of each block which is resampled is copied to the GPU once, and remains resident
+ * (up to RESIDENT_MEMORY_LIMIT, least recently used blocks are discarded first). A compute shader then
+ * finds the minimum and maximum sample of each pixel column, so re-sampling a resident range only
+ * transfers the indices of the extreme samples back from the GPU; the samples themselves (and the first
+ * and last sample of each column) are read from the series, so the columns hold exact values.
+ *
+ * Values are held in single precision, relative to the first value of their block, so precision is
+ * relative to the range of values within a block rather than their magnitude. Samples whose values
+ * differ by less than that precision are considered equal (the earliest is selected).
+ *
+ * All GL calls are made on a dedicated thread, which owns an offscreen context (OpenGL 4.3 or ES 3.1,
+ * as compute shaders require). If no such context can be created the backend is unavailable, and
+ * callers use the CPU kernels (see PlotCurveUpdater::resample).
+ */
+class GpuCompute
+{
+public:
+    static GpuCompute* getInstance(void);
+
+    //! Runs of pixel columns with fewer samples are reduced on the CPU (the transfer outweighs the saving)
+    static const uint64_t MIN_SAMPLES = 1 << 20;
+
+    //! Blocks held in each resident buffer (one dispatch reduces every segment within a buffer)
+    static const size_t PAGE_BLOCKS = 256;
+
+    //! Memory used by resident value columns (bytes)
+    static const size_t RESIDENT_MEMORY_LIMIT = 512 << 20;
+
+    //! Invocations per work group (each work group reduces a single segment)
+    static const unsigned int WORKGROUP_SIZE = 256;
+
+    //! Samples [first, last) of a single block, which lie within a pixel column
+    struct Segment
+    {
+        //! Index of the pixel column (within the run of columns)
+        size_t column = 0;
+
+        //! Index of the block (within the block table of the snapshot)
+        size_t block = 0;
+
+        uint32_t first = 0;
+        uint32_t last = 0;
+    };
+
+    //! Indices (within the block) of the minimum and maximum value of a segment
+    struct Extremes
+    {
+        uint32_t min = 0;
+        uint32_t max = 0;
+    };
+
+    bool initialise(void);
+    void shutdown(void);
+
+    //! The backend is selected, and a compute context is available
+    bool isActive(void) const { return enabled.load() && available.load(); }
+
+    bool isEnabled(void) const { return enabled.load(); }
+    void setEnabled(bool enable);
+
+    //! A compute context has been created (see initialise)
+    bool isAvailable(void) const { return available.load(); }
+
+    QString getRenderer(void) const;
+
+    bool visitColumns(const DataSnapshot& snapshot, const std::vector<uint64_t>& bounds,
+                      const std::function<void(size_t, const DataSnapshot::Bucket&)>& callback,
+                      const std::function<bool(void)>& cancelled = nullptr);
+
+    size_t getResidentBlocks(void) const;
+    size_t getResidentBytes(void) const;
+
+    void releaseResident(void);
+
+    static void planSegments(const DataSnapshot& snapshot, const std::vector<uint64_t>& bounds, std::vector<Segment>& segments);
+
+    static DataSnapshot::Bucket getBucket(const DataSnapshot& snapshot, const DataBlock::Columns& columns, const Segment& segment, const Extremes& extremes);
+
+protected:
+    GpuCompute();
+    ~GpuCompute();
+
+    //! Location of a resident value column
+    struct Resident
+    {
+        //! Block which was uploaded (an expired block is never resident, even if its address is re-used)
+        std::weak_ptr<const DataBlock> block;
+        const DataBlock* address = nullptr;
+
+        size_t page = 0;
+        size_t slot = 0;
+
+        //! Number of samples uploaded (samples may be appended to the final block of a series)
+        size_t length = 0;
+
+        //! Values are stored relative to the first value of the block
+        double reference = 0;
+    };
+
+    typedef std::list<Resident>::iterator ResidentIterator;
+
+    bool setup(void);
+    void release(void);
+
+    bool reduce(const DataSnapshot& snapshot, const std::vector<Segment>& segments, std::vector<Extremes>& extremes,
+                const std::function<bool(void)>& cancelled);
+
+    ResidentIterator makeResident(const DataBlock& block, const DataBlockPointer& pointer, size_t length);
+    bool allocateSlot(size_t& page, size_t& slot);
+    void evict(ResidentIterator it);
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> available{false};
+
+    bool initialised = false;
+
+    //! Thread on which every GL call is made, and an object which lives on it (see QMetaObject::invokeMethod)
+    QThread thread;
+    QObject* worker = nullptr;
+
+    QOffscreenSurface* surface = nullptr;
+    QOpenGLContext* context = nullptr;
+    QOpenGLShaderProgram* program = nullptr;
+
+    QString renderer;
+
+    //! Resident buffers, each holding PAGE_BLOCKS value columns of DataBlock::CAPACITY samples
+    std::vector<unsigned int> pages;
+
+    //! Unused slots of each page
+    std::vector<std::vector<size_t>> freeSlots;
+
+    //! Buffers for the segments of a dispatch, and the extremes which are read back
+    unsigned int segmentBuffer = 0;
+    unsigned int extremesBuffer = 0;
+
+    //! Resident columns (most recently used first), and their location by block
+    std::list<Resident> resident;
+    std::unordered_map<const DataBlock*, ResidentIterator> residentIndex;
+
+    //! Protects the resident columns (which are only modified on the compute thread)
+    mutable QMutex mutex;
+};
+
+
+#endif // GPU_COMPUTE_HPP
@@ -2,6 +2,9 @@
 
 #include <math.h>
 
+#include <QLocale>
+#include <QStringList>
+
 /**
  * @brief fixedWidthNumber formats an arbitrary number into a fixed-width string
  * @param value
@@ -27,3 +30,31 @@ QString fixedWidthNumber(double value)
 
     return text;
 }
+
+
+/**
+ * @brief formatDataSize formats a number of bytes for display (e.g. "1.5 MiB")
+ */
+QString formatDataSize(uint64_t bytes)
+{
+    return QLocale().formattedDataSize((qint64) bytes);
+}
+
+
+/**
+ * @brief describeMemoryUsage formats a breakdown of the memory used by a set of series (one category per line)
+ */
+QString describeMemoryUsage(const DataMemoryUsage &usage)
+{
+    QStringList lines;
+
+    lines.append(QString("Heap: %1").arg(formatDataSize(usage.getHeapBytes())));
+    lines.append(QString("Samples: %1").arg(formatDataSize(usage.columns)));
+    lines.append(QString("Compressed: %1").arg(formatDataSize(usage.compressed)));
+    lines.append(QString("Summaries: %1").arg(formatDataSize(usage.summary)));
+    lines.append(QString("Indexes: %1").arg(formatDataSize(usage.index)));
+    lines.append(QString("Decoded cache: %1").arg(formatDataSize(usage.cache)));
+    lines.append(QString("Mapped to disk: %1").arg(formatDataSize(usage.mapped)));
+
+    return lines.join("\n");
+}
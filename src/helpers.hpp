@@ -3,6 +3,11 @@
 
 #include <qstring.h>
 
+#include "data_block.hpp"
+
 QString fixedWidthNumber(double value);
 
+QString formatDataSize(uint64_t bytes);
+QString describeMemoryUsage(const DataMemoryUsage &usage);
+
 #endif // HELPERS_HPP
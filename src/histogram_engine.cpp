@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cmath>
+
+#include <QMetaObject>
+#include <QRunnable>
+
+#include "data_kernels.hpp"
+#include "parallel_for.hpp"
+#include "trace_recorder.hpp"
+
+#include "histogram_engine.hpp"
+
+
+const int HistogramEngine::DEFAULT_BINS;
+const int HistogramEngine::MAX_BINS;
+const uint64_t HistogramEngine::ESTIMATE_THRESHOLD;
+
+
+/*
+ * Thread pool task which computes the histograms of a single request
+ */
+class HistogramTask : public QRunnable
+{
+public:
+    HistogramTask(HistogramEngine &e, const HistogramEngine::Request &r) : engine(e), request(r) {}
+
+    virtual void run() override
+    {
+        engine.runRequest(request);
+    }
+
+protected:
+    HistogramEngine &engine;
+    HistogramEngine::Request request;
+};
+
+
+namespace
+{
+
+/*
+ * Spread n values evenly over the raw range [v_min, v_max], in bins of width 1 / scale starting at lo
+ */
+void spreadValues(double v_min, double v_max, double n, double lo, double scale, std::vector<double> &counts)
+{
+    const double top = (double) counts.size();
+
+    const double a = std::min(std::max((v_min - lo) * scale, 0.0), top);
+    const double b = std::min(std::max((v_max - lo) * scale, 0.0), top);
+
+    const size_t first = std::min((size_t) a, counts.size() - 1);
+
+    // Every value is in the same bin (e.g. a single sample, or a flat signal)
+    if (b - a < 1e-9 || (size_t) b == first)
+    {
+        counts[first] += n;
+        return;
+    }
+
+    const double density = n / (b - a);
+
+    for (size_t bin = first; bin < counts.size() && (double) bin < b; bin++)
+    {
+        counts[bin] += density * (std::min(b, bin + 1.0) - std::max(a, (double) bin));
+    }
+}
+
+}
+
+
+HistogramEngine::HistogramEngine(QObject *parent) : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+
+HistogramEngine::~HistogramEngine()
+{
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_mutex.unlock();
+
+    m_pool.waitForDone();
+}
+
+
+/**
+ * @brief HistogramEngine::requestHistograms - Compute the histogram of each series in the background.
+ * Any request which is still running is cancelled. histogramUpdated is emitted once the histograms (or their
+ * estimates) are available.
+ * @param series - The series (a null series has an empty histogram)
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range (inclusive)
+ * @param bins - Number of bins of each histogram
+ */
+void HistogramEngine::requestHistograms(const QList<DataSeriesPointer> &series, double t_min, double t_max, int bins)
+{
+    Request request;
+
+    // Snapshots are taken immediately, so the histograms describe the series at the time of the request
+    for (const auto &s : series)
+    {
+        request.labels.append(s.isNull() ? QString() : s->getLabel());
+        request.colors.append(s.isNull() ? QColor() : s->getColor());
+        request.snapshots.append(s.isNull() ? DataSnapshot() : s->getSnapshot());
+    }
+
+    request.t_min = std::min(t_min, t_max);
+    request.t_max = std::max(t_min, t_max);
+    request.bins = std::max(1, std::min(bins, MAX_BINS));
+    request.token = std::make_shared<CancellationToken>();
+
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_token = request.token;
+    request.id = ++m_requestId;
+
+    m_mutex.unlock();
+
+    m_pool.start(new HistogramTask(*this, request));
+}
+
+
+QVector<SeriesHistogram> HistogramEngine::getResults() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_results;
+}
+
+
+/**
+ * @brief HistogramEngine::isBusy - Determine if the most recent request has not been counted exactly
+ */
+bool HistogramEngine::isBusy() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_resultId != m_requestId || !m_resultExact;
+}
+
+
+/*
+ * Compute the histograms of a request (on the thread pool of the engine)
+ */
+void HistogramEngine::runRequest(const Request &request)
+{
+    TRACE_SCOPE("Histogram", "stats");
+
+    uint64_t total = 0;
+
+    for (const auto &snapshot : request.snapshots)
+    {
+        if (snapshot.isEmpty()) continue;
+
+        total += snapshot.upperBound(request.t_max) - snapshot.lowerBound(request.t_min);
+    }
+
+    // A large range is estimated first, so the view responds while the samples are counted
+    if (total > ESTIMATE_THRESHOLD && !computeResults(request, false)) return;
+
+    computeResults(request, true);
+}
+
+
+/*
+ * Compute (and publish) the histograms of a request, returning false if the request was cancelled
+ */
+bool HistogramEngine::computeResults(const Request &request, bool exact)
+{
+    QVector<SeriesHistogram> results;
+
+    // Each series is computed in turn (the blocks of each series are counted concurrently)
+    for (int idx = 0; idx < request.snapshots.count(); idx++)
+    {
+        if (request.token->isCancelled()) return false;
+
+        SeriesHistogram histogram = computeHistogram(request.snapshots[idx], request.t_min, request.t_max, request.bins, exact, request.token.get());
+
+        histogram.label = request.labels[idx];
+        histogram.color = request.colors[idx];
+
+        results.append(histogram);
+    }
+
+    if (request.token->isCancelled()) return false;
+
+    m_mutex.lock();
+
+    m_pending = results;
+    m_pendingId = request.id;
+    m_pendingExact = exact;
+
+    m_mutex.unlock();
+
+    // The results are published on the thread of the engine
+    QMetaObject::invokeMethod(this, "onRequestComplete", Qt::QueuedConnection);
+
+    return true;
+}
+
+
+void HistogramEngine::onRequestComplete()
+{
+    m_mutex.lock();
+
+    // Results of a superseded request are discarded (as is an estimate which arrives after the exact counts)
+    const bool current = m_pendingId == m_requestId && (m_pendingId != m_resultId || (m_pendingExact && !m_resultExact));
+
+    if (current)
+    {
+        m_results = m_pending;
+        m_resultId = m_pendingId;
+        m_resultExact = m_pendingExact;
+    }
+
+    m_mutex.unlock();
+
+    if (current)
+    {
+        emit histogramUpdated();
+    }
+}
+
+
+/**
+ * @brief HistogramEngine::computeHistogram - Compute the histogram of the samples of a snapshot within a time range
+ * @param snapshot - Samples of the series (scaled)
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range (inclusive)
+ * @param bins - Number of bins, which span the range of the values
+ * @param exact - Count every sample (otherwise the counts are estimated from the block summaries)
+ * @param token - Optional token which abandons the computation
+ */
+SeriesHistogram HistogramEngine::computeHistogram(const DataSnapshot &snapshot, double t_min, double t_max, int bins, bool exact, const CancellationToken *token)
+{
+    SeriesHistogram result;
+
+    result.exact = exact;
+
+    if (snapshot.isEmpty() || bins < 1) return result;
+
+    const uint64_t idx_first = snapshot.lowerBound(t_min);
+    const uint64_t idx_last = snapshot.upperBound(t_max);
+
+    // Values are binned raw, so the summaries (which are not scaled) can be used
+    const DataSnapshot raw = snapshot.getUnscaled();
+    const DataSnapshot::Statistics stats = raw.getStatistics(idx_first, idx_last);
+
+    if (stats.count == 0) return result;
+
+    result.count = stats.count;
+
+    const double lo = stats.min;
+    const double scale = stats.max > stats.min ? bins / (stats.max - stats.min) : 0;
+
+    const DataBlockTable &table = *raw.getTable();
+
+    const size_t firstBlock = table.getBlockForIndex(idx_first);
+    size_t lastBlock = firstBlock;
+
+    while (lastBlock < table.blocks.size() && table.offsets[lastBlock] < idx_last)
+    {
+        lastBlock++;
+    }
+
+    // Contiguous runs of blocks are counted in parallel, each into its own bins
+    const size_t blockCount = lastBlock - firstBlock;
+    const size_t runs = std::min<size_t>(blockCount, std::max(1, QThreadPool::globalInstance()->maxThreadCount()) * 4);
+
+    std::vector<std::vector<double>> partial(runs, std::vector<double>(bins, 0.0));
+
+    parallelFor(runs, [&](size_t run) {
+        std::vector<double> &counts = partial[run];
+        std::vector<uint32_t> local(exact ? bins : 0);
+
+        for (size_t ii = firstBlock + run * blockCount / runs; ii < firstBlock + (run + 1) * blockCount / runs; ii++)
+        {
+            if (token && token->isCancelled()) return;
+
+            const DataBlock &block = *table.blocks[ii];
+            const uint64_t base = table.offsets[ii];
+            const size_t length = table.getBlockLength(ii, raw.size());
+
+            const size_t a = idx_first > base ? idx_first - base : 0;
+            const size_t b = std::min<uint64_t>(idx_last - base, length);
+
+            if (a >= b) continue;
+
+            if (exact)
+            {
+                const DataBlock::Columns columns = block.getColumns(false);
+
+                std::fill(local.begin(), local.end(), 0);
+
+                if (columns.values)
+                {
+                    DataKernels::histogram(columns.values + a, b - a, lo, scale, bins, local.data());
+                }
+                else
+                {
+                    DataKernels::histogram(columns.valuesSingle + a, b - a, lo, scale, bins, local.data());
+                }
+
+                for (int bin = 0; bin < bins; bin++)
+                {
+                    counts[bin] += local[bin];
+                }
+
+                continue;
+            }
+
+            // Only the final block can still be growing (a block which is cut off by the next block is not sealed)
+            const bool sealed = ((ii + 1 < table.blocks.size()) || (length >= block.getCapacity())) && length == block.size();
+
+            // The samples of each bucket of the finest summary level are assumed to lie evenly between its min and max
+            block.visitSummary(a, b, 0, length, sealed, [&](size_t first, size_t last, const DataBlock::Summary &summary) {
+                spreadValues(summary.min, summary.max, (double) (last - first + 1), lo, scale, counts);
+            });
+        }
+    }, QThreadPool::globalInstance());
+
+    if (token && token->isCancelled()) return result;
+
+    result.counts.assign(bins, 0.0);
+
+    for (const auto &counts : partial)
+    {
+        for (int bin = 0; bin < bins; bin++)
+        {
+            result.counts[bin] += counts[bin];
+        }
+    }
+
+    // A negative scaler reverses the order of the values
+    const double v_lo = snapshot.applyScaling(stats.min);
+    const double v_hi = snapshot.applyScaling(stats.max);
+
+    if (v_lo > v_hi)
+    {
+        std::reverse(result.counts.begin(), result.counts.end());
+    }
+
+    result.min = std::min(v_lo, v_hi);
+    result.max = std::max(v_lo, v_hi);
+
+    return result;
+}
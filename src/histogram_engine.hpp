@@ -0,0 +1,126 @@
+#ifndef HISTOGRAM_ENGINE_HPP
+#define HISTOGRAM_ENGINE_HPP
+
+#include <vector>
+
+#include <QColor>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include "cancellation_token.hpp"
+#include "data_series.hpp"
+
+
+/**
+ * @brief The SeriesHistogram struct holds the distribution of the values of a series, within the range of a request
+ */
+struct SeriesHistogram
+{
+    QString label;
+    QColor color;
+
+    //! Range of the bins (scaled), which is the range of the values
+    double min = 0;
+    double max = 0;
+
+    //! Number of values in each bin (an estimate may be fractional)
+    std::vector<double> counts;
+
+    //! Number of values in range
+    uint64_t count = 0;
+
+    //! False if the counts were estimated from the block summaries
+    bool exact = false;
+
+    double getBinWidth(void) const { return counts.empty() ? 0 : (max - min) / counts.size(); }
+};
+
+
+/**
+ * @brief The HistogramEngine class computes the distribution of the values of a list of series in the background.
+ *
+ * The bins span the range of the values, which is read from the block summaries. For a large range of samples,
+ * the histogram is first estimated from the finest summary buckets (the samples of each bucket are spread evenly
+ * between its min and max), which is published immediately, and then counted exactly. Samples are counted
+ * in parallel, a block at a time, by a vectorised kernel (see DataKernels::histogram).
+ *
+ * Each request supersedes (and cancels) any request which is still running, and histogramUpdated is
+ * only emitted (on the thread of the engine) for the most recent request.
+ */
+class HistogramEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    HistogramEngine(QObject *parent = nullptr);
+    virtual ~HistogramEngine();
+
+    //! Default number of bins
+    static const int DEFAULT_BINS = 64;
+
+    //! Maximum number of bins
+    static const int MAX_BINS = 1024;
+
+    //! Requests for more samples than this (in total) are estimated before they are counted
+    static const uint64_t ESTIMATE_THRESHOLD = 1 << 22;
+
+    void requestHistograms(const QList<DataSeriesPointer> &series, double t_min, double t_max, int bins);
+
+    //! Histograms of the most recent request (the estimate, until the counts are complete)
+    QVector<SeriesHistogram> getResults(void) const;
+
+    bool isBusy(void) const;
+
+    static SeriesHistogram computeHistogram(const DataSnapshot &snapshot, double t_min, double t_max, int bins, bool exact, const CancellationToken *token = nullptr);
+
+signals:
+    void histogramUpdated(void);
+
+protected slots:
+    void onRequestComplete(void);
+
+protected:
+    struct Request
+    {
+        uint64_t id = 0;
+
+        QList<QString> labels;
+        QList<QColor> colors;
+        QList<DataSnapshot> snapshots;
+
+        double t_min = 0;
+        double t_max = 0;
+
+        int bins = DEFAULT_BINS;
+
+        CancellationTokenPointer token;
+    };
+
+    friend class HistogramTask;
+
+    void runRequest(const Request &request);
+    bool computeResults(const Request &request, bool exact);
+
+    //! Runs one request at a time (a superseded request is cancelled, and returns promptly)
+    QThreadPool m_pool;
+
+    mutable QMutex m_mutex;
+
+    uint64_t m_requestId = 0;
+    CancellationTokenPointer m_token;
+
+    QVector<SeriesHistogram> m_results;
+    uint64_t m_resultId = 0;
+    bool m_resultExact = false;
+
+    //! Completed results, which have not been published yet
+    QVector<SeriesHistogram> m_pending;
+    uint64_t m_pendingId = 0;
+    bool m_pendingExact = false;
+};
+
+
+#endif // HISTOGRAM_ENGINE_HPP
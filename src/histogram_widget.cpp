@@ -0,0 +1,154 @@
+#include <algorithm>
+
+#include <QInputDialog>
+#include <QMenu>
+
+#include <qwt_legend.h>
+#include <qwt_samples.h>
+#include <qwt_text.h>
+
+#include "histogram_widget.hpp"
+#include "lumberjack_settings.hpp"
+#include "plot_scheduler.hpp"
+
+
+HistogramWidget::HistogramWidget() : QwtPlot()
+{
+    auto label = axisTitle(QwtPlot::yLeft);
+    auto font = label.font();
+
+    font.setPointSize(8);
+    label.setFont(font);
+    label.setText("Samples");
+
+    setAxisTitle(QwtPlot::yLeft, label);
+
+    insertLegend(new QwtLegend(), QwtPlot::BottomLegend);
+
+    bins = LumberjackSettings::getInstance()->loadSetting("histogram", "bins", HistogramEngine::DEFAULT_BINS).toInt();
+    bins = std::max(1, std::min(bins, HistogramEngine::MAX_BINS));
+
+    setContextMenuPolicy(Qt::CustomContextMenu);
+    setMinimumSize(200, 100);
+
+    connect(&engine, &HistogramEngine::histogramUpdated, this, &HistogramWidget::onHistogramUpdated);
+    connect(this, &HistogramWidget::customContextMenuRequested, this, &HistogramWidget::onContextMenu);
+}
+
+
+void HistogramWidget::setBinCount(int count)
+{
+    count = std::max(1, std::min(count, HistogramEngine::MAX_BINS));
+
+    if (count == bins) return;
+
+    bins = count;
+
+    LumberjackSettings::getInstance()->saveSetting("histogram", "bins", bins);
+
+    requestHistograms();
+}
+
+
+/**
+ * @brief HistogramWidget::updateHistograms - Request the histograms of the series within the visible range.
+ * The histograms are computed in the background, and the plot is updated once they are available
+ */
+void HistogramWidget::updateHistograms(const QList<DataSeriesPointer> &series, const QwtInterval &view)
+{
+    seriesList = series;
+    interval = view;
+
+    requestHistograms();
+}
+
+
+void HistogramWidget::requestHistograms()
+{
+    engine.requestHistograms(seriesList, interval.minValue(), interval.maxValue(), bins);
+}
+
+
+void HistogramWidget::onHistogramUpdated()
+{
+    const auto results = engine.getResults();
+
+    // Remove any extra histograms
+    while (histograms.count() > results.count())
+    {
+        auto *histogram = histograms.takeLast();
+
+        histogram->detach();
+        delete histogram;
+    }
+
+    // Add any extra histograms
+    while (histograms.count() < results.count())
+    {
+        auto *histogram = new QwtPlotHistogram();
+
+        histogram->setStyle(QwtPlotHistogram::Columns);
+        histogram->attach(this);
+
+        histograms.append(histogram);
+    }
+
+    bool exact = true;
+
+    for (int idx = 0; idx < results.count(); idx++)
+    {
+        const auto &result = results.at(idx);
+
+        QVector<QwtIntervalSample> samples;
+
+        const double width = result.getBinWidth();
+
+        for (size_t bin = 0; bin < result.counts.size(); bin++)
+        {
+            const double lo = result.min + bin * width;
+
+            // Every value is equal, so the single occupied bin is drawn with unit width
+            const QwtInterval range = width > 0 ? QwtInterval(lo, lo + width) : QwtInterval(lo - 0.5, lo + 0.5);
+
+            if (result.counts[bin] > 0) samples.append(QwtIntervalSample(result.counts[bin], range));
+        }
+
+        QColor fill = result.color;
+        fill.setAlpha(96);
+
+        auto *histogram = histograms.at(idx);
+
+        histogram->setTitle(result.label);
+        histogram->setPen(QPen(result.color));
+        histogram->setBrush(QBrush(fill));
+        histogram->setSamples(samples);
+
+        exact &= result.exact;
+    }
+
+    setTitle(exact ? QString() : tr("Estimated (counting samples...)"));
+
+    setAxisAutoScale(QwtPlot::xBottom);
+    setAxisAutoScale(QwtPlot::yLeft);
+
+    PlotReplotScheduler::getInstance()->requestReplot(this);
+}
+
+
+void HistogramWidget::onContextMenu(const QPoint &pos)
+{
+    QMenu menu(this);
+
+    QAction *binCount = menu.addAction(tr("Set Bin Count..."));
+
+    QAction *action = menu.exec(mapToGlobal(pos));
+
+    if (action == binCount)
+    {
+        bool ok = false;
+
+        const int count = QInputDialog::getInt(this, tr("Histogram"), tr("Number of bins"), bins, 1, HistogramEngine::MAX_BINS, 1, &ok);
+
+        if (ok) setBinCount(count);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef HISTOGRAM_WIDGET_HPP
+#define HISTOGRAM_WIDGET_HPP
+
+#include <QList>
+#include <QPoint>
+
+#include <qwt_interval.h>
+#include <qwt_plot.h>
+#include <qwt_plot_histogram.h>
+
+#include "data_series.hpp"
+#include "histogram_engine.hpp"
+
+
+/*
+ * Displays the distribution of the values of the visible series, over the visible timespan.
+ * The histograms of a large range are estimated (and marked as such) until the samples have been counted.
+ */
+class HistogramWidget : public QwtPlot
+{
+    Q_OBJECT
+
+public:
+    HistogramWidget();
+
+    int getBinCount(void) const { return bins; }
+    void setBinCount(int count);
+
+public slots:
+    void updateHistograms(const QList<DataSeriesPointer> &series, const QwtInterval &interval);
+
+protected slots:
+    void onHistogramUpdated(void);
+    void onContextMenu(const QPoint &pos);
+
+protected:
+    void requestHistograms(void);
+
+    //! Computes the histograms in the background (a new request cancels the previous one)
+    HistogramEngine engine;
+
+    QList<DataSeriesPointer> seriesList;
+    QwtInterval interval;
+
+    int bins = HistogramEngine::DEFAULT_BINS;
+
+    //! Histogram of each series (which are owned by the plot)
+    QList<QwtPlotHistogram*> histograms;
+};
+
+#endif // HISTOGRAM_WIDGET_HPP
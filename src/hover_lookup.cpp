@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+
+#include "hover_lookup.hpp"
+
+
+/**
+ * @brief HoverLookup::setSeries - Select the series which are looked up.
+ * The cursors of series which were already selected are retained.
+ */
+void HoverLookup::setSeries(const QList<DataSeriesPointer> &s)
+{
+    std::vector<Entry> previous;
+    previous.swap(entries);
+
+    QList<DataSeriesPointer> previousSeries = series;
+
+    series = s;
+    entries.resize(series.count());
+
+    for (int idx = 0; idx < series.count(); idx++)
+    {
+        const int found = previousSeries.indexOf(series.at(idx));
+
+        if (found >= 0)
+        {
+            entries[idx] = previous[found];
+        }
+    }
+}
+
+
+/**
+ * @brief HoverLookup::setSamples - Provide the resampled samples which are drawn for a series
+ * @param idx - Index of the series
+ * @param samples - Resampled samples (raw values)
+ * @param scaler - Scaler applied to the raw values
+ * @param offset - Offset applied to the raw values
+ */
+void HoverLookup::setSamples(int idx, PlotSamplesPointer samples, double scaler, double offset)
+{
+    if (idx < 0 || idx >= (int) entries.size()) return;
+
+    Entry &entry = entries[idx];
+
+    if (entry.samples != samples)
+    {
+        entry.sampleIdx = 0;
+    }
+
+    entry.samples = samples;
+    entry.scaler = scaler;
+    entry.offset = offset;
+}
+
+
+/**
+ * @brief HoverLookup::setView - Set the visible time range, which determines whether each series is resolved
+ * from its raw or resampled samples
+ * @param t_min - Start of the view
+ * @param t_max - End of the view
+ * @param pixels - Width of the view (pixels)
+ */
+void HoverLookup::setView(double t_min, double t_max, unsigned int pixels)
+{
+    for (int idx = 0; idx < series.count(); idx++)
+    {
+        Entry &entry = entries[idx];
+
+        entry.dense = false;
+
+        if (series.at(idx).isNull() || pixels == 0) continue;
+
+        const DataSnapshot raw = series.at(idx)->getRawSnapshot();
+
+        const uint64_t count = raw.upperBound(t_max) - raw.lowerBound(t_min);
+
+        entry.dense = count > pixels * RAW_SAMPLES_PER_PIXEL;
+    }
+}
+
+
+/**
+ * @brief HoverLookup::lookup - Return the (interpolated) value of a series at the specified time
+ * @param idx - Index of the series
+ * @param t - Timestamp
+ * @param resampled - Optionally set to true if the value was resolved from the resampled samples
+ * @return the value (NaN if the series has no samples)
+ */
+double HoverLookup::lookup(int idx, double t, bool *resampled)
+{
+    if (resampled) *resampled = false;
+
+    if (idx < 0 || idx >= series.count() || series.at(idx).isNull()) return NAN;
+
+    Entry &entry = entries[idx];
+
+    if (resampledEnabled && entry.dense && entry.samples && entry.samples->size() > 0)
+    {
+        if (resampled) *resampled = true;
+
+        return lookupResampled(entry, t);
+    }
+
+    return lookupRaw(series.at(idx), entry, t);
+}
+
+
+/**
+ * @brief HoverLookup::lookupAll - Look up the value of every series at the specified time
+ */
+void HoverLookup::lookupAll(double t, std::vector<double> &values)
+{
+    values.resize(series.count());
+
+    for (int idx = 0; idx < series.count(); idx++)
+    {
+        values[idx] = lookup(idx, t);
+    }
+}
+
+
+double HoverLookup::lookupRaw(const DataSeriesPointer &s, Entry &entry, double t)
+{
+    const DataSnapshot raw = s->getRawSnapshot();
+
+    // The cursor (and the filtered samples it reads) are only replaced when the series has changed
+    if (!raw.isIdentical(entry.raw) || raw.getScaler() != entry.raw.getScaler() || raw.getOffset() != entry.raw.getOffset() || s->getFilter())
+    {
+        entry.raw = raw;
+        entry.cursor = DataCursor(s->getSnapshot());
+    }
+
+    if (entry.cursor.getSnapshot().isEmpty()) return NAN;
+
+    return entry.cursor.interpolate(t);
+}
+
+
+double HoverLookup::lookupResampled(Entry &entry, double t)
+{
+    const auto &timestamps = entry.samples->timestamps;
+    const auto &values = entry.samples->values;
+
+    const size_t n = timestamps.size();
+
+    size_t idx = std::min(entry.sampleIdx, n);
+
+    // Find the first sample after t, starting from the previous result
+    if (idx < n && timestamps[idx] <= t)
+    {
+        while (idx < n && timestamps[idx] <= t) idx++;
+    }
+    else
+    {
+        while (idx > 0 && timestamps[idx - 1] > t) idx--;
+    }
+
+    entry.sampleIdx = idx;
+
+    double value;
+
+    if (idx == 0)
+    {
+        value = values.front();
+    }
+    else if (idx >= n)
+    {
+        value = values.back();
+    }
+    else
+    {
+        const double dt = timestamps[idx] - timestamps[idx - 1];
+
+        value = values[idx - 1];
+
+        if (dt > 0)
+        {
+            value += (values[idx] - values[idx - 1]) * (t - timestamps[idx - 1]) / dt;
+        }
+    }
+
+    return value * entry.scaler + entry.offset;
+}
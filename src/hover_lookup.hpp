@@ -0,0 +1,75 @@
+#ifndef HOVER_LOOKUP_HPP
+#define HOVER_LOOKUP_HPP
+
+#include <vector>
+
+#include <QList>
+
+#include "data_series.hpp"
+#include "plot_sampler.hpp"
+
+
+/**
+ * @brief The HoverLookup class resolves the values of a set of series at the mouse cursor.
+ *
+ * A DataCursor is retained for each series, and only replaced when the samples of the series change,
+ * so successive lookups (as the mouse moves) usually resolve within the block, and near the sample,
+ * of the previous lookup rather than searching the whole series.
+ *
+ * When the view holds many more samples than pixels, the value at a single pixel is not meaningful
+ * anyway, so lookups may instead be resolved from the resampled samples which are drawn (see setSamples).
+ */
+class HoverLookup
+{
+public:
+    //! Lookups are resolved from the resampled samples if the view holds more raw samples per pixel
+    static constexpr double RAW_SAMPLES_PER_PIXEL = 4;
+
+    void setSeries(const QList<DataSeriesPointer> &series);
+    const QList<DataSeriesPointer>& getDataSeries(void) const { return series; }
+
+    int indexOf(const DataSeriesPointer &s) const { return series.indexOf(s); }
+
+    void setSamples(int idx, PlotSamplesPointer samples, double scaler, double offset);
+
+    void setView(double t_min, double t_max, unsigned int pixels);
+
+    //! Allow lookups to be resolved from the resampled samples
+    void setResampledEnabled(bool enabled) { resampledEnabled = enabled; }
+    bool isResampledEnabled(void) const { return resampledEnabled; }
+
+    double lookup(int idx, double t, bool *resampled = nullptr);
+
+    void lookupAll(double t, std::vector<double> &values);
+
+protected:
+    struct Entry
+    {
+        //! Raw samples observed by the cursor
+        DataSnapshot raw;
+
+        DataCursor cursor;
+
+        //! Resampled samples (raw values) and the scaling applied when they are drawn
+        PlotSamplesPointer samples;
+        double scaler = 1;
+        double offset = 0;
+
+        //! Result of the previous lookup within the resampled samples
+        size_t sampleIdx = 0;
+
+        //! The view holds many more raw samples than pixels
+        bool dense = false;
+    };
+
+    double lookupRaw(const DataSeriesPointer &s, Entry &entry, double t);
+    double lookupResampled(Entry &entry, double t);
+
+    QList<DataSeriesPointer> series;
+    std::vector<Entry> entries;
+
+    bool resampledEnabled = true;
+};
+
+
+#endif // HOVER_LOOKUP_HPP
@@ -0,0 +1,123 @@
+#include <stdint.h>
+
+#include "import_arena.hpp"
+
+
+const size_t ImportArena::PAGE_SIZE;
+
+
+/**
+ * @brief ImportArena::allocate - Allocate memory from the arena (which is valid until the arena is reset)
+ * @param bytes is the size of the allocation
+ * @param alignment is the alignment of the allocation (a power of two)
+ */
+void* ImportArena::allocate(size_t bytes, size_t alignment)
+{
+    if (bytes == 0) bytes = 1;
+
+    while (true)
+    {
+        // Pages which were retained by reset are used in order
+        while (current < pages.size())
+        {
+            Page &page = pages[current];
+
+            const uintptr_t base = (uintptr_t) page.data.get();
+            const size_t start = (size_t) (((base + offset + alignment - 1) & ~(uintptr_t) (alignment - 1)) - base);
+
+            if (start + bytes <= page.size)
+            {
+                offset = start + bytes;
+                used += bytes;
+
+                return page.data.get() + start;
+            }
+
+            current++;
+            offset = 0;
+        }
+
+        Page page;
+
+        page.size = std::max(PAGE_SIZE, bytes + alignment);
+        page.data.reset(new char[page.size]);
+
+        capacity += page.size;
+
+        pages.push_back(std::move(page));
+
+        current = pages.size() - 1;
+        offset = 0;
+    }
+}
+
+
+/**
+ * @brief ImportArena::extend - Grow the most recent allocation in place, if there is room within its page
+ * @param ptr is the allocation
+ * @param bytes is the current size of the allocation
+ * @param required is the new size of the allocation
+ * @return true if the allocation was extended (otherwise a new allocation is required)
+ */
+bool ImportArena::extend(void *ptr, size_t bytes, size_t required)
+{
+    if (current >= pages.size() || required < bytes) return false;
+
+    Page &page = pages[current];
+
+    const char *top = page.data.get() + offset;
+
+    if ((const char*) ptr + bytes != top) return false;
+
+    const size_t start = (size_t) ((const char*) ptr - page.data.get());
+
+    if (start + required > page.size) return false;
+
+    offset = start + required;
+    used += required - bytes;
+
+    return true;
+}
+
+
+/**
+ * @brief ImportArena::reset - Reclaim every allocation, retaining the pages for later allocations.
+ * If the arena required several pages, they are replaced with a single page of the same total size,
+ * so that later allocations of a similar size are contiguous.
+ */
+void ImportArena::reset()
+{
+    if (pages.size() > 1)
+    {
+        const size_t total = capacity;
+
+        release();
+
+        Page page;
+
+        page.size = total;
+        page.data.reset(new char[total]);
+
+        capacity = total;
+
+        pages.push_back(std::move(page));
+    }
+
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+
+/**
+ * @brief ImportArena::release - Free every page of the arena (e.g. once the import is complete)
+ */
+void ImportArena::release()
+{
+    pages.clear();
+
+    current = 0;
+    offset = 0;
+    capacity = 0;
+    used = 0;
+}
@@ -0,0 +1,153 @@
+#ifndef IMPORT_ARENA_HPP
+#define IMPORT_ARENA_HPP
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+/**
+ * @brief The ImportArena class is a monotonic allocator for the transient state of an import
+ * (e.g. the samples parsed from each chunk of a file, before they are added to their series).
+ *
+ * Memory is allocated from a small number of large pages, by advancing an offset, and is never freed
+ * individually. Instead, the arena is reset once the state is no longer required (e.g. once each block of the
+ * file has been appended to the series), which retains the pages for the next block, and is released when the
+ * import is complete. An import therefore allocates a few large pages, rather than many small (and growing)
+ * buffers, which would otherwise fragment the heap of a long session with repeated imports.
+ *
+ * An arena is not thread-safe: each worker (e.g. each chunk of a block) allocates from its own arena.
+ */
+class ImportArena
+{
+public:
+    //! Minimum size of each page (bytes)
+    static const size_t PAGE_SIZE = 1 << 20;
+
+    ImportArena() {}
+    ~ImportArena() { release(); }
+
+    ImportArena(const ImportArena&) = delete;
+    ImportArena& operator=(const ImportArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+
+    template<typename T>
+    T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+    bool extend(void *ptr, size_t bytes, size_t required);
+
+    void reset(void);
+    void release(void);
+
+    //! Total size of the pages (bytes)
+    size_t getCapacity(void) const { return capacity; }
+
+    //! Number of bytes allocated since the arena was reset
+    size_t getUsed(void) const { return used; }
+
+    size_t getPageCount(void) const { return pages.size(); }
+
+protected:
+    struct Page
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    std::vector<Page> pages;
+
+    //! Page which is being allocated from, and the offset of its first free byte
+    size_t current = 0;
+    size_t offset = 0;
+
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+
+/**
+ * @brief The ArenaBuffer class is a growable array of trivially copyable elements, which is allocated from an ImportArena.
+ *
+ * The buffer grows in place while it is the most recent allocation of the arena, and is otherwise moved to a
+ * larger allocation (the previous allocation is reclaimed when the arena is reset). The elements are only valid
+ * until the arena is reset, and the buffer does not free them.
+ */
+template<typename T>
+class ArenaBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaBuffer elements must be trivially copyable");
+
+public:
+    //! Number of elements of the first allocation
+    static const size_t MIN_CAPACITY = 64;
+
+    ArenaBuffer() {}
+    ArenaBuffer(ImportArena *arena) : arena(arena) {}
+
+    void setArena(ImportArena *a) { arena = a; m_data = nullptr; count = 0; capacity = 0; }
+    ImportArena* getArena(void) const { return arena; }
+
+    size_t size(void) const { return count; }
+    bool empty(void) const { return count == 0; }
+
+    T* data(void) { return m_data; }
+    const T* data(void) const { return m_data; }
+
+    T* begin(void) { return m_data; }
+    T* end(void) { return m_data + count; }
+    const T* begin(void) const { return m_data; }
+    const T* end(void) const { return m_data + count; }
+
+    T& operator[](size_t idx) { return m_data[idx]; }
+    const T& operator[](size_t idx) const { return m_data[idx]; }
+
+    T& back(void) { return m_data[count - 1]; }
+
+    void push_back(const T &value)
+    {
+        if (count == capacity) reserve(std::max(MIN_CAPACITY, capacity * 2));
+
+        m_data[count++] = value;
+    }
+
+    void reserve(size_t required)
+    {
+        if (required <= capacity) return;
+
+        if (m_data && arena->extend(m_data, capacity * sizeof(T), required * sizeof(T)))
+        {
+            capacity = required;
+            return;
+        }
+
+        T *grown = arena->allocate<T>(required);
+
+        if (count > 0) memcpy(grown, m_data, count * sizeof(T));
+
+        m_data = grown;
+        capacity = required;
+    }
+
+    //! Remove the elements (retaining the allocation)
+    void clear(void) { count = 0; }
+
+protected:
+    ImportArena *arena = nullptr;
+
+    T *m_data = nullptr;
+
+    size_t count = 0;
+    size_t capacity = 0;
+};
+
+
+template<typename T>
+const size_t ArenaBuffer<T>::MIN_CAPACITY;
+
+
+#endif // IMPORT_ARENA_HPP
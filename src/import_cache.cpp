@@ -0,0 +1,164 @@
+#include <string.h>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "import_cache.hpp"
+#include "series_file.hpp"
+
+
+const uint32_t ImportCache::FILE_VERSION;
+
+static const char FILE_MAGIC[4] = {'L', 'J', 'I', 'C'};
+
+
+/*
+ * The cache file is written alongside the original file
+ */
+QString ImportCache::getFileName(const QString& filename)
+{
+    return filename + ".ljcache";
+}
+
+
+/**
+ * @brief ImportCache::getKey - Describe the import of a file
+ * @param filename is the original file
+ * @param importer identifies the importer (e.g. plugin name and version)
+ * @param options describes the import options in use (see ImportPlugin::getOptionsKey)
+ * @return the key, which changes if the file (or the import) changes
+ */
+QByteArray ImportCache::getKey(const QString& filename, const QString& importer, const QByteArray& options)
+{
+    const QFileInfo info(filename);
+
+    QByteArray key;
+
+    key += "path=" + info.absoluteFilePath().toUtf8() + "\n";
+    key += "size=" + QByteArray::number((qlonglong) info.size()) + "\n";
+    key += "modified=" + QByteArray::number((qlonglong) info.lastModified().toMSecsSinceEpoch()) + "\n";
+    key += "importer=" + importer.toUtf8() + "\n";
+    key += "options=" + options + "\n";
+
+    return key;
+}
+
+
+/**
+ * @brief ImportCache::load - Load the series imported from a file
+ * @param filename is the original file
+ * @param key describes the import (see getKey)
+ * @param series receives the imported series
+ * @return true if the cache file is valid for the key
+ */
+bool ImportCache::load(const QString& filename, const QByteArray& key, QList<DataSeriesPointer>& series)
+{
+    QFile file(getFileName(filename));
+
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    char magic[4] = {0};
+    uint32_t version = 0;
+    uint32_t keyLength = 0;
+    uint32_t count = 0;
+
+    if (!SeriesFile::readData(file, magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+        !SeriesFile::readData(file, &version, sizeof(version)) || version != FILE_VERSION ||
+        !SeriesFile::readData(file, &keyLength, sizeof(keyLength)) || keyLength != (uint32_t) key.size())
+    {
+        return false;
+    }
+
+    // The original file has changed (or was imported differently)
+    if (file.read(keyLength) != key || !SeriesFile::readData(file, &count, sizeof(count)))
+    {
+        return false;
+    }
+
+    QList<DataSeriesPointer> loaded;
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        uint32_t labelLength = 0;
+        int64_t epochBase = 0;
+
+        bool valid = SeriesFile::readData(file, &labelLength, sizeof(labelLength)) && labelLength < (1 << 16);
+
+        QByteArray label;
+
+        if (valid)
+        {
+            label = file.read(labelLength);
+            valid = (uint32_t) label.size() == labelLength && SeriesFile::readData(file, &epochBase, sizeof(epochBase));
+        }
+
+        DataSeriesPointer s(new DataSeries(QString::fromUtf8(label)));
+
+        s->setEpochBase(epochBase);
+
+        if (!valid || !SeriesFile::readSamples(file, *s))
+        {
+            qWarning() << "Invalid import cache file" << file.fileName();
+            return false;
+        }
+
+        loaded.append(s);
+    }
+
+    series = loaded;
+
+    return true;
+}
+
+
+/**
+ * @brief ImportCache::store - Store the series imported from a file (replacing any existing cache file)
+ * @param filename is the original file
+ * @param key describes the import (see getKey)
+ * @param series are the imported series (the raw values are stored)
+ * @return true if the cache file was written
+ */
+bool ImportCache::store(const QString& filename, const QByteArray& key, const QList<DataSeriesPointer>& series)
+{
+    // The file is only replaced once it has been written in full
+    QSaveFile file(getFileName(filename));
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    const uint32_t version = FILE_VERSION;
+    const uint32_t keyLength = key.size();
+    const uint32_t count = series.size();
+
+    bool valid = SeriesFile::writeData(file, FILE_MAGIC, sizeof(FILE_MAGIC)) &&
+                 SeriesFile::writeData(file, &version, sizeof(version)) &&
+                 SeriesFile::writeData(file, &keyLength, sizeof(keyLength)) &&
+                 SeriesFile::writeData(file, key.constData(), key.size()) &&
+                 SeriesFile::writeData(file, &count, sizeof(count));
+
+    for (const auto& s : series)
+    {
+        if (!valid) break;
+
+        const QByteArray label = s->getLabel().toUtf8();
+        const uint32_t labelLength = label.size();
+        const int64_t epochBase = s->getEpochBase();
+
+        valid = SeriesFile::writeData(file, &labelLength, sizeof(labelLength)) &&
+                SeriesFile::writeData(file, label.constData(), label.size()) &&
+                SeriesFile::writeData(file, &epochBase, sizeof(epochBase)) &&
+                SeriesFile::writeSamples(file, s->getSnapshot());
+    }
+
+    if (!valid || !file.commit())
+    {
+        qWarning() << "Could not write import cache file" << file.fileName();
+
+        file.cancelWriting();
+        return false;
+    }
+
+    return true;
+}
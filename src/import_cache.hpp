@@ -0,0 +1,39 @@
+#ifndef IMPORT_CACHE_HPP
+#define IMPORT_CACHE_HPP
+
+#include <stdint.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The ImportCache class stores the series imported from a file in a sidecar file (e.g. log.csv.ljcache),
+ * so that re-opening the same file does not parse it again.
+ *
+ * The cache file is identified by a key which describes the import: the path, size and modification
+ * time of the original file, and the importer (and its options) which produced the series. If any of
+ * these changes, the cache file is ignored (and replaced after the next import).
+ *
+ * Each series is stored as a column, compressed with DataCodec (see SeriesFile):
+ *
+ *   "LJIC" | version (uint32) | key length (uint32) | key | series count (uint32)
+ *   then for each series: label length (uint32) | label (UTF-8) | epoch base (int64) | samples
+ */
+class ImportCache
+{
+public:
+    static const uint32_t FILE_VERSION = 2;
+
+    static QString getFileName(const QString& filename);
+
+    static QByteArray getKey(const QString& filename, const QString& importer, const QByteArray& options);
+
+    static bool load(const QString& filename, const QByteArray& key, QList<DataSeriesPointer>& series);
+    static bool store(const QString& filename, const QByteArray& key, const QList<DataSeriesPointer>& series);
+};
+
+#endif // IMPORT_CACHE_HPP
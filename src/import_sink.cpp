@@ -0,0 +1,78 @@
+#include "import_sink.hpp"
+
+
+SeriesImportSink::SeriesImportSink() : m_store(DataStore::getDefault())
+{
+}
+
+
+/**
+ * @brief SeriesImportSink::declareChannel - Create the series of a new channel
+ * @return the index of the channel
+ */
+int SeriesImportSink::declareChannel(const QString &label, const QString &group, const QString &units)
+{
+    auto series = DataSeriesPointer(new DataSeries(group, label));
+
+    series->setUnits(units);
+    series->setValuePrecision(m_precision);
+    series->setCompressionEnabled(m_compression);
+
+    if (m_store && series->getDataStore() != m_store)
+    {
+        series->setDataStore(m_store);
+    }
+
+    QMutexLocker lock(&m_mutex);
+
+    m_channels.append(series);
+
+    return m_channels.count() - 1;
+}
+
+
+int SeriesImportSink::getChannelCount() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_channels.count();
+}
+
+
+/**
+ * @brief SeriesImportSink::pushSamples - Append a batch of samples to the series of a channel.
+ * The series is not updated (the host updates each series as it grows, see DataSourceManager::publishImport)
+ */
+bool SeriesImportSink::pushSamples(int channel, const double *timestamps, const double *values, size_t count)
+{
+    auto series = getChannel(channel);
+
+    if (series.isNull()) return false;
+
+    if (count > 0)
+    {
+        series->addData(timestamps, values, count, false);
+
+        m_sampleCount += count;
+    }
+
+    return true;
+}
+
+
+QList<DataSeriesPointer> SeriesImportSink::getDataSeries() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_channels;
+}
+
+
+DataSeriesPointer SeriesImportSink::getChannel(int channel) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (channel < 0 || channel >= m_channels.count()) return DataSeriesPointer();
+
+    return m_channels[channel];
+}
@@ -0,0 +1,59 @@
+#ifndef IMPORT_SINK_HPP
+#define IMPORT_SINK_HPP
+
+#include <atomic>
+#include <memory>
+
+#include <QList>
+#include <QMutex>
+
+#include "data_series.hpp"
+#include "data_store.hpp"
+#include "plugin_importer.hpp"
+
+
+/**
+ * @brief The SeriesImportSink class stores the samples which an importer pushes into it (see ImportSink).
+ *
+ * Each channel is stored as a DataSeries, which is created (with the storage options of the sink)
+ * when the channel is declared, so it can be displayed while the import is still running.
+ * Batches are appended directly to the blocks of the series, without being buffered by the sink.
+ */
+class SeriesImportSink : public ImportSink
+{
+public:
+    SeriesImportSink();
+
+    virtual int declareChannel(const QString &label, const QString &group = QString(), const QString &units = QString()) override;
+    virtual int getChannelCount(void) const override;
+
+    virtual bool pushSamples(int channel, const double *timestamps, const double *values, size_t count) override;
+
+    //! Series of every channel (in the order they were declared)
+    QList<DataSeriesPointer> getDataSeries(void) const;
+
+    //! Total number of samples pushed into the sink
+    uint64_t getSampleCount(void) const { return m_sampleCount.load(); }
+
+    /* Storage options, applied to the series of channels which are declared later */
+    void setValuePrecision(DataSeries::ValuePrecision precision) { m_precision = precision; }
+    void setCompressionEnabled(bool enabled) { m_compression = enabled; }
+    void setDataStore(std::shared_ptr<DataStore> store) { m_store = store; }
+
+protected:
+    DataSeriesPointer getChannel(int channel) const;
+
+    //! Protects the list of channels (the series themselves are thread-safe)
+    mutable QMutex m_mutex;
+
+    QList<DataSeriesPointer> m_channels;
+
+    DataSeries::ValuePrecision m_precision = DataSeries::DOUBLE_PRECISION;
+    bool m_compression = false;
+    std::shared_ptr<DataStore> m_store;
+
+    std::atomic<uint64_t> m_sampleCount{0};
+};
+
+
+#endif // IMPORT_SINK_HPP
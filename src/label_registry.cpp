@@ -0,0 +1,78 @@
+#include "label_registry.hpp"
+
+
+const LabelRegistry::Id LabelRegistry::INVALID_ID;
+
+
+LabelRegistry::LabelRegistry()
+{
+    labels.append(QString());
+}
+
+
+/**
+ * @brief LabelRegistry::getInstance - The registry is created on first use (which may be from any thread)
+ */
+LabelRegistry* LabelRegistry::getInstance()
+{
+    static LabelRegistry registry;
+
+    return &registry;
+}
+
+
+/**
+ * @brief LabelRegistry::intern - Return the ID of a label, assigning a new ID if the label has not been seen
+ */
+LabelRegistry::Id LabelRegistry::intern(const QString& label)
+{
+    {
+        QReadLocker locker(&lock);
+
+        auto it = ids.constFind(label);
+
+        if (it != ids.constEnd()) return it.value();
+    }
+
+    QWriteLocker locker(&lock);
+
+    // The label may have been interned by another thread in the meantime
+    auto it = ids.constFind(label);
+
+    if (it != ids.constEnd()) return it.value();
+
+    const Id id = (Id) labels.size();
+
+    labels.append(label);
+    ids.insert(label, id);
+
+    return id;
+}
+
+
+/**
+ * @brief LabelRegistry::find - Return the ID of a label (or INVALID_ID if it has not been interned).
+ * A label which has not been interned cannot be the label of any source or series.
+ */
+LabelRegistry::Id LabelRegistry::find(const QString& label) const
+{
+    QReadLocker locker(&lock);
+
+    return ids.value(label, INVALID_ID);
+}
+
+
+QString LabelRegistry::getLabel(Id id) const
+{
+    QReadLocker locker(&lock);
+
+    return id < (Id) labels.size() ? labels[id] : QString();
+}
+
+
+int LabelRegistry::size() const
+{
+    QReadLocker locker(&lock);
+
+    return labels.size() - 1;
+}
@@ -0,0 +1,52 @@
+#ifndef LABEL_REGISTRY_HPP
+#define LABEL_REGISTRY_HPP
+
+#include <stdint.h>
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+
+/**
+ * @brief The LabelRegistry class interns the labels of sources and series, so that each distinct label
+ * is identified by a small integer ID (see DataSource::getSeriesById and DataSourceManager::findSeries).
+ *
+ * The ID of a label never changes (labels are never released), so code which resolves the same series
+ * repeatedly (e.g. the inputs of a math trace, or the curves of a restored workspace) can resolve its labels
+ * once, and then look the series up by ID, without hashing or comparing strings.
+ *
+ * Labels may be interned from any thread.
+ */
+class LabelRegistry
+{
+public:
+    typedef uint32_t Id;
+
+    //! ID of a label which has not been interned
+    static const Id INVALID_ID = 0;
+
+    static LabelRegistry* getInstance(void);
+
+    Id intern(const QString& label);
+    Id find(const QString& label) const;
+
+    QString getLabel(Id id) const;
+
+    //! Number of distinct labels
+    int size(void) const;
+
+protected:
+    LabelRegistry();
+
+    mutable QReadWriteLock lock;
+
+    QHash<QString, Id> ids;
+
+    //! Label of each ID (the first is the invalid ID)
+    QVector<QString> labels;
+};
+
+
+#endif // LABEL_REGISTRY_HPP
@@ -1,16 +1,17 @@
 #include <qelapsedtimer.h>
 
 #include "lumberjack_debug.hpp"
-#include "lumberjack_settings.hpp"
 
 #include <stdio.h>
 #include <stddef.h>
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 void lumberjackDebugHandler(QtMsgType msgType, const QMessageLogContext& context, const QString& message);
 
 
-QList<LumberjackDebugMessage> messageBuffer;
+DebugMessageLog messageLog;
 QElapsedTimer debugTimer;
 
 
@@ -23,54 +24,221 @@ LumberjackDebugMessage::LumberjackDebugMessage(qint64 t, QtMsgType type, const Q
 }
 
 
-void lumberjackDebugHandler(QtMsgType msgType, const QMessageLogContext& context, const QString& message)
+DebugMessageLog::DebugMessageLog() :
+    buffer(new Slot[CAPACITY])
 {
-    Q_UNUSED(context)
-
-    // Construct and buffer a new debug message
-    messageBuffer.append(LumberjackDebugMessage(debugTimer.elapsed(), msgType, message));
+    for (auto &level : levels)
+    {
+        level.entries.reset(new LevelEntry[CAPACITY]);
+    }
 }
 
 
-void registerLumberjackDebugHandler()
+/**
+ * @brief DebugMessageLog::append - Add a message to the log (from any thread)
+ * @param timestamp - Time of the message (ms)
+ * @param type - Type of message
+ * @param message - Text of the message (truncated to MAX_MESSAGE_LENGTH characters)
+ */
+void DebugMessageLog::append(qint64 timestamp, QtMsgType type, const QString& message)
 {
-    debugTimer.restart();
-    qInstallMessageHandler(lumberjackDebugHandler);
+    const uint64_t sequence = head.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    Slot &slot = buffer[(sequence - 1) & (CAPACITY - 1)];
+
+    uint64_t current = slot.sequence.load(std::memory_order_acquire);
+
+    // Claim the slot (which may still be being written by a writer one lap behind)
+    for (;;)
+    {
+        // A newer message already occupies the slot
+        if (current != BUSY && current > sequence) return;
+
+        if (current == BUSY)
+        {
+            std::this_thread::yield();
+            current = slot.sequence.load(std::memory_order_acquire);
+            continue;
+        }
+
+        if (slot.sequence.compare_exchange_weak(current, BUSY, std::memory_order_acquire)) break;
+    }
+
+    slot.timestamp = timestamp;
+    slot.messageType = type;
+    slot.length = std::min<int>(message.length(), MAX_MESSAGE_LENGTH);
+
+    std::copy(message.constData(), message.constData() + slot.length, slot.text);
+
+    slot.sequence.store(sequence, std::memory_order_release);
+
+    // Record the message in the index of its type
+    if (type >= 0 && type < MESSAGE_TYPES)
+    {
+        Level &level = levels[type];
+
+        const uint64_t position = level.count.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+        LevelEntry &entry = level.entries[(position - 1) & (CAPACITY - 1)];
+
+        uint64_t recorded = entry.position.load(std::memory_order_acquire);
+
+        // Claim the entry, as for the slot (so a reader never pairs a position with the sequence of another lap)
+        for (;;)
+        {
+            if (recorded != BUSY && recorded > position) return;
+
+            if (recorded == BUSY)
+            {
+                std::this_thread::yield();
+                recorded = entry.position.load(std::memory_order_acquire);
+                continue;
+            }
+
+            if (entry.position.compare_exchange_weak(recorded, BUSY, std::memory_order_acquire)) break;
+        }
+
+        entry.sequence.store(sequence, std::memory_order_relaxed);
+        entry.position.store(position, std::memory_order_release);
+    }
 }
 
 
 /*
- * Return a list of debug messages according to the user specified filter
+ * Copy a single message from the buffer.
+ * Returns false if the message has been overwritten, or is being written.
  */
-QList<LumberjackDebugMessage> getLumberjackDebugMessages(qint64 tSince)
+bool DebugMessageLog::read(uint64_t sequence, LumberjackDebugMessage& message) const
 {
-    auto *settings = LumberjackSettings().getInstance();
+    const Slot &slot = buffer[(sequence - 1) & (CAPACITY - 1)];
+
+    if (slot.sequence.load(std::memory_order_acquire) != sequence) return false;
 
-    uint32_t mask = 0x00;
+    QChar text[MAX_MESSAGE_LENGTH];
 
-    // Construct the debug message mask
-    if (settings->loadBoolean("debug", "showInfo")) mask |= (1 << QtMsgType::QtInfoMsg);
-    if (settings->loadBoolean("debug", "showDebug")) mask |= (1 << QtMsgType::QtDebugMsg);
-    if (settings->loadBoolean("debug", "showWarning")) mask |= (1 << QtMsgType::QtWarningMsg);
-    if (settings->loadBoolean("debug", "showCritical")) mask |= (1 << QtMsgType::QtCriticalMsg);
-    if (settings->loadBoolean("debug", "showFatal")) mask |= (1 << QtMsgType::QtFatalMsg);
+    const qint64 timestamp = slot.timestamp;
+    const QtMsgType type = slot.messageType;
+    const int length = std::min(std::max(slot.length, 0), MAX_MESSAGE_LENGTH);
 
+    std::copy(slot.text, slot.text + length, text);
+
+    // Discard the copy if the slot was claimed by another message in the meantime
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) return false;
+
+    message.sequence = sequence;
+    message.timestamp = timestamp;
+    message.messageType = type;
+    message.message = QString(text, length);
+
+    return true;
+}
+
+
+/**
+ * @brief DebugMessageLog::getMessages - Return the messages of the selected types which have not yet been read
+ * @param cursor - Messages which have already been read (advanced past the returned messages)
+ * @param mask - Selected message types (bit N selects message type N)
+ * @return the messages, in sequence order
+ */
+QList<LumberjackDebugMessage> DebugMessageLog::getMessages(Cursor& cursor, uint32_t mask) const
+{
     QList<LumberjackDebugMessage> messages;
 
-    for (const auto &msg : messageBuffer)
+    const uint64_t floor = cleared.load(std::memory_order_acquire);
+
+    for (int type = 0; type < MESSAGE_TYPES; type++)
     {
-        // Ignore messages prior to a given timestamp
-        if (msg.timestamp <= tSince) continue;
+        if (!(mask & (1 << type))) continue;
 
-        uint32_t flag = 1 << msg.messageType;
-        if (mask & flag) messages.append(msg);
+        const Level &level = levels[type];
+
+        const uint64_t count = level.count.load(std::memory_order_acquire);
+
+        uint64_t position = cursor.levels[type];
+
+        // Entries older than the capacity have been overwritten
+        if (count > CAPACITY)
+        {
+            position = std::max<uint64_t>(position, count - CAPACITY);
+        }
+
+        for ( ; position < count; position++)
+        {
+            const LevelEntry &entry = level.entries[position & (CAPACITY - 1)];
+
+            const uint64_t recorded = entry.position.load(std::memory_order_acquire);
+
+            // Not yet recorded (or being written), so resume from here next time
+            if (recorded == BUSY || recorded < position + 1) break;
+
+            // Overwritten by a newer entry
+            if (recorded > position + 1) continue;
+
+            const uint64_t sequence = entry.sequence.load(std::memory_order_relaxed);
+
+            // Discard the sequence if the entry was claimed by a newer entry in the meantime
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (entry.position.load(std::memory_order_relaxed) != recorded) continue;
+
+            if (sequence <= floor) continue;
+
+            LumberjackDebugMessage message;
+
+            if (read(sequence, message))
+            {
+                messages.append(message);
+            }
+        }
+
+        cursor.levels[type] = position;
     }
 
+    std::sort(messages.begin(), messages.end(), [](const LumberjackDebugMessage &a, const LumberjackDebugMessage &b) {
+        return a.sequence < b.sequence;
+    });
+
     return messages;
 }
 
 
+/**
+ * @brief DebugMessageLog::clear - Discard every message appended so far
+ */
+void DebugMessageLog::clear()
+{
+    cleared.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+
+void lumberjackDebugHandler(QtMsgType msgType, const QMessageLogContext& context, const QString& message)
+{
+    Q_UNUSED(context)
+
+    // Buffer a new debug message (may be called from any thread)
+    messageLog.append(debugTimer.elapsed(), msgType, message);
+}
+
+
+void registerLumberjackDebugHandler()
+{
+    debugTimer.restart();
+    qInstallMessageHandler(lumberjackDebugHandler);
+}
+
+
+/*
+ * Return the debug messages of the selected types which are newer than the cursor
+ */
+QList<LumberjackDebugMessage> getLumberjackDebugMessages(DebugMessageLog::Cursor& cursor, uint32_t mask)
+{
+    return messageLog.getMessages(cursor, mask);
+}
+
+
 void clearLumberjackDebugMessages()
 {
-    messageBuffer.clear();
+    messageLog.clear();
 }
@@ -1,21 +1,128 @@
 #ifndef LUMBERJACK_DEBUG_HPP
 #define LUMBERJACK_DEBUG_HPP
 
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
 #include <qdebug.h>
 
 class LumberjackDebugMessage
 {
 public:
+    LumberjackDebugMessage() {}
     LumberjackDebugMessage(qint64 t, QtMsgType type, const QString& msg);
 
     qint64 timestamp = 0;
 
-    QtMsgType messageType;
+    //! Sequence number of the message (messages are numbered from 1)
+    uint64_t sequence = 0;
+
+    QtMsgType messageType = QtDebugMsg;
     QString message;
 };
 
+
+/**
+ * @brief The DebugMessageLog class retains the most recent debug messages, in a fixed-capacity ring buffer.
+ *
+ * Messages may be appended from any thread without taking a lock, and read (without being removed)
+ * from any other thread. Once the buffer is full, each message replaces the oldest message.
+ *
+ * The sequence number of each message is also recorded in a separate ring for each message type, so a
+ * reader can retrieve only the messages of selected types which it has not yet read (see Cursor),
+ * without visiting any other message.
+ *
+ * Each slot of the buffer (and each entry of the type rings) is guarded by a sequence lock: a reader copies
+ * the slot, and discards the copy if the slot was overwritten while it was copied. The text of each message is therefore held
+ * within the slot (longer messages are truncated to MAX_MESSAGE_LENGTH characters).
+ */
+class DebugMessageLog
+{
+public:
+    //! Number of messages retained (a power of two)
+    static constexpr size_t CAPACITY = 4096;
+
+    //! Maximum length of a message (characters)
+    static constexpr int MAX_MESSAGE_LENGTH = 256;
+
+    //! Number of message types (see QtMsgType)
+    static constexpr int MESSAGE_TYPES = QtInfoMsg + 1;
+
+    /**
+     * @brief The Cursor struct records the messages of each type which a reader has already read
+     */
+    struct Cursor
+    {
+        uint64_t levels[MESSAGE_TYPES] = {};
+    };
+
+    DebugMessageLog();
+
+    void append(qint64 timestamp, QtMsgType type, const QString& message);
+
+    QList<LumberjackDebugMessage> getMessages(Cursor& cursor, uint32_t mask) const;
+
+    //! Sequence number of the most recent message
+    uint64_t getLatestSequence(void) const { return head.load(std::memory_order_acquire); }
+
+    void clear(void);
+
+    //! Mask which selects every message type
+    static uint32_t getFullMask(void) { return (1 << MESSAGE_TYPES) - 1; }
+
+protected:
+    //! Sequence number of a slot which is being written
+    static constexpr uint64_t BUSY = UINT64_MAX;
+
+    struct Slot
+    {
+        //! Sequence number of the message held by the slot (zero if empty)
+        std::atomic<uint64_t> sequence{0};
+
+        qint64 timestamp = 0;
+        QtMsgType messageType = QtDebugMsg;
+
+        int length = 0;
+        QChar text[MAX_MESSAGE_LENGTH];
+    };
+
+    /**
+     * @brief The LevelEntry struct records the sequence number of a single message of one type
+     */
+    struct LevelEntry
+    {
+        //! Position of the entry within the messages of its type (from 1, zero if not yet recorded, BUSY while written)
+        std::atomic<uint64_t> position{0};
+
+        std::atomic<uint64_t> sequence{0};
+    };
+
+    struct Level
+    {
+        //! Number of messages of this type
+        std::atomic<uint64_t> count{0};
+
+        std::unique_ptr<LevelEntry[]> entries;
+    };
+
+    bool read(uint64_t sequence, LumberjackDebugMessage& message) const;
+
+    //! Sequence number of the most recent message
+    std::atomic<uint64_t> head{0};
+
+    //! Messages up to (and including) this sequence number have been cleared
+    std::atomic<uint64_t> cleared{0};
+
+    std::unique_ptr<Slot[]> buffer;
+
+    Level levels[MESSAGE_TYPES];
+};
+
+
 void registerLumberjackDebugHandler();
-QList<LumberjackDebugMessage> getLumberjackDebugMessages(qint64 tSince);
+QList<LumberjackDebugMessage> getLumberjackDebugMessages(DebugMessageLog::Cursor& cursor, uint32_t mask);
 void clearLumberjackDebugMessages();
 
 
@@ -1,19 +1,43 @@
 #include <QDir>
 #include <QApplication>
+#include <QScopedPointer>
 #include <qcommandlineparser.h>
 #include <qcommandlineoption.h>
 
 #include "lumberjack_debug.hpp"
 #include "lumberjack_version.hpp"
 #include "lumberjack_settings.hpp"
+#include "data_store.hpp"
+#include "batch_processor.hpp"
+#include "plugin_registry.hpp"
+#include "synthetic_generator.hpp"
 
 #include "mainwindow.h"
 
 
+/*
+ * A batch job (--batch) runs without the GUI, so it must be detected before the application is created
+ */
+static bool isBatchMode(int argc, char *argv[])
+{
+    for (int idx = 1; idx < argc; idx++)
+    {
+        const QString arg(argv[idx]);
+
+        if (arg == "--batch" || arg.startsWith("--batch=")) return true;
+    }
+
+    return false;
+}
+
+
 int main(int argc, char *argv[])
 {
+    const bool batch = isBatchMode(argc, argv);
+
+    QScopedPointer<QCoreApplication> app(batch ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
 
-    QApplication a(argc, argv);
+    QCoreApplication &a = *app;
 
     // Add custom plugin dirs
     QStringList pluginPaths = a.libraryPaths();
@@ -23,13 +47,15 @@ int main(int argc, char *argv[])
 
     a.setLibraryPaths(pluginPaths);
 
-    QString p = QDir::currentPath() + "/plugins";
-
     // Configure application properties
     a.setApplicationName("lumberjack");
-    a.setApplicationDisplayName("lumberjack");
     a.setApplicationVersion(getLumberjackVersion());
 
+    if (auto *gui = qobject_cast<QApplication*>(app.data()))
+    {
+        gui->setApplicationDisplayName("lumberjack");
+    }
+
     QCoreApplication::setApplicationName("Lumberjack");
     QCoreApplication::setApplicationVersion(getLumberjackVersion());
 
@@ -42,14 +68,38 @@ int main(int argc, char *argv[])
     // Command line options
     QCommandLineOption dummyDataOption(QStringList() << "d" << "dummy", "Load dummy test data");
     QCommandLineOption debugCmdOption(QStringList() << "c" << "Debug to command line");
+    QCommandLineOption scratchOption(QStringList() << "s" << "scratch", "Store sample data in a memory-mapped scratch file (for logs larger than memory)", "directory");
+    QCommandLineOption workspaceOption(QStringList() << "w" << "workspace", "Open a workspace file (.ljws)", "file");
+    QCommandLineOption batchOption(QStringList() << "batch", "Run a batch job (JSON) without the GUI and exit", "job");
+
+    // Synthetic datasets (for benchmarks and stress tests)
+    QCommandLineOption generateOption(QStringList() << "g" << "generate", "Write a synthetic log (.csv or .bin) and exit", "file");
+    QCommandLineOption syntheticOption(QStringList() << "synthetic", "Load a synthetic dataset");
+    QCommandLineOption channelsOption(QStringList() << "channels", "Number of synthetic channels", "count", "8");
+    QCommandLineOption rateOption(QStringList() << "rate", "Synthetic sample rate (Hz)", "rate", "100");
+    QCommandLineOption durationOption(QStringList() << "duration", "Synthetic duration (s)", "seconds", "60");
+    QCommandLineOption jitterOption(QStringList() << "jitter", "Synthetic timestamp jitter (fraction of the sample period)", "fraction", "0");
+    QCommandLineOption gapsOption(QStringList() << "gaps", "Fraction of the synthetic timeline within gaps", "fraction", "0");
+    QCommandLineOption gapLengthOption(QStringList() << "gap-length", "Length of each synthetic gap (s)", "seconds", "1");
+    QCommandLineOption outOfOrderOption(QStringList() << "out-of-order", "Fraction of synthetic samples out of order", "fraction", "0");
+    QCommandLineOption nanOption(QStringList() << "nans", "Fraction of synthetic values which are NaN", "fraction", "0");
+    QCommandLineOption shapeOption(QStringList() << "shape", "Synthetic signal shape (noise, sine, step or mixed)", "shape", "mixed");
+    QCommandLineOption seedOption(QStringList() << "seed", "Seed of the synthetic dataset", "seed", "1");
 
     parser.addPositionalArgument("files", "Load data files, optionally", "[files...]");
     parser.addOption(dummyDataOption);
     parser.addOption(debugCmdOption);
+    parser.addOption(scratchOption);
+    parser.addOption(workspaceOption);
+    parser.addOption(batchOption);
+
+    parser.addOptions({generateOption, syntheticOption, channelsOption, rateOption, durationOption, jitterOption,
+                       gapsOption, gapLengthOption, outOfOrderOption, nanOption, shapeOption, seedOption});
 
     parser.process(a);
 
-    if (!parser.isSet(debugCmdOption))
+    // Batch jobs always report to the command line
+    if (!batch && !parser.isSet(debugCmdOption))
     {
         // Install custom debug handler
         registerLumberjackDebugHandler();
@@ -57,13 +107,100 @@ int main(int argc, char *argv[])
 
     qDebug() << "Lumberjack:" << getLumberjackVersion();
 
+    if (parser.isSet(scratchOption))
+    {
+        auto store = std::make_shared<DataStore>(parser.value(scratchOption));
+
+        if (store->isValid())
+        {
+            qInfo() << "Storing sample data in" << store->getFileName();
+            DataStore::setDefault(store);
+        }
+    }
+
+    SyntheticGenerator::Options synthetic;
+
+    synthetic.channels = parser.value(channelsOption).toInt();
+    synthetic.rate = parser.value(rateOption).toDouble();
+    synthetic.duration = parser.value(durationOption).toDouble();
+    synthetic.jitter = parser.value(jitterOption).toDouble();
+    synthetic.gapFraction = parser.value(gapsOption).toDouble();
+    synthetic.gapLength = parser.value(gapLengthOption).toDouble();
+    synthetic.outOfOrderFraction = parser.value(outOfOrderOption).toDouble();
+    synthetic.nanFraction = parser.value(nanOption).toDouble();
+    synthetic.seed = parser.value(seedOption).toULongLong();
+
+    if (!SyntheticGenerator::parseShape(parser.value(shapeOption), synthetic.shape))
+    {
+        qCritical() << "Invalid shape:" << parser.value(shapeOption);
+        return 1;
+    }
+
+    if (parser.isSet(generateOption))
+    {
+        SyntheticGenerator generator(synthetic);
+        QStringList errors;
+
+        if (!generator.writeFile(parser.value(generateOption), errors))
+        {
+            qCritical() << errors.join("\n");
+            return 1;
+        }
+
+        qInfo() << "Wrote" << generator.getRowCount() << "rows of" << synthetic.channels << "channels to" << parser.value(generateOption);
+        return 0;
+    }
+
+    if (batch)
+    {
+        BatchProcessor::Job job;
+        QStringList errors;
+
+        if (!BatchProcessor::loadJob(parser.value(batchOption), job, errors))
+        {
+            qCritical().noquote() << errors.join("\n");
+            return 1;
+        }
+
+        for (const QString &error : errors)
+        {
+            qWarning().noquote() << error;
+        }
+
+        auto *registry = PluginRegistry::getInstance();
+
+        registry->loadPlugins();
+
+        int failed = 0;
+
+        {
+            BatchProcessor processor(registry->ImportPlugins(), registry->ExportPlugins());
+
+            for (const auto &result : processor.run(job))
+            {
+                if (!result.success) failed++;
+            }
+        }
+
+        PluginRegistry::cleanup();
+
+        qInfo().noquote() << QString("Processed %1 files (%2 failed)").arg(job.inputs.size()).arg(failed);
+
+        return failed > 0 ? 1 : 0;
+    }
+
     MainWindow w;
     w.show();
 
-    // Import data from specified files
-    for (auto file : parser.positionalArguments())
+    if (parser.isSet(workspaceOption))
     {
-        w.loadDataFromFile(file);
+        w.loadWorkspace(parser.value(workspaceOption));
+    }
+
+    // Import data from specified files (which are imported together)
+    if (!parser.positionalArguments().isEmpty())
+    {
+        w.loadDataFromFiles(parser.positionalArguments());
     }
 
     if (parser.isSet(dummyDataOption))
@@ -71,5 +208,10 @@ int main(int argc, char *argv[])
         w.loadDummyData();
     }
 
-    return a.exec();
+    if (parser.isSet(syntheticOption))
+    {
+        w.loadSyntheticData(synthetic);
+    }
+
+    return app->exec();
 }
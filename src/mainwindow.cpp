@@ -16,6 +16,10 @@
 #include "plot_curve.hpp"
 #include "data_series.hpp"
 #include "plot_widget.hpp"
+#include "plot_scheduler.hpp"
+#include "telemetry_source.hpp"
+#include "series_update_scheduler.hpp"
+#include "trace_recorder.hpp"
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
@@ -23,11 +27,22 @@
 #include "plugins_dialog.hpp"
 #include "about_dialog.hpp"
 #include "math_trace_dialog.hpp"
+#include "math_dependency_graph.hpp"
+#include "math_trace_cache.hpp"
+#include "math_data_source.hpp"
+#include "workspace_file.hpp"
+
+#ifdef LUMBERJACK_PYTHON
+#include "python_bridge.hpp"
+#endif
 
 #include "plugin_registry.hpp"
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QPluginLoader>
 
 
@@ -37,6 +52,9 @@ MainWindow::MainWindow(QWidget *parent)
 {
     ui->setupUi(this);
 
+    // Series updates are coalesced in the GUI thread
+    SeriesUpdateScheduler::getInstance();
+
     setWindowTitle("Lumberjack v" + getLumberjackVersion());
 
     initMenus();
@@ -54,6 +72,9 @@ MainWindow::MainWindow(QWidget *parent)
 
     loadWorkspaceSettings();
 
+    // Computed math traces are re-used across sessions
+    MathTraceCache::getInstance()->setEnabled(LumberjackSettings::getInstance()->loadBoolean("math", "cache", true));
+
     // Load plugins
     PluginRegistry::getInstance()->loadPlugins();
 }
@@ -61,11 +82,20 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+#ifdef LUMBERJACK_PYTHON
+    PythonBridge::finalize();
+#endif
+
     PluginRegistry::cleanup();
+    MathDependencyGraph::cleanup();
+    MathTraceCache::cleanup();
     DataSourceManager::cleanup();
     LumberjackSettings::cleanup();
 
     delete ui;
+
+    PlotReplotScheduler::cleanup();
+    SeriesUpdateScheduler::cleanup();
 }
 
 
@@ -147,6 +177,22 @@ void MainWindow::loadDummyData()
 }
 
 
+/*
+ * Load a synthetic dataset (e.g. to reproduce the scale of a large log)
+ */
+void MainWindow::loadSyntheticData(const SyntheticGenerator::Options &options)
+{
+    SyntheticGenerator generator(options);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    DataSourceManager::getInstance()->addSource(generator.createSource(QString("Synthetic %1").arg(options.seed)));
+
+    qInfo() << "Generated" << generator.getRowCount() << "rows of" << options.channels << "channels in" << timer.elapsed() << "ms";
+}
+
+
 /*
  * Load workspace settings
  */
@@ -169,10 +215,10 @@ void MainWindow::saveWorkspaceSettings()
 {
     auto *settings = LumberjackSettings::getInstance();
 
-    settings->saveSetting("mainwindow", "showDataView", dataView.isVisible());
-    settings->saveSetting("mainwindow", "showTimelineView", timelineView.isVisible());
-    settings->saveSetting("mainwindow", "showStatsView", statsView.isVisible());
-    settings->saveSetting("mainwindow", "showDebugView", debugWidget.isVisible());
+    settings->saveSetting("mainwindow", "showDataView", isViewVisible(dataView));
+    settings->saveSetting("mainwindow", "showTimelineView", isViewVisible(timelineView));
+    settings->saveSetting("mainwindow", "showStatsView", isViewVisible(statsView));
+    settings->saveSetting("mainwindow", "showDebugView", isViewVisible(debugWidget));
 
     settings->saveSetting("mainwindow", "state", saveState());
     settings->saveSetting("mainwindow", "geometry", saveGeometry());
@@ -187,27 +233,49 @@ void MainWindow::initMenus()
 {
     // File menu
     connect(ui->action_Import_Data, &QAction::triggered, this, &MainWindow::importData);
+    connect(ui->action_Receive_Telemetry, &QAction::triggered, this, &MainWindow::receiveTelemetry);
+    connect(ui->action_Open_Workspace, &QAction::triggered, this, &MainWindow::openWorkspace);
+    connect(ui->action_Save_Workspace, &QAction::triggered, this, &MainWindow::saveWorkspaceAs);
+    connect(ui->action_Run_Script, &QAction::triggered, this, &MainWindow::runScript);
     connect(ui->actionE_xit, &QAction::triggered, this, &QMainWindow::close);
 
     // View menu
     connect(ui->action_Data_View, &QAction::triggered, this, &MainWindow::toggleDataView);
     connect(ui->action_Timeline, &QAction::triggered, this, &MainWindow::toggleTimelineView);
     connect(ui->action_Statistics, &QAction::triggered, this, &MainWindow::toggleStatisticsView);
+    connect(ui->action_Histogram, &QAction::triggered, this, &MainWindow::toggleHistogramView);
+    connect(ui->action_Correlation, &QAction::triggered, this, &MainWindow::toggleCorrelationView);
     connect(ui->action_FFT, &QAction::triggered, this, &MainWindow::toggleFftView);
+    connect(ui->action_Spectrogram, &QAction::triggered, this, &MainWindow::toggleSpectrogramView);
 
     // Graphs menu
     connect(ui->action_Add_Graph, &QAction::triggered, this, &MainWindow::addPlot);
+    connect(ui->action_Fit_All_Graphs, &QAction::triggered, this, &MainWindow::fitAllPlots);
     connect(ui->action_Math_Trace, &QAction::triggered, this, &MainWindow::showMathTraceDialog);
 
     // Help menu
     connect(ui->action_About, &QAction::triggered, this, &MainWindow::showAboutInfo);
     connect(ui->action_Plugins, &QAction::triggered, this, &MainWindow::showPluginsInfo);
     connect(ui->action_Debug, &QAction::triggered, this, &MainWindow::toggleDebugView);
+    connect(ui->action_Record_Trace, &QAction::toggled, this, &MainWindow::setTraceRecording);
+    connect(ui->action_Save_Trace, &QAction::triggered, this, &MainWindow::saveTrace);
+
+#ifndef LUMBERJACK_PYTHON
+    // Python scripting is not built
+    ui->action_Run_Script->setVisible(false);
+#endif
+
+#ifdef LUMBERJACK_NO_TRACE
+    // Tracing is compiled out
+    ui->action_Record_Trace->setVisible(false);
+    ui->action_Save_Trace->setVisible(false);
+#endif
 }
 
 
 /**
- * @brief MainWindow::initDocks initializes the various dockable widgets
+ * @brief MainWindow::initDocks shows the docked views which were visible in the previous session
+ * (each view is only created when it is first shown)
  */
 void MainWindow::initDocks()
 {
@@ -242,17 +310,15 @@ void MainWindow::initDocks()
  */
 void MainWindow::initSignalsSlots()
 {
-    DataViewTree *tree = dataView.getTree();
-
-    if (tree)
-    {
-        connect(tree, &DataViewTree::onSeriesRemoved, this, &MainWindow::seriesRemoved);
-    }
+    // Imports run in the background
+    auto *manager = DataSourceManager::getInstance();
 
-    connect(&dataView, &DataviewWidget::fileDropped, this, &MainWindow::loadDataFromFile);
+    connect(manager, &DataSourceManager::importProgress, this, &MainWindow::updateImportProgress);
+    connect(manager, &DataSourceManager::importFinished, this, &MainWindow::onImportFinished);
 
-    // Timeline view
-    connect(&timelineView, &TimelineWidget::timeUpdated, this, &MainWindow::onTimescaleChanged);
+    // Exports also run in the background
+    connect(manager, &DataSourceManager::exportProgress, this, &MainWindow::updateExportProgress);
+    connect(manager, &DataSourceManager::exportFinished, this, &MainWindow::onExportFinished);
 
 }
 
@@ -272,6 +338,25 @@ void MainWindow::initStatusBar()
     ui->statusbar->addPermanentWidget(&y1_pos);
     ui->statusbar->addPermanentWidget(&y2_pos);
 
+    importProgress.setRange(0, 100);
+    importProgress.setMaximumWidth(150);
+    importProgress.setHidden(true);
+
+    ui->statusbar->addPermanentWidget(&importProgress);
+
+    importButton.setText(tr("Imports"));
+    importButton.setToolTip(tr("Show the progress of each file"));
+    importButton.setAutoRaise(true);
+    importButton.setHidden(true);
+
+    ui->statusbar->addPermanentWidget(&importButton);
+
+    connect(&importButton, &QToolButton::clicked, this, &MainWindow::showImportView);
+
+    // The progress of each import is displayed in a separate window
+    importView.setParent(this, Qt::Tool);
+    importView.hide();
+
     updateCursorPos(0, 0, 0);
 }
 
@@ -283,8 +368,6 @@ void MainWindow::onTimescaleChanged(const QwtInterval &viewInterval)
 {
     auto source = sender();
 
-    QList<DataSeriesPointer> seriesList;
-
     // Update the timescale on other plots
     for (auto plot : plots)
     {
@@ -294,28 +377,134 @@ void MainWindow::onTimescaleChanged(const QwtInterval &viewInterval)
         // Ignore plots which are not synced
         if (!plot->isTimescaleSynced()) continue;
 
-        auto curves = plot->getVisibleCurves();
+        // Prevent updating of same plot
+        if (plot == source) continue;
+
+        plot->setTimeInterval(viewInterval);
+    }
+
+    updateViews(viewInterval);
+}
+
+
+/*
+ * Update the docked views which follow the timescale. Hidden views are not updated
+ * (so no statistics or spectra are computed for them), but are refreshed when shown (see refreshViews)
+ */
+void MainWindow::updateViews(const QwtInterval &viewInterval)
+{
+    const bool stats = isViewVisible(statsView);
+    const bool timeline = isViewVisible(timelineView);
+    const bool histogram = isViewVisible(histogramView);
+
+    if (stats || timeline || histogram)
+    {
+        QList<DataSeriesPointer> seriesList;
 
-        for (auto curve : curves)
+        for (auto plot : plots)
         {
-            auto series = curve->getDataSeries();
+            if (plot.isNull() || !plot->isTimescaleSynced()) continue;
 
-            if (series.isNull()) continue;
+            for (auto curve : plot->getVisibleCurves())
+            {
+                auto series = curve->getDataSeries();
 
-            seriesList.append(series);
+                if (series.isNull()) continue;
+
+                seriesList.append(series);
+            }
         }
 
-        // Prevent updating of same plot
-        if (plot == source) continue;
+        // Update the "statistics" view
+        if (stats) statsView->updateStats(seriesList, viewInterval);
 
-        plot->setTimeInterval(viewInterval);
-    }
+        // Update the "histogram" view
+        if (histogram) histogramView->updateHistograms(seriesList, viewInterval);
 
-    // Update the "statistics" view
-    statsView.updateStats(seriesList, viewInterval);
+        // Outline the visible series on the timeline
+        if (timeline) timelineView->setSeries(seriesList);
+    }
 
     // Update the "fft" view
-    fftView.updateInterval(viewInterval);
+    if (isViewVisible(fftView)) fftView->updateInterval(viewInterval);
+
+    // Update the "spectrogram" view
+    if (isViewVisible(spectrogramView)) spectrogramView->updateInterval(viewInterval);
+
+    // Update the "correlation" view
+    if (isViewVisible(correlationView)) correlationView->updateInterval(viewInterval);
+}
+
+
+/*
+ * Bring the visible views up to date with the plots (e.g. when a view is shown)
+ */
+void MainWindow::refreshViews()
+{
+    if (plots.isEmpty() || plots.first().isNull()) return;
+
+    auto plot = plots.first();
+
+    const QwtInterval view = plot->axisInterval(QwtPlot::xBottom);
+
+    if (isViewVisible(timelineView))
+    {
+        bool ok_min = false;
+        bool ok_max = false;
+
+        const double t_min = plot->getOldestTimestamp(&ok_min);
+        const double t_max = plot->getNewestTimestamp(&ok_max);
+
+        if (ok_min && ok_max)
+        {
+            timelineView->updateTimeLimits(QwtInterval(t_min, t_max));
+        }
+
+        timelineView->updateViewLimits(view);
+    }
+
+    updateViews(view);
+}
+
+
+/*
+ * The timeline follows the view (and the extent) of each plot
+ */
+void MainWindow::connectTimeline(PlotWidget *plot)
+{
+    if (!timelineView || !plot) return;
+
+    connect(plot, &PlotWidget::viewChanged, timelineView, &TimelineWidget::updateViewLimits);
+    connect(plot, &PlotWidget::timestampLimitsChanged, timelineView, &TimelineWidget::updateTimeLimits);
+}
+
+
+/*
+ * Show a docked view, creating its dock when it is first shown (the dock is re-used when
+ * it is shown again, so its position is retained). The views are refreshed when the dock becomes visible
+ */
+void MainWindow::showDockedWidget(QWidget *widget, QString title, QString name, Qt::DockWidgetArea area, Qt::DockWidgetAreas allowed)
+{
+    for (auto *dock : findChildren<QDockWidget*>())
+    {
+        if (dock->widget() == widget)
+        {
+            dock->show();
+            dock->raise();
+            return;
+        }
+    }
+
+    QDockWidget *dock = new QDockWidget(title, this);
+    dock->setObjectName(name);
+    dock->setAllowedAreas(allowed);
+    dock->setWidget(widget);
+
+    connect(dock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) refreshViews();
+    });
+
+    addDockWidget(area, dock);
 }
 
 
@@ -365,6 +554,51 @@ void MainWindow::hideDifferences()
 }
 
 
+/**
+ * @brief MainWindow::updateImportProgress - callback to display the progress of a background import in the status bar
+ */
+void MainWindow::updateImportProgress(QString filename, int progress)
+{
+    auto *manager = DataSourceManager::getInstance();
+
+    const int count = manager->getImportFilenames().count();
+
+    // The total progress of every file being imported
+    importProgress.setHidden(false);
+    importProgress.setValue(count > 1 ? manager->getTotalImportProgress() : progress);
+    importProgress.setToolTip(count > 1 ? tr("Importing %1 files").arg(count) : tr("Importing") + " " + filename);
+
+    importButton.setHidden(false);
+}
+
+
+void MainWindow::onImportFinished(QString filename, bool result)
+{
+    if (!DataSourceManager::getInstance()->isImporting())
+    {
+        importProgress.setHidden(true);
+        importButton.setHidden(true);
+    }
+
+    ui->statusbar->showMessage((result ? tr("Imported") : tr("Import failed:")) + " " + filename, 5000);
+}
+
+
+/**
+ * @brief MainWindow::updateExportProgress - callback to display the progress of a background export in the status bar
+ */
+void MainWindow::updateExportProgress(QString filename, int progress)
+{
+    ui->statusbar->showMessage(tr("Exporting %1 (%2%)").arg(filename).arg(progress));
+}
+
+
+void MainWindow::onExportFinished(QString filename, bool result)
+{
+    ui->statusbar->showMessage((result ? tr("Exported") : tr("Export failed:")) + " " + filename, 5000);
+}
+
+
 /*
  * Display the "Plugins" dialog
  */
@@ -389,28 +623,75 @@ void MainWindow::showAboutInfo()
 /*
  * Toggle display of the "Debug" window
  */
-void MainWindow::toggleDebugView()
+void MainWindow::toggleDebugView(void)
 {
     ui->action_Debug->setCheckable(true);
 
-    if (debugWidget.isVisible())
+    if (isViewVisible(debugWidget))
     {
-        hideDockedWidget(&debugWidget);
+        hideDockedWidget(debugWidget);
+
         ui->action_Debug->setChecked(false);
     }
     else
     {
-        QDockWidget *dock = new QDockWidget(tr("Debug View"), this);
-        dock->setObjectName("debug-view");
-        dock->setAllowedAreas(Qt::AllDockWidgetAreas);
-        dock->setWidget(&debugWidget);
+        // The view is created when it is first shown
+        if (!debugWidget)
+        {
+            debugWidget = new DebugWidget();
+        }
+
+        showDockedWidget(debugWidget, tr("Debug View"), "debug-view", Qt::RightDockWidgetArea);
 
-        addDockWidget(Qt::RightDockWidgetArea, dock);
         ui->action_Debug->setChecked(true);
     }
 }
 
 
+/*
+ * Start (or stop) recording a trace of the hot paths (import, resampling, replotting, FFT, math and export)
+ */
+void MainWindow::setTraceRecording(bool enabled)
+{
+    auto *recorder = TraceRecorder::getInstance();
+
+    // Each recording starts a new trace
+    if (enabled && !recorder->isEnabled())
+    {
+        recorder->clear();
+    }
+
+    recorder->setEnabled(enabled);
+}
+
+
+/*
+ * Save the recorded trace as a Chrome trace (JSON), which can be opened by chrome://tracing or Perfetto
+ */
+void MainWindow::saveTrace()
+{
+    QString filename = QFileDialog::getSaveFileName(
+                this,
+                tr("Save Trace"),
+                "lumberjack_trace.json",
+                tr("Chrome trace (*.json)"));
+
+    if (filename.isEmpty()) return;
+
+    QStringList errors;
+
+    if (TraceRecorder::getInstance()->writeChromeTrace(filename, errors))
+    {
+        qInfo() << "Saved" << TraceRecorder::getInstance()->getEventCount() << "trace events to" << filename;
+    }
+
+    for (const QString &err : errors)
+    {
+        qWarning() << err;
+    }
+}
+
+
 
 /**
  * @brief MainWindow::loadDataFromFile - Load data from the provided file
@@ -423,6 +704,28 @@ void MainWindow::loadDataFromFile(QString filename)
 }
 
 
+/**
+ * @brief MainWindow::loadDataFromFiles - Load data from several files, which are imported together
+ * @param filenames
+ */
+void MainWindow::loadDataFromFiles(QStringList filenames)
+{
+    auto manager = DataSourceManager::getInstance();
+    manager->importFiles(filenames);
+}
+
+
+/*
+ * Display the progress of each file which is being imported
+ */
+void MainWindow::showImportView(void)
+{
+    importView.refresh();
+    importView.show();
+    importView.raise();
+}
+
+
 /*
  * Callback when the "import data" menu action is fired
  */
@@ -432,6 +735,274 @@ void MainWindow::importData()
 }
 
 
+/*
+ * Callback when the "open workspace" menu action is fired
+ */
+void MainWindow::openWorkspace()
+{
+    QString filename = QFileDialog::getOpenFileName(
+                this,
+                tr("Open Workspace"),
+                QString(),
+                tr("Lumberjack workspace (*.%1)").arg(WorkspaceFile::FILE_EXTENSION));
+
+    if (filename.isEmpty()) return;
+
+    loadWorkspace(filename);
+}
+
+
+/*
+ * Callback when the "save workspace" menu action is fired
+ */
+void MainWindow::saveWorkspaceAs()
+{
+    QString filename = QFileDialog::getSaveFileName(
+                this,
+                tr("Save Workspace"),
+                "workspace." + WorkspaceFile::FILE_EXTENSION,
+                tr("Lumberjack workspace (*.%1)").arg(WorkspaceFile::FILE_EXTENSION));
+
+    if (filename.isEmpty()) return;
+
+    saveWorkspace(filename);
+}
+
+
+/*
+ * Callback when the "receive live telemetry" menu action is fired.
+ * The source receives until it is removed from the data view
+ */
+void MainWindow::receiveTelemetry()
+{
+    auto *settings = LumberjackSettings::getInstance();
+
+    const QStringList protocols = {
+        TelemetrySource::getProtocolName(TelemetrySource::PROTOCOL_UDP),
+        TelemetrySource::getProtocolName(TelemetrySource::PROTOCOL_TCP),
+    };
+
+    bool ok = false;
+
+    const int previous = settings->loadSetting("telemetry", "protocol", TelemetrySource::PROTOCOL_UDP).toInt();
+
+    const QString protocol = QInputDialog::getItem(
+                this,
+                tr("Receive Live Telemetry"),
+                tr("Protocol"),
+                protocols,
+                qBound(0, previous, (int) protocols.size() - 1),
+                false,
+                &ok);
+
+    if (!ok) return;
+
+    const int port = QInputDialog::getInt(
+                this,
+                tr("Receive Live Telemetry"),
+                tr("Port"),
+                settings->loadSetting("telemetry", "port", TelemetrySource::DEFAULT_PORT).toInt(),
+                1, 65535, 1,
+                &ok);
+
+    if (!ok) return;
+
+    const int p = protocols.indexOf(protocol);
+
+    settings->saveSetting("telemetry", "protocol", p);
+    settings->saveSetting("telemetry", "port", port);
+
+    auto source = QSharedPointer<TelemetrySource>::create(p, (quint16) port);
+
+    QStringList errors;
+
+    if (!source->start(errors))
+    {
+        QMessageBox::warning(this, tr("Receive Live Telemetry"), errors.join("\n"));
+        return;
+    }
+
+    DataSourceManager::getInstance()->addSource(source);
+}
+
+
+/*
+ * Callback when the "run script" menu action is fired
+ */
+void MainWindow::runScript()
+{
+#ifdef LUMBERJACK_PYTHON
+    QString filename = QFileDialog::getOpenFileName(
+                this,
+                tr("Run Python Script"),
+                QString(),
+                tr("Python script (*.py)"));
+
+    if (filename.isEmpty()) return;
+
+    QStringList errors;
+
+    if (!PythonBridge::runScript(filename, errors))
+    {
+        QMessageBox::warning(this, tr("Run Python Script"), errors.join("\n"));
+    }
+#endif
+}
+
+
+/**
+ * @brief MainWindow::loadWorkspace - Replace the current session with a workspace (see WorkspaceFile).
+ * The samples of each series are read from the workspace when the series is first plotted
+ * @param filename is the workspace file
+ * @return true if the workspace was opened
+ */
+bool MainWindow::loadWorkspace(QString filename)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    WorkspaceFile::Workspace workspace;
+    QStringList errors;
+
+    const bool result = WorkspaceFile::load(filename, workspace, errors);
+
+    for (const QString &err : errors)
+    {
+        qWarning() << err;
+    }
+
+    if (!result)
+    {
+        QMessageBox::warning(this, tr("Open Workspace"), errors.join("\n"));
+        return false;
+    }
+
+    auto *manager = DataSourceManager::getInstance();
+    auto *math = MathDataSource::getInstance();
+
+    // Discard the current session (plots cannot be removed, so they are cleared)
+    for (auto plot : plots)
+    {
+        if (plot.isNull()) continue;
+
+        plot->removeAllMarkers();
+        plot->removeAllSeries();
+    }
+
+    for (int idx = 0; idx < manager->getSourceCount(); idx++)
+    {
+        auto source = manager->getSourceByIndex(idx);
+
+        for (int jj = 0; !source.isNull() && jj < source->getSeriesCount(); jj++)
+        {
+            seriesRemoved(source->getSeriesByIndex(jj));
+        }
+    }
+
+    for (const QString &label : math->getSeriesLabels())
+    {
+        math->removeMathSeries(label);
+    }
+
+    manager->removeAllSources(false);
+
+    for (const auto &source : workspace.sources)
+    {
+        manager->addSource(source);
+    }
+
+    // Re-register the math source, which was removed along with the others
+    math = MathDataSource::getInstance();
+
+    for (const auto &trace : workspace.mathTraces)
+    {
+        // Math series are assigned a color when they are added
+        const QColor color = trace->getColor();
+
+        math->addMathSeries(trace);
+        trace->setColor(color);
+    }
+
+    while (plots.count() < workspace.plots.count())
+    {
+        addPlot();
+    }
+
+    for (int idx = 0; idx < workspace.plots.count(); idx++)
+    {
+        plots[idx]->restoreWorkspaceState(workspace.plots[idx]);
+    }
+
+    restoreState(workspace.windowState);
+
+    manager->update();
+
+    qInfo() << "Opened workspace" << filename << "in" << timer.elapsed() << "ms";
+
+    return true;
+}
+
+
+/**
+ * @brief MainWindow::saveWorkspace - Store the current session in a workspace file (see WorkspaceFile)
+ * @param filename is the workspace file
+ * @return true if the workspace was written
+ */
+bool MainWindow::saveWorkspace(QString filename)
+{
+    WorkspaceFile::Workspace workspace;
+
+    auto *manager = DataSourceManager::getInstance();
+    auto *math = MathDataSource::getInstance();
+
+    for (int idx = 0; idx < manager->getSourceCount(); idx++)
+    {
+        auto source = manager->getSourceByIndex(idx);
+
+        if (source.isNull() || source.data() == math) continue;
+
+        workspace.sources.append(source);
+    }
+
+    workspace.mathSource = math->getLabel();
+
+    for (const QString &label : math->getSeriesLabels())
+    {
+        auto trace = math->getMathSeries(label);
+
+        if (trace) workspace.mathTraces.append(trace);
+    }
+
+    for (auto plot : plots)
+    {
+        if (plot.isNull()) continue;
+
+        workspace.plots.append(plot->getWorkspaceState());
+    }
+
+    workspace.windowState = saveState();
+
+    QStringList errors;
+
+    const bool result = WorkspaceFile::save(filename, workspace, errors);
+
+    for (const QString &err : errors)
+    {
+        qWarning() << err;
+    }
+
+    if (!result)
+    {
+        QMessageBox::warning(this, tr("Save Workspace"), errors.join("\n"));
+        return false;
+    }
+
+    qInfo() << "Saved workspace" << filename;
+
+    return true;
+}
+
+
 void MainWindow::hideDockedWidget(QWidget *widget)
 {
     for (auto *dock : findChildren<QDockWidget*>())
@@ -458,6 +1029,16 @@ void MainWindow::seriesRemoved(DataSeriesPointer series)
 
         plot->removeSeries(series);
     }
+
+    if (spectrogramView)
+    {
+        spectrogramView->removeSeries(series);
+    }
+
+    if (correlationView)
+    {
+        correlationView->removeSeries(series);
+    }
 }
 
 
@@ -504,9 +1085,8 @@ void MainWindow::addPlot()
     connect(plot, &PlotWidget::markerAdded, this, &MainWindow::updateDifferences);
     connect(plot, &PlotWidget::markersRemoved, this, &MainWindow::hideDifferences);
     connect(plot, &PlotWidget::viewChanged, this, &MainWindow::onTimescaleChanged);
-    connect(plot, &PlotWidget::viewChanged, &timelineView, &TimelineWidget::updateViewLimits);
-    connect(plot, &PlotWidget::timestampLimitsChanged, &timelineView, &TimelineWidget::updateTimeLimits);
-    connect(plot, &PlotWidget::fileDropped, this, &MainWindow::loadDataFromFile);
+    connectTimeline(plot);
+    connect(plot, &PlotWidget::filesDropped, this, &MainWindow::loadDataFromFiles);
 
     plots.append(QSharedPointer<PlotWidget>(plot));
 
@@ -514,6 +1094,43 @@ void MainWindow::addPlot()
 }
 
 
+/*
+ * Fit every plot to its data.
+ * The bounds of every series (across all plots) are first computed together on the thread pool,
+ * so each plot then combines the cached bounds of its curves.
+ */
+void MainWindow::fitAllPlots()
+{
+    std::vector<DataSeriesPointer> series;
+
+    QSet<const DataSeries*> found;
+
+    for (auto plot : plots)
+    {
+        if (plot.isNull()) continue;
+
+        for (auto curve : plot->getVisibleCurves())
+        {
+            auto s = curve->getDataSeries();
+
+            if (s.isNull() || found.contains(s.data())) continue;
+
+            found.insert(s.data());
+            series.push_back(s);
+        }
+    }
+
+    PlotWidget::getSeriesBounds(series);
+
+    for (auto plot : plots)
+    {
+        if (plot.isNull()) continue;
+
+        plot->autoScale();
+    }
+}
+
+
 /*
  * Remove the specified plot from the display
  */
@@ -528,21 +1145,51 @@ void MainWindow::toggleFftView(void)
 {
     ui->action_FFT->setCheckable(true);
 
-    if (fftView.isVisible())
+    if (isViewVisible(fftView))
     {
-        hideDockedWidget(&fftView);
+        hideDockedWidget(fftView);
+
         ui->action_FFT->setChecked(false);
     }
     else
     {
-        QDockWidget* dock = new QDockWidget(tr("FFT View"), this);
-        dock->setObjectName("fft-view");
-        dock->setAllowedAreas(Qt::AllDockWidgetAreas);
-        dock->setWidget(&fftView);
+        // The view is created when it is first shown
+        if (!fftView)
+        {
+            fftView = new FFTWidget();
+        }
 
-        addDockWidget(Qt::LeftDockWidgetArea, dock);
+        showDockedWidget(fftView, tr("FFT View"), "fft-view", Qt::LeftDockWidgetArea);
 
-        ui->action_Data_View->setChecked(true);
+        ui->action_FFT->setChecked(true);
+    }
+}
+
+
+/**
+ * @brief MainWindow::toggleSpectrogramView toggles visibility of the "spectrogram" dock
+ */
+void MainWindow::toggleSpectrogramView(void)
+{
+    ui->action_Spectrogram->setCheckable(true);
+
+    if (isViewVisible(spectrogramView))
+    {
+        hideDockedWidget(spectrogramView);
+
+        ui->action_Spectrogram->setChecked(false);
+    }
+    else
+    {
+        // The view is created when it is first shown
+        if (!spectrogramView)
+        {
+            spectrogramView = new SpectrogramWidget();
+        }
+
+        showDockedWidget(spectrogramView, tr("Spectrogram"), "spectrogram-view", Qt::LeftDockWidgetArea);
+
+        ui->action_Spectrogram->setChecked(true);
     }
 }
 
@@ -554,20 +1201,24 @@ void MainWindow::toggleDataView(void)
 {
     ui->action_Data_View->setCheckable(true);
 
-    if (dataView.isVisible())
+    if (isViewVisible(dataView))
     {
-        hideDockedWidget(&dataView);
+        hideDockedWidget(dataView);
 
         ui->action_Data_View->setChecked(false);
     }
     else
     {
-        QDockWidget* dock = new QDockWidget(tr("Data View"), this);
-        dock->setObjectName("data-view");
-        dock->setAllowedAreas(Qt::AllDockWidgetAreas);
-        dock->setWidget(&dataView);
+        // The view is created when it is first shown
+        if (!dataView)
+        {
+            dataView = new DataviewWidget();
 
-        addDockWidget(Qt::LeftDockWidgetArea, dock);
+            connect(dataView->getTree(), &DataViewTree::onSeriesRemoved, this, &MainWindow::seriesRemoved);
+            connect(dataView, &DataviewWidget::filesDropped, this, &MainWindow::loadDataFromFiles);
+        }
+
+        showDockedWidget(dataView, tr("Data View"), "data-view", Qt::LeftDockWidgetArea);
 
         ui->action_Data_View->setChecked(true);
     }
@@ -581,20 +1232,28 @@ void MainWindow::toggleTimelineView(void)
 {
     ui->action_Timeline->setCheckable(true);
 
-    if (timelineView.isVisible())
+    if (isViewVisible(timelineView))
     {
-        hideDockedWidget(&timelineView);
+        hideDockedWidget(timelineView);
 
         ui->action_Timeline->setChecked(false);
     }
     else
     {
-        QDockWidget* dock = new QDockWidget(tr("Timeline"), this);
-        dock->setObjectName("timeline-view");
-        dock->setAllowedAreas(Qt::TopDockWidgetArea | Qt::BottomDockWidgetArea);
-        dock->setWidget(&timelineView);
+        // The view is created when it is first shown
+        if (!timelineView)
+        {
+            timelineView = new TimelineWidget();
+
+            connect(timelineView, &TimelineWidget::timeUpdated, this, &MainWindow::onTimescaleChanged);
+
+            for (auto plot : plots)
+            {
+                connectTimeline(plot.data());
+            }
+        }
 
-        addDockWidget(Qt::BottomDockWidgetArea, dock);
+        showDockedWidget(timelineView, tr("Timeline"), "timeline-view", Qt::BottomDockWidgetArea, Qt::TopDockWidgetArea | Qt::BottomDockWidgetArea);
 
         ui->action_Timeline->setChecked(true);
     }
@@ -608,25 +1267,82 @@ void MainWindow::toggleStatisticsView(void)
 {
     ui->action_Statistics->setCheckable(true);
 
-    if (statsView.isVisible())
+    if (isViewVisible(statsView))
     {
-        hideDockedWidget(&statsView);
+        hideDockedWidget(statsView);
 
         ui->action_Statistics->setChecked(false);
     }
     else
     {
-        QDockWidget *dock = new QDockWidget(tr("Stats View"), this);
-        dock->setObjectName("stats-view");
-        dock->setAllowedAreas(Qt::AllDockWidgetAreas);
-        dock->setWidget(&statsView);
+        // The view is created when it is first shown
+        if (!statsView)
+        {
+            statsView = new StatsWidget();
+        }
 
-        addDockWidget(Qt::LeftDockWidgetArea, dock);
+        showDockedWidget(statsView, tr("Stats View"), "stats-view", Qt::LeftDockWidgetArea);
 
         ui->action_Statistics->setChecked(true);
     }
 }
 
+
+/**
+ * @brief MainWindow::toggleHistogramView toggles visibility of the "histogram" dock
+ */
+void MainWindow::toggleHistogramView(void)
+{
+    ui->action_Histogram->setCheckable(true);
+
+    if (isViewVisible(histogramView))
+    {
+        hideDockedWidget(histogramView);
+
+        ui->action_Histogram->setChecked(false);
+    }
+    else
+    {
+        // The view is created when it is first shown
+        if (!histogramView)
+        {
+            histogramView = new HistogramWidget();
+        }
+
+        showDockedWidget(histogramView, tr("Histogram"), "histogram-view", Qt::LeftDockWidgetArea);
+
+        ui->action_Histogram->setChecked(true);
+    }
+}
+
+
+/**
+ * @brief MainWindow::toggleCorrelationView toggles visibility of the "correlation" dock
+ */
+void MainWindow::toggleCorrelationView(void)
+{
+    ui->action_Correlation->setCheckable(true);
+
+    if (isViewVisible(correlationView))
+    {
+        hideDockedWidget(correlationView);
+
+        ui->action_Correlation->setChecked(false);
+    }
+    else
+    {
+        // The view is created when it is first shown
+        if (!correlationView)
+        {
+            correlationView = new CorrelationWidget();
+        }
+
+        showDockedWidget(correlationView, tr("Correlation"), "correlation-view", Qt::LeftDockWidgetArea);
+
+        ui->action_Correlation->setChecked(true);
+    }
+}
+
 void MainWindow::showMathTraceDialog()
 {
     MathTraceDialog dialog(this);
@@ -3,15 +3,22 @@
 
 #include <QMainWindow>
 #include <qlabel.h>
+#include <qprogressbar.h>
+#include <qtoolbutton.h>
 
 #include "data_series.hpp"
+#include "synthetic_generator.hpp"
 
 #include "debug_widget.hpp"
 #include "plot_widget.hpp"
 #include "fft_widget.hpp"
+#include "spectrogram_widget.hpp"
+#include "histogram_widget.hpp"
+#include "correlation_widget.hpp"
 #include "stats_widget.hpp"
 #include "dataview_widget.hpp"
 #include "timeline_widget.hpp"
+#include "import_progress_widget.hpp"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -26,6 +33,7 @@ public:
     ~MainWindow();
 
     void loadDummyData(void);
+    void loadSyntheticData(const SyntheticGenerator::Options &options);
 
 public slots:
 
@@ -34,6 +42,15 @@ public slots:
     void updateDifferences(double dt, double dy);
     void hideDifferences();
     void loadDataFromFile(QString filename = QString());
+    void loadDataFromFiles(QStringList filenames);
+
+    bool loadWorkspace(QString filename);
+    bool saveWorkspace(QString filename);
+
+    void updateImportProgress(QString filename, int progress);
+    void onImportFinished(QString filename, bool result);
+    void updateExportProgress(QString filename, int progress);
+    void onExportFinished(QString filename, bool result);
 
 protected:
     void initMenus(void);
@@ -52,15 +69,28 @@ protected slots:
     void showPluginsInfo(void);
 
     void importData(void);
+    void receiveTelemetry(void);
+
+    void openWorkspace(void);
+    void saveWorkspaceAs(void);
+
+    void runScript(void);
 
     void toggleDebugView(void);
+    void setTraceRecording(bool enabled);
+    void saveTrace(void);
+    void showImportView(void);
     void toggleDataView(void);
     void toggleFftView(void);
+    void toggleSpectrogramView(void);
     void toggleTimelineView(void);
     void toggleStatisticsView(void);
+    void toggleHistogramView(void);
+    void toggleCorrelationView(void);
 
     void addPlot();
     void removePlot(QSharedPointer<PlotWidget> plot);
+    void fitAllPlots(void);
 
     void showMathTraceDialog(void);
 
@@ -80,11 +110,31 @@ private:
     QLabel dt_pos;
     QLabel dy_pos;
 
-    DataviewWidget dataView;
-    StatsWidget statsView;
-    TimelineWidget timelineView;
-    FFTWidget fftView;
+    //! Progress of the running import(s)
+    QProgressBar importProgress;
+
+    //! Displays the progress of each file (see importView)
+    QToolButton importButton;
+
+    ImportProgressWidget importView;
+
+    //! Docked views are created when they are first shown (and are owned by their dock)
+    DataviewWidget *dataView = nullptr;
+    StatsWidget *statsView = nullptr;
+    TimelineWidget *timelineView = nullptr;
+    FFTWidget *fftView = nullptr;
+    SpectrogramWidget *spectrogramView = nullptr;
+    HistogramWidget *histogramView = nullptr;
+    CorrelationWidget *correlationView = nullptr;
+
+    DebugWidget *debugWidget = nullptr;
+
+    static bool isViewVisible(const QWidget *widget) { return widget && widget->isVisible(); }
+
+    void showDockedWidget(QWidget *widget, QString title, QString name, Qt::DockWidgetArea area, Qt::DockWidgetAreas allowed = Qt::AllDockWidgetAreas);
+    void connectTimeline(PlotWidget *plot);
 
-    DebugWidget debugWidget;
+    void updateViews(const QwtInterval &view);
+    void refreshViews(void);
 };
 #endif // MAINWINDOW_H
@@ -21,3 +21,25 @@ DataSeriesPointer MathDataSeries::getInputSeries(const QString& variable) const
     }
     return DataSeriesPointer();
 }
+
+void MathDataSeries::setInputSnapshots(const QMap<QString, DataSnapshot>& snapshots, double gapSize)
+{
+    QMutexLocker locker(&inputMutex);
+
+    inputSnapshots = snapshots;
+    maxGapSize = gapSize;
+}
+
+QMap<QString, DataSnapshot> MathDataSeries::getInputSnapshots() const
+{
+    QMutexLocker locker(&inputMutex);
+
+    return inputSnapshots;
+}
+
+double MathDataSeries::getMaxGapSize() const
+{
+    QMutexLocker locker(&inputMutex);
+
+    return maxGapSize;
+}
@@ -3,6 +3,7 @@
 
 #include "data_series.hpp"
 #include <QMap>
+#include <QMutex>
 
 /**
  * @brief The MathDataSeries class represents a computed data series
@@ -51,12 +52,43 @@ public:
      */
     bool isComputed() const { return true; }
 
+    /**
+     * @brief Lazy series are not computed in full: only the samples which are plotted
+     * are evaluated, for the visible timespan and resolution (see MathCurveUpdater)
+     */
+    bool isLazy() const { return lazy; }
+    void setLazy(bool on) { lazy = on; }
+
+    /**
+     * @brief Record the input snapshots from which the current samples were computed
+     * @param snapshots Snapshot of each input series (by variable name), or empty if the samples are not valid
+     * @param maxGapSize Maximum gap (in ms) which was interpolated across
+     */
+    void setInputSnapshots(const QMap<QString, DataSnapshot>& snapshots, double maxGapSize);
+
+    /**
+     * @brief Get the input snapshots from which the current samples were computed
+     * @return Snapshot of each input series (empty if the series has not been computed)
+     */
+    QMap<QString, DataSnapshot> getInputSnapshots() const;
+
+    double getMaxGapSize() const;
+
 private:
     //! The mathematical expression used to compute this series
     QString mathExpression;
 
     //! Map of variable names to input series
     QMap<QString, DataSeriesPointer> inputSeries;
+
+    mutable QMutex inputMutex;
+
+    //! Input snapshots of the most recent (successful) computation
+    QMap<QString, DataSnapshot> inputSnapshots;
+
+    double maxGapSize = 1000.0;
+
+    bool lazy = false;
 };
 
 typedef QSharedPointer<MathDataSeries> MathDataSeriesPointer;
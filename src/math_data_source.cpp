@@ -1,5 +1,6 @@
 #include "math_data_source.hpp"
 #include "data_source_manager.hpp"
+#include "math_dependency_graph.hpp"
 
 // Initialize static instance
 MathDataSource* MathDataSource::instance = nullptr;
@@ -39,11 +40,26 @@ bool MathDataSource::addMathSeries(MathDataSeriesPointer series)
     }
 
     // Use the base class method to add the series
-    return addSeries(series, true);  // auto_color = true
+    if (!addSeries(series, true))  // auto_color = true
+    {
+        return false;
+    }
+
+    // The series follows changes to its inputs
+    MathDependencyGraph::getInstance()->addSeries(series);
+
+    return true;
 }
 
 bool MathDataSource::removeMathSeries(const QString& label)
 {
+    MathDataSeriesPointer series = getMathSeries(label);
+
+    if (series)
+    {
+        MathDependencyGraph::getInstance()->removeSeries(series.data());
+    }
+
     return removeSeriesByLabel(label, true);
 }
 
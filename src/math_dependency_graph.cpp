@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "math_dependency_graph.hpp"
+#include "math_trace_computer.hpp"
+
+
+MathDependencyGraph* MathDependencyGraph::instance = nullptr;
+
+const int MathDependencyGraph::UPDATE_INTERVAL;
+
+
+MathDependencyGraph::MathDependencyGraph() : QObject()
+{
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(UPDATE_INTERVAL);
+
+    connect(&updateTimer, &QTimer::timeout, this, &MathDependencyGraph::update);
+}
+
+
+/*
+ * Follow the inputs of a math trace. The series is only recomputed once it has been computed
+ * in full (see MathDataSeries::getInputSnapshots).
+ */
+void MathDependencyGraph::addSeries(MathDataSeriesPointer series)
+{
+    if (series.isNull()) return;
+
+    removeSeries(series.data());
+
+    nodes.append(series.toWeakRef());
+
+    const auto mapping = series->getVariableMapping();
+
+    for (auto it = mapping.begin(); it != mapping.end(); ++it)
+    {
+        const DataSeriesPointer& input = it.value();
+
+        if (input.isNull()) continue;
+
+        // Inputs may be shared between many math traces
+        connect(input.data(), &DataSeries::dataUpdated, this, &MathDependencyGraph::onInputUpdated, Qt::UniqueConnection);
+    }
+}
+
+
+void MathDependencyGraph::removeSeries(const MathDataSeries* series)
+{
+    for (int ii = nodes.size() - 1; ii >= 0; ii--)
+    {
+        auto node = nodes[ii].toStrongRef();
+
+        if (node.isNull() || node.data() == series)
+        {
+            nodes.removeAt(ii);
+        }
+    }
+
+    stale.remove(series);
+}
+
+
+void MathDependencyGraph::onInputUpdated()
+{
+    if (updating) return;
+
+    invalidate(qobject_cast<const DataSeries*>(sender()));
+}
+
+
+/*
+ * Mark every series which depends on the specified series (directly or indirectly) as stale,
+ * and schedule an update (further changes before the update are coalesced).
+ */
+void MathDependencyGraph::invalidate(const DataSeries* series)
+{
+    if (series == nullptr) return;
+
+    QList<const DataSeries*> changed;
+
+    changed.append(series);
+
+    while (!changed.isEmpty())
+    {
+        const DataSeries* source = changed.takeLast();
+
+        for (const auto& node : nodes)
+        {
+            auto dependent = node.toStrongRef();
+
+            if (dependent.isNull() || stale.contains(dependent.data())) continue;
+
+            const auto mapping = dependent->getVariableMapping();
+
+            for (auto it = mapping.begin(); it != mapping.end(); ++it)
+            {
+                if (it.value().data() == source)
+                {
+                    stale.insert(dependent.data());
+                    changed.append(dependent.data());
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!stale.isEmpty() && !updateTimer.isActive())
+    {
+        updateTimer.start();
+    }
+}
+
+
+/*
+ * Recompute every stale series. Inputs are recomputed before the series which depend on them.
+ */
+void MathDependencyGraph::update()
+{
+    updateTimer.stop();
+
+    if (stale.isEmpty()) return;
+
+    const auto order = getUpdateOrder();
+
+    updating = true;
+
+    for (const auto& series : order)
+    {
+        if (stale.contains(series.data()))
+        {
+            updateSeries(series);
+        }
+    }
+
+    updating = false;
+
+    stale.clear();
+}
+
+
+/*
+ * Order the registered series such that each series follows any math traces it depends on
+ */
+QList<MathDataSeriesPointer> MathDependencyGraph::getUpdateOrder()
+{
+    QList<MathDataSeriesPointer> order;
+    QSet<const DataSeries*> visited;
+
+    std::function<void(const MathDataSeriesPointer&)> visit = [&](const MathDataSeriesPointer& series) {
+        if (visited.contains(series.data())) return;
+
+        visited.insert(series.data());
+
+        const auto mapping = series->getVariableMapping();
+
+        for (auto it = mapping.begin(); it != mapping.end(); ++it)
+        {
+            for (const auto& node : nodes)
+            {
+                auto input = node.toStrongRef();
+
+                if (!input.isNull() && input.data() == it.value().data()) visit(input);
+            }
+        }
+
+        order.append(series);
+    };
+
+    for (const auto& node : nodes)
+    {
+        auto series = node.toStrongRef();
+
+        if (!series.isNull()) visit(series);
+    }
+
+    return order;
+}
+
+
+/*
+ * Recompute the points of a series which may have changed since it was last computed
+ */
+bool MathDependencyGraph::updateSeries(MathDataSeriesPointer series)
+{
+    const auto previous = series->getInputSnapshots();
+
+    // The series has not been computed (or is still being computed)
+    if (previous.isEmpty()) return false;
+
+    const auto mapping = series->getVariableMapping();
+
+    double t_start = std::numeric_limits<double>::infinity();
+
+    for (auto it = mapping.begin(); it != mapping.end(); ++it)
+    {
+        if (it.value().isNull() || !previous.contains(it.key())) return false;
+
+        t_start = std::min(t_start, getChangedTime(it.value()->getSnapshot(), previous[it.key()]));
+    }
+
+    // None of the inputs have changed
+    if (t_start == std::numeric_limits<double>::infinity()) return false;
+
+    MathTraceComputer computer;
+
+    computer.compute(series->getExpression(), mapping, series, series->getMaxGapSize(), t_start);
+    computer.startComputation();
+
+    return true;
+}
+
+
+/**
+ * @brief MathDependencyGraph::getChangedTime - Find the time from which a series may have changed
+ *
+ * Interpolation at a timestamp depends on the samples either side of it, so points of a math trace
+ * are unchanged up to (but not including) the last sample which is common to both snapshots.
+ *
+ * @param current is the current snapshot of an input series
+ * @param previous is the snapshot from which the math trace was computed
+ * @return the earliest time which must be recomputed (+inf if unchanged, -inf if the whole series must be recomputed)
+ */
+double MathDependencyGraph::getChangedTime(const DataSnapshot& current, const DataSnapshot& previous)
+{
+    const bool scaled = current.getScaler() == previous.getScaler() && current.getOffset() == previous.getOffset();
+
+    if (!scaled) return -std::numeric_limits<double>::infinity();
+
+    if (current.isIdentical(previous)) return std::numeric_limits<double>::infinity();
+
+    uint64_t idx_first = 0;
+    uint64_t idx_last = 0;
+
+    // Samples inserted before the common range (or no samples in common)
+    if (!current.getCommonRange(previous, idx_first, idx_last) || idx_first > 0)
+    {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    return current.getTimestamp(idx_last - 1);
+}
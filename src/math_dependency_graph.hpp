@@ -0,0 +1,89 @@
+#ifndef MATH_DEPENDENCY_GRAPH_HPP
+#define MATH_DEPENDENCY_GRAPH_HPP
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QWeakPointer>
+
+#include "math_data_series.hpp"
+
+
+/*
+ * Keeps math traces up to date as their input series change.
+ *
+ * Each MathDataSeries depends on its input series, which may themselves be math traces
+ * (e.g. c = a - b; d = abs(c)). When an input is updated, every series which depends on it
+ * (directly or through other math traces) is marked as stale. Stale series are recomputed
+ * together, shortly afterwards, in dependency order - so a burst of live data results in a
+ * single recomputation of each series.
+ *
+ * Only the affected part of each series is recomputed: if samples have been appended to an
+ * input, points are evaluated from the last sample which the inputs have in common with the
+ * previous computation. A change to the scaling of an input recomputes the whole series.
+ */
+class MathDependencyGraph : public QObject
+{
+    Q_OBJECT
+
+    static MathDependencyGraph* instance;
+
+public:
+    MathDependencyGraph();
+
+    // Singleton design pattern
+    static MathDependencyGraph* getInstance()
+    {
+        if (!instance)
+        {
+            instance = new MathDependencyGraph;
+        }
+
+        return instance;
+    }
+
+    static void cleanup()
+    {
+        if (instance)
+        {
+            delete instance;
+            instance = nullptr;
+        }
+    }
+
+    //! Delay between an input changing and the recomputation of its dependents (ms)
+    static const int UPDATE_INTERVAL = 100;
+
+    void addSeries(MathDataSeriesPointer series);
+    void removeSeries(const MathDataSeries* series);
+
+    //! Mark every math trace which depends on the specified series as stale
+    void invalidate(const DataSeries* series);
+
+    static double getChangedTime(const DataSnapshot& current, const DataSnapshot& previous);
+
+public slots:
+    //! Recompute all stale series now (rather than waiting for the update timer)
+    void update(void);
+
+protected slots:
+    void onInputUpdated(void);
+
+protected:
+    QList<MathDataSeriesPointer> getUpdateOrder(void);
+    bool updateSeries(MathDataSeriesPointer series);
+
+    //! Registered series (the graph does not extend their lifetime)
+    QList<QWeakPointer<MathDataSeries>> nodes;
+
+    //! Series waiting to be recomputed
+    QSet<const MathDataSeries*> stale;
+
+    //! Set while stale series are being recomputed (updates of the outputs are already accounted for)
+    bool updating = false;
+
+    QTimer updateTimer;
+};
+
+#endif // MATH_DEPENDENCY_GRAPH_HPP
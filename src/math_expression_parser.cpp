@@ -1,6 +1,18 @@
 #include "math_expression_parser.hpp"
 #include <QRegularExpression>
 #include <QDebug>
+#include <algorithm>
+#include <limits>
+
+const int MathProgram::MAX_STACK_DEPTH;
+const int MathProgram::MAX_REGISTERS;
+const size_t MathProgram::BLOCK_SIZE;
+
+// x^2 is evaluated as x * x by every evaluator (so the optimisation of x^2 is exact)
+static inline double power(double x, double y)
+{
+    return y == 2.0 ? x * x : pow(x, y);
+}
 
 MathExpressionParser::MathExpressionParser()
 {
@@ -75,7 +87,7 @@ bool MathExpressionParser::parse(const QString& expression)
  * Handles:
  * - Numbers (integers and decimals like 3.14)
  * - Variables (alphanumeric + underscore, e.g., "rpm1", "temp_sensor")
- * - Functions (abs, sqrt, log, exp, sin, cos, tan)
+ * - Functions (abs, sqrt, log, exp, sin, cos, tan, movavg, rollmin, rollmax, rollstd, diff, integ)
  * - Constants (pi, e)
  * - Operators (+, -, *, /, ^)
  * - Parentheses and commas
@@ -132,7 +144,9 @@ QList<MathExpressionParser::Token> MathExpressionParser::tokenize(const QString&
             // Check if it's a known function
             if (token.value == "abs" || token.value == "sqrt" || token.value == "log" ||
                 token.value == "exp" || token.value == "sin" || token.value == "cos" ||
-                token.value == "tan")
+                token.value == "tan" || token.value == "movavg" || token.value == "rollmin" ||
+                token.value == "rollmax" || token.value == "rollstd" || token.value == "diff" ||
+                token.value == "integ")
             {
                 token.type = Token::TOKEN_FUNCTION;
             }
@@ -188,7 +202,7 @@ QList<MathExpressionParser::Token> MathExpressionParser::tokenize(const QString&
             continue;
         }
 
-        // Comma (for multi-arg functions in the future)
+        // Comma (separates the arguments of windowed functions)
         if (c == ',')
         {
             Token token;
@@ -388,6 +402,32 @@ MathExpressionParser::NodePtr MathExpressionParser::parsePrimary(const QList<Tok
         // Parse argument
         NodePtr argument = parseExpression(tokens, pos);
 
+        NodePtr node = NodePtr::create();
+        node->type = NODE_FUNCTION;
+        node->argument = argument;
+
+        // Windowed functions take a second argument: the (constant) window length, in ms
+        const bool windowed = funcName == "movavg" || funcName == "rollmin" ||
+                              funcName == "rollmax" || funcName == "rollstd";
+
+        if (windowed)
+        {
+            if (pos >= tokens.size() || tokens[pos].type != Token::TOKEN_COMMA)
+            {
+                throw QString("Expected ',' and window length after %1 argument").arg(funcName);
+            }
+            pos++;
+
+            NodePtr length = parseExpression(tokens, pos);
+
+            // Constant expressions can be evaluated without any variables
+            if (!evaluateNode(length, QMap<QString, double>(), node->windowLength) ||
+                !std::isfinite(node->windowLength) || node->windowLength <= 0.0)
+            {
+                throw QString("Window length of %1 must be a positive constant").arg(funcName);
+            }
+        }
+
         // Expect ')'
         if (pos >= tokens.size() || tokens[pos].type != Token::TOKEN_RIGHT_PAREN)
         {
@@ -395,10 +435,6 @@ MathExpressionParser::NodePtr MathExpressionParser::parsePrimary(const QList<Tok
         }
         pos++;
 
-        NodePtr node = NodePtr::create();
-        node->type = NODE_FUNCTION;
-        node->argument = argument;
-
         // Set function type
         if (funcName == "abs") node->functionType = FUNC_ABS;
         else if (funcName == "sqrt") node->functionType = FUNC_SQRT;
@@ -407,6 +443,12 @@ MathExpressionParser::NodePtr MathExpressionParser::parsePrimary(const QList<Tok
         else if (funcName == "sin") node->functionType = FUNC_SIN;
         else if (funcName == "cos") node->functionType = FUNC_COS;
         else if (funcName == "tan") node->functionType = FUNC_TAN;
+        else if (funcName == "movavg") node->functionType = FUNC_MOVAVG;
+        else if (funcName == "rollmin") node->functionType = FUNC_ROLLMIN;
+        else if (funcName == "rollmax") node->functionType = FUNC_ROLLMAX;
+        else if (funcName == "rollstd") node->functionType = FUNC_ROLLSTD;
+        else if (funcName == "diff") node->functionType = FUNC_DIFF;
+        else if (funcName == "integ") node->functionType = FUNC_INTEG;
         else
         {
             throw QString("Unknown function: %1").arg(funcName);
@@ -508,7 +550,7 @@ bool MathExpressionParser::evaluateNode(const NodePtr& node, const QMap<QString,
             return true;
 
         case OP_POWER:
-            result = pow(leftVal, rightVal);
+            result = power(leftVal, rightVal);
             return true;
 
         default:
@@ -563,15 +605,1039 @@ bool MathExpressionParser::evaluateNode(const NodePtr& node, const QMap<QString,
             return true;
 
         default:
+            // Functions of the preceding points can not be evaluated at a single point
+            return false;
+        }
+    }
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Compile the expression tree into postfix bytecode
+ *
+ * The tree is optimised first (see optimizeNode). Nodes are then emitted in post-order
+ * (operands before the operator which consumes them), with each variable bound to the
+ * index of its name in the variables list.
+ *
+ * @param variables Variable names, in slot order
+ * @param program Output parameter for the compiled program
+ * @return true if compilation succeeded, false otherwise (check getError())
+ */
+bool MathExpressionParser::compile(const QStringList& variables, MathProgram& program)
+{
+    program = MathProgram();
+
+    if (!rootNode)
+    {
+        errorMessage = "No expression has been parsed";
+        return false;
+    }
+
+    program.slotCount = variables.size();
+
+    try
+    {
+        const NodePtr optimized = optimizeNode(rootNode);
+
+        CommonSubexpressions common;
+        countSubexpressions(optimized, common);
+
+        program.stackDepth = compileNode(optimized, variables, program, common);
+
+        std::vector<MathProgram::HistoryStep> path;
+        collectHistory(optimized, path, program);
+
+        if (program.stackDepth > MathProgram::MAX_STACK_DEPTH)
+        {
+            throw QString("Expression is too deeply nested");
+        }
+    }
+    catch (const QString& error)
+    {
+        errorMessage = error;
+        program = MathProgram();
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Emit a node, or (for a common subexpression which has already been emitted) load the register which holds its value
+ */
+int MathExpressionParser::compileNode(const NodePtr& node, const QStringList& variables, MathProgram& program, CommonSubexpressions& common) const
+{
+    if (!node)
+    {
+        throw QString("Invalid expression");
+    }
+
+    const bool repeated = (node->type == NODE_OPERATOR || node->type == NODE_FUNCTION) && common.counts.value(node->key) > 1;
+
+    MathProgram::Instruction instruction;
+
+    if (repeated && common.registers.contains(node->key))
+    {
+        instruction.opcode = MathProgram::OPCODE_LOAD;
+        instruction.operand = common.registers.value(node->key);
+        program.instructions.push_back(instruction);
+        return 1;
+    }
+
+    const int depth = emitNode(node, variables, program, common);
+
+    if (repeated && program.registerCount < MathProgram::MAX_REGISTERS)
+    {
+        instruction.opcode = MathProgram::OPCODE_STORE;
+        instruction.operand = program.registerCount++;
+        program.instructions.push_back(instruction);
+
+        common.registers[node->key] = instruction.operand;
+    }
+
+    return depth;
+}
+
+int MathExpressionParser::emitNode(const NodePtr& node, const QStringList& variables, MathProgram& program, CommonSubexpressions& common) const
+{
+
+    MathProgram::Instruction instruction;
+
+    switch (node->type)
+    {
+    case NODE_NUMBER:
+        instruction.opcode = MathProgram::OPCODE_CONSTANT;
+        instruction.operand = (int) program.constants.size();
+        program.constants.push_back(node->numberValue);
+        program.instructions.push_back(instruction);
+        return 1;
+
+    case NODE_VARIABLE:
+        instruction.opcode = MathProgram::OPCODE_VARIABLE;
+        instruction.operand = variables.indexOf(node->variableName);
+
+        if (instruction.operand < 0)
+        {
+            throw QString("Variable '%1' is not bound to a slot").arg(node->variableName);
+        }
+
+        program.instructions.push_back(instruction);
+        return 1;
+
+    case NODE_OPERATOR:
+    {
+        if (node->operatorType == OP_NEGATE)
+        {
+            const int depth = compileNode(node->left, variables, program, common);
+
+            instruction.opcode = MathProgram::OPCODE_NEGATE;
+            program.instructions.push_back(instruction);
+            return depth;
+        }
+
+        // The left operand remains on the stack while the right operand is evaluated
+        const int left = compileNode(node->left, variables, program, common);
+        const int right = compileNode(node->right, variables, program, common);
+
+        switch (node->operatorType)
+        {
+        case OP_ADD:      instruction.opcode = MathProgram::OPCODE_ADD; break;
+        case OP_SUBTRACT: instruction.opcode = MathProgram::OPCODE_SUBTRACT; break;
+        case OP_MULTIPLY: instruction.opcode = MathProgram::OPCODE_MULTIPLY; break;
+        case OP_DIVIDE:   instruction.opcode = MathProgram::OPCODE_DIVIDE; break;
+        case OP_POWER:    instruction.opcode = MathProgram::OPCODE_POWER; break;
+        default:
+            throw QString("Unknown operator");
+        }
+
+        program.instructions.push_back(instruction);
+        return std::max(left, right + 1);
+    }
+
+    case NODE_FUNCTION:
+    {
+        const int depth = compileNode(node->argument, variables, program, common);
+
+        switch (node->functionType)
+        {
+        case FUNC_ABS:  instruction.opcode = MathProgram::OPCODE_ABS; break;
+        case FUNC_SQRT: instruction.opcode = MathProgram::OPCODE_SQRT; break;
+        case FUNC_LOG:  instruction.opcode = MathProgram::OPCODE_LOG; break;
+        case FUNC_EXP:  instruction.opcode = MathProgram::OPCODE_EXP; break;
+        case FUNC_SIN:  instruction.opcode = MathProgram::OPCODE_SIN; break;
+        case FUNC_COS:  instruction.opcode = MathProgram::OPCODE_COS; break;
+        case FUNC_TAN:  instruction.opcode = MathProgram::OPCODE_TAN; break;
+        case FUNC_MOVAVG:  instruction.opcode = MathProgram::OPCODE_MOVAVG; break;
+        case FUNC_ROLLMIN: instruction.opcode = MathProgram::OPCODE_ROLLMIN; break;
+        case FUNC_ROLLMAX: instruction.opcode = MathProgram::OPCODE_ROLLMAX; break;
+        case FUNC_ROLLSTD: instruction.opcode = MathProgram::OPCODE_ROLLSTD; break;
+        case FUNC_DIFF:    instruction.opcode = MathProgram::OPCODE_DIFF; break;
+        case FUNC_INTEG:   instruction.opcode = MathProgram::OPCODE_INTEG; break;
+        default:
+            throw QString("Unknown function");
+        }
+
+        // Each stateful function has its own state
+        if (instruction.opcode >= MathProgram::OPCODE_MOVAVG)
+        {
+            instruction.operand = (int) program.windows.size();
+            program.windows.push_back(node->windowLength);
+        }
+
+        program.instructions.push_back(instruction);
+        return depth;
+    }
+
+    default:
+        throw QString("Invalid expression");
+    }
+}
+
+/**
+ * @brief Optimise an expression tree (the tree itself is unchanged, and unchanged subtrees are shared)
+ *
+ * - Constant subexpressions (e.g. 2 * pi) are evaluated. Subexpressions which fail evaluation
+ *   (e.g. 1 / 0) are retained, so that every point fails.
+ * - x^2 is replaced with x * x (with x shared, so it is evaluated once - see countSubexpressions)
+ * - Division by a power of two is replaced with multiplication by its reciprocal
+ *   (which is exact, unlike the reciprocal of any other constant)
+ *
+ * The key of each node is also set, for the elimination of common subexpressions.
+ */
+MathExpressionParser::NodePtr MathExpressionParser::optimizeNode(const NodePtr& node) const
+{
+    if (!node)
+    {
+        return node;
+    }
+
+    if (node->type == NODE_NUMBER || node->type == NODE_VARIABLE)
+    {
+        node->key = getNodeKey(node);
+        return node;
+    }
+
+    NodePtr optimized = NodePtr::create();
+
+    *optimized = *node;
+
+    optimized->left = optimizeNode(node->left);
+    optimized->right = optimizeNode(node->right);
+    optimized->argument = optimizeNode(node->argument);
+
+    // Constant subexpressions can be evaluated without any variables
+    double value = 0.0;
+
+    if (evaluateNode(optimized, QMap<QString, double>(), value))
+    {
+        NodePtr number = NodePtr::create();
+        number->type = NODE_NUMBER;
+        number->numberValue = value;
+        number->key = getNodeKey(number);
+        return number;
+    }
+
+    if (optimized->type == NODE_OPERATOR && optimized->right && optimized->right->type == NODE_NUMBER)
+    {
+        const double constant = optimized->right->numberValue;
+
+        int exponent = 0;
+
+        if (optimized->operatorType == OP_POWER && constant == 2.0)
+        {
+            optimized->operatorType = OP_MULTIPLY;
+            optimized->right = optimized->left;
+        }
+        else if (optimized->operatorType == OP_DIVIDE && std::isnormal(constant) && std::isnormal(1.0 / constant) &&
+                 std::fabs(std::frexp(constant, &exponent)) == 0.5)
+        {
+            NodePtr reciprocal = NodePtr::create();
+            reciprocal->type = NODE_NUMBER;
+            reciprocal->numberValue = 1.0 / constant;
+            reciprocal->key = getNodeKey(reciprocal);
+
+            optimized->operatorType = OP_MULTIPLY;
+            optimized->right = reciprocal;
+        }
+    }
+
+    optimized->key = getNodeKey(optimized);
+
+    return optimized;
+}
+
+/*
+ * Describe the structure of a node (keys of the child nodes must already be set).
+ * Operands of commutative operators are ordered, so that (for example) a * b and b * a are identical.
+ */
+QString MathExpressionParser::getNodeKey(const NodePtr& node) const
+{
+    switch (node->type)
+    {
+    case NODE_NUMBER:
+        return QString("#%1").arg(QString::number(node->numberValue, 'g', 17));
+
+    case NODE_VARIABLE:
+        return QString("$%1").arg(node->variableName);
+
+    case NODE_OPERATOR:
+    {
+        if (node->operatorType == OP_NEGATE)
+        {
+            return QString("(-%1)").arg(node->left->key);
+        }
+
+        QString left = node->left->key;
+        QString right = node->right->key;
+
+        const bool commutative = node->operatorType == OP_ADD || node->operatorType == OP_MULTIPLY;
+
+        if (commutative && right < left)
+        {
+            std::swap(left, right);
+        }
+
+        return QString("(%1 %2 %3)").arg(left).arg((int) node->operatorType).arg(right);
+    }
+
+    case NODE_FUNCTION:
+        return QString("f%1[%2](%3)").arg((int) node->functionType)
+                .arg(QString::number(node->windowLength, 'g', 17)).arg(node->argument->key);
+
+    default:
+        return QString();
+    }
+}
+
+/*
+ * Count the occurrences of each subexpression. The subexpressions of a repeated node are
+ * only counted once, since the later occurrences are not evaluated.
+ */
+void MathExpressionParser::countSubexpressions(const NodePtr& node, CommonSubexpressions& common) const
+{
+    if (!node || node->type == NODE_NUMBER || node->type == NODE_VARIABLE)
+    {
+        return;
+    }
+
+    const int count = common.counts.value(node->key) + 1;
+
+    common.counts[node->key] = count;
+
+    if (count > 1)
+    {
+        return;
+    }
+
+    countSubexpressions(node->left, common);
+    countSubexpressions(node->right, common);
+    countSubexpressions(node->argument, common);
+}
+
+/**
+ * @brief Record the history required by each stateful function (see MathProgram::getHistoryStart)
+ *
+ * A result at time t of movavg(x, w) requires x over (t - w, t], diff(x) requires x at the
+ * preceding point, and so on for nested functions. A path is recorded for each innermost
+ * stateful function.
+ */
+void MathExpressionParser::collectHistory(const NodePtr& node, std::vector<MathProgram::HistoryStep>& path, MathProgram& program) const
+{
+    if (!node)
+    {
+        return;
+    }
+
+    bool stateful = false;
+
+    if (node->type == NODE_FUNCTION)
+    {
+        MathProgram::HistoryStep step;
+
+        switch (node->functionType)
+        {
+        case FUNC_MOVAVG:
+        case FUNC_ROLLMIN:
+        case FUNC_ROLLMAX:
+        case FUNC_ROLLSTD:
+            step.previous = false;
+            step.length = node->windowLength;
+            stateful = true;
+            break;
+
+        case FUNC_DIFF:
+            step.previous = true;
+            step.length = 0;
+            stateful = true;
+            break;
+
+        case FUNC_INTEG:
+            program.unboundedHistory = true;
+            return;
+
+        default:
+            break;
+        }
+
+        if (stateful)
+        {
+            path.push_back(step);
+        }
+    }
+
+    const size_t depth = program.historyPaths.size();
+
+    collectHistory(node->left, path, program);
+    collectHistory(node->right, path, program);
+    collectHistory(node->argument, path, program);
+
+    // Innermost stateful function
+    if (stateful && program.historyPaths.size() == depth)
+    {
+        program.historyPaths.push_back(path);
+    }
+
+    if (stateful)
+    {
+        path.pop_back();
+    }
+}
+
+/**
+ * @brief Evaluate the compiled program
+ *
+ * Domain errors (division by zero, square root of a negative number, logarithm of a
+ * non-positive number) fail the evaluation, as for MathExpressionParser::evaluate.
+ */
+bool MathProgram::evaluate(const double* values, double& result) const
+{
+    if (instructions.empty())
+    {
+        return false;
+    }
+
+    double stack[MAX_STACK_DEPTH];
+    double registers[MAX_REGISTERS];
+    int top = -1;
+
+    for (const Instruction& instruction : instructions)
+    {
+        switch (instruction.opcode)
+        {
+        case OPCODE_CONSTANT:
+            stack[++top] = constants[instruction.operand];
+            break;
+
+        case OPCODE_VARIABLE:
+            stack[++top] = values[instruction.operand];
+            break;
+
+        case OPCODE_LOAD:
+            stack[++top] = registers[instruction.operand];
+            break;
+
+        case OPCODE_STORE:
+            registers[instruction.operand] = stack[top];
+            break;
+
+        case OPCODE_ADD:
+            top--;
+            stack[top] += stack[top + 1];
+            break;
+
+        case OPCODE_SUBTRACT:
+            top--;
+            stack[top] -= stack[top + 1];
+            break;
+
+        case OPCODE_MULTIPLY:
+            top--;
+            stack[top] *= stack[top + 1];
+            break;
+
+        case OPCODE_DIVIDE:
+            top--;
+            if (stack[top + 1] == 0.0)
+            {
+                return false;  // Division by zero
+            }
+            stack[top] /= stack[top + 1];
+            break;
+
+        case OPCODE_POWER:
+            top--;
+            stack[top] = power(stack[top], stack[top + 1]);
+            break;
+
+        case OPCODE_NEGATE:
+            stack[top] = -stack[top];
+            break;
+
+        case OPCODE_ABS:
+            stack[top] = fabs(stack[top]);
+            break;
+
+        case OPCODE_SQRT:
+            if (stack[top] < 0.0)
+            {
+                return false;  // Negative sqrt
+            }
+            stack[top] = sqrt(stack[top]);
+            break;
+
+        case OPCODE_LOG:
+            if (stack[top] <= 0.0)
+            {
+                return false;  // Log of non-positive
+            }
+            stack[top] = log(stack[top]);
+            break;
+
+        case OPCODE_EXP:
+            stack[top] = exp(stack[top]);
+            break;
+
+        case OPCODE_SIN:
+            stack[top] = sin(stack[top]);
+            break;
+
+        case OPCODE_COS:
+            stack[top] = cos(stack[top]);
+            break;
+
+        case OPCODE_TAN:
+            stack[top] = tan(stack[top]);
+            break;
+
+        default:
+            // Functions of the preceding points (see evaluateBlock)
             return false;
         }
     }
 
+    result = stack[0];
+    return true;
+}
+
+/**
+ * @brief Evaluate the compiled program for a block of points
+ *
+ * Each stack entry is a column of n values, so every instruction is a single pass over
+ * contiguous arrays (which the compiler can vectorise). Rather than ending the evaluation
+ * of a point early, domain errors clear the validity flag of the point.
+ */
+void MathProgram::evaluateBlock(const double* const* inputs, size_t n, double* output, unsigned char* valid) const
+{
+    evaluateBlock(inputs, n, output, valid, nullptr, nullptr);
+}
+
+/**
+ * @brief Evaluate the compiled program for a block of points, in timestamp order
+ *
+ * Stateless instructions are evaluated as above. Each stateful function visits the points of
+ * its column in order, updating its window (see updateWindow).
+ */
+void MathProgram::evaluateBlock(const double* const* inputs, size_t n, double* output, unsigned char* valid,
+                                const double* timestamps, State* state) const
+{
+    if (instructions.empty() || (isStateful() && (state == nullptr || timestamps == nullptr)))
+    {
+        std::fill(valid, valid + n, 0);
+        return;
+    }
+
+    // Registers follow the stack columns
+    std::vector<double> workspace((stackDepth + registerCount) * n);
+
+    double* registers = workspace.data() + stackDepth * n;
+
+    int top = -1;
+
+    for (const Instruction& instruction : instructions)
+    {
+        if (instruction.opcode == OPCODE_CONSTANT)
+        {
+            top++;
+            std::fill(workspace.data() + top * n, workspace.data() + (top + 1) * n, constants[instruction.operand]);
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_VARIABLE)
+        {
+            top++;
+            std::copy(inputs[instruction.operand], inputs[instruction.operand] + n, workspace.data() + top * n);
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_LOAD)
+        {
+            top++;
+            std::copy(registers + instruction.operand * n, registers + (instruction.operand + 1) * n, workspace.data() + top * n);
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_STORE)
+        {
+            std::copy(workspace.data() + top * n, workspace.data() + (top + 1) * n, registers + instruction.operand * n);
+            continue;
+        }
+
+        // Binary operators consume the top column, and write the result to the column below
+        const bool binary = instruction.opcode >= OPCODE_ADD && instruction.opcode <= OPCODE_POWER;
+
+        if (binary) top--;
+
+        double* a = workspace.data() + top * n;
+        const double* b = a + n;
+
+        switch (instruction.opcode)
+        {
+        case OPCODE_ADD:
+            for (size_t i = 0; i < n; i++) a[i] += b[i];
+            break;
+
+        case OPCODE_SUBTRACT:
+            for (size_t i = 0; i < n; i++) a[i] -= b[i];
+            break;
+
+        case OPCODE_MULTIPLY:
+            for (size_t i = 0; i < n; i++) a[i] *= b[i];
+            break;
+
+        case OPCODE_DIVIDE:
+            for (size_t i = 0; i < n; i++) valid[i] &= (b[i] != 0.0);  // Division by zero
+            for (size_t i = 0; i < n; i++) a[i] /= b[i];
+            break;
+
+        case OPCODE_POWER:
+            for (size_t i = 0; i < n; i++) a[i] = power(a[i], b[i]);
+            break;
+
+        case OPCODE_NEGATE:
+            for (size_t i = 0; i < n; i++) a[i] = -a[i];
+            break;
+
+        case OPCODE_ABS:
+            for (size_t i = 0; i < n; i++) a[i] = fabs(a[i]);
+            break;
+
+        case OPCODE_SQRT:
+            for (size_t i = 0; i < n; i++) valid[i] &= (a[i] >= 0.0);  // Negative sqrt
+            for (size_t i = 0; i < n; i++) a[i] = sqrt(a[i]);
+            break;
+
+        case OPCODE_LOG:
+            for (size_t i = 0; i < n; i++) valid[i] &= (a[i] > 0.0);  // Log of non-positive
+            for (size_t i = 0; i < n; i++) a[i] = log(a[i]);
+            break;
+
+        case OPCODE_EXP:
+            for (size_t i = 0; i < n; i++) a[i] = exp(a[i]);
+            break;
+
+        case OPCODE_SIN:
+            for (size_t i = 0; i < n; i++) a[i] = sin(a[i]);
+            break;
+
+        case OPCODE_COS:
+            for (size_t i = 0; i < n; i++) a[i] = cos(a[i]);
+            break;
+
+        case OPCODE_TAN:
+            for (size_t i = 0; i < n; i++) a[i] = tan(a[i]);
+            break;
+
+        case OPCODE_MOVAVG:
+        case OPCODE_ROLLMIN:
+        case OPCODE_ROLLMAX:
+        case OPCODE_ROLLSTD:
+        case OPCODE_DIFF:
+        case OPCODE_INTEG:
+        {
+            State::Window& window = state->windows[instruction.operand];
+            const double length = windows[instruction.operand];
+
+            for (size_t i = 0; i < n; i++)
+            {
+                if (!valid[i])
+                {
+                    // The derivative is only taken between consecutive valid points
+                    if (instruction.opcode == OPCODE_DIFF) window.started = false;
+                    continue;
+                }
+
+                valid[i] = updateWindow(instruction.opcode, length, window, timestamps[i], a[i]);
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    std::copy(workspace.data(), workspace.data() + n, output);
+}
+
+void MathProgram::reset(State& state) const
+{
+    state.windows.assign(windows.size(), State::Window());
+}
+
+/**
+ * @brief Add a point to the window of a stateful function
+ * @param opcode Stateful function
+ * @param length Window length (ms)
+ * @param window State of the function
+ * @param t Timestamp of the point (not less than any preceding point)
+ * @param value Value of the argument, replaced with the result of the function
+ * @return true if the result is valid (the first point has no derivative)
+ */
+bool MathProgram::updateWindow(OpCode opcode, double length, State::Window& window, double t, double& value)
+{
+    switch (opcode)
+    {
+    case OPCODE_MOVAVG:
+    case OPCODE_ROLLSTD:
+    {
+        if (!window.started)
+        {
+            window.reference = value;
+            window.started = true;
+        }
+
+        const double x = value - window.reference;
+
+        window.points.push_back(std::make_pair(t, x));
+        window.sum += x;
+        window.sumSquares += x * x;
+
+        while (window.points.front().first <= t - length)
+        {
+            window.sum -= window.points.front().second;
+            window.sumSquares -= window.points.front().second * window.points.front().second;
+            window.points.pop_front();
+        }
+
+        const double count = (double) window.points.size();
+        const double mean = window.sum / count;
+
+        if (opcode == OPCODE_MOVAVG)
+        {
+            value = window.reference + mean;
+        }
+        else
+        {
+            value = sqrt(std::max(0.0, window.sumSquares / count - mean * mean));
+        }
+
+        // Start afresh once the window is empty (discards any rounding error accumulated by the sums)
+        if (window.points.size() == 1)
+        {
+            window.sum = x;
+            window.sumSquares = x * x;
+        }
+
+        return true;
+    }
+
+    case OPCODE_ROLLMIN:
+    case OPCODE_ROLLMAX:
+    {
+        const bool minimum = opcode == OPCODE_ROLLMIN;
+
+        // Points which can no longer be the extreme of any window are discarded
+        while (!window.extremes.empty() &&
+               (minimum ? window.extremes.back().second >= value : window.extremes.back().second <= value))
+        {
+            window.extremes.pop_back();
+        }
+
+        window.extremes.push_back(std::make_pair(t, value));
+
+        while (window.extremes.front().first <= t - length)
+        {
+            window.extremes.pop_front();
+        }
+
+        value = window.extremes.front().second;
+        return true;
+    }
+
+    case OPCODE_DIFF:
+    {
+        const bool started = window.started;
+        const double dt = (t - window.t_previous) / 1000.0;
+        const double dv = value - window.v_previous;
+
+        window.started = true;
+        window.t_previous = t;
+        window.v_previous = value;
+
+        if (!started || dt <= 0.0) return false;
+
+        value = dv / dt;
+        return true;
+    }
+
+    case OPCODE_INTEG:
+    {
+        // Trapezoidal rule
+        if (window.started)
+        {
+            window.integral += 0.5 * (value + window.v_previous) * (t - window.t_previous) / 1000.0;
+        }
+
+        window.started = true;
+        window.t_previous = t;
+        window.v_previous = value;
+
+        value = window.integral;
+        return true;
+    }
+
     default:
         return false;
     }
 }
 
+/**
+ * @brief Follow each history path back from t (see MathExpressionParser::collectHistory)
+ *
+ * Each window extends the history by its length, and each derivative by one point.
+ */
+double MathProgram::getHistoryStart(double t, const std::function<double(double)>& previous) const
+{
+    if (unboundedHistory)
+    {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    double start = t;
+
+    for (const auto& path : historyPaths)
+    {
+        double time = t;
+
+        for (const HistoryStep& step : path)
+        {
+            time = step.previous ? previous(time) : time - step.length;
+        }
+
+        start = std::min(start, time);
+    }
+
+    return start;
+}
+
+/**
+ * @brief Determine the monotonicity of the program (see MathProgram::getMonotonicity)
+ *
+ * The instructions are visited as for evaluation, but each stack entry records the
+ * direction of the sub-expression (or its value, for constant sub-expressions).
+ */
+int MathProgram::getMonotonicity() const
+{
+    if (instructions.empty())
+    {
+        return 0;
+    }
+
+    struct Term
+    {
+        bool constant;
+        double value;
+
+        // 1 (non-decreasing), -1 (non-increasing) or 0 (unknown), for non-constant terms
+        int direction;
+    };
+
+    Term stack[MAX_STACK_DEPTH];
+    Term registers[MAX_REGISTERS];
+    int top = -1;
+
+    int slot = -1;
+
+    for (const Instruction& instruction : instructions)
+    {
+        if (instruction.opcode == OPCODE_CONSTANT)
+        {
+            stack[++top] = {true, constants[instruction.operand], 0};
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_VARIABLE)
+        {
+            // Only functions of a single variable
+            if (slot >= 0 && slot != instruction.operand)
+            {
+                return 0;
+            }
+
+            slot = instruction.operand;
+            stack[++top] = {false, 0, 1};
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_LOAD)
+        {
+            stack[++top] = registers[instruction.operand];
+            continue;
+        }
+
+        if (instruction.opcode == OPCODE_STORE)
+        {
+            registers[instruction.operand] = stack[top];
+            continue;
+        }
+
+        const bool binary = instruction.opcode == OPCODE_ADD || instruction.opcode == OPCODE_SUBTRACT ||
+                            instruction.opcode == OPCODE_MULTIPLY || instruction.opcode == OPCODE_DIVIDE ||
+                            instruction.opcode == OPCODE_POWER;
+
+        if (binary)
+        {
+            top--;
+
+            Term& a = stack[top];
+            const Term& b = stack[top + 1];
+
+            if (a.constant && b.constant)
+            {
+                // Constant sub-expressions are simply evaluated
+                const double operands[] = {a.value, b.value};
+
+                if (!evaluateConstant(instruction.opcode, operands, 2, a.value))
+                {
+                    return 0;
+                }
+
+                continue;
+            }
+
+            const int sign_b = instruction.opcode == OPCODE_SUBTRACT ? -1 : 1;
+
+            switch (instruction.opcode)
+            {
+            case OPCODE_ADD:
+            case OPCODE_SUBTRACT:
+                if (b.constant)
+                {
+                    // (direction of a is unchanged)
+                }
+                else if (a.constant)
+                {
+                    a = {false, 0, sign_b * b.direction};
+                }
+                else
+                {
+                    a.direction = (a.direction == sign_b * b.direction) ? a.direction : 0;
+                }
+                break;
+
+            case OPCODE_MULTIPLY:
+                if (a.constant || b.constant)
+                {
+                    const double factor = a.constant ? a.value : b.value;
+                    const int direction = a.constant ? b.direction : a.direction;
+
+                    a = {false, 0, factor > 0 ? direction : (factor < 0 ? -direction : 0)};
+                }
+                else
+                {
+                    a.direction = 0;
+                }
+                break;
+
+            case OPCODE_DIVIDE:
+                // Division by a variable is discontinuous (at zero)
+                a.direction = (b.constant && b.value != 0) ? (b.value > 0 ? a.direction : -a.direction) : 0;
+                break;
+
+            default:
+                a.direction = 0;
+                break;
+            }
+
+            a.constant = false;
+
+            if (a.direction == 0)
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        // Functions of a single argument
+        Term& a = stack[top];
+
+        if (a.constant)
+        {
+            if (!evaluateConstant(instruction.opcode, &a.value, 1, a.value))
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        switch (instruction.opcode)
+        {
+        case OPCODE_NEGATE:
+            a.direction = -a.direction;
+            break;
+
+        case OPCODE_SQRT:
+        case OPCODE_LOG:
+        case OPCODE_EXP:
+            // Increasing functions
+            break;
+
+        default:
+            return 0;
+        }
+    }
+
+    return stack[0].constant ? 1 : stack[0].direction;
+}
+
+/**
+ * @brief Apply a single operator to constant operands
+ * @param opcode Operator or function
+ * @param operands Operand values (in stack order)
+ * @param count Number of operands (1 or 2)
+ * @param result Output parameter for the result
+ * @return true if evaluation succeeded
+ */
+bool MathProgram::evaluateConstant(OpCode opcode, const double* operands, int count, double& result)
+{
+    MathProgram program;
+
+    Instruction instruction;
+
+    instruction.opcode = OPCODE_CONSTANT;
+
+    for (int ii = 0; ii < count; ii++)
+    {
+        instruction.operand = ii;
+
+        program.instructions.push_back(instruction);
+        program.constants.push_back(operands[ii]);
+    }
+
+    instruction.opcode = opcode;
+    instruction.operand = 0;
+
+    program.instructions.push_back(instruction);
+    program.stackDepth = count;
+
+    return program.evaluate(nullptr, result);
+}
+
 QStringList MathExpressionParser::getVariables() const
 {
     QStringList variables;
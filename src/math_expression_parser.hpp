@@ -2,9 +2,222 @@
 #define MATH_EXPRESSION_PARSER_HPP
 
 #include <QString>
+#include <QStringList>
+#include <QHash>
 #include <QMap>
 #include <QSharedPointer>
 #include <cmath>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief The MathProgram class is a compiled (postfix bytecode) form of a parsed expression
+ *
+ * Each instruction either pushes a value (a constant, or a variable read from an
+ * integer slot) onto the evaluation stack, or replaces the value(s) at the top of the
+ * stack with the result of an operator or function. Evaluation is a single loop over
+ * the instructions, using a fixed size stack array, without any allocation or lookup.
+ *
+ * A block of points may also be evaluated at once (see evaluateBlock), in which case each
+ * stack entry is a column of values, and each instruction is a single pass over the columns.
+ *
+ * Windowed functions (movavg, rollmin, rollmax, rollstd) and diff / integ depend on the
+ * preceding points, so they can only be evaluated a block at a time, in timestamp order,
+ * with a State which carries their windows from one block to the next.
+ *
+ * See MathExpressionParser::compile
+ */
+class MathProgram
+{
+public:
+    enum OpCode
+    {
+        OPCODE_CONSTANT,    // Push constant[operand]
+        OPCODE_VARIABLE,    // Push values[operand]
+        OPCODE_LOAD,        // Push registers[operand] (a common subexpression)
+        OPCODE_STORE,       // Copy the top of the stack to registers[operand]
+        OPCODE_ADD,
+        OPCODE_SUBTRACT,
+        OPCODE_MULTIPLY,
+        OPCODE_DIVIDE,
+        OPCODE_POWER,
+        OPCODE_NEGATE,
+        OPCODE_ABS,
+        OPCODE_SQRT,
+        OPCODE_LOG,
+        OPCODE_EXP,
+        OPCODE_SIN,
+        OPCODE_COS,
+        OPCODE_TAN,
+
+        // Functions of the preceding points (operand is the index of the function state)
+        OPCODE_MOVAVG,      // Mean over the trailing window windows[operand]
+        OPCODE_ROLLMIN,     // Minimum over the trailing window
+        OPCODE_ROLLMAX,     // Maximum over the trailing window
+        OPCODE_ROLLSTD,     // Standard deviation over the trailing window
+        OPCODE_DIFF,        // Derivative (per second)
+        OPCODE_INTEG        // Integral (over seconds)
+    };
+
+    struct Instruction
+    {
+        OpCode opcode;
+
+        // Constant index, variable slot or register (for push instructions), or state index (for stateful functions)
+        int operand = 0;
+    };
+
+    /**
+     * @brief The State struct holds the preceding points seen by each stateful function
+     *
+     * Every update is O(1) (amortised): the windowed mean and standard deviation are running
+     * sums, and the windowed minimum and maximum are monotonic queues.
+     */
+    struct State
+    {
+        struct Window
+        {
+            //! Points within the window (oldest first), relative to the reference value
+            std::deque<std::pair<double, double>> points;
+
+            //! Candidates for the minimum (or maximum) of the window, oldest first
+            std::deque<std::pair<double, double>> extremes;
+
+            //! Sums over the window are accumulated relative to the first value (limits cancellation)
+            double reference = 0;
+            double sum = 0;
+            double sumSquares = 0;
+
+            //! Previous point (for diff and integ)
+            double t_previous = 0;
+            double v_previous = 0;
+
+            double integral = 0;
+
+            bool started = false;
+        };
+
+        std::vector<Window> windows;
+    };
+
+    //! Maximum evaluation stack depth (deeper expressions can not be compiled)
+    static const int MAX_STACK_DEPTH = 64;
+
+    //! Maximum number of registers (any further common subexpressions are evaluated again)
+    static const int MAX_REGISTERS = 16;
+
+    //! Number of points evaluated by each pass of MathTraceComputer (see evaluateBlock)
+    static const size_t BLOCK_SIZE = 4096;
+
+    bool isValid() const { return !instructions.empty(); }
+
+    //! Number of variable slots read by the program
+    int getSlotCount() const { return slotCount; }
+
+    //! Number of registers used to hold common subexpressions
+    int getRegisterCount() const { return registerCount; }
+
+    const std::vector<Instruction>& getInstructions() const { return instructions; }
+
+    /**
+     * @brief Evaluate the program
+     * @param values Variable values, indexed by slot
+     * @param result Output parameter for the computed result
+     * @return true if evaluation succeeded, false otherwise (e.g. division by zero)
+     */
+    bool evaluate(const double* values, double& result) const;
+
+    /**
+     * @brief Evaluate the program for a block of points
+     * @param inputs Variable values, indexed by slot (each an array of n values)
+     * @param n Number of points
+     * @param output Output array for the computed results
+     * @param valid Validity of each point: cleared for any point which fails evaluation
+     *        (e.g. division by zero), otherwise unchanged
+     */
+    void evaluateBlock(const double* const* inputs, size_t n, double* output, unsigned char* valid) const;
+
+    /**
+     * @brief Evaluate the program for a block of points, which follows any previously evaluated blocks
+     * @param timestamps Timestamp of each point (ascending)
+     * @param state State of the stateful functions (see reset). Without a state, every point of a
+     *        stateful program is invalid.
+     *
+     * Points which are invalid at the argument of a stateful function are not added to its window.
+     */
+    void evaluateBlock(const double* const* inputs, size_t n, double* output, unsigned char* valid,
+                       const double* timestamps, State* state) const;
+
+    //! True if the program contains functions of the preceding points (see State)
+    bool isStateful() const { return !windows.empty(); }
+
+    //! True if the result depends on every preceding point (see getHistoryStart)
+    bool hasUnboundedHistory() const { return unboundedHistory; }
+
+    //! Prepare a state for evaluation from the first point
+    void reset(State& state) const;
+
+    /**
+     * @brief Find the earliest time which affects the result at t, for a stateful program
+     *
+     * A block evaluated from this time (with a fresh state) produces the same results from t
+     * onwards as evaluating every preceding point.
+     *
+     * @param t Time of the first required result
+     * @param previous Returns the timestamp of the point preceding the specified time (or -inf)
+     * @return the start time, which is -inf if the result depends on every preceding point (integ)
+     */
+    double getHistoryStart(double t, const std::function<double(double)>& previous) const;
+
+    /**
+     * @brief Determine whether the program is a monotonic function of a single variable
+     *
+     * The extreme values of a monotonic function over a range of inputs are the function of the
+     * extreme inputs, so such a program may be evaluated over summary buckets (see DataSnapshot::Bucket).
+     * The analysis is conservative: e.g. abs(a) is never considered monotonic, and functions with a
+     * restricted domain (sqrt, log) are monotonic wherever they can be evaluated.
+     *
+     * @return 1 if non-decreasing, -1 if non-increasing, 0 if not (known to be) monotonic
+     */
+    int getMonotonicity() const;
+
+protected:
+    friend class MathExpressionParser;
+
+    static bool evaluateConstant(OpCode opcode, const double* operands, int count, double& result);
+
+    static bool updateWindow(OpCode opcode, double length, State::Window& window, double t, double& value);
+
+    std::vector<Instruction> instructions;
+    std::vector<double> constants;
+
+    //! Trailing window length (ms) of each stateful function (zero for diff and integ)
+    std::vector<double> windows;
+
+    //! A step back in time, from the result of a stateful function to the points of its argument
+    struct HistoryStep
+    {
+        //! True for the preceding point (diff), otherwise the window length
+        bool previous;
+        double length;
+    };
+
+    //! Steps from the root of the expression to each innermost stateful function
+    std::vector<std::vector<HistoryStep>> historyPaths;
+
+    //! Set if the program contains integ (which depends on every preceding point)
+    bool unboundedHistory = false;
+
+    int slotCount = 0;
+    int registerCount = 0;
+
+    //! Evaluation stack depth required by the program
+    int stackDepth = 0;
+};
+
 
 /**
  * @brief The MathExpressionParser class parses and evaluates mathematical expressions
@@ -12,14 +225,21 @@
  * Supports:
  * - Arithmetic operators: +, -, *, /, ^ (power)
  * - Functions: abs(), sqrt(), log(), exp(), sin(), cos(), tan()
+ * - Windowed functions, over a trailing window (in ms): movavg(x, w), rollmin(x, w), rollmax(x, w), rollstd(x, w)
+ * - Derivative (per second) and integral (over seconds): diff(x), integ(x)
  * - Constants: pi, e
  * - Parentheses for precedence
  * - Variable substitution
  *
+ * Windowed functions, diff and integ depend on the preceding points, so they are evaluated
+ * by MathProgram::evaluateBlock only (evaluate fails for them).
+ *
+ * The expression is optimised before it is compiled (see optimizeNode): constant subexpressions
+ * are folded, repeated subexpressions are evaluated once, and some operators are replaced with
+ * cheaper equivalents. Every optimisation produces exactly the same results.
+ *
  * TODO: Future enhancements:
  * - Conditional operations (if/then/else)
- * - Aggregations (moving_avg, min, max over windows)
- * - Derivatives and integrals
  */
 class MathExpressionParser
 {
@@ -42,6 +262,14 @@ public:
      */
     bool evaluate(const QMap<QString, double>& variables, double& result) const;
 
+    /**
+     * @brief Compile the parsed expression into bytecode
+     * @param variables Variable names, in slot order (every variable in the expression must be present)
+     * @param program Output parameter for the compiled program
+     * @return true if compilation succeeded, false otherwise (check getError())
+     */
+    bool compile(const QStringList& variables, MathProgram& program);
+
     /**
      * @brief Get the last error message
      * @return Error message string, or empty if no error
@@ -82,7 +310,13 @@ private:
         FUNC_EXP,
         FUNC_SIN,
         FUNC_COS,
-        FUNC_TAN
+        FUNC_TAN,
+        FUNC_MOVAVG,
+        FUNC_ROLLMIN,
+        FUNC_ROLLMAX,
+        FUNC_ROLLSTD,
+        FUNC_DIFF,
+        FUNC_INTEG
     };
 
     // Expression tree node
@@ -102,6 +336,12 @@ private:
         // Function type for FUNCTION nodes
         FunctionType functionType;
 
+        // Window length (ms) for windowed FUNCTION nodes
+        double windowLength = 0.0;
+
+        // Structure of the subexpression (identical subexpressions have the same key)
+        QString key;
+
         // Child nodes
         QSharedPointer<ExpressionNode> left;
         QSharedPointer<ExpressionNode> right;
@@ -142,6 +382,23 @@ private:
     // Evaluation method
     bool evaluateNode(const NodePtr& node, const QMap<QString, double>& variables, double& result) const;
 
+    // Subexpressions which occur more than once, and the register holding each (once emitted)
+    struct CommonSubexpressions
+    {
+        QHash<QString, int> counts;
+        QHash<QString, int> registers;
+    };
+
+    // Optimisation methods
+    NodePtr optimizeNode(const NodePtr& node) const;
+    QString getNodeKey(const NodePtr& node) const;
+    void countSubexpressions(const NodePtr& node, CommonSubexpressions& common) const;
+
+    // Compilation methods (return the stack depth required by the node)
+    int compileNode(const NodePtr& node, const QStringList& variables, MathProgram& program, CommonSubexpressions& common) const;
+    int emitNode(const NodePtr& node, const QStringList& variables, MathProgram& program, CommonSubexpressions& common) const;
+    void collectHistory(const NodePtr& node, std::vector<MathProgram::HistoryStep>& path, MathProgram& program) const;
+
     // Helper methods
     void collectVariables(const NodePtr& node, QStringList& variables) const;
     bool isOperator(QChar c) const;
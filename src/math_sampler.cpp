@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "math_dependency_graph.hpp"
+#include "math_sampler.hpp"
+#include "parallel_for.hpp"
+
+
+const uint64_t MathCurveUpdater::CHUNK_SAMPLES;
+const size_t MathCurveUpdater::CHUNK_CACHE_MEMORY;
+
+
+MathCurveUpdater::MathCurveUpdater(MathDataSeries &data_series) : PlotCurveUpdater(data_series),
+    mathSeries(data_series),
+    windowSeries("math window")
+{
+    const auto mapping = mathSeries.getVariableMapping();
+
+    QMap<QString, size_t> inputIndex;
+
+    for (auto it = mapping.begin(); it != mapping.end(); ++it)
+    {
+        if (it.value().isNull()) return;
+
+        inputIndex[it.key()] = inputs.size();
+        inputs.push_back(it.value());
+    }
+
+    MathExpressionParser parser;
+
+    if (!parser.parse(mathSeries.getExpression())) return;
+
+    // Each required variable is bound to a slot (in order), as for MathTraceComputer
+    const QStringList variables = parser.getVariables();
+
+    for (const QString& var : variables)
+    {
+        if (!inputIndex.contains(var)) return;
+
+        variableIndex.push_back(inputIndex[var]);
+    }
+
+    if (!parser.compile(variables, program)) return;
+
+    monotonicity = variableIndex.size() == 1 ? program.getMonotonicity() : 0;
+
+    computer.compute(mathSeries.getExpression(), mapping, MathDataSeriesPointer(), mathSeries.getMaxGapSize());
+}
+
+
+/*
+ * A running request uses the chunk cache and the inputs, so it must finish before the members are destroyed
+ * (the base class destructor runs too late)
+ */
+MathCurveUpdater::~MathCurveUpdater()
+{
+    cancelRequests();
+    waitForRequests();
+}
+
+
+/*
+ * Evaluate (and down-sample) the expression over the specified timespan.
+ * Only the chunks which cover the view (and one chunk either side, so that lines are
+ * drawn off either edge) are evaluated, at the resolution required for n_pixels columns.
+ */
+void MathCurveUpdater::updateCurveSamples(double t_min, double t_max, unsigned int n_pixels)
+{
+    QMutexLocker lock(&mutex);
+
+    if (t_min > t_max)
+    {
+        std::swap(t_min, t_max);
+    }
+
+    std::vector<DataSnapshot> snapshots;
+
+    size_t largest = 0;
+
+    for (const auto& input : inputs)
+    {
+        snapshots.push_back(input->getSnapshot());
+
+        if (snapshots.back().size() > snapshots[largest].size()) largest = snapshots.size() - 1;
+    }
+
+    const bool changed = updateChunkCache(snapshots);
+
+    const int mode = downsampleMode.load();
+
+    DensityView view;
+
+    if (mode == DOWNSAMPLE_DENSITY)
+    {
+        QMutexLocker request_lock(&requestMutex);
+        view = density_requested;
+    }
+
+    const double scaler = mathSeries.getScaler();
+    const double offset = mathSeries.getOffset();
+
+    const bool density_reusable = mode != DOWNSAMPLE_DENSITY ||
+            (view == density_latest && scaler == scaler_latest && offset == offset_latest);
+
+    // Nothing has changed, other than (possibly) the scaling of the output
+    if (samples_latest && !changed && t_min == t_min_latest && t_max == t_max_latest && n_pixels == n_pixels_latest &&
+        mode == mode_latest && density_reusable)
+    {
+        if (scaler != scaler_latest || offset != offset_latest)
+        {
+            scaler_latest = scaler;
+            offset_latest = offset;
+
+            emit sampleComplete(samples_latest, scaler_latest, offset_latest);
+        }
+
+        return;
+    }
+
+    auto output = acquireBuffer();
+
+    if (!program.isValid() || snapshots.empty() || snapshots[largest].isEmpty() || n_pixels == 0)
+    {
+        samples_latest = output;
+
+        emit sampleComplete(samples_latest, scaler, offset);
+        return;
+    }
+
+    const DataSnapshot& reference = snapshots[largest];
+
+    // The chunk grid is determined by the sample period, so it is only estimated once
+    if (sample_dt <= 0 || chunkCache.empty())
+    {
+        sample_dt = (reference.getTimestamp(reference.size() - 1) - reference.getTimestamp(0)) / std::max<uint64_t>(1, reference.size() - 1);
+
+        if (!(sample_dt > 0)) sample_dt = 1;
+    }
+
+    // Summary buckets are evaluated (rather than every sample) if there are enough buckets per pixel
+    const uint64_t n_visible = reference.upperBound(t_max) - reference.upperBound(t_min);
+
+    int level = -1;
+
+    if (monotonicity != 0)
+    {
+        for (unsigned int lvl = 0; lvl < DataBlock::SUMMARY_LEVELS; lvl++)
+        {
+            if (DataBlock::getSummaryBucketSize(lvl) * MIN_BUCKETS_PER_PIXEL * n_pixels <= n_visible)
+            {
+                level = lvl;
+            }
+        }
+    }
+
+    const double width = getChunkWidth(level);
+
+    const int64_t k_first = (int64_t) std::floor(t_min / width) - 1;
+    const int64_t k_last = (int64_t) std::floor(t_max / width) + 1;
+
+    passCount++;
+
+    std::vector<int64_t> missing;
+
+    for (int64_t k = k_first; k <= k_last; k++)
+    {
+        auto it = chunkCache.find(ChunkKey(level, k));
+
+        if (it == chunkCache.end())
+        {
+            missing.push_back(k);
+        }
+        else
+        {
+            it->second.used = passCount;
+        }
+    }
+
+    if (!missing.empty())
+    {
+        std::vector<Chunk> results(missing.size());
+
+        parallelFor(missing.size(), [&](size_t idx) {
+            if (isSuperseded()) return;
+
+            evaluateChunk(snapshots, level, missing[idx], results[idx]);
+        }, getThreadPool());
+
+        // Chunks evaluated by an abandoned pass are discarded (some may be incomplete)
+        if (isSuperseded())
+        {
+            output->clear();
+            return;
+        }
+
+        for (size_t idx = 0; idx < missing.size(); idx++)
+        {
+            Chunk& chunk = chunkCache[ChunkKey(level, missing[idx])];
+
+            chunk.timestamps.swap(results[idx].timestamps);
+            chunk.values.swap(results[idx].values);
+            chunk.used = passCount;
+
+            chunkCacheMemory += chunk.getMemory();
+        }
+    }
+
+    // The visible chunks are assembled into a single series, which is down-sampled as usual
+    windowSeries.clearData(false);
+
+    for (int64_t k = k_first; k <= k_last; k++)
+    {
+        const Chunk& chunk = chunkCache[ChunkKey(level, k)];
+
+        windowSeries.addData(chunk.timestamps, chunk.values, false);
+    }
+
+    trimChunkCache();
+
+    const auto window = windowSeries.getSnapshot();
+
+    // The window is assembled afresh for each pass, so its pixel columns can not be re-used
+    columnCache.clear();
+
+    if (!resample(window, t_min, t_max, n_pixels, *output, columnCache, mode))
+    {
+        output->clear();
+        return;
+    }
+
+    if (mode == DOWNSAMPLE_DENSITY && !rasterizeDensity(DataSnapshot(window.getTable(), scaler, offset), t_min, t_max, n_pixels, view, *output))
+    {
+        output->clear();
+        return;
+    }
+
+    output->updateRange();
+
+    density_latest = view;
+
+    t_min_latest = t_min;
+    t_max_latest = t_max;
+    n_pixels_latest = n_pixels;
+    mode_latest = mode;
+
+    scaler_latest = scaler;
+    offset_latest = offset;
+
+    samples_latest = output;
+
+    emit sampleComplete(samples_latest, scaler_latest, offset_latest);
+}
+
+
+/*
+ * Timespan of each chunk: CHUNK_SAMPLES samples of the largest input, or CHUNK_SAMPLES buckets at a summary level
+ */
+double MathCurveUpdater::getChunkWidth(int level) const
+{
+    const uint64_t samples = level < 0 ? 1 : DataBlock::getSummaryBucketSize(level);
+
+    return sample_dt * CHUNK_SAMPLES * samples;
+}
+
+
+/**
+ * @brief MathCurveUpdater::evaluateChunk - Evaluate the points of a single chunk
+ * @param snapshots are the input series (in variable mapping order)
+ * @param level is the summary level, or -1 to evaluate every timestamp of the inputs
+ * @param k is the grid index of the chunk
+ * @param chunk receives the points
+ */
+void MathCurveUpdater::evaluateChunk(const std::vector<DataSnapshot>& snapshots, int level, int64_t k, Chunk& chunk)
+{
+    const double width = getChunkWidth(level);
+
+    const double t_begin = k * width;
+    const double t_end = (k + 1) * width;
+
+    computedChunks++;
+
+    // Monotonic functions of a single input are evaluated over buckets, unless any of the points fails
+    if (level >= 0 && evaluateBuckets(snapshots[variableIndex[0]], level, t_begin, t_end, chunk))
+    {
+        bucketChunks++;
+        return;
+    }
+
+    MathTraceComputer::ChunkResult result;
+
+    computer.computeChunk(program, snapshots, variableIndex, t_begin, t_end, result);
+
+    chunk.timestamps.swap(result.timestamps);
+    chunk.values.swap(result.values);
+}
+
+
+/*
+ * Evaluate the expression at the first, last, minimum and maximum samples of each summary bucket within [t_begin, t_end).
+ * Returns false if the expression could not be evaluated at any of these samples (e.g. outside the domain of sqrt),
+ * since the extreme values within the bucket are then unknown.
+ */
+bool MathCurveUpdater::evaluateBuckets(const DataSnapshot& snapshot, int level, double t_begin, double t_end, Chunk& chunk) const
+{
+    chunk.timestamps.clear();
+    chunk.values.clear();
+
+    bool valid = true;
+
+    snapshot.visitBuckets(snapshot.lowerBound(t_begin), snapshot.lowerBound(t_end), level, [&](const DataSnapshot::Bucket& bucket) {
+        if (!valid) return;
+
+        DataPoint points[4] = {bucket.first, bucket.min, bucket.max, bucket.last};
+
+        std::stable_sort(points, points + 4, [](const DataPoint& a, const DataPoint& b) {
+            return a.timestamp < b.timestamp;
+        });
+
+        for (int ii = 0; ii < 4; ii++)
+        {
+            // The same sample may be (for example) both the first and the minimum
+            if (ii > 0 && points[ii].timestamp == points[ii - 1].timestamp && points[ii].value == points[ii - 1].value)
+            {
+                continue;
+            }
+
+            double result = 0;
+
+            if (!program.evaluate(&points[ii].value, result) || !std::isfinite(result))
+            {
+                valid = false;
+                return;
+            }
+
+            chunk.timestamps.push_back(points[ii].timestamp);
+            chunk.values.push_back(result);
+        }
+    });
+
+    return valid;
+}
+
+
+/*
+ * Discard any chunks which may have changed since they were evaluated (see MathDependencyGraph::getChangedTime).
+ * Returns true if any input has changed.
+ */
+bool MathCurveUpdater::updateChunkCache(const std::vector<DataSnapshot>& snapshots)
+{
+    double t_changed = std::numeric_limits<double>::infinity();
+
+    if (inputs_latest.size() != snapshots.size())
+    {
+        t_changed = -std::numeric_limits<double>::infinity();
+    }
+    else
+    {
+        for (size_t idx = 0; idx < snapshots.size(); idx++)
+        {
+            t_changed = std::min(t_changed, MathDependencyGraph::getChangedTime(snapshots[idx], inputs_latest[idx]));
+        }
+    }
+
+    inputs_latest = snapshots;
+
+    if (t_changed == std::numeric_limits<double>::infinity()) return false;
+
+    for (auto it = chunkCache.begin(); it != chunkCache.end();)
+    {
+        // Chunks which end before the first changed sample are unchanged
+        if ((it->first.second + 1) * getChunkWidth(it->first.first) > t_changed)
+        {
+            chunkCacheMemory -= it->second.getMemory();
+            it = chunkCache.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Discard the least recently used chunks, to limit memory use (chunks used by the current pass are retained)
+ */
+void MathCurveUpdater::trimChunkCache()
+{
+    while (chunkCacheMemory > CHUNK_CACHE_MEMORY)
+    {
+        auto oldest = chunkCache.end();
+
+        for (auto it = chunkCache.begin(); it != chunkCache.end(); it++)
+        {
+            if (oldest == chunkCache.end() || it->second.used < oldest->second.used) oldest = it;
+        }
+
+        if (oldest == chunkCache.end() || oldest->second.used == passCount) break;
+
+        chunkCacheMemory -= oldest->second.getMemory();
+        chunkCache.erase(oldest);
+    }
+}
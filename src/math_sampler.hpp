@@ -0,0 +1,111 @@
+#ifndef MATH_SAMPLER_HPP
+#define MATH_SAMPLER_HPP
+
+#include <atomic>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "math_data_series.hpp"
+#include "math_expression_parser.hpp"
+#include "math_trace_computer.hpp"
+#include "plot_sampler.hpp"
+
+
+/*
+ * Samples a lazy MathDataSeries (see MathDataSeries::isLazy), which is never computed in full.
+ *
+ * The timeline is divided into chunks, on a fixed grid (so that panning re-uses the chunks which
+ * remain visible), and only the visible chunks are evaluated. The evaluated points are then
+ * down-sampled like any other series.
+ *
+ * When the view is zoomed out, an expression which is a monotonic function of a single input
+ * (see MathProgram::getMonotonicity) is evaluated at the first, last and extreme samples of each
+ * summary bucket of the input, which produces exactly the same pixel columns as evaluating every
+ * sample. Any other expression is evaluated in full, for the visible chunks only.
+ *
+ * Chunks are discarded as the inputs change (only from the first changed sample onwards),
+ * and the least recently used chunks are discarded to limit memory use.
+ */
+class MathCurveUpdater : public PlotCurveUpdater
+{
+    Q_OBJECT
+
+public:
+    MathCurveUpdater(MathDataSeries &data_series);
+    virtual ~MathCurveUpdater();
+
+    //! Samples (of the largest input) per chunk, evaluated at full resolution
+    static const uint64_t CHUNK_SAMPLES = 1 << 16;
+
+    //! Memory used by evaluated chunks, per curve (bytes)
+    static const size_t CHUNK_CACHE_MEMORY = 32 << 20;
+
+    //! Total number of chunks evaluated (cached chunks are not counted)
+    uint64_t getComputedChunkCount(void) const { return computedChunks.load(); }
+
+    //! Number of those chunks which were evaluated from summary buckets
+    uint64_t getBucketChunkCount(void) const { return bucketChunks.load(); }
+
+public slots:
+    virtual void updateCurveSamples(double t_min, double t_max, unsigned int n_pixels) override;
+
+protected:
+    //! Pixel columns are computed from the evaluated chunks, which are not retained beyond the view
+    virtual bool isPrefetchSupported(void) const override { return false; }
+
+    struct Chunk
+    {
+        std::vector<double> timestamps;
+        std::vector<double> values;
+
+        //! Pass in which the chunk was most recently used
+        uint64_t used = 0;
+
+        size_t getMemory(void) const { return 2 * timestamps.size() * sizeof(double); }
+    };
+
+    //! Chunks are identified by summary level (-1 for full resolution) and grid index
+    typedef std::pair<int, int64_t> ChunkKey;
+
+    double getChunkWidth(int level) const;
+
+    void evaluateChunk(const std::vector<DataSnapshot>& snapshots, int level, int64_t k, Chunk& chunk);
+    bool evaluateBuckets(const DataSnapshot& snapshot, int level, double t_begin, double t_end, Chunk& chunk) const;
+
+    bool updateChunkCache(const std::vector<DataSnapshot>& snapshots);
+    void trimChunkCache(void);
+
+    MathDataSeries &mathSeries;
+
+    //! Input series (in variable mapping order) and the input read by each program slot
+    std::vector<DataSeriesPointer> inputs;
+    std::vector<size_t> variableIndex;
+
+    MathProgram program;
+
+    //! Direction of the expression, if it is monotonic (see MathProgram::getMonotonicity)
+    int monotonicity = 0;
+
+    //! Evaluates full resolution chunks (with the maximum gap size of the series)
+    MathTraceComputer computer;
+
+    //! Estimated sample period of the largest input, which determines the chunk grid
+    double sample_dt = 0;
+
+    //! Inputs from which the cached chunks were evaluated
+    std::vector<DataSnapshot> inputs_latest;
+
+    std::map<ChunkKey, Chunk> chunkCache;
+    size_t chunkCacheMemory = 0;
+
+    uint64_t passCount = 0;
+
+    //! Evaluated points of the visible chunks
+    DataSeries windowSeries;
+
+    std::atomic<uint64_t> computedChunks{0};
+    std::atomic<uint64_t> bucketChunks{0};
+};
+
+#endif // MATH_SAMPLER_HPP
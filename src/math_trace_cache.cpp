@@ -0,0 +1,254 @@
+#include <string.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "math_trace_cache.hpp"
+#include "series_file.hpp"
+
+
+MathTraceCache* MathTraceCache::instance = nullptr;
+
+const uint32_t MathTraceCache::FILE_VERSION;
+const int64_t MathTraceCache::MAX_CACHE_SIZE;
+
+static const char FILE_MAGIC[4] = {'L', 'J', 'M', 'T'};
+
+
+/*
+ * Mix a 64-bit word into a hash
+ */
+static inline uint64_t hashWord(uint64_t hash, uint64_t word)
+{
+    hash ^= word * 0x9E3779B97F4A7C15ULL;
+    hash = (hash << 27) | (hash >> 37);
+
+    return hash * 0xC2B2AE3D27D4EB4FULL + 0x165667B19E3779F9ULL;
+}
+
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t bytes)
+{
+    const unsigned char* ptr = (const unsigned char*) data;
+
+    for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t), ptr += sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, ptr, sizeof(uint64_t));
+
+        hash = hashWord(hash, word);
+    }
+
+    if (bytes > 0)
+    {
+        uint64_t word = 0;
+        memcpy(&word, ptr, bytes);
+
+        hash = hashWord(hash, word ^ ((uint64_t) bytes << 56));
+    }
+
+    return hash;
+}
+
+
+/*
+ * Create a cache in the specified directory.
+ * If no directory is provided, the (per user) cache location of the application is used.
+ */
+MathTraceCache::MathTraceCache(QString directory) : directory(directory)
+{
+    if (this->directory.isEmpty())
+    {
+        this->directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QDir::separator() + "math";
+    }
+}
+
+
+QString MathTraceCache::getDirectory() const
+{
+    QMutexLocker lock(&mutex);
+
+    return directory;
+}
+
+
+void MathTraceCache::setDirectory(QString dir)
+{
+    QMutexLocker lock(&mutex);
+
+    directory = dir;
+}
+
+
+/**
+ * @brief MathTraceCache::getKey - Describe a computation of a math trace
+ * @param expression is the expression of the trace
+ * @param inputs is the snapshot of each input series (by variable name)
+ * @param maxGapSize is the maximum gap (in ms) which is interpolated across
+ * @return the key, which changes if any input changes
+ */
+QByteArray MathTraceCache::getKey(const QString& expression, const QMap<QString, DataSnapshot>& inputs, double maxGapSize)
+{
+    QByteArray key;
+
+    key += "expression=" + expression.toUtf8() + "\n";
+    key += "gap=" + QByteArray::number(maxGapSize, 'g', 17) + "\n";
+
+    for (auto it = inputs.begin(); it != inputs.end(); ++it)
+    {
+        const DataSnapshot& snapshot = it.value();
+
+        key += it.key().toUtf8() + "=" + QByteArray::number((qulonglong) getContentHash(snapshot), 16) +
+               "," + QByteArray::number((qulonglong) snapshot.size()) +
+               "," + QByteArray::number(snapshot.getScaler(), 'g', 17) +
+               "," + QByteArray::number(snapshot.getOffset(), 'g', 17) +
+               "," + QByteArray::number(snapshot.getTimeScale(), 'g', 17) +
+               "," + QByteArray::number(snapshot.getTimeOffset(), 'g', 17) + "\n";
+    }
+
+    return key;
+}
+
+
+/*
+ * Hash the (raw) samples of a snapshot, a block at a time
+ */
+uint64_t MathTraceCache::getContentHash(const DataSnapshot& snapshot)
+{
+    uint64_t hash = hashWord(0, snapshot.size());
+
+    snapshot.getView().visitSegments([&hash](const DataView::Segment& segment) {
+        hash = hashBytes(hash, segment.timestamps, segment.length * sizeof(double));
+
+        if (segment.values)
+        {
+            hash = hashBytes(hash, segment.values, segment.length * sizeof(double));
+        }
+        else
+        {
+            hash = hashBytes(hash, segment.valuesSingle, segment.length * sizeof(float));
+        }
+    });
+
+    return hash;
+}
+
+
+QString MathTraceCache::getFileName(const QByteArray& key) const
+{
+    const uint64_t hash = hashBytes(0, key.constData(), key.size());
+
+    return directory + QDir::separator() + QString("%1.ljmath").arg(hash, 16, 16, QChar('0'));
+}
+
+
+/**
+ * @brief MathTraceCache::load - Load a computed trace
+ * @param key describes the computation (see getKey)
+ * @param output receives the samples (any existing samples are discarded)
+ * @return true if the trace was found (otherwise the output is left empty)
+ */
+bool MathTraceCache::load(const QByteArray& key, DataSeries& output)
+{
+    if (!isEnabled()) return false;
+
+    QFile file(getFileName(key));
+
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    char magic[4] = {0};
+    uint32_t version = 0;
+    uint32_t keyLength = 0;
+
+    if (!SeriesFile::readData(file, magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+        !SeriesFile::readData(file, &version, sizeof(version)) || version != FILE_VERSION ||
+        !SeriesFile::readData(file, &keyLength, sizeof(keyLength)) || keyLength != (uint32_t) key.size())
+    {
+        return false;
+    }
+
+    // (The file name is only a hash of the key)
+    if (file.read(keyLength) != key)
+    {
+        return false;
+    }
+
+    if (!SeriesFile::readSamples(file, output))
+    {
+        qWarning() << "Invalid math trace cache file" << file.fileName();
+        return false;
+    }
+
+    hits++;
+
+    return true;
+}
+
+
+/**
+ * @brief MathTraceCache::store - Store a computed trace (replacing any trace with the same key)
+ * @param key describes the computation (see getKey)
+ * @param snapshot contains the computed samples (the raw values are stored)
+ * @return true if the trace was written
+ */
+bool MathTraceCache::store(const QByteArray& key, const DataSnapshot& snapshot)
+{
+    if (!isEnabled() || snapshot.isEmpty()) return false;
+
+    QMutexLocker lock(&mutex);
+
+    if (!QDir().mkpath(directory)) return false;
+
+    // The file is only replaced once it has been written in full
+    QSaveFile file(getFileName(key));
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    const uint32_t version = FILE_VERSION;
+    const uint32_t keyLength = key.size();
+
+    const bool valid = SeriesFile::writeData(file, FILE_MAGIC, sizeof(FILE_MAGIC)) &&
+                       SeriesFile::writeData(file, &version, sizeof(version)) &&
+                       SeriesFile::writeData(file, &keyLength, sizeof(keyLength)) &&
+                       SeriesFile::writeData(file, key.constData(), key.size()) &&
+                       SeriesFile::writeSamples(file, snapshot);
+
+    if (!valid || !file.commit())
+    {
+        qWarning() << "Could not write math trace cache file" << file.fileName();
+
+        file.cancelWriting();
+        return false;
+    }
+
+    trim();
+
+    return true;
+}
+
+
+/*
+ * Remove the least recently written files, until the cache fits within MAX_CACHE_SIZE
+ */
+void MathTraceCache::trim()
+{
+    QDir dir(directory);
+
+    const auto files = dir.entryInfoList(QStringList() << "*.ljmath", QDir::Files, QDir::Time);
+
+    int64_t total = 0;
+
+    for (const QFileInfo& info : files)
+    {
+        total += info.size();
+
+        if (total > MAX_CACHE_SIZE)
+        {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
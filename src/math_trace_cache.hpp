@@ -0,0 +1,90 @@
+#ifndef MATH_TRACE_CACHE_HPP
+#define MATH_TRACE_CACHE_HPP
+
+#include <stdint.h>
+#include <atomic>
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The MathTraceCache class stores computed math traces on disk, so they are not recomputed in later sessions
+ *
+ * Each computed trace is stored in its own file, identified by a key which describes the computation:
+ * the expression, the maximum gap size, and the contents (and scaling) of each input series. If an
+ * input changes, the key changes, so a stale trace is never loaded. Old files are discarded once
+ * the cache exceeds MAX_CACHE_SIZE (least recently written first).
+ *
+ * Samples are compressed with DataCodec (see SeriesFile):
+ *
+ *   "LJMT" | version (uint32) | key length (uint32) | key | samples
+ *
+ * The cache is disabled by default (see MainWindow, which enables it according to the settings).
+ * Loading and storing are thread safe.
+ */
+class MathTraceCache
+{
+    static MathTraceCache* instance;
+
+public:
+    MathTraceCache(QString directory = QString());
+
+    // Singleton design pattern
+    static MathTraceCache* getInstance()
+    {
+        if (!instance)
+        {
+            instance = new MathTraceCache;
+        }
+
+        return instance;
+    }
+
+    static void cleanup()
+    {
+        if (instance)
+        {
+            delete instance;
+            instance = nullptr;
+        }
+    }
+
+    static const uint32_t FILE_VERSION = 1;
+
+    //! Total size of the cache files (bytes)
+    static const int64_t MAX_CACHE_SIZE = 1LL << 30;
+
+    bool isEnabled(void) const { return enabled.load(); }
+    void setEnabled(bool on) { enabled = on; }
+
+    QString getDirectory(void) const;
+    void setDirectory(QString dir);
+
+    static QByteArray getKey(const QString& expression, const QMap<QString, DataSnapshot>& inputs, double maxGapSize);
+    static uint64_t getContentHash(const DataSnapshot& snapshot);
+
+    bool load(const QByteArray& key, DataSeries& output);
+    bool store(const QByteArray& key, const DataSnapshot& snapshot);
+
+    //! Number of traces loaded from the cache
+    uint64_t getHitCount(void) const { return hits.load(); }
+
+protected:
+    QString getFileName(const QByteArray& key) const;
+    void trim(void);
+
+    mutable QMutex mutex;
+
+    QString directory;
+
+    std::atomic<bool> enabled{false};
+
+    std::atomic<uint64_t> hits{0};
+};
+
+#endif // MATH_TRACE_CACHE_HPP
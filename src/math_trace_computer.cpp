@@ -2,10 +2,18 @@
 #include <QElapsedTimer>
 #include <QDebug>
 #include <algorithm>
-#include <set>
+#include <functional>
+#include <limits>
+#include "math_trace_cache.hpp"
+#include "parallel_for.hpp"
+#include "trace_recorder.hpp"
+
+const uint64_t MathTraceComputer::CHUNK_SAMPLES;
 
 MathTraceComputer::MathTraceComputer()
-    : cancelRequested(false)
+    : currentMaxGapSize(1000.0),
+      currentStartTime(-std::numeric_limits<double>::infinity()),
+      cancelRequested(false)
 {
 }
 
@@ -20,11 +28,16 @@ MathTraceComputer::~MathTraceComputer()
  * @param variableMapping Map of variable names to input data series
  * @param outputSeries Series to populate with computed results
  * @param maxGapSize Maximum gap in milliseconds to interpolate across (default: 1000ms)
+ * @param startTime Start of the incremental update (by default, the whole output series is computed)
+ *
+ * An incremental update discards the output points from startTime onwards, and evaluates only the
+ * timestamps from startTime onwards (e.g. the range affected by samples appended to an input).
  */
 void MathTraceComputer::compute(const QString& expression,
                                 const QMap<QString, DataSeriesPointer>& variableMapping,
                                 MathDataSeriesPointer outputSeries,
-                                double maxGapSize)
+                                double maxGapSize,
+                                double startTime)
 {
     QMutexLocker locker(&computeMutex);
 
@@ -32,6 +45,7 @@ void MathTraceComputer::compute(const QString& expression,
     currentVariableMapping = variableMapping;
     currentOutputSeries = outputSeries;
     currentMaxGapSize = maxGapSize;
+    currentStartTime = startTime;
     cancelRequested = false;
 }
 
@@ -40,19 +54,24 @@ void MathTraceComputer::compute(const QString& expression,
  *
  * Algorithm:
  * 1. Parse and validate expression
- * 2. Collect all unique timestamps from input series (creates timestamp union)
- * 3. For each timestamp:
+ * 2. Merge the timestamps of the input series (the union is streamed, a block at a time)
+ * 3. Split the timeline into chunks, which are evaluated concurrently. For each timestamp:
  *    - Check if it's in a valid region (not in large gap)
  *    - Interpolate values from all input series at that timestamp
  *    - Evaluate expression with interpolated values
  *    - Add result to output series (if valid)
- * 4. Emit progress updates periodically
+ * 4. Append the results of each chunk (in order), and emit progress updates periodically
+ *
+ * A complete computation is loaded from the MathTraceCache instead, if the same expression has
+ * already been computed from identical inputs (and is stored in the cache after computation).
  *
  * This creates a new series with timestamps from ALL input series combined,
  * preserving maximum data fidelity.
  */
 void MathTraceComputer::startComputation()
 {
+    TRACE_SCOPE("Math Trace", "math");
+
     QElapsedTimer timer;
     timer.start();
 
@@ -87,101 +106,170 @@ void MathTraceComputer::startComputation()
         }
     }
 
-    // Collect all unique timestamps from input series
-    qDebug() << "Collecting timestamps from input series...";
-    QVector<double> timestamps = collectTimestamps(currentVariableMapping);
+    // Compile the expression, with each required variable bound to a slot (in order)
+    MathProgram program;
+    if (!parser.compile(requiredVars, program))
+    {
+        emit computationFailed(QString("Failed to compile expression: %1").arg(parser.getError()));
+        return;
+    }
+
+    const bool incremental = currentStartTime > -std::numeric_limits<double>::infinity();
+
+    // The timestamps and the values are read from the same snapshot of each series
+    std::vector<DataSnapshot> snapshots;
+    QMap<QString, size_t> snapshotIndex;
+    QMap<QString, DataSnapshot> inputSnapshots;
+
+    uint64_t inputCount = 0;
+    size_t largest = 0;
+
+    for (auto it = currentVariableMapping.begin(); it != currentVariableMapping.end(); ++it)
+    {
+        snapshotIndex[it.key()] = snapshots.size();
+        snapshots.push_back(it.value()->getSnapshot());
+        inputSnapshots[it.key()] = snapshots.back();
+
+        inputCount += snapshots.back().size();
+
+        if (snapshots.back().size() > snapshots[largest].size()) largest = snapshots.size() - 1;
+    }
 
-    if (timestamps.isEmpty())
+    if (inputCount == 0)
     {
         emit computationFailed("No timestamps found in input series");
         return;
     }
 
-    qDebug() << "Found" << timestamps.size() << "unique timestamps";
-
-    // Clear existing data in output series
-    currentOutputSeries->clearData(false);
+    // A complete computation may already have been stored (e.g. in a previous session)
+    MathTraceCache* cache = MathTraceCache::getInstance();
 
-    // Main computation loop: evaluate expression at each timestamp
-    int lastProgress = -1;
-    int validPoints = 0;
-    int skippedPoints = 0;
+    QByteArray cacheKey;
 
-    for (int i = 0; i < timestamps.size(); ++i)
+    if (!incremental && cache->isEnabled())
     {
-        // Check for cancellation request from user
-        if (cancelRequested)
+        cacheKey = MathTraceCache::getKey(currentExpression, inputSnapshots, currentMaxGapSize);
+
+        if (cache->load(cacheKey, *currentOutputSeries))
         {
-            emit computationFailed("Computation cancelled");
+            currentOutputSeries->setInputSnapshots(inputSnapshots, currentMaxGapSize);
+            currentOutputSeries->update();
+
+            qDebug() << "Math trace loaded from cache:" << currentOutputSeries->size() << "points in" << timer.elapsed() << "ms";
+
+            emit progressUpdated(100);
+            emit computationComplete();
             return;
         }
+    }
 
-        double timestamp = timestamps[i];
+    std::vector<size_t> variableIndex;
 
-        // Skip timestamps in large gaps (prevents wild interpolation across disconnected regions)
-        if (!isTimestampValid(timestamp, currentVariableMapping, currentMaxGapSize))
-        {
-            skippedPoints++;
-            continue;
-        }
+    for (const QString& var : requiredVars)
+    {
+        variableIndex.push_back(snapshotIndex[var]);
+    }
 
-        // Interpolate values for each variable at this timestamp using linear interpolation
-        QMap<QString, double> variableValues;
-        bool allValid = true;
+    // The timeline is split into chunks (at the timestamps of the largest input), which are
+    // evaluated concurrently. Timestamps equal to a boundary belong to the following chunk.
+    const DataSnapshot& reference = snapshots[largest];
 
-        for (const QString& var : requiredVars)
-        {
-            DataSeriesPointer series = currentVariableMapping[var];
-            double value = series->getValueAtTime(timestamp, DataSeries::INTERPOLATE);
+    const uint64_t idx_start = reference.lowerBound(currentStartTime);
+    const uint64_t n_reference = reference.size() - idx_start;
 
-            // Check for NaN or Inf (can occur at boundaries or with invalid data)
-            if (std::isnan(value) || std::isinf(value))
-            {
-                allValid = false;
-                break;
-            }
+    // A chunk of an integral would have to evaluate every preceding point, so it is not split
+    const uint64_t chunkCount = program.hasUnboundedHistory() ?
+                1 : std::max<uint64_t>(1, (n_reference + CHUNK_SAMPLES - 1) / CHUNK_SAMPLES);
 
-            variableValues[var] = value;
-        }
+    std::vector<double> boundaries;
 
-        if (!allValid)
-        {
-            skippedPoints++;
-            continue;
-        }
+    boundaries.push_back(currentStartTime);
+
+    for (uint64_t k = 1; k < chunkCount; k++)
+    {
+        const double t = reference.getTimestamp(idx_start + k * n_reference / chunkCount);
+
+        if (t > boundaries.back()) boundaries.push_back(t);
+    }
+
+    boundaries.push_back(std::numeric_limits<double>::infinity());
+
+    const size_t chunks = boundaries.size() - 1;
+
+    // The output no longer matches any input snapshots until the computation is complete
+    currentOutputSeries->setInputSnapshots(QMap<QString, DataSnapshot>(), currentMaxGapSize);
+
+    // Clear existing data in output series (or only the points being re-computed)
+    if (incremental)
+    {
+        currentOutputSeries->truncate(currentStartTime, false);
+    }
+    else
+    {
+        currentOutputSeries->clearData(false);
+    }
+
+    // Chunks are evaluated in batches, and the results of each batch are appended (in order)
+    // before the next batch is started, which limits the memory used by pending results
+    QThreadPool* pool = QThreadPool::globalInstance();
+
+    const size_t batchSize = std::max(1, 2 * pool->maxThreadCount());
+
+    std::vector<ChunkResult> results;
+
+    uint64_t validPoints = 0;
+    uint64_t skippedPoints = 0;
+    uint64_t totalTimestamps = 0;
+
+    int nextProgress = 0;
+
+    for (size_t first = 0; first < chunks; first += batchSize)
+    {
+        const size_t count = std::min(batchSize, chunks - first);
+
+        results.assign(count, ChunkResult());
+
+        parallelFor(count, [&](size_t idx) {
+            computeChunk(program, snapshots, variableIndex, boundaries[first + idx], boundaries[first + idx + 1], results[idx]);
+        }, pool);
 
-        // Evaluate the expression
-        double result = 0.0;
-        if (!parser.evaluate(variableValues, result))
+        // Check for cancellation request from user
+        if (cancelRequested)
         {
-            skippedPoints++;
-            continue;
+            emit computationFailed("Computation cancelled");
+            return;
         }
 
-        // Check if result is valid
-        if (std::isnan(result) || std::isinf(result))
+        for (const auto& result : results)
         {
-            skippedPoints++;
-            continue;
-        }
+            currentOutputSeries->addData(result.timestamps, result.values, false);
 
-        // Add computed point to output series
-        currentOutputSeries->addData(timestamp, result, false);
-        validPoints++;
+            validPoints += result.timestamps.size();
+            skippedPoints += result.skipped;
+            totalTimestamps += result.total;
+        }
 
         // Report progress periodically (every 10%)
-        int progress = (i * 100) / timestamps.size();
-        if (progress != lastProgress && progress % 10 == 0)
+        int progress = (int) (((first + count) * 100) / chunks);
+        if (progress >= nextProgress && progress < 100)
         {
             emit progressUpdated(progress);
-            lastProgress = progress;
+            nextProgress = (progress / 10 + 1) * 10;
         }
     }
 
+    currentOutputSeries->setInputSnapshots(inputSnapshots, currentMaxGapSize);
+
+    if (!cacheKey.isEmpty() && validPoints > 0)
+    {
+        cache->store(cacheKey, currentOutputSeries->getSnapshot());
+    }
+
     // Trigger data update on the output series
     currentOutputSeries->update();
 
-    if (validPoints == 0)
+    // (An incremental update may have no new points)
+    if (validPoints == 0 && !incremental)
     {
         emit computationFailed(QString("Expression produced no valid results (%1 points skipped) - check for division by zero or invalid operations").arg(skippedPoints));
         return;
@@ -191,12 +279,155 @@ void MathTraceComputer::startComputation()
     qDebug() << "  - Time elapsed:" << timer.elapsed() << "ms";
     qDebug() << "  - Valid points:" << validPoints;
     qDebug() << "  - Skipped points:" << skippedPoints;
-    qDebug() << "  - Total timestamps:" << timestamps.size();
+    qDebug() << "  - Total timestamps:" << totalTimestamps;
 
     emit progressUpdated(100);
     emit computationComplete();
 }
 
+/**
+ * @brief Evaluate the expression at every timestamp (of the union of the inputs) within a range
+ *
+ * Each chunk reads the inputs through its own cursors, so chunks may be evaluated concurrently.
+ * The expression is evaluated one block of timestamps at a time: the inputs are interpolated
+ * into columns (indexed by slot), and the whole block is evaluated at once (see MathProgram::evaluateBlock).
+ *
+ * Stateful expressions (e.g. movavg) are first evaluated over the history which precedes the
+ * chunk (see MathProgram::getHistoryStart), so that a chunk produces the same points as a
+ * sequential evaluation of the whole timeline. Points of the history are not output.
+ *
+ * @param program Compiled expression
+ * @param snapshots Input series (every series in the variable mapping)
+ * @param variableIndex Index of the input series for each slot of the program
+ * @param t_begin Start of the range (inclusive)
+ * @param t_end End of the range (exclusive)
+ * @param result Output for the valid points (and the number of skipped points)
+ */
+void MathTraceComputer::computeChunk(const MathProgram& program,
+                                     const std::vector<DataSnapshot>& snapshots,
+                                     const std::vector<size_t>& variableIndex,
+                                     double t_begin, double t_end,
+                                     ChunkResult& result)
+{
+    double t_first = t_begin;
+
+    if (program.isStateful())
+    {
+        // The preceding point is the latest timestamp (of any input) before t
+        t_first = program.getHistoryStart(t_begin, [&snapshots](double t) {
+            double previous = -std::numeric_limits<double>::infinity();
+
+            for (const auto& snapshot : snapshots)
+            {
+                const uint64_t idx = snapshot.lowerBound(t);
+
+                if (idx > 0) previous = std::max(previous, snapshot.getTimestamp(idx - 1));
+            }
+
+            return previous;
+        });
+    }
+
+    MathProgram::State state;
+    program.reset(state);
+
+    // Timestamps are visited in order, so each series is read through a cursor (rather than a
+    // separate binary search for every lookup), and its gaps are checked in order
+    std::vector<DataCursor> cursors;
+    std::vector<GapList> gaps;
+
+    for (const auto& snapshot : snapshots)
+    {
+        cursors.push_back(DataCursor(snapshot));
+        gaps.push_back(GapList(snapshot, currentMaxGapSize, t_first, t_end));
+    }
+
+    TimestampMerger merger(snapshots, t_first, t_end);
+
+    const size_t blockSize = MathProgram::BLOCK_SIZE;
+    const size_t slotCount = variableIndex.size();
+
+    std::vector<std::vector<double>> inputColumns(slotCount, std::vector<double>(blockSize));
+    std::vector<const double*> inputs;
+
+    for (const auto& column : inputColumns)
+    {
+        inputs.push_back(column.data());
+    }
+
+    std::vector<double> timestamps(blockSize);
+    std::vector<double> values(blockSize);
+    std::vector<unsigned char> valid(blockSize);
+
+    for (;;)
+    {
+        // The batch is abandoned if cancelled
+        if (cancelRequested)
+        {
+            return;
+        }
+
+        const size_t count = merger.read(timestamps.data(), blockSize);
+
+        if (count == 0)
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            double timestamp = timestamps[i];
+
+            // Skip timestamps in large gaps (prevents wild interpolation across disconnected regions)
+            valid[i] = 1;
+
+            for (auto& gap : gaps)
+            {
+                if (gap.contains(timestamp)) valid[i] = 0;
+            }
+
+            // Interpolate values for each variable at this timestamp using linear interpolation
+            for (size_t v = 0; v < slotCount; ++v)
+            {
+                double value = valid[i] ? cursors[variableIndex[v]].interpolate(timestamp) : 0.0;
+
+                // Check for NaN or Inf (can occur at boundaries or with invalid data)
+                if (std::isnan(value) || std::isinf(value))
+                {
+                    valid[i] = 0;
+                    value = 0.0;
+                }
+
+                inputColumns[v][i] = value;
+            }
+        }
+
+        // Evaluate the expression (points which fail evaluation are marked invalid)
+        program.evaluateBlock(inputs.data(), count, values.data(), valid.data(), timestamps.data(), &state);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            // (history preceding the chunk)
+            if (timestamps[i] < t_begin)
+            {
+                continue;
+            }
+
+            result.total++;
+
+            // Check if result is valid
+            if (!valid[i] || std::isnan(values[i]) || std::isinf(values[i]))
+            {
+                result.skipped++;
+                continue;
+            }
+
+            result.timestamps.push_back(timestamps[i]);
+            result.values.push_back(values[i]);
+        }
+    }
+}
+
 void MathTraceComputer::cancelComputation()
 {
     QMutexLocker locker(&computeMutex);
@@ -204,7 +435,7 @@ void MathTraceComputer::cancelComputation()
 }
 
 /**
- * @brief Collect all unique timestamps from all input series
+ * @brief Prepare to merge the timestamps of the provided snapshots
  *
  * Creates the timestamp union - the set of all timestamps that appear in ANY input series.
  * This ensures we preserve all data points from all inputs.
@@ -214,46 +445,95 @@ void MathTraceComputer::cancelComputation()
  *   Series B timestamps: [5, 15, 25]
  *   Result: [0, 5, 10, 15, 20, 25]  (sorted, unique)
  *
- * @param series Map of input series
- * @return Sorted vector of all unique timestamps (in milliseconds)
+ * @param snapshots Input series (each sorted by timestamp)
+ * @param t_begin Only timestamps from t_begin (inclusive)...
+ * @param t_end ...to t_end (exclusive) are merged
  */
-QVector<double> MathTraceComputer::collectTimestamps(const QMap<QString, DataSeriesPointer>& series)
+TimestampMerger::TimestampMerger(const std::vector<DataSnapshot>& snapshots, double t_begin, double t_end)
 {
-    // Use std::set for automatic sorting and deduplication (O(log n) insert)
-    std::set<double> timestampSet;
+    inputs.reserve(snapshots.size());
+
+    std::vector<const DataSnapshot*> merged;
 
-    // Collect all timestamps from all input series
-    for (auto it = series.begin(); it != series.end(); ++it)
+    for (const auto& snapshot : snapshots)
     {
-        DataSeriesPointer s = it.value();
+        // Series which share their timestamps (e.g. columns of the same table) are merged once
+        bool duplicate = false;
 
-        for (uint64_t i = 0; i < s->size(); ++i)
+        for (const auto* other : merged)
         {
-            double timestamp = s->getTimestamp(i);
-            timestampSet.insert(timestamp);  // Duplicates automatically ignored
+            duplicate |= other->hasSameTimestamps(snapshot);
         }
+
+        if (duplicate) continue;
+
+        merged.push_back(&snapshot);
+
+        const uint64_t idx_first = snapshot.lowerBound(t_begin);
+        const uint64_t idx_last = snapshot.lowerBound(t_end);
+
+        if (idx_last <= idx_first) continue;
+
+        Input input;
+
+        input.view = snapshot.getView(idx_first, idx_last);
+        input.position = input.view.begin();
+        input.end = input.view.end();
+
+        heap.push_back(std::make_pair(input.position.getTimestamp(), inputs.size()));
+        inputs.push_back(input);
+
+        inputCount += idx_last - idx_first;
     }
 
-    // Convert set to vector (already sorted by std::set)
-    QVector<double> timestamps;
-    timestamps.reserve(timestampSet.size());
+    std::make_heap(heap.begin(), heap.end(), std::greater<std::pair<double, size_t>>());
+}
+
+size_t TimestampMerger::read(double* output, size_t n)
+{
+    const std::greater<std::pair<double, size_t>> order;
 
-    for (double timestamp : timestampSet)
+    size_t count = 0;
+
+    while (count < n && !heap.empty())
     {
-        timestamps.append(timestamp);
+        // Remove the input with the earliest timestamp
+        std::pop_heap(heap.begin(), heap.end(), order);
+
+        const double timestamp = heap.back().first;
+        Input& input = inputs[heap.back().second];
+
+        // Duplicates (in the same or different series) are ignored
+        if (!started || timestamp != previous)
+        {
+            output[count++] = timestamp;
+            previous = timestamp;
+            started = true;
+        }
+
+        consumedCount++;
+
+        // Return the input to the heap at its next timestamp (if not exhausted)
+        if (++input.position != input.end)
+        {
+            heap.back().first = input.position.getTimestamp();
+            std::push_heap(heap.begin(), heap.end(), order);
+        }
+        else
+        {
+            heap.pop_back();
+        }
     }
 
-    return timestamps;
+    return count;
 }
 
 /**
- * @brief Check if a timestamp is valid for computation (not in a large gap)
- *
- * This prevents wildly inaccurate interpolation across disconnected data regions.
+ * @brief Find the large gaps of a series
  *
  * A timestamp is considered INVALID if it falls in a gap larger than maxGapSize
- * in ANY input series. This ensures we only compute where we have reasonable
- * data coverage.
+ * in ANY input series. This prevents wildly inaccurate interpolation across
+ * disconnected data regions.
  *
  * Example (maxGapSize = 1000ms):
  *   Series A: [0ms, 10ms, 2000ms, 2010ms]  (gap of 1990ms between 10 and 2000)
@@ -261,57 +541,45 @@ QVector<double> MathTraceComputer::collectTimestamps(const QMap<QString, DataSer
  *   Timestamp 5ms: VALID (between 0 and 10, gap only 10ms)
  *   Timestamp 2005ms: VALID (between 2000 and 2010, gap only 10ms)
  *
- * @param timestamp The timestamp to check (milliseconds)
- * @param series Map of input series to check
+ * Timestamps more than maxGapSize before the first sample (or after the last sample) are also invalid.
+ *
+ * @param snapshot Input series
  * @param maxGapSize Maximum acceptable gap size (milliseconds)
- * @return true if timestamp is valid for computation, false if in large gap
+ * @param t_begin Only gaps which affect timestamps from t_begin (inclusive)...
+ * @param t_end ...to t_end (exclusive) are recorded
  */
-bool MathTraceComputer::isTimestampValid(double timestamp,
-                                        const QMap<QString, DataSeriesPointer>& series,
-                                        double maxGapSize)
+GapList::GapList(const DataSnapshot& snapshot, double maxGapSize, double t_begin, double t_end)
 {
-    // Check each input series - timestamp must be valid in ALL series
-    for (auto it = series.begin(); it != series.end(); ++it)
-    {
-        DataSeriesPointer s = it.value();
+    if (snapshot.isEmpty()) return;
 
-        // Find the index where this timestamp would be inserted (binary search)
-        uint64_t idx = s->getIndexForTimestamp(timestamp);
+    const uint64_t size = snapshot.size();
 
-        // Handle boundary cases (before first point or after last point)
-        if (idx == 0 || idx >= s->size())
-        {
-            // Check distance to nearest actual data point
-            if (idx == 0 && s->size() > 0)
-            {
-                double nearestTime = s->getTimestamp(0);
-                if (fabs(timestamp - nearestTime) > maxGapSize)
-                {
-                    return false;
-                }
-            }
-            else if (idx >= s->size() && s->size() > 0)
-            {
-                double nearestTime = s->getTimestamp(s->size() - 1);
-                if (fabs(timestamp - nearestTime) > maxGapSize)
-                {
-                    return false;
-                }
-            }
-        }
-        else
+    t_before = snapshot.getTimestamp(0) - maxGapSize;
+    t_after = snapshot.getTimestamp(size - 1) + maxGapSize;
+
+    // A timestamp t lies between the last sample at (or before) t and the following sample
+    uint64_t idx_first = snapshot.upperBound(t_begin);
+    uint64_t idx_last = std::min(size, snapshot.lowerBound(t_end) + 1);
+
+    if (idx_first > 0) idx_first--;
+
+    if (idx_last < idx_first + 2) return;
+
+    double previous = 0;
+    bool started = false;
+
+    snapshot.getView(idx_first, idx_last).visitSegments([&](const DataView::Segment& segment) {
+        for (size_t ii = 0; ii < segment.length; ii++)
         {
-            // Check gap size around this timestamp
-            double timeBefore = s->getTimestamp(idx - 1);
-            double timeAfter = s->getTimestamp(idx);
-            double gapSize = timeAfter - timeBefore;
+            const double t = snapshot.applyTimeScaling(segment.getTimestamp(ii));
 
-            if (gapSize > maxGapSize)
+            if (started && t - previous > maxGapSize)
             {
-                return false;
+                spans.push_back(std::make_pair(previous, t));
             }
-        }
-    }
 
-    return true;
+            previous = t;
+            started = true;
+        }
+    });
 }
@@ -4,20 +4,114 @@
 #include <QObject>
 #include <QThread>
 #include <QMutex>
+#include <atomic>
+#include <limits>
+#include <utility>
+#include <vector>
 #include "data_series.hpp"
 #include "math_data_series.hpp"
 #include "math_expression_parser.hpp"
 
+/**
+ * @brief The TimestampMerger class produces the union of the timestamps of several series
+ *
+ * The timestamps of each series are already sorted, so the union is a streaming k-way
+ * merge (with duplicates removed), read a block at a time. The union is never stored
+ * in full, and no memory is allocated per timestamp.
+ */
+class TimestampMerger
+{
+public:
+    TimestampMerger(const std::vector<DataSnapshot>& snapshots,
+                    double t_begin = -std::numeric_limits<double>::infinity(),
+                    double t_end = std::numeric_limits<double>::infinity());
+
+    /**
+     * @brief Read the next timestamps of the union (in ascending order)
+     * @param output Output array (with space for n timestamps)
+     * @param n Maximum number of timestamps to read
+     * @return Number of timestamps read (less than n once the union is exhausted)
+     */
+    size_t read(double* output, size_t n);
+
+    //! Total number of input samples (across every series, including duplicates, but excluding series with the same timestamps as another)
+    uint64_t getInputCount() const { return inputCount; }
+
+    //! Number of input samples consumed so far
+    uint64_t getConsumedCount() const { return consumedCount; }
+
+private:
+    struct Input
+    {
+        DataView view;
+        DataView::const_iterator position;
+        DataView::const_iterator end;
+    };
+
+    std::vector<Input> inputs;
+
+    //! Min-heap of (next timestamp, input index), for inputs which are not yet exhausted
+    std::vector<std::pair<double, size_t>> heap;
+
+    uint64_t inputCount = 0;
+    uint64_t consumedCount = 0;
+
+    //! Most recently emitted timestamp (for removing duplicates)
+    double previous = 0;
+    bool started = false;
+};
+
+/**
+ * @brief The GapList class records the gaps of a series which are too large to interpolate across
+ *
+ * Gaps are found by a single pass over the timestamps of the series (within the required range).
+ * Timestamps are then checked in ascending order, by advancing through the gaps, rather than by
+ * a lookup into the series for every timestamp.
+ */
+class GapList
+{
+public:
+    GapList(const DataSnapshot& snapshot, double maxGapSize,
+            double t_begin = -std::numeric_limits<double>::infinity(),
+            double t_end = std::numeric_limits<double>::infinity());
+
+    /**
+     * @brief Check whether a timestamp lies within a gap
+     * @param t Timestamp (not less than any previously checked timestamp)
+     */
+    bool contains(double t)
+    {
+        if (t < t_before || t > t_after) return true;
+
+        while (position < spans.size() && spans[position].second <= t) position++;
+
+        return position < spans.size() && spans[position].first <= t;
+    }
+
+    //! Number of gaps between samples (within the required range)
+    size_t getGapCount() const { return spans.size(); }
+
+private:
+    //! Gaps [first, second) between consecutive samples
+    std::vector<std::pair<double, double>> spans;
+    size_t position = 0;
+
+    //! Timestamps before t_before (or after t_after) are too far from the first (or last) sample
+    double t_before = -std::numeric_limits<double>::infinity();
+    double t_after = std::numeric_limits<double>::infinity();
+};
+
 /**
  * @brief The MathTraceComputer class performs background computation of math traces
  *
- * This class runs in a background thread and:
- * 1. Merges timestamps from all input series
+ * This class runs in a background thread (evaluating chunks of the timeline concurrently,
+ * using the global thread pool) and:
+ * 1. Merges timestamps from all input series (see TimestampMerger)
  * 2. Interpolates values at each timestamp
  * 3. Evaluates the mathematical expression
  * 4. Populates the output MathDataSeries with computed points
  *
- * Large gaps in data are handled by not interpolating across them.
+ * Large gaps in data are handled by not interpolating across them (see GapList).
  */
 class MathTraceComputer : public QObject
 {
@@ -27,17 +121,47 @@ public:
     MathTraceComputer();
     virtual ~MathTraceComputer();
 
+    //! Approximate number of samples (of the largest input) in each concurrently evaluated chunk
+    static const uint64_t CHUNK_SAMPLES = 1 << 18;
+
     /**
      * @brief Compute a math trace from input series and expression
      * @param expression Mathematical expression to evaluate
      * @param variableMapping Map of variable names to input series
      * @param outputSeries The series to populate with computed results
      * @param maxGapSize Maximum gap (in ms) to interpolate across. Larger gaps are left empty.
+     * @param startTime Only points from this time onwards are (re-)computed; earlier points of the output are retained
      */
     void compute(const QString& expression,
                  const QMap<QString, DataSeriesPointer>& variableMapping,
                  MathDataSeriesPointer outputSeries,
-                 double maxGapSize = 1000.0);  // Default: 1 second
+                 double maxGapSize = 1000.0,  // Default: 1 second
+                 double startTime = -std::numeric_limits<double>::infinity());
+
+    //! Valid points computed for a single chunk of the timeline
+    struct ChunkResult
+    {
+        std::vector<double> timestamps;
+        std::vector<double> values;
+
+        //! Number of timestamps in the chunk which did not produce a valid point
+        uint64_t skipped = 0;
+
+        //! Number of timestamps in the chunk
+        uint64_t total = 0;
+    };
+
+    /**
+     * @brief Evaluate a range of the timeline (using the maximum gap size set by compute)
+     *
+     * Chunks read the inputs through their own cursors, so they may be evaluated concurrently
+     * (see also MathCurveUpdater, which evaluates only the chunks which are visible).
+     */
+    void computeChunk(const MathProgram& program,
+                      const std::vector<DataSnapshot>& snapshots,
+                      const std::vector<size_t>& variableIndex,
+                      double t_begin, double t_end,
+                      ChunkResult& result);
 
 signals:
     /**
@@ -74,30 +198,14 @@ public slots:
     void cancelComputation();
 
 private:
-    /**
-     * @brief Collect all unique timestamps from input series
-     * @return Sorted list of timestamps
-     */
-    QVector<double> collectTimestamps(const QMap<QString, DataSeriesPointer>& series);
-
-    /**
-     * @brief Check if a timestamp should be skipped due to large gaps
-     * @param timestamp Current timestamp
-     * @param series Input series to check
-     * @param maxGapSize Maximum allowed gap
-     * @return true if timestamp is within valid data regions
-     */
-    bool isTimestampValid(double timestamp,
-                         const QMap<QString, DataSeriesPointer>& series,
-                         double maxGapSize);
-
     QString currentExpression;
     QMap<QString, DataSeriesPointer> currentVariableMapping;
     MathDataSeriesPointer currentOutputSeries;
     double currentMaxGapSize;
+    double currentStartTime;
 
     QMutex computeMutex;
-    bool cancelRequested;
+    std::atomic<bool> cancelRequested;
 };
 
 #endif // MATH_TRACE_COMPUTER_HPP
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <memory>
+
+#include <QMutex>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include "parallel_for.hpp"
+
+
+/*
+ * Items which are shared by the caller and the helper tasks
+ */
+struct ParallelForState
+{
+    ParallelForState(size_t count, const std::function<void(size_t)>& func) : n(count), fn(func) {}
+
+    const size_t n;
+
+    //! Valid until every item has completed (helpers which start later do not call it)
+    const std::function<void(size_t)>& fn;
+
+    std::atomic<size_t> next{0};
+
+    QMutex mutex;
+    QWaitCondition complete;
+    size_t completed = 0;
+
+    void work(void)
+    {
+        size_t count = 0;
+
+        for (size_t idx = next++; idx < n; idx = next++)
+        {
+            fn(idx);
+            count++;
+        }
+
+        if (count == 0) return;
+
+        QMutexLocker lock(&mutex);
+
+        completed += count;
+
+        if (completed == n) complete.wakeAll();
+    }
+};
+
+
+class ParallelForTask : public QRunnable
+{
+public:
+    ParallelForTask(std::shared_ptr<ParallelForState> s) : state(s) { setAutoDelete(true); }
+
+    virtual void run() override { state->work(); }
+
+protected:
+    std::shared_ptr<ParallelForState> state;
+};
+
+
+void parallelFor(size_t n, const std::function<void(size_t)>& fn, QThreadPool* pool)
+{
+    if (n == 0) return;
+
+    auto state = std::make_shared<ParallelForState>(n, fn);
+
+    const size_t helpers = std::min<size_t>(n, std::max(1, pool->maxThreadCount())) - 1;
+
+    for (size_t ii = 0; ii < helpers; ii++)
+    {
+        pool->start(new ParallelForTask(state));
+    }
+
+    state->work();
+
+    QMutexLocker lock(&state->mutex);
+
+    while (state->completed < n)
+    {
+        state->complete.wait(&state->mutex);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef PARALLEL_FOR_HPP
+#define PARALLEL_FOR_HPP
+
+#include <functional>
+
+#include <QThreadPool>
+
+
+/**
+ * @brief parallelFor - Call fn(idx) for every idx in [0, n), using the threads of the pool
+ *
+ * The calling thread also processes items, so this may be called from a pool thread
+ * (if every other pool thread is busy, the caller simply processes every item itself).
+ * Returns once every item has been processed.
+ *
+ * @param n is the number of items
+ * @param fn is called (concurrently) for each item
+ * @param pool is the thread pool to use
+ */
+void parallelFor(size_t n, const std::function<void(size_t)>& fn, QThreadPool* pool);
+
+
+#endif // PARALLEL_FOR_HPP
@@ -0,0 +1,636 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <QByteArray>
+
+#include "parse_kernels.hpp"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define PARSE_KERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PARSE_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PARSE_KERNELS_SWAR
+#endif
+
+
+//! Powers of ten which are exactly representable as doubles
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const int MAX_EXACT_POWER = 22;
+
+//! Largest mantissa which is exactly representable as a double
+static const uint64_t MAX_EXACT_MANTISSA = 1ULL << 53;
+
+//! Significant digits which always fit within a 64-bit mantissa
+static const int MAX_MANTISSA_DIGITS = 19;
+
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+
+static inline void trim(const char*& begin, const char*& end)
+{
+    while (begin < end && isSpace(*begin)) begin++;
+    while (end > begin && isSpace(end[-1])) end--;
+}
+
+
+static inline double powerOfTen(size_t n)
+{
+    return n <= (size_t) MAX_EXACT_POWER ? POWERS_OF_TEN[n] : pow(10, (double) n);
+}
+
+
+/*
+ * Convert 8 ASCII digits to an integer, in parallel within a 64-bit word (little-endian)
+ */
+#ifdef PARSE_KERNELS_SWAR
+static inline uint64_t parseEightDigits(const char* p)
+{
+    uint64_t word = 0;
+    memcpy(&word, p, sizeof(word));
+
+    word -= 0x3030303030303030ULL;
+
+    // Pairs, then groups of four digits
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+    return word;
+}
+#endif
+
+
+/*
+ * Convert a run of digits to an integer (the caller must ensure that it does not overflow)
+ */
+static inline uint64_t parseDigits(const char* p, const char* end, uint64_t value)
+{
+#ifdef PARSE_KERNELS_SWAR
+    for (; end - p >= 8; p += 8)
+    {
+        value = value * 100000000ULL + parseEightDigits(p);
+    }
+#endif
+
+    for (; p < end; p++)
+    {
+        value = value * 10 + (uint64_t) (*p - '0');
+    }
+
+    return value;
+}
+
+
+/*
+ * Accumulate a run of digits into the mantissa, starting from p.
+ * Leading zeros are not significant, so they are not counted as digits of the mantissa.
+ * Returns the end of the run.
+ */
+static inline const char* readDigits(const char* p, const char* end, uint64_t& mantissa, int& digits)
+{
+    const char* run = p + ParseKernels::scanDigits(p, end);
+
+    if (mantissa == 0)
+    {
+        while (p < run && *p == '0') p++;
+    }
+
+    digits += (int) (run - p);
+
+    // Too many digits for the fast path (the mantissa is not used)
+    if (digits > MAX_MANTISSA_DIGITS) return run;
+
+    mantissa = parseDigits(p, run, mantissa);
+
+    return run;
+}
+
+
+/*
+ * Convert a decimal number, if the result is guaranteed to be correctly rounded:
+ * the mantissa and the power of ten are both exact, so a single multiplication (or division) is
+ * correctly rounded (Clinger's fast path). This covers almost every value written to a log file.
+ * Returns false if the conversion must be performed in full (or the text is not a decimal number).
+ */
+static bool parseDecimal(const char* p, const char* end, double& value)
+{
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    const char* integer = p;
+
+    p = readDigits(p, end, mantissa, digits);
+
+    bool valid = p > integer;
+
+    if (p < end && *p == '.')
+    {
+        p++;
+
+        const char* fraction = p;
+
+        p = readDigits(p, end, mantissa, digits);
+
+        exponent = -(int) (p - fraction);
+        valid = valid || p > fraction;
+    }
+
+    if (!valid) return false;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+
+        bool negative_exponent = false;
+
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative_exponent = *p == '-';
+            p++;
+        }
+
+        const char* first = p;
+        int e = 0;
+
+        // (Large exponents are left for the full conversion)
+        while (p < end && isDigit(*p) && e < 10000)
+        {
+            e = e * 10 + (*p - '0');
+            p++;
+        }
+
+        if (p == first) return false;
+
+        exponent += negative_exponent ? -e : e;
+    }
+
+    if (p != end || digits > MAX_MANTISSA_DIGITS || mantissa > MAX_EXACT_MANTISSA) return false;
+
+    double result = (double) mantissa;
+
+    if (exponent < 0)
+    {
+        if (exponent < -MAX_EXACT_POWER) return false;
+
+        result /= POWERS_OF_TEN[-exponent];
+    }
+    else if (exponent > 0)
+    {
+        if (exponent > MAX_EXACT_POWER) return false;
+
+        result *= POWERS_OF_TEN[exponent];
+    }
+
+    value = negative ? -result : result;
+
+    return true;
+}
+
+
+/**
+ * @brief ParseKernels::parseDouble - Convert a number, e.g. "-12.5e3" (as for QByteArray::toDouble)
+ * @param begin is the first byte of the text
+ * @param end is one past the last byte
+ * @param value receives the number
+ * @return true if the whole text was converted
+ */
+bool ParseKernels::parseDouble(const char* begin, const char* end, double& value)
+{
+    trim(begin, end);
+
+    if (parseDecimal(begin, end, value)) return true;
+
+    // Anything else (e.g. 20 significant digits, large exponents, "inf") is converted in full
+    bool ok = false;
+
+    const double result = QByteArray::fromRawData(begin, (int) (end - begin)).toDouble(&ok);
+
+    if (ok)
+    {
+        value = result;
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief ParseKernels::parseTime - Convert a time of day, hh:mm:ss:ms or hh:mm:ss.fff (e.g. "12:30:05:250")
+ * Each of hh, mm and ss may be any number (missing fields are zero). The resolution of the
+ * fourth field depends on its length: "25" is 0.25 seconds, and "025" is 0.025 seconds.
+ * Any further fields are ignored.
+ * @param seconds receives the time in seconds
+ * @return true if every field was converted
+ */
+bool ParseKernels::parseTime(const char* begin, const char* end, double& seconds)
+{
+    trim(begin, end);
+
+    double fields[4] = {0, 0, 0, 0};
+
+    const char* field = begin;
+
+    for (int ii = 0; ii < 4; ii++)
+    {
+        const char* colon = (const char*) memchr(field, ':', end - field);
+
+        if (!colon) colon = end;
+
+        if (!parseDouble(field, colon, fields[ii])) return false;
+
+        // "Resolution" of milliseconds depends on the length of the provided string
+        if (ii == 3)
+        {
+            fields[ii] /= powerOfTen(colon - field);
+        }
+
+        if (colon == end) break;
+
+        field = colon + 1;
+    }
+
+    double t = fields[2];
+
+    t += (fields[1] * 60);
+    t += (fields[0] * 3600);
+    t += fields[3];
+
+    seconds = t;
+
+    return true;
+}
+
+
+/*
+ * Read exactly n digits
+ */
+static inline bool readFixed(const char*& p, const char* end, int n, int& value)
+{
+    if (end - p < n || ParseKernels::scanDigits(p, p + n) != (size_t) n) return false;
+
+    value = (int) parseDigits(p, p + n, 0);
+    p += n;
+
+    return true;
+}
+
+
+static inline bool readChar(const char*& p, const char* end, char c)
+{
+    if (p >= end || *p != c) return false;
+
+    p++;
+
+    return true;
+}
+
+
+static inline bool isLeapYear(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+
+static int getDaysInMonth(int year, int month)
+{
+    static const int DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    return month == 2 && isLeapYear(year) ? 29 : DAYS[month - 1];
+}
+
+
+/*
+ * Number of days from 1970-01-01 to the specified date (proleptic Gregorian calendar)
+ */
+static int64_t getDaysFromEpoch(int64_t year, int month, int day)
+{
+    year -= month <= 2;
+
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yoe = year - era * 400;
+    const int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+
+/*
+ * Fields of an ISO 8601 date and time (see readDateTime)
+ */
+struct DateTimeFields
+{
+    int64_t days = 0;
+
+    //! hh * 3600 + mm * 60 + ss
+    int seconds = 0;
+
+    //! Digits of the fraction of a second
+    const char* fraction = nullptr;
+    size_t fractionDigits = 0;
+
+    //! Offset of the time zone from UTC (seconds)
+    int zone = 0;
+};
+
+
+/*
+ * Read the fields of an ISO 8601 date and time (the text must be trimmed)
+ */
+static bool readDateTime(const char* p, const char* end, DateTimeFields& fields)
+{
+    int year = 0;
+    int month = 0;
+    int day = 0;
+
+    if (!readFixed(p, end, 4, year) || !readChar(p, end, '-') ||
+        !readFixed(p, end, 2, month) || !readChar(p, end, '-') ||
+        !readFixed(p, end, 2, day))
+    {
+        return false;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > getDaysInMonth(year, month)) return false;
+
+    fields.days = getDaysFromEpoch(year, month, day);
+
+    if (p < end && (*p == 'T' || *p == ' '))
+    {
+        p++;
+
+        int hh = 0;
+        int mm = 0;
+        int ss = 0;
+
+        if (!readFixed(p, end, 2, hh) || !readChar(p, end, ':') || !readFixed(p, end, 2, mm)) return false;
+
+        if (readChar(p, end, ':'))
+        {
+            if (!readFixed(p, end, 2, ss)) return false;
+
+            if (p < end && (*p == '.' || *p == ','))
+            {
+                p++;
+
+                size_t n = ParseKernels::scanDigits(p, end);
+
+                if (n == 0) return false;
+
+                fields.fraction = p;
+                fields.fractionDigits = n;
+
+                p += n;
+            }
+        }
+
+        if (hh > 23 || mm > 59 || ss > 60) return false;
+
+        fields.seconds = hh * 3600 + mm * 60 + ss;
+
+        // Time zone designator (offset from UTC)
+        if (!readChar(p, end, 'Z') && p < end && (*p == '+' || *p == '-'))
+        {
+            const int sign = *p == '-' ? -1 : 1;
+
+            p++;
+
+            int oh = 0;
+            int om = 0;
+
+            if (!readFixed(p, end, 2, oh)) return false;
+
+            readChar(p, end, ':');
+
+            if (p < end && !readFixed(p, end, 2, om)) return false;
+
+            if (oh > 23 || om > 59) return false;
+
+            fields.zone = sign * (oh * 3600 + om * 60);
+        }
+    }
+
+    return p == end;
+}
+
+
+/**
+ * @brief ParseKernels::parseDateTime - Convert an ISO 8601 date and time, e.g. "2024-03-01T12:30:05.250Z"
+ * The date may be followed by a time (separated by 'T' or a space) of hh:mm, hh:mm:ss or hh:mm:ss.fff,
+ * and a time zone of Z, +hh, +hh:mm or +hhmm. A time without a time zone is treated as UTC.
+ * @param seconds receives the time in seconds since the Unix epoch
+ * @return true if the whole text was converted
+ */
+bool ParseKernels::parseDateTime(const char* begin, const char* end, double& seconds)
+{
+    trim(begin, end);
+
+    DateTimeFields fields;
+
+    if (!readDateTime(begin, end, fields)) return false;
+
+    double fraction = 0;
+
+    if (fields.fractionDigits > 0)
+    {
+        // Digits beyond nanoseconds are not significant
+        const size_t used = fields.fractionDigits < 18 ? fields.fractionDigits : 18;
+
+        fraction = (double) parseDigits(fields.fraction, fields.fraction + used, 0) / powerOfTen(used);
+    }
+
+    double t = (double) fields.days * 86400;
+
+    t += fields.seconds + fraction;
+    t -= fields.zone;
+
+    seconds = t;
+
+    return true;
+}
+
+
+/*
+ * Convert (at most) the first "digits" digits of a fraction to an integer of exactly that many digits,
+ * rounding to nearest on the following digit
+ */
+static inline int64_t readFraction(const char* p, size_t n, int digits)
+{
+    const size_t used = n < (size_t) digits ? n : (size_t) digits;
+
+    int64_t value = (int64_t) parseDigits(p, p + used, 0);
+
+    for (size_t ii = used; ii < (size_t) digits; ii++) value *= 10;
+
+    if (n > used && p[used] >= '5') value++;
+
+    return value;
+}
+
+
+/**
+ * @brief ParseKernels::parseTicks - Convert a fixed point decimal number (e.g. "1709296205.123456789") exactly,
+ * to an integer number of ticks. Unlike parseDouble, the result does not depend on the magnitude of the number
+ * (so an epoch-based timestamp keeps its resolution). Digits beyond the resolution of a tick are rounded.
+ * @param exponent is the number of ticks in one unit of the text, as a power of ten (e.g. 9 for seconds to nanoseconds)
+ * @param ticks receives the number of ticks
+ * @return false if the text is not a fixed point number (e.g. it has an exponent), or does not fit in the range of ticks
+ */
+bool ParseKernels::parseTicks(const char* begin, const char* end, int exponent, int64_t& ticks)
+{
+    trim(begin, end);
+
+    if (exponent < 0 || exponent > 18) return false;
+
+    const char* p = begin;
+
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    const size_t n_integer = scanDigits(p, end);
+
+    const char* integer = p;
+
+    p += n_integer;
+
+    const char* fraction = p;
+    size_t n_fraction = 0;
+
+    if (p < end && *p == '.')
+    {
+        fraction = ++p;
+        n_fraction = scanDigits(p, end);
+        p += n_fraction;
+    }
+
+    if (p != end || (n_integer == 0 && n_fraction == 0)) return false;
+
+    // Leading zeros do not count towards the range
+    while (integer < fraction && *integer == '0') integer++;
+
+    const size_t digits = scanDigits(integer, end);
+
+    const int64_t scale = (int64_t) POWERS_OF_TEN[exponent];
+
+    if (digits > 18) return false;
+
+    const int64_t whole = (int64_t) parseDigits(integer, integer + digits, 0);
+
+    if (whole > (INT64_MAX - scale) / scale) return false;
+
+    const int64_t result = whole * scale + (n_fraction > 0 ? readFraction(fraction, n_fraction, exponent) : 0);
+
+    ticks = negative ? -result : result;
+
+    return true;
+}
+
+
+/**
+ * @brief ParseKernels::parseDateTimeTicks - Convert an ISO 8601 date and time exactly (see parseDateTime)
+ * @param ticks receives the time in nanoseconds since the Unix epoch (digits beyond nanoseconds are rounded)
+ * @return true if the whole text was converted
+ */
+bool ParseKernels::parseDateTimeTicks(const char* begin, const char* end, int64_t& ticks)
+{
+    trim(begin, end);
+
+    DateTimeFields fields;
+
+    if (!readDateTime(begin, end, fields)) return false;
+
+    const int64_t seconds = fields.days * 86400 + fields.seconds - fields.zone;
+
+    ticks = seconds * 1000000000LL + (fields.fractionDigits > 0 ? readFraction(fields.fraction, fields.fractionDigits, 9) : 0);
+
+    return true;
+}
+
+
+/**
+ * @brief ParseKernels::scanDigits - Count the ASCII digits at the start of the text
+ * @return the length of the run of digits
+ */
+size_t ParseKernels::scanDigits(const char* begin, const char* end)
+{
+    const char* p = begin;
+
+#if defined(PARSE_KERNELS_SSE2)
+    const __m128i lower = _mm_set1_epi8('0' - 1);
+    const __m128i upper = _mm_set1_epi8('9' + 1);
+
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*) p);
+
+        // (Bytes above 0x7F are negative, so are not digits)
+        const __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(bytes, lower), _mm_cmplt_epi8(bytes, upper));
+
+        const unsigned mask = (unsigned) _mm_movemask_epi8(digits);
+
+        if (mask != 0xFFFF)
+        {
+            return (p - begin) + __builtin_ctz(~mask);
+        }
+    }
+#elif defined(PARSE_KERNELS_NEON)
+    const uint8x16_t zero = vdupq_n_u8('0');
+
+    for (; end - p >= 16; p += 16)
+    {
+        const uint8x16_t bytes = vld1q_u8((const uint8_t*) p);
+
+        // Digits are at most 9 above '0' (other bytes wrap around)
+        if (vmaxvq_u8(vsubq_u8(bytes, zero)) > 9) break;
+    }
+#endif
+
+    while (p < end && isDigit(*p)) p++;
+
+    return p - begin;
+}
+
+
+const char* ParseKernels::getInstructionSet()
+{
+#if defined(PARSE_KERNELS_SSE2)
+    return "SSE2";
+#elif defined(PARSE_KERNELS_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
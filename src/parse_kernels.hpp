@@ -0,0 +1,36 @@
+#ifndef PARSE_KERNELS_H
+#define PARSE_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief The ParseKernels class provides conversion functions for importers, which read text in place.
+ *
+ * Each function parses a range of bytes [begin, end) (e.g. a field of a memory-mapped file), and
+ * does not depend on the locale (the decimal separator is always '.'). Leading and trailing
+ * whitespace is ignored.
+ *
+ * Runs of digits are located 16 bytes at a time (SSE2 on x86 / x86_64, NEON on ARM64),
+ * and converted 8 digits at a time.
+ */
+class ParseKernels
+{
+public:
+    static bool parseDouble(const char* begin, const char* end, double& value);
+
+    static bool parseTime(const char* begin, const char* end, double& seconds);
+    static bool parseDateTime(const char* begin, const char* end, double& seconds);
+
+    static bool parseTicks(const char* begin, const char* end, int exponent, int64_t& ticks);
+    static bool parseDateTimeTicks(const char* begin, const char* end, int64_t& ticks);
+
+    static size_t scanDigits(const char* begin, const char* end);
+
+    //! Name of the instruction set used to scan digits
+    static const char* getInstructionSet(void);
+};
+
+
+#endif // PARSE_KERNELS_H
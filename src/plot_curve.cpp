@@ -1,10 +1,22 @@
+#include <climits>
+#include <vector>
+
 #include <qelapsedtimer.h>
+#include <qpaintengine.h>
+#include <qpainter.h>
 #include <qwt_symbol.h>
+#include <qwt_plot.h>
 #include <qwt_plot_curve.h>
 #include <qwt_text_label.h>
 #include <qfont.h>
+#include <qmetaobject.h>
 
 #include "plot_curve.hpp"
+#include "plot_opengl_canvas.hpp"
+
+
+// A symbol every two pixels already overlaps its neighbours (for any visible symbol size)
+const double PlotCurve::MAX_SYMBOL_DENSITY = 0.5;
 
 
 
@@ -15,8 +27,7 @@
  */
 PlotCurve::PlotCurve(DataSeriesPointer s, PlotCurveUpdater *updater) : QwtPlotCurve(), series(s)
 {
-
-    // Create a new worker thread
+    // Create a new worker (resampling is performed by the shared thread pool)
     if (updater == nullptr)
     {
         updater = new PlotCurveUpdater(*s);
@@ -24,17 +35,21 @@ PlotCurve::PlotCurve(DataSeriesPointer s, PlotCurveUpdater *updater) : QwtPlotCu
 
     worker = updater;
 
+    sampleData = new PlotSeriesData();
+    setData(sampleData);
+
     if (!series.isNull())
     {
         QwtPlotCurve::setTitle((*series).getLabel());
 
         connect(&(*series), &DataSeries::styleUpdated, this, &PlotCurve::updateLineStyle);
         connect(&(*series), &DataSeries::styleUpdated, this, &PlotCurve::updateLabel);
+        connect(&(*series), &DataSeries::dataChanged, this, &PlotCurve::seriesUpdated);
 
         updateLineStyle();
     }
 
-    worker->moveToThread(&workerThread);
+    // Results are delivered (queued) to the GUI thread
     connect(worker, &PlotCurveUpdater::sampleComplete, this, &PlotCurve::onDataResampled);
 
     setPaintAttribute(QwtPlotCurve::PaintAttribute::ClipPolygons, true);
@@ -45,23 +60,229 @@ PlotCurve::PlotCurve(DataSeriesPointer s, PlotCurveUpdater *updater) : QwtPlotCu
 
 PlotCurve::~PlotCurve()
 {
-    // Wait for the resampling thread to complete
-    workerThread.quit();
-    workerThread.wait();
-
-    // Delete the worker thread
+    // Abandon any outstanding resampling, and wait for the pool to release the worker
     delete worker;
+
+    delete glBuffer;
+}
+
+
+/*
+ * In density mode, the curve is drawn as a single image (once the first density pass is available).
+ *
+ * Plain solid lines are drawn directly from a GPU vertex buffer, when the plot has an OpenGL canvas
+ * (the symbols of a dense curve are then blitted over the lines, see drawSymbols).
+ * Anything else (sparse symbols, styled pens, non-linear axes, printing or exporting) is drawn by QwtPlotCurve.
+ */
+void PlotCurve::drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                           const QRectF &canvasRect, int from, int to) const
+{
+    const PlotSamplesPointer& samples = sampleData->getSamples();
+
+    if (samples && !samples->density.isNull() && getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_DENSITY)
+    {
+        const QRectF& rect = samples->densityRect;
+
+        // Row zero of the image is the maximum value
+        QRectF target(QPointF(xMap.transform(rect.left()), yMap.transform(rect.bottom())),
+                      QPointF(xMap.transform(rect.right()), yMap.transform(rect.top())));
+
+        painter->drawImage(target, samples->density);
+        return;
+    }
+
+    const QwtPlot* p = plot();
+
+    PlotOpenGLCanvas* canvas = p ? dynamic_cast<PlotOpenGLCanvas*>(p->canvas()) : nullptr;
+
+    const bool symbols = symbol() != nullptr && symbol()->style() != QwtSymbol::NoSymbol;
+
+    const bool lines_only = style() == QwtPlotCurve::Lines && (!symbols || isSymbolDense(dataSize(), canvasRect.width()));
+
+    if (canvas && lines_only && from == 0 && (to < 0 || (size_t) to + 1 >= dataSize()))
+    {
+        if (glBuffer == nullptr)
+        {
+            glBuffer = new PlotCurveBuffer();
+        }
+
+        if (glBuffer->draw(painter, canvas, xMap, yMap, sampleData->getSamples(), sampleData->getRevision(),
+                           sampleData->getScaler(), sampleData->getOffset(), pen()))
+        {
+            if (symbols && dataSize() > 0)
+            {
+                painter->save();
+                drawSymbols(painter, *symbol(), xMap, yMap, canvasRect, 0, (int) dataSize() - 1);
+                painter->restore();
+            }
+
+            return;
+        }
+    }
+
+    QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, from, to);
+}
+
+
+/**
+ * @brief PlotCurve::isSymbolDense - Determine if the symbols of a curve would (mostly) overlap
+ * @param points - Number of drawn samples
+ * @param pixels - Width of the canvas
+ */
+bool PlotCurve::isSymbolDense(size_t points, double pixels)
+{
+    return pixels > 0 && points > pixels * MAX_SYMBOL_DENSITY;
+}
+
+
+/*
+ * Symbols of a sparse curve are drawn individually by QwtPlotCurve. A dense curve has thousands of overlapping symbols,
+ * which are blitted from a single pixmap instead (vector output, e.g. printing, still draws every symbol).
+ */
+void PlotCurve::drawSymbols(QPainter *painter, const QwtSymbol &symbol, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                            const QRectF &canvasRect, int from, int to) const
+{
+    const QPaintEngine *engine = painter->paintEngine();
+
+    const bool raster = engine && (engine->type() == QPaintEngine::Raster || engine->type() == QPaintEngine::OpenGL2);
+
+    if (raster && isSymbolDense((size_t) (to - from + 1), canvasRect.width()))
+    {
+        blitSymbols(painter, symbol, xMap, yMap, canvasRect, from, to);
+        return;
+    }
+
+    QwtPlotCurve::drawSymbols(painter, symbol, xMap, yMap, canvasRect, from, to);
+}
+
+
+/*
+ * Draw the symbols of a dense curve with a single batch of pixmap fragments.
+ * Consecutive samples at the same pixel (e.g. the min and max of a bucket of a flat region) share a symbol.
+ */
+void PlotCurve::blitSymbols(QPainter *painter, const QwtSymbol &symbol, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                            const QRectF &canvasRect, int from, int to) const
+{
+    const qreal ratio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+
+    const QRect bounds = symbol.boundingRect();
+
+    if (bounds.isEmpty()) return;
+
+    // The pixmap is rendered again when the style changes (see updateLineStyle), or on a screen with a different pixel ratio
+    if (symbolPixmap.isNull() || symbolPixmap.devicePixelRatio() != ratio)
+    {
+        QPixmap pixmap(bounds.size() * ratio);
+
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+
+        QPainter p(&pixmap);
+
+        p.setRenderHint(QPainter::Antialiasing, painter->testRenderHint(QPainter::Antialiasing));
+        symbol.drawSymbol(&p, QPointF(-bounds.left(), -bounds.top()));
+        p.end();
+
+        symbolPixmap = pixmap;
+    }
+
+    // Symbols which are centred outside the canvas may still overlap its edge
+    const QRectF clip = canvasRect.adjusted(-bounds.width(), -bounds.height(), bounds.width(), bounds.height());
+
+    // The fragment is scaled from device pixels, and centred on the symbol
+    const QPointF centre(bounds.left() + bounds.width() * 0.5, bounds.top() + bounds.height() * 0.5);
+    const QRectF source(0, 0, symbolPixmap.width(), symbolPixmap.height());
+
+    std::vector<QPainter::PixmapFragment> fragments;
+    fragments.reserve((size_t) (to - from + 1));
+
+    QPoint previous(INT_MIN, INT_MIN);
+
+    for (int idx = from; idx <= to; idx++)
+    {
+        const QPointF sample = sampleData->sample(idx);
+
+        const QPointF pos(xMap.transform(sample.x()), yMap.transform(sample.y()));
+
+        if (!clip.contains(pos)) continue;
+
+        const QPoint pixel((int) (pos.x() * ratio), (int) (pos.y() * ratio));
+
+        if (pixel == previous) continue;
+
+        previous = pixel;
+
+        fragments.push_back(QPainter::PixmapFragment::create(pos + centre, source, 1.0 / ratio, 1.0 / ratio));
+    }
+
+    if (!fragments.empty())
+    {
+        painter->drawPixmapFragments(fragments.data(), (int) fragments.size(), symbolPixmap);
+    }
 }
 
 
-void PlotCurve::onDataResampled(const QVector<double> &t_data, const QVector<double> &y_data)
+void PlotCurve::onDataResampled(PlotSamplesPointer samples, double scaler, double offset)
 {
+    sampleData->setSamples(samples, scaler, offset);
+
+    // The plot may limit the rate at which it is re-drawn (see PlotWidget::scheduleReplot)
+    if (isSignalConnected(QMetaMethod::fromSignal(&PlotCurve::samplesUpdated)))
+    {
+        emit samplesUpdated();
+        return;
+    }
+
     // Re-draw the curve
-    setSamples(t_data, y_data);
+    dataChanged();
 }
 
 
-void PlotCurve::resampleData(double t_min, double t_max, unsigned int n_pixels)
+void PlotSeriesData::setSamples(PlotSamplesPointer s, double scaler_value, double offset_value)
+{
+    // The samples currently held are never overwritten by the updater (see PlotCurveUpdater::acquireBuffer),
+    // so the revision only changes when different samples are provided (not when they are re-scaled)
+    if (s != samples)
+    {
+        revision++;
+    }
+
+    samples = s;
+    scaler = scaler_value;
+    offset = offset_value;
+
+    if (!samples || samples->size() == 0)
+    {
+        // Invalid rectangle (see qwtBoundingRect)
+        bounds = QRectF(1.0, 1.0, -2.0, -2.0);
+        return;
+    }
+
+    // Timestamps are in order; a negative scaler swaps the direction of the value range
+    double y_a = samples->minValue * scaler + offset;
+    double y_b = samples->maxValue * scaler + offset;
+
+    double x_min = samples->timestamps.front();
+    double x_max = samples->timestamps.back();
+
+    bounds = QRectF(x_min, qMin(y_a, y_b), x_max - x_min, qAbs(y_b - y_a));
+}
+
+
+QPointF PlotSeriesData::sample(size_t i) const
+{
+    return QPointF(samples->timestamps[i], samples->values[i] * scaler + offset);
+}
+
+
+/**
+ * @brief PlotCurve::resampleData - Request that the curve be resampled to the specified view
+ * @param t_min is the first visible timestamp
+ * @param t_max is the last visible timestamp
+ * @param n_pixels is the width of the view, in pixels
+ * @param progressive draws a coarse pass first, if the full resolution pass will take a while
+ */
+void PlotCurve::resampleData(double t_min, double t_max, unsigned int n_pixels, bool progressive)
 {
     if (series.isNull())
     {
@@ -73,15 +294,95 @@ void PlotCurve::resampleData(double t_min, double t_max, unsigned int n_pixels)
     }
     else
     {
-        worker->updateCurveSamples(t_min, t_max, n_pixels);
+        t_min_requested = t_min;
+        t_max_requested = t_max;
+        n_pixels_requested = n_pixels;
+        resampleRequested = true;
+
+        if (getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_DENSITY)
+        {
+            updateDensityView();
+        }
+
+        // Hidden curves are resampled when they are next shown
+        if (isVisible())
+        {
+            // Resampling is performed by the thread pool; only the latest request is processed
+            worker->requestCurveSamples(t_min, t_max, n_pixels, getResamplePriority(), progressive);
+        }
+    }
+}
+
+
+/*
+ * The density image covers the visible value range of the curve axis, at the height of the canvas
+ */
+void PlotCurve::updateDensityView()
+{
+    const QwtPlot* p = plot();
+
+    if (p == nullptr || worker == nullptr || series.isNull()) return;
+
+    const QwtInterval interval = p->axisInterval(yAxis());
+
+    const int rows = p->canvas() ? p->canvas()->height() : 0;
+
+    worker->setDensityView(interval.minValue(), interval.maxValue(), rows > 0 ? (unsigned int) rows : 0, series->getColor().rgb());
+}
+
+
+void PlotCurve::setDownsampleMode(int mode)
+{
+    if (worker == nullptr || worker->getDownsampleMode() == mode) return;
+
+    worker->setDownsampleMode(mode);
+
+    // Resample the current view with the new algorithm
+    if (resampleRequested)
+    {
+        resampleData(t_min_requested, t_max_requested, n_pixels_requested);
     }
 }
 
 
+/*
+ * Curves in the plot which has focus (or is under the mouse) are resampled first,
+ * followed by curves in other visible plots.
+ */
+int PlotCurve::getResamplePriority() const
+{
+    const QwtPlot* p = plot();
+
+    if (p == nullptr || !p->isVisible())
+    {
+        return PlotCurveUpdater::PRIORITY_HIDDEN;
+    }
+
+    if (p->hasFocus() || p->underMouse())
+    {
+        return PlotCurveUpdater::PRIORITY_FOCUSED;
+    }
+
+    return PlotCurveUpdater::PRIORITY_VISIBLE;
+}
+
+
 void PlotCurve::setVisible(bool on)
 {
     QwtPlotCurve::setVisible(on);
     updateLabel();
+
+    if (worker == nullptr) return;
+
+    if (!on)
+    {
+        worker->cancelRequests();
+    }
+    else if (resampleRequested)
+    {
+        // Catch up with any view changes made while the curve was hidden
+        worker->requestCurveSamples(t_min_requested, t_max_requested, n_pixels_requested, getResamplePriority());
+    }
 }
 
 
@@ -137,5 +438,12 @@ void PlotCurve::updateLineStyle()
 
     setSymbol(symbol);
 
+    // Rendered again for the new style, when next needed
+    symbolPixmap = QPixmap();
 
+    // The density image is drawn in the series colour
+    if (getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_DENSITY && resampleRequested)
+    {
+        resampleData(t_min_requested, t_max_requested, n_pixels_requested);
+    }
 }
@@ -1,14 +1,55 @@
 #ifndef PLOT_CURVE_H
 #define PLOT_CURVE_H
 
-#include <QThread>
+#include <QPixmap>
 
 #include <qwt_plot_curve.h>
+#include <qwt_series_data.h>
 
 #include "data_series.hpp"
 #include "plot_sampler.hpp"
 
 class PlotCurve;
+class PlotCurveBuffer;
+
+
+/*
+ * Curve data which draws directly from the output of a PlotCurveUpdater.
+ *
+ * When a resampling pass completes, the curve simply swaps the samples pointer,
+ * rather than copying the samples into its own storage.
+ * The scaler and offset of the series are applied as each sample is drawn.
+ */
+class PlotSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    PlotSeriesData() {}
+
+    void setSamples(PlotSamplesPointer s, double scaler, double offset);
+
+    virtual size_t size() const override { return samples ? samples->size() : 0; }
+    virtual QPointF sample(size_t i) const override;
+    virtual QRectF boundingRect() const override { return bounds; }
+
+    const PlotSamplesPointer& getSamples(void) const { return samples; }
+    double getScaler(void) const { return scaler; }
+    double getOffset(void) const { return offset; }
+
+    //! Incremented whenever the samples are replaced
+    uint64_t getRevision(void) const { return revision; }
+
+protected:
+    PlotSamplesPointer samples;
+
+    uint64_t revision = 0;
+
+    double scaler = 1.0;
+    double offset = 0.0;
+
+    //! Bounding rectangle of the (scaled) samples
+    QRectF bounds = QRectF(1.0, 1.0, -2.0, -2.0);
+};
+
 
 /*
  * An extension of the QwtPlotCurve class,
@@ -25,30 +66,78 @@ class PlotCurve : public QObject, public QwtPlotCurve
    Q_OBJECT
 
 public:
-    PlotCurve(DataSeriesPointer series, PlotCurveUpdater* updater);
-    PlotCurve(DataSeries* series, PlotCurveUpdater *updater) : PlotCurve(DataSeriesPointer(series), updater) {}
+    PlotCurve(DataSeriesPointer series, PlotCurveUpdater* updater = nullptr);
+    PlotCurve(DataSeries* series, PlotCurveUpdater *updater = nullptr) : PlotCurve(DataSeriesPointer(series), updater) {}
 
     DataSeriesPointer getDataSeries(void) { return series; }
 
+    //! Resampled samples which are drawn
+    const PlotSeriesData* getSampleData(void) const { return sampleData; }
+
     virtual ~PlotCurve();
 
+    virtual void drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                            const QRectF &canvasRect, int from, int to) const override;
+
+    //! Down-sampling algorithm (see PlotCurveUpdater::DownsampleMode)
+    int getDownsampleMode(void) const { return worker ? worker->getDownsampleMode() : PlotCurveUpdater::DOWNSAMPLE_M4; }
+    void setDownsampleMode(int mode);
+
+    //! Description of the most recent resampling pass (see PlotCurveUpdater::getStats)
+    ResampleStats getResampleStats(void) const { return worker ? worker->getStats() : ResampleStats(); }
+    bool isResamplePending(void) const { return worker && worker->isRequestPending(); }
+
+    //! Above this number of points per pixel, symbols are blitted from a cached pixmap rather than drawn individually
+    static const double MAX_SYMBOL_DENSITY;
+
+    static bool isSymbolDense(size_t points, double pixels);
+
 public slots:
-    void resampleData(double t_min, double t_max, unsigned int n_pixels);
+    void resampleData(double t_min, double t_max, unsigned int n_pixels, bool progressive = false);
     void updateLabel(void);
     void updateLineStyle(void);
 
     virtual void setVisible(bool on) override;
 
+signals:
+    //! Emitted when new samples are available, if connected (the curve does not request a replot itself)
+    void samplesUpdated(void);
+
+    //! Emitted (at a capped rate) when the samples of the series within [t_min, t_max] have changed (e.g. while the series is being imported)
+    void seriesUpdated(double t_min, double t_max);
+
 protected slots:
-    void onDataResampled(const QVector<double> &t_data, const QVector<double> &y_data);
+    void onDataResampled(PlotSamplesPointer samples, double scaler, double offset);
 
 protected:
     DataSeriesPointer series;
 
+    //! Curve data (owned by the curve, see QwtPlotCurve::setData)
+    PlotSeriesData* sampleData = nullptr;
+
     PlotCurveUpdater *worker = nullptr;
 
-    //! Thread for re-sampling curve data
-    QThread workerThread;
+    //! Vertex buffer, when drawn on an OpenGL canvas (see PlotOpenGLCanvas)
+    mutable PlotCurveBuffer *glBuffer = nullptr;
+
+    //! Symbol of the curve, rendered once for a dense curve (see drawSymbols)
+    mutable QPixmap symbolPixmap;
+
+    virtual void drawSymbols(QPainter *painter, const QwtSymbol &symbol, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                             const QRectF &canvasRect, int from, int to) const override;
+
+    void blitSymbols(QPainter *painter, const QwtSymbol &symbol, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                     const QRectF &canvasRect, int from, int to) const;
+
+    int getResamplePriority(void) const;
+
+    void updateDensityView(void);
+
+    //! Most recent resampling request
+    double t_min_requested = 0;
+    double t_max_requested = 0;
+    unsigned int n_pixels_requested = 0;
+    bool resampleRequested = false;
 };
 
 #endif // PLOT_CURVE_H
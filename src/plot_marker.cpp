@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <cmath>
+
+#include <qpainter.h>
+
+#include <qwt_scale_map.h>
+
 #include "plot_marker.hpp"
 
 PlotMarker::PlotMarker(QSharedPointer<PlotCurve> plotCurve)
@@ -5,3 +12,67 @@ PlotMarker::PlotMarker(QSharedPointer<PlotCurve> plotCurve)
 {
 
 }
+
+
+PlotMarkerLayer::PlotMarkerLayer(EventStorePointer e, const QColor &c) :
+    events(e),
+    color(c)
+{
+    // Drawn beneath the markers placed by the user
+    setZ(QwtPlotMarker().z() - 1);
+}
+
+
+void PlotMarkerLayer::draw(QPainter *painter,
+                           const QwtScaleMap &xMap,
+                           const QwtScaleMap &yMap,
+                           const QRectF &canvasRect) const
+{
+    Q_UNUSED(yMap);
+
+    if (!events || events->isEmpty()) return;
+
+    const double t_min = xMap.invTransform(canvasRect.left());
+    const double t_max = xMap.invTransform(canvasRect.right());
+
+    // Time spanned by a few pixels
+    const double spacing = std::fabs(xMap.invTransform(canvasRect.left() + CLUSTER_SPACING) - t_min);
+
+    const auto clusters = events->getClusters(std::min(t_min, t_max), std::max(t_min, t_max), spacing);
+
+    QPen pen(color);
+
+    painter->setPen(pen);
+
+    double label_x = -1e9;
+
+    for (const auto &cluster : clusters)
+    {
+        const int x1 = qRound(xMap.transform(cluster.t_first));
+        const int x2 = qRound(xMap.transform(cluster.t_last));
+
+        if (cluster.count == 1)
+        {
+            painter->drawLine(x1, canvasRect.top(), x1, canvasRect.bottom());
+        }
+        else
+        {
+            // A cluster of events is drawn as a band
+            QColor fill = color;
+            fill.setAlpha(100);
+
+            painter->fillRect(QRect(std::min(x1, x2) - 1, canvasRect.top(), std::abs(x2 - x1) + 3, canvasRect.height()), fill);
+        }
+
+        // Labels are only drawn where there is room for them
+        if (x1 - label_x < LABEL_SPACING) continue;
+
+        const QString text = cluster.count == 1 ? events->getEvent(cluster.index).label : QString::number(cluster.count) + "x";
+
+        if (text.isEmpty()) continue;
+
+        painter->drawText(x1 + 3, canvasRect.top() + painter->fontMetrics().ascent() + 2, text);
+
+        label_x = x1;
+    }
+}
@@ -2,8 +2,10 @@
 #define PLOT_MARKER_H
 
 #include <qwt_plot_marker.h>
+#include <qwt_plot_item.h>
 
 #include "plot_curve.hpp"
+#include "event_store.hpp"
 
 /*
  * Custom subclass of QwtPlotMarker to keep track of which curve the marker is assigned to
@@ -19,4 +21,38 @@ public:
     QSharedPointer<PlotCurve> curve;
 };
 
+
+/**
+ * @brief The PlotMarkerLayer class draws every event of an EventStore as a vertical marker line.
+ *
+ * Only the events within the visible interval are drawn. Events closer together than a few pixels
+ * are drawn as a single (thicker) marker, labelled with the number of events it represents, so the
+ * cost of drawing depends on the width of the plot rather than the number of events.
+ */
+class PlotMarkerLayer : public QwtPlotItem
+{
+public:
+    PlotMarkerLayer(EventStorePointer events, const QColor &color = Qt::darkMagenta);
+
+    //! Minimum spacing between separately drawn markers (pixels)
+    static const int CLUSTER_SPACING = 4;
+
+    //! Minimum spacing between markers for their labels to be drawn (pixels)
+    static const int LABEL_SPACING = 60;
+
+    const EventStorePointer& getEvents(void) const { return events; }
+
+    virtual int rtti(void) const override { return QwtPlotItem::Rtti_PlotUserItem + 1; }
+
+    virtual void draw(QPainter *painter,
+                      const QwtScaleMap &xMap,
+                      const QwtScaleMap &yMap,
+                      const QRectF &canvasRect) const override;
+
+protected:
+    EventStorePointer events;
+
+    QColor color;
+};
+
 #endif // PLOT_MARKER_H
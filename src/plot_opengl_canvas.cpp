@@ -0,0 +1,210 @@
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QPaintEngine>
+#include <QVector4D>
+#include <QDebug>
+
+#include "plot_opengl_canvas.hpp"
+
+
+static const char* CURVE_VERTEX_SHADER =
+        "attribute highp vec2 vertex;\n"
+        "uniform highp vec4 transform;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_Position = vec4(vertex.x * transform.x + transform.y, vertex.y * transform.z + transform.w, 0.0, 1.0);\n"
+        "}\n";
+
+static const char* CURVE_FRAGMENT_SHADER =
+        "uniform lowp vec4 color;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = color;\n"
+        "}\n";
+
+
+PlotOpenGLCanvas::PlotOpenGLCanvas(QwtPlot *plot) : QwtPlotOpenGLCanvas(plot)
+{
+}
+
+
+PlotOpenGLCanvas::~PlotOpenGLCanvas()
+{
+    if (curveProgram)
+    {
+        // GL resources must be released in the context which created them
+        makeCurrent();
+        delete curveProgram;
+        doneCurrent();
+    }
+}
+
+
+/*
+ * Returns true if the painter is drawing into an OpenGL context (i.e. native GL calls may be made)
+ */
+bool PlotOpenGLCanvas::isOpenGLPainter(const QPainter* painter)
+{
+    if (!painter || !painter->paintEngine()) return false;
+
+    return painter->paintEngine()->type() == QPaintEngine::OpenGL2 && QOpenGLContext::currentContext() != nullptr;
+}
+
+
+/*
+ * Return the shader program used to draw curves (the canvas context must be current).
+ * Returns nullptr if the program could not be built, in which case curves are drawn by QPainter.
+ */
+QOpenGLShaderProgram* PlotOpenGLCanvas::getCurveProgram()
+{
+    if (curveProgram || curveProgramFailed)
+    {
+        return curveProgram;
+    }
+
+    curveProgram = new QOpenGLShaderProgram();
+
+    bool ok = curveProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, CURVE_VERTEX_SHADER) &&
+              curveProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, CURVE_FRAGMENT_SHADER) &&
+              curveProgram->link();
+
+    if (!ok)
+    {
+        qWarning() << "Could not build curve shader:" << curveProgram->log();
+
+        delete curveProgram;
+        curveProgram = nullptr;
+        curveProgramFailed = true;
+    }
+
+    return curveProgram;
+}
+
+
+/*
+ * Copy the samples into the vertex buffer (the drawing context must be current)
+ */
+bool PlotCurveBuffer::upload(const PlotSamples& samples)
+{
+    QOpenGLContext* current = QOpenGLContext::currentContext();
+
+    // A curve which has been moved to a different plot needs a buffer in the new context
+    if (context != current)
+    {
+        buffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+        context = current;
+    }
+
+    if (!buffer.isCreated() && !buffer.create())
+    {
+        return false;
+    }
+
+    const size_t n = samples.size();
+
+    x_origin = n > 0 ? samples.timestamps.front() : 0;
+    y_origin = samples.minValue;
+
+    std::vector<float> vertices(n * 2);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        vertices[idx * 2] = (float) (samples.timestamps[idx] - x_origin);
+        vertices[idx * 2 + 1] = (float) (samples.values[idx] - y_origin);
+    }
+
+    buffer.bind();
+    buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    buffer.allocate(vertices.data(), (int) (vertices.size() * sizeof(float)));
+    buffer.release();
+
+    vertexCount = (int) n;
+
+    return true;
+}
+
+
+/**
+ * @brief PlotCurveBuffer::draw - Draw the samples as a line strip, using native GL calls
+ * @param painter is the canvas painter (which must be painting into the canvas context)
+ * @param canvas is the plot canvas
+ * @param xMap maps timestamps to canvas coordinates
+ * @param yMap maps (scaled) values to canvas coordinates
+ * @param samples are the raw samples to draw
+ * @param rev identifies the contents of the samples (the buffers are re-used between passes)
+ * @param scaler is applied to the raw values
+ * @param offset is applied to the raw values
+ * @param pen is the curve pen (only solid lines are supported)
+ * @return false if the samples could not be drawn (the caller should fall back to QPainter)
+ */
+bool PlotCurveBuffer::draw(QPainter* painter, PlotOpenGLCanvas* canvas, const QwtScaleMap& xMap, const QwtScaleMap& yMap,
+                           const PlotSamplesPointer& samples, uint64_t rev, double scaler, double offset, const QPen& pen)
+{
+    if (!canvas || !PlotOpenGLCanvas::isOpenGLPainter(painter)) return false;
+
+    // Only linear axes, and (untransformed or translated) painters, can be mapped in the shader
+    if (xMap.transformation() || yMap.transformation()) return false;
+    if (painter->transform().type() > QTransform::TxTranslate) return false;
+
+    if (pen.style() != Qt::SolidLine) return false;
+
+    if (!samples || samples->size() < 2) return true;
+
+    painter->beginNativePainting();
+
+    QOpenGLShaderProgram* program = canvas->getCurveProgram();
+
+    bool ok = program != nullptr;
+
+    if (ok && (rev != revision || context != QOpenGLContext::currentContext()))
+    {
+        ok = upload(*samples);
+        revision = ok ? rev : 0;
+    }
+
+    if (ok)
+    {
+        // The viewport covers the whole canvas (in logical pixels, as used by the scale maps)
+        const double width = canvas->width();
+        const double height = canvas->height();
+
+        const double dx = painter->transform().dx();
+        const double dy = painter->transform().dy();
+
+        // Linear maps, from sample coordinates to device coordinates
+        const double sx = (xMap.p2() - xMap.p1()) / (xMap.s2() - xMap.s1());
+        const double sy = (yMap.p2() - yMap.p1()) / (yMap.s2() - yMap.s1());
+
+        const double px = xMap.p1() + (x_origin - xMap.s1()) * sx + dx;
+        const double py = yMap.p1() + (y_origin * scaler + offset - yMap.s1()) * sy + dy;
+
+        // ... and then to normalized device coordinates (y axis is flipped)
+        QVector4D transform((float) (2 * sx / width),
+                            (float) (2 * px / width - 1),
+                            (float) (-2 * sy * scaler / height),
+                            (float) (1 - 2 * py / height));
+
+        QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+
+        program->bind();
+        program->setUniformValue("transform", transform);
+        program->setUniformValue("color", pen.color());
+
+        buffer.bind();
+
+        program->enableAttributeArray("vertex");
+        program->setAttributeBuffer("vertex", GL_FLOAT, 0, 2);
+
+        gl->glLineWidth(qMax(1.0f, (float) (pen.widthF() * canvas->devicePixelRatioF())));
+        gl->glDrawArrays(GL_LINE_STRIP, 0, vertexCount);
+
+        program->disableAttributeArray("vertex");
+
+        buffer.release();
+        program->release();
+    }
+
+    painter->endNativePainting();
+
+    return ok;
+}
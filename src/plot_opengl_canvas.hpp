@@ -0,0 +1,78 @@
+#ifndef PLOT_OPENGL_CANVAS_HPP
+#define PLOT_OPENGL_CANVAS_HPP
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QPainter>
+#include <QPen>
+
+#include <qwt_plot.h>
+#include <qwt_plot_opengl_canvas.h>
+#include <qwt_scale_map.h>
+
+#include "plot_sampler.hpp"
+
+
+/*
+ * Hardware-accelerated plot canvas (opt-in, see the "graph/openGLCanvas" setting).
+ *
+ * Plot items are painted by Qwt as usual, but curves which support it (see PlotCurveBuffer)
+ * draw directly from vertex buffers held on the GPU, rather than through QPainter.
+ * The canvas owns the shader program which is shared by every curve in the plot.
+ */
+class PlotOpenGLCanvas : public QwtPlotOpenGLCanvas
+{
+public:
+    explicit PlotOpenGLCanvas(QwtPlot *plot = nullptr);
+    virtual ~PlotOpenGLCanvas();
+
+    QOpenGLShaderProgram* getCurveProgram(void);
+
+    static bool isOpenGLPainter(const QPainter* painter);
+
+protected:
+    //! Shader program for drawing curves (created in the canvas context, on first use)
+    QOpenGLShaderProgram* curveProgram = nullptr;
+
+    bool curveProgramFailed = false;
+};
+
+
+/*
+ * GPU-resident copy of the samples drawn by a single curve.
+ *
+ * Vertices are uploaded once per resampling pass. The axis transforms, and the scaler and offset
+ * of the series, are applied in the vertex shader, so panning or zooming between resampling passes
+ * (and re-scaling a series) only changes the shader uniforms.
+ *
+ * Vertices are stored relative to the first sample (and the minimum value) in single precision,
+ * which retains sub-pixel precision for large timestamps.
+ */
+class PlotCurveBuffer
+{
+public:
+    PlotCurveBuffer() {}
+
+    bool draw(QPainter* painter, PlotOpenGLCanvas* canvas, const QwtScaleMap& xMap, const QwtScaleMap& yMap,
+              const PlotSamplesPointer& samples, uint64_t revision, double scaler, double offset, const QPen& pen);
+
+protected:
+    bool upload(const PlotSamples& samples);
+
+    QOpenGLBuffer buffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+
+    //! Context in which the buffer was created
+    QOpenGLContext* context = nullptr;
+
+    //! Revision of the samples held in the buffer
+    uint64_t revision = 0;
+
+    //! Origin of the vertex coordinates
+    double x_origin = 0;
+    double y_origin = 0;
+
+    int vertexCount = 0;
+};
+
+
+#endif // PLOT_OPENGL_CANVAS_HPP
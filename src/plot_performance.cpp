@@ -0,0 +1,128 @@
+#include "plot_performance.hpp"
+
+
+const qint64 PlotPerformanceMonitor::RATE_WINDOW;
+const int PlotPerformanceMonitor::MAX_CURVES;
+
+
+/**
+ * @brief PlotPerformanceMonitor::recordPaint - Record a paint of the canvas
+ * @param duration - Duration of the paint (ms)
+ * @param t - Time of the paint (see now)
+ */
+void PlotPerformanceMonitor::recordPaint(double duration, qint64 t)
+{
+    paintTime = duration;
+
+    paints.push_back(t);
+    trim(paints, t);
+}
+
+
+/**
+ * @brief PlotPerformanceMonitor::recordChange - Record a change notification from a series
+ */
+void PlotPerformanceMonitor::recordChange(qint64 t)
+{
+    changes.push_back(t);
+    trim(changes, t);
+}
+
+
+//! Paints per second, over the most recent RATE_WINDOW
+double PlotPerformanceMonitor::getReplotRate(qint64 t)
+{
+    trim(paints, t);
+
+    return paints.size() * 1000.0 / RATE_WINDOW;
+}
+
+
+//! Change notifications per second, over the most recent RATE_WINDOW
+double PlotPerformanceMonitor::getChangeRate(qint64 t)
+{
+    trim(changes, t);
+
+    return changes.size() * 1000.0 / RATE_WINDOW;
+}
+
+
+void PlotPerformanceMonitor::trim(std::deque<qint64> &events, qint64 t) const
+{
+    while (!events.empty() && events.front() <= t - RATE_WINDOW)
+    {
+        events.pop_front();
+    }
+}
+
+
+/**
+ * @brief PlotPerformanceMonitor::describe - Format the lines of the overlay: a summary of the plot,
+ * followed by a line for each curve (up to MAX_CURVES)
+ * @param curves - Figures of the curves of the plot
+ * @param t - Current time (see now)
+ */
+QStringList PlotPerformanceMonitor::describe(const std::vector<CurveInfo> &curves, qint64 t)
+{
+    int queued = 0;
+
+    for (const auto &curve : curves)
+    {
+        queued += curve.pending;
+    }
+
+    QStringList lines;
+
+    lines.append(QString("Paint %1 ms | %2 replots/s | %3 changes/s | %4 queued")
+                 .arg(paintTime, 0, 'f', 1)
+                 .arg(getReplotRate(t), 0, 'f', 0)
+                 .arg(getChangeRate(t), 0, 'f', 0)
+                 .arg(queued));
+
+    for (int idx = 0; idx < (int) curves.size() && idx < MAX_CURVES; idx++)
+    {
+        const CurveInfo &curve = curves[idx];
+        const ResampleStats &stats = curve.stats;
+
+        QString line = curve.label + ": ";
+
+        if (stats.passes == 0)
+        {
+            line += "not resampled";
+        }
+        else
+        {
+            const QString lod = stats.direct ? QString("raw") : stats.level < 0 ? QString("samples") : QString("level %1").arg(stats.level);
+
+            line += QString("%1 ms | %2 / %3 points | %4")
+                    .arg(stats.duration, 0, 'f', 2)
+                    .arg(stats.outputPoints)
+                    .arg(stats.rawPoints)
+                    .arg(lod);
+
+            if (stats.shared)
+            {
+                line += " (shared)";
+            }
+
+            if (stats.gpu)
+            {
+                line += " (gpu)";
+            }
+        }
+
+        if (curve.pending)
+        {
+            line += " | pending";
+        }
+
+        lines.append(line);
+    }
+
+    if ((int) curves.size() > MAX_CURVES)
+    {
+        lines.append(QString("(%1 more curves)").arg(curves.size() - MAX_CURVES));
+    }
+
+    return lines;
+}
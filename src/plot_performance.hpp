@@ -0,0 +1,70 @@
+#ifndef PLOT_PERFORMANCE_HPP
+#define PLOT_PERFORMANCE_HPP
+
+#include <deque>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+#include "plot_sampler.hpp"
+
+
+/**
+ * @brief The PlotPerformanceMonitor class collects the performance figures of a plot, which are drawn
+ * as an overlay on the canvas (see PlotWidget::setPerformanceHudEnabled).
+ *
+ * The plot records the duration of each canvas paint, and each change notification it receives from its
+ * series. Rates are measured over the most recent RATE_WINDOW. The figures of each curve are those of
+ * its most recent resampling pass (see PlotCurveUpdater::getStats), so the overlay describes the same
+ * spans as the trace (see TraceRecorder) without recording being enabled.
+ */
+class PlotPerformanceMonitor
+{
+public:
+    //! Interval over which rates are measured (ms)
+    static const qint64 RATE_WINDOW = 1000;
+
+    //! Maximum number of curves which are described individually
+    static const int MAX_CURVES = 8;
+
+    struct CurveInfo
+    {
+        QString label;
+        ResampleStats stats;
+
+        //! A resampling request is queued or running
+        bool pending = false;
+    };
+
+    PlotPerformanceMonitor(void) { clock.start(); }
+
+    //! Time since the monitor was created (ms)
+    qint64 now(void) const { return clock.elapsed(); }
+
+    void recordPaint(double duration, qint64 t);
+    void recordChange(qint64 t);
+
+    //! Duration of the most recent paint (ms)
+    double getPaintTime(void) const { return paintTime; }
+
+    double getReplotRate(qint64 t);
+    double getChangeRate(qint64 t);
+
+    QStringList describe(const std::vector<CurveInfo> &curves, qint64 t);
+
+protected:
+    void trim(std::deque<qint64> &events, qint64 t) const;
+
+    QElapsedTimer clock;
+
+    double paintTime = 0;
+
+    //! Times of recent paints and change notifications (ms)
+    std::deque<qint64> paints;
+    std::deque<qint64> changes;
+};
+
+
+#endif // PLOT_PERFORMANCE_HPP
@@ -0,0 +1,91 @@
+#include "plot_scheduler.hpp"
+#include "trace_recorder.hpp"
+
+
+PlotReplotScheduler* PlotReplotScheduler::instance = nullptr;
+
+const int PlotReplotScheduler::FRAME_INTERVAL;
+
+
+PlotReplotScheduler::PlotReplotScheduler() : QObject()
+{
+    frameTimer.setSingleShot(true);
+    frameElapsed.start();
+
+    connect(&frameTimer, &QTimer::timeout, this, &PlotReplotScheduler::drawFrame);
+}
+
+
+/*
+ * Re-draw the plot in the next frame (requests made before then are coalesced)
+ */
+void PlotReplotScheduler::requestReplot(QwtPlot* plot)
+{
+    if (plot == nullptr) return;
+
+    for (const auto& p : pending)
+    {
+        if (p == plot) return;
+    }
+
+    pending.append(QPointer<QwtPlot>(plot));
+
+    scheduleFrame();
+}
+
+
+/*
+ * Re-draw the plot immediately (e.g. before the plot is captured as an image)
+ */
+void PlotReplotScheduler::replotNow(QwtPlot* plot)
+{
+    if (plot == nullptr) return;
+
+    pending.removeAll(QPointer<QwtPlot>(plot));
+
+    TRACE_SCOPE("Replot", "plot");
+
+    plot->QwtPlot::replot();
+}
+
+
+void PlotReplotScheduler::scheduleFrame()
+{
+    if (frameTimer.isActive()) return;
+
+    // A frame which overran its budget delays the next frame by the same amount
+    const qint64 interval = qMax<qint64>(FRAME_INTERVAL, frameDuration);
+
+    const qint64 remaining = interval - frameElapsed.elapsed();
+
+    frameTimer.start(remaining > 0 ? (int) remaining : 0);
+}
+
+
+void PlotReplotScheduler::drawFrame()
+{
+    TRACE_SCOPE("Draw Frame", "plot");
+
+    frameElapsed.restart();
+
+    // Plots which request a replot while the frame is being drawn are queued for the next frame
+    QList<QPointer<QwtPlot>> plots;
+    plots.swap(pending);
+
+    for (auto& plot : plots)
+    {
+        if (!plot.isNull())
+        {
+            TRACE_SCOPE("Replot", "plot");
+
+            plot->QwtPlot::replot();
+        }
+    }
+
+    frameDuration = frameElapsed.elapsed();
+
+    if (!pending.isEmpty())
+    {
+        scheduleFrame();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef PLOT_SCHEDULER_HPP
+#define PLOT_SCHEDULER_HPP
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include <qwt_plot.h>
+
+
+/*
+ * Coalesces replot requests from every plot into display frames.
+ *
+ * Zooming a plot can update the time axis of every synced plot, and each resampled curve
+ * then requests its own replot. Rather than repainting a plot for each of these requests,
+ * plots are queued (at most once) and re-drawn together at the start of the next frame.
+ *
+ * If drawing a frame takes longer than the frame budget, the following frame is delayed by
+ * the same amount: intermediate frames are dropped, rather than queued behind each other.
+ */
+class PlotReplotScheduler : public QObject
+{
+    Q_OBJECT
+
+    static PlotReplotScheduler* instance;
+
+public:
+    PlotReplotScheduler();
+
+    // Singleton design pattern
+    static PlotReplotScheduler* getInstance()
+    {
+        if (!instance)
+        {
+            instance = new PlotReplotScheduler;
+        }
+
+        return instance;
+    }
+
+    static void cleanup()
+    {
+        if (instance)
+        {
+            delete instance;
+            instance = nullptr;
+        }
+    }
+
+    //! Target interval between frames (ms)
+    static const int FRAME_INTERVAL = 16;
+
+    void requestReplot(QwtPlot* plot);
+    void replotNow(QwtPlot* plot);
+
+    //! Duration of the most recent frame (ms)
+    qint64 getFrameDuration(void) const { return frameDuration; }
+
+protected slots:
+    void drawFrame(void);
+
+protected:
+    void scheduleFrame(void);
+
+    //! Plots waiting to be re-drawn (destroyed plots are skipped)
+    QList<QPointer<QwtPlot>> pending;
+
+    QTimer frameTimer;
+
+    //! Time since the start of the previous frame
+    QElapsedTimer frameElapsed;
+
+    qint64 frameDuration = 0;
+};
+
+#endif // PLOT_SCHEDULER_HPP
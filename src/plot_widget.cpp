@@ -2,6 +2,7 @@
 #include <QMimeData>
 #include <QDockWidget>
 #include <QInputDialog>
+#include <QMessageBox>
 #include <qcolordialog.h>
 #include <qmenu.h>
 #include <qaction.h>
@@ -13,14 +14,23 @@
 #include <qfiledialog.h>
 #include <qwt_text.h>
 #include <qwt_symbol.h>
+#include <QElapsedTimer>
+#include <QFontDatabase>
+#include <QPainter>
 
 #include "plot_widget.hpp"
+#include "plot_opengl_canvas.hpp"
+#include "plot_scheduler.hpp"
 
 #include "axis_edit_dialog.hpp"
+#include "datatable_widget.hpp"
 #include "series_editor_dialog.hpp"
 
 #include "data_source_manager.hpp"
+#include "gpu_compute.hpp"
 #include "lumberjack_settings.hpp"
+#include "math_sampler.hpp"
+#include "parallel_for.hpp"
 
 
 /**
@@ -28,6 +38,19 @@
  */
 PlotWidget::PlotWidget() : QwtPlot()
 {
+    auto *settings = LumberjackSettings::getInstance();
+
+    // Optional hardware-accelerated canvas (must be selected before the canvas interactions are created)
+    if (settings->loadBoolean("graph", "openGLCanvas", false))
+    {
+        setCanvas(new PlotOpenGLCanvas(this));
+    }
+
+    // Optional GPU resampling (the compute context is created on the GUI thread)
+    if (settings->loadBoolean("graph", "gpuCompute", false))
+    {
+        GpuCompute::getInstance()->setEnabled(true);
+    }
 
     // Enable secondary axis
     enableAxis(QwtPlot::yRight, true);
@@ -57,9 +80,12 @@ PlotWidget::PlotWidget() : QwtPlot()
 
     connect(this, &PlotWidget::customContextMenuRequested, this, &PlotWidget::onContextMenu);
 
-    // Load graph widget settings
+    connect(&followTimer, &QTimer::timeout, this, &PlotWidget::updateFollow);
 
-    auto *settings = LumberjackSettings::getInstance();
+    dataTimer.setSingleShot(true);
+    connect(&dataTimer, &QTimer::timeout, this, &PlotWidget::updateData);
+
+    // Load graph widget settings
 
     QString bgColor = settings->loadSetting("graph", "defaultBackgroundColor", "#F0F0F0").toString();
 
@@ -68,6 +94,9 @@ PlotWidget::PlotWidget() : QwtPlot()
         setBackgroundColor(QColor(bgColor));
     }
 
+    downsampleMode = settings->loadSetting("graph", "downsampleMode", PlotCurveUpdater::DOWNSAMPLE_M4).toInt();
+    progressive = settings->loadBoolean("graph", "progressiveRendering", true);
+
     // Initially set an empty axis title
     setAxisTitle(QwtPlot::yLeft, " ");
     setAxisTitle(QwtPlot::yRight, " ");
@@ -90,150 +119,171 @@ PlotWidget::~PlotWidget()
 
     removeAllSeries();
     removeAllMarkers();
+    removeAllEventLayers();
 }
 
 
 /**
- * @brief PlotWidget::getOldestTimestamp returns the oldest timestamp for visible data
- * @param ok - set to true if a value is found, else false
- * @return the "oldest" value of all displayed graph curves
+ * @brief PlotWidget::getDataBounds returns the combined bounds of the visible curves.
+ * The bounds are cached, and only combined again when a series has changed (see invalidateDataBounds),
+ * or a curve has been added, removed, hidden or moved to the other axis.
+ * The bounds of each series are maintained by the series itself (see DataSeries::getValueRange).
  */
-double PlotWidget::getOldestTimestamp(bool *ok) const
+const PlotWidget::DataBounds& PlotWidget::getDataBounds() const
 {
-    double oldest = __DBL_MAX__;
+    std::vector<DataBounds::CurveState> state;
 
-    double t = 0;
+    state.reserve(curves.size());
 
-    if (ok != nullptr)
+    for (const auto &curve : curves)
     {
-        *ok = false;
+        if (curve.isNull()) continue;
+
+        state.push_back({ curve.data(), curve->isVisible(), curve->yAxis() });
     }
 
-    for (auto curve : curves)
+    if (dataBounds.valid && state == dataBounds.state) return dataBounds;
+
+    dataBounds = DataBounds();
+    dataBounds.state = state;
+
+    std::vector<const PlotCurve*> visible;
+    std::vector<DataSeriesPointer> series;
+
+    for (const auto &curve : curves)
     {
-        // Ignore null curves
-        if (curve.isNull()) continue;
+        // Ignore null or hidden curves
+        if (curve.isNull() || !curve->isVisible()) continue;
 
-        // Ignore hidden curves
-        if (!curve->isVisible()) continue;
+        visible.push_back(curve.data());
+        series.push_back(curve->getDataSeries());
+    }
 
-        auto series = curve->getDataSeries();
+    const std::vector<QRectF> seriesBounds = getSeriesBounds(series);
 
-        if (series.isNull()) continue;
+    // The bounds are combined in curve order
+    for (size_t idx = 0; idx < visible.size(); idx++)
+    {
+        const PlotCurve *curve = visible[idx];
+        const QRectF &bounds = seriesBounds[idx];
 
-        if (!series->hasData()) continue;
+        if (bounds.isNull()) continue;
 
-        t = series->getOldestTimestamp();
+        dataBounds.time |= QwtInterval(bounds.left(), bounds.right());
 
-        if (t < oldest)
-        {
-            // A sample has been found
-            if (ok != nullptr)
-            {
-                *ok = true;
-            }
+        const QwtInterval values(bounds.top(), bounds.bottom());
 
-            oldest = t;
+        if (curve->yAxis() == QwtPlot::yLeft)
+        {
+            dataBounds.left |= values;
+        }
+        else if (curve->yAxis() == QwtPlot::yRight)
+        {
+            dataBounds.right |= values;
         }
     }
 
-    return oldest;
+    dataBounds.valid = true;
+
+    return dataBounds;
 }
 
 
 /**
- * @brief PlotWidget::getNewestTimestamp returns the newest timestamp for visible data
- * @param ok - set to true if a value is found, else false
- * @return the "newest" value of all displayed graph curves
+ * @brief PlotWidget::getSeriesBounds returns the bounds of each series (a null rectangle for a null or empty series).
+ * The bounds of many series (e.g. every curve of a dashboard) are computed concurrently.
  */
-double PlotWidget::getNewestTimestamp(bool *ok) const
+std::vector<QRectF> PlotWidget::getSeriesBounds(const std::vector<DataSeriesPointer> &series)
 {
-    double newest = __DBL_MIN__;
+    std::vector<QRectF> bounds(series.size());
 
-    double t = 0;
+    auto boundsOne = [&](size_t idx) {
+        const auto &s = series[idx];
 
-    if (ok != nullptr)
+        if (!s.isNull() && s->hasData())
+        {
+            bounds[idx] = s->getBounds();
+        }
+    };
+
+    if (series.size() >= (size_t) PARALLEL_BOUNDS_SERIES)
     {
-        *ok = false;
+        parallelFor(series.size(), boundsOne, QThreadPool::globalInstance());
     }
-
-    for (auto curve : curves)
+    else
     {
-        // Ignore null curves
-        if (curve.isNull()) continue;
-
-        // Ignore hidden curves
-        if (!curve->isVisible()) continue;
+        for (size_t idx = 0; idx < series.size(); idx++)
+        {
+            boundsOne(idx);
+        }
+    }
 
-        auto series = curve->getDataSeries();
+    return bounds;
+}
 
-        if (series.isNull()) continue;
 
-        if (!series->hasData()) continue;
+/*
+ * Callback when the samples of a series have changed
+ */
+void PlotWidget::invalidateDataBounds()
+{
+    dataBounds.valid = false;
+}
 
-        t = series->getNewestTimestamp();
 
-        if (t > newest)
-        {
-            // A sample has been found
-            if (ok != nullptr)
-            {
-                *ok = true;
-            }
+/**
+ * @brief PlotWidget::getOldestTimestamp returns the oldest timestamp for visible data
+ * @param ok - set to true if a value is found, else false
+ * @return the "oldest" value of all displayed graph curves
+ */
+double PlotWidget::getOldestTimestamp(bool *ok) const
+{
+    const auto &bounds = getDataBounds();
 
-            newest = t;
-        }
+    if (ok != nullptr)
+    {
+        *ok = bounds.time.isValid();
     }
 
-    return newest;
+    return bounds.time.isValid() ? bounds.time.minValue() : __DBL_MAX__;
 }
 
 
 /**
- * @brief PlotWidget::getMinimumValue returns the minimum value for visible data
+ * @brief PlotWidget::getNewestTimestamp returns the newest timestamp for visible data
  * @param ok - set to true if a value is found, else false
- * @return the "minimum" value of all displayed graph curves
+ * @return the "newest" value of all displayed graph curves
  */
-double PlotWidget::getMinimumValue(bool *ok) const
+double PlotWidget::getNewestTimestamp(bool *ok) const
 {
-    double minimum = __DBL_MAX__;
-
-    double value = 0;
+    const auto &bounds = getDataBounds();
 
     if (ok != nullptr)
     {
-        *ok = false;
+        *ok = bounds.time.isValid();
     }
 
-    for (auto curve : curves)
-    {
-        // Ignore null curves
-        if (curve.isNull()) continue;
-
-        // Ignore hidden curves
-        if (!curve->isVisible()) continue;
-
-        auto series = curve->getDataSeries();
-
-        if (series.isNull()) continue;
+    return bounds.time.isValid() ? bounds.time.maxValue() : -__DBL_MAX__;
+}
 
-        if (!series->hasData()) continue;
 
-        value = series->getMinimumValue();
+/**
+ * @brief PlotWidget::getMinimumValue returns the minimum value for visible data
+ * @param ok - set to true if a value is found, else false
+ * @return the "minimum" value of all displayed graph curves
+ */
+double PlotWidget::getMinimumValue(bool *ok) const
+{
+    const auto &bounds = getDataBounds();
 
-        if (value < minimum)
-        {
-            // A sample has been found
-            if (ok != nullptr)
-            {
-                *ok = true;
-            }
+    const QwtInterval values = bounds.left | bounds.right;
 
-            minimum = value;
-        }
+    if (ok != nullptr)
+    {
+        *ok = values.isValid();
     }
 
-    return minimum;
+    return values.isValid() ? values.minValue() : __DBL_MAX__;
 }
 
 
@@ -244,48 +294,19 @@ double PlotWidget::getMinimumValue(bool *ok) const
  */
 double PlotWidget::getMaximumValue(bool *ok) const
 {
-    double maximum = __DBL_MIN__;
+    const auto &bounds = getDataBounds();
 
-    double value = 0;
+    const QwtInterval values = bounds.left | bounds.right;
 
     if (ok != nullptr)
     {
-        *ok = false;
-    }
-
-    for (auto curve : curves)
-    {
-        // Ignore null curves
-        if (curve.isNull()) continue;
-
-        // Ignore hidden curves
-        if (!curve->isVisible()) continue;
-
-        auto series = curve->getDataSeries();
-
-        if (series.isNull()) continue;
-
-        if (!series->hasData()) continue;
-
-        value = series->getMaximumValue();
-
-        if (value > maximum)
-        {
-            // A sample has been found
-            if (ok != nullptr)
-            {
-                *ok = true;
-            }
-
-            maximum = value;
-        }
+        *ok = values.isValid();
     }
 
-    return maximum;
+    return values.isValid() ? values.maxValue() : -__DBL_MAX__;
 }
 
 
-
 /**
  * @brief PlotWidget::getVisibleCurves returns a list of visible curves
  * @param axisId is the ID of the yAxis (use yBoth for all curves)
@@ -349,14 +370,24 @@ void PlotWidget::onContextMenu(const QPoint &pos)
     // Data menu
     QMenu *dataMenu = new QMenu(tr("Data"), &menu);
 
-    QAction *exportData = dataMenu->addAction(tr("Export Data"));
+    // Export submenu
+    QMenu *exportMenu = new QMenu(tr("Export Data"), dataMenu);
+
+    QAction *exportData = exportMenu->addAction(tr("All Data"));
+    QAction *exportVisible = exportMenu->addAction(tr("Visible Range"));
+    QAction *exportResampled = exportMenu->addAction(tr("Visible Range (Resampled)..."));
+    QAction *exportDecimated = exportMenu->addAction(tr("Visible Range (Decimated)..."));
+
+    dataMenu->addMenu(exportMenu);
+    QAction *viewData = dataMenu->addAction(tr("View Data at Cursor"));
     dataMenu->addSeparator();
     QAction *imageToClipboard = dataMenu->addAction(tr("Image to Clipboard"));
     QAction *imageToFile = dataMenu->addAction(tr("Image to File"));
     dataMenu->addSeparator();
     QAction *clearAll = dataMenu->addAction(tr("Clear All"));
 
-    exportData->setEnabled(curves.count() > 0);
+    exportMenu->setEnabled(curves.count() > 0);
+    viewData->setEnabled(curves.count() > 0);
 
     menu.addMenu(dataMenu);
 
@@ -399,9 +430,48 @@ void PlotWidget::onContextMenu(const QPoint &pos)
     // But it looks nice to show the shortcut key :)
     addMarker->setShortcut(QKeySequence(Qt::Key_Space));
 
+    QMenu *snapMenu = markerMenu->addMenu(tr("Snap Markers To"));
+
+    QAction *snapNone = snapMenu->addAction(tr("None"));
+    QAction *snapNearest = snapMenu->addAction(tr("Nearest Sample"));
+    QAction *snapMinimum = snapMenu->addAction(tr("Local Minimum"));
+    QAction *snapMaximum = snapMenu->addAction(tr("Local Maximum"));
+
+    snapNone->setCheckable(true);
+    snapNearest->setCheckable(true);
+    snapMinimum->setCheckable(true);
+    snapMaximum->setCheckable(true);
+
+    snapNone->setChecked(markerSnap == SNAP_NONE);
+    snapNearest->setChecked(markerSnap == SNAP_NEAREST);
+    snapMinimum->setChecked(markerSnap == SNAP_MINIMUM);
+    snapMaximum->setChecked(markerSnap == SNAP_MAXIMUM);
+
     markerMenu->addSeparator();
     QAction *clearMarkers = markerMenu->addAction(tr("Clear Markers"));
 
+    markerMenu->addSeparator();
+    QAction *addEvents = markerMenu->addAction(tr("Add Events from Tracked Curve"));
+    addEvents->setEnabled(isCurveTracked());
+
+    QAction *findEventsAction = markerMenu->addAction(tr("Find Events on Tracked Curve..."));
+    findEventsAction->setEnabled(isCurveTracked());
+
+    // As for "Add Marker", the shortcuts are handled by the event filter
+    QAction *nextEvent = markerMenu->addAction(tr("Next Event"));
+    nextEvent->setShortcut(QKeySequence(Qt::Key_BracketRight));
+    nextEvent->setEnabled(eventIndex && !eventIndex->isEmpty());
+
+    QAction *previousEvent = markerMenu->addAction(tr("Previous Event"));
+    previousEvent->setShortcut(QKeySequence(Qt::Key_BracketLeft));
+    previousEvent->setEnabled(eventIndex && !eventIndex->isEmpty());
+
+    QAction *eventStatistics = markerMenu->addAction(tr("Event Statistics"));
+    eventStatistics->setEnabled(eventIndex && eventSeries);
+
+    QAction *clearEvents = markerMenu->addAction(tr("Clear Event Layers"));
+    clearEvents->setEnabled(!eventLayers.isEmpty());
+
     menu.addMenu(markerMenu);
 
     // Plot submenu
@@ -411,6 +481,41 @@ void PlotWidget::onContextMenu(const QPoint &pos)
     syncAction->setCheckable(true);
     syncAction->setChecked(isTimescaleSynced());
 
+    QAction *followAction = plotMenu->addAction(tr("Follow Newest Data"));
+    followAction->setCheckable(true);
+    followAction->setChecked(isFollowingNewest());
+
+    QAction *progressiveAction = plotMenu->addAction(tr("Progressive Rendering"));
+    progressiveAction->setCheckable(true);
+    progressiveAction->setChecked(isProgressive());
+
+    QAction *hudAction = plotMenu->addAction(tr("Performance Overlay"));
+    hudAction->setCheckable(true);
+    hudAction->setChecked(isPerformanceHudEnabled());
+
+    QMenu *downsampleMenu = plotMenu->addMenu(tr("Downsampling"));
+
+    QAction *downsampleM4 = downsampleMenu->addAction(tr("Min / Max (M4)"));
+    QAction *downsampleLTTB = downsampleMenu->addAction(tr("Largest Triangle (LTTB)"));
+    QAction *downsampleDensity = downsampleMenu->addAction(tr("Sample Density"));
+
+    downsampleM4->setCheckable(true);
+    downsampleLTTB->setCheckable(true);
+    downsampleDensity->setCheckable(true);
+
+    downsampleM4->setChecked(getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_M4);
+    downsampleLTTB->setChecked(getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_LTTB);
+    downsampleDensity->setChecked(getDownsampleMode() == PlotCurveUpdater::DOWNSAMPLE_DENSITY);
+
+    // Applies to plots created after the setting is changed
+    QAction *openGLAction = plotMenu->addAction(tr("OpenGL Canvas (New Plots)"));
+    openGLAction->setCheckable(true);
+    openGLAction->setChecked(LumberjackSettings::getInstance()->loadBoolean("graph", "openGLCanvas", false));
+
+    QAction *gpuAction = plotMenu->addAction(tr("GPU Resampling"));
+    gpuAction->setCheckable(true);
+    gpuAction->setChecked(GpuCompute::getInstance()->isEnabled());
+
     QAction *bgColor = plotMenu->addAction(tr("Set Color"));
     QAction *plotTitle = plotMenu->addAction(tr("Set Title"));
 
@@ -452,6 +557,22 @@ void PlotWidget::onContextMenu(const QPoint &pos)
     {
         exportDataToFile();
     }
+    else if (action == exportVisible)
+    {
+        exportVisibleData(ExportScope::SCOPE_ALL);
+    }
+    else if (action == exportResampled)
+    {
+        exportVisibleData(ExportScope::SCOPE_RESAMPLE);
+    }
+    else if (action == exportDecimated)
+    {
+        exportVisibleData(ExportScope::SCOPE_DECIMATE);
+    }
+    else if (action == viewData)
+    {
+        viewDataAtTimestamp(timestamp);
+    }
     else if (action == imageToClipboard)
     {
         saveImageToClipboard();
@@ -491,10 +612,94 @@ void PlotWidget::onContextMenu(const QPoint &pos)
     {
         removeAllMarkers();
     }
+    else if (action == snapNone)
+    {
+        setMarkerSnap(SNAP_NONE);
+    }
+    else if (action == snapNearest)
+    {
+        setMarkerSnap(SNAP_NEAREST);
+    }
+    else if (action == snapMinimum)
+    {
+        setMarkerSnap(SNAP_MINIMUM);
+    }
+    else if (action == snapMaximum)
+    {
+        setMarkerSnap(SNAP_MAXIMUM);
+    }
+    else if (action == addEvents)
+    {
+        if (isCurveTracked())
+        {
+            auto series = tracking_curve->getDataSeries();
+
+            addEventLayer(EventStore::fromChanges(series->getSnapshot(), series->getLabel()), tracking_curve->pen().color());
+        }
+    }
+    else if (action == findEventsAction)
+    {
+        findEvents();
+    }
+    else if (action == nextEvent)
+    {
+        jumpToEvent(true);
+    }
+    else if (action == previousEvent)
+    {
+        jumpToEvent(false);
+    }
+    else if (action == eventStatistics)
+    {
+        showEventStatistics();
+    }
+    else if (action == clearEvents)
+    {
+        removeAllEventLayers();
+    }
     else if (action == syncAction)
     {
         setTimescaleSynced(!isTimescaleSynced());
     }
+    else if (action == followAction)
+    {
+        setFollowNewest(!isFollowingNewest());
+    }
+    else if (action == progressiveAction)
+    {
+        setProgressive(!isProgressive());
+    }
+    else if (action == hudAction)
+    {
+        setPerformanceHudEnabled(!isPerformanceHudEnabled());
+    }
+    else if (action == downsampleM4)
+    {
+        setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_M4);
+    }
+    else if (action == downsampleLTTB)
+    {
+        setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_LTTB);
+    }
+    else if (action == downsampleDensity)
+    {
+        setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_DENSITY);
+    }
+    else if (action == openGLAction)
+    {
+        LumberjackSettings::getInstance()->saveSetting("graph", "openGLCanvas", openGLAction->isChecked());
+    }
+    else if (action == gpuAction)
+    {
+        LumberjackSettings::getInstance()->saveSetting("graph", "gpuCompute", gpuAction->isChecked());
+        GpuCompute::getInstance()->setEnabled(gpuAction->isChecked());
+
+        // Curves are resampled on the CPU until a compute context can be created
+        if (gpuAction->isChecked() && !GpuCompute::getInstance()->isAvailable())
+        {
+            QMessageBox::warning(this, tr("GPU Resampling"), tr("GPU resampling requires OpenGL 4.3 (or OpenGL ES 3.1), which is not available"));
+        }
+    }
     else if (action == bgColor)
     {
         selectBackgroundColor();
@@ -521,6 +726,32 @@ void PlotWidget::addMarker(double timestamp, QSharedPointer<PlotCurve> curve)
         // Point
         value = curve->getDataSeries()->getValueAtTime(timestamp);
 
+        const DataSnapshot snapshot = curve->getDataSeries()->getSnapshot();
+
+        if (markerSnap != SNAP_NONE && !snapshot.isEmpty())
+        {
+            DataPoint point;
+
+            if (markerSnap == SNAP_NEAREST)
+            {
+                point = snapshot.getNearestPoint(timestamp);
+            }
+            else
+            {
+                // Search for the feature within a few pixels of the requested position
+                const QwtScaleMap map = canvasMap(QwtPlot::xBottom);
+                const double window = std::fabs(map.invTransform(MARKER_SNAP_PIXELS) - map.invTransform(0));
+
+                const uint64_t idx_first = snapshot.lowerBound(timestamp - window);
+                const uint64_t idx_last = snapshot.upperBound(timestamp + window);
+
+                point = snapshot.getExtremePoint(idx_first, idx_last, markerSnap == SNAP_MAXIMUM);
+            }
+
+            timestamp = point.timestamp;
+            value = point.value;
+        }
+
         marker->setLineStyle(QwtPlotMarker::NoLine);
         marker->setSymbol(new QwtSymbol(QwtSymbol::Ellipse, QBrush(Qt::cyan), QPen(Qt::cyan), QSize(4, 4)));
         marker->setLabelOrientation(Qt::Horizontal);
@@ -608,6 +839,168 @@ void PlotWidget::removeAllMarkers()
 }
 
 
+/**
+ * @brief PlotWidget::addEventLayer overlays a set of events on the plot
+ * @param events - Events to draw
+ * @param color - Color of the event markers
+ */
+void PlotWidget::addEventLayer(EventStorePointer events, const QColor &color)
+{
+    if (!events) return;
+
+    auto *layer = new PlotMarkerLayer(events, color);
+
+    layer->attach(this);
+
+    eventLayers.append(layer);
+
+    replot();
+}
+
+
+/**
+ * @brief PlotWidget::removeAllEventLayers removes all displayed event layers
+ */
+void PlotWidget::removeAllEventLayers()
+{
+    for (auto *layer : eventLayers)
+    {
+        if (!layer) continue;
+
+        layer->detach();
+
+        delete layer;
+    }
+
+    eventLayers.clear();
+
+    eventIndex.reset();
+    eventSeries.clear();
+
+    replot();
+}
+
+
+/**
+ * @brief PlotWidget::findEvents - Find the intervals of the tracked curve which satisfy a condition
+ * (e.g. exceeding a threshold), overlay the start of each interval, and navigate between them
+ */
+void PlotWidget::findEvents()
+{
+    if (!isCurveTracked()) return;
+
+    auto series = tracking_curve->getDataSeries();
+
+    if (series.isNull()) return;
+
+    QStringList conditions;
+
+    for (int condition = EventIndex::CONDITION_ABOVE; condition <= EventIndex::CONDITION_GAPS; condition++)
+    {
+        conditions << EventIndex::getConditionName(condition);
+    }
+
+    auto *settings = LumberjackSettings::getInstance();
+
+    bool ok = false;
+
+    QString selected = QInputDialog::getItem(this, tr("Find Events"), tr("Find in %1").arg(series->getLabel()),
+                                             conditions, settings->loadSetting("events", "condition", 0).toInt(), false, &ok);
+
+    if (!ok) return;
+
+    const int condition = conditions.indexOf(selected);
+
+    double threshold = 0;
+
+    if (condition == EventIndex::CONDITION_ABOVE || condition == EventIndex::CONDITION_BELOW)
+    {
+        // Default to the middle of the visible range of the curve
+        const QRectF bounds = tracking_curve->boundingRect();
+
+        threshold = QInputDialog::getDouble(this, tr("Find Events"), tr("Threshold"), bounds.center().y(), -1e300, 1e300, 6, &ok);
+    }
+    else if (condition == EventIndex::CONDITION_GAPS)
+    {
+        threshold = QInputDialog::getDouble(this, tr("Find Events"), tr("Longest spacing between samples (ms)"),
+                                            settings->loadSetting("events", "gap", 1000).toDouble(), 0, 1e15, 3, &ok);
+
+        if (ok) settings->saveSetting("events", "gap", threshold);
+    }
+
+    if (!ok) return;
+
+    settings->saveSetting("events", "condition", condition);
+
+    auto index = EventIndex::build(series->getSnapshot(), condition, threshold);
+
+    addEventLayer(index->toEventStore(series->getLabel()), tracking_curve->pen().color());
+    setEventIndex(index, series);
+
+    jumpToEvent(true);
+}
+
+
+void PlotWidget::setEventIndex(EventIndexPointer index, DataSeriesPointer series)
+{
+    eventIndex = index;
+    eventSeries = series;
+}
+
+
+/**
+ * @brief PlotWidget::jumpToEvent - Centre the view on the next (or previous) event, keeping the zoom level
+ * @param forward - Step to the next event (otherwise the previous event)
+ * @return true if there was an event to step to
+ */
+bool PlotWidget::jumpToEvent(bool forward)
+{
+    if (!eventIndex || eventIndex->isEmpty()) return false;
+
+    const auto view = axisInterval(QwtPlot::xBottom);
+    const double centre = 0.5 * (view.minValue() + view.maxValue());
+
+    // Events within a pixel of the centre have already been reached
+    const double epsilon = view.width() / std::max(1, getHorizontalPixels());
+
+    const EventIndex::Interval *interval = forward ? eventIndex->next(centre + epsilon) : eventIndex->previous(centre - epsilon);
+
+    if (!interval) return false;
+
+    const double half = 0.5 * view.width();
+
+    setTimeInterval(QwtInterval(interval->t_start - half, interval->t_start + half));
+
+    return true;
+}
+
+
+/**
+ * @brief PlotWidget::showEventStatistics - Display the statistics of the series within the current events
+ */
+void PlotWidget::showEventStatistics()
+{
+    if (!eventIndex || !eventSeries) return;
+
+    const auto stats = eventIndex->getStatistics(eventSeries->getSnapshot());
+
+    QString text = tr("%1 events (%2)").arg(eventIndex->size()).arg(EventIndex::getConditionName(eventIndex->getCondition()));
+
+    text += "\n" + tr("Total duration: %1 ms").arg(eventIndex->getDuration());
+
+    if (stats.count > 0)
+    {
+        text += "\n" + tr("Samples: %1").arg(stats.count);
+        text += "\n" + tr("Minimum: %1").arg(stats.min);
+        text += "\n" + tr("Maximum: %1").arg(stats.max);
+        text += "\n" + tr("Mean: %1").arg(stats.getMean());
+        text += "\n" + tr("RMS: %1").arg(stats.getRms());
+    }
+
+    QMessageBox::information(this, tr("Event Statistics"), text);
+}
+
+
 /**
  * @brief PlotWidget::setBackgroundColor launches a dialog to select the background color
  */
@@ -659,56 +1052,266 @@ void PlotWidget::setPlotTitle(QString title)
 
 /**
  * @brief PlotWidget::exportDataToFile - export data to a file
+ * @param scope - Samples of each series to export
  */
-void PlotWidget::exportDataToFile()
+void PlotWidget::exportDataToFile(const ExportScope &scope)
 {
     auto manager = DataSourceManager::getInstance();
 
-    QList<DataSeriesPointer> dataSeries;
+    QList<DataSeriesPointer> dataSeries;
+
+    for (auto curve : curves)
+    {
+        dataSeries.append(curve->getDataSeries());
+    }
+
+    manager->exportData(dataSeries, QString(), scope);
+}
+
+
+/**
+ * @brief PlotWidget::viewDataAtTimestamp - open a table of the samples of the visible curves, at the specified timestamp
+ * @param timestamp - The row at (or after) this timestamp is selected
+ */
+void PlotWidget::viewDataAtTimestamp(double timestamp)
+{
+    QList<DataSeriesPointer> seriesList;
+
+    for (auto curve : getVisibleCurves())
+    {
+        if (!curve.isNull() && !curve->getDataSeries().isNull())
+        {
+            seriesList.append(curve->getDataSeries());
+        }
+    }
+
+    if (seriesList.isEmpty()) return;
+
+    DataSeriesTableView *table = new DataSeriesTableView(seriesList);
+
+    table->setAttribute(Qt::WA_DeleteOnClose);
+    table->resize(std::min(200 + 150 * (int) seriesList.count(), 1200), 600);
+    table->show();
+    table->scrollToTimestamp(timestamp);
+}
+
+
+/**
+ * @brief PlotWidget::exportVisibleData - export the data within the visible time range to a file
+ * @param mode - Export every sample, or resample (or decimate) the samples, as selected by the user
+ */
+void PlotWidget::exportVisibleData(ExportScope::Mode mode)
+{
+    auto *settings = LumberjackSettings::getInstance();
+
+    const auto interval = axisInterval(QwtPlot::xBottom);
+
+    ExportScope scope;
+
+    scope.mode = mode;
+    scope.rangeOnly = true;
+    scope.tMin = interval.minValue();
+    scope.tMax = interval.maxValue();
+
+    bool ok = true;
+
+    if (mode == ExportScope::SCOPE_RESAMPLE)
+    {
+        scope.rate = QInputDialog::getDouble(
+            this,
+            tr("Export Resampled Data"),
+            tr("Sample rate (Hz)"),
+            settings->loadSetting("export", "resampleRate", 100).toDouble(),
+            0.001, 1e6, 3, &ok
+        );
+
+        if (ok) settings->saveSetting("export", "resampleRate", scope.rate);
+    }
+    else if (mode == ExportScope::SCOPE_DECIMATE)
+    {
+        scope.points = QInputDialog::getInt(
+            this,
+            tr("Export Decimated Data"),
+            tr("Number of points (per series)"),
+            settings->loadSetting("export", "decimatePoints", 10000).toInt(),
+            4, 100000000, 1000, &ok
+        );
+
+        if (ok) settings->saveSetting("export", "decimatePoints", (int) scope.points);
+    }
+
+    if (ok)
+    {
+        exportDataToFile(scope);
+    }
+}
+
+
+/**
+ * @brief PlotWidget::saveImageToClipboard - copy the current plot view to clipboard
+ */
+void PlotWidget::saveImageToClipboard()
+{
+    auto *cliboard = QGuiApplication::clipboard();
+
+    replotNow();
+
+    cliboard->setPixmap(grab());
+}
+
+
+/**
+ * @brief PlotWidget::saveImageToFile - Save the current plot view to an image file
+ */
+void PlotWidget::saveImageToFile()
+{
+    replotNow();
+
+    auto image = grab().toImage();
+
+    QString filename = QFileDialog::getSaveFileName(
+                this,
+                tr("Save Screenshot"),
+                "screenshot.png");
+
+    if (!filename.isEmpty())
+    {
+        image.save(filename);
+    }
+}
+
+
+
+void PlotWidget::setTimeInterval(const QwtInterval &interval)
+{
+    autoScale(QwtPlot::xBottom, interval);
+
+    replot();
+}
+
+
+/**
+ * @brief PlotWidget::getWorkspaceState - Describe the plot, so it can be restored from a workspace.
+ * Curves are identified by the labels of their source and series (see DataSourceManager::findSource)
+ */
+WorkspaceFile::PlotState PlotWidget::getWorkspaceState()
+{
+    auto *manager = DataSourceManager::getInstance();
+
+    WorkspaceFile::PlotState state;
+
+    // Curves which are stored, so that markers can refer to their curve by index
+    QList<QSharedPointer<PlotCurve>> stored;
+
+    for (const auto &curve : curves)
+    {
+        if (curve.isNull()) continue;
+
+        auto series = curve->getDataSeries();
+        auto source = manager->findSource(series);
+
+        if (source.isNull()) continue;
+
+        WorkspaceFile::CurveState curveState;
+
+        curveState.source = source->getLabel();
+        curveState.series = series->getLabel();
+        curveState.axis = curve->yAxis();
+
+        state.curves.append(curveState);
+        stored.append(curve);
+    }
+
+    for (const auto *marker : markers)
+    {
+        if (!marker) continue;
+
+        WorkspaceFile::MarkerState markerState;
 
-    for (auto curve : curves)
-    {
-        dataSeries.append(curve->getDataSeries());
+        markerState.timestamp = marker->xValue();
+        markerState.curve = marker->curve.isNull() ? -1 : stored.indexOf(marker->curve);
+
+        // The curve of the marker is not part of the workspace
+        if (!marker->curve.isNull() && markerState.curve < 0) continue;
+
+        state.markers.append(markerState);
     }
 
-    manager->exportData(dataSeries);
-}
+    const auto time = axisInterval(QwtPlot::xBottom);
+    const auto left = axisInterval(QwtPlot::yLeft);
+    const auto right = axisInterval(QwtPlot::yRight);
 
+    state.t_min = time.minValue();
+    state.t_max = time.maxValue();
+    state.y1_min = left.minValue();
+    state.y1_max = left.maxValue();
+    state.y2_min = right.minValue();
+    state.y2_max = right.maxValue();
 
-/**
- * @brief PlotWidget::saveImageToClipboard - copy the current plot view to clipboard
- */
-void PlotWidget::saveImageToClipboard()
-{
-    auto *cliboard = QGuiApplication::clipboard();
+    state.xGrid = isXGridEnabled();
+    state.yGrid = isYGridEnabled();
+    state.timescaleSynced = syncedTimescale;
+    state.followNewest = followNewest;
+    state.downsampleMode = downsampleMode;
+    state.markerSnap = markerSnap;
 
-    cliboard->setPixmap(grab());
+    return state;
 }
 
 
 /**
- * @brief PlotWidget::saveImageToFile - Save the current plot view to an image file
+ * @brief PlotWidget::restoreWorkspaceState - Replace the curves, view and options of the plot with
+ * those of a workspace (curves whose series cannot be found are skipped)
  */
-void PlotWidget::saveImageToFile()
+void PlotWidget::restoreWorkspaceState(const WorkspaceFile::PlotState &state)
 {
-    auto image = grab().toImage();
+    auto *manager = DataSourceManager::getInstance();
 
-    QString filename = QFileDialog::getSaveFileName(
-                this,
-                tr("Save Screenshot"),
-                "screenshot.png");
+    removeAllMarkers();
+    removeAllSeries();
 
-    if (!filename.isEmpty())
+    // The view is restored first, so each curve is only resampled for the restored view
+    if (state.t_max > state.t_min) setAxisScale(QwtPlot::xBottom, state.t_min, state.t_max);
+    if (state.y1_max > state.y1_min) setAxisScale(QwtPlot::yLeft, state.y1_min, state.y1_max);
+    if (state.y2_max > state.y2_min) setAxisScale(QwtPlot::yRight, state.y2_min, state.y2_max);
+
+    // The mode is not saved as the default for new plots (see setDownsampleMode)
+    downsampleMode = state.downsampleMode;
+
+    QList<QSharedPointer<PlotCurve>> restored;
+
+    for (const auto &curveState : state.curves)
     {
-        image.save(filename);
+        auto series = manager->findSeries(curveState.source, curveState.series);
+
+        if (series.isNull())
+        {
+            qWarning() << "Could not find series" << curveState.source << ":" << curveState.series;
+        }
+
+        restored.append(addSeries(series, curveState.axis) ? curves.last() : QSharedPointer<PlotCurve>());
     }
-}
 
+    // Markers are placed where they were saved (rather than snapped again)
+    markerSnap = SNAP_NONE;
+
+    for (const auto &markerState : state.markers)
+    {
+        const auto curve = markerState.curve >= 0 ? restored.value(markerState.curve) : QSharedPointer<PlotCurve>();
 
+        if (markerState.curve >= 0 && curve.isNull()) continue;
 
-void PlotWidget::setTimeInterval(const QwtInterval &interval)
-{
-    autoScale(QwtPlot::xBottom, interval);
+        addMarker(markerState.timestamp, curve);
+    }
+
+    markerSnap = state.markerSnap;
+
+    xGridEnable(state.xGrid);
+    yGridEnable(state.yGrid);
+
+    syncedTimescale = state.timescaleSynced;
+
+    setFollowNewest(state.followNewest);
 
     replot();
 }
@@ -813,6 +1416,8 @@ void PlotWidget::dropEvent(QDropEvent *event)
     }
     else
     {
+        QStringList filenames;
+
         for (const QUrl &url : event->mimeData()->urls())
         {
             const QString& filename = url.toLocalFile();
@@ -821,9 +1426,15 @@ void PlotWidget::dropEvent(QDropEvent *event)
 
             if (info.exists() && info.isFile())
             {
-                emit fileDropped(filename);
+                filenames.append(filename);
             }
         }
+
+        // The files are imported together
+        if (!filenames.isEmpty())
+        {
+            emit filesDropped(filenames);
+        }
     }
 }
 
@@ -956,6 +1567,266 @@ void PlotWidget::updateTimestampLimits()
 }
 
 
+/*
+ * Select the down-sampling algorithm for the curves in this plot.
+ * The selection is also saved as the default for new plots.
+ */
+void PlotWidget::setDownsampleMode(int mode)
+{
+    downsampleMode = mode;
+
+    for (auto curve : curves)
+    {
+        if (!curve.isNull())
+        {
+            curve->setDownsampleMode(mode);
+        }
+    }
+
+    LumberjackSettings::getInstance()->saveSetting("graph", "downsampleMode", mode);
+}
+
+
+/*
+ * Enable or disable progressive resampling.
+ * The selection is also saved as the default for new plots.
+ */
+void PlotWidget::setProgressive(bool enable)
+{
+    progressive = enable;
+
+    LumberjackSettings::getInstance()->saveSetting("graph", "progressiveRendering", enable);
+}
+
+
+void PlotWidget::setPerformanceHudEnabled(bool enable)
+{
+    performanceHud = enable;
+
+    replot();
+}
+
+
+/*
+ * Draw the items of the canvas, measuring the duration of each paint (see PlotPerformanceMonitor)
+ */
+void PlotWidget::drawCanvas(QPainter *painter)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QwtPlot::drawCanvas(painter);
+
+    performance.recordPaint(elapsed.nsecsElapsed() * 1e-6, performance.now());
+
+    if (performanceHud)
+    {
+        drawPerformanceHud(painter);
+    }
+}
+
+
+/*
+ * Draw the performance figures in the top left corner of the canvas
+ */
+void PlotWidget::drawPerformanceHud(QPainter *painter)
+{
+    std::vector<PlotPerformanceMonitor::CurveInfo> info;
+
+    for (const auto &curve : curves)
+    {
+        if (curve.isNull() || !curve->isVisible()) continue;
+
+        PlotPerformanceMonitor::CurveInfo entry;
+
+        entry.label = curve->title().text();
+        entry.stats = curve->getResampleStats();
+        entry.pending = curve->isResamplePending();
+
+        info.push_back(entry);
+    }
+
+    const QStringList lines = performance.describe(info, performance.now());
+
+    painter->save();
+
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    painter->setFont(font);
+
+    const QFontMetrics metrics(font);
+
+    int width = 0;
+
+    for (const QString &line : lines)
+    {
+        width = qMax(width, metrics.horizontalAdvance(line));
+    }
+
+    const int margin = 4;
+    const QRect box(margin, margin, width + 2 * margin, lines.count() * metrics.height() + 2 * margin);
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QColor(0, 0, 0, 160));
+    painter->drawRect(box);
+
+    painter->setPen(Qt::white);
+
+    for (int idx = 0; idx < lines.count(); idx++)
+    {
+        painter->drawText(box.left() + margin, box.top() + margin + idx * metrics.height() + metrics.ascent(), lines.at(idx));
+    }
+
+    painter->restore();
+}
+
+
+/*
+ * The axes are updated immediately (so that the axis intervals are current),
+ * but the canvas is re-drawn in the next display frame (see PlotReplotScheduler).
+ */
+void PlotWidget::replot()
+{
+    updateAxes();
+
+    scheduleReplot();
+}
+
+
+/*
+ * Re-draw the canvas without waiting for the next frame
+ */
+void PlotWidget::replotNow()
+{
+    PlotReplotScheduler::getInstance()->replotNow(this);
+}
+
+
+/*
+ * Called when a curve has new samples to draw.
+ * Completions from every curve (and every plot) are coalesced into a single replot per frame.
+ */
+void PlotWidget::scheduleReplot()
+{
+    PlotReplotScheduler::getInstance()->requestReplot(this);
+}
+
+
+/*
+ * Enable or disable live tail mode.
+ * While following, the time axis tracks the newest sample (retaining the visible timespan),
+ * so that data from a live source scroll into view.
+ */
+void PlotWidget::setFollowNewest(bool follow)
+{
+    followNewest = follow;
+
+    if (follow)
+    {
+        followTimer.start(FOLLOW_INTERVAL);
+        updateFollow();
+    }
+    else
+    {
+        followTimer.stop();
+    }
+}
+
+
+/*
+ * Move the time axis to the newest sample (if new data have arrived since the last update).
+ * Curves only compute the pixel columns for newly exposed data (see PlotColumnCache),
+ * and series with a retention limit do not grow, so the cost of following is bounded.
+ */
+void PlotWidget::updateFollow()
+{
+    bool ok = false;
+
+    double t_newest = getNewestTimestamp(&ok);
+
+    if (!ok || t_newest == followTimestamp) return;
+
+    followTimestamp = t_newest;
+
+    auto interval = axisInterval(QwtPlot::xBottom);
+
+    setAxisScale(QwtPlot::xBottom, t_newest - interval.width(), t_newest);
+
+    resampleCurves();
+    replot();
+
+    updateCurrentView();
+    updateTimestampLimits();
+}
+
+
+/*
+ * The samples of the series of a curve have changed within [t_min, t_max].
+ * The curve is only resampled if the change is visible: a curve is drawn to the samples either side of the view,
+ * so the change is extended to the neighbouring samples before it is compared with the view.
+ */
+void PlotWidget::onSeriesChanged(double t_min, double t_max)
+{
+    auto *curve = qobject_cast<PlotCurve*>(sender());
+
+    performance.recordChange(performance.now());
+
+    invalidateDataBounds();
+
+    if (curve && !curve->getDataSeries().isNull())
+    {
+        const DataSnapshot snapshot = curve->getDataSeries()->getRawSnapshot();
+
+        const uint64_t idx_first = snapshot.lowerBound(t_min);
+        const uint64_t idx_last = snapshot.upperBound(t_max);
+
+        const double t_before = idx_first > 0 ? snapshot.getDataPoint(idx_first - 1).timestamp : t_min;
+        const double t_after = idx_last < snapshot.size() ? snapshot.getDataPoint(idx_last).timestamp : t_max;
+
+        const auto interval = axisInterval(QwtPlot::xBottom);
+
+        if (t_before <= interval.maxValue() && t_after >= interval.minValue())
+        {
+            changedCurves.insert(curve);
+        }
+    }
+
+    // The timestamp limits are updated even if the change is not visible
+    scheduleDataUpdate();
+}
+
+
+/*
+ * Schedule the curves to be resampled, when the samples of any series have changed.
+ * A series which is being imported changes continuously, so the plot is updated at most once per DATA_UPDATE_INTERVAL.
+ */
+void PlotWidget::scheduleDataUpdate()
+{
+    if (!dataTimer.isActive())
+    {
+        dataTimer.start(DATA_UPDATE_INTERVAL);
+    }
+}
+
+
+void PlotWidget::updateData()
+{
+    auto interval = axisInterval(QwtPlot::xBottom);
+
+    const int n_pixels = getHorizontalPixels();
+
+    for (auto curve : curves)
+    {
+        if (curve.isNull() || !changedCurves.contains(curve.data())) continue;
+
+        curve->resampleData(interval.minValue(), interval.maxValue(), n_pixels, progressive);
+    }
+
+    changedCurves.clear();
+
+    updateTimestampLimits();
+}
+
+
 /*
  * Resample all attached curves to the displayed time region
  *
@@ -986,7 +1857,8 @@ void PlotWidget::resampleCurves(int axis_id)
             continue;
         }
 
-        curve->resampleData(interval.minValue(), interval.maxValue(), n_pixels);
+        // Each curve is first drawn coarsely, so the view responds within a frame
+        curve->resampleData(interval.minValue(), interval.maxValue(), n_pixels, progressive);
     }
 }
 
@@ -1224,6 +2096,12 @@ bool PlotWidget::eventFilter(QObject *target, QEvent *event)
                     return true;
                 }
             }
+
+            if (keyPressEvent && keyPressEvent->modifiers() == Qt::NoModifier &&
+                (keyPressEvent->key() == Qt::Key_BracketRight || keyPressEvent->key() == Qt::Key_BracketLeft))
+            {
+                if (jumpToEvent(keyPressEvent->key() == Qt::Key_BracketRight)) return true;
+            }
             break;
         }
         default:
@@ -1264,7 +2142,8 @@ void PlotWidget::wheelEvent(QWheelEvent *event)
         zoom_vertical = false;
     }
 
-    double factor = 1.25;
+    // Curves prefetch the views one wheel step in and out (see PlotCurveUpdater::prefetchNeighbours)
+    double factor = PlotCurveUpdater::ZOOM_STEP;
 
     if (delta.y() > 0)
     {
@@ -1437,13 +2316,13 @@ void PlotWidget::mouseMoveEvent(QMouseEvent *event)
     // Are we tracking a curve?
     if (isCurveTrackingEnabled() && !tracking_curve.isNull())
     {
-        auto series = tracking_curve->getDataSeries();
+        updateHoverLookup();
 
-        if (!series.isNull() && series->size() > 0)
-        {
-            y = tracking_curve->getDataSeries()->getValueAtTime(x);
+        const double value = hoverLookup.lookup(hoverLookup.indexOf(tracking_curve->getDataSeries()), x);
 
-            y = transform(tracking_curve->yAxis(), y);
+        if (!std::isnan(value))
+        {
+            y = transform(tracking_curve->yAxis(), value);
 
             pen.setColor(tracking_curve->pen().color());
             crosshair->setLinePen(pen);
@@ -1472,6 +2351,52 @@ void PlotWidget::mouseMoveEvent(QMouseEvent *event)
 }
 
 
+/*
+ * Keep the hover lookup in step with the visible curves and the current view.
+ * Cursors are retained between mouse events, so each lookup starts from the previous one.
+ */
+void PlotWidget::updateHoverLookup()
+{
+    auto visible = getVisibleCurves();
+
+    QList<DataSeriesPointer> series;
+
+    for (const auto &curve : visible)
+    {
+        series.append(curve->getDataSeries());
+    }
+
+    bool changed = false;
+
+    if (series != hoverLookup.getDataSeries())
+    {
+        hoverLookup.setSeries(series);
+        changed = true;
+    }
+
+    const QwtInterval interval = axisInterval(QwtPlot::xBottom);
+    const int pixels = getHorizontalPixels();
+
+    if (changed || interval != hoverInterval || pixels != hoverPixels)
+    {
+        hoverLookup.setView(interval.minValue(), interval.maxValue(), pixels);
+
+        hoverInterval = interval;
+        hoverPixels = pixels;
+    }
+
+    for (int idx = 0; idx < visible.count(); idx++)
+    {
+        const PlotSeriesData *data = visible.at(idx)->getSampleData();
+
+        if (data)
+        {
+            hoverLookup.setSamples(idx, data->getSamples(), data->getScaler(), data->getOffset());
+        }
+    }
+}
+
+
 void PlotWidget::mousePressEvent(QMouseEvent *event)
 {
     QPoint canvas_pos = canvas()->mapFromGlobal(mapToGlobal(event->pos()));
@@ -1624,8 +2549,12 @@ bool PlotWidget::addSeries(DataSeriesPointer series, int axis_id)
     PlotCurve *curve = new PlotCurve(series, worker);
 
     curve->setYAxis(axis_id);
+    curve->setDownsampleMode(downsampleMode);
     curve->attach(this);
 
+    connect(curve, &PlotCurve::samplesUpdated, this, &PlotWidget::scheduleReplot);
+    connect(curve, &PlotCurve::seriesUpdated, this, &PlotWidget::onSeriesChanged);
+
     curves.push_back(QSharedPointer<PlotCurve>(curve));
 
     auto interval = axisInterval(QwtPlot::xBottom);
@@ -1717,40 +2646,15 @@ void PlotWidget::removeAllSeries()
  */
 void PlotWidget::autoScale(int axis_id)
 {
-    QwtInterval interval_bottom;
-    QwtInterval interval_left;
-    QwtInterval interval_right;
-
-    bool update = false;
-    bool update_left = false;
-    bool update_right = false;
-
-    for (auto curve : curves)
-    {
-        // Ignore hidden data curves
-        if (curve.isNull() || !curve->isVisible()) continue;
-
-        auto series = curve->getDataSeries();
-
-        if (series.isNull() || series->size() == 0) continue;
-
-        interval_bottom |= QwtInterval(series->getOldestTimestamp(), series->getNewestTimestamp());
-
-        QwtInterval y(series->getMinimumValue(), series->getMaximumValue());
+    const auto &bounds = getDataBounds();
 
-        if (curve->yAxis() == QwtPlot::yLeft)
-        {
-            interval_left |= y;
-            update_left = true;
-        }
-        else if (curve->yAxis() == QwtPlot::yRight)
-        {
-            interval_right |= y;
-            update_right = true;
-        }
+    const QwtInterval interval_bottom = bounds.time;
+    const QwtInterval interval_left = bounds.left;
+    const QwtInterval interval_right = bounds.right;
 
-        update = true;
-    }
+    const bool update = interval_bottom.isValid();
+    const bool update_left = interval_left.isValid();
+    const bool update_right = interval_right.isValid();
 
     // Return if no curves were available for updating
     if (!update) return;
@@ -1823,8 +2727,10 @@ void PlotWidget::autoScale(QSharedPointer<PlotCurve> curve)
     double t_min = series->getOldestTimestamp();
     double t_max = series->getNewestTimestamp();
 
-    double y_min = series->getMinimumValue();
-    double y_max = series->getMaximumValue();
+    double y_min = 0;
+    double y_max = 0;
+
+    series->getValueRange(y_min, y_max);
 
     setAxisScale(QwtPlot::xBottom, t_min, t_max);
     setAxisScale(curve->yAxis(), y_min, y_max);
@@ -1888,5 +2794,13 @@ int PlotWidget::getHorizontalPixels() const
  */
 PlotCurveUpdater* PlotWidget::generateNewWorker(DataSeriesPointer series)
 {
+    // Lazy math traces are evaluated only for the visible timespan
+    auto math = series.dynamicCast<MathDataSeries>();
+
+    if (math && math->isLazy())
+    {
+        return new MathCurveUpdater(*math);
+    }
+
     return new PlotCurveUpdater(*series);
 }
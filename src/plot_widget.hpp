@@ -2,6 +2,8 @@
 #define PLOT_WIDGET_HPP
 
 #include <QMouseEvent>
+#include <QSet>
+#include <QTimer>
 #include <QWheelEvent>
 
 #include <qwt_plot.h>
@@ -14,6 +16,11 @@
 #include "plot_panner.hpp"
 #include "plot_curve.hpp"
 #include "plot_marker.hpp"
+#include "plot_performance.hpp"
+#include "hover_lookup.hpp"
+#include "event_index.hpp"
+#include "plugin_exporter.hpp"
+#include "workspace_file.hpp"
 
 
 class PlotWidget : public QwtPlot
@@ -34,9 +41,79 @@ public:
 
     QList<QSharedPointer<PlotCurve>> getVisibleCurves(int axisId = yBoth);
 
+    /**
+     * @brief The DataBounds struct holds the combined bounds of the visible curves
+     */
+    struct DataBounds
+    {
+        QwtInterval time;
+        QwtInterval left;
+        QwtInterval right;
+
+        //! Curves which the bounds describe (any change invalidates the bounds)
+        struct CurveState
+        {
+            const PlotCurve *curve;
+            bool visible;
+            int axis;
+
+            bool operator==(const CurveState &other) const { return curve == other.curve && visible == other.visible && axis == other.axis; }
+        };
+
+        std::vector<CurveState> state;
+
+        bool valid = false;
+    };
+
+    const DataBounds& getDataBounds(void) const;
+
+    static std::vector<QRectF> getSeriesBounds(const std::vector<DataSeriesPointer> &series);
+
+    //! Bounds of the series are computed on the thread pool if there are at least this many
+    static const int PARALLEL_BOUNDS_SERIES = 16;
+
     bool isTimescaleSynced(void) const { return syncedTimescale; }
     void setTimescaleSynced(bool sync) { syncedTimescale = sync; }
 
+    //! Interval between updates of the time axis, when following the newest data (ms)
+    static const int FOLLOW_INTERVAL = 40;
+
+    //! Minimum interval between resampling the curves after their series have changed (ms)
+    static const int DATA_UPDATE_INTERVAL = 100;
+
+    bool isFollowingNewest(void) const { return followNewest; }
+    void setFollowNewest(bool follow);
+
+    //! Down-sampling algorithm used by every curve in this plot (see PlotCurveUpdater::DownsampleMode)
+    int getDownsampleMode(void) const { return downsampleMode; }
+
+    enum MarkerSnap
+    {
+        SNAP_NONE = 0,
+        SNAP_NEAREST,
+        SNAP_MINIMUM,
+        SNAP_MAXIMUM,
+    };
+
+    int getMarkerSnap(void) const { return markerSnap; }
+    void setMarkerSnap(int snap) { markerSnap = snap; }
+
+    //! Markers placed on a curve are snapped to a feature within this distance (pixels)
+    static const int MARKER_SNAP_PIXELS = 10;
+    void setDownsampleMode(int mode);
+
+    //! Draw a coarse pass of every curve before refining (see PlotCurveUpdater::processRequests)
+    bool isProgressive(void) const { return progressive; }
+    void setProgressive(bool enable);
+
+    //! Overlay the performance figures of the plot (see PlotPerformanceMonitor) on the canvas
+    bool isPerformanceHudEnabled(void) const { return performanceHud; }
+    void setPerformanceHudEnabled(bool enable);
+
+    //! Curves, view and options of the plot, as stored in a workspace (see WorkspaceFile)
+    WorkspaceFile::PlotState getWorkspaceState(void);
+    void restoreWorkspaceState(const WorkspaceFile::PlotState &state);
+
 signals:
     // Emitted whenever the view rect is changed
     void viewChanged(const QwtInterval &view);
@@ -44,7 +121,7 @@ signals:
     // Emitted whenever the timestamp limits are changed
     void timestampLimitsChanged(const QwtInterval &limits);
 
-    void fileDropped(QString filename);
+    void filesDropped(QStringList filenames);
 
     void cursorPositionChanged(double &t, double &y1, double &y2);
 
@@ -52,6 +129,10 @@ signals:
     void markersRemoved();
 
 public slots:
+    virtual void replot(void) override;
+    void invalidateDataBounds(void);
+    void replotNow(void);
+    void scheduleReplot(void);
     int getHorizontalPixels(void) const;
 
     bool addSeries(DataSeriesPointer series, int axis_id = QwtPlot::yLeft);
@@ -65,6 +146,14 @@ public slots:
     void addMarker(double timestamp, QSharedPointer<PlotCurve> curve = nullptr);
     void removeAllMarkers();
 
+    void addEventLayer(EventStorePointer events, const QColor &color = Qt::darkMagenta);
+    void removeAllEventLayers();
+
+    void findEvents(void);
+    void setEventIndex(EventIndexPointer index, DataSeriesPointer series = DataSeriesPointer());
+    bool jumpToEvent(bool forward = true);
+    void showEventStatistics(void);
+
     void autoScale(int axis_id = yBoth);
     void autoScale(int axis_id, QwtInterval interval);
     void autoScale(QSharedPointer<PlotCurve> curve);
@@ -82,7 +171,10 @@ public slots:
 
     void selectBackgroundColor();
 
-    void exportDataToFile();
+    void exportDataToFile(const ExportScope &scope = ExportScope());
+    void exportVisibleData(ExportScope::Mode mode);
+
+    void viewDataAtTimestamp(double timestamp);
 
     void saveImageToClipboard();
     void saveImageToFile();
@@ -95,6 +187,12 @@ protected slots:
 
     void editAxisScale(QwtPlot::Axis axisId);
 
+    void updateFollow(void);
+
+    void onSeriesChanged(double t_min, double t_max);
+    void scheduleDataUpdate(void);
+    void updateData(void);
+
 protected:
 
     virtual bool eventFilter(QObject *target, QEvent *event) override;
@@ -113,6 +211,9 @@ protected:
 
     void handleMiddleMouseDrag(QMouseEvent *event);
 
+    virtual void drawCanvas(QPainter *painter) override;
+    void drawPerformanceHud(QPainter *painter);
+
     void initZoomer(void);
     void initPanner(void);
     void initLegend(void);
@@ -128,6 +229,8 @@ protected:
     void updateCurrentView();
     void updateTimestampLimits();
 
+    void updateHoverLookup(void);
+
     // Curve tracking
     virtual bool isCurveTrackingEnabled(void) const { return true; }
     bool isCurveTracked(void);
@@ -152,8 +255,22 @@ protected:
     // List of markers attached to this widget
     QList<PlotMarker*> markers;
 
+    // Layers of events drawn on this widget
+    QList<PlotMarkerLayer*> eventLayers;
+
+    // Intervals which the event navigation steps between (see jumpToEvent), and the series they were found in
+    EventIndexPointer eventIndex;
+    DataSeriesPointer eventSeries;
+
     QSharedPointer<PlotCurve> tracking_curve;
 
+    // Values of the visible curves at the mouse cursor
+    HoverLookup hoverLookup;
+
+    // View for which the hover lookup was last configured
+    QwtInterval hoverInterval;
+    int hoverPixels = 0;
+
     // Specify "both" y axes
     static const int yBoth = -1;
 
@@ -165,6 +282,33 @@ protected:
 
     // Is this graph synced to the global timescale?
     bool syncedTimescale = true;
+
+    // Down-sampling algorithm for attached curves
+    int downsampleMode = PlotCurveUpdater::DOWNSAMPLE_M4;
+
+    int markerSnap = SNAP_NONE;
+
+    // Does the time axis follow the newest data?
+    bool followNewest = false;
+    double followTimestamp = 0;
+
+    QTimer followTimer;
+
+    // Coalesces changes to the series of every curve (see scheduleDataUpdate)
+    QTimer dataTimer;
+
+    // Curves with visible changes, which are resampled by the next data update (see onSeriesChanged)
+    QSet<const PlotCurve*> changedCurves;
+
+    // Progressive resampling, when the view is changed
+    bool progressive = true;
+
+    // Performance overlay
+    bool performanceHud = false;
+    PlotPerformanceMonitor performance;
+
+    // Combined bounds of the visible curves (see getDataBounds)
+    mutable DataBounds dataBounds;
 };
 
 #endif // PLOT_WIDGET_HPP
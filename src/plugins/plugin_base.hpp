@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QString>
 
+#include "cancellation_token.hpp"
+
 /**
  * @brief The PluginBase class forms the basis of any Lumberjack plugin
  */
@@ -24,6 +26,15 @@ public:
 
     // Return the IID string associated with this plugin
     virtual QString pluginIID(void) const = 0;
+
+    // The token of the running job (e.g. an import), which is set when the job is cancelled
+    void setCancellationToken(CancellationTokenPointer token) { m_cancellation = token; }
+
+    // Return true if the running job has been cancelled (cheap enough to check in any loop)
+    bool isCancelled(void) const { return m_cancellation && m_cancellation->isCancelled(); }
+
+protected:
+    CancellationTokenPointer m_cancellation;
 };
 
 typedef QList<QSharedPointer<PluginBase>> PluginList;
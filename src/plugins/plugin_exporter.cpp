@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <cmath>
+
 #include "plugin_exporter.hpp"
 
 
+const uint64_t ExportPlugin::MAX_RESAMPLE_POINTS;
+
+
 bool ExportPlugin::supportsFileType(QString fileType) const
 {
     fileType = fileType.replace(".", "").toLower();
@@ -38,3 +44,173 @@ QString ExportPlugin::fileFilter(void) const
 
     return filter;
 }
+
+
+/**
+ * @brief ExportPlugin::getScopedView - Select the samples of a series to export, according to the export scope.
+ * Every sample (within the time range, if selected) is exported through a view of the series, so no samples are copied.
+ * Resampled or decimated samples are generated into a temporary series (which holds only the output samples).
+ * @param series - The series to export
+ * @return a view of the samples to export
+ */
+DataView ExportPlugin::getScopedView(const DataSeriesPointer &series) const
+{
+    if (series.isNull()) return DataView();
+
+    const DataSnapshot snapshot = series->getSnapshot();
+
+    uint64_t idx_first = 0;
+    uint64_t idx_last = snapshot.size();
+
+    if (m_scope.rangeOnly)
+    {
+        idx_first = snapshot.lowerBound(m_scope.tMin);
+        idx_last = snapshot.upperBound(m_scope.tMax);
+    }
+
+    switch (m_scope.mode)
+    {
+    case ExportScope::SCOPE_RESAMPLE:
+        return resampleView(snapshot, idx_first, idx_last);
+    case ExportScope::SCOPE_DECIMATE:
+        return decimateView(snapshot, idx_first, idx_last);
+    default:
+        return snapshot.getView(idx_first, idx_last);
+    }
+}
+
+
+/**
+ * @brief ExportPlugin::resampleView - Resample the samples in the range [idx_first, idx_last) at the rate of the export scope.
+ * The grid is aligned to multiples of the sample period, and lies between the first and last samples (values are not extrapolated).
+ */
+DataView ExportPlugin::resampleView(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last) const
+{
+    if (idx_first >= idx_last || !(m_scope.rate > 0))
+    {
+        return snapshot.getView(idx_first, idx_last);
+    }
+
+    const double dt = 1.0 / m_scope.rate;
+
+    const double t0 = std::ceil(snapshot.getTimestamp(idx_first) * m_scope.rate) * dt;
+    const double t1 = snapshot.getTimestamp(idx_last - 1);
+
+    const uint64_t n = t0 > t1 ? 0 : std::min<uint64_t>((uint64_t) ((t1 - t0) * m_scope.rate) + 1, MAX_RESAMPLE_POINTS);
+
+    DataSeries resampled;
+
+    DataCursor cursor(snapshot);
+
+    const uint64_t CHUNK = 1 << 16;
+
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    for (uint64_t ii = 0; ii < n; ii += CHUNK)
+    {
+        const size_t length = (size_t) std::min(CHUNK, n - ii);
+
+        const double t = t0 + ii * dt;
+
+        timestamps.resize(length);
+        values.resize(length);
+
+        for (size_t jj = 0; jj < length; jj++)
+        {
+            timestamps[jj] = t + jj * dt;
+        }
+
+        cursor.resample(t, dt, length, values.data());
+
+        resampled.addData(timestamps, values, false);
+    }
+
+    // The view holds the samples after the temporary series is destroyed
+    return resampled.getSnapshot().getView();
+}
+
+
+/**
+ * @brief ExportPlugin::decimateView - Decimate the samples in the range [idx_first, idx_last) to the number of points of the export scope.
+ * The range is divided into intervals of equal sample count, and the first, minimum, maximum and last samples of each
+ * interval are kept (in timestamp order), so the envelope of the data is preserved. The extremes of each interval are
+ * found from the summary pyramid of the series, rather than by visiting every sample.
+ */
+DataView ExportPlugin::decimateView(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last) const
+{
+    const uint64_t count = idx_last > idx_first ? idx_last - idx_first : 0;
+
+    // Each interval contributes (up to) four points
+    const uint64_t intervals = m_scope.points / 4;
+
+    if (intervals == 0 || count <= m_scope.points)
+    {
+        return snapshot.getView(idx_first, idx_last);
+    }
+
+    DataSeries decimated;
+
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    for (uint64_t ii = 0; ii < intervals; ii++)
+    {
+        const uint64_t a = idx_first + count * ii / intervals;
+        const uint64_t b = idx_first + count * (ii + 1) / intervals;
+
+        // The coarsest summary level whose buckets fit within the interval
+        int level = -1;
+
+        for (unsigned int lvl = 0; lvl < DataBlock::SUMMARY_LEVELS; lvl++)
+        {
+            if (DataBlock::getSummaryBucketSize(lvl) <= b - a) level = (int) lvl;
+        }
+
+        DataPoint points[4];
+        bool found = false;
+
+        snapshot.visitBuckets(a, b, level, [&](const DataSnapshot::Bucket &bucket) {
+            if (!found)
+            {
+                points[0] = bucket.first;
+                points[1] = bucket.min;
+                points[2] = bucket.max;
+                found = true;
+            }
+            else
+            {
+                if (bucket.min.value < points[1].value) points[1] = bucket.min;
+                if (bucket.max.value > points[2].value) points[2] = bucket.max;
+            }
+
+            points[3] = bucket.last;
+        });
+
+        if (!found) continue;
+
+        std::stable_sort(points, points + 4, [](const DataPoint &p, const DataPoint &q) {
+            return p.timestamp < q.timestamp;
+        });
+
+        for (int jj = 0; jj < 4; jj++)
+        {
+            // The same sample may be (for example) both the first and the minimum
+            if (jj > 0 && points[jj].timestamp == points[jj - 1].timestamp && points[jj].value == points[jj - 1].value) continue;
+
+            timestamps.push_back(points[jj].timestamp);
+            values.push_back(points[jj].value);
+        }
+
+        if (timestamps.size() >= (1 << 16))
+        {
+            decimated.addData(timestamps, values, false);
+            timestamps.clear();
+            values.clear();
+        }
+    }
+
+    decimated.addData(timestamps, values, false);
+
+    return decimated.getSnapshot().getView();
+}
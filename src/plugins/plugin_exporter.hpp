@@ -8,6 +8,34 @@
 
 #define ExporterInterface_iid "org.lumberjack.plugins.ExportPlugin/1.0"
 
+
+/**
+ * @brief The ExportScope struct selects the samples of each series which are exported
+ */
+struct ExportScope
+{
+    enum Mode
+    {
+        SCOPE_ALL = 0,      // Every sample
+        SCOPE_RESAMPLE,     // Uniformly resampled (linear interpolation) at the specified rate
+        SCOPE_DECIMATE,     // Decimated to (at most) the specified number of points, keeping the extremes of each interval
+    };
+
+    Mode mode = SCOPE_ALL;
+
+    //! Only samples within the time range [tMin, tMax] are exported
+    bool rangeOnly = false;
+    double tMin = 0;
+    double tMax = 0;
+
+    //! Sample rate (Hz), for SCOPE_RESAMPLE
+    double rate = 0;
+
+    //! Number of points of each series, for SCOPE_DECIMATE
+    uint64_t points = 0;
+};
+
+
 /**
  * @brief The ExportPlugin class defines an interface for exporting data
  */
@@ -48,9 +76,23 @@ public:
     void setFilename(QString filename) { m_filename = filename; }
     QString getFilename(void) const { return m_filename; }
 
+    void setScope(const ExportScope &scope) { m_scope = scope; }
+    const ExportScope& getScope(void) const { return m_scope; }
+
+    //! Maximum number of samples which are generated (for each series) when resampling
+    static const uint64_t MAX_RESAMPLE_POINTS = 100000000;
+
 protected:
     // Stored filename, destination of exported data
     QString m_filename;
+
+    // Samples to export
+    ExportScope m_scope;
+
+    DataView getScopedView(const DataSeriesPointer &series) const;
+
+    DataView resampleView(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last) const;
+    DataView decimateView(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last) const;
 };
 
 typedef QList<QSharedPointer<ExportPlugin>> ExportPluginList;
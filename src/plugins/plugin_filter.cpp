@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstring>
+
+#include "parallel_for.hpp"
+
+#include "plugin_filter.hpp"
+
+
+/*
+ * The filtered samples of one chunk (which are appended to the output series in order)
+ */
+struct FilteredChunk
+{
+    std::vector<double> timestamps;
+    std::vector<double> values;
+};
+
+
+/**
+ * @brief FilterPlugin::filterData - Filter a range of samples, appending the filtered samples to the output series.
+ *
+ * The samples are divided into chunks of (at most) DataBlock::CAPACITY samples, each of which is contiguous
+ * in memory, so a filter is called once per chunk. The chunks of a stateless filter are filtered concurrently,
+ * a few chunks per thread at a time (which bounds the memory used for the filtered samples), and the chunks of a
+ * stateful filter are filtered in order, on the calling thread.
+ *
+ * @param samples - The samples to filter
+ * @param output - Series which the filtered samples are appended to (with the same timestamps as the input samples)
+ * @param pool - Thread pool used to filter the chunks of a stateless filter
+ * @return false if the samples could not be filtered (or the filter was cancelled)
+ */
+bool FilterPlugin::filterData(const DataView &samples, DataSeries &output, QThreadPool *pool)
+{
+    m_error.clear();
+
+    if (samples.isEmpty()) return true;
+
+    if (!beginFilter(samples))
+    {
+        if (m_error.isEmpty()) m_error = tr("Samples could not be filtered");
+        return false;
+    }
+
+    const DataSnapshot &snapshot = samples.getSnapshot();
+
+    const uint64_t count = samples.size();
+    const uint64_t chunkSize = DataBlock::CAPACITY;
+    const size_t chunkCount = (size_t) ((count + chunkSize - 1) / chunkSize);
+
+    // Values which are already stored in double precision (and not scaled) are passed to the filter directly
+    const bool unscaled = snapshot.getScaler() == 1.0 && snapshot.getOffset() == 0.0;
+
+    const bool stateless = isStateless();
+    const size_t threads = stateless && pool ? std::max(1, pool->maxThreadCount()) : 1;
+
+    std::vector<FilteredChunk> chunks(std::min(chunkCount, threads * 2));
+
+    auto filterOne = [&](size_t chunkIndex, FilteredChunk &chunk)
+    {
+        const uint64_t a = chunkIndex * chunkSize;
+        const uint64_t b = std::min(count, a + chunkSize);
+
+        chunk.timestamps.resize(b - a);
+        chunk.values.resize(b - a);
+
+        const DataView view(snapshot, samples.getFirstIndex() + a, samples.getFirstIndex() + b);
+
+        view.visitSegments([&](const DataView::Segment &segment)
+        {
+            double *timestamps = chunk.timestamps.data() + segment.index;
+            double *values = chunk.values.data() + segment.index;
+
+            memcpy(timestamps, segment.timestamps, segment.length * sizeof(double));
+
+            FilterChunk span;
+
+            span.index = a + segment.index;
+            span.length = segment.length;
+            span.count = count;
+            span.timestamps = timestamps;
+            span.output = values;
+
+            if (unscaled && segment.values)
+            {
+                span.input = segment.values;
+            }
+            else
+            {
+                // Convert (and scale) the values in the output buffer, which is then filtered in place
+                for (size_t ii = 0; ii < segment.length; ii++)
+                {
+                    values[ii] = segment.getValue(ii);
+                }
+
+                snapshot.applyScaling(values, segment.length);
+
+                span.input = values;
+            }
+
+            filterChunk(span);
+        });
+    };
+
+    bool result = true;
+
+    for (size_t first = 0; first < chunkCount; first += chunks.size())
+    {
+        if (isCancelled())
+        {
+            m_error = tr("Filter was cancelled");
+            result = false;
+            break;
+        }
+
+        const size_t n = std::min(chunks.size(), chunkCount - first);
+
+        if (stateless && n > 1)
+        {
+            parallelFor(n, [&](size_t idx) { filterOne(first + idx, chunks[idx]); }, pool);
+        }
+        else
+        {
+            for (size_t idx = 0; idx < n; idx++)
+            {
+                filterOne(first + idx, chunks[idx]);
+            }
+        }
+
+        for (size_t idx = 0; idx < n; idx++)
+        {
+            const FilteredChunk &chunk = chunks[idx];
+
+            output.addData(chunk.timestamps.data(), chunk.values.data(), chunk.values.size(), first + idx + 1 == chunkCount);
+        }
+    }
+
+    endFilter();
+
+    return result;
+}
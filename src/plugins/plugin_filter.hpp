@@ -1,16 +1,56 @@
 #ifndef PLUGIN_FILTER_HPP
 #define PLUGIN_FILTER_HPP
 
+#include <stdint.h>
+
+#include <QThreadPool>
 #include <QtPlugin>
 
+#include "data_series.hpp"
 #include "plugin_base.hpp"
 
 #define FilterInterface_iid "org.lumberjack.plugins.FilterPlugin/1.0"
 
 
+/**
+ * @brief The FilterChunk struct is a contiguous span of samples, which is passed to a filter.
+ *
+ * The input values have the scaler and offset of the series applied.
+ * The output buffer is preallocated (with space for length values), and may be the same
+ * buffer as the input (so a filter must support processing a chunk in place).
+ */
+struct FilterChunk
+{
+    //! Index (within the filtered samples) of the first sample of the chunk
+    uint64_t index = 0;
+
+    //! Number of samples in the chunk
+    size_t length = 0;
+
+    //! Total number of samples being filtered
+    uint64_t count = 0;
+
+    //! Sample timestamps (seconds)
+    const double *timestamps = nullptr;
+
+    //! Input values
+    const double *input = nullptr;
+
+    //! Output values (one per input sample)
+    double *output = nullptr;
+
+    bool isFirst(void) const { return index == 0; }
+    bool isLast(void) const { return index + length >= count; }
+};
+
 
 /**
- * @brief The FilterPlugin class defines an interface for applying custom data filters
+ * @brief The FilterPlugin class defines an interface for applying custom data filters.
+ *
+ * Filters operate on chunks of samples (see FilterChunk), rather than on single samples,
+ * so the cost of the (virtual) call is spread over thousands of samples. A filter declares
+ * whether it is stateless: the chunks of a stateless filter are processed concurrently (and in any order),
+ * whereas the chunks of a stateful filter (e.g. a recursive filter) are processed in order, by one thread.
  */
 class FilterPlugin : public PluginBase
 {
@@ -24,8 +64,30 @@ public:
         return QString(FilterInterface_iid);
     }
 
+    // Return true if each chunk can be filtered independently of any other chunk
+    virtual bool isStateless(void) const = 0;
+
+    // Return true (and the coefficients) if the filter is an affine function of each value: output = input * scaler + offset.
+    // Adjacent affine filters in a FilterChain are fused into a single multiply-add
+    virtual bool getAffine(double &scaler, double &offset) const { Q_UNUSED(scaler); Q_UNUSED(offset); return false; }
+
+    // Called before the first chunk of the samples is filtered (e.g. to reset the state of the filter)
+    // Return false if the samples cannot be filtered
+    virtual bool beginFilter(const DataView &samples) { Q_UNUSED(samples); return true; }
+
+    // Filter a chunk of samples, writing an output value for every input value.
+    // For a stateless filter, this is called concurrently (so it must not modify the filter)
+    virtual void filterChunk(const FilterChunk &chunk) = 0;
+
+    // Called once every chunk has been filtered (or the filter was cancelled)
+    virtual void endFilter(void) {}
+
+    bool filterData(const DataView &samples, DataSeries &output, QThreadPool *pool = QThreadPool::globalInstance());
+
+    QString errorString(void) const { return m_error; }
 
-    // TODO
+protected:
+    QString m_error;
 };
 
 typedef QList<QSharedPointer<FilterPlugin>> FilterPluginList;
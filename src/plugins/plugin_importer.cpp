@@ -1,6 +1,7 @@
 #include <QFileInfo>
 
 #include "plugin_importer.hpp"
+#include "decompression_device.hpp"
 
 /**
  * @brief PluginImporter::supportsFileType - Determine if a particular file type is supported
@@ -23,6 +24,24 @@ bool ImportPlugin::supportsFileType(QString fileType) const
 }
 
 
+/**
+ * @brief ImportPlugin::supportsFile - Determine if a particular file is supported (by its suffix)
+ * @param filename - e.g. 'log.csv', or 'log.csv.gz' if compressed files are supported
+ * @return
+ */
+bool ImportPlugin::supportsFile(QString filename) const
+{
+    if (DecompressionDevice::getFormat(filename) != DecompressionDevice::FORMAT_NONE)
+    {
+        if (!supportsCompressedFiles()) return false;
+
+        filename = DecompressionDevice::getUncompressedName(filename);
+    }
+
+    return supportsFileType(QFileInfo(filename).suffix());
+}
+
+
 /**
  * @brief ImportPlugin::fileFilter constructs a file filter string for importing files
  * @return
@@ -41,6 +60,14 @@ QString ImportPlugin::fileFilter(void) const
         ft.prepend("*");
 
         fileFilters.append(ft);
+
+        if (supportsCompressedFiles())
+        {
+            for (const QString &suffix : DecompressionDevice::getSupportedSuffixes())
+            {
+                fileFilters.append(ft + "." + suffix);
+            }
+        }
     }
 
     filter += fileFilters.join(" ");
@@ -80,3 +107,25 @@ bool ImportPlugin::validateFile(QString filename, QStringList &errors) const
 
     return errors.count() == 0;
 }
+
+
+/**
+ * @brief ImportSink::pushColumns - Append a batch of rows to several channels, which share a column of timestamps.
+ * The default implementation pushes each column separately
+ * @param channels - Index of the channel of each column
+ * @param timestamps - Timestamp of each row
+ * @param values - Each column of values (one per channel)
+ * @param count - Number of rows
+ * @return false if any column could not be pushed
+ */
+bool ImportSink::pushColumns(const QVector<int> &channels, const double *timestamps, const double *const *values, size_t count)
+{
+    bool result = true;
+
+    for (int idx = 0; idx < channels.count(); idx++)
+    {
+        result &= pushSamples(channels[idx], timestamps, values[idx], count);
+    }
+
+    return result;
+}
@@ -10,6 +10,35 @@
 #define ImporterInterface_iid "org.lumberjack.plugins.ImportPlugin/1.0"
 
 
+/**
+ * @brief The ImportSink class receives the samples of an import as they are read (see ImportPlugin::setImportSink).
+ *
+ * The importer declares a channel for each series in the file, and pushes batches of samples into the sink.
+ * The host decides how the samples are stored (e.g. compressed, or memory-mapped), and displays each channel
+ * as soon as it is declared, so an importer does not need to build (or buffer) any DataSeries of its own.
+ *
+ * Every function may be called from any thread (e.g. from the tasks of a parallel import).
+ */
+class ImportSink
+{
+public:
+    virtual ~ImportSink() = default;
+
+    // Declare a channel (e.g. a column of the file), returning its index (or -1 if it could not be declared)
+    virtual int declareChannel(const QString &label, const QString &group = QString(), const QString &units = QString()) = 0;
+
+    // Return the number of channels which have been declared
+    virtual int getChannelCount(void) const = 0;
+
+    // Append a batch of samples to a channel. Batches should be pushed in timestamp order
+    // (samples which are out of order are accepted, but are more expensive to store)
+    virtual bool pushSamples(int channel, const double *timestamps, const double *values, size_t count) = 0;
+
+    // Append a batch of rows to several channels, which share a column of timestamps
+    virtual bool pushColumns(const QVector<int> &channels, const double *timestamps, const double *const *values, size_t count);
+};
+
+
 /**
  * @brief The ImportPlugin class defines an interface for importing data
  */
@@ -31,6 +60,11 @@ public:
     // Return False to cancel the data import process
     virtual bool beforeImport() { return true; }
 
+    // Optional: use the import options of another instance of this importer (which has completed beforeImport)
+    // instead of calling beforeImport, e.g. when several files are imported together
+    // Return False if the options do not apply to this file (e.g. it has a different layout)
+    virtual bool reuseImportOptions(const ImportPlugin &other) { Q_UNUSED(other); return false; }
+
     // Load data from the provided filename
     virtual bool importData(QStringList &errors) = 0;
 
@@ -44,8 +78,33 @@ public:
     virtual uint8_t getImportProgress(void) const = 0;
 
     // After import, plugin must return a list of DataSeries objects
+    // Note: This is also called (from another thread) while the import is running, so that series are
+    //       displayed as soon as they are created, and their samples as they are added (see DataSeries)
     virtual QList<DataSeriesPointer> getDataSeries(void) const = 0;
 
+    // Optional: create a new instance of this importer, so that each import has its own state
+    // (otherwise the registered instance is used, and only imports one file at a time)
+    virtual QSharedPointer<ImportPlugin> createInstance(void) const { return QSharedPointer<ImportPlugin>(); }
+
+    // Optional: return true if the file should be followed after import (called after beforeImport)
+    // Data which are appended to the file are then imported by importAppendedData
+    virtual bool isFollowEnabled(void) const { return false; }
+
+    // Optional: import any data appended to the file since the previous import, adding samples to the existing series
+    // Return False if the file can no longer be followed (e.g. it has been truncated)
+    virtual bool importAppendedData(QStringList &errors) { Q_UNUSED(errors); return false; }
+
+    // Optional: return true if the importer pushes its samples into an ImportSink, when one is set (see setImportSink)
+    // The series of the import are then provided by the sink, and getDataSeries may return an empty list
+    virtual bool supportsImportSink(void) const { return false; }
+
+    // Optional: return true if compressed files (e.g. log.csv.gz) can be imported (see DecompressionDevice)
+    virtual bool supportsCompressedFiles(void) const { return false; }
+
+    // Optional description of the options used for import (called after beforeImport)
+    // Imported series are cached (see ImportCache), and the cache is only used if the options match
+    virtual QByteArray getOptionsKey(void) const { return QByteArray(); }
+
     // Return the IID string
     virtual QString pluginIID(void) const override
     {
@@ -55,13 +114,21 @@ public:
     QString fileFilter(void) const;
 
     bool supportsFileType(QString fileType) const;
+    bool supportsFile(QString filename) const;
 
     void setFilename(QString filename) { m_filename = filename; }
     QString getFilename(void) const { return m_filename; }
 
+    // The sink is set by the host before importData (if supportsImportSink), and remains valid until afterImport
+    void setImportSink(ImportSink *sink) { m_sink = sink; }
+    ImportSink* getImportSink(void) const { return m_sink; }
+
 protected:
     // Stored filename, source of imported data
     QString m_filename;
+
+    // Destination of imported samples (nullptr if the importer provides its own series)
+    ImportSink *m_sink = nullptr;
 };
 
 typedef QList<QSharedPointer<ImportPlugin>> ImportPluginList;
@@ -0,0 +1,504 @@
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "plugin_library.hpp"
+
+
+//! Incremented whenever the format of the metadata cache changes
+static const int PLUGIN_CACHE_VERSION = 1;
+
+
+/**
+ * @brief PluginMetadata::matchesFile - Return true if the library file is unchanged since the metadata were read
+ */
+bool PluginMetadata::matchesFile() const
+{
+    QFileInfo info(path);
+
+    return info.exists() && info.size() == size && info.lastModified().toMSecsSinceEpoch() == modified;
+}
+
+
+QJsonObject PluginMetadata::toJson() const
+{
+    QJsonObject json;
+
+    json["path"] = path;
+    json["size"] = size;
+    json["modified"] = modified;
+    json["iid"] = iid;
+    json["name"] = name;
+    json["description"] = description;
+    json["version"] = version;
+    json["fileTypes"] = QJsonArray::fromStringList(fileTypes);
+    json["compressed"] = compressed;
+
+    return json;
+}
+
+
+PluginMetadata PluginMetadata::fromJson(const QJsonObject &json)
+{
+    PluginMetadata metadata;
+
+    metadata.path = json["path"].toString();
+    metadata.size = (qint64) json["size"].toDouble();
+    metadata.modified = (qint64) json["modified"].toDouble();
+    metadata.iid = json["iid"].toString();
+    metadata.name = json["name"].toString();
+    metadata.description = json["description"].toString();
+    metadata.version = json["version"].toString();
+    metadata.compressed = json["compressed"].toBool();
+
+    for (const auto &fileType : json["fileTypes"].toArray())
+    {
+        metadata.fileTypes.append(fileType.toString());
+    }
+
+    return metadata;
+}
+
+
+/**
+ * @brief PluginMetadata::readCache - Read the cached metadata of plugin libraries, indexed by path
+ * @param filename - The cache file
+ * @return the cached metadata (empty if the cache does not exist, or has a different version)
+ */
+QHash<QString, PluginMetadata> PluginMetadata::readCache(const QString &filename)
+{
+    QHash<QString, PluginMetadata> metadata;
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) return metadata;
+
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+
+    if (json["version"].toInt() != PLUGIN_CACHE_VERSION) return metadata;
+
+    for (const auto &entry : json["plugins"].toArray())
+    {
+        PluginMetadata plugin = fromJson(entry.toObject());
+
+        if (!plugin.path.isEmpty())
+        {
+            metadata[plugin.path] = plugin;
+        }
+    }
+
+    return metadata;
+}
+
+
+bool PluginMetadata::writeCache(const QString &filename, const QHash<QString, PluginMetadata> &metadata)
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    QJsonArray plugins;
+
+    for (const auto &plugin : metadata)
+    {
+        plugins.append(plugin.toJson());
+    }
+
+    QJsonObject json;
+
+    json["version"] = PLUGIN_CACHE_VERSION;
+    json["plugins"] = plugins;
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    const QByteArray data = QJsonDocument(json).toJson(QJsonDocument::Compact);
+
+    return file.write(data) == data.size();
+}
+
+
+PluginLibrary::PluginLibrary(const PluginMetadata &metadata) : m_metadata(metadata)
+{
+    m_loader.setFileName(metadata.path);
+}
+
+
+/**
+ * @brief PluginLibrary::probe - Load the library, and read the metadata from the plugin.
+ * A library which is not a Lumberjack plugin is unloaded again (and its metadata are left empty, so
+ * the library is not loaded again until it changes). Must be called before the library is shared.
+ * @return true if the library provides a plugin
+ */
+bool PluginLibrary::probe()
+{
+    QFileInfo info(m_metadata.path);
+
+    PluginMetadata metadata;
+
+    metadata.path = m_metadata.path;
+    metadata.size = info.size();
+    metadata.modified = info.lastModified().toMSecsSinceEpoch();
+
+    QObject *object = instance();
+
+    PluginBase *plugin = qobject_cast<PluginBase*>(object);
+
+    ImportPlugin *importer = qobject_cast<ImportPlugin*>(object);
+    ExportPlugin *exporter = qobject_cast<ExportPlugin*>(object);
+    FilterPlugin *filter = qobject_cast<FilterPlugin*>(object);
+
+    if (plugin && (importer || exporter || filter))
+    {
+        metadata.iid = plugin->pluginIID();
+        metadata.name = plugin->pluginName();
+        metadata.description = plugin->pluginDescription();
+        metadata.version = plugin->pluginVersion();
+
+        if (importer)
+        {
+            metadata.fileTypes = importer->supportedFileTypes();
+            metadata.compressed = importer->supportsCompressedFiles();
+        }
+        else if (exporter)
+        {
+            metadata.fileTypes = exporter->supportedFileTypes();
+        }
+    }
+    else if (object)
+    {
+        // Not a Lumberjack plugin (e.g. a Qt plugin)
+        m_loader.unload();
+        m_instance.store(nullptr);
+    }
+
+    m_metadata = metadata;
+
+    return m_metadata.isValid();
+}
+
+
+/**
+ * @brief PluginLibrary::instance - Return the plugin instance, loading the library if it has not been loaded
+ * @return the root component of the plugin (nullptr if the library could not be loaded)
+ */
+QObject* PluginLibrary::instance()
+{
+    QObject *object = m_instance.load(std::memory_order_acquire);
+
+    if (object) return object;
+
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_attempted)
+    {
+        m_attempted = true;
+
+        object = m_loader.instance();
+
+        if (object)
+        {
+            // The plugin belongs to the main thread, wherever it was first used
+            if (QCoreApplication::instance())
+            {
+                object->moveToThread(QCoreApplication::instance()->thread());
+            }
+
+            m_instance.store(object, std::memory_order_release);
+        }
+        else
+        {
+            qWarning() << "Could not load plugin" << m_metadata.path << "-" << m_loader.errorString();
+        }
+    }
+
+    return m_instance.load(std::memory_order_acquire);
+}
+
+
+ImportPlugin* LazyImportPlugin::target() const
+{
+    return qobject_cast<ImportPlugin*>(m_library->instance());
+}
+
+
+/*
+ * Load the plugin, and pass it the state which has been set on this object (filename, sink, cancellation token)
+ */
+ImportPlugin* LazyImportPlugin::prepare()
+{
+    ImportPlugin *plugin = target();
+
+    if (plugin)
+    {
+        plugin->setFilename(m_filename);
+        plugin->setImportSink(m_sink);
+        plugin->setCancellationToken(m_cancellation);
+    }
+
+    return plugin;
+}
+
+
+bool LazyImportPlugin::validateFile(QString filename, QStringList &errors) const
+{
+    ImportPlugin *plugin = target();
+
+    if (!plugin)
+    {
+        errors.append(tr("Plugin could not be loaded: %1").arg(m_library->getMetadata().path));
+        return false;
+    }
+
+    return plugin->validateFile(filename, errors);
+}
+
+
+bool LazyImportPlugin::beforeImport()
+{
+    ImportPlugin *plugin = prepare();
+
+    return plugin && plugin->beforeImport();
+}
+
+
+bool LazyImportPlugin::reuseImportOptions(const ImportPlugin &other)
+{
+    ImportPlugin *plugin = prepare();
+
+    // The options belong to the plugin which the other importer stands in for
+    const LazyImportPlugin *lazy = dynamic_cast<const LazyImportPlugin*>(&other);
+    const ImportPlugin *source = lazy ? lazy->target() : &other;
+
+    return plugin && source && plugin->reuseImportOptions(*source);
+}
+
+
+bool LazyImportPlugin::importData(QStringList &errors)
+{
+    ImportPlugin *plugin = prepare();
+
+    if (!plugin)
+    {
+        errors.append(tr("Plugin could not be loaded: %1").arg(m_library->getMetadata().path));
+        return false;
+    }
+
+    return plugin->importData(errors);
+}
+
+
+void LazyImportPlugin::afterImport()
+{
+    ImportPlugin *plugin = prepare();
+
+    if (plugin) plugin->afterImport();
+}
+
+
+void LazyImportPlugin::cancelImport()
+{
+    ImportPlugin *plugin = target();
+
+    if (plugin) plugin->cancelImport();
+}
+
+
+uint8_t LazyImportPlugin::getImportProgress() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin ? plugin->getImportProgress() : 0;
+}
+
+
+QList<DataSeriesPointer> LazyImportPlugin::getDataSeries() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin ? plugin->getDataSeries() : QList<DataSeriesPointer>();
+}
+
+
+QSharedPointer<ImportPlugin> LazyImportPlugin::createInstance() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin ? plugin->createInstance() : QSharedPointer<ImportPlugin>();
+}
+
+
+bool LazyImportPlugin::isFollowEnabled() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin && plugin->isFollowEnabled();
+}
+
+
+bool LazyImportPlugin::importAppendedData(QStringList &errors)
+{
+    ImportPlugin *plugin = prepare();
+
+    return plugin && plugin->importAppendedData(errors);
+}
+
+
+bool LazyImportPlugin::supportsImportSink() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin && plugin->supportsImportSink();
+}
+
+
+QByteArray LazyImportPlugin::getOptionsKey() const
+{
+    ImportPlugin *plugin = target();
+
+    return plugin ? plugin->getOptionsKey() : QByteArray();
+}
+
+
+ExportPlugin* LazyExportPlugin::target() const
+{
+    return qobject_cast<ExportPlugin*>(m_library->instance());
+}
+
+
+/*
+ * Load the plugin, and pass it the state which has been set on this object (filename, scope, cancellation token)
+ */
+ExportPlugin* LazyExportPlugin::prepare()
+{
+    ExportPlugin *plugin = target();
+
+    if (plugin)
+    {
+        plugin->setFilename(m_filename);
+        plugin->setScope(m_scope);
+        plugin->setCancellationToken(m_cancellation);
+    }
+
+    return plugin;
+}
+
+
+bool LazyExportPlugin::beforeExport()
+{
+    ExportPlugin *plugin = prepare();
+
+    return plugin && plugin->beforeExport();
+}
+
+
+bool LazyExportPlugin::exportData(QList<DataSeriesPointer> &series, QStringList &errors)
+{
+    ExportPlugin *plugin = prepare();
+
+    if (!plugin)
+    {
+        errors.append(tr("Plugin could not be loaded: %1").arg(m_library->getMetadata().path));
+        return false;
+    }
+
+    return plugin->exportData(series, errors);
+}
+
+
+void LazyExportPlugin::afterExport()
+{
+    ExportPlugin *plugin = prepare();
+
+    if (plugin) plugin->afterExport();
+}
+
+
+void LazyExportPlugin::cancelExport()
+{
+    ExportPlugin *plugin = target();
+
+    if (plugin) plugin->cancelExport();
+}
+
+
+uint8_t LazyExportPlugin::getExportProgress() const
+{
+    ExportPlugin *plugin = target();
+
+    return plugin ? plugin->getExportProgress() : 0;
+}
+
+
+FilterPlugin* LazyFilterPlugin::target() const
+{
+    FilterPlugin *plugin = m_target.load(std::memory_order_acquire);
+
+    if (!plugin)
+    {
+        plugin = qobject_cast<FilterPlugin*>(m_library->instance());
+        m_target.store(plugin, std::memory_order_release);
+    }
+
+    return plugin;
+}
+
+
+bool LazyFilterPlugin::isStateless() const
+{
+    FilterPlugin *plugin = target();
+
+    return plugin && plugin->isStateless();
+}
+
+
+bool LazyFilterPlugin::getAffine(double &scaler, double &offset) const
+{
+    FilterPlugin *plugin = target();
+
+    return plugin && plugin->getAffine(scaler, offset);
+}
+
+
+bool LazyFilterPlugin::beginFilter(const DataView &samples)
+{
+    FilterPlugin *plugin = target();
+
+    if (!plugin)
+    {
+        m_error = tr("Plugin could not be loaded: %1").arg(m_library->getMetadata().path);
+        return false;
+    }
+
+    plugin->setCancellationToken(m_cancellation);
+
+    return plugin->beginFilter(samples);
+}
+
+
+void LazyFilterPlugin::filterChunk(const FilterChunk &chunk)
+{
+    FilterPlugin *plugin = target();
+
+    if (plugin)
+    {
+        plugin->filterChunk(chunk);
+    }
+    else if (chunk.output != chunk.input)
+    {
+        std::copy(chunk.input, chunk.input + chunk.length, chunk.output);
+    }
+}
+
+
+void LazyFilterPlugin::endFilter()
+{
+    FilterPlugin *plugin = target();
+
+    if (plugin) plugin->endFilter();
+}
@@ -0,0 +1,190 @@
+#ifndef PLUGIN_LIBRARY_HPP
+#define PLUGIN_LIBRARY_HPP
+
+#include <atomic>
+#include <memory>
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPluginLoader>
+#include <QStringList>
+
+#include "plugin_filter.hpp"
+#include "plugin_importer.hpp"
+#include "plugin_exporter.hpp"
+
+
+/**
+ * @brief The PluginMetadata struct describes a plugin library, without the library being loaded.
+ * The metadata of each library are cached (see PluginRegistry::loadPlugins), and are only valid
+ * while the library file is unchanged (the same size and modification time).
+ */
+struct PluginMetadata
+{
+    QString path;
+
+    //! Library file size and modification time (msecs since epoch) when the metadata were read
+    qint64 size = 0;
+    qint64 modified = 0;
+
+    //! Plugin interface (empty if the library is not a Lumberjack plugin)
+    QString iid;
+
+    QString name;
+    QString description;
+    QString version;
+
+    //! File types supported by an importer or exporter
+    QStringList fileTypes;
+
+    //! The importer supports compressed files (see ImportPlugin::supportsCompressedFiles)
+    bool compressed = false;
+
+    bool isValid(void) const { return !iid.isEmpty(); }
+    bool matchesFile(void) const;
+
+    QJsonObject toJson(void) const;
+    static PluginMetadata fromJson(const QJsonObject &json);
+
+    static QHash<QString, PluginMetadata> readCache(const QString &filename);
+    static bool writeCache(const QString &filename, const QHash<QString, PluginMetadata> &metadata);
+};
+
+
+/**
+ * @brief The PluginLibrary class loads a plugin library on demand.
+ * The library is not loaded (and the plugin is not instantiated) until the plugin is first used,
+ * except to read its metadata when they are not cached (see probe).
+ */
+class PluginLibrary
+{
+public:
+    explicit PluginLibrary(const PluginMetadata &metadata);
+
+    const PluginMetadata& getMetadata(void) const { return m_metadata; }
+
+    //! Load the library, and read its metadata from the plugin
+    bool probe(void);
+
+    bool isLoaded(void) const { return m_instance.load() != nullptr; }
+
+    QObject* instance(void);
+
+protected:
+    PluginMetadata m_metadata;
+
+    QPluginLoader m_loader;
+
+    //! Serialises loading of the library
+    QMutex m_mutex;
+
+    //! The library has been loaded (or loading failed, in which case the instance is nullptr)
+    bool m_attempted = false;
+
+    std::atomic<QObject*> m_instance{nullptr};
+};
+
+typedef std::shared_ptr<PluginLibrary> PluginLibraryPointer;
+
+
+/**
+ * @brief The LazyImportPlugin class stands in for an importer plugin which has not been loaded.
+ * The name and file types are provided by the metadata, and any other call loads the plugin.
+ */
+class LazyImportPlugin : public ImportPlugin
+{
+public:
+    explicit LazyImportPlugin(PluginLibraryPointer library) : m_library(library) {}
+
+    virtual QString pluginName(void) const override { return m_library->getMetadata().name; }
+    virtual QString pluginDescription(void) const override { return m_library->getMetadata().description; }
+    virtual QString pluginVersion(void) const override { return m_library->getMetadata().version; }
+    virtual QString pluginIID(void) const override { return m_library->getMetadata().iid; }
+
+    virtual QStringList supportedFileTypes(void) const override { return m_library->getMetadata().fileTypes; }
+    virtual bool supportsCompressedFiles(void) const override { return m_library->getMetadata().compressed; }
+
+    virtual bool validateFile(QString filename, QStringList &errors) const override;
+    virtual bool beforeImport() override;
+    virtual bool reuseImportOptions(const ImportPlugin &other) override;
+    virtual bool importData(QStringList &errors) override;
+    virtual void afterImport(void) override;
+    virtual void cancelImport(void) override;
+    virtual uint8_t getImportProgress(void) const override;
+    virtual QList<DataSeriesPointer> getDataSeries(void) const override;
+    virtual QSharedPointer<ImportPlugin> createInstance(void) const override;
+    virtual bool isFollowEnabled(void) const override;
+    virtual bool importAppendedData(QStringList &errors) override;
+    virtual bool supportsImportSink(void) const override;
+    virtual QByteArray getOptionsKey(void) const override;
+
+    ImportPlugin* target(void) const;
+
+protected:
+    ImportPlugin* prepare(void);
+
+    PluginLibraryPointer m_library;
+};
+
+
+/**
+ * @brief The LazyExportPlugin class stands in for an exporter plugin which has not been loaded
+ */
+class LazyExportPlugin : public ExportPlugin
+{
+public:
+    explicit LazyExportPlugin(PluginLibraryPointer library) : m_library(library) {}
+
+    virtual QString pluginName(void) const override { return m_library->getMetadata().name; }
+    virtual QString pluginDescription(void) const override { return m_library->getMetadata().description; }
+    virtual QString pluginVersion(void) const override { return m_library->getMetadata().version; }
+    virtual QString pluginIID(void) const override { return m_library->getMetadata().iid; }
+
+    virtual QStringList supportedFileTypes(void) const override { return m_library->getMetadata().fileTypes; }
+
+    virtual bool beforeExport(void) override;
+    virtual bool exportData(QList<DataSeriesPointer> &series, QStringList &errors) override;
+    virtual void afterExport(void) override;
+    virtual void cancelExport(void) override;
+    virtual uint8_t getExportProgress(void) const override;
+
+    ExportPlugin* target(void) const;
+
+protected:
+    ExportPlugin* prepare(void);
+
+    PluginLibraryPointer m_library;
+};
+
+
+/**
+ * @brief The LazyFilterPlugin class stands in for a filter plugin which has not been loaded
+ */
+class LazyFilterPlugin : public FilterPlugin
+{
+public:
+    explicit LazyFilterPlugin(PluginLibraryPointer library) : m_library(library) {}
+
+    virtual QString pluginName(void) const override { return m_library->getMetadata().name; }
+    virtual QString pluginDescription(void) const override { return m_library->getMetadata().description; }
+    virtual QString pluginVersion(void) const override { return m_library->getMetadata().version; }
+    virtual QString pluginIID(void) const override { return m_library->getMetadata().iid; }
+
+    virtual bool isStateless(void) const override;
+    virtual bool getAffine(double &scaler, double &offset) const override;
+    virtual bool beginFilter(const DataView &samples) override;
+    virtual void filterChunk(const FilterChunk &chunk) override;
+    virtual void endFilter(void) override;
+
+    FilterPlugin* target(void) const;
+
+protected:
+    PluginLibraryPointer m_library;
+
+    //! Loaded plugin (cached, as filterChunk is called for every chunk)
+    mutable std::atomic<FilterPlugin*> m_target{nullptr};
+};
+
+
+#endif // PLUGIN_LIBRARY_HPP
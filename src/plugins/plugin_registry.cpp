@@ -4,13 +4,18 @@
 #include <QDialog>
 #include <QPluginLoader>
 #include <QDir>
+#include <QLibrary>
+#include <QStandardPaths>
 
 #include "plugin_registry.hpp"
 #include "lumberjack_settings.hpp"
 
 // Imports for built-in plugin classes
 #include "plugins/csv_importer/lumberjack_csv_importer.hpp"
+#include "plugins/mavlink_importer/mavlink_importer.hpp"
+#include "plugins/arrow_importer/arrow_importer.hpp"
 #include "plugins/csv_exporter/lumberjack_csv_exporter.hpp"
+#include "plugins/arrow_exporter/arrow_exporter.hpp"
 #include "plugins/offset_filter/offset_filter.hpp"
 #include "plugins/scaler_filter/scaler_filter.hpp"
 
@@ -36,9 +41,12 @@ void PluginRegistry::loadBuiltinPlugins()
 {
     // Builtin importer plugins
     m_ImportPlugins.append(QSharedPointer<ImportPlugin>(new LumberjackCSVImporter()));
+    m_ImportPlugins.append(QSharedPointer<ImportPlugin>(new MavlinkImporter()));
+    m_ImportPlugins.append(QSharedPointer<ImportPlugin>(new ArrowImporter()));
 
     // Builtin exporter plugins
     m_ExportPlugins.append(QSharedPointer<ExportPlugin>(new LumberjackCSVExporter()));
+    m_ExportPlugins.append(QSharedPointer<ExportPlugin>(new ArrowExporter()));
 
     // Builtin filter plugins
     m_FilterPlugins.append(QSharedPointer<FilterPlugin>(new OffsetFilter()));
@@ -49,12 +57,21 @@ void PluginRegistry::loadBuiltinPlugins()
 /*
  * Load all dynamic plugins
  * - Iterates through specified plugin dirs
+ * - Plugin libraries are not loaded until they are used: each plugin is registered by a stand-in
+ *   (e.g. LazyImportPlugin), using metadata which are cached between sessions (see PluginMetadata)
  */
 void PluginRegistry::loadPlugins()
 {
 
     loadBuiltinPlugins();
 
+    const QString cacheFile = getMetadataCacheFile();
+
+    const QHash<QString, PluginMetadata> cache = PluginMetadata::readCache(cacheFile);
+    QHash<QString, PluginMetadata> metadata;
+
+    bool changed = false;
+
     QList<QString> checkedPaths;
 
     for (QString libPath : QApplication::libraryPaths())
@@ -71,84 +88,94 @@ void PluginRegistry::loadPlugins()
         {
             QString libPath = libDir.absoluteFilePath(libFile);
 
-            QPluginLoader loader(libPath);
+            if (!QLibrary::isLibrary(libPath)) continue;
 
-            QObject *instance = loader.instance();
+            auto it = cache.find(libPath);
 
-            // Try to load against each type of plugin interface
-            if      (loadImportPlugin(instance)) {}
-            else if (loadExportPlugin(instance)) {}
-            else if (loadFilterPlugin(instance)) {}
+            PluginLibraryPointer library;
+
+            if (it != cache.end() && it->matchesFile())
+            {
+                library = std::make_shared<PluginLibrary>(*it);
+            }
             else
             {
-                // No match for the plugin
-                delete instance;
+                // The library is new (or has changed), so it is loaded to read the metadata
+                PluginMetadata entry;
+                entry.path = libPath;
+
+                library = std::make_shared<PluginLibrary>(entry);
+                library->probe();
+
+                changed = true;
             }
+
+            // Libraries which are not plugins are also cached, so they are not loaded again
+            metadata[libPath] = library->getMetadata();
+
+            registerLibrary(library);
         }
     }
+
+    if (changed || metadata.size() != cache.size())
+    {
+        PluginMetadata::writeCache(cacheFile, metadata);
+    }
 }
 
 
-void PluginRegistry::clearRegistry()
+/*
+ * Location of the plugin metadata cache
+ */
+QString PluginRegistry::getMetadataCacheFile()
 {
-    m_ImportPlugins.clear();
-    m_ExportPlugins.clear();
-    m_FilterPlugins.clear();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QDir::separator() + "plugins.json";
 }
 
 
 /**
- * @brief PluginRegistry::loadImportPlugin - Attempt to load an importer plugin
- * @param instance
- * @return
+ * @brief PluginRegistry::registerLibrary - Register a plugin library, according to its interface
+ * @param library
+ * @return false if the library does not provide a known plugin interface
  */
-bool PluginRegistry::loadImportPlugin(QObject *instance)
+bool PluginRegistry::registerLibrary(PluginLibraryPointer library)
 {
-    ImportPlugin *plugin = qobject_cast<ImportPlugin*>(instance);
+    const QString iid = library->getMetadata().iid;
 
-    if (plugin)
+    if (iid == ImporterInterface_iid)
     {
-        m_ImportPlugins.append(QSharedPointer<ImportPlugin>(plugin));
-        return true;
+        m_ImportPlugins.append(QSharedPointer<ImportPlugin>(new LazyImportPlugin(library)));
     }
-
-    return false;
-}
-
-
-bool PluginRegistry::loadExportPlugin(QObject *instance)
-{
-    ExportPlugin *plugin = qobject_cast<ExportPlugin*>(instance);
-
-    if (plugin)
+    else if (iid == ExporterInterface_iid)
+    {
+        m_ExportPlugins.append(QSharedPointer<ExportPlugin>(new LazyExportPlugin(library)));
+    }
+    else if (iid == FilterInterface_iid)
     {
-        m_ExportPlugins.append(QSharedPointer<ExportPlugin>(plugin));
-        return true;
+        m_FilterPlugins.append(QSharedPointer<FilterPlugin>(new LazyFilterPlugin(library)));
+    }
+    else
+    {
+        return false;
     }
 
-    return false;
+    return true;
 }
 
 
-bool PluginRegistry::loadFilterPlugin(QObject *instance)
+void PluginRegistry::clearRegistry()
 {
-    FilterPlugin *plugin = qobject_cast<FilterPlugin*>(instance);
-
-    if (plugin)
-    {
-        m_FilterPlugins.append(QSharedPointer<FilterPlugin>(plugin));
-        return true;
-    }
-
-    return false;
+    m_ImportPlugins.clear();
+    m_ExportPlugins.clear();
+    m_FilterPlugins.clear();
 }
 
 
 /**
- * @brief PluginRegistry::getFilenameForImport - Select a file for importing
+ * @brief PluginRegistry::getFilenamesForImport - Select files for importing
  * @return
  */
-QString PluginRegistry::getFilenameForImport(void) const
+QStringList PluginRegistry::getFilenamesForImport(void) const
 {
     auto settings = LumberjackSettings::getInstance();
 
@@ -174,7 +201,7 @@ QString PluginRegistry::getFilenameForImport(void) const
         dialog.setDirectory(lastDir);
     }
 
-    dialog.setFileMode(QFileDialog::ExistingFile);
+    dialog.setFileMode(QFileDialog::ExistingFiles);
     dialog.setNameFilters(filePatterns);
     dialog.setViewMode(QFileDialog::Detail);
 
@@ -184,21 +211,19 @@ QString PluginRegistry::getFilenameForImport(void) const
     if (result != QDialog::Accepted)
     {
         // User cancelled the import process
-        return QString();
+        return QStringList();
     }
 
     // Determine which plugin loaded the data
     QString filter = dialog.selectedNameFilter();
     QStringList files = dialog.selectedFiles();
 
-    QString filename;
-
-    if (!filter.isEmpty() && files.length() >= 1)
+    if (filter.isEmpty())
     {
-        filename = files.first();
+        return QStringList();
     }
 
-    return filename;
+    return files;
 }
 
 
@@ -4,6 +4,7 @@
 #include "plugin_filter.hpp"
 #include "plugin_importer.hpp"
 #include "plugin_exporter.hpp"
+#include "plugin_library.hpp"
 
 /**
  * @brief The PluginRegistry class manages loading of custom plugins
@@ -45,14 +46,14 @@ public:
     const ExportPluginList& ExportPlugins(void) { return m_ExportPlugins; }
     const FilterPluginList& FilterPlugins(void) { return m_FilterPlugins; }
 
-    QString getFilenameForImport(void) const;
+    QStringList getFilenamesForImport(void) const;
     QString getFilenameForExport(void) const;
 
 protected:
 
-    bool loadImportPlugin(QObject *instance);
-    bool loadExportPlugin(QObject *instance);
-    bool loadFilterPlugin(QObject *instance);
+    bool registerLibrary(PluginLibraryPointer library);
+
+    static QString getMetadataCacheFile(void);
 
     // Registry of each plugin "type"
     ImportPluginList m_ImportPlugins;
@@ -0,0 +1,676 @@
+// Python must be included before Qt (which defines "slots")
+#pragma push_macro("slots")
+#undef slots
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#pragma pop_macro("slots")
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string.h>
+#include <vector>
+
+#include <QFile>
+
+#include "data_source_manager.hpp"
+#include "python_bridge.hpp"
+#include "series_buffer.hpp"
+
+
+const char* PythonBridge::MODULE_NAME = "lumberjack";
+
+
+/*
+ * A Column is a read-only, one-dimensional buffer of samples (float64, or float32 for single precision values),
+ * which either views the storage of a series (retained by the SeriesBuffer) or owns a copy of the samples.
+ */
+struct ColumnStorage
+{
+    //! Retains the viewed storage (nullptr if the column owns a copy)
+    std::shared_ptr<const SeriesBuffer> buffer;
+
+    //! Copied samples
+    std::vector<double> copy;
+};
+
+struct ColumnObject
+{
+    PyObject_HEAD
+
+    ColumnStorage* storage;
+
+    const void* data;
+    Py_ssize_t length;
+    Py_ssize_t itemsize;
+};
+
+static PyTypeObject ColumnType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+static PyBufferProcs ColumnBufferProcs;
+
+
+static PyObject* createColumn(const void* data, Py_ssize_t length, bool single, std::shared_ptr<const SeriesBuffer> buffer)
+{
+    ColumnObject* column = PyObject_New(ColumnObject, &ColumnType);
+
+    if (!column) return nullptr;
+
+    column->storage = new ColumnStorage();
+    column->storage->buffer = buffer;
+    column->data = data;
+    column->length = length;
+    column->itemsize = single ? sizeof(float) : sizeof(double);
+
+    return (PyObject*) column;
+}
+
+
+//! Create a column which owns its samples (filled by the function, with one bulk copy)
+template<typename Function>
+static PyObject* createColumnCopy(Py_ssize_t length, Function fill)
+{
+    ColumnObject* column = (ColumnObject*) createColumn(nullptr, length, false, nullptr);
+
+    if (!column) return nullptr;
+
+    column->storage->copy.resize(length);
+
+    fill(column->storage->copy.data());
+
+    column->data = column->storage->copy.data();
+
+    return (PyObject*) column;
+}
+
+
+static void columnDealloc(PyObject* self)
+{
+    delete ((ColumnObject*) self)->storage;
+
+    PyObject_Free(self);
+}
+
+
+static Py_ssize_t columnLength(PyObject* self)
+{
+    return ((ColumnObject*) self)->length;
+}
+
+
+static int columnGetBuffer(PyObject* self, Py_buffer* view, int flags)
+{
+    ColumnObject* column = (ColumnObject*) self;
+
+    if (flags & PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "Columns are read-only");
+        view->obj = nullptr;
+        return -1;
+    }
+
+    view->obj = self;
+    view->buf = (void*) column->data;
+    view->len = column->length * column->itemsize;
+    view->readonly = 1;
+    view->itemsize = column->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*) (column->itemsize == sizeof(float) ? "f" : "d") : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &column->length : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? &column->itemsize : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+
+    Py_INCREF(self);
+
+    return 0;
+}
+
+
+static bool initColumnType(void)
+{
+    static PySequenceMethods sequence;
+
+    sequence.sq_length = columnLength;
+
+    ColumnBufferProcs.bf_getbuffer = columnGetBuffer;
+
+    ColumnType.tp_name = "lumberjack.Column";
+    ColumnType.tp_doc = "Read-only column of samples (supports the buffer protocol, e.g. numpy.asarray)";
+    ColumnType.tp_basicsize = sizeof(ColumnObject);
+    ColumnType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ColumnType.tp_dealloc = columnDealloc;
+    ColumnType.tp_as_sequence = &sequence;
+    ColumnType.tp_as_buffer = &ColumnBufferProcs;
+
+    return PyType_Ready(&ColumnType) == 0;
+}
+
+
+/*
+ * Find a series by the labels of its source and series (raising KeyError if there is no such series)
+ */
+static DataSeriesPointer findSeries(const char* source, const char* series)
+{
+    auto result = DataSourceManager::getInstance()->findSeries(QString::fromUtf8(source), QString::fromUtf8(series));
+
+    if (result.isNull())
+    {
+        PyErr_Format(PyExc_KeyError, "No series '%s' in source '%s'", series, source);
+    }
+
+    return result;
+}
+
+
+static std::shared_ptr<const SeriesBuffer> getBuffer(PyObject* args)
+{
+    const char* source = nullptr;
+    const char* label = nullptr;
+
+    if (!PyArg_ParseTuple(args, "ss", &source, &label)) return nullptr;
+
+    auto series = findSeries(source, label);
+
+    if (series.isNull()) return nullptr;
+
+    return std::make_shared<const SeriesBuffer>(SeriesBuffer::fromSeries(*series));
+}
+
+
+static PyObject* toList(const QStringList& labels)
+{
+    PyObject* list = PyList_New(labels.size());
+
+    if (!list) return nullptr;
+
+    for (int idx = 0; idx < labels.size(); idx++)
+    {
+        PyList_SET_ITEM(list, idx, PyUnicode_FromString(labels[idx].toUtf8().constData()));
+    }
+
+    return list;
+}
+
+
+/*
+ * lumberjack.sources() - Labels of the loaded sources
+ */
+static PyObject* getSources(PyObject*, PyObject*)
+{
+    return toList(DataSourceManager::getInstance()->getSourceLabels());
+}
+
+
+/*
+ * lumberjack.series(source) - Labels of the series of a source
+ */
+static PyObject* getSeries(PyObject*, PyObject* args)
+{
+    const char* label = nullptr;
+
+    if (!PyArg_ParseTuple(args, "s", &label)) return nullptr;
+
+    auto source = DataSourceManager::getInstance()->getSourceByLabel(QString::fromUtf8(label));
+
+    if (source.isNull())
+    {
+        PyErr_Format(PyExc_KeyError, "No source '%s'", label);
+        return nullptr;
+    }
+
+    QStringList labels;
+
+    for (int idx = 0; idx < source->getSeriesCount(); idx++)
+    {
+        labels.append(source->getSeriesByIndex(idx)->getLabel());
+    }
+
+    return toList(labels);
+}
+
+
+/*
+ * lumberjack.segments(source, series) - (timestamps, values) columns of each block, which view the series storage
+ */
+static PyObject* getSegments(PyObject*, PyObject* args)
+{
+    auto buffer = getBuffer(args);
+
+    if (!buffer) return nullptr;
+
+    PyObject* list = PyList_New(buffer->getSegmentCount());
+
+    if (!list) return nullptr;
+
+    for (size_t idx = 0; idx < buffer->getSegmentCount(); idx++)
+    {
+        const auto& segment = buffer->getSegment(idx);
+
+        const bool single = segment.values == nullptr;
+
+        PyObject* pair = Py_BuildValue("(NN)",
+                                       createColumn(segment.timestamps, segment.length, false, buffer),
+                                       createColumn(single ? (const void*) segment.valuesSingle : segment.values, segment.length, single, buffer));
+
+        if (!pair)
+        {
+            Py_DECREF(list);
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(list, idx, pair);
+    }
+
+    return list;
+}
+
+
+/*
+ * lumberjack.timestamps(source, series) - Timestamp column (ms, aligned time), which views the series storage
+ * if it is a single block (and the source has no time scaling)
+ */
+static PyObject* getTimestamps(PyObject*, PyObject* args)
+{
+    auto buffer = getBuffer(args);
+
+    if (!buffer) return nullptr;
+
+    if (buffer->isContiguous() && buffer->size() > 0 && !buffer->hasTimeScaling())
+    {
+        return createColumn(buffer->getSegment(0).timestamps, buffer->size(), false, buffer);
+    }
+
+    return createColumnCopy(buffer->size(), [&buffer](double* data) { buffer->copyTimestamps(data); });
+}
+
+
+/*
+ * lumberjack.values(source, series, scaled=True) - Value column, which views the series storage if it
+ * is a single block (and no scaling is applied)
+ */
+static PyObject* getValues(PyObject*, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"source", "series", "scaled", nullptr};
+
+    const char* source = nullptr;
+    const char* label = nullptr;
+    int scaled = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|p", (char**) keywords, &source, &label, &scaled)) return nullptr;
+
+    auto series = findSeries(source, label);
+
+    if (series.isNull()) return nullptr;
+
+    auto buffer = std::make_shared<const SeriesBuffer>(SeriesBuffer::fromSeries(*series));
+
+    const bool identity = buffer->getScaler() == 1.0 && buffer->getOffset() == 0.0;
+
+    if (buffer->isContiguous() && buffer->size() > 0 && (!scaled || identity))
+    {
+        const auto& segment = buffer->getSegment(0);
+
+        if (segment.values) return createColumn(segment.values, segment.length, false, buffer);
+
+        return createColumn(segment.valuesSingle, segment.length, true, buffer);
+    }
+
+    return createColumnCopy(buffer->size(), [&buffer, scaled](double* data) { buffer->copyValues(data, scaled); });
+}
+
+
+/*
+ * lumberjack.scaling(source, series) - (scaler, offset) of a series, which are applied to its raw values
+ */
+static PyObject* getScaling(PyObject*, PyObject* args)
+{
+    auto buffer = getBuffer(args);
+
+    if (!buffer) return nullptr;
+
+    return Py_BuildValue("(dd)", buffer->getScaler(), buffer->getOffset());
+}
+
+
+/*
+ * lumberjack.aggregate(source, series, t_min, t_max, buckets) - Statistics of the samples within equal time buckets
+ * (see DataSnapshot::aggregate), as a dict of float64 columns: "t" (centre of each bucket), "count", "min", "max",
+ * "mean", "stddev", "first" and "last" (NaN for an empty bucket)
+ */
+static PyObject* getAggregate(PyObject*, PyObject* args)
+{
+    const char* source = nullptr;
+    const char* label = nullptr;
+    double t_min = 0;
+    double t_max = 0;
+    Py_ssize_t buckets = 0;
+
+    if (!PyArg_ParseTuple(args, "ssddn", &source, &label, &t_min, &t_max, &buckets)) return nullptr;
+
+    if (buckets <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "buckets must be positive");
+        return nullptr;
+    }
+
+    auto series = findSeries(source, label);
+
+    if (series.isNull()) return nullptr;
+
+    const auto result = series->aggregate(t_min, t_max, (size_t) buckets);
+
+    PyObject* dict = PyDict_New();
+
+    if (!dict) return nullptr;
+
+    auto add = [dict](const char* key, PyObject* column) {
+        if (!column) return false;
+
+        const bool ok = PyDict_SetItemString(dict, key, column) == 0;
+
+        Py_DECREF(column);
+
+        return ok;
+    };
+
+    auto copy = [buckets](const std::vector<double>& values) {
+        return createColumnCopy(buckets, [&values](double* data) { std::copy(values.begin(), values.end(), data); });
+    };
+
+    const bool ok =
+        add("t", createColumnCopy(buckets, [&result](double* data) {
+            for (size_t ii = 0; ii < result.size(); ii++) data[ii] = result.getBucketCentre(ii);
+        })) &&
+        add("count", createColumnCopy(buckets, [&result](double* data) {
+            std::copy(result.count.begin(), result.count.end(), data);
+        })) &&
+        add("min", copy(result.min)) &&
+        add("max", copy(result.max)) &&
+        add("mean", copy(result.mean)) &&
+        add("stddev", copy(result.stddev)) &&
+        add("first", copy(result.first)) &&
+        add("last", copy(result.last));
+
+    if (!ok)
+    {
+        Py_DECREF(dict);
+        return nullptr;
+    }
+
+    return dict;
+}
+
+
+/*
+ * Request a contiguous float64 buffer (e.g. a NumPy array)
+ */
+static bool getColumnBuffer(PyObject* object, Py_buffer& view, const char* name)
+{
+    if (PyObject_GetBuffer(object, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) return false;
+
+    const char* format = view.format ? view.format : "B";
+
+    if (format[0] == '<' || format[0] == '=' || format[0] == '@') format++;
+
+    if (view.ndim != 1 || view.itemsize != sizeof(double) || strcmp(format, "d") != 0)
+    {
+        PyErr_Format(PyExc_TypeError, "%s must be a one-dimensional float64 buffer", name);
+        PyBuffer_Release(&view);
+        return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * lumberjack.add_series(source, label, timestamps, values) - Add (or replace) a series, ingesting the
+ * samples in a single call (the source is created if required)
+ */
+static PyObject* addSeries(PyObject*, PyObject* args)
+{
+    const char* sourceLabel = nullptr;
+    const char* label = nullptr;
+    PyObject* timestamps = nullptr;
+    PyObject* values = nullptr;
+
+    if (!PyArg_ParseTuple(args, "ssOO", &sourceLabel, &label, &timestamps, &values)) return nullptr;
+
+    Py_buffer t;
+    Py_buffer v;
+
+    if (!getColumnBuffer(timestamps, t, "timestamps")) return nullptr;
+
+    if (!getColumnBuffer(values, v, "values"))
+    {
+        PyBuffer_Release(&t);
+        return nullptr;
+    }
+
+    PyObject* result = nullptr;
+
+    if (t.len != v.len)
+    {
+        PyErr_SetString(PyExc_ValueError, "timestamps and values must have the same length");
+    }
+    else
+    {
+        auto manager = DataSourceManager::getInstance();
+
+        const QString name = QString::fromUtf8(sourceLabel);
+
+        auto source = manager->getSourceByLabel(name);
+
+        if (source.isNull())
+        {
+            source = DataSourcePointer(new DataSource(name, name, "Python"));
+            manager->addSource(source);
+        }
+
+        const size_t count = t.len / sizeof(double);
+
+        auto series = source->getSeriesByLabel(QString::fromUtf8(label));
+
+        if (series.isNull())
+        {
+            series = DataSeriesPointer(new DataSeries(QString::fromUtf8(label)));
+            series->addData((const double*) t.buf, (const double*) v.buf, count, false);
+
+            source->addSeries(series);
+        }
+        else
+        {
+            series->clearData(false);
+            series->addData((const double*) t.buf, (const double*) v.buf, count);
+        }
+
+        manager->update();
+
+        result = Py_None;
+        Py_INCREF(result);
+    }
+
+    PyBuffer_Release(&t);
+    PyBuffer_Release(&v);
+
+    return result;
+}
+
+
+static PyMethodDef moduleMethods[] = {
+    {"sources", getSources, METH_NOARGS, "sources() - Labels of the loaded sources"},
+    {"series", getSeries, METH_VARARGS, "series(source) - Labels of the series of a source"},
+    {"segments", getSegments, METH_VARARGS, "segments(source, series) - (timestamps, values) columns of each block, without copying"},
+    {"timestamps", getTimestamps, METH_VARARGS, "timestamps(source, series) - Timestamp column (ms)"},
+    {"values", (PyCFunction) (void(*)(void)) getValues, METH_VARARGS | METH_KEYWORDS, "values(source, series, scaled=True) - Value column"},
+    {"scaling", getScaling, METH_VARARGS, "scaling(source, series) - (scaler, offset) applied to the raw values"},
+    {"aggregate", getAggregate, METH_VARARGS, "aggregate(source, series, t_min, t_max, buckets) - Statistics of equal time buckets, as a dict of columns"},
+    {"add_series", addSeries, METH_VARARGS, "add_series(source, label, timestamps, values) - Add a series from float64 buffers"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT,
+    "lumberjack",
+    "Access to the data loaded in Lumberjack",
+    -1,
+    moduleMethods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+
+static PyObject* initModule(void)
+{
+    if (!initColumnType()) return nullptr;
+
+    PyObject* module = PyModule_Create(&moduleDef);
+
+    if (!module) return nullptr;
+
+    Py_INCREF(&ColumnType);
+
+    if (PyModule_AddObject(module, "Column", (PyObject*) &ColumnType) != 0)
+    {
+        Py_DECREF(&ColumnType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    return module;
+}
+
+
+/*
+ * Description of the raised exception (which is cleared)
+ */
+static QString getErrorMessage(void)
+{
+    PyObject* type = nullptr;
+    PyObject* value = nullptr;
+    PyObject* traceback = nullptr;
+
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+
+    QString message = "Python error";
+
+    if (value)
+    {
+        PyObject* text = PyObject_Str(value);
+
+        if (text)
+        {
+            message = QString("%1: %2").arg(type ? ((PyTypeObject*) type)->tp_name : "Error").arg(PyUnicode_AsUTF8(text));
+            Py_DECREF(text);
+        }
+    }
+
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
+
+    PyErr_Clear();
+
+    return message;
+}
+
+
+/**
+ * @brief PythonBridge::initialize - Start the interpreter (and register the lumberjack module)
+ */
+bool PythonBridge::initialize(QStringList& errors)
+{
+    if (Py_IsInitialized()) return true;
+
+    if (PyImport_AppendInittab(MODULE_NAME, &initModule) != 0)
+    {
+        errors.append("Could not register the lumberjack Python module");
+        return false;
+    }
+
+    Py_InitializeEx(0);
+
+    if (!Py_IsInitialized())
+    {
+        errors.append("Could not start the Python interpreter");
+        return false;
+    }
+
+    return true;
+}
+
+
+void PythonBridge::finalize()
+{
+    if (Py_IsInitialized())
+    {
+        Py_Finalize();
+    }
+}
+
+
+bool PythonBridge::isInitialized()
+{
+    return Py_IsInitialized();
+}
+
+
+/*
+ * Compile and run code in the __main__ module
+ */
+static bool runSource(const QByteArray& code, const QByteArray& filename, QStringList& errors)
+{
+    PyObject* compiled = Py_CompileString(code.constData(), filename.constData(), Py_file_input);
+
+    if (!compiled)
+    {
+        errors.append(getErrorMessage());
+        return false;
+    }
+
+    PyObject* globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+    PyObject* result = PyEval_EvalCode(compiled, globals, globals);
+
+    Py_DECREF(compiled);
+
+    if (!result)
+    {
+        errors.append(getErrorMessage());
+        return false;
+    }
+
+    Py_DECREF(result);
+
+    return true;
+}
+
+
+/**
+ * @brief PythonBridge::runCode - Run Python code (in the __main__ module, which persists between calls)
+ * @return false if the code raised an exception (which is described in errors)
+ */
+bool PythonBridge::runCode(const QString& code, QStringList& errors)
+{
+    if (!initialize(errors)) return false;
+
+    return runSource(code.toUtf8(), "<console>", errors);
+}
+
+
+/**
+ * @brief PythonBridge::runScript - Run a Python script file (see runCode)
+ */
+bool PythonBridge::runScript(const QString& filename, QStringList& errors)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errors.append(QString("Could not open file: %1").arg(filename));
+        return false;
+    }
+
+    if (!initialize(errors)) return false;
+
+    return runSource(file.readAll(), filename.toUtf8(), errors);
+}
@@ -0,0 +1,44 @@
+#ifndef PYTHON_BRIDGE_HPP
+#define PYTHON_BRIDGE_HPP
+
+#include <QString>
+#include <QStringList>
+
+
+/**
+ * @brief The PythonBridge class embeds the Python interpreter, and provides the "lumberjack" module,
+ * through which scripts access the loaded data (built with CONFIG+=python).
+ *
+ * The columns of a series are exposed through the buffer protocol (see SeriesBuffer), so NumPy arrays
+ * view the sample storage of the series directly, without copying it:
+ *
+ *   import lumberjack, numpy as np
+ *
+ *   for t, v in lumberjack.segments("flight.bin", "Altitude"):   # one (timestamps, values) pair per block
+ *       print(np.asarray(v).max())
+ *
+ *   t = np.asarray(lumberjack.timestamps("flight.bin", "Altitude"))  # complete column (one copy per block,
+ *   v = np.asarray(lumberjack.values("flight.bin", "Altitude"))      # unless the series is a single block)
+ *
+ *   lumberjack.add_series("Python", "Filtered", t, np.convolve(v, np.ones(9) / 9, "same"))
+ *
+ * Segment values are raw (see lumberjack.scaling), and segments are read-only. add_series ingests any
+ * pair of contiguous float64 buffers (e.g. NumPy arrays) in a single call. The interpreter runs in the
+ * GUI thread, and the module may only be used from it.
+ */
+class PythonBridge
+{
+public:
+    //! Name of the module which provides access to the loaded data
+    static const char* MODULE_NAME;
+
+    static bool initialize(QStringList& errors);
+    static void finalize(void);
+
+    static bool isInitialized(void);
+
+    static bool runCode(const QString& code, QStringList& errors);
+    static bool runScript(const QString& filename, QStringList& errors);
+};
+
+#endif // PYTHON_BRIDGE_HPP
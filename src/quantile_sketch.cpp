@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+
+#include "quantile_sketch.hpp"
+
+
+QuantileSketch::QuantileSketch(double acc) : accuracy(std::min(std::max(acc, 1e-6), 0.5))
+{
+    gamma = (1 + accuracy) / (1 - accuracy);
+    logGamma = std::log(gamma);
+}
+
+
+/*
+ * Bin which contains a (positive) magnitude: gamma^(bin - 1) < magnitude <= gamma^bin
+ */
+int QuantileSketch::getBin(double magnitude) const
+{
+    return (int) std::ceil(std::log(magnitude) / logGamma);
+}
+
+
+/*
+ * Value which represents every magnitude in a bin (within the relative accuracy of the sketch)
+ */
+double QuantileSketch::getBinValue(int bin) const
+{
+    return 2 * std::pow(gamma, bin) / (gamma + 1);
+}
+
+
+void QuantileSketch::add(double value)
+{
+    if (std::isnan(value)) return;
+
+    if (count == 0)
+    {
+        min = value;
+        max = value;
+    }
+    else
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    count++;
+
+    if (value > MIN_MAGNITUDE)
+    {
+        positive[getBin(value)]++;
+    }
+    else if (value < -MIN_MAGNITUDE)
+    {
+        negative[getBin(-value)]++;
+    }
+    else
+    {
+        zeros++;
+    }
+}
+
+
+void QuantileSketch::add(const double *values, size_t n)
+{
+    for (size_t ii = 0; ii < n; ii++)
+    {
+        add(values[ii]);
+    }
+}
+
+
+void QuantileSketch::add(const float *values, size_t n)
+{
+    for (size_t ii = 0; ii < n; ii++)
+    {
+        add((double) values[ii]);
+    }
+}
+
+
+/**
+ * @brief QuantileSketch::merge - Add the values counted by another sketch (which must have the same accuracy)
+ */
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.count == 0) return;
+
+    if (count == 0)
+    {
+        min = other.min;
+        max = other.max;
+    }
+    else
+    {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    count += other.count;
+    zeros += other.zeros;
+
+    for (const auto &bin : other.positive)
+    {
+        positive[bin.first] += bin.second;
+    }
+
+    for (const auto &bin : other.negative)
+    {
+        negative[bin.first] += bin.second;
+    }
+}
+
+
+void QuantileSketch::clear()
+{
+    positive.clear();
+    negative.clear();
+
+    zeros = 0;
+    count = 0;
+
+    min = 0;
+    max = 0;
+}
+
+
+/**
+ * @brief QuantileSketch::getQuantile - Estimate a quantile of the values
+ * @param q - The quantile, in [0, 1] (e.g. 0.5 for the median)
+ * @return the estimated value (or NaN if the sketch is empty)
+ */
+double QuantileSketch::getQuantile(double q) const
+{
+    if (count == 0) return std::nan("");
+
+    q = std::min(std::max(q, 0.0), 1.0);
+
+    if (q == 0) return min;
+    if (q == 1) return max;
+
+    // Rank of the value (from zero), in ascending order of value
+    const uint64_t rank = (uint64_t) std::floor(q * (count - 1));
+
+    uint64_t seen = 0;
+    double value = 0;
+    bool found = false;
+
+    // Negative values, from the largest magnitude
+    for (auto it = negative.rbegin(); it != negative.rend(); ++it)
+    {
+        seen += it->second;
+
+        if (seen > rank)
+        {
+            value = -getBinValue(it->first);
+            found = true;
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        seen += zeros;
+
+        found = seen > rank;
+    }
+
+    if (!found)
+    {
+        for (const auto &bin : positive)
+        {
+            seen += bin.second;
+
+            if (seen > rank)
+            {
+                value = getBinValue(bin.first);
+                break;
+            }
+        }
+    }
+
+    return std::min(std::max(value, min), max);
+}
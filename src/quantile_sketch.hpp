@@ -0,0 +1,75 @@
+#ifndef QUANTILE_SKETCH_HPP
+#define QUANTILE_SKETCH_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+
+
+/**
+ * @brief The QuantileSketch class estimates the quantiles (e.g. the median) of a set of values, in bounded memory.
+ *
+ * Values are counted in logarithmically spaced bins, so each quantile is estimated to within a fixed
+ * relative accuracy of the true value (as in DDSketch). Sketches are mergeable: the sketch of the union
+ * of two sets of values is the merge of their sketches, so a sketch can be computed once for each block
+ * of a series and combined for any range of blocks (see StatsEngine).
+ *
+ * NaN values are ignored.
+ */
+class QuantileSketch
+{
+public:
+    //! Default relative accuracy of each quantile
+    static constexpr double DEFAULT_ACCURACY = 0.005;
+
+    //! Values with a smaller magnitude are counted as zero
+    static constexpr double MIN_MAGNITUDE = 1e-300;
+
+    explicit QuantileSketch(double accuracy = DEFAULT_ACCURACY);
+
+    void add(double value);
+    void add(const double *values, size_t count);
+    void add(const float *values, size_t count);
+
+    void merge(const QuantileSketch &other);
+
+    void clear(void);
+
+    uint64_t getCount(void) const { return count; }
+    bool isEmpty(void) const { return count == 0; }
+
+    double getAccuracy(void) const { return accuracy; }
+
+    double getMinimum(void) const { return min; }
+    double getMaximum(void) const { return max; }
+
+    double getQuantile(double q) const;
+
+    //! Number of occupied bins (which determines the memory used by the sketch)
+    size_t getBinCount(void) const { return positive.size() + negative.size(); }
+
+protected:
+    int getBin(double magnitude) const;
+    double getBinValue(int bin) const;
+
+    double accuracy;
+
+    //! Ratio of the upper and lower bounds of each bin
+    double gamma;
+    double logGamma;
+
+    //! Number of values in each bin, for positive values and (by magnitude) negative values
+    std::map<int, uint64_t> positive;
+    std::map<int, uint64_t> negative;
+
+    uint64_t zeros = 0;
+    uint64_t count = 0;
+
+    //! Exact extreme values (quantiles are clamped to this range)
+    double min = 0;
+    double max = 0;
+};
+
+
+#endif // QUANTILE_SKETCH_HPP
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <string.h>
+
+#include "series_buffer.hpp"
+
+
+SeriesBuffer::SeriesBuffer(const DataView& view) : view(view)
+{
+    this->view.visitSegments([this](const DataView::Segment& segment) {
+        segments.push_back(segment);
+        count += segment.length;
+    });
+}
+
+
+/**
+ * @brief SeriesBuffer::fromSeries - Buffer of every (filtered) sample of a series
+ */
+SeriesBuffer SeriesBuffer::fromSeries(const DataSeries& series)
+{
+    return SeriesBuffer(series.getSnapshot().getView());
+}
+
+
+bool SeriesBuffer::isSinglePrecision() const
+{
+    if (segments.empty()) return false;
+
+    return std::all_of(segments.begin(), segments.end(), [](const DataView::Segment& segment) {
+        return segment.valuesSingle != nullptr;
+    });
+}
+
+
+/**
+ * @brief SeriesBuffer::copyTimestamps - Copy the timestamp column (one copy per segment)
+ * @param timestamps receives size() timestamps
+ * @param scaled applies the time scaling of the series (see DataSeries::setTimeScaling)
+ */
+void SeriesBuffer::copyTimestamps(double* timestamps, bool scaled) const
+{
+    for (const auto& segment : segments)
+    {
+        memcpy(timestamps + segment.index, segment.timestamps, segment.length * sizeof(double));
+    }
+
+    if (scaled && hasTimeScaling())
+    {
+        const DataSnapshot& snapshot = view.getSnapshot();
+
+        for (uint64_t idx = 0; idx < count; idx++)
+        {
+            timestamps[idx] = snapshot.applyTimeScaling(timestamps[idx]);
+        }
+    }
+}
+
+
+/**
+ * @brief SeriesBuffer::copyValues - Copy the value column (one copy per segment)
+ * @param values receives size() values
+ * @param scaled applies the scaler and offset of the series
+ */
+void SeriesBuffer::copyValues(double* values, bool scaled) const
+{
+    for (const auto& segment : segments)
+    {
+        double* out = values + segment.index;
+
+        if (segment.values)
+        {
+            memcpy(out, segment.values, segment.length * sizeof(double));
+        }
+        else
+        {
+            std::copy(segment.valuesSingle, segment.valuesSingle + segment.length, out);
+        }
+    }
+
+    if (scaled && (getScaler() != 1.0 || getOffset() != 0.0))
+    {
+        view.getSnapshot().applyScaling(values, count);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SERIES_BUFFER_HPP
+#define SERIES_BUFFER_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The SeriesBuffer class exposes the sample columns of a series for bulk (zero-copy) access,
+ * e.g. as NumPy arrays through the Python buffer protocol (see PythonBridge).
+ *
+ * The buffer retains a view of the series, and the decoded columns of each compressed block, so the
+ * column pointers of every segment remain valid (and unchanged) for as long as the buffer exists, even
+ * if the series is modified. Samples are stored in blocks (see DataBlock::CAPACITY), so a series is
+ * exposed as a sequence of contiguous segments; copyTimestamps and copyValues assemble the complete
+ * columns with one bulk copy per segment, for code which requires a single array.
+ *
+ * Timestamps and values are raw, unless copied with scaling (see getScaler, getOffset and getTimeScale).
+ */
+class SeriesBuffer
+{
+public:
+    SeriesBuffer() {}
+    SeriesBuffer(const DataView& view);
+
+    static SeriesBuffer fromSeries(const DataSeries& series);
+
+    //! Total number of samples
+    uint64_t size(void) const { return count; }
+
+    size_t getSegmentCount(void) const { return segments.size(); }
+    const DataView::Segment& getSegment(size_t idx) const { return segments[idx]; }
+
+    //! True if the samples are stored in (at most) a single segment, so the columns can be used without a copy
+    bool isContiguous(void) const { return segments.size() <= 1; }
+
+    //! True if every segment stores its values in single precision
+    bool isSinglePrecision(void) const;
+
+    double getScaler(void) const { return view.getSnapshot().getScaler(); }
+    double getOffset(void) const { return view.getSnapshot().getOffset(); }
+
+    double getTimeScale(void) const { return view.getSnapshot().getTimeScale(); }
+    double getTimeOffset(void) const { return view.getSnapshot().getTimeOffset(); }
+    bool hasTimeScaling(void) const { return view.getSnapshot().hasTimeScaling(); }
+
+    void copyTimestamps(double* timestamps, bool scaled = true) const;
+    void copyValues(double* values, bool scaled = true) const;
+
+protected:
+    //! View of the samples (which retains the blocks of the series)
+    DataView view;
+
+    //! Segments of the view (which retain any decoded columns)
+    std::vector<DataView::Segment> segments;
+
+    uint64_t count = 0;
+};
+
+#endif // SERIES_BUFFER_HPP
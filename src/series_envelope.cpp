@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+
+#include "series_envelope.hpp"
+
+
+void SeriesEnvelope::clear()
+{
+    snapshot = DataSnapshot();
+    buckets.clear();
+
+    min = 0;
+    max = 0;
+}
+
+
+/**
+ * @brief SeriesEnvelope::update - Update the envelope to describe a (newer) snapshot of the series.
+ * If the snapshot shares its leading samples with the previous snapshot (i.e. samples have only been appended),
+ * the buckets of the blocks which preceded the final block of the previous snapshot are retained.
+ * @param latest - Snapshot of the series
+ * @return true if the envelope has changed
+ */
+bool SeriesEnvelope::update(const DataSnapshot &latest)
+{
+    if (latest.isIdentical(snapshot) && latest.getScaler() == snapshot.getScaler() && latest.getOffset() == snapshot.getOffset())
+    {
+        return false;
+    }
+
+    uint64_t idx_first = 0;
+    uint64_t idx_last = 0;
+
+    uint64_t restart = 0;
+
+    const bool compatible = latest.getScaler() == snapshot.getScaler() && latest.getOffset() == snapshot.getOffset();
+
+    // Any block other than the final block of the previous snapshot is unchanged
+    if (compatible && latest.getCommonRange(snapshot, idx_first, idx_last) && idx_first == 0)
+    {
+        const DataBlockTable &table = *latest.getTable();
+
+        restart = table.offsets[table.getBlockForIndex(idx_last - 1)];
+    }
+
+    while (!buckets.empty() && buckets.back().idx >= restart)
+    {
+        buckets.pop_back();
+    }
+
+    snapshot = latest;
+
+    appendBuckets(restart);
+    updateRange();
+
+    return true;
+}
+
+
+/*
+ * Summarise the samples of the snapshot from the specified index onwards
+ */
+void SeriesEnvelope::appendBuckets(uint64_t idx_first)
+{
+    uint64_t idx = idx_first;
+
+    snapshot.visitBuckets(idx_first, snapshot.size(), DataBlock::SUMMARY_LEVELS - 1, [&](const DataSnapshot::Bucket &b) {
+        Bucket bucket;
+
+        bucket.idx = idx;
+        bucket.t_first = b.first.timestamp;
+        bucket.t_last = b.last.timestamp;
+        bucket.min = b.min.value;
+        bucket.max = b.max.value;
+
+        idx += b.count;
+
+        buckets.push_back(bucket);
+    });
+}
+
+
+void SeriesEnvelope::updateRange()
+{
+    bool found = false;
+
+    for (const auto &bucket : buckets)
+    {
+        if (std::isnan(bucket.min) || std::isnan(bucket.max)) continue;
+
+        if (!found)
+        {
+            min = bucket.min;
+            max = bucket.max;
+            found = true;
+        }
+        else
+        {
+            min = std::min(min, bucket.min);
+            max = std::max(max, bucket.max);
+        }
+    }
+
+    if (!found)
+    {
+        min = 0;
+        max = 0;
+    }
+}
+
+
+/**
+ * @brief SeriesEnvelope::getColumns - Bin the envelope into equally spaced columns over a time range.
+ * Columns which contain no samples are set to NaN.
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range
+ * @param width - Number of columns
+ * @param mins - Set to the minimum value within each column
+ * @param maxs - Set to the maximum value within each column
+ * @return the number of columns which contain samples
+ */
+int SeriesEnvelope::getColumns(double t_min, double t_max, int width, std::vector<double> &mins, std::vector<double> &maxs) const
+{
+    width = std::max(width, 0);
+
+    mins.assign(width, NAN);
+    maxs.assign(width, NAN);
+
+    if (width == 0 || !(t_max > t_min)) return 0;
+
+    const double scale = width / (t_max - t_min);
+
+    int filled = 0;
+
+    // Buckets are in timestamp order, so only those which overlap the range are visited
+    auto it = std::lower_bound(buckets.begin(), buckets.end(), t_min, [](const Bucket &bucket, double t) {
+        return bucket.t_last < t;
+    });
+
+    for ( ; it != buckets.end() && it->t_first <= t_max; ++it)
+    {
+        if (std::isnan(it->min) || std::isnan(it->max)) continue;
+
+        const int a = std::max(0, (int) std::floor((it->t_first - t_min) * scale));
+        const int b = std::min(width - 1, (int) std::floor((it->t_last - t_min) * scale));
+
+        // A bucket spanning several columns is spread across each of them
+        for (int col = a; col <= b; col++)
+        {
+            if (std::isnan(mins[col]))
+            {
+                mins[col] = it->min;
+                maxs[col] = it->max;
+                filled++;
+            }
+            else
+            {
+                mins[col] = std::min(mins[col], it->min);
+                maxs[col] = std::max(maxs[col], it->max);
+            }
+        }
+    }
+
+    return filled;
+}
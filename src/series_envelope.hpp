@@ -0,0 +1,66 @@
+#ifndef SERIES_ENVELOPE_HPP
+#define SERIES_ENVELOPE_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The SeriesEnvelope class holds a coarse min / max outline of an entire series.
+ *
+ * The outline is read from the top level of the summary pyramid of each block, so it has roughly one
+ * bucket per block, regardless of the number of samples. It is updated incrementally: only the final
+ * block of the previous snapshot is summarised again when samples are appended (see update).
+ *
+ * The outline is binned into columns (e.g. one per pixel of the timeline) when it is drawn.
+ */
+class SeriesEnvelope
+{
+public:
+    /**
+     * @brief The Bucket struct describes the range of values within a run of samples
+     */
+    struct Bucket
+    {
+        //! Index of the first sample (within the snapshot)
+        uint64_t idx = 0;
+
+        double t_first = 0;
+        double t_last = 0;
+
+        double min = 0;
+        double max = 0;
+    };
+
+    void clear(void);
+
+    bool update(const DataSnapshot &snapshot);
+
+    const std::vector<Bucket>& getBuckets(void) const { return buckets; }
+
+    bool isEmpty(void) const { return buckets.empty(); }
+
+    //! Range of values of the entire series
+    double getMin(void) const { return min; }
+    double getMax(void) const { return max; }
+
+    int getColumns(double t_min, double t_max, int width, std::vector<double> &mins, std::vector<double> &maxs) const;
+
+protected:
+    void appendBuckets(uint64_t idx_first);
+    void updateRange(void);
+
+    //! Samples which the envelope describes
+    DataSnapshot snapshot;
+
+    std::vector<Bucket> buckets;
+
+    double min = 0;
+    double max = 0;
+};
+
+
+#endif // SERIES_ENVELOPE_HPP
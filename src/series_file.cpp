@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <vector>
+
+#include "data_codec.hpp"
+#include "series_file.hpp"
+
+
+const uint32_t SeriesFile::CHUNK_SAMPLES;
+
+
+bool SeriesFile::writeData(QIODevice& file, const void* data, qint64 bytes)
+{
+    return file.write((const char*) data, bytes) == bytes;
+}
+
+
+bool SeriesFile::readData(QIODevice& file, void* data, qint64 bytes)
+{
+    return file.read((char*) data, bytes) == bytes;
+}
+
+
+/**
+ * @brief SeriesFile::writeSamples - Write the (raw) samples of a snapshot, a chunk at a time
+ * @param file is positioned at the start of the sample section
+ * @param snapshot contains the samples
+ * @return true if every sample was written
+ */
+bool SeriesFile::writeSamples(QIODevice& file, const DataSnapshot& snapshot)
+{
+    const uint64_t count = snapshot.size();
+
+    bool valid = writeData(file, &count, sizeof(count));
+
+    std::vector<uint64_t> timestampWords;
+    std::vector<uint64_t> valueWords;
+
+    std::vector<double> timestamps(CHUNK_SAMPLES);
+    std::vector<double> values(CHUNK_SAMPLES);
+
+    for (uint64_t first = 0; valid && first < count; first += CHUNK_SAMPLES)
+    {
+        const uint32_t n = (uint32_t) std::min<uint64_t>(CHUNK_SAMPLES, count - first);
+
+        const DataView view = snapshot.getView(first, first + n);
+
+        view.copyTimestamps(timestamps.data(), true);
+        view.copyValues(values.data(), true);
+
+        timestampWords.clear();
+        valueWords.clear();
+
+        DataCodec::encodeTimestamps(timestamps.data(), n, timestampWords);
+        DataCodec::encodeValues(values.data(), n, valueWords);
+
+        const uint32_t header[3] = {n, (uint32_t) timestampWords.size(), (uint32_t) valueWords.size()};
+
+        valid = writeData(file, header, sizeof(header)) &&
+                writeData(file, timestampWords.data(), timestampWords.size() * sizeof(uint64_t)) &&
+                writeData(file, valueWords.data(), valueWords.size() * sizeof(uint64_t));
+    }
+
+    return valid;
+}
+
+
+/*
+ * Read the chunks of a sample section, passing the samples of each chunk to the callback
+ * as callback(timestamps, values, n). Returns false if the section is invalid.
+ */
+template<typename Callback>
+static bool readChunks(QIODevice& file, uint64_t count, Callback callback)
+{
+    std::vector<uint64_t> timestampWords;
+    std::vector<uint64_t> valueWords;
+
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    uint64_t loaded = 0;
+
+    while (loaded < count)
+    {
+        uint32_t header[3] = {0, 0, 0};
+
+        bool valid = SeriesFile::readData(file, header, sizeof(header));
+
+        const uint32_t n = header[0];
+
+        // Each sample is encoded in (much) less than two words
+        valid = valid && n > 0 && n <= SeriesFile::CHUNK_SAMPLES && loaded + n <= count &&
+                header[1] <= 2 * n + 2 && header[2] <= 2 * n + 2;
+
+        if (valid)
+        {
+            timestampWords.resize(header[1]);
+            valueWords.resize(header[2]);
+
+            valid = SeriesFile::readData(file, timestampWords.data(), header[1] * sizeof(uint64_t)) &&
+                    SeriesFile::readData(file, valueWords.data(), header[2] * sizeof(uint64_t));
+        }
+
+        if (!valid) return false;
+
+        timestamps.resize(n);
+        values.resize(n);
+
+        DataCodec::decodeTimestamps(timestampWords, n, timestamps.data());
+        DataCodec::decodeValues(valueWords, n, values.data());
+
+        callback(timestamps, values, n);
+
+        loaded += n;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief SeriesFile::readSamples - Read samples written by writeSamples
+ * @param file is positioned at the start of the sample section
+ * @param output receives the samples (any existing samples are discarded)
+ * @return true if every sample was read (otherwise the output is left empty)
+ */
+bool SeriesFile::readSamples(QIODevice& file, DataSeries& output)
+{
+    uint64_t count = 0;
+
+    if (!readData(file, &count, sizeof(count))) return false;
+
+    output.clearData(false);
+
+    const bool valid = readChunks(file, count, [&output](const std::vector<double>& t, const std::vector<double>& v, uint32_t) {
+        output.addData(t, v, false);
+    });
+
+    if (!valid)
+    {
+        output.clearData(false);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief SeriesFile::readSamples - Read samples written by writeSamples into columns (e.g. for DataSeries::Loader)
+ * @param file is positioned at the start of the sample section
+ * @return true if every sample was read (otherwise the columns are left empty)
+ */
+bool SeriesFile::readSamples(QIODevice& file, std::vector<double>& timestamps, std::vector<double>& values)
+{
+    uint64_t count = 0;
+
+    timestamps.clear();
+    values.clear();
+
+    if (!readData(file, &count, sizeof(count))) return false;
+
+    // Each sample is encoded in at least one bit, so a corrupt count cannot reserve more than 64 samples per byte
+    if (count / 64 > (uint64_t) file.size()) return false;
+
+    timestamps.reserve(count);
+    values.reserve(count);
+
+    const bool valid = readChunks(file, count, [&](const std::vector<double>& t, const std::vector<double>& v, uint32_t n) {
+        timestamps.insert(timestamps.end(), t.begin(), t.begin() + n);
+        values.insert(values.end(), v.begin(), v.begin() + n);
+    });
+
+    if (!valid)
+    {
+        timestamps.clear();
+        values.clear();
+        return false;
+    }
+
+    return true;
+}
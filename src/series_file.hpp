@@ -0,0 +1,37 @@
+#ifndef SERIES_FILE_HPP
+#define SERIES_FILE_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <QIODevice>
+
+#include "data_series.hpp"
+
+
+/**
+ * @brief The SeriesFile class reads and writes the samples of a series, compressed with DataCodec
+ *
+ * Samples are stored in chunks of CHUNK_SAMPLES:
+ *
+ *   sample count (uint64)
+ *   then for each chunk: samples (uint32) | timestamp words (uint32) | value words (uint32) | words...
+ *
+ * This is the sample section of each cache file (see MathTraceCache and ImportCache).
+ */
+class SeriesFile
+{
+public:
+    //! Samples per compressed chunk
+    static const uint32_t CHUNK_SAMPLES = 1 << 16;
+
+    static bool writeSamples(QIODevice& file, const DataSnapshot& snapshot);
+    static bool readSamples(QIODevice& file, DataSeries& output);
+    static bool readSamples(QIODevice& file, std::vector<double>& timestamps, std::vector<double>& values);
+
+    static bool writeData(QIODevice& file, const void* data, qint64 bytes);
+    static bool readData(QIODevice& file, void* data, qint64 bytes);
+};
+
+#endif // SERIES_FILE_HPP
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <iterator>
+
+#include <QRegularExpression>
+
+#include "series_search_index.hpp"
+
+
+void SeriesSearchIndex::clear()
+{
+    entries.clear();
+    postings.clear();
+}
+
+
+SeriesSearchIndex::Trigram SeriesSearchIndex::getTrigram(const QChar *chars)
+{
+    return ((Trigram) chars[0].unicode() << 32) | ((Trigram) chars[1].unicode() << 16) | (Trigram) chars[2].unicode();
+}
+
+
+/*
+ * Add each trigram of the text to the index (the entry is added once to each posting list)
+ */
+void SeriesSearchIndex::indexText(const QString &text, uint32_t entry)
+{
+    for (int ii = 0; ii + 3 <= text.length(); ii++)
+    {
+        auto &posting = postings[getTrigram(text.constData() + ii)];
+
+        if (posting.empty() || posting.back() != entry)
+        {
+            posting.push_back(entry);
+        }
+    }
+}
+
+
+void SeriesSearchIndex::append(const QString &label, const QString &group)
+{
+    Entry entry;
+
+    entry.label = label;
+    entry.text = label.toLower();
+    entry.group = group.toLower();
+
+    const uint32_t idx = (uint32_t) entries.size();
+
+    indexText(entry.text, idx);
+    indexText(entry.group, idx);
+
+    entries.push_back(entry);
+}
+
+
+QStringList SeriesSearchIndex::getPatterns(const QString &filter)
+{
+    QStringList patterns;
+
+    for (QString pattern : filter.trimmed().split(" "))
+    {
+        // An empty pattern matches every series
+        if (pattern.isEmpty()) continue;
+
+        if (!pattern.startsWith("*"))
+        {
+            pattern.prepend("*");
+        }
+
+        if (!pattern.endsWith("*"))
+        {
+            pattern.append("*");
+        }
+
+        patterns.append(pattern);
+    }
+
+    return patterns;
+}
+
+
+/*
+ * Return the entries which contain every trigram of the literal parts of a (lower case) pattern,
+ * or every entry if the pattern has no literal part of three or more characters
+ */
+std::vector<uint32_t> SeriesSearchIndex::getCandidates(const QString &pattern) const
+{
+    std::vector<uint32_t> candidates;
+    bool pruned = false;
+
+    // Character classes (e.g. [abc]) are not indexed
+    if (!pattern.contains('['))
+    {
+        static const QRegularExpression wildcards("[*?]");
+
+        for (const QString &literal : pattern.split(wildcards, Qt::SkipEmptyParts))
+        {
+            for (int ii = 0; ii + 3 <= literal.length(); ii++)
+            {
+                auto it = postings.find(getTrigram(literal.constData() + ii));
+
+                // A trigram which does not occur in any series
+                if (it == postings.end()) return std::vector<uint32_t>();
+
+                if (!pruned)
+                {
+                    candidates = it->second;
+                    pruned = true;
+                }
+                else
+                {
+                    std::vector<uint32_t> common;
+
+                    std::set_intersection(candidates.begin(), candidates.end(), it->second.begin(), it->second.end(), std::back_inserter(common));
+
+                    candidates.swap(common);
+                }
+
+                if (candidates.empty()) return candidates;
+            }
+        }
+    }
+
+    if (!pruned)
+    {
+        candidates.resize(entries.size());
+
+        for (uint32_t ii = 0; ii < (uint32_t) entries.size(); ii++)
+        {
+            candidates[ii] = ii;
+        }
+    }
+
+    return candidates;
+}
+
+
+/**
+ * @brief SeriesSearchIndex::search - Return the labels of the series which match every pattern of the filter
+ * @param filter - Space separated wildcard patterns (an empty filter matches every series)
+ */
+QStringList SeriesSearchIndex::search(const QString &filter) const
+{
+    QStringList labels;
+
+    const QStringList patterns = getPatterns(filter.toLower());
+
+    if (patterns.isEmpty())
+    {
+        for (const auto &entry : entries)
+        {
+            labels.append(entry.label);
+        }
+
+        return labels;
+    }
+
+    std::vector<uint32_t> candidates;
+
+    struct Matcher
+    {
+        //! Pattern without the surrounding wildcards (if it has no other wildcards)
+        QString literal;
+
+        QRegularExpression regex;
+    };
+
+    std::vector<Matcher> matchers;
+
+    for (int idx = 0; idx < patterns.count(); idx++)
+    {
+        const QString &pattern = patterns.at(idx);
+
+        std::vector<uint32_t> matches = getCandidates(pattern);
+
+        if (idx == 0)
+        {
+            candidates.swap(matches);
+        }
+        else
+        {
+            std::vector<uint32_t> common;
+
+            std::set_intersection(candidates.begin(), candidates.end(), matches.begin(), matches.end(), std::back_inserter(common));
+
+            candidates.swap(common);
+        }
+
+        Matcher matcher;
+
+        const QString core = pattern.mid(1, pattern.length() - 2);
+
+        if (core.contains('*') || core.contains('?') || core.contains('['))
+        {
+            matcher.regex = QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern), QRegularExpression::CaseInsensitiveOption);
+        }
+        else
+        {
+            matcher.literal = core;
+        }
+
+        matchers.push_back(matcher);
+    }
+
+    // Each candidate contains the trigrams of every pattern, but may not match
+    for (uint32_t idx : candidates)
+    {
+        const Entry &entry = entries[idx];
+
+        bool matches_all = true;
+
+        for (const auto &matcher : matchers)
+        {
+            bool match;
+
+            if (matcher.regex.pattern().isEmpty())
+            {
+                match = entry.text.contains(matcher.literal) || entry.group.contains(matcher.literal);
+            }
+            else
+            {
+                match = matcher.regex.match(entry.text).hasMatch() || matcher.regex.match(entry.group).hasMatch();
+            }
+
+            if (!match)
+            {
+                matches_all = false;
+                break;
+            }
+        }
+
+        if (matches_all)
+        {
+            labels.append(entry.label);
+        }
+    }
+
+    return labels;
+}
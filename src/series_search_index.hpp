@@ -0,0 +1,64 @@
+#ifndef SERIES_SEARCH_INDEX_HPP
+#define SERIES_SEARCH_INDEX_HPP
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+
+/**
+ * @brief The SeriesSearchIndex class finds the series (of a source) which match a filter string.
+ *
+ * The filter is a list of space separated wildcard patterns (e.g. "gps* alt"), each of which may match
+ * anywhere within the label or the group of a series (case insensitive). A series matches the filter
+ * if it matches every pattern.
+ *
+ * The labels and groups are indexed by trigram, so that only the series which contain every trigram
+ * of the literal parts of each pattern are tested against the pattern. The index is built once
+ * (see DataSource::getSeriesLabels), rather than for each filter.
+ */
+class SeriesSearchIndex
+{
+public:
+    void clear(void);
+
+    //! Add a series (series are returned in the order they were added)
+    void append(const QString &label, const QString &group = QString());
+
+    int size(void) const { return (int) entries.size(); }
+
+    QStringList search(const QString &filter) const;
+
+    //! Split a filter string into patterns (wildcards are added at each end of each pattern)
+    static QStringList getPatterns(const QString &filter);
+
+protected:
+    struct Entry
+    {
+        QString label;
+
+        //! Lower case label and group
+        QString text;
+        QString group;
+    };
+
+    typedef uint64_t Trigram;
+
+    static Trigram getTrigram(const QChar *chars);
+
+    void indexText(const QString &text, uint32_t entry);
+
+    std::vector<uint32_t> getCandidates(const QString &pattern) const;
+
+    std::vector<Entry> entries;
+
+    //! Entries (in order) which contain each trigram
+    std::unordered_map<Trigram, std::vector<uint32_t>> postings;
+};
+
+
+#endif // SERIES_SEARCH_INDEX_HPP
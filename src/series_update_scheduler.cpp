@@ -0,0 +1,105 @@
+#include <QCoreApplication>
+#include <QThread>
+
+#include "series_update_scheduler.hpp"
+#include "data_series.hpp"
+
+
+SeriesUpdateScheduler* SeriesUpdateScheduler::instance = nullptr;
+
+const int SeriesUpdateScheduler::NOTIFY_INTERVAL;
+
+
+SeriesUpdateScheduler::SeriesUpdateScheduler() : QObject()
+{
+    // The scheduler may first be requested by an import thread, but notifications are delivered in the GUI thread
+    if (QCoreApplication::instance())
+    {
+        moveToThread(QCoreApplication::instance()->thread());
+        notifyTimer.moveToThread(QCoreApplication::instance()->thread());
+    }
+
+    notifyTimer.setSingleShot(true);
+    notifyElapsed.start();
+
+    connect(&notifyTimer, &QTimer::timeout, this, &SeriesUpdateScheduler::notifyAll);
+}
+
+
+/*
+ * Notify the series of its changes at the next interval (requests made before then are coalesced).
+ * A series which is already queued returns immediately, without taking the pending mutex.
+ */
+void SeriesUpdateScheduler::requestUpdate(DataSeries* series)
+{
+    if (series == nullptr) return;
+
+    if (series->updateQueued.exchange(true)) return;
+
+    pending_mutex.lock();
+
+    pending.append(QPointer<DataSeries>(series));
+
+    const bool start = !scheduled;
+    scheduled = true;
+
+    pending_mutex.unlock();
+
+    if (!start) return;
+
+    if (QThread::currentThread() == thread())
+    {
+        scheduleNotify();
+    }
+    else
+    {
+        // The timer can only be started from its own thread
+        QMetaObject::invokeMethod(this, "scheduleNotify", Qt::QueuedConnection);
+    }
+}
+
+
+int SeriesUpdateScheduler::getPendingCount() const
+{
+    QMutexLocker lock(&pending_mutex);
+
+    return pending.count();
+}
+
+
+void SeriesUpdateScheduler::scheduleNotify()
+{
+    if (notifyTimer.isActive()) return;
+
+    const qint64 remaining = NOTIFY_INTERVAL - notifyElapsed.elapsed();
+
+    notifyTimer.start(remaining > 0 ? (int) remaining : 0);
+}
+
+
+void SeriesUpdateScheduler::notifyAll()
+{
+    notifyTimer.stop();
+    notifyElapsed.restart();
+
+    // Series which are updated while the notifications are delivered are queued for the next interval
+    pending_mutex.lock();
+
+    QList<QPointer<DataSeries>> series;
+    series.swap(pending);
+
+    scheduled = false;
+
+    pending_mutex.unlock();
+
+    for (auto& s : series)
+    {
+        if (!s.isNull())
+        {
+            // Cleared (by exchange) before the changes are read, so an update which finds the series still queued
+            // has already recorded its changes
+            s->updateQueued.exchange(false);
+            s->notifyChanged();
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SERIES_UPDATE_SCHEDULER_HPP
+#define SERIES_UPDATE_SCHEDULER_HPP
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class DataSeries;
+
+
+/*
+ * Coalesces the change notifications of every series.
+ *
+ * A series which is appended to one sample at a time (e.g. while live data are received) is updated
+ * far more often than it can usefully be resampled or re-drawn. Each update queues the series (at most
+ * once), and queued series are notified together (see DataSeries::dataChanged) at most once per
+ * NOTIFY_INTERVAL, with the interval of the samples which changed in the meantime.
+ *
+ * Series may be updated from any thread: notifications are always delivered in the thread of the scheduler.
+ */
+class SeriesUpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+    static SeriesUpdateScheduler* instance;
+
+public:
+    SeriesUpdateScheduler();
+
+    // Singleton design pattern
+    static SeriesUpdateScheduler* getInstance()
+    {
+        if (!instance)
+        {
+            instance = new SeriesUpdateScheduler;
+        }
+
+        return instance;
+    }
+
+    static void cleanup()
+    {
+        if (instance)
+        {
+            delete instance;
+            instance = nullptr;
+        }
+    }
+
+    //! Minimum interval between notifications (ms), i.e. at most ~30 notifications per second
+    static const int NOTIFY_INTERVAL = 33;
+
+    void requestUpdate(DataSeries* series);
+
+    //! Number of series waiting to be notified
+    int getPendingCount(void) const;
+
+public slots:
+    //! Notify every queued series now (rather than waiting for the next interval)
+    void notifyAll(void);
+
+protected slots:
+    void scheduleNotify(void);
+
+protected:
+    //! Series waiting to be notified, each at most once (see DataSeries::updateQueued).
+    //! Destroyed series are skipped (pending mutex must be held)
+    QList<QPointer<DataSeries>> pending;
+
+    mutable QMutex pending_mutex;
+
+    //! Set when a notification has been requested, but not yet delivered (pending mutex must be held)
+    bool scheduled = false;
+
+    QTimer notifyTimer;
+
+    //! Time since the previous notification
+    QElapsedTimer notifyElapsed;
+};
+
+#endif // SERIES_UPDATE_SCHEDULER_HPP
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include "parallel_for.hpp"
+#include "spectrogram_sampler.hpp"
+#include "trace_recorder.hpp"
+
+
+const unsigned int SpectrogramUpdater::FRAME_SIZE;
+const unsigned int SpectrogramUpdater::MAX_FRAMES;
+const size_t SpectrogramUpdater::MAX_CACHED_FRAMES;
+const unsigned int SpectrogramUpdater::FRAMES_PER_TASK;
+
+
+SpectrogramUpdater::SpectrogramUpdater(DataSeries &data_series) : PlotCurveUpdater(data_series)
+{
+    qRegisterMetaType<SpectrogramFramesPointer>("SpectrogramFramesPointer");
+}
+
+
+/*
+ * A running request uses the frame cache, so it must finish before the members are destroyed
+ * (the base class destructor runs too late)
+ */
+SpectrogramUpdater::~SpectrogramUpdater()
+{
+    cancelRequests();
+    waitForRequests();
+}
+
+
+/*
+ * Compute the frames covering the specified timespan (n_pixels limits the number of frames).
+ * Frames which have already been computed (at the same frame spacing) are re-used.
+ */
+void SpectrogramUpdater::updateCurveSamples(double t_min, double t_max, unsigned int n_pixels)
+{
+    TRACE_SCOPE("Spectrogram", "fft");
+
+    QMutexLocker lock(&mutex);
+
+    auto frames = std::make_shared<SpectrogramFrames>();
+
+    const auto snapshot = series.getSnapshot();
+
+    if (snapshot.size() < FRAME_SIZE || t_max <= t_min)
+    {
+        emit framesComplete(frames);
+        return;
+    }
+
+    // The frame grid is determined by the sample period, so it is only estimated once
+    if (sample_dt <= 0 || frameCache.empty())
+    {
+        sample_dt = (snapshot.getTimestamp(snapshot.size() - 1) - snapshot.getTimestamp(0)) / (snapshot.size() - 1);
+    }
+
+    if (!(sample_dt > 0))
+    {
+        emit framesComplete(frames);
+        return;
+    }
+
+    // Frames overlap by half, unless the view is zoomed out too far to display every frame
+    const unsigned int n_target = (n_pixels > 0 && n_pixels < MAX_FRAMES) ? n_pixels : MAX_FRAMES;
+
+    double hop = sample_dt * FRAME_SIZE / 2;
+
+    while ((t_max - t_min) / hop > n_target)
+    {
+        hop *= 2;
+    }
+
+    const int w = window.load();
+
+    updateFrameCache(snapshot, hop, w);
+
+    const int64_t k_first = (int64_t) std::floor(t_min / hop);
+    const int64_t k_last = (int64_t) std::ceil(t_max / hop);
+
+    // Only frames which are not yet cached are computed
+    std::vector<int64_t> missing;
+
+    for (int64_t k = k_first; k <= k_last; k++)
+    {
+        if (frameCache.find(k) == frameCache.end()) missing.push_back(k);
+    }
+
+    if (!missing.empty())
+    {
+        const auto plan = FFTEngine::getRealPlan(FRAME_SIZE);
+        const auto coefficients = FFTEngine::getWindowCoefficients(w, FRAME_SIZE);
+
+        std::vector<std::vector<float>> results(missing.size());
+
+        const size_t n_tasks = (missing.size() + FRAMES_PER_TASK - 1) / FRAMES_PER_TASK;
+
+        parallelFor(n_tasks, [&](size_t task) {
+            const size_t end = std::min<size_t>(missing.size(), (task + 1) * FRAMES_PER_TASK);
+
+            for (size_t idx = task * FRAMES_PER_TASK; idx < end; idx++)
+            {
+                if (isSuperseded()) return;
+
+                // A frame which cannot be computed (too close to either end of the series) is cached as empty
+                if (!computeFrame(snapshot, missing[idx], *plan, coefficients, results[idx]))
+                {
+                    results[idx].clear();
+                }
+            }
+        }, getThreadPool());
+
+        // Frames computed by an abandoned pass are discarded (some may be incomplete)
+        if (isSuperseded()) return;
+
+        for (size_t idx = 0; idx < missing.size(); idx++)
+        {
+            if (!results[idx].empty()) computedFrames++;
+
+            frameCache[missing[idx]].swap(results[idx]);
+        }
+    }
+
+    frames->first = k_first;
+    frames->hop = hop;
+    frames->f_max = 0.5 / sample_dt;
+    frames->n_frames = k_last - k_first + 1;
+    frames->n_bins = FRAME_SIZE / 2 + 1;
+    frames->values.assign(frames->n_frames * frames->n_bins, std::numeric_limits<float>::quiet_NaN());
+
+    float v_min = std::numeric_limits<float>::max();
+    float v_max = std::numeric_limits<float>::lowest();
+
+    for (size_t frame = 0; frame < frames->n_frames; frame++)
+    {
+        const auto& values = frameCache[k_first + frame];
+
+        if (values.empty()) continue;
+
+        std::copy(values.begin(), values.end(), frames->values.begin() + frame * frames->n_bins);
+
+        for (float value : values)
+        {
+            v_min = std::min(v_min, value);
+            v_max = std::max(v_max, value);
+        }
+    }
+
+    if (v_min <= v_max)
+    {
+        frames->minValue = v_min;
+        frames->maxValue = v_max;
+    }
+
+    trimFrameCache((k_first + k_last) / 2);
+
+    // A newer request is waiting
+    if (isSuperseded()) return;
+
+    emit framesComplete(frames);
+}
+
+
+/**
+ * @brief SpectrogramUpdater::computeFrame - Compute the power spectrum (in dB) of a single frame
+ * @param snapshot contains the samples
+ * @param frame is the grid index of the frame (the frame is centred at frame * hop)
+ * @param plan is the transform for FRAME_SIZE samples
+ * @param coefficients are the window coefficients
+ * @param output is set to the power of each bin
+ * @return false if there are not enough samples around the frame centre
+ */
+bool SpectrogramUpdater::computeFrame(const DataSnapshot& snapshot, int64_t frame, const RealFFTPlan& plan,
+                                      const std::vector<double>& coefficients, std::vector<float>& output) const
+{
+    const uint64_t half = FRAME_SIZE / 2;
+    const uint64_t center = snapshot.lowerBound(frame * hop_latest);
+
+    if (center < half || center + half > snapshot.size()) return false;
+
+    std::vector<double> samples(FRAME_SIZE);
+
+    snapshot.getView(center - half, center + half).copyValues(samples.data());
+
+    // The mean is removed, so that the DC component does not leak into the lowest bins
+    double mean = 0;
+
+    for (double value : samples) mean += value;
+
+    mean /= FRAME_SIZE;
+
+    for (double& value : samples) value -= mean;
+
+    std::vector<double> power(plan.getBinCount(), 0);
+    std::vector<FFTComplex> bins;
+
+    FFTEngine::accumulatePower(plan, samples.data(), coefficients, bins, power.data());
+
+    // Power is scaled such that a sinusoid of amplitude A (at the centre of a bin) is A^2 / 4
+    double gain = 0;
+
+    for (double value : coefficients) gain += value;
+
+    const double scale = gain > 0 ? 1.0 / (gain * gain) : 1.0;
+
+    output.resize(power.size());
+
+    for (size_t k = 0; k < power.size(); k++)
+    {
+        output[k] = (float) (10 * std::log10(std::max(power[k] * scale, 1e-30)));
+    }
+
+    return true;
+}
+
+
+/*
+ * Discard any cached frames which are no longer valid: the spacing, window or scaling of the frames has changed,
+ * or the samples around the frame have changed (e.g. the oldest samples have been discarded).
+ */
+void SpectrogramUpdater::updateFrameCache(const DataSnapshot& snapshot, double hop, int w)
+{
+    const bool compatible = hop == hop_latest && w == window_latest &&
+                            snapshot.getScaler() == snapshot_latest.getScaler() &&
+                            snapshot.getOffset() == snapshot_latest.getOffset();
+
+    uint64_t idx_first = 0;
+    uint64_t idx_last = 0;
+
+    if (!compatible || !snapshot.getCommonRange(snapshot_latest, idx_first, idx_last) || idx_last - idx_first <= 2 * FRAME_SIZE)
+    {
+        frameCache.clear();
+    }
+    else if (!snapshot.isIdentical(snapshot_latest))
+    {
+        // Frames which lie strictly within the common range are unchanged
+        const double t_first = snapshot.getTimestamp(idx_first + FRAME_SIZE);
+        const double t_last = snapshot.getTimestamp(idx_last - 1 - FRAME_SIZE);
+
+        for (auto it = frameCache.begin(); it != frameCache.end();)
+        {
+            const double t = it->first * hop;
+
+            if (t < t_first || t > t_last)
+            {
+                it = frameCache.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+    snapshot_latest = snapshot;
+    hop_latest = hop;
+    window_latest = w;
+}
+
+
+/*
+ * Discard the cached frames furthest from the specified frame, to limit memory use
+ */
+void SpectrogramUpdater::trimFrameCache(int64_t center)
+{
+    while (frameCache.size() > MAX_CACHED_FRAMES)
+    {
+        auto first = frameCache.begin();
+        auto last = std::prev(frameCache.end());
+
+        if (center - first->first > last->first - center)
+        {
+            frameCache.erase(first);
+        }
+        else
+        {
+            frameCache.erase(last);
+        }
+    }
+}
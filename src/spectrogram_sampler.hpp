@@ -0,0 +1,119 @@
+#ifndef SPECTROGRAM_SAMPLER_HPP
+#define SPECTROGRAM_SAMPLER_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "fft_engine.hpp"
+#include "plot_sampler.hpp"
+
+
+/**
+ * @brief The SpectrogramFrames struct holds the short-time spectra covering a view.
+ *
+ * Frame k is centred at (first + k) * hop, and each frame holds the power (in dB) of
+ * bins evenly spaced from zero to f_max. Missing frames (e.g. at the ends of the series) are NaN.
+ * Once published (see SpectrogramUpdater::framesComplete) the frames are not modified.
+ */
+struct SpectrogramFrames
+{
+    //! Grid index of the first frame
+    int64_t first = 0;
+
+    //! Time between frame centres
+    double hop = 0;
+
+    //! Frequency of the last bin (Nyquist frequency)
+    double f_max = 0;
+
+    size_t n_frames = 0;
+    size_t n_bins = 0;
+
+    //! Power of each bin, frame by frame
+    std::vector<float> values;
+
+    //! Range of the (finite) values
+    float minValue = 0;
+    float maxValue = 0;
+
+    bool isEmpty(void) const { return n_frames == 0 || n_bins == 0; }
+
+    double getFrameTime(int64_t frame) const { return (first + frame) * hop; }
+
+    float getValue(size_t frame, size_t bin) const { return values[frame * n_bins + bin]; }
+};
+
+typedef std::shared_ptr<const SpectrogramFrames> SpectrogramFramesPointer;
+
+Q_DECLARE_METATYPE(SpectrogramFramesPointer)
+
+
+/*
+ * Curve updater which computes a short-time Fourier transform (STFT) of the visible samples.
+ *
+ * Frames are aligned to a fixed time grid, and retained between requests: when the view is panned
+ * only the newly exposed frames are computed. Frames are computed in parallel (see parallelFor).
+ */
+class SpectrogramUpdater : public PlotCurveUpdater
+{
+    Q_OBJECT
+
+public:
+    SpectrogramUpdater(DataSeries &data_series);
+    virtual ~SpectrogramUpdater();
+
+    //! Number of samples transformed by each frame
+    static const unsigned int FRAME_SIZE = 1024;
+
+    //! Maximum number of frames in a view (frames are spaced further apart as the view is zoomed out)
+    static const unsigned int MAX_FRAMES = 2048;
+
+    //! Frames retained for panning
+    static const size_t MAX_CACHED_FRAMES = 4 * MAX_FRAMES;
+
+    //! Number of frames computed by each parallel task
+    static const unsigned int FRAMES_PER_TASK = 16;
+
+    int getWindow(void) const { return window.load(); }
+    void setWindow(int w) { window.store(w); }
+
+    //! Total number of frames computed (cached frames are not counted)
+    uint64_t getComputedFrameCount(void) const { return computedFrames.load(); }
+
+public slots:
+    virtual void updateCurveSamples(double t_min, double t_max, unsigned int n_pixels) override;
+
+signals:
+    void framesComplete(SpectrogramFramesPointer frames);
+
+protected:
+    //! Spectra are not resampled from pixel columns
+    virtual bool isPrefetchSupported(void) const override { return false; }
+
+    bool computeFrame(const DataSnapshot& snapshot, int64_t frame, const RealFFTPlan& plan,
+                      const std::vector<double>& coefficients, std::vector<float>& output) const;
+
+    void updateFrameCache(const DataSnapshot& snapshot, double hop, int w);
+    void trimFrameCache(int64_t center);
+
+    std::atomic<int> window{FFTEngine::WINDOW_HANN};
+
+    //! Estimated sample period (from the entire series), which determines the frame grid
+    double sample_dt = 0;
+
+    //! Samples from which the cached frames were computed
+    DataSnapshot snapshot_latest;
+
+    double hop_latest = 0;
+    int window_latest = -1;
+
+    //! Computed frames (by grid index)
+    std::map<int64_t, std::vector<float>> frameCache;
+
+    std::atomic<uint64_t> computedFrames{0};
+};
+
+
+#endif // SPECTROGRAM_SAMPLER_HPP
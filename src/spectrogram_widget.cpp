@@ -0,0 +1,245 @@
+#include <cmath>
+
+#include <QMimeData>
+#include <QDebug>
+#include <qnumeric.h>
+
+#include <qwt_scale_widget.h>
+#include <qwt_text.h>
+
+#include "data_source_manager.hpp"
+#include "lumberjack_settings.hpp"
+#include "plot_scheduler.hpp"
+#include "spectrogram_widget.hpp"
+
+
+const double SpectrogramWidget::DYNAMIC_RANGE = 80;
+
+
+SpectrogramRasterData::SpectrogramRasterData(SpectrogramFramesPointer f, const QwtInterval& range) :
+    frames(f),
+    valueRange(range)
+{
+}
+
+
+QwtInterval SpectrogramRasterData::interval(Qt::Axis axis) const
+{
+    switch (axis)
+    {
+    case Qt::XAxis:
+        // Each frame covers half a frame spacing either side of the frame centre
+        return QwtInterval(frames->getFrameTime(0) - frames->hop / 2, frames->getFrameTime(frames->n_frames - 1) + frames->hop / 2);
+    case Qt::YAxis:
+        return QwtInterval(0, frames->f_max);
+    default:
+        return valueRange;
+    }
+}
+
+
+/*
+ * Return the power of the nearest frame and bin (NaN is not drawn)
+ */
+double SpectrogramRasterData::value(double x, double y) const
+{
+    const double frame = std::floor(x / frames->hop + 0.5) - frames->first;
+    const double bin = std::floor(y / frames->f_max * (frames->n_bins - 1) + 0.5);
+
+    if (frame < 0 || frame >= frames->n_frames || bin < 0 || bin >= frames->n_bins)
+    {
+        return qQNaN();
+    }
+
+    return frames->getValue((size_t) frame, (size_t) bin);
+}
+
+
+SpectrogramWidget::SpectrogramWidget() : QwtPlot()
+{
+    auto label = axisTitle(QwtPlot::yLeft);
+    auto font = label.font();
+
+    font.setPointSize(8);
+    label.setFont(font);
+    label.setText("Frequency [Hz]");
+
+    setAxisTitle(QwtPlot::yLeft, label);
+
+    spectrogram = new QwtPlotSpectrogram();
+
+    // Rendering of the image is also split across threads
+    spectrogram->setRenderThreadCount(0);
+    spectrogram->attach(this);
+
+    // Colour bar (dB) on the right axis
+    enableAxis(QwtPlot::yRight, true);
+    axisWidget(QwtPlot::yRight)->setColorBarEnabled(true);
+
+    setAcceptDrops(true);
+    setMinimumSize(200, 100);
+}
+
+
+SpectrogramWidget::~SpectrogramWidget()
+{
+    // The updater must not emit while (or after) the widget is destroyed
+    delete updater;
+}
+
+
+/*
+ * Select the series to display (replacing any previous series)
+ */
+void SpectrogramWidget::setSeries(DataSeriesPointer s)
+{
+    delete updater;
+    updater = nullptr;
+
+    series = s;
+
+    if (series.isNull())
+    {
+        spectrogram->setVisible(false);
+        setTitle(QString());
+        PlotReplotScheduler::getInstance()->requestReplot(this);
+        return;
+    }
+
+    setTitle(series->getLabel());
+
+    updater = new SpectrogramUpdater(*series);
+    updater->setWindow(LumberjackSettings::getInstance()->loadSetting("fft", "window", FFTEngine::WINDOW_HANN).toInt());
+
+    connect(updater, &SpectrogramUpdater::framesComplete, this, &SpectrogramWidget::onFramesComplete, Qt::QueuedConnection);
+
+    requestFrames();
+}
+
+
+void SpectrogramWidget::removeSeries(DataSeriesPointer s)
+{
+    if (!s.isNull() && s == series)
+    {
+        setSeries(DataSeriesPointer());
+    }
+}
+
+
+/*
+ * Update the spectrogram timespan when the visible interval changes
+ */
+void SpectrogramWidget::updateInterval(const QwtInterval &interval)
+{
+    timestamp_min = interval.minValue();
+    timestamp_max = interval.maxValue();
+
+    requestFrames();
+}
+
+
+void SpectrogramWidget::requestFrames()
+{
+    if (!updater || !isVisible()) return;
+
+    // At most one frame per pixel column
+    updater->requestCurveSamples(timestamp_min, timestamp_max, canvas()->width());
+}
+
+
+void SpectrogramWidget::onFramesComplete(SpectrogramFramesPointer frames)
+{
+    if (!frames || frames->isEmpty())
+    {
+        spectrogram->setVisible(false);
+        PlotReplotScheduler::getInstance()->requestReplot(this);
+        return;
+    }
+
+    const QwtInterval range(frames->maxValue - DYNAMIC_RANGE, frames->maxValue);
+
+    spectrogram->setColorMap(createColorMap());
+    spectrogram->setData(new SpectrogramRasterData(frames, range));
+    spectrogram->setVisible(true);
+
+    // The colour bar requires its own copy of the map
+    axisWidget(QwtPlot::yRight)->setColorMap(range, createColorMap());
+    setAxisScale(QwtPlot::yRight, range.minValue(), range.maxValue());
+
+    setAxisScale(QwtPlot::xBottom, timestamp_min, timestamp_max);
+    setAxisScale(QwtPlot::yLeft, 0, frames->f_max);
+
+    PlotReplotScheduler::getInstance()->requestReplot(this);
+}
+
+
+/*
+ * Colour map from the floor of the dynamic range (black) to the peak power (yellow)
+ */
+QwtColorMap* SpectrogramWidget::createColorMap()
+{
+    auto *colorMap = new QwtLinearColorMap(Qt::black, Qt::yellow);
+
+    colorMap->addColorStop(0.35, Qt::darkBlue);
+    colorMap->addColorStop(0.7, Qt::red);
+
+    return colorMap;
+}
+
+
+void SpectrogramWidget::dragEnterEvent(QDragEnterEvent *event)
+{
+    auto *mime = event->mimeData();
+
+    // DataSeries is being dragged onto this widget
+    if (mime->hasFormat("source") && mime->hasFormat("series"))
+    {
+        event->acceptProposedAction();
+    }
+}
+
+
+void SpectrogramWidget::dropEvent(QDropEvent *event)
+{
+    auto *mime = event->mimeData();
+    auto *manager = DataSourceManager::getInstance();
+
+    if (!mime || !manager) return;
+
+    if (mime->hasFormat("source") && mime->hasFormat("series"))
+    {
+        QString source_lbl = mime->data("source");
+        QString series_lbl = mime->data("series");
+
+        auto s = manager->findSeries(source_lbl, series_lbl);
+
+        if (s.isNull())
+        {
+            qCritical() << "Could not find graph matching" << source_lbl << ":" << series_lbl;
+            return;
+        }
+
+        setSeries(s);
+
+        event->accept();
+    }
+}
+
+
+void SpectrogramWidget::resizeEvent(QResizeEvent *event)
+{
+    QwtPlot::resizeEvent(event);
+
+    requestFrames();
+}
+
+
+/*
+ * Frames are not computed while the widget is hidden
+ */
+void SpectrogramWidget::showEvent(QShowEvent *event)
+{
+    QwtPlot::showEvent(event);
+
+    requestFrames();
+}
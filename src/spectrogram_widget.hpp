@@ -0,0 +1,81 @@
+#ifndef SPECTROGRAM_WIDGET_HPP
+#define SPECTROGRAM_WIDGET_HPP
+
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QResizeEvent>
+#include <QShowEvent>
+
+#include <qwt_color_map.h>
+#include <qwt_interval.h>
+#include <qwt_plot.h>
+#include <qwt_plot_spectrogram.h>
+#include <qwt_raster_data.h>
+
+#include "data_series.hpp"
+#include "spectrogram_sampler.hpp"
+
+
+/*
+ * Raster data which draws the frames of a spectrogram (time on the x axis, frequency on the y axis)
+ */
+class SpectrogramRasterData : public QwtRasterData
+{
+public:
+    SpectrogramRasterData(SpectrogramFramesPointer f, const QwtInterval& range);
+
+    virtual QwtInterval interval(Qt::Axis axis) const override;
+    virtual double value(double x, double y) const override;
+
+protected:
+    SpectrogramFramesPointer frames;
+
+    //! Range of the colour map (dB)
+    QwtInterval valueRange;
+};
+
+
+/*
+ * Displays the short-time spectrum of a single series over the visible timespan.
+ * A series is selected by dropping it onto the widget.
+ */
+class SpectrogramWidget : public QwtPlot
+{
+    Q_OBJECT
+
+public:
+    SpectrogramWidget();
+    virtual ~SpectrogramWidget();
+
+    //! Range of power values (below the peak) which are displayed (dB)
+    static const double DYNAMIC_RANGE;
+
+    void updateInterval(const QwtInterval &interval);
+
+public slots:
+    void setSeries(DataSeriesPointer series);
+    void removeSeries(DataSeriesPointer series);
+
+protected slots:
+    void onFramesComplete(SpectrogramFramesPointer frames);
+
+protected:
+    virtual void dragEnterEvent(QDragEnterEvent *event) override;
+    virtual void dropEvent(QDropEvent *event) override;
+    virtual void resizeEvent(QResizeEvent *event) override;
+    virtual void showEvent(QShowEvent *event) override;
+
+    static QwtColorMap* createColorMap(void);
+
+    void requestFrames(void);
+
+    DataSeriesPointer series;
+    SpectrogramUpdater* updater = nullptr;
+
+    QwtPlotSpectrogram* spectrogram = nullptr;
+
+    double timestamp_min = 0;
+    double timestamp_max = 0;
+};
+
+#endif // SPECTROGRAM_WIDGET_HPP
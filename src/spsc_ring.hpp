@@ -0,0 +1,107 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+
+/**
+ * @brief The SPSCRing class is a bounded, lock-free queue between exactly one producer thread
+ * and exactly one consumer thread (e.g. the network thread of a TelemetrySource, and the GUI thread).
+ *
+ * The capacity is rounded up to a power of two, so that the indices wrap with a mask. The head (written by
+ * the consumer) and the tail (written by the producer) are on separate cache lines, and each side caches the
+ * index of the other, so that a push or pop normally touches no memory which is shared with the other thread.
+ *
+ * A push fails (rather than blocking or overwriting) when the ring is full, and the caller decides what to drop.
+ */
+template<typename T>
+class SPSCRing
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCRing elements must be trivially copyable");
+
+public:
+    SPSCRing(size_t capacity)
+    {
+        size_t n = 2;
+
+        while (n < capacity) n *= 2;
+
+        mask = n - 1;
+        buffer.reset(new T[n]);
+    }
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    size_t capacity(void) const { return mask + 1; }
+
+    //! Number of elements in the ring (approximate, unless called by the producer or the consumer)
+    size_t size(void) const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool empty(void) const { return size() == 0; }
+
+    //! Add an element (producer only), returning false if the ring is full
+    bool push(const T &value)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t - cachedHead > mask)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+
+            if (t - cachedHead > mask) return false;
+        }
+
+        buffer[t & mask] = value;
+
+        tail.store(t + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    //! Remove up to count elements (consumer only), returning the number removed
+    size_t pop(T *output, size_t count)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+
+        if (cachedTail - h < count)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+        }
+
+        const size_t n = std::min(count, cachedTail - h);
+
+        for (size_t ii = 0; ii < n; ii++)
+        {
+            output[ii] = buffer[(h + ii) & mask];
+        }
+
+        head.store(h + n, std::memory_order_release);
+
+        return n;
+    }
+
+protected:
+    size_t mask = 0;
+
+    std::unique_ptr<T[]> buffer;
+
+    //! Index of the next element to pop (written by the consumer), and the consumer's copy of the tail
+    alignas(64) std::atomic<size_t> head {0};
+    size_t cachedTail = 0;
+
+    //! Index of the next element to push (written by the producer), and the producer's copy of the head
+    alignas(64) std::atomic<size_t> tail {0};
+    size_t cachedHead = 0;
+};
+
+
+#endif // SPSC_RING_HPP
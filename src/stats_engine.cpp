@@ -0,0 +1,377 @@
+#include <cmath>
+
+#include <QMetaObject>
+#include <QRunnable>
+
+#include "parallel_for.hpp"
+#include "trace_recorder.hpp"
+
+#include "stats_engine.hpp"
+
+
+/*
+ * Thread pool task which computes the statistics of a single request
+ */
+class StatsTask : public QRunnable
+{
+public:
+    StatsTask(StatsEngine &e, const StatsEngine::Request &r) : engine(e), request(r) {}
+
+    virtual void run() override
+    {
+        engine.runRequest(request);
+    }
+
+protected:
+    StatsEngine &engine;
+    StatsEngine::Request request;
+};
+
+
+StatsEngine::StatsEngine(QObject *parent) : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+
+    m_quantiles = { 0.05, 0.5, 0.95 };
+}
+
+
+StatsEngine::~StatsEngine()
+{
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_mutex.unlock();
+
+    m_pool.waitForDone();
+}
+
+
+void StatsEngine::setQuantiles(const std::vector<double> &q)
+{
+    QMutexLocker lock(&m_mutex);
+
+    m_quantiles = q;
+}
+
+
+std::vector<double> StatsEngine::getQuantiles() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_quantiles;
+}
+
+
+/**
+ * @brief StatsEngine::requestStats - Compute the statistics of each series in the background.
+ * Any request which is still running is cancelled. statsUpdated is emitted once the statistics are available.
+ * @param series - The series (a null series has empty statistics)
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range (inclusive)
+ */
+void StatsEngine::requestStats(const QList<DataSeriesPointer> &series, double t_min, double t_max)
+{
+    Request request;
+
+    // Snapshots are taken immediately, so the statistics describe the series at the time of the request
+    for (const auto &s : series)
+    {
+        request.labels.append(s.isNull() ? QString() : s->getLabel());
+        request.snapshots.append(s.isNull() ? DataSnapshot() : s->getSnapshot());
+        request.memory.append(s.isNull() ? DataMemoryUsage() : s->getMemoryUsage());
+    }
+
+    request.t_min = std::min(t_min, t_max);
+    request.t_max = std::max(t_min, t_max);
+    request.token = std::make_shared<CancellationToken>();
+
+    m_mutex.lock();
+
+    if (m_token) m_token->cancel();
+
+    m_token = request.token;
+    request.id = ++m_requestId;
+    request.quantiles = m_quantiles;
+
+    m_mutex.unlock();
+
+    m_pool.start(new StatsTask(*this, request));
+}
+
+
+QVector<SeriesStats> StatsEngine::getResults() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_results;
+}
+
+
+/**
+ * @brief StatsEngine::isBusy - Determine if the most recent request has not completed
+ */
+bool StatsEngine::isBusy() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    return m_resultId != m_requestId;
+}
+
+
+/*
+ * Compute the statistics of a request (on the thread pool of the engine)
+ */
+void StatsEngine::runRequest(const Request &request)
+{
+    TRACE_SCOPE("Statistics", "stats");
+
+    QVector<SeriesStats> results(request.snapshots.count());
+
+    // Written concurrently (without detaching the vector)
+    SeriesStats *output = results.data();
+
+    // Each series is computed concurrently (the blocks of each series are also sketched concurrently)
+    parallelFor(results.size(), [&](size_t idx) {
+        if (request.token->isCancelled()) return;
+
+        SeriesStats stats = computeStats(request.snapshots[idx], request.t_min, request.t_max, request.quantiles, request.token.get());
+
+        stats.label = request.labels[idx];
+        stats.memory = request.memory[idx];
+
+        output[idx] = stats;
+    }, QThreadPool::globalInstance());
+
+    if (request.token->isCancelled()) return;
+
+    m_mutex.lock();
+
+    m_pending = results;
+    m_pendingId = request.id;
+
+    m_mutex.unlock();
+
+    // The results are published on the thread of the engine
+    QMetaObject::invokeMethod(this, "onRequestComplete", Qt::QueuedConnection);
+}
+
+
+void StatsEngine::onRequestComplete()
+{
+    m_mutex.lock();
+
+    // Results of a superseded request are discarded
+    const bool current = m_pendingId == m_requestId && m_pendingId != m_resultId;
+
+    if (current)
+    {
+        m_results = m_pending;
+        m_resultId = m_pendingId;
+    }
+
+    m_mutex.unlock();
+
+    if (current)
+    {
+        emit statsUpdated();
+    }
+}
+
+
+/**
+ * @brief StatsEngine::computeStats - Compute the statistics of the samples of a snapshot within a time range
+ * @param snapshot - Samples of the series (scaled)
+ * @param t_min - Start of the time range
+ * @param t_max - End of the time range (inclusive)
+ * @param q - Quantiles to estimate
+ * @param token - Optional token which abandons the computation
+ */
+SeriesStats StatsEngine::computeStats(const DataSnapshot &snapshot, double t_min, double t_max, const std::vector<double> &q, const CancellationToken *token)
+{
+    SeriesStats result;
+
+    if (snapshot.isEmpty()) return result;
+
+    const uint64_t first = snapshot.lowerBound(t_min);
+    const uint64_t last = snapshot.upperBound(t_max);
+
+    result.stats = snapshot.getStatistics(first, last);
+
+    if (result.stats.count == 0 || q.empty()) return result;
+
+    // The sketch counts raw values, so cached sketches are valid for any scaling of the series
+    const QuantileSketch sketch = computeSketch(snapshot, first, last, token);
+
+    for (double quantile : q)
+    {
+        // A negative scaler reverses the order of the values
+        const double raw = sketch.getQuantile(snapshot.getScaler() < 0 ? 1 - quantile : quantile);
+
+        result.quantiles.push_back(std::isnan(raw) ? raw : snapshot.applyScaling(raw));
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief StatsEngine::computeSketch - Compute a sketch of the raw values in the index range [idx_first, idx_last).
+ * Cached sketches are used for full blocks, and the blocks are sketched in parallel.
+ */
+QuantileSketch StatsEngine::computeSketch(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last, const CancellationToken *token)
+{
+    QuantileSketch total;
+
+    idx_last = std::min<uint64_t>(idx_last, snapshot.size());
+
+    if (idx_first >= idx_last) return total;
+
+    const DataBlockTable &table = *snapshot.getTable();
+
+    const size_t firstBlock = table.getBlockForIndex(idx_first);
+    size_t lastBlock = firstBlock;
+
+    while (lastBlock < table.blocks.size() && table.offsets[lastBlock] < idx_last)
+    {
+        lastBlock++;
+    }
+
+    std::vector<std::shared_ptr<const QuantileSketch>> sketches(lastBlock - firstBlock);
+
+    parallelFor(sketches.size(), [&](size_t idx) {
+        if (token && token->isCancelled()) return;
+
+        const size_t ii = firstBlock + idx;
+
+        const DataBlock &block = *table.blocks[ii];
+        const uint64_t base = table.offsets[ii];
+        const size_t length = table.getBlockLength(ii, snapshot.size());
+
+        // Only the final block can still be growing (a block which is cut off by the next block is not sealed)
+        const bool sealed = ((ii + 1 < table.blocks.size()) || (length >= block.getCapacity())) && length == block.size();
+
+        const size_t a = idx_first > base ? idx_first - base : 0;
+        const size_t b = std::min<uint64_t>(idx_last - base, length);
+
+        if (a == 0 && b == length && sealed)
+        {
+            sketches[idx] = getBlockSketch(table.blocks[ii]);
+            return;
+        }
+
+        auto sketch = std::make_shared<QuantileSketch>();
+
+        const DataBlock::Columns columns = block.getColumns(false);
+
+        if (columns.values)
+        {
+            sketch->add(columns.values + a, b - a);
+        }
+        else
+        {
+            sketch->add(columns.valuesSingle + a, b - a);
+        }
+
+        sketches[idx] = sketch;
+    }, QThreadPool::globalInstance());
+
+    for (const auto &sketch : sketches)
+    {
+        if (sketch) total.merge(*sketch);
+    }
+
+    return total;
+}
+
+
+/*
+ * Return the sketch of every value in a full block (computing it, if it is not cached)
+ */
+std::shared_ptr<const QuantileSketch> StatsEngine::getBlockSketch(const DataBlockPointer &block)
+{
+    m_cacheMutex.lock();
+
+    auto it = m_cache.find(block.get());
+
+    if (it != m_cache.end() && it->second.block.lock() == block)
+    {
+        auto sketch = it->second.sketch;
+
+        m_cacheMutex.unlock();
+
+        return sketch;
+    }
+
+    m_cacheMutex.unlock();
+
+    auto sketch = std::make_shared<QuantileSketch>();
+
+    const DataBlock::Columns columns = block->getColumns(false);
+
+    if (columns.values)
+    {
+        sketch->add(columns.values, block->size());
+    }
+    else
+    {
+        sketch->add(columns.valuesSingle, block->size());
+    }
+
+    m_cacheMutex.lock();
+
+    CachedSketch &cached = m_cache[block.get()];
+
+    cached.block = block;
+    cached.sketch = sketch;
+
+    trimCache();
+
+    m_cacheMutex.unlock();
+
+    return sketch;
+}
+
+
+/*
+ * Discard cached sketches once the cache is full (cache mutex must be held)
+ */
+void StatsEngine::trimCache()
+{
+    if (m_cache.size() <= MAX_CACHED_SKETCHES) return;
+
+    // Sketches of blocks which have been released are discarded first
+    for (auto it = m_cache.begin(); it != m_cache.end();)
+    {
+        if (it->second.block.expired())
+        {
+            it = m_cache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (m_cache.size() > MAX_CACHED_SKETCHES)
+    {
+        m_cache.clear();
+    }
+}
+
+
+size_t StatsEngine::getCachedSketchCount() const
+{
+    QMutexLocker lock(&m_cacheMutex);
+
+    return m_cache.size();
+}
+
+
+void StatsEngine::clearCache()
+{
+    QMutexLocker lock(&m_cacheMutex);
+
+    m_cache.clear();
+}
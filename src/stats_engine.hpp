@@ -0,0 +1,133 @@
+#ifndef STATS_ENGINE_HPP
+#define STATS_ENGINE_HPP
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include "cancellation_token.hpp"
+#include "data_series.hpp"
+#include "quantile_sketch.hpp"
+
+
+/**
+ * @brief The SeriesStats struct holds the statistics of a series, within the range of a request
+ */
+struct SeriesStats
+{
+    QString label;
+
+    //! Count, min, max, mean, standard deviation and RMS (see DataSnapshot::getStatistics)
+    DataSnapshot::Statistics stats;
+
+    //! Estimate of each requested quantile (see StatsEngine::setQuantiles)
+    std::vector<double> quantiles;
+
+    //! Memory used by the series (when the request was made)
+    DataMemoryUsage memory;
+};
+
+
+/**
+ * @brief The StatsEngine class computes the statistics of a list of series in the background.
+ *
+ * The moment statistics (min, max, mean, std dev, RMS) are read from the block summaries, and the
+ * quantiles are estimated from a QuantileSketch of the values in range. A sketch of each full block
+ * is cached, so only the partial blocks at the ends of the range are scanned when the view changes.
+ *
+ * Each request supersedes (and cancels) any request which is still running, and statsUpdated is
+ * only emitted (on the thread of the engine) for the most recent request.
+ */
+class StatsEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    StatsEngine(QObject *parent = nullptr);
+    virtual ~StatsEngine();
+
+    //! Maximum number of cached block sketches
+    static const size_t MAX_CACHED_SKETCHES = 2048;
+
+    void setQuantiles(const std::vector<double> &q);
+    std::vector<double> getQuantiles(void) const;
+
+    void requestStats(const QList<DataSeriesPointer> &series, double t_min, double t_max);
+
+    //! Statistics of the most recent request which has completed
+    QVector<SeriesStats> getResults(void) const;
+
+    bool isBusy(void) const;
+
+    SeriesStats computeStats(const DataSnapshot &snapshot, double t_min, double t_max, const std::vector<double> &q, const CancellationToken *token = nullptr);
+    QuantileSketch computeSketch(const DataSnapshot &snapshot, uint64_t idx_first, uint64_t idx_last, const CancellationToken *token = nullptr);
+
+    size_t getCachedSketchCount(void) const;
+    void clearCache(void);
+
+signals:
+    void statsUpdated(void);
+
+protected slots:
+    void onRequestComplete(void);
+
+protected:
+    struct Request
+    {
+        uint64_t id = 0;
+
+        QList<QString> labels;
+        QList<DataSnapshot> snapshots;
+        QList<DataMemoryUsage> memory;
+
+        double t_min = 0;
+        double t_max = 0;
+
+        std::vector<double> quantiles;
+
+        CancellationTokenPointer token;
+    };
+
+    friend class StatsTask;
+
+    void runRequest(const Request &request);
+
+    std::shared_ptr<const QuantileSketch> getBlockSketch(const DataBlockPointer &block);
+    void trimCache(void);
+
+    //! Runs one request at a time (a superseded request is cancelled, and returns promptly)
+    QThreadPool m_pool;
+
+    mutable QMutex m_mutex;
+
+    std::vector<double> m_quantiles;
+
+    uint64_t m_requestId = 0;
+    CancellationTokenPointer m_token;
+
+    QVector<SeriesStats> m_results;
+    uint64_t m_resultId = 0;
+
+    //! Completed results, which have not been published yet
+    QVector<SeriesStats> m_pending;
+    uint64_t m_pendingId = 0;
+
+    //! Sketches of full blocks (an entry is stale once its block has been released, and the address re-used)
+    struct CachedSketch
+    {
+        std::weak_ptr<const DataBlock> block;
+        std::shared_ptr<const QuantileSketch> sketch;
+    };
+
+    mutable QMutex m_cacheMutex;
+    std::map<const DataBlock*, CachedSketch> m_cache;
+};
+
+
+#endif // STATS_ENGINE_HPP
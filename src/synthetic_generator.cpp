@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QFile>
+#include <QFileInfo>
+
+#include "parallel_for.hpp"
+#include "text_export_pipeline.hpp"
+
+#include "synthetic_generator.hpp"
+
+
+const uint64_t SyntheticGenerator::CHUNK_ROWS;
+const int SyntheticGenerator::MAVLINK_CHANNELS_PER_MESSAGE;
+
+
+// Salts which separate the random streams of the dataset
+static const uint64_t SALT_TIMELINE = 0x54494d454c494e45ULL;
+static const uint64_t SALT_GAP = 0x4741505357494e44ULL;
+static const uint64_t SALT_VALUE = 0x56414c5545534545ULL;
+static const uint64_t SALT_STEP = 0x535445504c56454cULL;
+
+// ArduPilot (DataFlash) log framing
+static const uint8_t MAVLINK_HEAD_BYTE_1 = 0xA3;
+static const uint8_t MAVLINK_HEAD_BYTE_2 = 0x95;
+static const uint8_t MAVLINK_FORMAT_ID = 128;
+static const int MAVLINK_HEADER_LENGTH = 3;
+static const int MAVLINK_FORMAT_LENGTH = MAVLINK_HEADER_LENGTH + 86;
+
+
+SyntheticGenerator::SyntheticGenerator(const Options &o) : options(o)
+{
+    options.channels = std::max(options.channels, 0);
+}
+
+
+uint64_t SyntheticGenerator::getRowCount() const
+{
+    if (!(options.rate > 0) || !(options.duration > 0)) return 0;
+
+    return (uint64_t) std::llround(options.duration * options.rate);
+}
+
+
+uint64_t SyntheticGenerator::getChunkCount() const
+{
+    return (getRowCount() + CHUNK_ROWS - 1) / CHUNK_ROWS;
+}
+
+
+/**
+ * @brief SyntheticGenerator::generateTimestamps - Generate the timestamps of a chunk of the timeline (shared by every channel)
+ * @param chunk - Index of the chunk
+ * @param timestamps - Set to the timestamps of the chunk (s), omitting those within gaps
+ */
+void SyntheticGenerator::generateTimestamps(uint64_t chunk, std::vector<double> &timestamps) const
+{
+    timestamps.clear();
+
+    const uint64_t rows = getRowCount();
+    const uint64_t first = chunk * CHUNK_ROWS;
+    const uint64_t last = std::min(rows, first + CHUNK_ROWS);
+
+    if (first >= last) return;
+
+    timestamps.reserve(last - first);
+
+    const double period = 1 / options.rate;
+    const bool gaps = options.gapFraction > 0 && options.gapLength > 0;
+
+    uint64_t state = mix(options.seed ^ SALT_TIMELINE) ^ mix(chunk);
+
+    const uint64_t gapSeed = mix(options.seed ^ SALT_GAP);
+
+    for (uint64_t row = first; row < last; row++)
+    {
+        const double nominal = row * period;
+
+        // The jitter is drawn for every row, so the other rows are not affected by the gaps
+        const double jitter = (uniform(state) * 2 - 1) * options.jitter * period;
+
+        if (gaps)
+        {
+            // Whether a window of the timeline is a gap depends only on the seed and the window
+            uint64_t window = gapSeed ^ (uint64_t) std::floor(nominal / options.gapLength);
+
+            if (uniform(window) < options.gapFraction) continue;
+        }
+
+        timestamps.push_back(nominal + jitter);
+    }
+
+    if (options.outOfOrderFraction > 0)
+    {
+        for (size_t idx = 0; idx + 1 < timestamps.size(); idx++)
+        {
+            if (uniform(state) < options.outOfOrderFraction)
+            {
+                std::swap(timestamps[idx], timestamps[idx + 1]);
+                idx++;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief SyntheticGenerator::generateValues - Generate the values of a channel, for the timestamps of a chunk
+ * @param chunk - Index of the chunk
+ * @param channel - Index of the channel
+ * @param timestamps - Timestamps of the chunk (see generateTimestamps)
+ * @param values - Set to the value at each timestamp
+ */
+void SyntheticGenerator::generateValues(uint64_t chunk, int channel, const std::vector<double> &timestamps, std::vector<double> &values) const
+{
+    values.resize(timestamps.size());
+
+    uint64_t state = mix(mix(options.seed ^ SALT_VALUE) ^ (uint64_t) channel) ^ mix(chunk);
+
+    for (size_t idx = 0; idx < timestamps.size(); idx++)
+    {
+        const bool missing = uniform(state) < options.nanFraction;
+        const double value = generateValue(channel, timestamps[idx], state);
+
+        values[idx] = missing ? NAN : value;
+    }
+}
+
+
+/*
+ * Generate a single value of a channel (drawing one random number from the state)
+ */
+double SyntheticGenerator::generateValue(int channel, double t, uint64_t &state) const
+{
+    const int shape = options.shape == SHAPE_MIXED ? channel % SHAPE_MIXED : options.shape;
+    const double amplitude = 1 + channel % 5;
+    const double noise = uniform(state) * 2 - 1;
+
+    switch (shape)
+    {
+    case SHAPE_SINE:
+    {
+        const double frequency = 0.1 * (1 + channel % 7);
+
+        return amplitude * (std::sin(2 * M_PI * frequency * t + channel) + 0.01 * noise);
+    }
+    case SHAPE_STEP:
+    {
+        // The level of each step depends only on the seed, the channel and the step
+        const double period = 1 + channel % 4;
+
+        uint64_t step = mix(options.seed ^ SALT_STEP) ^ mix((uint64_t) channel) ^ (uint64_t) (int64_t) std::floor(t / period);
+
+        return amplitude * ((int) (next(step) % 11) - 5);
+    }
+    case SHAPE_NOISE:
+    default:
+        return amplitude * noise;
+    }
+}
+
+
+QString SyntheticGenerator::getChannelLabel(int channel) const
+{
+    return QString("Channel %1").arg(channel);
+}
+
+
+/**
+ * @brief SyntheticGenerator::generateSeries - Generate a series for each channel (the channels are generated in parallel)
+ */
+QList<DataSeriesPointer> SyntheticGenerator::generateSeries(QThreadPool *pool) const
+{
+    std::vector<DataSeriesPointer> series(options.channels);
+
+    for (int channel = 0; channel < options.channels; channel++)
+    {
+        series[channel] = DataSeriesPointer(new DataSeries(getChannelLabel(channel)));
+    }
+
+    const uint64_t chunks = getChunkCount();
+
+    parallelFor(series.size(), [&](size_t channel) {
+        std::vector<double> t;
+        std::vector<double> v;
+
+        // Each channel regenerates the timeline, rather than waiting for the other channels
+        for (uint64_t chunk = 0; chunk < chunks; chunk++)
+        {
+            generateTimestamps(chunk, t);
+            generateValues(chunk, (int) channel, t, v);
+
+            series[channel]->addData(t, v, false);
+        }
+    }, pool);
+
+    QList<DataSeriesPointer> result;
+
+    for (const auto &s : series)
+    {
+        result.append(s);
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief SyntheticGenerator::createSource - Create a source which holds the generated series
+ * @param label - Label of the source
+ */
+DataSource* SyntheticGenerator::createSource(const QString &label) const
+{
+    const QString description = QString("%1 channels at %2 Hz for %3 s (seed %4)")
+            .arg(options.channels)
+            .arg(options.rate)
+            .arg(options.duration)
+            .arg(options.seed);
+
+    auto *source = new DataSource("Synthetic", label, description);
+
+    for (const auto &series : generateSeries())
+    {
+        series->update();
+        source->addSeries(series);
+    }
+
+    return source;
+}
+
+
+/**
+ * @brief SyntheticGenerator::writeFile - Write the dataset to a file, in the format implied by its extension (.csv or .bin)
+ */
+bool SyntheticGenerator::writeFile(const QString &filename, QStringList &errors) const
+{
+    const QString suffix = QFileInfo(filename).suffix().toLower();
+
+    if (suffix == "csv") return writeCSV(filename, errors);
+    if (suffix == "bin") return writeMavlink(filename, errors);
+
+    errors.append(QString("Unsupported file type: %1").arg(filename));
+    return false;
+}
+
+
+/**
+ * @brief SyntheticGenerator::writeCSV - Write the dataset to a CSV file, with a column of timestamps (s) and a column for each channel.
+ * NaN values are written as empty cells. The rows of each chunk are formatted in parallel.
+ */
+bool SyntheticGenerator::writeCSV(const QString &filename, QStringList &errors) const
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        errors.append(QString("Could not open file for writing: %1").arg(filename));
+        return false;
+    }
+
+    QByteArray header = "time";
+
+    for (int channel = 0; channel < options.channels; channel++)
+    {
+        header += "," + getChannelLabel(channel).toLatin1();
+    }
+
+    header += "\n";
+
+    bool valid = file.write(header) >= 0;
+
+    TextExportPipeline pipeline;
+
+    valid = valid && pipeline.run(getChunkCount(), [this](size_t chunk, std::vector<char> &buffer) { formatCSV(chunk, buffer); }, file);
+
+    file.close();
+
+    if (!valid)
+    {
+        errors.append(QString("Could not write to file: %1").arg(filename));
+    }
+
+    return valid;
+}
+
+
+void SyntheticGenerator::formatCSV(uint64_t chunk, std::vector<char> &buffer) const
+{
+    std::vector<double> t;
+    std::vector<std::vector<double>> values(options.channels);
+
+    generateTimestamps(chunk, t);
+
+    for (int channel = 0; channel < options.channels; channel++)
+    {
+        generateValues(chunk, channel, t, values[channel]);
+    }
+
+    for (size_t row = 0; row < t.size(); row++)
+    {
+        TextExportPipeline::appendNumber(buffer, t[row]);
+
+        for (const auto &v : values)
+        {
+            buffer.push_back(',');
+
+            if (!std::isnan(v[row]))
+            {
+                TextExportPipeline::appendNumber(buffer, v[row]);
+            }
+        }
+
+        buffer.push_back('\n');
+    }
+}
+
+
+/*
+ * Message type of a group of channels (skipping the type of the format message)
+ */
+static uint8_t getMessageType(int group)
+{
+    const int type = group + 1;
+
+    return (uint8_t) (type >= MAVLINK_FORMAT_ID ? type + 1 : type);
+}
+
+
+/*
+ * Append a format message, which describes the layout of a message type
+ */
+static void appendFormatMessage(QByteArray &buffer, uint8_t type, uint8_t length, const QByteArray &name, const QByteArray &format, const QByteArray &labels)
+{
+    QByteArray message(MAVLINK_FORMAT_LENGTH, '\0');
+
+    message[0] = (char) MAVLINK_HEAD_BYTE_1;
+    message[1] = (char) MAVLINK_HEAD_BYTE_2;
+    message[2] = (char) MAVLINK_FORMAT_ID;
+    message[3] = (char) type;
+    message[4] = (char) length;
+
+    // Fixed-length text fields, padded with zeros
+    memcpy(message.data() + 5, name.constData(), std::min<int>(name.size(), 4));
+    memcpy(message.data() + 9, format.constData(), std::min<int>(format.size(), 16));
+    memcpy(message.data() + 25, labels.constData(), std::min<int>(labels.size(), 64));
+
+    buffer += message;
+}
+
+
+/**
+ * @brief SyntheticGenerator::writeMavlink - Write the dataset to an ArduPilot (DataFlash) log file.
+ * Each group of (up to MAVLINK_CHANNELS_PER_MESSAGE) channels is a message type (S000, S001, ...) with
+ * a timestamp (TimeUS) and a float field for each channel (C0, C1, ...).
+ */
+bool SyntheticGenerator::writeMavlink(const QString &filename, QStringList &errors) const
+{
+    const int groups = (options.channels + MAVLINK_CHANNELS_PER_MESSAGE - 1) / MAVLINK_CHANNELS_PER_MESSAGE;
+
+    if (groups > 254)
+    {
+        errors.append(QString("Too many channels for a log file (maximum %1)").arg(254 * MAVLINK_CHANNELS_PER_MESSAGE));
+        return false;
+    }
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        errors.append(QString("Could not open file for writing: %1").arg(filename));
+        return false;
+    }
+
+    QByteArray header;
+
+    appendFormatMessage(header, MAVLINK_FORMAT_ID, MAVLINK_FORMAT_LENGTH, "FMT", "BBnNZ", "Type,Length,Name,Format,Columns");
+
+    for (int group = 0; group < groups; group++)
+    {
+        const int count = std::min(MAVLINK_CHANNELS_PER_MESSAGE, options.channels - group * MAVLINK_CHANNELS_PER_MESSAGE);
+
+        QByteArray format = "Q";
+        QByteArray labels = "TimeUS";
+
+        for (int idx = 0; idx < count; idx++)
+        {
+            format += 'f';
+            labels += ",C" + QByteArray::number(idx);
+        }
+
+        const uint8_t length = (uint8_t) (MAVLINK_HEADER_LENGTH + 8 + 4 * count);
+
+        appendFormatMessage(header, getMessageType(group), length, QString("S%1").arg(group, 3, 10, QChar('0')).toLatin1(), format, labels);
+    }
+
+    bool valid = file.write(header) >= 0;
+
+    TextExportPipeline pipeline;
+
+    valid = valid && pipeline.run(getChunkCount(), [this](size_t chunk, std::vector<char> &buffer) { formatMavlink(chunk, buffer); }, file);
+
+    file.close();
+
+    if (!valid)
+    {
+        errors.append(QString("Could not write to file: %1").arg(filename));
+    }
+
+    return valid;
+}
+
+
+void SyntheticGenerator::formatMavlink(uint64_t chunk, std::vector<char> &buffer) const
+{
+    std::vector<double> t;
+    std::vector<std::vector<double>> values(options.channels);
+
+    generateTimestamps(chunk, t);
+
+    for (int channel = 0; channel < options.channels; channel++)
+    {
+        generateValues(chunk, channel, t, values[channel]);
+    }
+
+    for (size_t row = 0; row < t.size(); row++)
+    {
+        const uint64_t timeUS = (uint64_t) std::llround(std::max(t[row], 0.0) * 1e6);
+
+        for (int first = 0; first < options.channels; first += MAVLINK_CHANNELS_PER_MESSAGE)
+        {
+            const int last = std::min(options.channels, first + MAVLINK_CHANNELS_PER_MESSAGE);
+
+            buffer.push_back((char) MAVLINK_HEAD_BYTE_1);
+            buffer.push_back((char) MAVLINK_HEAD_BYTE_2);
+            buffer.push_back((char) getMessageType(first / MAVLINK_CHANNELS_PER_MESSAGE));
+
+            // Fields are little-endian (as is every supported host)
+            TextExportPipeline::appendText(buffer, (const char*) &timeUS, sizeof(timeUS));
+
+            for (int channel = first; channel < last; channel++)
+            {
+                const float value = (float) values[channel][row];
+
+                TextExportPipeline::appendText(buffer, (const char*) &value, sizeof(value));
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief SyntheticGenerator::parseShape - Convert the name of a shape ("noise", "sine", "step" or "mixed") to a Shape
+ * @return true if the name is valid
+ */
+bool SyntheticGenerator::parseShape(const QString &name, int &shape)
+{
+    const QString n = name.trimmed().toLower();
+
+    if (n == "noise") shape = SHAPE_NOISE;
+    else if (n == "sine") shape = SHAPE_SINE;
+    else if (n == "step") shape = SHAPE_STEP;
+    else if (n == "mixed") shape = SHAPE_MIXED;
+    else return false;
+
+    return true;
+}
+
+
+//! Finalizer of the splitmix64 generator, which maps every input to a well-mixed output
+uint64_t SyntheticGenerator::mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return x;
+}
+
+
+uint64_t SyntheticGenerator::next(uint64_t &state)
+{
+    state += 0x9e3779b97f4a7c15ULL;
+
+    return mix(state);
+}
+
+
+//! Uniformly distributed in [0, 1)
+double SyntheticGenerator::uniform(uint64_t &state)
+{
+    return (next(state) >> 11) * 0x1.0p-53;
+}
@@ -0,0 +1,113 @@
+#ifndef SYNTHETIC_GENERATOR_HPP
+#define SYNTHETIC_GENERATOR_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "data_series.hpp"
+#include "data_source.hpp"
+
+
+/**
+ * @brief The SyntheticGenerator class generates large, reproducible datasets (for benchmarks and stress tests).
+ *
+ * Every channel shares a timeline of samples at a nominal rate, which may be perturbed by jitter, gaps
+ * (windows of time with no samples) and out-of-order samples (adjacent samples with swapped timestamps).
+ * The values of each channel follow a signal shape, with an optional fraction of NaN values.
+ *
+ * The timeline is generated a chunk of rows at a time, and the random numbers of each chunk (and channel)
+ * are seeded from the seed of the dataset, so any chunk can be generated independently (and in parallel)
+ * and the same options always produce exactly the same dataset. A dataset can be loaded directly into
+ * series, or written (a chunk at a time) to a CSV or an ArduPilot (DataFlash) log file, so a dataset
+ * much larger than memory can be written.
+ */
+class SyntheticGenerator
+{
+public:
+    enum Shape
+    {
+        SHAPE_NOISE = 0,
+        SHAPE_SINE,
+        SHAPE_STEP,
+        SHAPE_MIXED,            // Each channel cycles through the other shapes
+    };
+
+    struct Options
+    {
+        int channels = 8;
+
+        //! Nominal sample rate (Hz)
+        double rate = 100;
+
+        //! Duration of the timeline (s)
+        double duration = 60;
+
+        //! Maximum deviation of each timestamp from the nominal timeline (fraction of the sample period)
+        double jitter = 0;
+
+        //! Approximate fraction of the timeline within gaps, and the length of each gap (s)
+        double gapFraction = 0;
+        double gapLength = 1;
+
+        //! Fraction of samples which are swapped with the following sample
+        double outOfOrderFraction = 0;
+
+        //! Fraction of values which are NaN
+        double nanFraction = 0;
+
+        int shape = SHAPE_MIXED;
+
+        uint64_t seed = 1;
+    };
+
+    //! Number of rows of the nominal timeline within each chunk
+    static const uint64_t CHUNK_ROWS = 65536;
+
+    //! Maximum number of channels per message type of an ArduPilot log
+    static const int MAVLINK_CHANNELS_PER_MESSAGE = 10;
+
+    SyntheticGenerator(void) : SyntheticGenerator(Options()) {}
+    explicit SyntheticGenerator(const Options &options);
+
+    const Options& getOptions(void) const { return options; }
+
+    //! Number of rows of the nominal timeline (before gaps are removed)
+    uint64_t getRowCount(void) const;
+    uint64_t getChunkCount(void) const;
+
+    void generateTimestamps(uint64_t chunk, std::vector<double> &timestamps) const;
+    void generateValues(uint64_t chunk, int channel, const std::vector<double> &timestamps, std::vector<double> &values) const;
+
+    QString getChannelLabel(int channel) const;
+
+    QList<DataSeriesPointer> generateSeries(QThreadPool *pool = QThreadPool::globalInstance()) const;
+    DataSource* createSource(const QString &label) const;
+
+    bool writeCSV(const QString &filename, QStringList &errors) const;
+    bool writeMavlink(const QString &filename, QStringList &errors) const;
+    bool writeFile(const QString &filename, QStringList &errors) const;
+
+    static bool parseShape(const QString &name, int &shape);
+
+protected:
+    double generateValue(int channel, double t, uint64_t &state) const;
+
+    void formatCSV(uint64_t chunk, std::vector<char> &buffer) const;
+    void formatMavlink(uint64_t chunk, std::vector<char> &buffer) const;
+
+    static uint64_t mix(uint64_t x);
+    static uint64_t next(uint64_t &state);
+    static double uniform(uint64_t &state);
+
+    Options options;
+};
+
+
+#endif // SYNTHETIC_GENERATOR_HPP
@@ -0,0 +1,254 @@
+#include <string.h>
+
+#include <QMutexLocker>
+
+#include "telemetry_ingest.hpp"
+
+
+const size_t TelemetryIngest::HEADER_SIZE;
+const size_t TelemetryIngest::RECORD_SIZE;
+const size_t TelemetryIngest::MAX_CHANNELS;
+const size_t TelemetryIngest::DEFAULT_RING_CAPACITY;
+
+
+namespace
+{
+
+const char MAGIC[4] = {'L', 'J', 'T', '1'};
+
+//! Largest payload of a packet (bytes)
+const size_t MAX_PAYLOAD = 0xFFFF;
+
+uint16_t readUint16(const char *data)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+
+    return (uint16_t) (bytes[0] | (bytes[1] << 8));
+}
+
+double readDouble(const char *data)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+
+    uint64_t bits = 0;
+
+    for (int ii = 7; ii >= 0; ii--)
+    {
+        bits = (bits << 8) | bytes[ii];
+    }
+
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+void writeUint16(QByteArray &output, uint16_t value)
+{
+    output.append((char) (value & 0xFF));
+    output.append((char) (value >> 8));
+}
+
+void writeDouble(QByteArray &output, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    for (int ii = 0; ii < 8; ii++)
+    {
+        output.append((char) ((bits >> (8 * ii)) & 0xFF));
+    }
+}
+
+QByteArray encodeHeader(int type, size_t length)
+{
+    QByteArray header(MAGIC, sizeof(MAGIC));
+
+    header.append((char) type);
+    header.append((char) 0);
+
+    writeUint16(header, (uint16_t) length);
+
+    return header;
+}
+
+}
+
+
+TelemetryIngest::TelemetryIngest(size_t ringCapacity) :
+    ringCapacity(ringCapacity),
+    rings(MAX_CHANNELS),
+    newChannels(MAX_CHANNELS),
+    scratch(ringCapacity),
+    t_ms(ringCapacity),
+    values(ringCapacity)
+{
+}
+
+
+/**
+ * @brief TelemetryIngest::decode - Decode a sequence of packets (producer only)
+ * @param data is a datagram, or the bytes received from a stream
+ * @param length is the number of bytes
+ * @return the number of bytes which were consumed. A partial packet at the end is not consumed
+ * (so a stream can provide the remainder later), and bytes which are not the start of a packet are
+ * skipped (so a stream resynchronises after corruption)
+ */
+size_t TelemetryIngest::decode(const char *data, size_t length)
+{
+    size_t offset = 0;
+    bool skipping = false;
+
+    while (length - offset >= HEADER_SIZE)
+    {
+        const char *header = data + offset;
+
+        if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            // Count each run of unrecognised bytes once
+            if (!skipping) malformed.fetch_add(1, std::memory_order_relaxed);
+
+            skipping = true;
+            offset++;
+            continue;
+        }
+
+        skipping = false;
+
+        const size_t payload = readUint16(header + 6);
+
+        if (length - offset - HEADER_SIZE < payload) break;
+
+        decodePacket((uint8_t) header[4], header + HEADER_SIZE, payload);
+
+        offset += HEADER_SIZE + payload;
+    }
+
+    return offset;
+}
+
+
+void TelemetryIngest::decodePacket(int type, const char *payload, size_t length)
+{
+    packets.fetch_add(1, std::memory_order_relaxed);
+
+    switch (type)
+    {
+    case PACKET_SAMPLES:
+    {
+        if (length < sizeof(double) || (length - sizeof(double)) % RECORD_SIZE != 0)
+        {
+            malformed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const double t = readDouble(payload);
+        const size_t count = (length - sizeof(double)) / RECORD_SIZE;
+
+        uint64_t lost = 0;
+
+        for (size_t ii = 0; ii < count; ii++)
+        {
+            const char *record = payload + sizeof(double) + ii * RECORD_SIZE;
+
+            if (!getRing(readUint16(record))->push({t, readDouble(record + 2)})) lost++;
+        }
+
+        samples.fetch_add(count - lost, std::memory_order_relaxed);
+
+        if (lost > 0) dropped.fetch_add(lost, std::memory_order_relaxed);
+
+        break;
+    }
+    case PACKET_NAME:
+    {
+        if (length < 2)
+        {
+            malformed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const uint16_t id = readUint16(payload);
+        const QString label = QString::fromUtf8(payload + 2, (int) (length - 2));
+
+        QMutexLocker locker(&namesMutex);
+
+        names.insert(id, label);
+
+        break;
+    }
+    default:
+        // Unknown packet types are skipped (so that the protocol can be extended)
+        break;
+    }
+}
+
+
+/*
+ * Ring of a channel (producer only), which is allocated (and announced to the consumer) on first use
+ */
+TelemetryIngest::Ring* TelemetryIngest::getRing(uint16_t id)
+{
+    Ring *ring = rings[id].get();
+
+    if (ring) return ring;
+
+    rings[id].reset(new Ring(ringCapacity));
+
+    ring = rings[id].get();
+
+    newChannels.push({id, ring});
+
+    return ring;
+}
+
+
+/**
+ * @brief TelemetryIngest::takeNames - Return (and clear) the channel labels received since the previous call
+ */
+QHash<uint16_t, QString> TelemetryIngest::takeNames()
+{
+    QMutexLocker locker(&namesMutex);
+
+    QHash<uint16_t, QString> result;
+    result.swap(names);
+
+    return result;
+}
+
+
+/**
+ * @brief TelemetryIngest::encodeSamples - Encode a PACKET_SAMPLES packet (e.g. for a sender, or for testing)
+ * @param t_ms is the timestamp of every sample
+ * @param ids is the channel of each sample
+ * @param values is the value of each sample
+ */
+QByteArray TelemetryIngest::encodeSamples(double t_ms, const std::vector<uint16_t> &ids, const std::vector<double> &values)
+{
+    const size_t count = std::min(std::min(ids.size(), values.size()), (MAX_PAYLOAD - sizeof(double)) / RECORD_SIZE);
+
+    QByteArray packet = encodeHeader(PACKET_SAMPLES, sizeof(double) + count * RECORD_SIZE);
+
+    writeDouble(packet, t_ms);
+
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        writeUint16(packet, ids[ii]);
+        writeDouble(packet, values[ii]);
+    }
+
+    return packet;
+}
+
+
+QByteArray TelemetryIngest::encodeName(uint16_t id, const QString &label)
+{
+    QByteArray name = label.toUtf8().left((int) MAX_PAYLOAD - 2);
+
+    QByteArray packet = encodeHeader(PACKET_NAME, 2 + name.size());
+
+    writeUint16(packet, id);
+    packet.append(name);
+
+    return packet;
+}
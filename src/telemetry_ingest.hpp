@@ -0,0 +1,153 @@
+#ifndef TELEMETRY_INGEST_HPP
+#define TELEMETRY_INGEST_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "spsc_ring.hpp"
+
+
+/**
+ * @brief The TelemetryIngest class decodes live telemetry packets (see TelemetrySource) on the network thread,
+ * and queues the samples of each channel for the consumer (the GUI thread), without either thread blocking the other.
+ *
+ * Each channel has its own SPSCRing of samples, which is allocated when the channel first appears. The consumer
+ * learns of new channels through another ring, and then drains each channel in batches (see drain), so that the
+ * samples are appended to each series as a block rather than one at a time. Samples which arrive while the ring
+ * of their channel is full are dropped (and counted), rather than stalling the network thread.
+ *
+ * Packets are little-endian, and each starts with an 8 byte header:
+ *
+ *   char[4] magic ("LJT1"), uint8 type, uint8 reserved, uint16 payload length (bytes)
+ *
+ * PACKET_SAMPLES:  double timestamp (ms), followed by any number of {uint16 channel, double value} records
+ * PACKET_NAME:     uint16 channel, followed by the (UTF-8) label of the channel
+ *
+ * Several packets may be sent in one datagram, and a stream (TCP) is simply a sequence of packets.
+ */
+class TelemetryIngest
+{
+public:
+    enum PacketType
+    {
+        PACKET_SAMPLES = 1,
+        PACKET_NAME = 2,
+    };
+
+    //! Size of the packet header (bytes)
+    static const size_t HEADER_SIZE = 8;
+
+    //! Size of each record of a PACKET_SAMPLES packet (bytes)
+    static const size_t RECORD_SIZE = 10;
+
+    //! Number of channels which can be addressed (the channel is a uint16)
+    static const size_t MAX_CHANNELS = 65536;
+
+    //! Default number of samples which each channel can queue (~1 s at 1 kHz)
+    static const size_t DEFAULT_RING_CAPACITY = 1024;
+
+    struct Sample
+    {
+        double timestamp;
+        double value;
+    };
+
+    typedef SPSCRing<Sample> Ring;
+
+    TelemetryIngest(size_t ringCapacity = DEFAULT_RING_CAPACITY);
+
+    /* Producer (network thread) */
+    size_t decode(const char *data, size_t length);
+
+    /* Consumer */
+
+    /**
+     * @brief drain - Remove the queued samples of every channel
+     * @param callback is called (for each channel with samples) as callback(channel, t_ms, values, count)
+     */
+    template<typename Callback>
+    void drain(Callback callback)
+    {
+        Channel channel;
+
+        while (newChannels.pop(&channel, 1) == 1)
+        {
+            channels.push_back(channel);
+        }
+
+        for (const auto &ch : channels)
+        {
+            size_t n;
+
+            while ((n = ch.ring->pop(scratch.data(), scratch.size())) > 0)
+            {
+                for (size_t ii = 0; ii < n; ii++)
+                {
+                    t_ms[ii] = scratch[ii].timestamp;
+                    values[ii] = scratch[ii].value;
+                }
+
+                callback(ch.id, t_ms.data(), values.data(), n);
+            }
+        }
+    }
+
+    QHash<uint16_t, QString> takeNames(void);
+
+    /* Statistics */
+    uint64_t getPacketCount(void) const { return packets.load(std::memory_order_relaxed); }
+    uint64_t getSampleCount(void) const { return samples.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount(void) const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t getMalformedCount(void) const { return malformed.load(std::memory_order_relaxed); }
+
+    static QByteArray encodeSamples(double t_ms, const std::vector<uint16_t> &ids, const std::vector<double> &values);
+    static QByteArray encodeName(uint16_t id, const QString &label);
+
+protected:
+    void decodePacket(int type, const char *payload, size_t length);
+
+    Ring* getRing(uint16_t id);
+
+    struct Channel
+    {
+        uint16_t id;
+        Ring *ring;
+    };
+
+    const size_t ringCapacity;
+
+    //! Ring of each channel (allocated and owned by the producer, or null if the channel has not appeared)
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    //! Channels which have appeared since the consumer last drained (every channel fits, so a push never fails)
+    SPSCRing<Channel> newChannels;
+
+    //! Channels known to the consumer
+    std::vector<Channel> channels;
+
+    //! Consumer buffers for each batch
+    std::vector<Sample> scratch;
+    std::vector<double> t_ms;
+    std::vector<double> values;
+
+    //! Labels of channels which have been received since they were last taken (labels are rare, so are not lock-free)
+    QMutex namesMutex;
+    QHash<uint16_t, QString> names;
+
+    std::atomic<uint64_t> packets {0};
+    std::atomic<uint64_t> samples {0};
+    std::atomic<uint64_t> dropped {0};
+    std::atomic<uint64_t> malformed {0};
+};
+
+
+#endif // TELEMETRY_INGEST_HPP
@@ -0,0 +1,332 @@
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+
+#include "data_source_manager.hpp"
+#include "telemetry_source.hpp"
+#include "trace_recorder.hpp"
+
+
+const int TelemetrySource::DRAIN_INTERVAL;
+const quint16 TelemetrySource::DEFAULT_PORT;
+
+
+/**
+ * @brief TelemetryReceiver::open - Open the socket (on the network thread)
+ * @return true if the socket is listening
+ */
+bool TelemetryReceiver::open(int protocol, quint16 port, QStringList &errors)
+{
+    if (protocol == TelemetrySource::PROTOCOL_TCP)
+    {
+        server = new QTcpServer(this);
+
+        connect(server, &QTcpServer::newConnection, this, &TelemetryReceiver::acceptConnections);
+
+        if (!server->listen(QHostAddress::Any, port))
+        {
+            errors.append(QString("Could not listen on TCP port %1: %2").arg(port).arg(server->errorString()));
+            return false;
+        }
+
+        return true;
+    }
+
+    udp = new QUdpSocket(this);
+
+    // Telemetry datagrams arrive in bursts, which the default buffer may not hold
+    udp->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 4 << 20);
+
+    connect(udp, &QUdpSocket::readyRead, this, &TelemetryReceiver::readDatagrams);
+
+    if (!udp->bind(QHostAddress::Any, port))
+    {
+        errors.append(QString("Could not bind UDP port %1: %2").arg(port).arg(udp->errorString()));
+        return false;
+    }
+
+    return true;
+}
+
+
+void TelemetryReceiver::close()
+{
+    // The connections are deleted with the server
+    for (auto socket : pending.keys())
+    {
+        socket->abort();
+    }
+
+    pending.clear();
+
+    delete udp;
+    udp = nullptr;
+
+    delete server;
+    server = nullptr;
+}
+
+
+void TelemetryReceiver::readDatagrams()
+{
+    QByteArray datagram;
+
+    while (udp && udp->hasPendingDatagrams())
+    {
+        datagram.resize((int) udp->pendingDatagramSize());
+
+        const qint64 n = udp->readDatagram(datagram.data(), datagram.size());
+
+        // A partial packet at the end of a datagram is discarded (the remainder is not sent later)
+        if (n > 0) ingest.decode(datagram.constData(), (size_t) n);
+    }
+}
+
+
+void TelemetryReceiver::acceptConnections()
+{
+    while (server && server->hasPendingConnections())
+    {
+        QTcpSocket *socket = server->nextPendingConnection();
+
+        pending.insert(socket, QByteArray());
+
+        connect(socket, &QTcpSocket::readyRead, this, &TelemetryReceiver::readStream);
+        connect(socket, &QTcpSocket::disconnected, this, &TelemetryReceiver::closeStream);
+    }
+}
+
+
+void TelemetryReceiver::readStream()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+
+    if (!socket || !pending.contains(socket)) return;
+
+    QByteArray &buffer = pending[socket];
+
+    buffer.append(socket->readAll());
+
+    const size_t consumed = ingest.decode(buffer.constData(), (size_t) buffer.size());
+
+    buffer.remove(0, (int) consumed);
+}
+
+
+void TelemetryReceiver::closeStream()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+
+    if (!socket) return;
+
+    pending.remove(socket);
+    socket->deleteLater();
+}
+
+
+TelemetrySource::TelemetrySource(int protocol, quint16 port) :
+    DataSource("Live Telemetry", QString("%1 port %2").arg(getProtocolName(protocol)).arg(port),
+               QString("Live telemetry received on %1 port %2").arg(getProtocolName(protocol)).arg(port)),
+    m_protocol(protocol),
+    m_port(port)
+{
+    thread.setObjectName("Telemetry");
+
+    drainTimer.setInterval(DRAIN_INTERVAL);
+
+    connect(&drainTimer, &QTimer::timeout, this, &TelemetrySource::drain);
+}
+
+
+TelemetrySource::~TelemetrySource()
+{
+    close();
+}
+
+
+/**
+ * @brief TelemetrySource::start - Open the socket, and start adding the received samples to the series
+ * @param errors is appended with the reason if the socket could not be opened
+ * @return true if the source is receiving
+ */
+bool TelemetrySource::start(QStringList &errors)
+{
+    if (running) return true;
+
+    receiver = new TelemetryReceiver(ingest);
+    receiver->moveToThread(&thread);
+
+    connect(&thread, &QThread::finished, receiver, &QObject::deleteLater);
+
+    thread.start();
+
+    bool result = false;
+
+    // The sockets are created on the network thread, so that they deliver their data there
+    QMetaObject::invokeMethod(receiver, [&]() {
+        result = receiver->open(m_protocol, m_port, errors);
+    }, Qt::BlockingQueuedConnection);
+
+    running = true;
+
+    if (!result)
+    {
+        close();
+        return false;
+    }
+
+    drainTimer.start();
+
+    return true;
+}
+
+
+/**
+ * @brief TelemetrySource::stop - Close the socket (the samples received so far are retained)
+ */
+void TelemetrySource::stop()
+{
+    if (!running) return;
+
+    close();
+
+    // Samples which were queued before the socket was closed
+    drain();
+}
+
+
+void TelemetrySource::close()
+{
+    if (!running) return;
+
+    drainTimer.stop();
+
+    QMetaObject::invokeMethod(receiver, [this]() {
+        receiver->close();
+    }, Qt::BlockingQueuedConnection);
+
+    thread.quit();
+    thread.wait();
+
+    // The receiver is deleted when the thread finishes
+    receiver = nullptr;
+    running = false;
+}
+
+
+QString TelemetrySource::getProtocolName(int protocol)
+{
+    switch (protocol)
+    {
+    case PROTOCOL_TCP:
+        return "TCP";
+    case PROTOCOL_UDP:
+    default:
+        return "UDP";
+    }
+}
+
+
+QString TelemetrySource::getDefaultLabel(uint16_t id)
+{
+    return QString("Channel %1").arg(id);
+}
+
+
+/**
+ * @brief TelemetrySource::drain - Add the samples which have been received since the previous drain to the series
+ */
+void TelemetrySource::drain()
+{
+    TRACE_SCOPE("Telemetry Drain", "import");
+
+    updated.clear();
+    added = false;
+
+    // Adding many series (e.g. when a sender starts) only refreshes the data view once
+    blockSignals(true);
+
+    renameChannels(ingest.takeNames());
+
+    ingest.drain([this](uint16_t id, const double *t_ms, const double *values, size_t count) {
+        auto series = getChannelSeries(id);
+
+        const size_t n = series->size();
+
+        series->addData(t_ms, values, count, false);
+
+        // The samples of a channel are normally drained in a single batch
+        if (series->size() != n && (updated.isEmpty() || updated.last() != series.data()))
+        {
+            updated.append(series.data());
+        }
+    });
+
+    blockSignals(false);
+
+    if (added)
+    {
+        emit dataChanged();
+        DataSourceManager::getInstance()->update();
+    }
+
+    for (auto series : updated)
+    {
+        series->update();
+    }
+}
+
+
+/*
+ * Series of a channel, which is added when the channel first receives samples
+ */
+DataSeriesPointer TelemetrySource::getChannelSeries(uint16_t id)
+{
+    auto series = channels.value(id);
+
+    if (!series.isNull()) return series;
+
+    QString label = labels.value(id, getDefaultLabel(id));
+
+    // Two channels with the same label are both retained
+    if (!getSeriesByLabel(label).isNull())
+    {
+        label = QString("%1 (%2)").arg(label).arg(id);
+    }
+
+    series = DataSeriesPointer(new DataSeries(label));
+
+    addSeries(series);
+    channels.insert(id, series);
+
+    added = true;
+
+    return series;
+}
+
+
+void TelemetrySource::renameChannels(const QHash<uint16_t, QString> &names)
+{
+    for (auto it = names.constBegin(); it != names.constEnd(); ++it)
+    {
+        const uint16_t id = it.key();
+        const QString label = it.value().isEmpty() ? getDefaultLabel(id) : it.value();
+
+        labels.insert(id, label);
+
+        auto series = channels.value(id);
+
+        if (series.isNull() || series->getLabel() == label) continue;
+
+        // The label must not replace the series of another channel
+        auto existing = getSeriesByLabel(label);
+
+        if (!existing.isNull() && existing != series) continue;
+
+        removeSeries(series, false);
+        series->setLabel(label);
+        addSeries(series, false);
+
+        added = true;
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef TELEMETRY_SOURCE_HPP
+#define TELEMETRY_SOURCE_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include "data_source.hpp"
+#include "telemetry_ingest.hpp"
+
+class QTcpServer;
+class QTcpSocket;
+class QUdpSocket;
+
+
+/**
+ * @brief The TelemetryReceiver class owns the socket of a TelemetrySource, and runs on its network thread,
+ * decoding each datagram (or the bytes of each stream) into the TelemetryIngest as soon as it arrives
+ */
+class TelemetryReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    TelemetryReceiver(TelemetryIngest &ingest) : ingest(ingest) {}
+
+    bool open(int protocol, quint16 port, QStringList &errors);
+    void close(void);
+
+protected slots:
+    void readDatagrams(void);
+    void acceptConnections(void);
+    void readStream(void);
+    void closeStream(void);
+
+protected:
+    TelemetryIngest &ingest;
+
+    QUdpSocket *udp = nullptr;
+    QTcpServer *server = nullptr;
+
+    //! Bytes of each connection which do not yet form a complete packet
+    QHash<QTcpSocket*, QByteArray> pending;
+};
+
+
+/**
+ * @brief The TelemetrySource class is a data source whose series are received live from the network
+ * (e.g. from a vehicle, or a test rig), rather than imported from a file.
+ *
+ * Packets (see TelemetryIngest) are received and decoded on a dedicated thread, which queues the samples of
+ * each channel in a lock-free ring. The GUI thread drains the rings at a fixed interval, appending each batch
+ * to the series of its channel, and notifies each series which has grown once per interval (as an import
+ * does, see DataSourceManager::publishImport), so the rate of updates does not depend on the packet rate.
+ *
+ * Each channel is a series, labelled by the most recent PACKET_NAME for the channel (or "Channel N").
+ * The socket is closed when the source is removed.
+ */
+class TelemetrySource : public DataSource
+{
+    Q_OBJECT
+
+public:
+    enum Protocol
+    {
+        PROTOCOL_UDP = 0,
+        PROTOCOL_TCP,
+    };
+
+    //! Interval at which the received samples are added to the series (ms)
+    static const int DRAIN_INTERVAL = 20;
+
+    //! Default port to listen on
+    static const quint16 DEFAULT_PORT = 14660;
+
+    TelemetrySource(int protocol, quint16 port);
+    virtual ~TelemetrySource();
+
+    bool start(QStringList &errors);
+    void stop(void);
+
+    bool isRunning(void) const { return running; }
+
+    int getProtocol(void) const { return m_protocol; }
+    quint16 getPort(void) const { return m_port; }
+
+    const TelemetryIngest& getIngest(void) const { return ingest; }
+
+    static QString getProtocolName(int protocol);
+
+public slots:
+    void drain(void);
+
+protected:
+    DataSeriesPointer getChannelSeries(uint16_t id);
+    void renameChannels(const QHash<uint16_t, QString> &names);
+
+    void close(void);
+
+    static QString getDefaultLabel(uint16_t id);
+
+    int m_protocol;
+    quint16 m_port;
+
+    bool running = false;
+
+    TelemetryIngest ingest;
+
+    QThread thread;
+    TelemetryReceiver *receiver = nullptr;
+
+    QTimer drainTimer;
+
+    //! Series of each channel which has received samples
+    QHash<uint16_t, DataSeriesPointer> channels;
+
+    //! Labels of channels which were named before they received samples
+    QHash<uint16_t, QString> labels;
+
+    //! Series which were added, or grew, during the current drain
+    QVector<DataSeries*> updated;
+    bool added = false;
+};
+
+
+#endif // TELEMETRY_SOURCE_HPP
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <charconv>
+#include <memory>
+
+#include <QMutex>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include "text_export_pipeline.hpp"
+#include "time_ticks.hpp"
+
+
+const size_t TextExportPipeline::BLOCKS_PER_THREAD;
+
+
+/*
+ * Items which are shared by the writer and the formatting tasks
+ */
+struct TextExportState
+{
+    TextExportState(size_t count, size_t window, const TextExportPipeline::FormatFunction &func) :
+        n(count), pending(window), fn(func) {}
+
+    const size_t n;
+
+    //! Block b is formatted into slot (b % size)
+    struct Slot
+    {
+        std::vector<char> buffer;
+        bool ready = false;
+    };
+
+    std::vector<Slot> pending;
+
+    //! Valid until the writer has stopped every task (tasks which start later do not call it)
+    const TextExportPipeline::FormatFunction &fn;
+
+    QMutex mutex;
+
+    //! Signalled when a block has been formatted, or a slot has been freed
+    QWaitCondition changed;
+
+    //! Next block to format, and to write
+    size_t next = 0;
+    size_t written = 0;
+
+    //! Number of blocks being formatted
+    size_t busy = 0;
+
+    bool stopped = false;
+
+    //! Spare buffers (so their capacity is reused)
+    std::vector<std::vector<char>> spare;
+
+    /*
+     * Claim the next block (if one is available within the window), called with the mutex locked
+     */
+    bool claim(size_t &block)
+    {
+        if (stopped || next >= n || next >= written + pending.size()) return false;
+
+        block = next++;
+        busy++;
+
+        return true;
+    }
+
+    /*
+     * Format a claimed block, called with the mutex locked (which is released while formatting)
+     */
+    void format(size_t block)
+    {
+        std::vector<char> buffer;
+
+        if (!spare.empty())
+        {
+            buffer.swap(spare.back());
+            spare.pop_back();
+        }
+
+        mutex.unlock();
+
+        buffer.clear();
+        fn(block, buffer);
+
+        mutex.lock();
+
+        Slot &slot = pending[block % pending.size()];
+
+        slot.buffer.swap(buffer);
+        slot.ready = true;
+
+        busy--;
+
+        changed.wakeAll();
+    }
+
+    void work(void)
+    {
+        QMutexLocker lock(&mutex);
+
+        while (!stopped && next < n)
+        {
+            size_t block;
+
+            if (claim(block))
+            {
+                format(block);
+            }
+            else
+            {
+                changed.wait(&mutex);
+            }
+        }
+    }
+};
+
+
+class TextExportTask : public QRunnable
+{
+public:
+    TextExportTask(std::shared_ptr<TextExportState> s) : state(s) { setAutoDelete(true); }
+
+    virtual void run() override { state->work(); }
+
+protected:
+    std::shared_ptr<TextExportState> state;
+};
+
+
+TextExportPipeline::TextExportPipeline(QThreadPool *pool) : m_pool(pool)
+{
+}
+
+
+/**
+ * @brief TextExportPipeline::run - Format every block, and write the blocks to the device in order
+ * @param blockCount - Number of blocks
+ * @param format - Formats the rows of a block (into a buffer which is private to the block)
+ * @param device - Destination of the formatted blocks
+ * @param cancel - Polled before each block is written, to stop the export early
+ * @return false if a block could not be written (or the export was stopped)
+ */
+bool TextExportPipeline::run(size_t blockCount, const FormatFunction &format, QIODevice &device, const CancelFunction &cancel)
+{
+    m_blocksWritten = 0;
+
+    if (blockCount == 0) return true;
+
+    const size_t threads = std::max(1, m_pool ? m_pool->maxThreadCount() : 1);
+
+    auto state = std::make_shared<TextExportState>(blockCount, threads * BLOCKS_PER_THREAD, format);
+
+    const size_t helpers = std::min(blockCount, threads) - 1;
+
+    for (size_t ii = 0; m_pool && ii < helpers; ii++)
+    {
+        m_pool->start(new TextExportTask(state));
+    }
+
+    bool result = true;
+
+    state->mutex.lock();
+
+    while (state->written < blockCount)
+    {
+        if (cancel && cancel())
+        {
+            result = false;
+            break;
+        }
+
+        TextExportState::Slot &slot = state->pending[state->written % state->pending.size()];
+
+        size_t block;
+
+        if (!slot.ready)
+        {
+            // Format a block here, rather than waiting (if there is one to format)
+            if (state->claim(block))
+            {
+                state->format(block);
+            }
+            else
+            {
+                state->changed.wait(&state->mutex);
+            }
+
+            continue;
+        }
+
+        std::vector<char> buffer;
+
+        buffer.swap(slot.buffer);
+        slot.ready = false;
+
+        state->written++;
+        state->changed.wakeAll();
+
+        state->mutex.unlock();
+
+        const qint64 size = (qint64) buffer.size();
+
+        if (size > 0 && device.write(buffer.data(), size) != size)
+        {
+            result = false;
+        }
+
+        m_blocksWritten++;
+
+        state->mutex.lock();
+
+        state->spare.push_back(std::move(buffer));
+
+        if (!result) break;
+    }
+
+    // Stop the tasks, and wait for any block which is still being formatted
+    state->stopped = true;
+    state->changed.wakeAll();
+
+    while (state->busy > 0)
+    {
+        state->changed.wait(&state->mutex);
+    }
+
+    state->mutex.unlock();
+
+    return result;
+}
+
+
+/**
+ * @brief TextExportPipeline::appendNumber - Format a value (as the shortest text which reads back as the same value),
+ * appending it to the buffer
+ */
+void TextExportPipeline::appendNumber(std::vector<char> &buffer, double value)
+{
+    char text[32];
+
+    auto result = std::to_chars(text, text + sizeof(text), value);
+
+    buffer.insert(buffer.end(), text, result.ptr);
+}
+
+
+/**
+ * @brief TextExportPipeline::appendTicks - Format a timestamp in nanoseconds exactly (as decimal seconds, without trailing zeros),
+ * appending it to the buffer (see TimeTicks)
+ */
+void TextExportPipeline::appendTicks(std::vector<char> &buffer, int64_t ticks)
+{
+    // Split into whole seconds and the fraction, without negating a tick (which would overflow at the minimum)
+    int64_t seconds = ticks / TimeTicks::PER_SECOND;
+    int64_t fraction = ticks % TimeTicks::PER_SECOND;
+
+    if (fraction < 0)
+    {
+        fraction = -fraction;
+
+        if (seconds == 0) buffer.push_back('-');
+    }
+
+    char text[32];
+
+    auto result = std::to_chars(text, text + sizeof(text), seconds);
+
+    buffer.insert(buffer.end(), text, result.ptr);
+
+    if (fraction == 0) return;
+
+    char digits[9];
+    int count = 9;
+
+    for (int ii = 8; ii >= 0; ii--)
+    {
+        digits[ii] = (char) ('0' + fraction % 10);
+        fraction /= 10;
+    }
+
+    while (digits[count - 1] == '0') count--;
+
+    buffer.push_back('.');
+    buffer.insert(buffer.end(), digits, digits + count);
+}
+
+
+void TextExportPipeline::appendText(std::vector<char> &buffer, const char *text, size_t length)
+{
+    buffer.insert(buffer.end(), text, text + length);
+}
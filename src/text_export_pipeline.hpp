@@ -0,0 +1,54 @@
+#ifndef TEXT_EXPORT_PIPELINE_HPP
+#define TEXT_EXPORT_PIPELINE_HPP
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+#include <QIODevice>
+#include <QThreadPool>
+
+
+/**
+ * @brief The TextExportPipeline class formats the rows of a text export (e.g. CSV) in parallel.
+ *
+ * The export is divided into blocks (e.g. ranges of time) which can be formatted independently.
+ * Each block is formatted by a pool thread into a private buffer, and the calling thread writes the
+ * buffers to the device in block order, as soon as each is complete, so formatting and writing overlap.
+ * Only a few blocks (per thread) are in flight at once, which bounds the memory used by the buffers.
+ *
+ * While it waits for the next block to be written, the calling thread formats blocks itself, so the
+ * pipeline completes even if no pool thread is available (e.g. when it is run from a pool thread).
+ */
+class TextExportPipeline
+{
+public:
+    //! Format the rows of a block, appending them to the buffer. Called concurrently, for different blocks
+    typedef std::function<void(size_t block, std::vector<char> &buffer)> FormatFunction;
+
+    //! Return true to stop the export (e.g. if it has been cancelled)
+    typedef std::function<bool(void)> CancelFunction;
+
+    //! Number of blocks (per thread) which may be formatted ahead of the block being written
+    static const size_t BLOCKS_PER_THREAD = 2;
+
+    explicit TextExportPipeline(QThreadPool *pool = QThreadPool::globalInstance());
+
+    bool run(size_t blockCount, const FormatFunction &format, QIODevice &device, const CancelFunction &cancel = CancelFunction());
+
+    //! Number of blocks written by the current (or previous) run
+    size_t getBlocksWritten(void) const { return m_blocksWritten; }
+
+    static void appendNumber(std::vector<char> &buffer, double value);
+    static void appendTicks(std::vector<char> &buffer, int64_t ticks);
+    static void appendText(std::vector<char> &buffer, const char *text, size_t length);
+
+protected:
+    QThreadPool *m_pool;
+
+    std::atomic<size_t> m_blocksWritten{0};
+};
+
+
+#endif // TEXT_EXPORT_PIPELINE_HPP
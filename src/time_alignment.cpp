@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cmath>
+
+#include "fft_engine.hpp"
+#include "time_alignment.hpp"
+#include "trace_recorder.hpp"
+
+
+const size_t TimeAlignment::DEFAULT_POINTS;
+const size_t TimeAlignment::DEFAULT_SEGMENT;
+
+
+/**
+ * @brief TimeAlignment::decimate - Decimate a channel onto a uniform grid, for correlation.
+ *
+ * Cell ii covers [t0 + ii * dt, t0 + (ii + 1) * dt), and receives the mean of the samples within it,
+ * less the mean of every cell. Empty cells within the range of the samples are interpolated, and cells
+ * outside the range are zero (so they do not contribute to the correlation).
+ *
+ * @param snapshot is the (aligned) channel
+ * @param t0 is the start of the grid
+ * @param dt is the spacing of the grid (dt > 0)
+ * @param n is the number of cells
+ * @param output receives n values
+ */
+void TimeAlignment::decimate(const DataSnapshot& snapshot, double t0, double dt, size_t n, std::vector<double>& output)
+{
+    output.assign(n, 0.0);
+
+    if (snapshot.isEmpty() || n == 0) return;
+
+    const uint64_t idx_first = snapshot.lowerBound(t0);
+    const uint64_t idx_last = snapshot.lowerBound(t0 + n * dt);
+
+    if (idx_first >= idx_last) return;
+
+    // Coarsest summary level with buckets no larger than a cell (so each bucket lies within one or two cells)
+    const double perCell = (double) (idx_last - idx_first) / n;
+
+    int level = -1;
+
+    for (unsigned int ll = 0; ll < DataBlock::SUMMARY_LEVELS && DataBlock::getSummaryBucketSize(ll) <= perCell; ll++)
+    {
+        level = (int) ll;
+    }
+
+    std::vector<uint64_t> counts(n, 0);
+
+    // Each bucket is assigned to the cell of its midpoint
+    snapshot.visitBuckets(idx_first, idx_last, level, [&](const DataSnapshot::Bucket& bucket) {
+        const double t = 0.5 * (bucket.first.timestamp + bucket.last.timestamp);
+        const int64_t cell = (int64_t) std::floor((t - t0) / dt);
+
+        if (cell < 0 || cell >= (int64_t) n) return;
+
+        output[cell] += bucket.sum;
+        counts[cell] += bucket.count;
+    });
+
+    size_t first = n;
+    size_t last = 0;
+
+    double total = 0;
+    size_t filled = 0;
+
+    for (size_t ii = 0; ii < n; ii++)
+    {
+        if (counts[ii] == 0) continue;
+
+        output[ii] /= counts[ii];
+
+        total += output[ii];
+        filled++;
+
+        first = std::min(first, ii);
+        last = ii;
+    }
+
+    if (filled == 0) return;
+
+    const double mean = total / filled;
+
+    // Interpolate across empty cells (between the first and last filled cells)
+    size_t previous = first;
+
+    for (size_t ii = first + 1; ii <= last; ii++)
+    {
+        if (counts[ii] == 0) continue;
+
+        for (size_t jj = previous + 1; jj < ii; jj++)
+        {
+            output[jj] = output[previous] + (output[ii] - output[previous]) * (double) (jj - previous) / (ii - previous);
+        }
+
+        previous = ii;
+    }
+
+    for (size_t ii = first; ii <= last; ii++)
+    {
+        output[ii] -= mean;
+    }
+}
+
+
+/**
+ * @brief TimeAlignment::findOffset - Estimate the offset which aligns the target channel with the reference channel
+ * @param reference is the channel which is aligned to
+ * @param target is the channel which is shifted
+ * @param maxLag is the largest offset (ms) which is considered (zero for any offset)
+ * @param points is the number of grid points onto which each channel is decimated
+ * @return the offset (invalid if either channel is constant, or there are too few samples)
+ */
+TimeAlignment::Result TimeAlignment::findOffset(const DataSnapshot& reference, const DataSnapshot& target, double maxLag, size_t points)
+{
+    TRACE_SCOPE("Time alignment", "math");
+
+    if (reference.size() < 2 || target.size() < 2 || points < 4) return Result();
+
+    // The grid covers both channels
+    const double t0 = std::min(reference.getTimestamp(0), target.getTimestamp(0));
+    const double t1 = std::max(reference.getTimestamp(reference.size() - 1), target.getTimestamp(target.size() - 1));
+
+    if (!(t1 > t0)) return Result();
+
+    const double dt = (t1 - t0) / points;
+
+    return correlate(transform(reference, t0, dt, points), transform(target, t0, dt, points), maxLag).peak;
+}
+
+
+/**
+ * @brief TimeAlignment::transform - Decimate a channel onto a grid, and calculate its spectrum (for correlate)
+ * @param snapshot is the (aligned) channel
+ * @param t0 is the start of the grid
+ * @param dt is the spacing of the grid (dt > 0)
+ * @param points is the number of grid points
+ */
+TimeAlignment::Spectrum TimeAlignment::transform(const DataSnapshot& snapshot, double t0, double dt, size_t points)
+{
+    Spectrum spectrum;
+
+    spectrum.t0 = t0;
+    spectrum.dt = dt;
+    spectrum.points = points;
+
+    if (points == 0 || !(dt > 0)) return spectrum;
+
+    std::vector<double> grid;
+
+    decimate(snapshot, t0, dt, points, grid);
+
+    for (double value : grid)
+    {
+        spectrum.energy += value * value;
+    }
+
+    // Zero padding to (at least) twice the length, so the circular correlation does not wrap
+    size_t n = 1;
+
+    while (n < 2 * points) n <<= 1;
+
+    std::vector<FFTComplex> input(n);
+
+    for (size_t ii = 0; ii < points; ii++) input[ii] = FFTComplex(grid[ii], 0);
+
+    spectrum.bins.resize(n);
+
+    FFTEngine::getPlan(n)->transform(input.data(), spectrum.bins.data());
+
+    return spectrum;
+}
+
+
+/**
+ * @brief TimeAlignment::correlate - Calculate the normalised cross-correlation of two channels, from their spectra
+ * @param reference is the spectrum of the channel which is aligned to
+ * @param target is the spectrum of the channel which is shifted (on the same grid)
+ * @param maxLag is the largest offset (ms) which is considered (zero for any offset)
+ * @return the correlation at each offset (empty, with an invalid peak, if either channel is constant)
+ */
+TimeAlignment::Correlation TimeAlignment::correlate(const Spectrum& reference, const Spectrum& target, double maxLag)
+{
+    Correlation result;
+
+    if (!reference.isCompatible(target) || reference.points < 4 || reference.bins.size() != target.bins.size()) return result;
+
+    if (!(reference.energy > 0) || !(target.energy > 0)) return result;
+
+    const size_t points = reference.points;
+    const size_t n = reference.bins.size();
+    const double dt = reference.dt;
+
+    std::vector<FFTComplex> input(n);
+    std::vector<FFTComplex> output(n);
+
+    // r[k] = sum(a[i] * b[i + k]) is the inverse transform of conj(A) * B, calculated as conj(FFT(A * conj(B))) / n
+    for (size_t ii = 0; ii < n; ii++)
+    {
+        input[ii] = reference.bins[ii] * std::conj(target.bins[ii]);
+    }
+
+    FFTEngine::getPlan(n)->transform(input.data(), output.data());
+
+    auto correlation = [&](int64_t k) {
+        return std::conj(output[(size_t) ((k + (int64_t) n) % (int64_t) n)]).real() / n;
+    };
+
+    int64_t maxShift = (int64_t) points - 1;
+
+    if (maxLag > 0)
+    {
+        maxShift = std::min<int64_t>(maxShift, (int64_t) std::ceil(maxLag / dt));
+    }
+
+    const double norm = std::sqrt(reference.energy * target.energy);
+
+    int64_t best = 0;
+    double peak = -INFINITY;
+
+    // A positive shift (the target lags the reference) is a negative offset
+    result.values.resize(2 * maxShift + 1);
+    result.maxShift = maxShift;
+    result.resolution = dt;
+
+    for (int64_t k = -maxShift; k <= maxShift; k++)
+    {
+        const double r = correlation(k);
+
+        result.values[maxShift - k] = r / norm;
+
+        if (r > peak)
+        {
+            peak = r;
+            best = k;
+        }
+    }
+
+    // Interpolate the peak (fitting a parabola through the neighbouring lags)
+    double delta = 0;
+
+    if (best > -maxShift && best < maxShift)
+    {
+        const double before = correlation(best - 1);
+        const double after = correlation(best + 1);
+        const double curvature = before - 2 * peak + after;
+
+        if (curvature < 0)
+        {
+            delta = std::clamp(0.5 * (before - after) / curvature, -0.5, 0.5);
+        }
+    }
+
+    // The target lags the reference by (best + delta) cells, b[i + k] ~ a[i]
+    result.peak.valid = true;
+    result.peak.offset = -(best + delta) * dt;
+    result.peak.correlation = peak / norm;
+    result.peak.resolution = dt;
+
+    return result;
+}
+
+
+/**
+ * @brief TimeAlignment::computeCoherence - Estimate the magnitude-squared coherence of two channels (Welch's method).
+ * Both channels are decimated onto the grid, which is divided into segments overlapping by half. Each segment is
+ * windowed and transformed, and the cross and auto spectra are averaged over the segments.
+ * @param reference is the reference channel (e.g. a command)
+ * @param target is the other channel (e.g. the response)
+ * @param t0 is the start of the grid
+ * @param dt is the spacing of the grid (ms)
+ * @param points is the number of grid points
+ * @param segment is the number of grid points in each segment (which determines the frequency resolution)
+ */
+TimeAlignment::Coherence TimeAlignment::computeCoherence(const DataSnapshot& reference, const DataSnapshot& target, double t0, double dt, size_t points, size_t segment)
+{
+    TRACE_SCOPE("Coherence", "math");
+
+    Coherence result;
+
+    if (segment < 4 || points < segment || !(dt > 0)) return result;
+
+    std::vector<double> a;
+    std::vector<double> b;
+
+    decimate(reference, t0, dt, points, a);
+    decimate(target, t0, dt, points, b);
+
+    const auto plan = FFTEngine::getRealPlan(segment);
+    const auto coefficients = FFTEngine::getWindowCoefficients(FFTEngine::WINDOW_HANN, segment);
+
+    const size_t n_bins = plan->getBinCount();
+
+    std::vector<double> power_a(n_bins, 0.0);
+    std::vector<double> power_b(n_bins, 0.0);
+    std::vector<FFTComplex> cross(n_bins);
+
+    std::vector<double> samples(segment);
+    std::vector<FFTComplex> bins_a(n_bins);
+    std::vector<FFTComplex> bins_b(n_bins);
+
+    for (size_t start = 0; start + segment <= points; start += segment / 2)
+    {
+        for (size_t ii = 0; ii < segment; ii++) samples[ii] = a[start + ii] * coefficients[ii];
+
+        plan->transform(samples.data(), bins_a.data());
+
+        for (size_t ii = 0; ii < segment; ii++) samples[ii] = b[start + ii] * coefficients[ii];
+
+        plan->transform(samples.data(), bins_b.data());
+
+        for (size_t k = 0; k < n_bins; k++)
+        {
+            power_a[k] += std::norm(bins_a[k]);
+            power_b[k] += std::norm(bins_b[k]);
+            cross[k] += std::conj(bins_a[k]) * bins_b[k];
+        }
+
+        result.segments++;
+    }
+
+    result.frequency.resize(n_bins);
+    result.coherence.resize(n_bins);
+    result.phase.resize(n_bins);
+
+    for (size_t k = 0; k < n_bins; k++)
+    {
+        const double denominator = power_a[k] * power_b[k];
+
+        // Timestamps are in ms
+        result.frequency[k] = 1000.0 * k / (segment * dt);
+        result.coherence[k] = denominator > 0 ? std::min(1.0, std::norm(cross[k]) / denominator) : 0;
+
+        // A delay of the target appears as a phase lag, B = A exp(-i w delay)
+        result.phase[k] = -std::arg(cross[k]);
+    }
+
+    return result;
+}
@@ -0,0 +1,115 @@
+#ifndef TIME_ALIGNMENT_HPP
+#define TIME_ALIGNMENT_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "data_series.hpp"
+#include "fft_engine.hpp"
+
+
+/**
+ * @brief The TimeAlignment class estimates the time offset between two channels (e.g. the same quantity
+ * logged by two devices with different clocks), so their sources can be aligned (see DataSource::setTimeScaling).
+ *
+ * Each channel is decimated onto a common uniform grid using its summary pyramid (the mean of each cell is
+ * calculated from the coarsest buckets which fit, so the samples are not visited individually), and the
+ * offset is found at the peak of their cross-correlation, which is calculated with an FFT. The peak is
+ * interpolated between grid points, so the resolution is finer than the grid spacing. The cost depends on
+ * the number of grid points, rather than the number of samples, so hour-long logs are aligned in milliseconds.
+ *
+ * The same grid is used to analyse the relationship between two channels (e.g. a command and its response),
+ * as the correlation at each lag (see correlate), and the coherence at each frequency (see computeCoherence).
+ */
+class TimeAlignment
+{
+public:
+    //! Number of grid points onto which each channel is decimated
+    static const size_t DEFAULT_POINTS = 1 << 16;
+
+    struct Result
+    {
+        bool valid = false;
+
+        //! Time (ms) to add to the timestamps of the target, so that it aligns with the reference
+        double offset = 0;
+
+        //! Normalised correlation at the offset (1 for identical shapes)
+        double correlation = 0;
+
+        //! Spacing of the grid (ms)
+        double resolution = 0;
+    };
+
+    //! Number of grid points in each segment of a coherence estimate
+    static const size_t DEFAULT_SEGMENT = 256;
+
+    /**
+     * @brief The Spectrum struct holds the transform of a channel, decimated onto a grid (see transform).
+     * Spectra of the same grid can be correlated, so the spectrum of a channel can be re-used with other channels.
+     */
+    struct Spectrum
+    {
+        //! Grid, t0 + ii * dt for ii in [0, points)
+        double t0 = 0;
+        double dt = 0;
+        size_t points = 0;
+
+        //! Sum of the squares of the decimated channel (less its mean)
+        double energy = 0;
+
+        //! Transform of the decimated channel, zero padded to (at least) twice the number of points
+        std::vector<FFTComplex> bins;
+
+        bool isCompatible(const Spectrum& other) const { return t0 == other.t0 && dt == other.dt && points == other.points; }
+    };
+
+    /**
+     * @brief The Correlation struct holds the normalised cross-correlation of two channels at a range of offsets
+     */
+    struct Correlation
+    {
+        //! Correlation at each offset, getOffset(idx), from -maxShift to +maxShift cells
+        std::vector<double> values;
+
+        int64_t maxShift = 0;
+
+        //! Spacing of the offsets (ms)
+        double resolution = 0;
+
+        //! Offset at the peak of the correlation
+        Result peak;
+
+        double getOffset(size_t idx) const { return ((int64_t) idx - maxShift) * resolution; }
+    };
+
+    /**
+     * @brief The Coherence struct holds the magnitude-squared coherence of two channels, at each frequency
+     */
+    struct Coherence
+    {
+        //! Frequency of each bin (Hz)
+        std::vector<double> frequency;
+
+        //! Coherence of each bin, from 0 (unrelated) to 1 (linearly related)
+        std::vector<double> coherence;
+
+        //! Phase of the cross spectrum at each bin (radians), positive if the target lags the reference
+        std::vector<double> phase;
+
+        //! Number of (overlapping) segments which were averaged
+        size_t segments = 0;
+    };
+
+    static Result findOffset(const DataSnapshot& reference, const DataSnapshot& target, double maxLag = 0, size_t points = DEFAULT_POINTS);
+
+    static Spectrum transform(const DataSnapshot& snapshot, double t0, double dt, size_t points);
+    static Correlation correlate(const Spectrum& reference, const Spectrum& target, double maxLag = 0);
+
+    static Coherence computeCoherence(const DataSnapshot& reference, const DataSnapshot& target, double t0, double dt, size_t points,
+                                      size_t segment = DEFAULT_SEGMENT);
+
+    static void decimate(const DataSnapshot& snapshot, double t0, double dt, size_t n, std::vector<double>& output);
+};
+
+#endif // TIME_ALIGNMENT_HPP
@@ -0,0 +1,58 @@
+#ifndef TIME_TICKS_HPP
+#define TIME_TICKS_HPP
+
+#include <stdint.h>
+#include <cmath>
+
+
+/**
+ * @brief The TimeTicks class converts between timestamps (seconds, as doubles) and integer nanosecond ticks.
+ *
+ * Timestamps are stored as doubles, which cannot represent an epoch-based time (e.g. 1.7e9 seconds) to better
+ * than a few hundred nanoseconds. An importer which reads exact timestamps (see ParseKernels::parseTicks) stores
+ * them relative to an epoch base instead (see DataSeries::getEpochBase), which is a whole number of days, so the
+ * stored timestamps are small enough to retain nanosecond resolution for about a hundred days.
+ *
+ * Ticks are also used to compare timestamps exactly, e.g. to merge the samples of several series into rows:
+ * two timestamps are the same if they round to the same tick.
+ */
+class TimeTicks
+{
+public:
+    //! Number of ticks in one second (the unit of a timestamp)
+    static const int64_t PER_SECOND = 1000000000LL;
+
+    //! Number of ticks in a day (epoch bases are aligned to a day)
+    static const int64_t PER_DAY = 86400LL * PER_SECOND;
+
+    //! Timestamps beyond this range (seconds) do not have a tick
+    static constexpr double MAX_SECONDS = 9.2e9;
+
+    //! Nearest tick to a timestamp (a timestamp beyond the range of a tick is clamped)
+    static int64_t fromSeconds(double seconds)
+    {
+        if (!(seconds > -MAX_SECONDS)) return (int64_t) (-MAX_SECONDS * PER_SECOND);
+        if (!(seconds < MAX_SECONDS)) return (int64_t) (MAX_SECONDS * PER_SECOND);
+
+        return std::llround(seconds * PER_SECOND);
+    }
+
+    //! Timestamp of a tick (exact for up to 2^53 ticks, if the result is then converted back with fromSeconds)
+    static double toSeconds(int64_t ticks)
+    {
+        return (double) ticks / PER_SECOND;
+    }
+
+    //! Start of the (UTC) day containing a tick, which is used as the epoch base of a series
+    static int64_t getDayBase(int64_t ticks)
+    {
+        int64_t day = ticks / PER_DAY;
+
+        if (ticks % PER_DAY < 0) day--;
+
+        return day * PER_DAY;
+    }
+};
+
+
+#endif // TIME_TICKS_HPP
@@ -0,0 +1,224 @@
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+
+#include "trace_recorder.hpp"
+
+
+const size_t TraceRecorder::EVENTS_PER_THREAD;
+
+
+TraceRecorder::TraceRecorder()
+{
+    m_clock.start();
+}
+
+
+/**
+ * @brief TraceRecorder::getInstance - The recorder is created on first use (which may be from any thread)
+ */
+TraceRecorder* TraceRecorder::getInstance()
+{
+    static TraceRecorder recorder;
+
+    return &recorder;
+}
+
+
+/*
+ * Return the buffer of the calling thread, creating it on the first call from the thread
+ */
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer()
+{
+    thread_local ThreadBuffer *local = nullptr;
+
+    if (local) return local;
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+
+    buffer->events.resize(EVENTS_PER_THREAD);
+
+    const bool main = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+
+    QMutexLocker lock(&m_bufferMutex);
+
+    buffer->id = (int) m_buffers.size() + 1;
+    buffer->name = main ? QString("Main") : QString("Worker %1").arg(buffer->id);
+
+    local = buffer.get();
+    m_buffers.push_back(std::move(buffer));
+
+    return local;
+}
+
+
+/**
+ * @brief TraceRecorder::record - Record a span of the calling thread (without taking a lock)
+ * @param name - Name of the span (a string literal)
+ * @param category - Category of the span (a string literal)
+ * @param start - Start of the span (see now)
+ * @param duration - Duration of the span (ns)
+ */
+void TraceRecorder::record(const char *name, const char *category, int64_t start, int64_t duration)
+{
+    ThreadBuffer *buffer = getThreadBuffer();
+
+    const uint64_t idx = buffer->written.load(std::memory_order_relaxed);
+
+    Event &event = buffer->events[idx % EVENTS_PER_THREAD];
+
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = duration;
+
+    // Publish the event to the reader
+    buffer->written.store(idx + 1, std::memory_order_release);
+}
+
+
+/**
+ * @brief TraceRecorder::clear - Discard the events recorded so far (the threads continue to record)
+ */
+void TraceRecorder::clear()
+{
+    QMutexLocker lock(&m_bufferMutex);
+
+    for (auto &buffer : m_buffers)
+    {
+        buffer->cleared = buffer->written.load(std::memory_order_acquire);
+    }
+}
+
+
+size_t TraceRecorder::getEventCount()
+{
+    QMutexLocker lock(&m_bufferMutex);
+
+    size_t count = 0;
+
+    for (auto &buffer : m_buffers)
+    {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+
+        count += std::min<uint64_t>(written - buffer->cleared, EVENTS_PER_THREAD);
+    }
+
+    return count;
+}
+
+
+/*
+ * Copy the retained events of a buffer (the owning thread may still be recording).
+ * Any event which may have been overwritten while it was copied is discarded.
+ */
+std::vector<TraceRecorder::Event> TraceRecorder::takeEvents(const ThreadBuffer &buffer) const
+{
+    const uint64_t written = buffer.written.load(std::memory_order_acquire);
+
+    uint64_t first = std::max(buffer.cleared, written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0);
+
+    std::vector<Event> events;
+    events.reserve(written - first);
+
+    for (uint64_t idx = first; idx < written; idx++)
+    {
+        events.push_back(buffer.events[idx % EVENTS_PER_THREAD]);
+    }
+
+    const uint64_t after = buffer.written.load(std::memory_order_acquire);
+
+    if (after > EVENTS_PER_THREAD && after - EVENTS_PER_THREAD > first)
+    {
+        const size_t overwritten = std::min<uint64_t>(after - EVENTS_PER_THREAD - first, events.size());
+
+        events.erase(events.begin(), events.begin() + overwritten);
+    }
+
+    return events;
+}
+
+
+static void appendJsonString(QByteArray &output, const char *text)
+{
+    output += '"';
+
+    for (const char *c = text ? text : ""; *c; c++)
+    {
+        if (*c == '"' || *c == '\\') output += '\\';
+
+        output += *c;
+    }
+
+    output += '"';
+}
+
+
+/**
+ * @brief TraceRecorder::toChromeTrace - Format the recorded events as a Chrome trace (JSON), which can be
+ * opened by chrome://tracing or https://ui.perfetto.dev
+ */
+QByteArray TraceRecorder::toChromeTrace()
+{
+    QMutexLocker lock(&m_bufferMutex);
+
+    QByteArray output = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+
+    for (const auto &buffer : m_buffers)
+    {
+        const QByteArray tid = QByteArray::number(buffer->id);
+
+        // Metadata event which names the thread
+        output += first ? "" : ",\n";
+        output += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":";
+        appendJsonString(output, buffer->name.toUtf8().constData());
+        output += "}}";
+
+        first = false;
+
+        for (const Event &event : takeEvents(*buffer))
+        {
+            output += ",\n{\"ph\":\"X\",\"name\":";
+            appendJsonString(output, event.name);
+            output += ",\"cat\":";
+            appendJsonString(output, event.category);
+
+            // Timestamps are in microseconds
+            output += ",\"pid\":1,\"tid\":" + tid;
+            output += ",\"ts\":" + QByteArray::number(event.start * 1e-3, 'f', 3);
+            output += ",\"dur\":" + QByteArray::number(event.duration * 1e-3, 'f', 3);
+            output += "}";
+        }
+    }
+
+    output += "\n]}\n";
+
+    return output;
+}
+
+
+/**
+ * @brief TraceRecorder::writeChromeTrace - Write the recorded events to a file (see toChromeTrace)
+ */
+bool TraceRecorder::writeChromeTrace(const QString &filename, QStringList &errors)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        errors.append(QString("Could not open file for writing: %1").arg(filename));
+        return false;
+    }
+
+    if (file.write(toChromeTrace()) < 0)
+    {
+        errors.append(QString("Could not write to file: %1").arg(filename));
+        return false;
+    }
+
+    return true;
+}
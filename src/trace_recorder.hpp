@@ -0,0 +1,141 @@
+#ifndef TRACE_RECORDER_HPP
+#define TRACE_RECORDER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+
+/**
+ * @brief The TraceRecorder class records the duration of instrumented spans of code (see TRACE_SCOPE),
+ * so that a profile of a slow workflow can be exported as a Chrome trace (which Perfetto also opens).
+ *
+ * Each thread records into a private ring buffer, so recording an event does not take a lock (or allocate):
+ * only the owning thread writes to a buffer, and it publishes each event by advancing its (atomic) count.
+ * When the buffer of a thread is full, its oldest events are overwritten.
+ *
+ * Recording is disabled until setEnabled is called, when each span costs a single (relaxed) load.
+ * Building with CONFIG+=notrace defines LUMBERJACK_NO_TRACE, which removes the spans altogether.
+ */
+class TraceRecorder
+{
+public:
+    //! Capacity of the ring buffer of each thread
+    static const size_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event
+    {
+        //! Name and category must be string literals (only the pointers are recorded)
+        const char *name = nullptr;
+        const char *category = nullptr;
+
+        //! Start and duration of the span (ns since the recorder was created)
+        int64_t start = 0;
+        int64_t duration = 0;
+    };
+
+    static TraceRecorder* getInstance(void);
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled(void) const { return m_enabled.load(std::memory_order_relaxed); }
+
+    int64_t now(void) const { return m_clock.nsecsElapsed(); }
+
+    void record(const char *name, const char *category, int64_t start, int64_t duration);
+
+    void clear(void);
+
+    size_t getEventCount(void);
+
+    QByteArray toChromeTrace(void);
+    bool writeChromeTrace(const QString &filename, QStringList &errors);
+
+protected:
+    TraceRecorder(void);
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+
+        //! Number of events recorded by the thread (written only by the owning thread)
+        std::atomic<uint64_t> written{0};
+
+        //! Events before this count have been cleared (accessed only with the buffer mutex held)
+        uint64_t cleared = 0;
+
+        int id = 0;
+        QString name;
+    };
+
+    ThreadBuffer* getThreadBuffer(void);
+
+    std::vector<Event> takeEvents(const ThreadBuffer &buffer) const;
+
+    std::atomic<bool> m_enabled{false};
+
+    QElapsedTimer m_clock;
+
+    //! A buffer is created for each thread which records an event, and retained until exit
+    QMutex m_bufferMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+
+/**
+ * @brief The TraceScope class records the span of its own lifetime (if the recorder is enabled when it is created)
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char *name, const char *category) : m_name(name), m_category(category)
+    {
+        auto *recorder = TraceRecorder::getInstance();
+
+        if (recorder->isEnabled())
+        {
+            m_start = recorder->now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_start >= 0)
+        {
+            auto *recorder = TraceRecorder::getInstance();
+
+            recorder->record(m_name, m_category, m_start, recorder->now() - m_start);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+protected:
+    const char *m_name;
+    const char *m_category;
+
+    int64_t m_start = -1;
+};
+
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef LUMBERJACK_NO_TRACE
+#define TRACE_SCOPE(name, category) ((void) 0)
+#else
+//! Record the span from this statement to the end of the enclosing scope
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, category)
+#endif
+
+
+#endif // TRACE_RECORDER_HPP
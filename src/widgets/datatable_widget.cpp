@@ -1,24 +1,112 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <QBrush>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QKeyEvent>
+
 #include "datatable_widget.hpp"
 
 
-DataSeriesTableModel::DataSeriesTableModel(DataSeriesPointer series, QObject* parent) : QAbstractTableModel(parent)
+//! Interval between refreshes of the table, while the series are updated
+static const int TABLE_REFRESH_INTERVAL = 250;
+
+
+/*
+ * Map a timestamp to an integer with the same order (for a binary search over every possible timestamp)
+ */
+static int64_t getTimestampKey(double t)
 {
-    this->series = series;
+    int64_t bits;
+
+    memcpy(&bits, &t, sizeof(bits));
+
+    return bits >= 0 ? bits : std::numeric_limits<int64_t>::min() - bits - 1;
 }
 
 
-int DataSeriesTableModel::rowCount(const QModelIndex &parent) const
+static double getKeyTimestamp(int64_t key)
 {
-    Q_UNUSED(parent);
+    const int64_t bits = key >= 0 ? key : std::numeric_limits<int64_t>::min() - key - 1;
+
+    double t;
+
+    memcpy(&t, &bits, sizeof(t));
+
+    return t;
+}
+
+
+DataSeriesTableModel::DataSeriesTableModel(DataSeriesPointer s, QObject* parent) :
+    DataSeriesTableModel(QList<DataSeriesPointer>({ s }), parent)
+{
+}
+
+
+DataSeriesTableModel::DataSeriesTableModel(const QList<DataSeriesPointer> &seriesList, QObject* parent) : QAbstractTableModel(parent)
+{
+    for (const auto &s : seriesList)
+    {
+        if (s.isNull()) continue;
+
+        series.append(s);
+
+        connect(s.data(), &DataSeries::dataChanged, this, &DataSeriesTableModel::scheduleRefresh);
+    }
+
+    refreshTimer.setSingleShot(true);
+
+    connect(&refreshTimer, &QTimer::timeout, this, &DataSeriesTableModel::refresh);
+
+    for (const auto &s : series)
+    {
+        snapshots.append(s->getSnapshot());
+        totalRows += snapshots.last().size();
+    }
+}
 
-    if (series.isNull())
+
+void DataSeriesTableModel::scheduleRefresh()
+{
+    if (!refreshTimer.isActive())
     {
-        return 0;
+        refreshTimer.start(TABLE_REFRESH_INTERVAL);
     }
-    else
+}
+
+
+/**
+ * @brief DataSeriesTableModel::refresh - Read new snapshots of the series, and discard the cached rows
+ */
+void DataSeriesTableModel::refresh()
+{
+    beginResetModel();
+
+    snapshots.clear();
+    totalRows = 0;
+
+    for (const auto &s : series)
     {
-        return series->size();
+        snapshots.append(s->getSnapshot());
+        totalRows += snapshots.last().size();
     }
+
+    chunks.clear();
+    chunkOrder.clear();
+
+    endResetModel();
+}
+
+
+int DataSeriesTableModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+
+    return (int) std::min<uint64_t>(totalRows, std::numeric_limits<int>::max());
 }
 
 
@@ -26,39 +114,287 @@ int DataSeriesTableModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
 
-    return 2;
+    return 1 + series.count();
 }
 
 
 QVariant DataSeriesTableModel::data(const QModelIndex &index, int role) const
 {
-    if (role == Qt::DisplayRole)
+    const int row = index.row();
+    const int col = index.column();
+
+    // Out of bounds
+    if (row < 0 || row >= rowCount() || col < 0 || col >= columnCount())
     {
-        int row = index.row();
-        int col = index.column();
+        return QVariant();
+    }
+
+    if (role != Qt::DisplayRole && role != Qt::ForegroundRole)
+    {
+        return QVariant();
+    }
+
+    auto chunk = getChunk(row / CHUNK_SIZE);
 
-        // Out of bounds
-        if (series.isNull() || row < 0 || row >= series->size())
+    const int idx = row % CHUNK_SIZE;
+
+    if (!chunk || idx >= (int) chunk->timestamps.size())
+    {
+        return QVariant();
+    }
+
+    if (role == Qt::ForegroundRole)
+    {
+        // Values which are held from an earlier sample of the series
+        if (col > 0 && chunk->owners[idx] != col - 1)
         {
-            return QVariant();
+            return QBrush(Qt::gray);
         }
 
-        DataPoint point = series->getDataPoint(row);
+        return QVariant();
+    }
+
+    if (col == 0)
+    {
+        return chunk->timestamps[idx];
+    }
+
+    const double value = chunk->values[(size_t) idx * series.count() + col - 1];
+
+    return std::isnan(value) ? QVariant() : QVariant(value);
+}
 
-        switch (col)
+
+QVariant DataSeriesTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal)
+    {
+        if (section == 0) return tr("Timestamp");
+
+        if (section > 0 && section <= series.count())
         {
-        case 0:
-            return point.timestamp;
-        case 1:
-            return point.value;
-        default:
-            return "Invalid index: " + QString::number(col);
+            return series.count() > 1 ? series.at(section - 1)->getLabel() : tr("Value");
         }
     }
-    else
+
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+
+/**
+ * @brief DataSeriesTableModel::getRowForTimestamp - Return the first row with a timestamp >= t (or the last row)
+ */
+int DataSeriesTableModel::getRowForTimestamp(double t) const
+{
+    uint64_t row = 0;
+
+    for (const auto &snapshot : snapshots)
     {
-        return QVariant();
+        row += snapshot.lowerBound(t);
+    }
+
+    return (int) std::min<uint64_t>(row, std::max(rowCount() - 1, 0));
+}
+
+
+double DataSeriesTableModel::getTimestamp(int row) const
+{
+    auto chunk = getChunk(row / CHUNK_SIZE);
+
+    const int idx = row % CHUNK_SIZE;
+
+    if (!chunk || row < 0 || idx >= (int) chunk->timestamps.size()) return std::nan("");
+
+    return chunk->timestamps[idx];
+}
+
+
+/**
+ * @brief DataSeriesTableModel::getMergePosition - Find the position of a row within the merged timeline
+ * @param row - Index of the row
+ * @return the number of samples of each series which precede the row
+ */
+std::vector<uint64_t> DataSeriesTableModel::getMergePosition(uint64_t row) const
+{
+    const int n = snapshots.count();
+
+    std::vector<uint64_t> position(n, 0);
+
+    if (n == 1)
+    {
+        position[0] = std::min<uint64_t>(row, snapshots[0].size());
+        return position;
+    }
+
+    if (row == 0 || row >= totalRows) return position;
+
+    // Find the timestamp of the row: the smallest t for which more than "row" samples are <= t
+    int64_t lo = std::numeric_limits<int64_t>::max();
+    int64_t hi = std::numeric_limits<int64_t>::min();
+
+    for (const auto &snapshot : snapshots)
+    {
+        if (snapshot.isEmpty()) continue;
+
+        lo = std::min(lo, getTimestampKey(snapshot.getTimestamp(0)));
+        hi = std::max(hi, getTimestampKey(snapshot.getTimestamp(snapshot.size() - 1)));
+    }
+
+    auto countBefore = [&](double t) {
+        uint64_t count = 0;
+
+        for (const auto &snapshot : snapshots)
+        {
+            count += snapshot.upperBound(t);
+        }
+
+        return count;
+    };
+
+    while (lo < hi)
+    {
+        const int64_t mid = lo + (int64_t) (((uint64_t) hi - (uint64_t) lo) / 2);
+
+        if (countBefore(getKeyTimestamp(mid)) > row)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    const double t = getKeyTimestamp(lo);
+
+    uint64_t preceding = 0;
+
+    for (int ii = 0; ii < n; ii++)
+    {
+        position[ii] = snapshots[ii].lowerBound(t);
+        preceding += position[ii];
+    }
+
+    // Samples at exactly t are ordered by series
+    uint64_t remaining = row - preceding;
+
+    for (int ii = 0; ii < n && remaining > 0; ii++)
+    {
+        const uint64_t equal = std::min<uint64_t>(remaining, snapshots[ii].upperBound(t) - position[ii]);
+
+        position[ii] += equal;
+        remaining -= equal;
+    }
+
+    return position;
+}
+
+
+DataSeriesTableModel::ChunkPointer DataSeriesTableModel::getChunk(int chunk) const
+{
+    auto it = chunks.find(chunk);
+
+    if (it != chunks.end())
+    {
+        // Most recently used chunks are at the end
+        auto order = std::find(chunkOrder.begin(), chunkOrder.end(), chunk);
+
+        if (order != chunkOrder.end() && order + 1 != chunkOrder.end())
+        {
+            chunkOrder.erase(order);
+            chunkOrder.push_back(chunk);
+        }
+
+        return it->second;
+    }
+
+    auto result = fetchChunk(chunk);
+
+    chunks[chunk] = result;
+    chunkOrder.push_back(chunk);
+
+    while (chunkOrder.size() > MAX_CACHED_CHUNKS)
+    {
+        chunks.erase(chunkOrder.front());
+        chunkOrder.erase(chunkOrder.begin());
     }
+
+    return result;
+}
+
+
+/*
+ * Read the rows of a chunk, by merging the samples of each series from the position of the first row
+ */
+DataSeriesTableModel::ChunkPointer DataSeriesTableModel::fetchChunk(int chunk) const
+{
+    auto result = std::make_shared<Chunk>();
+
+    const uint64_t first = (uint64_t) chunk * CHUNK_SIZE;
+
+    if (first >= totalRows) return result;
+
+    const size_t rows = std::min<uint64_t>(CHUNK_SIZE, totalRows - first);
+    const int n = snapshots.count();
+
+    const std::vector<uint64_t> position = getMergePosition(first);
+
+    // Samples of each series, from the sample before the chunk (the value which is held at the first row)
+    std::vector<std::vector<double>> timestamps(n);
+    std::vector<std::vector<double>> values(n);
+
+    std::vector<size_t> next(n, 0);
+    std::vector<double> held(n, std::nan(""));
+
+    for (int ii = 0; ii < n; ii++)
+    {
+        const uint64_t a = position[ii] > 0 ? position[ii] - 1 : 0;
+        const uint64_t b = std::min<uint64_t>(position[ii] + rows, snapshots[ii].size());
+
+        const DataView view = snapshots[ii].getView(a, b);
+
+        timestamps[ii].resize(view.size());
+        values[ii].resize(view.size());
+
+        view.copyTimestamps(timestamps[ii].data());
+        view.copyValues(values[ii].data());
+
+        next[ii] = position[ii] - a;
+
+        if (position[ii] > 0) held[ii] = values[ii][0];
+    }
+
+    result->timestamps.reserve(rows);
+    result->owners.reserve(rows);
+    result->values.reserve(rows * n);
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        int owner = -1;
+
+        // The earliest next sample (ties are taken in series order)
+        for (int ii = 0; ii < n; ii++)
+        {
+            if (next[ii] >= timestamps[ii].size()) continue;
+
+            if (owner < 0 || timestamps[ii][next[ii]] < timestamps[owner][next[owner]])
+            {
+                owner = ii;
+            }
+        }
+
+        if (owner < 0) break;
+
+        held[owner] = values[owner][next[owner]];
+
+        result->timestamps.push_back(timestamps[owner][next[owner]]);
+        result->owners.push_back(owner);
+        result->values.insert(result->values.end(), held.begin(), held.end());
+
+        next[owner]++;
+    }
+
+    return result;
 }
 
 
@@ -66,22 +402,103 @@ DataSeriesTableView::DataSeriesTableView(DataSeriesPointer series, QWidget *pare
     QTableView(parent),
     model(series)
 {
-    model.setHeaderData(0, Qt::Vertical, tr("Timestamp"));
-    model.setHeaderData(1, Qt::Horizontal, tr("Value"));
+    init();
+}
+
 
+DataSeriesTableView::DataSeriesTableView(const QList<DataSeriesPointer> &series, QWidget *parent) :
+    QTableView(parent),
+    model(series)
+{
+    init();
+}
+
+
+void DataSeriesTableView::init()
+{
     setModel(&model);
 
     setAlternatingRowColors(true);
 
-    if (!series.isNull())
-    {
-        QString title = series->getLabel();
+    horizontalHeader()->setStretchLastSection(true);
+
+    QStringList labels;
 
-        setWindowTitle(title);
+    for (const auto &series : model.getDataSeries())
+    {
+        labels.append(series->getLabel());
     }
+
+    setWindowTitle(labels.join(", "));
+
+    // The rows which are visible are retained when the model is refreshed
+    connect(&model, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+        const int row = rowAt(0);
+
+        restoreTop = row >= 0;
+
+        if (restoreTop) topTimestamp = model.getTimestamp(row);
+    });
+
+    connect(&model, &QAbstractItemModel::modelReset, this, [this]() {
+        if (restoreTop)
+        {
+            scrollTo(model.index(model.getRowForTimestamp(topTimestamp), 0), QAbstractItemView::PositionAtTop);
+        }
+    });
 }
 
 
 DataSeriesTableView::~DataSeriesTableView()
 {
 }
+
+
+/**
+ * @brief DataSeriesTableView::scrollToTimestamp - Scroll to (and select) the first row at or after a timestamp
+ */
+void DataSeriesTableView::scrollToTimestamp(double t)
+{
+    if (model.rowCount() == 0) return;
+
+    const int row = model.getRowForTimestamp(t);
+
+    scrollTo(model.index(row, 0), QAbstractItemView::PositionAtCenter);
+    selectRow(row);
+}
+
+
+/**
+ * @brief DataSeriesTableView::goToTimestamp - Ask the user for a timestamp, and scroll to it
+ */
+void DataSeriesTableView::goToTimestamp()
+{
+    const int row = std::max(currentIndex().row(), rowAt(0));
+
+    bool ok = false;
+
+    const double t = QInputDialog::getDouble(
+        this,
+        tr("Go to Timestamp"),
+        tr("Timestamp"),
+        row >= 0 ? model.getTimestamp(row) : 0,
+        -DBL_MAX, DBL_MAX, 3, &ok
+    );
+
+    if (ok)
+    {
+        scrollToTimestamp(t);
+    }
+}
+
+
+void DataSeriesTableView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Find) || event->keyCombination() == QKeyCombination(Qt::ControlModifier, Qt::Key_G))
+    {
+        goToTimestamp();
+        return;
+    }
+
+    QTableView::keyPressEvent(event);
+}
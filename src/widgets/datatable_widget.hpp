@@ -1,26 +1,91 @@
 #ifndef DATATABLE_WIDGET_HPP
 #define DATATABLE_WIDGET_HPP
 
+#include <map>
+#include <memory>
+#include <vector>
+
 #include <qtableview.h>
 #include <qwidget.h>
+#include <QTimer>
 
 #include "data_series.hpp"
 
 
+/**
+ * @brief The DataSeriesTableModel class presents the samples of one or more series as a table.
+ *
+ * The rows follow the merged timeline of every series (samples with equal timestamps are ordered by
+ * series): each row holds the sample of one series, and the other columns hold the most recent value
+ * of each other series at that time (shown greyed out).
+ *
+ * Rows are read from snapshots of the series in chunks, which are cached, so that scrolling through
+ * a large series does not look up each sample separately. Any row can be located by timestamp
+ * (see getRowForTimestamp) without reading the rows before it.
+ */
 class DataSeriesTableModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
     DataSeriesTableModel(DataSeriesPointer series, QObject *parent = nullptr);
+    DataSeriesTableModel(const QList<DataSeriesPointer> &series, QObject *parent = nullptr);
+
+    //! Number of rows fetched at once
+    static const int CHUNK_SIZE = 1024;
+
+    //! Maximum number of cached chunks
+    static const size_t MAX_CACHED_CHUNKS = 64;
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    const QList<DataSeriesPointer>& getDataSeries(void) const { return series; }
+
+    int getRowForTimestamp(double t) const;
+    double getTimestamp(int row) const;
+
+    std::vector<uint64_t> getMergePosition(uint64_t row) const;
+
+public slots:
+    void refresh(void);
 
 protected:
-    DataSeriesPointer series;
+    /**
+     * @brief The Chunk struct holds a block of consecutive rows
+     */
+    struct Chunk
+    {
+        std::vector<double> timestamps;
+
+        //! Value of each series, row by row (NaN before the first sample of a series)
+        std::vector<double> values;
+
+        //! Series which provides the sample of each row
+        std::vector<int> owners;
+    };
+
+    typedef std::shared_ptr<const Chunk> ChunkPointer;
+
+    ChunkPointer getChunk(int chunk) const;
+    ChunkPointer fetchChunk(int chunk) const;
+
+    void scheduleRefresh(void);
+
+    QList<DataSeriesPointer> series;
+    QList<DataSnapshot> snapshots;
+
+    uint64_t totalRows = 0;
+
+    //! Cached chunks, and the order in which they were used
+    mutable std::map<int, ChunkPointer> chunks;
+    mutable std::vector<int> chunkOrder;
+
+    //! Coalesces updates of the series
+    QTimer refreshTimer;
 };
 
 
@@ -30,10 +95,23 @@ class DataSeriesTableView : public QTableView
 
 public:
     DataSeriesTableView(DataSeriesPointer series, QWidget *parent = nullptr);
+    DataSeriesTableView(const QList<DataSeriesPointer> &series, QWidget *parent = nullptr);
     virtual ~DataSeriesTableView();
 
+public slots:
+    void scrollToTimestamp(double t);
+    void goToTimestamp(void);
+
 protected:
+    virtual void keyPressEvent(QKeyEvent *event) override;
+
+    void init(void);
+
     DataSeriesTableModel model;
+
+    //! Timestamp of the top row, which is restored after the model is refreshed
+    double topTimestamp = 0;
+    bool restoreTop = false;
 };
 
 
@@ -1,13 +1,27 @@
+#include <algorithm>
+#include <limits>
+
 #include <QDrag>
+#include <QInputDialog>
+#include <QLineEdit>
 #include <QMimeData>
+#include <QSet>
+#include <QMessageBox>
+#include <QRegularExpression>
 #include <qmenu.h>
 #include <qaction.h>
 #include <qheaderview.h>
 
+#include "concatenated_series.hpp"
 #include "datatable_widget.hpp"
 #include "series_editor_dialog.hpp"
 #include "dataview_tree.hpp"
 #include "data_source_manager.hpp"
+#include "helpers.hpp"
+#include "time_alignment.hpp"
+
+
+const int DataViewTree::MEMORY_UPDATE_INTERVAL;
 
 
 DataViewTree::DataViewTree(QWidget *parent) : QTreeWidget(parent)
@@ -21,6 +35,11 @@ DataViewTree::DataViewTree(QWidget *parent) : QTreeWidget(parent)
     connect(this, &QTreeWidget::customContextMenuRequested, this, &DataViewTree::onContextMenu);
 
     setAlternatingRowColors(true);
+
+    // Memory usage changes as series are imported, compressed and cached
+    connect(&memoryTimer, &QTimer::timeout, this, &DataViewTree::updateMemoryUsage);
+
+    memoryTimer.start(MEMORY_UPDATE_INTERVAL);
 }
 
 DataViewTree::~DataViewTree()
@@ -38,10 +57,11 @@ void DataViewTree::setupTree()
 
     QStringList labels;
 
-    setColumnCount(2);
+    setColumnCount(3);
 
     labels.append("");
     labels.append(tr("Label"));
+    labels.append(tr("Memory"));
 
     setHeaderLabels(labels);
 
@@ -56,7 +76,8 @@ void DataViewTree::setupTree()
 
     header()->setSectionResizeMode(0, QHeaderView::Fixed);
     header()->setSectionResizeMode(1, QHeaderView::Stretch);
-    header()->setStretchLastSection(true);
+    header()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+    header()->setStretchLastSection(false);
     header()->resizeSection(0, 55);
 }
 
@@ -77,6 +98,16 @@ void DataViewTree::editDataSeries(DataSeriesPointer series)
 
     if (result)
     {
+        auto *manager = DataSourceManager::getInstance();
+
+        // The label or group of the series may have changed
+        for (int ii = 0; ii < manager->getSourceCount(); ii++)
+        {
+            auto source = manager->getSourceByIndex(ii);
+
+            if (!source.isNull()) source->invalidateSearchIndex();
+        }
+
         refresh(filterString);
     }
 
@@ -132,6 +163,10 @@ void DataViewTree::onContextMenu(const QPoint &pos)
         // View data
         QAction *viewSeriesData = new QAction(tr("View Data"), &menu);
 
+        // Align the clock of the source with another source
+        QAction *alignSource = new QAction(tr("Align Source To..."), &menu);
+        alignSource->setEnabled(manager->getSourceCount() > 1);
+
         // Delete series
         QAction *deleteSeries = new QAction(tr("Delete Series"), &menu);
 
@@ -139,6 +174,7 @@ void DataViewTree::onContextMenu(const QPoint &pos)
         menu.addSeparator();
         menu.addAction(editSeries);
         menu.addAction(viewSeriesData);
+        menu.addAction(alignSource);
         menu.addSeparator();
         menu.addAction(deleteSeries);
 
@@ -160,6 +196,10 @@ void DataViewTree::onContextMenu(const QPoint &pos)
             DataSeriesTableView *table = new DataSeriesTableView(series);
             table->show();
         }
+        else if (action == alignSource)
+        {
+            alignSourceTo(source, series);
+        }
         else if (action == deleteSeries)
         {
             emit onSeriesRemoved(series);
@@ -178,6 +218,55 @@ void DataViewTree::onContextMenu(const QPoint &pos)
             return;
         }
 
+        // Stop importing data appended to the file
+        QAction *stopFollowing = nullptr;
+
+        if (manager->isFollowing(source))
+        {
+            stopFollowing = new QAction(tr("Stop Following File"), &menu);
+
+            menu.addAction(stopFollowing);
+            menu.addSeparator();
+        }
+
+        // Memory management
+        QAction *releaseCaches = new QAction(tr("Drop Caches"), &menu);
+        QAction *compressSource = new QAction(tr("Compress Series"), &menu);
+        QAction *spillSource = new QAction(tr("Move Samples to Disk"), &menu);
+
+        menu.addAction(releaseCaches);
+        menu.addAction(compressSource);
+        menu.addAction(spillSource);
+        menu.addSeparator();
+
+        // Time alignment
+        QAction *timeOffset = new QAction(tr("Set Time Offset..."), &menu);
+        QAction *timeScale = new QAction(tr("Set Time Scale..."), &menu);
+
+        menu.addAction(timeOffset);
+        menu.addAction(timeScale);
+        menu.addSeparator();
+
+        // Time window (the samples outside the window are hidden, not discarded)
+        QAction *cropSource = new QAction(tr("Crop to Time Range..."), &menu);
+        QAction *uncropSource = nullptr;
+
+        menu.addAction(cropSource);
+
+        if (source->hasTimeWindow())
+        {
+            uncropSource = new QAction(tr("Remove Crop"), &menu);
+            menu.addAction(uncropSource);
+        }
+
+        menu.addSeparator();
+
+        // Concatenation (e.g. of the files of a test which was split across several logs)
+        QAction *concatenateSource = new QAction(tr("Concatenate Matching Sources..."), &menu);
+
+        menu.addAction(concatenateSource);
+        menu.addSeparator();
+
         // Delete source
         QAction *deleteSource = new QAction(tr("Delete Source"), &menu);
 
@@ -185,7 +274,60 @@ void DataViewTree::onContextMenu(const QPoint &pos)
 
         QAction *action = menu.exec(mapToGlobal(pos));
 
-        if (action == deleteSource)
+        if (action && action == stopFollowing)
+        {
+            manager->stopFollowing(source);
+        }
+        else if (action == releaseCaches)
+        {
+            source->releaseCaches();
+            updateMemoryUsage();
+        }
+        else if (action == compressSource)
+        {
+            source->compressSeries();
+            updateMemoryUsage();
+        }
+        else if (action == spillSource)
+        {
+            if (!source->spillToStore())
+            {
+                QMessageBox::warning(this, tr("Move Samples to Disk"), tr("Could not create a scratch file"));
+            }
+
+            updateMemoryUsage();
+        }
+        else if (action == timeOffset)
+        {
+            bool ok = false;
+
+            double offset = QInputDialog::getDouble(this, tr("Set Time Offset"), tr("Offset (ms) added to each timestamp of %1").arg(source->getLabel()),
+                                                    source->getTimeOffset(), -1e15, 1e15, 3, &ok);
+
+            if (ok) source->setTimeScaling(source->getTimeScale(), offset);
+        }
+        else if (action == timeScale)
+        {
+            bool ok = false;
+
+            double scale = QInputDialog::getDouble(this, tr("Set Time Scale"), tr("Scale applied to each timestamp of %1 (clock drift)").arg(source->getLabel()),
+                                                   source->getTimeScale(), 1e-6, 1e6, 9, &ok);
+
+            if (ok) source->setTimeScaling(scale, source->getTimeOffset());
+        }
+        else if (action == cropSource)
+        {
+            cropSourceTo(source);
+        }
+        else if (action && action == uncropSource)
+        {
+            source->clearTimeWindow();
+        }
+        else if (action == concatenateSource)
+        {
+            concatenateSources(source);
+        }
+        else if (action == deleteSource)
         {
             // Emit "removed" signal for each data series
             for (auto label : source->getSeriesLabels())
@@ -203,6 +345,164 @@ void DataViewTree::onContextMenu(const QPoint &pos)
 }
 
 
+/*
+ * Crop a source to a range of time, which defaults to the current window (or to every stored sample)
+ */
+void DataViewTree::cropSourceTo(DataSourcePointer source)
+{
+    double t_min = source->getTimeWindowStart();
+    double t_max = source->getTimeWindowEnd();
+
+    if (!source->hasTimeWindow())
+    {
+        t_min = std::numeric_limits<double>::infinity();
+        t_max = -std::numeric_limits<double>::infinity();
+
+        for (int idx = 0; idx < source->getSeriesCount(); idx++)
+        {
+            auto series = source->getSeriesByIndex(idx);
+
+            if (series.isNull()) continue;
+
+            const DataSnapshot stored = series->getStoredSnapshot();
+
+            if (stored.isEmpty()) continue;
+
+            t_min = std::min(t_min, stored.getTimestamp(0));
+            t_max = std::max(t_max, stored.getTimestamp(stored.size() - 1));
+        }
+
+        if (t_min > t_max) return;
+    }
+
+    bool ok = false;
+
+    const double start = QInputDialog::getDouble(this, tr("Crop to Time Range"), tr("Start time (ms) of %1").arg(source->getLabel()),
+                                                 t_min, -1e15, 1e15, 3, &ok);
+
+    if (!ok) return;
+
+    const double end = QInputDialog::getDouble(this, tr("Crop to Time Range"), tr("End time (ms) of %1").arg(source->getLabel()),
+                                               std::max(t_max, start), start, 1e15, 3, &ok);
+
+    if (ok) source->setTimeWindow(start, end);
+}
+
+
+/*
+ * Concatenate the sources whose labels match a wildcard pattern (which defaults to the label of the source,
+ * with each number replaced by a wildcard, so that run_001.csv matches run_002.csv, ...)
+ */
+void DataViewTree::concatenateSources(DataSourcePointer source)
+{
+    auto *manager = DataSourceManager::getInstance();
+
+    QString pattern = source->getLabel();
+    pattern.replace(QRegularExpression("\\d+"), "*");
+
+    bool ok = false;
+
+    pattern = QInputDialog::getText(this, tr("Concatenate Sources"), tr("Concatenate the sources whose labels match"),
+                                    QLineEdit::Normal, pattern, &ok);
+
+    if (!ok || pattern.isEmpty()) return;
+
+    const QRegularExpression regex(QRegularExpression::wildcardToRegularExpression(pattern));
+
+    QList<DataSourcePointer> sources;
+
+    for (int ii = 0; ii < manager->getSourceCount(); ii++)
+    {
+        auto other = manager->getSourceByIndex(ii);
+
+        if (!other.isNull() && regex.match(other->getLabel()).hasMatch()) sources.append(other);
+    }
+
+    QStringList errors;
+
+    auto result = ConcatenatedSeries::concatenateSources(sources, errors);
+
+    if (result.isNull())
+    {
+        QMessageBox::warning(this, tr("Concatenate Sources"), errors.join("\n"));
+        return;
+    }
+
+    manager->addSource(result);
+}
+
+
+/*
+ * Align the source of a series with another source, by estimating the offset
+ * between the series and a series of the other source (e.g. the same quantity)
+ */
+void DataViewTree::alignSourceTo(DataSourcePointer source, DataSeriesPointer series)
+{
+    auto *manager = DataSourceManager::getInstance();
+
+    QStringList items;
+    QList<DataSeriesPointer> candidates;
+
+    for (int ii = 0; ii < manager->getSourceCount(); ii++)
+    {
+        auto other = manager->getSourceByIndex(ii);
+
+        if (other.isNull() || other == source) continue;
+
+        for (const auto &label : other->getSeriesLabels())
+        {
+            auto candidate = other->getSeriesByLabel(label);
+
+            if (candidate.isNull()) continue;
+
+            items << QString("%1: %2").arg(other->getLabel()).arg(label);
+            candidates << candidate;
+        }
+    }
+
+    if (items.isEmpty()) return;
+
+    bool ok = false;
+
+    // Select the series with the same label by default
+    int current = 0;
+
+    for (int ii = 0; ii < candidates.size(); ii++)
+    {
+        if (candidates[ii]->getLabel() == series->getLabel())
+        {
+            current = ii;
+            break;
+        }
+    }
+
+    QString selected = QInputDialog::getItem(this, tr("Align Source"), tr("Align %1 to").arg(source->getLabel()), items, current, false, &ok);
+
+    if (!ok) return;
+
+    auto reference = candidates.value(items.indexOf(selected));
+
+    if (reference.isNull()) return;
+
+    auto result = TimeAlignment::findOffset(reference->getSnapshot(), series->getSnapshot());
+
+    if (!result.valid)
+    {
+        QMessageBox::warning(this, tr("Align Source"), tr("Could not align %1 with %2").arg(series->getLabel()).arg(reference->getLabel()));
+        return;
+    }
+
+    source->setTimeScaling(source->getTimeScale(), source->getTimeOffset() + result.offset);
+
+    QMessageBox::information(this, tr("Align Source"),
+                             tr("Shifted %1 by %2 ms (correlation %3, resolution %4 ms)")
+                                 .arg(source->getLabel())
+                                 .arg(result.offset, 0, 'g', 9)
+                                 .arg(result.correlation, 0, 'f', 3)
+                                 .arg(result.resolution, 0, 'g', 3));
+}
+
+
 /*
  * Callback when user double-clicks on an item
  */
@@ -235,20 +535,15 @@ void DataViewTree::onItemDoubleClicked(QTreeWidgetItem *item, int col)
 
 
 /*
- * Refresh (redraw) the tree, based on user filtering.
+ * Refresh the tree (adding and removing items for any sources and series which have changed), and apply the filter
  */
 int DataViewTree::refresh(QString filters)
 {
     setUpdatesEnabled(false);
 
-    setupTree();
-
-    // Save the filter text
-    filterString = filters;
-
     auto *manager = DataSourceManager::getInstance();
 
-    int series_count = 0;
+    QList<SourceItem> items;
 
     for (int ii = 0; ii < manager->getSourceCount(); ii++)
     {
@@ -256,61 +551,254 @@ int DataViewTree::refresh(QString filters)
 
         if (source.isNull()) continue;
 
-        QStringList labels = source->getSeriesLabels(filters);
-
-        // Add a header item for this "data source"
-        QTreeWidgetItem *item = new QTreeWidgetItem();
+        // Items of existing sources are re-used
+        SourceItem entry;
 
-        QString uid = source->getIdentifier();
+        for (int jj = 0; jj < sourceItems.count(); jj++)
+        {
+            if (sourceItems[jj].source == source)
+            {
+                entry = sourceItems.takeAt(jj);
+                break;
+            }
+        }
 
-        item->setText(1, source->getLabel());
+        if (!entry.item)
+        {
+            entry.source = source;
+            entry.item = new QTreeWidgetItem();
 
-        // Embolden text for "source"
-        QFont font = item->font(1);
-        font.setBold(true);
-        item->setFont(1, font);
+            // Embolden text for "source"
+            QFont font = entry.item->font(1);
+            font.setBold(true);
+            entry.item->setFont(1, font);
+        }
 
-        int idx = topLevelItemCount();
+        entry.item->setText(1, source->getLabel());
 
-        if (labels.isEmpty() && !filters.isEmpty())
+        // Sources are displayed in the order of the manager
+        if (indexOfTopLevelItem(entry.item) != items.count())
         {
-            continue;
+            if (indexOfTopLevelItem(entry.item) >= 0)
+            {
+                takeTopLevelItem(indexOfTopLevelItem(entry.item));
+            }
+
+            insertTopLevelItem(items.count(), entry.item);
         }
 
-        insertTopLevelItem(idx, item);
+        updateSourceItem(entry);
 
-        // Construct a flat list of childItems to add to the tree in a single operation
-        QList<QTreeWidgetItem*> childItems;
+        items.append(entry);
+    }
+
+    // Sources which have been removed
+    for (auto &entry : sourceItems)
+    {
+        delete entry.item;
+    }
 
-        for (QString series_label : labels)
+    sourceItems = items;
+
+    const int series_count = applyFilter(filters);
+
+    updateMemoryUsage();
+
+    setUpdatesEnabled(true);
+
+    return series_count;
+}
+
+
+/*
+ * Synchronize the series items of a source with its series (items of unchanged series are retained)
+ */
+void DataViewTree::updateSourceItem(SourceItem &entry)
+{
+    const QStringList labels = entry.source->getSeriesLabels();
+
+    QList<QWeakPointer<DataSeries>> series;
+    QList<QTreeWidgetItem*> children;
+
+    QHash<DataSeries*, int> existing;
+
+    for (int idx = 0; idx < entry.series.count(); idx++)
+    {
+        if (!entry.series[idx].isNull())
         {
-            auto series = source->getSeriesByLabel(series_label);
+            existing.insert(entry.series[idx].toStrongRef().data(), idx);
+        }
+    }
 
-            if (series.isNull()) continue;
+    bool changed = labels.count() != entry.series.count();
+
+    for (const QString &label : labels)
+    {
+        auto s = entry.source->getSeriesByLabel(label);
 
-            QTreeWidgetItem *child = new QTreeWidgetItem();
+        if (s.isNull()) continue;
 
-            // Series label
-            child->setText(1, series->getLabel());
-            child->setToolTip(1, source->getLabel() + ":" + series->getLabel() + " (" + QString::number(series->size()) + " samples)");
+        QTreeWidgetItem *child = nullptr;
+
+        auto it = existing.find(s.data());
+
+        if (it != existing.end())
+        {
+            child = entry.children[it.value()];
+            changed |= it.value() != children.count();
+
+            existing.erase(it);
+        }
+        else
+        {
+            child = new QTreeWidgetItem();
 
             QFont font = child->font(1);
             font.setItalic(true);
             child->setFont(1, font);
 
-            child->setBackground(0, series->getColor());
+            changed = true;
+        }
+
+        updateSeriesItem(child, *entry.source, *s);
 
-            item->addChild(child);
+        series.append(s.toWeakRef());
+        children.append(child);
+    }
+
+    // Items of series which have been removed
+    for (int idx : existing)
+    {
+        delete entry.children[idx];
+    }
 
-            series_count++;
+    for (int idx = 0; idx < entry.series.count(); idx++)
+    {
+        if (entry.series[idx].isNull())
+        {
+            delete entry.children[idx];
         }
+    }
 
-        item->addChildren(childItems);
+    // The children are only re-ordered (in a single operation) if the series have changed
+    if (changed)
+    {
+        entry.item->takeChildren();
+        entry.item->addChildren(children);
     }
 
-    setUpdatesEnabled(true);
+    entry.series = series;
+    entry.children = children;
+}
+
+
+void DataViewTree::updateSeriesItem(QTreeWidgetItem *child, const DataSource &source, const DataSeries &series)
+{
+    // Series label
+    child->setText(1, series.getLabel());
+
+    // A series which is loaded on demand is not loaded just to describe it
+    const QString samples = series.isLoaded() ? QString::number(series.size()) + " samples" : "not loaded";
+
+    child->setToolTip(1, source.getLabel() + ":" + series.getLabel() + " (" + samples + ")");
+
+    child->setBackground(0, series.getColor());
+}
+
+
+void DataViewTree::updateMemoryItem(QTreeWidgetItem *item, const DataMemoryUsage &usage)
+{
+    const QString text = formatDataSize(usage.getHeapBytes());
+
+    if (item->text(2) != text)
+    {
+        item->setText(2, text);
+        item->setTextAlignment(2, Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    item->setToolTip(2, describeMemoryUsage(usage));
+}
+
+
+/*
+ * Update the memory usage of each source (and of the series of expanded sources)
+ */
+void DataViewTree::updateMemoryUsage()
+{
+    if (!isVisible()) return;
+
+    for (auto &entry : sourceItems)
+    {
+        DataMemoryUsage total;
+
+        for (int idx = 0; idx < entry.series.count(); idx++)
+        {
+            auto series = entry.series[idx].toStrongRef();
+
+            if (series.isNull()) continue;
+
+            const DataMemoryUsage usage = series->getMemoryUsage();
+
+            if (entry.item->isExpanded()) updateMemoryItem(entry.children[idx], usage);
+
+            total += usage;
+        }
+
+        updateMemoryItem(entry.item, total);
+    }
+}
+
+
+/*
+ * Show the series which match the filter (see DataSource::getSeriesLabels), without rebuilding the tree
+ */
+int DataViewTree::applyFilter(QString filters)
+{
+    // Save the filter text
+    filterString = filters;
+
+    int series_count = 0;
+
+    const bool filtered = !filters.trimmed().isEmpty();
+
+    for (auto &entry : sourceItems)
+    {
+        int visible = 0;
+
+        if (filtered)
+        {
+            const QStringList labels = entry.source->getSeriesLabels(filters);
+
+            QSet<QString> matches(labels.begin(), labels.end());
 
-    expandAll();
+            for (auto *child : entry.children)
+            {
+                const bool match = matches.contains(child->text(1));
+
+                if (child->isHidden() == match) child->setHidden(!match);
+
+                visible += match ? 1 : 0;
+            }
+        }
+        else
+        {
+            for (auto *child : entry.children)
+            {
+                if (child->isHidden()) child->setHidden(false);
+            }
+
+            visible = entry.children.count();
+        }
+
+        entry.item->setHidden(filtered && visible == 0);
+
+        if (visible > 0 && !entry.item->isExpanded())
+        {
+            entry.item->setExpanded(true);
+        }
+
+        series_count += visible;
+    }
 
     return series_count;
 }
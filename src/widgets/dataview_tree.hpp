@@ -1,9 +1,12 @@
 #ifndef DATAVIEW_TREE_HPP
 #define DATAVIEW_TREE_HPP
 
+#include <QHash>
+#include <QTimer>
 #include <QTreeWidget>
 
 #include "data_series.hpp"
+#include "data_source.hpp"
 
 class DataViewTree : public QTreeWidget
 {
@@ -13,8 +16,14 @@ public:
     DataViewTree(QWidget *parent = nullptr);
     virtual ~DataViewTree();
 
+    //! Interval at which the memory usage of the visible items is updated (ms)
+    static const int MEMORY_UPDATE_INTERVAL = 2000;
+
 public slots:
     int refresh(QString filters=QString());
+    int applyFilter(QString filters);
+
+    void updateMemoryUsage(void);
 
     void onItemDoubleClicked(QTreeWidgetItem *item, int col);
     void onContextMenu(const QPoint &pos);
@@ -27,6 +36,31 @@ protected:
 
     void setupTree();
     void editDataSeries(DataSeriesPointer series);
+    void alignSourceTo(DataSourcePointer source, DataSeriesPointer series);
+    void cropSourceTo(DataSourcePointer source);
+    void concatenateSources(DataSourcePointer source);
+
+    /**
+     * @brief The SourceItem struct is the tree item of a source, and the items of its series.
+     * Items are retained between refreshes, and are hidden (rather than removed) by the filter.
+     */
+    struct SourceItem
+    {
+        DataSourcePointer source;
+        QTreeWidgetItem *item = nullptr;
+
+        //! Series (in label order) and their items
+        QList<QWeakPointer<DataSeries>> series;
+        QList<QTreeWidgetItem*> children;
+    };
+
+    void updateSourceItem(SourceItem &entry);
+    void updateSeriesItem(QTreeWidgetItem *child, const DataSource &source, const DataSeries &series);
+    void updateMemoryItem(QTreeWidgetItem *item, const DataMemoryUsage &usage);
+
+    QList<SourceItem> sourceItems;
+
+    QTimer memoryTimer;
 
     QString filterString;
 };
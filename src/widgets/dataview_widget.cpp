@@ -28,6 +28,8 @@ DataviewWidget::DataviewWidget(QWidget *parent) : QWidget(parent)
 
 void DataviewWidget::dropEvent(QDropEvent *event)
 {
+    QStringList filenames;
+
     for (const QUrl &url : event->mimeData()->urls())
     {
         const QString& filename = url.toLocalFile();
@@ -36,9 +38,15 @@ void DataviewWidget::dropEvent(QDropEvent *event)
 
         if (info.exists() && info.isFile())
         {
-            emit fileDropped(filename);
+            filenames.append(filename);
         }
     }
+
+    // The files are imported together
+    if (!filenames.isEmpty())
+    {
+        emit filesDropped(filenames);
+    }
 }
 
 
@@ -67,18 +75,17 @@ void DataviewWidget::dragEnterEvent(QDragEnterEvent *event)
 void DataviewWidget::clearFilter()
 {
     ui.filterText->clear();
+
+    filterTextUpdated(QString());
 }
 
 
 void DataviewWidget::filterTextUpdated(QString text)
 {
-    Q_UNUSED(text);
+    // The tree is not rebuilt, only filtered
+    int series_count = ui.treeWidget->applyFilter(text);
 
-    blockSignals(true);
-
-    refresh();
-
-    blockSignals(false);
+    ui.resultsLabel->setText(QString::number(series_count) + tr(" series available"));
 }
 
 
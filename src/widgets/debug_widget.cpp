@@ -2,7 +2,6 @@
 
 #include "debug_widget.hpp"
 
-#include "lumberjack_debug.hpp"
 #include "lumberjack_settings.hpp"
 
 
@@ -27,6 +26,7 @@ DebugWidget::DebugWidget(QWidget *parent) : QWidget(parent)
     ui.showInfo->setChecked(settings->loadBoolean("debug", "showInfo"));
     ui.showDebug->setChecked(settings->loadBoolean("debug", "showDebug"));
 
+    updateMessageMask();
     updateDebugMessages();
 
     // Periodically refresh messages
@@ -49,23 +49,40 @@ void DebugWidget::debugPreferencesChanged()
     settings->saveSetting("debug", "showInfo", ui.showInfo->isChecked());
     settings->saveSetting("debug", "showDebug", ui.showDebug->isChecked());
 
+    updateMessageMask();
+
+    // Display the retained messages again, with the new selection
     ui.debugConsole->clear();
-    latestTimestamp = 0;
+    cursor = DebugMessageLog::Cursor();
 
     updateDebugMessages();
 }
 
 
+/*
+ * Construct the mask of the message types which are displayed
+ */
+void DebugWidget::updateMessageMask()
+{
+    messageMask = 0x00;
+
+    if (ui.showInfo->isChecked()) messageMask |= (1 << QtMsgType::QtInfoMsg);
+    if (ui.showDebug->isChecked()) messageMask |= (1 << QtMsgType::QtDebugMsg);
+    if (ui.showWarning->isChecked()) messageMask |= (1 << QtMsgType::QtWarningMsg);
+    if (ui.showCritical->isChecked()) messageMask |= (1 << QtMsgType::QtCriticalMsg);
+    if (ui.showFatal->isChecked()) messageMask |= (1 << QtMsgType::QtFatalMsg);
+}
+
+
 void DebugWidget::updateDebugMessages()
 {
-    auto messages = getLumberjackDebugMessages(latestTimestamp);
+    // Only messages which have not yet been displayed are returned
+    auto messages = getLumberjackDebugMessages(cursor, messageMask);
 
     for (auto &msg : messages)
     {
         qint64 t = msg.timestamp;
 
-        latestTimestamp = t;
-
         // Extract timestamp
         QString text;
 
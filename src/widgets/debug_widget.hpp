@@ -6,6 +6,8 @@
 
 #include "ui_debug_widget.h"
 
+#include "lumberjack_debug.hpp"
+
 class DebugWidget : public QWidget
 {
     Q_OBJECT
@@ -24,7 +26,13 @@ protected:
 
     QTimer* updateTimer = nullptr;
 
-    qint64 latestTimestamp = 0;
+    //! Messages which have already been displayed
+    DebugMessageLog::Cursor cursor;
+
+    //! Message types which are displayed
+    uint32_t messageMask = 0;
+
+    void updateMessageMask(void);
 
     void addDebugMessage(QtMsgType type, QString &msg);
 };
@@ -0,0 +1,117 @@
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+#include "import_progress_widget.hpp"
+#include "data_source_manager.hpp"
+
+
+ImportProgressWidget::ImportProgressWidget(QWidget *parent) : QWidget(parent)
+{
+    setWindowTitle(tr("Imports"));
+
+    tree.setColumnCount(3);
+    tree.setHeaderLabels(QStringList() << tr("File") << tr("Progress") << QString());
+    tree.setRootIsDecorated(false);
+    tree.header()->setStretchLastSection(false);
+    tree.header()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    cancelAllButton.setText(tr("Cancel All"));
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    layout->addWidget(&summary);
+    layout->addWidget(&tree);
+    layout->addWidget(&cancelAllButton, 0, Qt::AlignRight);
+
+    resize(500, 300);
+
+    connect(&cancelAllButton, &QPushButton::released, this, &ImportProgressWidget::cancelAll);
+
+    auto *manager = DataSourceManager::getInstance();
+
+    connect(manager, &DataSourceManager::importProgress, this, &ImportProgressWidget::refresh);
+    connect(manager, &DataSourceManager::importFinished, this, &ImportProgressWidget::refresh);
+
+    refresh();
+}
+
+
+/**
+ * @brief ImportProgressWidget::refresh - Update the list of files, and the progress of each
+ */
+void ImportProgressWidget::refresh(void)
+{
+    auto *manager = DataSourceManager::getInstance();
+
+    const QStringList filenames = manager->getImportFilenames();
+
+    // Remove files which are no longer being imported
+    for (int idx = tree.topLevelItemCount() - 1; idx >= 0; idx--)
+    {
+        QTreeWidgetItem *item = tree.topLevelItem(idx);
+
+        const QString filename = item->data(0, Qt::UserRole).toString();
+
+        if (!filenames.contains(filename))
+        {
+            progressBars.remove(filename);
+            delete tree.takeTopLevelItem(idx);
+        }
+    }
+
+    for (const QString &filename : filenames)
+    {
+        QProgressBar *progress = progressBars.value(filename, nullptr);
+
+        if (!progress)
+        {
+            QTreeWidgetItem *item = new QTreeWidgetItem(&tree);
+
+            item->setText(0, QFileInfo(filename).fileName());
+            item->setToolTip(0, filename);
+            item->setData(0, Qt::UserRole, filename);
+
+            progress = new QProgressBar();
+            progress->setRange(0, 100);
+
+            QPushButton *cancel = new QPushButton(tr("Cancel"));
+
+            connect(cancel, &QPushButton::released, this, [filename]() {
+                DataSourceManager::getInstance()->cancelImport(filename);
+            });
+
+            tree.setItemWidget(item, 1, progress);
+            tree.setItemWidget(item, 2, cancel);
+
+            progressBars.insert(filename, progress);
+        }
+
+        const int value = manager->getImportProgress(filename);
+
+        // A queued file has not started
+        if (value < 0)
+        {
+            progress->setFormat(tr("Queued"));
+            progress->setValue(0);
+        }
+        else
+        {
+            progress->setFormat("%p%");
+            progress->setValue(value);
+        }
+    }
+
+    summary.setText(filenames.isEmpty() ? tr("No files are being imported") :
+                                          tr("Importing %1 file(s): %2%").arg(filenames.count()).arg(manager->getTotalImportProgress()));
+
+    cancelAllButton.setEnabled(!filenames.isEmpty());
+}
+
+
+void ImportProgressWidget::cancelAll(void)
+{
+    DataSourceManager::getInstance()->cancelImports();
+
+    refresh();
+}
@@ -0,0 +1,38 @@
+#ifndef IMPORT_PROGRESS_WIDGET_HPP
+#define IMPORT_PROGRESS_WIDGET_HPP
+
+#include <QHash>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QWidget>
+
+
+/**
+ * @brief The ImportProgressWidget class lists the files which are being imported (or are queued for import),
+ * with the progress of each file. The import of each file can be cancelled individually.
+ */
+class ImportProgressWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    ImportProgressWidget(QWidget *parent = nullptr);
+
+public slots:
+    void refresh(void);
+
+protected slots:
+    void cancelAll(void);
+
+protected:
+    QLabel summary;
+    QTreeWidget tree;
+    QPushButton cancelAllButton;
+
+    //! Progress bar of each file which is listed
+    QHash<QString, QProgressBar*> progressBars;
+};
+
+#endif // IMPORT_PROGRESS_WIDGET_HPP
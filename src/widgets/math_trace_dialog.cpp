@@ -205,6 +205,7 @@ void MathTraceDialog::setEditMode(MathDataSeriesPointer series)
     // Populate fields from existing series
     ui->editTraceName->setText(series->getLabel());
     ui->editExpression->setText(series->getExpression());
+    ui->checkLazy->setChecked(series->isLazy());
 
     // Clear existing variable rows
     while (!variableRows.isEmpty())
@@ -402,6 +403,16 @@ void MathTraceDialog::createMathTrace()
         variableMapping
     );
 
+    // Lazy series are evaluated as they are plotted, so there is nothing to compute yet
+    if (ui->checkLazy->isChecked())
+    {
+        mathSeries->setLazy(true);
+        mathSource->addMathSeries(mathSeries);
+
+        QDialog::accept();
+        return;
+    }
+
     // Add to MathDataSource
     mathSource->addMathSeries(mathSeries);
     currentSeries = mathSeries;
@@ -1,56 +1,1230 @@
-#include <qelapsedtimer.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
+#include <QElapsedTimer>
+
+#include "gpu_compute.hpp"
 #include "plot_sampler.hpp"
+#include "trace_recorder.hpp"
+
+
+void PixelColumn::add(const DataSnapshot::Bucket& bucket)
+{
+    if (count == 0)
+    {
+        first = bucket.first;
+        min = bucket.min;
+        max = bucket.max;
+        last = bucket.last;
+        count = bucket.count;
+
+        return;
+    }
+
+    if (bucket.min.value < min.value) min = bucket.min;
+    if (bucket.max.value > max.value) max = bucket.max;
+
+    last = bucket.last;
+    count += bucket.count;
+}
+
+
+void PixelColumn::append(PlotSamples& output, const DataPoint& point) const
+{
+    output.timestamps.push_back(point.timestamp);
+    output.values.push_back(point.value);
+}
+
+
+/*
+ * Select the samples required to represent this column (at most four):
+ * - The first sample is always selected
+ * - The min and max samples are selected (in timestamp order) if they exceed the first and last
+ * - The last sample is selected if it differs from the first
+ * Returns the number of samples selected
+ */
+size_t PixelColumn::getPoints(DataPoint* points) const
+{
+    size_t n = 0;
+
+    if (count == 0) return n;
+
+    points[n++] = first;
+
+    if (count > 2)
+    {
+        // If the "minimum" value was lower than the first and last points
+        bool min_value_found = (min.value < first.value) && (min.value < last.value);
+
+        // If the "maximum" value was greater than the first and last points
+        bool max_value_found = (max.value > first.value) && (max.value > last.value);
+
+        // Now work out the timestamp order in which to add the point(s)
+        if (min_value_found && max_value_found)
+        {
+            if (min.timestamp <= max.timestamp)
+            {
+                points[n++] = min;
+                points[n++] = max;
+            }
+            else
+            {
+                points[n++] = max;
+                points[n++] = min;
+            }
+        }
+        else if (min_value_found)
+        {
+            points[n++] = min;
+        }
+        else if (max_value_found)
+        {
+            points[n++] = max;
+        }
+    }
+
+    if (count > 1)
+    {
+        points[n++] = last;
+    }
+
+    return n;
+}
+
+
+/*
+ * Emit the samples required to represent this column (see getPoints)
+ */
+void PixelColumn::flush(PlotSamples& output) const
+{
+    DataPoint points[4];
+
+    size_t n = getPoints(points);
+
+    for (size_t idx = 0; idx < n; idx++)
+    {
+        append(output, points[idx]);
+    }
+}
+
+
+/*
+ * Cached columns can be re-used if they were computed at the same zoom level.
+ * Successive pans compute the column width from slightly different timespans, so a small tolerance is allowed.
+ */
+bool PlotColumnCache::isCompatible(int lvl, double width) const
+{
+    return level == lvl && hasWidth(width);
+}
+
+
+bool PlotColumnCache::hasWidth(double width) const
+{
+    return !columns.empty() && fabs(width - dt) <= dt * 1e-9;
+}
+
+
+/*
+ * Discard any columns which may have changed since the cache was computed from an earlier snapshot.
+ *
+ * A column is retained if every sample within it is common to both snapshots. A margin (of one
+ * summary bucket) is allowed at either end of the common range, as a bucket which straddles a
+ * column boundary is assigned to the column which contains its first sample.
+ */
+void PlotColumnCache::update(const DataSnapshot& data, uint64_t margin)
+{
+    uint64_t idx_first = 0;
+    uint64_t idx_last = 0;
+
+    bool common = data.getCommonRange(snapshot, idx_first, idx_last) && (idx_last - idx_first) > 2 * margin;
+
+    snapshot = data;
+
+    if (!common)
+    {
+        columns.clear();
+        return;
+    }
+
+    // Columns which lie strictly within the common range
+    int64_t col_first = std::max(first, getColumn(data.getTimestamp(idx_first + margin)) + 1);
+    int64_t col_last = std::min(first + (int64_t) columns.size(), getColumn(data.getTimestamp(idx_last - 1 - margin)));
+
+    if (col_first >= col_last)
+    {
+        columns.clear();
+        return;
+    }
+
+    columns.erase(columns.begin() + (col_last - first), columns.end());
+    columns.erase(columns.begin(), columns.begin() + (col_first - first));
+
+    first = col_first;
+}
+
+
+//! Return the grid index of the column which contains the specified timestamp
+int64_t PlotColumnCache::getColumn(double t) const
+{
+    return (int64_t) std::floor((t - origin) / dt);
+}
+
+
+void PlotColumnCache::clear()
+{
+    snapshot = DataSnapshot();
+    columns.clear();
+}
+
+
+void PlotSamples::clear()
+{
+    timestamps.clear();
+    values.clear();
+
+    minValue = 0;
+    maxValue = 0;
+
+    density = QImage();
+    densityRect = QRectF();
+}
+
+
+void PlotSamples::updateRange()
+{
+    if (values.empty()) return;
+
+    auto range = std::minmax_element(values.begin(), values.end());
+
+    minValue = *range.first;
+    maxValue = *range.second;
+}
+
+
+const size_t PlotResampleCache::MAX_ENTRIES;
+
+
+PlotResampleCache* PlotResampleCache::getInstance()
+{
+    static PlotResampleCache cache;
+
+    return &cache;
+}
+
+
+bool PlotResampleCache::Entry::matches(const DataSnapshot& snapshot, double t0, double t1, unsigned int pixels, int m) const
+{
+    if (count != snapshot.size() || timeScale != snapshot.getTimeScale() || timeOffset != snapshot.getTimeOffset()) return false;
+
+    if (t_min != t0 || t_max != t1 || n_pixels != pixels || mode != m) return false;
+
+    // An expired table never matches (the samples have changed)
+    return !table.expired() && table.lock() == snapshot.getTable();
+}
+
+
+/*
+ * Find the entry for a pass (the mutex must be held), discarding any expired entries
+ */
+std::list<PlotResampleCache::Entry>::iterator PlotResampleCache::find(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode)
+{
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->table.expired() && it->samples)
+        {
+            it = entries.erase(it);
+        }
+        else if (it->matches(snapshot, t_min, t_max, n_pixels, mode))
+        {
+            return it;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return entries.end();
+}
+
+
+/**
+ * @brief PlotResampleCache::acquire - Find the output of a pass, or reserve the pass for the caller.
+ * If another curve is resampling the same pass, wait until it is published (or abandoned).
+ * @param snapshot - Unscaled samples of the series
+ * @param samples - Receives the samples, if found
+ * @param stats - Receives the description of the pass, if found
+ * @param cancelled - Returns true if the caller no longer needs the samples (checked while waiting)
+ * @return RESULT_RESAMPLE if the caller must resample the pass, then call publish or abandon
+ */
+PlotResampleCache::Result PlotResampleCache::acquire(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode,
+                                                     PlotSamplesPointer& samples, ResampleStats& stats, const std::function<bool(void)>& cancelled)
+{
+    QMutexLocker lock(&mutex);
+
+    while (true)
+    {
+        auto it = find(snapshot, t_min, t_max, n_pixels, mode);
+
+        if (it == entries.end())
+        {
+            Entry entry;
+
+            entry.table = snapshot.getTable();
+            entry.count = snapshot.size();
+            entry.timeScale = snapshot.getTimeScale();
+            entry.timeOffset = snapshot.getTimeOffset();
+            entry.t_min = t_min;
+            entry.t_max = t_max;
+            entry.n_pixels = n_pixels;
+            entry.mode = mode;
+
+            entries.push_front(entry);
+
+            return RESULT_RESAMPLE;
+        }
+
+        if (it->samples)
+        {
+            // Most recently used first
+            entries.splice(entries.begin(), entries, it);
+
+            samples = it->samples;
+            stats = it->stats;
+
+            return RESULT_FOUND;
+        }
+
+        // The curve which is resampling the pass is running (it reserved the pass, and then started resampling)
+        if (cancelled && cancelled()) return RESULT_CANCELLED;
+
+        passComplete.wait(&mutex, 10);
+    }
+}
+
+
+/*
+ * Publish the samples of a pass reserved by acquire (which are not modified while they are in the cache)
+ */
+void PlotResampleCache::publish(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode,
+                                PlotSamplesPointer samples, const ResampleStats& stats)
+{
+    QMutexLocker lock(&mutex);
+
+    auto it = find(snapshot, t_min, t_max, n_pixels, mode);
+
+    if (it != entries.end() && !it->samples)
+    {
+        it->samples = samples;
+        it->stats = stats;
+    }
+
+    // Discard the least recently used passes (a pass which is being resampled is retained)
+    size_t complete = 0;
+
+    for (auto entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->samples && ++complete > MAX_ENTRIES)
+        {
+            entry = entries.erase(entry);
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    passComplete.wakeAll();
+}
+
+
+/*
+ * Release a pass reserved by acquire, which was not completed (any curve waiting for it resamples the pass itself)
+ */
+void PlotResampleCache::abandon(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode)
+{
+    QMutexLocker lock(&mutex);
+
+    auto it = find(snapshot, t_min, t_max, n_pixels, mode);
+
+    if (it != entries.end() && !it->samples)
+    {
+        entries.erase(it);
+    }
+
+    passComplete.wakeAll();
+}
+
+
+size_t PlotResampleCache::size() const
+{
+    QMutexLocker lock(&mutex);
+
+    return entries.size();
+}
+
+
+void PlotResampleCache::clear()
+{
+    QMutexLocker lock(&mutex);
+
+    // Passes which are being resampled are retained (they are published or abandoned by their curve)
+    entries.remove_if([](const Entry& entry) { return entry.samples != nullptr; });
+}
+
+
+const uint64_t PlotCurveUpdater::BUCKETS_PER_CHECK;
+const unsigned int PlotCurveUpdater::PROGRESSIVE_FACTOR;
+const unsigned int PlotCurveUpdater::DENSITY_BUCKETS_PER_PIXEL;
+const size_t PlotCurveUpdater::PREFETCH_MEMORY_LIMIT;
+const double PlotCurveUpdater::ZOOM_STEP = 1.25;
+
+
+PlotCurveUpdater::PlotCurveUpdater(DataSeries &data_series) : QObject(), series(data_series), task(*this)
+{
+    qRegisterMetaType<PlotSamplesPointer>("PlotSamplesPointer");
+}
+
+
+/*
+ * Note: derived classes must also cancel and wait for requests in their own destructor,
+ * as their members are destroyed before this destructor runs
+ */
+PlotCurveUpdater::~PlotCurveUpdater()
+{
+    cancelRequests();
+    waitForRequests();
+}
+
+
+/*
+ * Return the thread pool which is shared by all curves.
+ * The pool is sized to the number of hardware threads.
+ */
+QThreadPool* PlotCurveUpdater::getThreadPool()
+{
+    static QThreadPool pool;
+
+    return &pool;
+}
+
+
+void PlotResampleTask::run()
+{
+    updater.processRequests();
+}
+
+
+/*
+ * Request that the curve be resampled (may be called from any thread).
+ * The request supersedes any request which has not yet completed.
+ * A progressive request publishes a coarse pass before the full resolution pass (see processRequests).
+ */
+void PlotCurveUpdater::requestCurveSamples(double t_min, double t_max, unsigned int n_pixels, int priority, bool progressive)
+{
+    QMutexLocker lock(&requestMutex);
+
+    t_min_requested = t_min;
+    t_max_requested = t_max;
+    n_pixels_requested = n_pixels;
+    priority_requested = priority;
+
+    requestPending = true;
+    progressiveRequested = progressive;
+    requestGeneration++;
+
+    // A running task picks up the new request once its current pass is abandoned
+    if (!taskActive)
+    {
+        taskActive = true;
+        taskPriority = priority;
+        getThreadPool()->start(&task, priority);
+    }
+    else if (priority > taskPriority && getThreadPool()->tryTake(&task))
+    {
+        // The task was queued for a low priority stage (refinement or prefetching)
+        taskPriority = priority;
+        getThreadPool()->start(&task, priority);
+    }
+}
+
+
+/*
+ * Set the value range (scaled), height and colour of the density image (DOWNSAMPLE_DENSITY mode).
+ * Applies to subsequent requests.
+ */
+void PlotCurveUpdater::setDensityView(double y_min, double y_max, unsigned int n_rows, QRgb color)
+{
+    QMutexLocker lock(&requestMutex);
+
+    density_requested.y_min = y_min;
+    density_requested.y_max = y_max;
+    density_requested.rows = n_rows;
+    density_requested.color = color;
+}
+
+
+/*
+ * Discard any pending request, and abandon the current resampling pass (e.g. when a curve is hidden)
+ */
+void PlotCurveUpdater::cancelRequests()
+{
+    QMutexLocker lock(&requestMutex);
+
+    requestPending = false;
+    prefetchPending = false;
+    requestGeneration++;
+
+    // A task which has not yet started can simply be removed from the pool
+    if (taskActive && getThreadPool()->tryTake(&task))
+    {
+        taskActive = false;
+        taskComplete.wakeAll();
+    }
+}
+
+
+/*
+ * Block until the task for this updater (if any) has completed
+ */
+void PlotCurveUpdater::waitForRequests()
+{
+    QMutexLocker lock(&requestMutex);
+
+    while (taskActive)
+    {
+        taskComplete.wait(&requestMutex);
+    }
+}
+
+
+bool PlotCurveUpdater::isRequestPending() const
+{
+    QMutexLocker lock(&requestMutex);
+
+    return requestPending || taskActive;
+}
+
+
+/*
+ * Return a description of the most recent published pass (may be called from any thread)
+ */
+ResampleStats PlotCurveUpdater::getStats() const
+{
+    QMutexLocker lock(&statsMutex);
+
+    return stats;
+}
+
+
+/*
+ * Record the description of a pass which is about to be published
+ */
+void PlotCurveUpdater::publishStats(qint64 nsecs, const PlotSamples& output)
+{
+    QMutexLocker lock(&statsMutex);
+
+    const uint64_t passes = stats.passes;
+
+    stats = passStats;
+    stats.duration = nsecs * 1e-6;
+    stats.outputPoints = output.size();
+    stats.passes = passes + 1;
+}
+
+
+/*
+ * Process requests until there are none remaining (in a pool thread).
+ *
+ * For a progressive request which changes the zoom level, a coarse pass is published first.
+ * The full resolution pass is then queued (at a lower priority) behind the coarse passes of
+ * any other curves, so that every curve is drawn (coarsely) before any curve is refined.
+ *
+ * Once a visible curve is up to date, the views around it are prefetched (at the lowest priority),
+ * until a new request arrives.
+ */
+void PlotCurveUpdater::processRequests()
+{
+    double t_min;
+    double t_max;
+    unsigned int n_pixels;
+    int priority;
+    bool progressive;
+
+    requestMutex.lock();
+
+    while (requestPending || prefetchPending)
+    {
+        if (!requestPending)
+        {
+            prefetchPending = false;
+            activeGeneration = requestGeneration.load();
+
+            t_min = t_min_requested;
+            t_max = t_max_requested;
+            n_pixels = n_pixels_requested;
+
+            requestMutex.unlock();
+
+            prefetchNeighbours(t_min, t_max, n_pixels);
+
+            requestMutex.lock();
+
+            activeGeneration = 0;
+            continue;
+        }
+
+        t_min = t_min_requested;
+        t_max = t_max_requested;
+        n_pixels = n_pixels_requested;
+        priority = priority_requested;
+        progressive = progressiveRequested;
+
+        requestPending = false;
+        progressiveRequested = false;
+        activeGeneration = requestGeneration.load();
+
+        requestMutex.unlock();
+
+        if (progressive && isCoarsePassUseful(t_min, t_max, n_pixels))
+        {
+            updateCoarseSamples(t_min, t_max, std::max(1u, n_pixels / PROGRESSIVE_FACTOR));
+
+            requestMutex.lock();
+
+            // Re-queue the same request, unless it has since been replaced (or cancelled)
+            if (!requestPending && requestGeneration.load() == activeGeneration)
+            {
+                requestPending = true;
+                activeGeneration = 0;
+
+                taskPriority = priority + PRIORITY_REFINE;
+                getThreadPool()->start(&task, taskPriority);
+
+                requestMutex.unlock();
+                return;
+            }
+
+            activeGeneration = 0;
+            continue;
+        }
+
+        updateCurveSamples(t_min, t_max, n_pixels);
+
+        requestMutex.lock();
+
+        activeGeneration = 0;
+
+        if (!requestPending && priority >= PRIORITY_VISIBLE && isPrefetchSupported())
+        {
+            prefetchPending = true;
+
+            taskPriority = PRIORITY_PREFETCH;
+            getThreadPool()->start(&task, taskPriority);
+
+            requestMutex.unlock();
+            return;
+        }
+    }
+
+    taskActive = false;
+    taskComplete.wakeAll();
+
+    requestMutex.unlock();
+}
+
+
+/*
+ * Returns true if a coarse pass would be significantly faster than the full resolution pass,
+ * i.e. the series must be down-sampled, and the columns of the previous pass cannot be re-used.
+ */
+bool PlotCurveUpdater::isCoarsePassUseful(double t_min, double t_max, unsigned int n_pixels) const
+{
+    if (n_pixels < PROGRESSIVE_FACTOR) return false;
+
+    const auto snapshot = series.getSnapshot().getUnscaled();
+
+    const uint64_t n_samples = snapshot.upperBound(std::max(t_min, t_max)) - snapshot.upperBound(std::min(t_min, t_max));
+
+    if (n_samples <= (uint64_t) n_pixels * MIN_BUCKETS_PER_PIXEL * PROGRESSIVE_FACTOR) return false;
+
+    QMutexLocker lock(&mutex);
+
+    // Panning at the same zoom level is already incremental (as is zooming to a prefetched level)
+    const double dt = std::fabs(t_max - t_min) / n_pixels;
+
+    if (columnCache.hasWidth(dt)) return false;
+
+    for (const auto& cache : prefetchCaches)
+    {
+        if (cache.hasWidth(dt)) return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Speculatively compute the pixel columns around the most recent request (when the pool is otherwise idle):
+ * one window either side at the current zoom level, and one mouse wheel step in and out.
+ * Panning or zooming into a prefetched region then only copies the cached columns.
+ *
+ * Returns false if abandoned in favour of a newer request.
+ */
+bool PlotCurveUpdater::prefetchNeighbours(double t_min, double t_max, unsigned int n_pixels)
+{
+    QMutexLocker lock(&mutex);
+
+    if (t_min > t_max) std::swap(t_min, t_max);
+
+    const double span = t_max - t_min;
+
+    if (n_pixels == 0 || !(span > 0)) return true;
+
+    const auto snapshot = series.getSnapshot().getUnscaled();
+
+    // Neighbouring windows, at the current zoom level
+    prefetchScratch.clear();
+
+    if (!resample(snapshot, t_min - span, t_max + span, n_pixels * 3, prefetchScratch, columnCache))
+    {
+        return false;
+    }
+
+    // Zooming about any point within the view stays within 1.5 windows of the centre
+    const double center = (t_min + t_max) / 2;
+    const double factors[2] = {1 / ZOOM_STEP, ZOOM_STEP};
+
+    for (double factor : factors)
+    {
+        const double width = span * factor;
+        const double dt = width / n_pixels;
+
+        auto cache = prefetchCaches.begin();
+
+        while (cache != prefetchCaches.end() && !cache->hasWidth(dt)) cache++;
+
+        if (cache == prefetchCaches.end())
+        {
+            cache = prefetchCaches.emplace(prefetchCaches.begin());
+        }
+
+        prefetchScratch.clear();
+
+        if (!resample(snapshot, center - 1.5 * width, center + 1.5 * width, n_pixels * 3, prefetchScratch, *cache))
+        {
+            return false;
+        }
+    }
+
+    prefetchScratch.clear();
+
+    trimPrefetchCaches();
+
+    return true;
+}
+
+
+/*
+ * When the zoom level changes, swap in the prefetched columns for the new level (if available).
+ * The columns for the previous zoom level are retained, so that zooming back is also cached.
+ */
+void PlotCurveUpdater::selectColumnCache(double t_min, double t_max, unsigned int n_pixels)
+{
+    if (n_pixels == 0) return;
+
+    const double dt = std::fabs(t_max - t_min) / n_pixels;
+
+    if (columnCache.columns.empty() || columnCache.hasWidth(dt)) return;
+
+    auto cache = prefetchCaches.begin();
+
+    while (cache != prefetchCaches.end() && !cache->hasWidth(dt)) cache++;
+
+    if (cache != prefetchCaches.end())
+    {
+        std::swap(*cache, columnCache);
+        prefetchCaches.splice(prefetchCaches.begin(), prefetchCaches, cache);
+    }
+    else
+    {
+        prefetchCaches.emplace_front();
+        std::swap(prefetchCaches.front(), columnCache);
+        columnCache.clear();
+    }
+
+    trimPrefetchCaches();
+}
+
+
+/*
+ * Discard the least recently used prefetched columns, to limit memory usage
+ */
+void PlotCurveUpdater::trimPrefetchCaches()
+{
+    const size_t limit = PREFETCH_MEMORY_LIMIT / sizeof(PixelColumn);
+
+    size_t total = 0;
+
+    for (auto cache = prefetchCaches.begin(); cache != prefetchCaches.end(); )
+    {
+        total += cache->columns.size();
+
+        if (total > limit || cache->columns.empty())
+        {
+            cache = prefetchCaches.erase(cache);
+        }
+        else
+        {
+            cache++;
+        }
+    }
+}
+
+
+/*
+ * Publish a low resolution version of the requested view.
+ * The output is not retained for re-use, so the following full resolution pass always runs.
+ */
+void PlotCurveUpdater::updateCoarseSamples(double t_min, double t_max, unsigned int n_pixels)
+{
+    QMutexLocker lock(&mutex);
+
+    const auto snapshot = series.getSnapshot();
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    auto output = acquireBuffer();
+
+    if (!resample(snapshot.getUnscaled(), t_min, t_max, n_pixels, *output, coarseCache))
+    {
+        output->clear();
+        return;
+    }
+
+    output->updateRange();
 
+    publishStats(elapsed.nsecsElapsed(), *output);
+
+    emit sampleComplete(output, snapshot.getScaler(), snapshot.getOffset());
+}
 
 
-PlotCurveUpdater::PlotCurveUpdater(DataSeries &data_series) : QObject(), series(data_series)
+/*
+ * Return an (empty) output buffer, for the next resampling pass.
+ *
+ * Output is double-buffered: a buffer is re-used (without reallocating) once the only
+ * remaining reference is held by the updater. If both buffers are still referenced
+ * (e.g. a curve has not yet received the previous result), a new buffer is allocated,
+ * and the replaced buffer is released by its remaining owners.
+ */
+std::shared_ptr<PlotSamples> PlotCurveUpdater::acquireBuffer()
 {
-    // TODO
+    for (auto& buffer : buffers)
+    {
+        if (buffer && buffer.use_count() == 1)
+        {
+            // Ensure that the previous owner has finished reading before the buffer is overwritten
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            buffer->clear();
+            return buffer;
+        }
+    }
+
+    auto& oldest = buffers[0] == samples_latest ? buffers[1] : buffers[0];
+
+    oldest = std::make_shared<PlotSamples>();
+
+    return oldest;
 }
 
 
 /**
  * Re-sample the data for the provided data series, between the specified timestamps
  *
- * TODO: Description of how the algorithm works!
- *
- * TODO: This algorithm constructs two arrays, and then the QwtPlotCurve->setSamples() function
- *       *COPIES* the data across to the curve.
- *       Instead, perhaps we could use setRawSamples() function to prevent an unnecessary copy operation.
+ * Resampling operates on raw (unscaled) values. The scaler and offset of the series are
+ * applied once to the resampled output, and the raw output is retained: if only the
+ * scaler or offset has changed, the retained samples are simply re-scaled.
  */
 void PlotCurveUpdater::updateCurveSamples(double t_min, double t_max, unsigned int n_pixels)
 {
-    if (!mutex.tryLock()) return;
+    QMutexLocker lock(&mutex);
+
+    const auto snapshot = series.getSnapshot();
+
+    const int mode = downsampleMode.load();
+
+    DensityView view;
+
+    if (mode == DOWNSAMPLE_DENSITY)
+    {
+        QMutexLocker request_lock(&requestMutex);
+        view = density_requested;
+    }
+
+    // The density image is rasterized in scaled coordinates, so it can only be re-used without re-scaling
+    const bool density_reusable = mode != DOWNSAMPLE_DENSITY ||
+            (view == density_latest && snapshot.getScaler() == scaler_latest && snapshot.getOffset() == offset_latest);
+
+    // If the arguments are the same as last time, the raw samples can be reused
+    if (samples_latest && t_min == t_min_latest && t_max == t_max_latest && n_pixels == n_pixels_latest && mode == mode_latest && density_reusable)
+    {
+        if (snapshot.getScaler() != scaler_latest || snapshot.getOffset() != offset_latest)
+        {
+            scaler_latest = snapshot.getScaler();
+            offset_latest = snapshot.getOffset();
+
+            emit sampleComplete(samples_latest, scaler_latest, offset_latest);
+        }
+
+        return;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    const DataSnapshot unscaled = snapshot.getUnscaled();
+
+    // The density image depends on the view of the curve, so only lines are shared with other curves
+    PlotResampleCache* shared = mode == DOWNSAMPLE_DENSITY ? nullptr : PlotResampleCache::getInstance();
 
-    // If the arguments are the same as last time, ignore
-    if (t_min == t_min_latest && t_max == t_max_latest && n_pixels == n_pixels_latest)
+    if (shared)
     {
-        mutex.unlock();
+        PlotSamplesPointer samples;
+        ResampleStats cached;
+
+        const auto result = shared->acquire(unscaled, t_min, t_max, n_pixels, mode, samples, cached, [this]() { return isSuperseded(); });
+
+        if (result == PlotResampleCache::RESULT_CANCELLED) return;
+
+        if (result == PlotResampleCache::RESULT_FOUND)
+        {
+            t_min_latest = t_min;
+            t_max_latest = t_max;
+            n_pixels_latest = n_pixels;
+            mode_latest = mode;
+
+            scaler_latest = snapshot.getScaler();
+            offset_latest = snapshot.getOffset();
+
+            samples_latest = samples;
+
+            passStats = cached;
+            passStats.shared = true;
+
+            publishStats(elapsed.nsecsElapsed(), *samples);
+
+            emit sampleComplete(samples_latest, scaler_latest, offset_latest);
+            return;
+        }
+    }
+
+    auto output = acquireBuffer();
+
+    selectColumnCache(t_min, t_max, n_pixels);
+
+    // A newer request is waiting - the output of this pass would never be seen
+    if (!resample(unscaled, t_min, t_max, n_pixels, *output, columnCache, mode))
+    {
+        if (shared) shared->abandon(unscaled, t_min, t_max, n_pixels, mode);
+
+        output->clear();
         return;
     }
 
+    if (mode == DOWNSAMPLE_DENSITY && !rasterizeDensity(snapshot, t_min, t_max, n_pixels, view, *output))
+    {
+        output->clear();
+        return;
+    }
+
+    output->updateRange();
+
+    if (shared) shared->publish(unscaled, t_min, t_max, n_pixels, mode, output, passStats);
+
+    density_latest = view;
+
     t_min_latest = t_min;
     t_max_latest = t_max;
     n_pixels_latest = n_pixels;
+    mode_latest = mode;
 
-    // Profiling timer
-    QElapsedTimer elapsed;
-    elapsed.restart();
+    scaler_latest = snapshot.getScaler();
+    offset_latest = snapshot.getOffset();
+
+    samples_latest = output;
+
+    publishStats(elapsed.nsecsElapsed(), *output);
+
+    // Signal that the downsampling process is now complete
+    emit sampleComplete(samples_latest, scaler_latest, offset_latest);
+}
+
+
+/**
+ * Largest-Triangle-Three-Buckets selection, using each pixel column as a bucket.
+ *
+ * For each column, the candidate sample (from those which M4 would draw, see PixelColumn::getPoints)
+ * which forms the largest triangle with the previously selected sample, and the mean of the candidates
+ * in the next column, is selected. Selecting from the column candidates (rather than every sample)
+ * keeps the cost proportional to the number of pixels, and the extreme values are always candidates.
+ *
+ * @param columns are the pixel columns, in timestamp order
+ * @param n_columns is the number of pixel columns
+ * @param left is the sample before the first column (may be nullptr)
+ * @param right is the sample after the final column (may be nullptr)
+ * @param output receives the selected samples
+ */
+void PlotCurveUpdater::selectLargestTriangles(const PixelColumn* columns, size_t n_columns, const DataPoint* left, const DataPoint* right, PlotSamples& output)
+{
+    DataPoint points[4];
+    DataPoint next[4];
+
+    size_t n_next = 0;
+    size_t idx_next = 0;
+
+    // Find the candidates for the next non-empty column (after the specified index)
+    auto advance = [&](size_t idx) {
+        for (idx_next = idx; idx_next < n_columns; idx_next++)
+        {
+            n_next = columns[idx_next].getPoints(next);
+
+            if (n_next > 0) return;
+        }
+
+        n_next = 0;
+    };
+
+    advance(0);
+
+    bool have_previous = left != nullptr;
+    DataPoint previous = have_previous ? *left : DataPoint();
+
+    while (n_next > 0)
+    {
+        size_t n = n_next;
+
+        for (size_t ii = 0; ii < n; ii++)
+        {
+            points[ii] = next[ii];
+        }
+
+        advance(idx_next + 1);
+
+        // Third vertex of the triangle is the mean of the next column (or the sample beyond the columns)
+        DataPoint target = points[n - 1];
+
+        if (n_next > 0)
+        {
+            target = DataPoint(0, 0);
+
+            for (size_t ii = 0; ii < n_next; ii++)
+            {
+                target.timestamp += next[ii].timestamp;
+                target.value += next[ii].value;
+            }
+
+            target.timestamp /= n_next;
+            target.value /= n_next;
+        }
+        else if (right != nullptr)
+        {
+            target = *right;
+        }
+
+        // Without a previous selection, the first sample is used
+        size_t selected = 0;
+
+        if (have_previous)
+        {
+            double area_max = -1;
+
+            for (size_t ii = 0; ii < n; ii++)
+            {
+                double area = fabs((previous.timestamp - target.timestamp) * (points[ii].value - previous.value) -
+                                   (previous.timestamp - points[ii].timestamp) * (target.value - previous.value));
+
+                if (area > area_max)
+                {
+                    area_max = area;
+                    selected = ii;
+                }
+            }
+        }
+
+        previous = points[selected];
+        have_previous = true;
+
+        output.timestamps.push_back(previous.timestamp);
+        output.values.push_back(previous.value);
+    }
+}
+
+
+/**
+ * @brief PlotCurveUpdater::rasterizeDensity - Render the number of samples within each pixel cell as an image
+ * @param snapshot is the (scaled) series data
+ * @param t_min is the start of the visible timespan
+ * @param t_max is the end of the visible timespan
+ * @param n_pixels is the number of pixel columns
+ * @param view specifies the value range, number of rows and colour of the image
+ * @param output receives the density image
+ * @return false if a newer request is waiting (the image is incomplete)
+ *
+ * As with resample, summary buckets are used rather than individual samples. The samples in a bucket
+ * are spread evenly over the rows between its minimum and maximum values, which is a close approximation
+ * when there are many buckets per pixel column (see DENSITY_BUCKETS_PER_PIXEL).
+ *
+ * The opacity of each cell is proportional to the logarithm of the sample count,
+ * so that sparse excursions remain visible next to dense regions.
+ */
+bool PlotCurveUpdater::rasterizeDensity(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels,
+                                        const DensityView& view, PlotSamples& output)
+{
+    if (t_min > t_max) std::swap(t_min, t_max);
+
+    if (n_pixels == 0 || view.rows == 0 || !(view.y_max > view.y_min) || !(t_max > t_min))
+    {
+        return true;
+    }
+
+    const uint64_t idx_first = snapshot.lowerBound(t_min);
+    const uint64_t idx_last = snapshot.upperBound(t_max);
+
+    if (idx_first >= idx_last) return true;
+
+    const uint64_t n_samples = idx_last - idx_first;
+
+    int level = -1;
+
+    for (unsigned int lvl = 0; lvl < DataBlock::SUMMARY_LEVELS; lvl++)
+    {
+        if (DataBlock::getSummaryBucketSize(lvl) * DENSITY_BUCKETS_PER_PIXEL * n_pixels <= n_samples)
+        {
+            level = lvl;
+        }
+    }
+
+    const unsigned int cols = n_pixels;
+    const unsigned int rows = view.rows;
+
+    densityScratch.assign((size_t) cols * rows, 0.0f);
+
+    const double sx = cols / (t_max - t_min);
+    const double sy = rows / (view.y_max - view.y_min);
 
-    // Initialize empty arrays
-    QVector<double> t_data;
-    QVector<double> y_data;
+    auto accumulate = [&](const DataSnapshot::Bucket& bucket) {
+        // Row zero is the top of the image
+        const double r_top = (view.y_max - std::max(bucket.min.value, bucket.max.value)) * sy;
+        const double r_bottom = (view.y_max - std::min(bucket.min.value, bucket.max.value)) * sy;
+
+        if (r_bottom < 0 || r_top >= rows) return;
+
+        const int64_t span_first = (int64_t) std::floor(r_top);
+        const int64_t span_last = (int64_t) std::floor(r_bottom);
+
+        const float weight = (float) bucket.count / (float) (span_last - span_first + 1);
+
+        const int64_t row_first = std::max<int64_t>(span_first, 0);
+        const int64_t row_last = std::min<int64_t>(span_last, rows - 1);
+
+        int64_t col = (int64_t) ((bucket.first.timestamp - t_min) * sx);
+        col = std::min<int64_t>(std::max<int64_t>(col, 0), cols - 1);
+
+        float* cell = densityScratch.data() + row_first * cols + col;
+
+        for (int64_t row = row_first; row <= row_last; row++, cell += cols)
+        {
+            *cell += weight;
+        }
+    };
+
+    const uint64_t chunk = (level < 0 ? 1 : DataBlock::getSummaryBucketSize(level)) * BUCKETS_PER_CHECK;
+
+    for (uint64_t idx = idx_first; idx < idx_last; )
+    {
+        const uint64_t idx_next = std::min(idx + chunk, idx_last);
+
+        snapshot.visitBuckets(idx, idx_next, level, accumulate);
+
+        idx = idx_next;
+
+        if (isSuperseded()) return false;
+    }
+
+    const float peak = *std::max_element(densityScratch.begin(), densityScratch.end());
+
+    if (peak <= 0) return true;
+
+    // Cells which contain any samples are always visible
+    const int MIN_ALPHA = 24;
+
+    const float scale = (255 - MIN_ALPHA) / std::log1p(peak);
+
+    output.density = QImage((int) cols, (int) rows, QImage::Format_ARGB32_Premultiplied);
+
+    const float* cell = densityScratch.data();
+
+    for (unsigned int row = 0; row < rows; row++)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(output.density.scanLine((int) row));
+
+        for (unsigned int col = 0; col < cols; col++, cell++)
+        {
+            int alpha = *cell > 0 ? MIN_ALPHA + (int) (std::log1p(*cell) * scale) : 0;
+
+            line[col] = qPremultiply(qRgba(qRed(view.color), qGreen(view.color), qBlue(view.color), std::min(alpha, 255)));
+        }
+    }
+
+    output.densityRect = QRectF(t_min, view.y_min, t_max - t_min, view.y_max - view.y_min);
+
+    return true;
+}
+
+
+/**
+ * Re-sample the data in the provided snapshot, between the specified timestamps
+ *
+ * The visible timespan is divided into n_pixels columns. For each column, at most four samples
+ * are emitted (first, min, max, last), which is sufficient to draw an identical curve.
+ *
+ * Rather than visiting every sample in the timespan, the summary pyramid maintained by the
+ * DataSeries is used. The coarsest summary level which still provides at least
+ * MIN_BUCKETS_PER_PIXEL buckets per pixel column is selected, making the cost of resampling
+ * proportional to the number of pixels rather than the number of samples.
+ *
+ * In DOWNSAMPLE_M4 mode, columns are drawn with their first / min / max / last samples, which draws
+ * an identical curve. In DOWNSAMPLE_LTTB mode a single sample is selected from each column
+ * (see selectLargestTriangles), which is visually faithful but paints a quarter of the points.
+ *
+ * Pixel columns are retained between passes (in the provided cache, see PlotColumnCache). When the
+ * timespan is panned without changing the zoom level, only the newly exposed columns are computed.
+ *
+ * A single snapshot of the series is used for the entire resampling pass, so the result
+ * is consistent even if samples are being added while the curve is resampled.
+ *
+ * The output is drawn directly by the curve (see PlotSeriesData), so it is not copied again.
+ *
+ * Returns false if the pass was abandoned, because a newer request has been made (see isSuperseded)
+ */
+bool PlotCurveUpdater::resample(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, PlotSamples& output,
+                               PlotColumnCache& cache, int mode)
+{
+    TRACE_SCOPE("Resample", "plot");
+
+    passStats = ResampleStats();
 
     // Quick check for an empty series
-    if (series.size() == 0 || n_pixels == 0)
+    if (snapshot.isEmpty() || n_pixels == 0)
     {
-        emit sampleComplete(t_data, y_data);
-        mutex.unlock();
-        return;
+        return true;
     }
 
-    const size_t N = series.size();
+    const uint64_t N = snapshot.size();
 
     // Ensure that the timestamp values are ordered correctly
     if (t_min > t_max)
@@ -62,223 +1236,234 @@ void PlotCurveUpdater::updateCurveSamples(double t_min, double t_max, unsigned i
     }
 
     // Extract data access indices
-    auto idx_min = series.getIndexForTimestamp(t_min);
-    auto idx_max = series.getIndexForTimestamp(t_max);
+    // Samples in the range [idx_min, idx_max) are within the visible timespan
+    auto idx_min = snapshot.upperBound(t_min);
+    auto idx_max = snapshot.upperBound(t_max);
 
     auto n_samples = idx_max - idx_min;
 
     /* If there is at least one sample available "before" the minimum timestamp,
      * we *always* draw that sample first.
      * This wil ensure that a line gets drawn off the left of the screen!
+     *
+     * Similarly, the first sample "after" the maximum timestamp is always drawn.
      */
 
     bool sample_left = idx_min > 0;
-    bool sample_right = idx_max < (N - 1);
 
-    DataPoint point;
+    passStats.rawPoints = n_samples;
 
     // If the number of available points is *not greater* than the number of pixels,
     // simple return *all* samples within the specified timespan
     if (n_samples <= n_pixels)
     {
+        const auto view = snapshot.getView(sample_left ? idx_min - 1 : idx_min, idx_max + 1);
+
         // We know how many samples are going to be inserted
-        t_data.reserve(n_samples + 2);
-        y_data.reserve(n_samples + 2);
+        output.timestamps.resize(view.size());
+        output.values.resize(view.size());
 
-        if (sample_left)
-        {
-            point = series.getDataPoint(idx_min - 1);
-            t_data.push_back(point.timestamp);
-            y_data.push_back(point.value);
-        }
+        view.copyTimestamps(output.timestamps.data());
+        view.copyValues(output.values.data());
 
-        for (auto idx = idx_min; (idx <= idx_max) && (idx < N); idx++)
-        {
-            point = series.getDataPoint(idx);
+        return true;
+    }
 
-            t_data.push_back(point.timestamp);
-            y_data.push_back(point.value);
-        }
+    // Select the coarsest summary level which provides enough buckets per pixel
+    int level = -1;
 
-        if (sample_right)
+    for (unsigned int lvl = 0; lvl < DataBlock::SUMMARY_LEVELS; lvl++)
+    {
+        if (DataBlock::getSummaryBucketSize(lvl) * MIN_BUCKETS_PER_PIXEL * n_pixels <= n_samples)
         {
-            point = series.getDataPoint(idx_max + 1);
-            t_data.push_back(point.timestamp);
-            y_data.push_back(point.value);
+            level = lvl;
         }
+    }
 
-        emit sampleComplete(t_data, y_data);
+    passStats.direct = false;
 
-        mutex.unlock();
-        return;
+    // Time delta per pixel
+    const double dt = (t_max - t_min) / n_pixels;
+
+    // At an unchanged zoom level, a coarser level used by the cached columns is retained
+    // (the sample density of overlapping views may differ slightly, e.g. at the end of the series)
+    if (cache.hasWidth(dt) && cache.level > level)
+    {
+        level = cache.level;
     }
 
-    // The "worst case" down sampling requires 4 data points per pixel
-    // So, pre-allocate that amount of memory
-    t_data.reserve(4 * n_pixels + 2);
-    y_data.reserve(4 * n_pixels + 2);
+    // Columns from the previous pass are re-used if the zoom level has not changed
+    if (cache.isCompatible(level, dt) && !cache.snapshot.isIdentical(snapshot))
+    {
+        // Only columns which contain new (or discarded) samples need to be computed again
+        cache.update(snapshot, level < 0 ? 1 : DataBlock::getSummaryBucketSize(level));
+    }
 
-    if (sample_left)
+    if (!cache.isCompatible(level, dt))
     {
-        point = series.getDataPoint(idx_min - 1);
-        t_data.push_back(point.timestamp);
-        y_data.push_back(point.value);
+        cache.clear();
+
+        cache.snapshot = snapshot;
+        cache.level = level;
+        cache.dt = dt;
+        cache.origin = t_min;
     }
 
-    // Time delta per pixel
-    double dt = (t_max - t_min) / n_pixels;
+    passStats.level = cache.level;
 
-    double t = series.getTimestamp(idx_min);
+    // Grid columns which cover the visible timespan
+    // (the final column ends at t_max, allowing for rounding of the column width)
+    const int64_t col_first = cache.getColumn(t_min);
+    const int64_t col_last = std::max(col_first, cache.getColumn(t_max - dt * 1e-6));
 
-    // Pre-calculate the time of the "next" pixel
-    double t_next = t + dt;
+    const size_t n_columns = (size_t) (col_last - col_first + 1);
 
-    // Construct pointers to raw samples to be added
-    DataPoint pt_first = series.getDataPoint(idx_min);
-    DataPoint pt_min = pt_first;
-    DataPoint pt_max = pt_first;
-    DataPoint pt_last = pt_first;
+    // The view lies entirely within the cache (e.g. within a prefetched region), so there is nothing to compute
+    const bool contained = cache.contains(col_first) && cache.contains(col_last);
 
-    int pt_counter = 1;
+    std::vector<PixelColumn>& columns = columnScratch;
 
-    if (idx_max >= N)
-    {
-        idx_max = N - 1;
-    }
+    columns.resize(contained ? 0 : n_columns);
 
-    bool min_value_found = false;
-    bool max_value_found = false;
+    // Buckets are visited in chunks, checking for a newer request between each chunk.
+    // Pixel columns carry across chunk boundaries (a bucket split by a boundary is simply visited in two parts).
+    const uint64_t chunk = (level < 0 ? 1 : DataBlock::getSummaryBucketSize(level)) * BUCKETS_PER_CHECK;
 
-    for (uint64_t idx = idx_min; idx <= idx_max; idx++)
+    for (int64_t col = col_first; col <= col_last && !contained; )
     {
-        auto point = series.getDataPoint(idx);
-
-        if ((idx < idx_max) && (point.timestamp < t_next))
+        if (cache.contains(col))
         {
-            // Increment sample counter within this pixel window
-            pt_counter++;
+            columns[col - col_first] = cache.columns[col - cache.first];
+            col++;
+            continue;
+        }
 
-            // Update min / max values
-            if (point.value < pt_min.value)
-            {
-                pt_min = point;
-            }
-            if (point.value > pt_max.value)
-            {
-                pt_max = point;
-            }
+        // Compute a contiguous run of columns which are not cached
+        const int64_t run_first = col;
+        int64_t run_last = col;
 
-            // Record this as the "most recent" point
-            pt_last = point;
+        while (run_last < col_last && !cache.contains(run_last + 1))
+        {
+            run_last++;
         }
-        else
+
+        for (int64_t ii = run_first; ii <= run_last; ii++)
         {
-            /* We have moved to the next "pixel":
-             * - Work out how many points need to be added to the previous pixel
-             */
+            columns[ii - col_first].clear();
+        }
 
-            // Record the current time as the start of the next "pixel"
-            t = t_next;
-            t_next = t + dt;
+        // Samples within the run are [start, end), so they never spill into a neighbouring (cached) column
+        const uint64_t idx_end = snapshot.lowerBound(cache.getColumnStart(run_last + 1));
 
-            // Add in the data points as required
-            if (pt_counter > 0)
+        // A large run may be reduced on the GPU instead, using the exact samples of each column
+        // (if the backend is unavailable, or the samples do not fit on the GPU, the run is visited below)
+        GpuCompute* gpu = GpuCompute::getInstance();
+
+        if (gpu->isActive() && idx_end - snapshot.lowerBound(cache.getColumnStart(run_first)) >= GpuCompute::MIN_SAMPLES)
+        {
+            std::vector<uint64_t> bounds;
+
+            for (int64_t ii = run_first; ii <= run_last; ii++)
             {
-                t_data.push_back(pt_first.timestamp);
-                y_data.push_back(pt_first.value);
+                bounds.push_back(snapshot.lowerBound(cache.getColumnStart(ii)));
             }
 
-            if (pt_counter > 2)
-            {
-                // If the "minimum" value was lower than the first and last points
-                if ((pt_min.value < pt_first.value) && (pt_min.value < pt_last.value))
-                {
-                    min_value_found = true;
-                }
-                else
-                {
-                    min_value_found = false;
-                }
+            bounds.push_back(idx_end);
 
-                // If the "maximum" value was greater than the first and last points
-                if ((pt_max.value > pt_first.value) && (pt_max.value > pt_last.value))
-                {
-                    max_value_found = true;
-                }
-                else
-                {
-                    max_value_found = false;
-                }
+            PixelColumn* run = &columns[run_first - col_first];
 
-                // Now work out the timestamp order in which to add the point(s)
-                if (min_value_found)
-                {
-                    // Min *and* max value found, determine which one is first
-                    if (max_value_found)
-                    {
-                        if (pt_min.timestamp <= pt_max.timestamp)
-                        {
-                            t_data.push_back(pt_min.timestamp);
-                            y_data.push_back(pt_min.value);
-
-                            t_data.push_back(pt_max.timestamp);
-                            y_data.push_back(pt_max.value);
-                        }
-                        else
-                        {
-                            t_data.push_back(pt_max.timestamp);
-                            y_data.push_back(pt_max.value);
-
-                            t_data.push_back(pt_min.timestamp);
-                            y_data.push_back(pt_min.value);
-                        }
-                    }
-                    else
-                    {
-                        // Just the minimum value
-                        t_data.push_back(pt_min.timestamp);
-                        y_data.push_back(pt_min.value);
-                    }
-                }
-                else if (max_value_found)
-                {
-                    t_data.push_back(pt_max.timestamp);
-                    y_data.push_back(pt_max.value);
-                }
-            }
+            const bool reduced = gpu->visitColumns(snapshot, bounds, [run](size_t column, const DataSnapshot::Bucket& bucket) {
+                run[column].add(bucket);
+            }, [this]() { return isSuperseded(); });
 
-            // Always add the "last" value
-            if (pt_counter >= 1)
+            if (reduced)
             {
-                t_data.push_back(pt_last.timestamp);
-                y_data.push_back(pt_last.value);
+                passStats.gpu = true;
+                col = run_last + 1;
+                continue;
             }
+        }
+
+        PixelColumn* column = &columns[run_first - col_first];
+        double column_end = cache.getColumnStart(run_first + 1);
+
+        for (uint64_t idx = snapshot.lowerBound(cache.getColumnStart(run_first)); idx < idx_end; )
+        {
+            if (isSuperseded()) return false;
+
+            uint64_t next = std::min<uint64_t>((idx / chunk + 1) * chunk, idx_end);
+
+            snapshot.visitBuckets(idx, next, level, [&](const DataSnapshot::Bucket& bucket) {
+                // Buckets are assigned to a pixel column based on the timestamp of the first sample
+                if (bucket.first.timestamp >= column_end)
+                {
+                    int64_t p = std::min(cache.getColumn(bucket.first.timestamp), run_last);
 
-            // Reset point data
-            pt_first = point;
-            pt_min = point;
-            pt_max = point;
-            pt_last = point;
+                    column = &columns[p - col_first];
+                    column_end = cache.getColumnStart(p + 1);
+                }
+
+                column->add(bucket);
+            });
 
-            // Reset point counter
-            pt_counter = 1;
+            idx = next;
         }
+
+        col = run_last + 1;
+    }
+
+    if (!contained)
+    {
+        cache.first = col_first;
+        cache.columns.swap(columns);
+    }
+
+    const PixelColumn* visible = &cache.columns[col_first - cache.first];
+
+    // Samples in the range [idx_first, idx_last) are within the columns
+    const uint64_t idx_first = snapshot.lowerBound(cache.getColumnStart(col_first));
+    const uint64_t idx_last = snapshot.lowerBound(cache.getColumnStart(col_last + 1));
+
+    // The "worst case" down sampling requires 4 data points per pixel
+    // So, pre-allocate that amount of memory
+    output.timestamps.reserve(4 * n_columns + 2);
+    output.values.reserve(4 * n_columns + 2);
+
+    bool sample_right = idx_last < N;
+
+    DataPoint left;
+    DataPoint right;
+
+    if (idx_first > 0)
+    {
+        left = snapshot.getDataPoint(idx_first - 1);
+        output.timestamps.push_back(left.timestamp);
+        output.values.push_back(left.value);
     }
 
-    // If there is a point "off screen" to the right, add it
     if (sample_right)
     {
-        point = series.getDataPoint(idx_max + 1);
-        t_data.push_back(point.timestamp);
-        y_data.push_back(point.value);
+        right = snapshot.getDataPoint(idx_last);
     }
 
-    // Reduce the allocated memory to fit
-    t_data.shrink_to_fit();
-    y_data.shrink_to_fit();
+    if (mode == DOWNSAMPLE_LTTB)
+    {
+        selectLargestTriangles(visible, n_columns, idx_first > 0 ? &left : nullptr, sample_right ? &right : nullptr, output);
+    }
+    else
+    {
+        for (size_t ii = 0; ii < n_columns; ii++)
+        {
+            visible[ii].flush(output);
+        }
+    }
 
-    // Signal that the downsampling process is now complete
-    emit sampleComplete(t_data, y_data);
+    // If there is a point "off screen" to the right, add it
+    if (sample_right)
+    {
+        output.timestamps.push_back(right.timestamp);
+        output.values.push_back(right.value);
+    }
 
-    mutex.unlock();
+    return true;
 }
@@ -1,14 +1,256 @@
 #ifndef PLOT_SAMPLER_HPP
 #define PLOT_SAMPLER_HPP
 
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <QImage>
 #include <QMutex>
+#include <QMetaType>
+#include <QRectF>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "data_series.hpp"
 
 
+/**
+ * @brief The PlotSamples struct holds the output of a single resampling pass.
+ *
+ * Values are raw; the scaler and offset of the series are applied as the samples are drawn.
+ * Once published (see PlotCurveUpdater::sampleComplete) the samples are not modified
+ * until every reference held outside the updater has been released.
+ */
+struct PlotSamples
+{
+    std::vector<double> timestamps;
+    std::vector<double> values;
+
+    //! Range of the raw values (valid if not empty)
+    double minValue = 0;
+    double maxValue = 0;
+
+    //! Sample density, in DOWNSAMPLE_DENSITY mode (row zero is the maximum value)
+    QImage density;
+
+    //! Timespan and (scaled) value range covered by the density image
+    QRectF densityRect;
+
+    size_t size(void) const { return timestamps.size(); }
+
+    void clear(void);
+    void updateRange(void);
+};
+
+typedef std::shared_ptr<const PlotSamples> PlotSamplesPointer;
+
+Q_DECLARE_METATYPE(PlotSamplesPointer)
+
+
+/*
+ * Accumulates the first / min / max / last samples which fall within a single pixel column
+ */
+struct PixelColumn
+{
+    DataPoint first;
+    DataPoint min;
+    DataPoint max;
+    DataPoint last;
+
+    uint64_t count = 0;
+
+    void clear(void) { count = 0; }
+
+    void add(const DataSnapshot::Bucket& bucket);
+
+    size_t getPoints(DataPoint* points) const;
+
+    void flush(PlotSamples& output) const;
+
+protected:
+    void append(PlotSamples& output, const DataPoint& point) const;
+};
+
+
+/**
+ * @brief The PlotColumnCache struct retains the pixel columns computed by a resampling pass.
+ *
+ * Columns are aligned to a fixed grid (origin + k * dt) rather than to the visible timespan.
+ * When the curve is panned at a fixed zoom level, the columns which remain visible are
+ * unchanged, so only the newly exposed columns need to be computed.
+ *
+ * Similarly, when samples are appended to the series (or the oldest samples are discarded),
+ * only the columns which contain changed samples are discarded from the cache.
+ */
+struct PlotColumnCache
+{
+    //! Samples from which the columns were computed
+    DataSnapshot snapshot;
+
+    //! Summary level used to compute the columns
+    int level = -1;
+
+    //! Width of each column
+    double dt = 0;
+
+    //! Start time of column zero
+    double origin = 0;
+
+    //! Grid index of the first cached column
+    int64_t first = 0;
+
+    std::vector<PixelColumn> columns;
+
+    bool hasWidth(double width) const;
+    bool isCompatible(int lvl, double width) const;
+
+    void update(const DataSnapshot& data, uint64_t margin);
+
+    bool contains(int64_t column) const { return column >= first && column < first + (int64_t) columns.size(); }
+
+    int64_t getColumn(double t) const;
+    double getColumnStart(int64_t column) const { return origin + column * dt; }
+
+    void clear(void);
+};
+
+
+/**
+ * @brief The ResampleStats struct describes the most recent published resampling pass of a curve (see PlotCurveUpdater::getStats)
+ */
+struct ResampleStats
+{
+    //! Duration of the pass (ms)
+    double duration = 0;
+
+    //! Raw samples within the view, and samples produced by the pass
+    uint64_t rawPoints = 0;
+    uint64_t outputPoints = 0;
+
+    //! Summary level of the buckets (-1 if raw samples were visited, or drawn directly)
+    int level = -1;
+
+    //! Every sample in the view was drawn (i.e. the view was not down-sampled)
+    bool direct = true;
+
+    //! The samples were computed for another curve of the same series (see PlotResampleCache)
+    bool shared = false;
+
+    //! Pixel columns were reduced on the GPU (see GpuCompute)
+    bool gpu = false;
+
+    //! Number of passes published
+    uint64_t passes = 0;
+};
+
+
+/**
+ * @brief The PlotResampleCache class shares the output of resampling passes between every curve (see getInstance).
+ *
+ * The same series is often drawn by several curves (e.g. an overview and a detail plot, or synchronised plots
+ * of different layouts), whose views are frequently identical. A pass is identified by the samples of the
+ * series (its block table and size, which change whenever the samples change), the time alignment, view and
+ * down-sampling mode, so identical requests from different curves are only resampled once. A request which
+ * is already being resampled by another curve waits for that pass, rather than repeating it.
+ *
+ * The cache observes the block table of each entry without retaining it, so entries for samples which
+ * have since changed (or been removed) expire, and are discarded.
+ */
+class PlotResampleCache
+{
+public:
+    //! Number of completed passes retained
+    static const size_t MAX_ENTRIES = 32;
+
+    static PlotResampleCache* getInstance(void);
+
+    //! Result of acquire
+    enum Result
+    {
+        //! The samples (and the description of their pass) were found
+        RESULT_FOUND = 0,
+
+        //! The caller must resample, then publish (or abandon) the pass
+        RESULT_RESAMPLE,
+
+        //! The caller was cancelled while waiting for another curve
+        RESULT_CANCELLED,
+    };
+
+    Result acquire(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode,
+                   PlotSamplesPointer& samples, ResampleStats& stats, const std::function<bool(void)>& cancelled);
+
+    void publish(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode,
+                 PlotSamplesPointer samples, const ResampleStats& stats);
+
+    void abandon(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode);
+
+    size_t size(void) const;
+    void clear(void);
+
+protected:
+    struct Entry
+    {
+        //! Samples of the series (not retained)
+        std::weak_ptr<const DataBlockTable> table;
+        uint64_t count = 0;
+        double timeScale = 1.0;
+        double timeOffset = 0.0;
+
+        double t_min = 0;
+        double t_max = 0;
+        unsigned int n_pixels = 0;
+        int mode = 0;
+
+        //! Samples are being computed by a curve (null until the pass is published)
+        PlotSamplesPointer samples;
+        ResampleStats stats;
+
+        bool matches(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode) const;
+    };
+
+    std::list<Entry>::iterator find(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, int mode);
+
+    mutable QMutex mutex;
+
+    //! Signalled when a pass is published or abandoned
+    QWaitCondition passComplete;
+
+    //! Passes, most recently used first
+    std::list<Entry> entries;
+};
+
+
+class PlotCurveUpdater;
+
+
+/*
+ * Thread pool task which processes the requests for a single PlotCurveUpdater
+ */
+class PlotResampleTask : public QRunnable
+{
+public:
+    PlotResampleTask(PlotCurveUpdater& u) : updater(u) { setAutoDelete(false); }
+
+    virtual void run() override;
+
+protected:
+    PlotCurveUpdater& updater;
+};
+
+
 /*
  * Class which manages curve resampling.
- * Curve sampling is handled in a background thread, using this class to sample data.
+ * Curve sampling is handled by a thread pool which is shared by every curve (see getThreadPool).
+ *
+ * Requests (see requestCurveSamples) may be made from any thread, and are coalesced:
+ * only the most recent request is processed, and a resampling pass which has been
+ * superseded by a newer request is abandoned without producing any output.
+ * Each updater occupies at most one pool thread at a time.
  */
 class PlotCurveUpdater : public QObject
 {
@@ -16,23 +258,201 @@ class PlotCurveUpdater : public QObject
 
 public:
     PlotCurveUpdater(DataSeries &data_series);
+    virtual ~PlotCurveUpdater();
+
+    //! Minimum number of summary buckets per pixel column when down-sampling
+    static const unsigned int MIN_BUCKETS_PER_PIXEL = 4;
+
+    //! Number of summary buckets visited between checks for a newer request
+    static const uint64_t BUCKETS_PER_CHECK = 4096;
+
+    //! Minimum number of summary buckets per pixel column when rasterizing sample density
+    static const unsigned int DENSITY_BUCKETS_PER_PIXEL = 64;
+
+    //! Zoom factor of a single mouse wheel step (see PlotWidget::wheelEvent), used for prefetching
+    static const double ZOOM_STEP;
+
+    //! Memory used by prefetched pixel columns, per curve (bytes)
+    static const size_t PREFETCH_MEMORY_LIMIT = 4 << 20;
+
+    //! Ratio of full resolution to coarse pixel columns, for progressive requests
+    static const unsigned int PROGRESSIVE_FACTOR = 8;
+
+    //! Down-sampling algorithms (see resample)
+    enum DownsampleMode
+    {
+        DOWNSAMPLE_M4 = 0,
+        DOWNSAMPLE_LTTB = 1,
+
+        //! Sample counts per pixel cell are rendered as an image (see setDensityView)
+        DOWNSAMPLE_DENSITY = 2,
+    };
+
+    //! Value range (scaled) and colour of the density image
+    struct DensityView
+    {
+        double y_min = 0;
+        double y_max = 0;
+        unsigned int rows = 0;
+        QRgb color = 0;
+
+        bool operator==(const DensityView& other) const
+        {
+            return y_min == other.y_min && y_max == other.y_max && rows == other.rows && color == other.color;
+        }
+    };
+
+    //! Task priorities (higher priority tasks are started first)
+    enum Priority
+    {
+        PRIORITY_HIDDEN = 0,
+        PRIORITY_VISIBLE = 1,
+        PRIORITY_FOCUSED = 2,
+
+        //! Offset applied to the full resolution pass of a progressive request
+        PRIORITY_REFINE = -3,
+
+        //! Speculative passes (see prefetchNeighbours) run once every other request is complete
+        PRIORITY_PREFETCH = -6,
+    };
+
+    static QThreadPool* getThreadPool(void);
+
+    int getDownsampleMode(void) const { return downsampleMode.load(); }
+    void setDownsampleMode(int mode) { downsampleMode.store(mode); }
+
+    void setDensityView(double y_min, double y_max, unsigned int n_rows, QRgb color);
+
+    void requestCurveSamples(double t_min, double t_max, unsigned int n_pixels, int priority = PRIORITY_VISIBLE, bool progressive = false);
+    void cancelRequests(void);
+    void waitForRequests(void);
+
+    //! A request is queued or being processed
+    bool isRequestPending(void) const;
+
+    ResampleStats getStats(void) const;
 
 public slots:
     virtual void updateCurveSamples(double t_min, double t_max, unsigned int n_pixels);
 
 signals:
-    // Sampled data is returned
-    void sampleComplete(const QVector<double>&, const QVector<double>&);
+    // Sampled data is returned, along with the scaling to apply to the values
+    void sampleComplete(PlotSamplesPointer samples, double scaler, double offset);
 
 protected:
+    friend class PlotResampleTask;
+
+    void processRequests(void);
+
+    //! Returns true if the columns around a request can be computed ahead of time (see prefetchNeighbours)
+    virtual bool isPrefetchSupported(void) const { return true; }
+
+    bool prefetchNeighbours(double t_min, double t_max, unsigned int n_pixels);
+    void selectColumnCache(double t_min, double t_max, unsigned int n_pixels);
+    void trimPrefetchCaches(void);
+
     DataSeries &series;
 
+    bool resample(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels, PlotSamples& output,
+                  PlotColumnCache& cache, int mode = DOWNSAMPLE_M4);
+
+    bool isCoarsePassUseful(double t_min, double t_max, unsigned int n_pixels) const;
+    void updateCoarseSamples(double t_min, double t_max, unsigned int n_pixels);
+
+    bool rasterizeDensity(const DataSnapshot& snapshot, double t_min, double t_max, unsigned int n_pixels,
+                          const DensityView& view, PlotSamples& output);
+
+    static void selectLargestTriangles(const PixelColumn* columns, size_t n_columns, const DataPoint* left, const DataPoint* right, PlotSamples& output);
+
+    void publishStats(qint64 nsecs, const PlotSamples& output);
+
+    //! Returns true if the request being processed has been superseded by a newer request
+    bool isSuperseded(void) const { return activeGeneration != 0 && requestGeneration.load() != activeGeneration; }
+
+    std::shared_ptr<PlotSamples> acquireBuffer(void);
+
     //! Mutex to prevent simultaneous sampling
     mutable QMutex mutex;
 
     double t_min_latest = -1;
     double t_max_latest = -1;
     unsigned int n_pixels_latest = 0;
+    int mode_latest = DOWNSAMPLE_M4;
+
+    DensityView density_latest;
+
+    //! Selected down-sampling algorithm (may be changed from any thread)
+    std::atomic<int> downsampleMode{DOWNSAMPLE_M4};
+
+    //! Scaling applied to the most recent output
+    double scaler_latest = 1.0;
+    double offset_latest = 0.0;
+
+    //! Most recent output (raw values)
+    PlotSamplesPointer samples_latest;
+
+    //! Pixel columns from the most recent down-sampling pass
+    PlotColumnCache columnCache;
+
+    //! Pixel columns from the most recent coarse pass (kept separate, so that panning re-uses the full resolution columns)
+    PlotColumnCache coarseCache;
+
+    //! Pixel columns at other zoom levels (most recently used first)
+    std::list<PlotColumnCache> prefetchCaches;
+
+    //! Output of speculative passes (discarded)
+    PlotSamples prefetchScratch;
+
+    //! Columns being computed by the current pass (swapped into the cache once complete)
+    std::vector<PixelColumn> columnScratch;
+
+    //! Sample counts per pixel cell, for the density image
+    std::vector<float> densityScratch;
+
+    //! Output buffers, re-used once they are no longer referenced by a curve
+    std::shared_ptr<PlotSamples> buffers[2];
+
+    //! Description of the most recent call to resample (protected by mutex)
+    ResampleStats passStats;
+
+    //! Description of the most recent published pass (see getStats)
+    mutable QMutex statsMutex;
+    ResampleStats stats;
+
+    //! Mutex protecting the pending request
+    mutable QMutex requestMutex;
+
+    //! Signalled when the task completes (see waitForRequests)
+    QWaitCondition taskComplete;
+
+    //! Most recent request (not yet processed)
+    double t_min_requested = 0;
+    double t_max_requested = 0;
+    unsigned int n_pixels_requested = 0;
+    int priority_requested = PRIORITY_VISIBLE;
+
+    DensityView density_requested;
+
+    bool requestPending = false;
+
+    //! A coarse pass should be drawn before the pending request (see requestCurveSamples)
+    bool progressiveRequested = false;
+
+    //! Neighbouring views should be prefetched once the pool is idle
+    bool prefetchPending = false;
+
+    //! Task which processes requests (queued or running while taskActive is set)
+    PlotResampleTask task;
+    bool taskActive = false;
+
+    //! Priority at which the task was most recently queued
+    int taskPriority = PRIORITY_VISIBLE;
+
+    //! Incremented for every request
+    std::atomic<uint64_t> requestGeneration{0};
+
+    //! Generation of the request being processed (zero if not processing a queued request)
+    uint64_t activeGeneration = 0;
 };
 
 
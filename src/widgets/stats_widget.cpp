@@ -1,6 +1,9 @@
+#include <cmath>
+
 #include <qtablewidget.h>
 
 #include "stats_widget.hpp"
+#include "helpers.hpp"
 
 
 StatsWidget::StatsWidget(QWidget *parent) : QWidget(parent)
@@ -10,6 +13,8 @@ StatsWidget::StatsWidget(QWidget *parent) : QWidget(parent)
     setWindowTitle("Statistics");
 
     initTable();
+
+    connect(&engine, &StatsEngine::statsUpdated, this, &StatsWidget::onStatsUpdated);
 }
 
 
@@ -25,28 +30,46 @@ void StatsWidget::initTable()
     headers << tr("Min");
     headers << tr("Max");
     headers << tr("Mean");
-//    headers << tr("Std Dev");
+    headers << tr("Std Dev");
+    headers << tr("RMS");
+
+    // Quantiles are estimated (see QuantileSketch)
+    for (double q : engine.getQuantiles())
+    {
+        headers << (q == 0.5 ? tr("Median") : tr("P%1").arg(q * 100));
+    }
+
+    headers << tr("Memory");
 
     table->setColumnCount(headers.length());
     table->setHorizontalHeaderLabels(headers);
 }
 
 
+/**
+ * @brief StatsWidget::updateStats - Request the statistics of the series within the visible range.
+ * The statistics are computed in the background, and the table is updated once they are available
+ */
 void StatsWidget::updateStats(const QList<DataSeriesPointer> &seriesList, const QwtInterval &interval)
+{
+    engine.requestStats(seriesList, interval.minValue(), interval.maxValue());
+}
+
+
+void StatsWidget::onStatsUpdated()
 {
     auto* table = ui.statsTable;
 
-    double tMin = interval.minValue();
-    double tMax = interval.maxValue();
+    const auto results = engine.getResults();
 
     // Remove any extra rows
-    while (table->rowCount() > seriesList.length())
+    while (table->rowCount() > results.count())
     {
         table->removeRow(table->rowCount() - 1);
     }
 
     // Add any extra rows
-    while (table->rowCount() < seriesList.length())
+    while (table->rowCount() < results.count())
     {
         int row = table->rowCount();
         table->insertRow(row);
@@ -57,27 +80,32 @@ void StatsWidget::updateStats(const QList<DataSeriesPointer> &seriesList, const
         }
     }
 
-    // TODO: Make this a threaded function, could take a long time to calculate
-
     // Fill out the data
-    for (int idx = 0; idx < seriesList.count(); idx++)
+    for (int idx = 0; idx < results.count(); idx++)
     {
-        auto series = seriesList.at(idx);
+        const auto &result = results.at(idx);
+        const auto &stats = result.stats;
 
-        if (series.isNull()) continue;
+        bool valid = stats.count > 0;
 
-        // TODO: If the series does not have any data points within the interval,
-        //       then we should simply ignore it (or display dashes)
+        table->item(idx, 0)->setText(result.label);
+        table->item(idx, 1)->setText(valid ? QString::number(stats.min) : "---");
+        table->item(idx, 2)->setText(valid ? QString::number(stats.max) : "---");
+        table->item(idx, 3)->setText(valid ? QString::number(stats.getMean()) : "---");
+        table->item(idx, 4)->setText(valid ? QString::number(stats.getStdDev()) : "---");
+        table->item(idx, 5)->setText(valid ? QString::number(stats.getRms()) : "---");
 
-        double vMin = series->getMinimumValue(tMin, tMax);
-        double vMax = series->getMaximumValue(tMin, tMax);
-        double vMean = series->getMeanValue(tMin, tMax);
+        // Quantiles are followed by the memory column
+        const int memory_column = table->columnCount() - 1;
 
-        table->item(idx, 0)->setText(series->getLabel());
-        table->item(idx, 1)->setText(QString::number(vMin));
-        table->item(idx, 2)->setText(QString::number(vMax));
-        table->item(idx, 3)->setText(QString::number(vMean));
-    }
+        for (int q = 0; q + 6 < memory_column; q++)
+        {
+            const bool known = valid && q < (int) result.quantiles.size() && !std::isnan(result.quantiles[q]);
 
-}
+            table->item(idx, q + 6)->setText(known ? QString::number(result.quantiles[q]) : "---");
+        }
 
+        table->item(idx, memory_column)->setText(formatDataSize(result.memory.getHeapBytes()));
+        table->item(idx, memory_column)->setToolTip(describeMemoryUsage(result.memory));
+    }
+}
@@ -6,6 +6,7 @@
 #include <qwt_interval.h>
 
 #include "data_series.hpp"
+#include "stats_engine.hpp"
 
 #include "ui_stats_view.h"
 
@@ -20,9 +21,15 @@ public:
 public slots:
     void updateStats(const QList<DataSeriesPointer> &series, const QwtInterval &interval);
 
+protected slots:
+    void onStatsUpdated(void);
+
 protected:
     Ui::stats_form ui;
 
+    //! Computes the statistics in the background (a new request cancels the previous one)
+    StatsEngine engine;
+
     void initTable();
 };
 
@@ -5,6 +5,9 @@
 #include <qwt_scale_widget.h>
 #include <qwt_scale_map.h>
 
+#include <cmath>
+#include <vector>
+
 #include "timeline_widget.hpp"
 
 
@@ -42,6 +45,115 @@ void RangeMarker::draw(QPainter *painter,
 }
 
 
+//! Minimum interval between updates of the envelopes of live series (ms)
+static const int TIMELINE_REFRESH_INTERVAL = 250;
+
+
+EnvelopeMarker::EnvelopeMarker()
+{
+    // Draw the envelopes beneath the range marker
+    setZ(-1);
+}
+
+
+void EnvelopeMarker::setSeries(const QList<DataSeriesPointer> &series)
+{
+    QList<SeriesEnvelope> previous = envelopes;
+    QList<DataSeriesPointer> previousSeries = this->series;
+
+    this->series = series;
+    envelopes.clear();
+
+    // Envelopes of series which were already shown are retained
+    for (const auto &s : series)
+    {
+        const int idx = previousSeries.indexOf(s);
+
+        envelopes.append(idx >= 0 ? previous.at(idx) : SeriesEnvelope());
+    }
+
+    updateEnvelopes();
+}
+
+
+/**
+ * @brief EnvelopeMarker::updateEnvelopes - Update the envelope of each series to the latest samples
+ * @return true if any envelope has changed
+ */
+bool EnvelopeMarker::updateEnvelopes()
+{
+    bool changed = false;
+
+    for (int idx = 0; idx < series.count(); idx++)
+    {
+        if (series.at(idx).isNull()) continue;
+
+        if (envelopes[idx].update(series.at(idx)->getSnapshot()))
+        {
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+
+void EnvelopeMarker::draw(QPainter *painter,
+                          const QwtScaleMap &xMap,
+                          const QwtScaleMap &yMap,
+                          const QRectF &canvasRect) const
+{
+    Q_UNUSED(yMap);
+
+    const int x0 = qRound(canvasRect.left());
+    const int width = qRound(canvasRect.width());
+
+    if (width <= 0) return;
+
+    const double t_min = xMap.invTransform(x0);
+    const double t_max = xMap.invTransform(x0 + width);
+
+    const double top = canvasRect.top() + 5;
+    const double height = canvasRect.height() - 10;
+
+    std::vector<double> mins;
+    std::vector<double> maxs;
+
+    for (int idx = 0; idx < series.count(); idx++)
+    {
+        const SeriesEnvelope &envelope = envelopes.at(idx);
+
+        if (series.at(idx).isNull() || envelope.isEmpty()) continue;
+
+        if (envelope.getColumns(t_min, t_max, width, mins, maxs) == 0) continue;
+
+        const double range = envelope.getMax() - envelope.getMin();
+
+        QColor color = series.at(idx)->getColor();
+        color.setAlpha(150);
+
+        painter->setPen(QPen(color, 1));
+
+        // Each column is drawn as a vertical line, from the minimum to the maximum value
+        for (int col = 0; col < width; col++)
+        {
+            if (std::isnan(mins[col])) continue;
+
+            double y1 = 0.5;
+            double y2 = 0.5;
+
+            if (range > 0)
+            {
+                y1 = (mins[col] - envelope.getMin()) / range;
+                y2 = (maxs[col] - envelope.getMin()) / range;
+            }
+
+            painter->drawLine(x0 + col, qRound(top + height * (1 - y1)), x0 + col, qRound(top + height * (1 - y2)));
+        }
+    }
+}
+
+
 TimelineZoomer::TimelineZoomer(QWidget *parent) : QwtPlotZoomer(parent, true)
 {
     setMaxStackDepth(-1);
@@ -82,6 +194,13 @@ TimelineWidget::TimelineWidget(QWidget *parent) : QwtPlot(parent)
     axisScaleDraw(QwtPlot::xBottom)->enableComponent(QwtAbstractScaleDraw::Labels, false);
     axisScaleDraw(QwtPlot::xBottom)->enableComponent(QwtAbstractScaleDraw::Ticks, false);
 
+    // Initialize series envelopes
+    envelopeMarker.attach(this);
+
+    refreshTimer.setSingleShot(true);
+
+    connect(&refreshTimer, &QTimer::timeout, this, &TimelineWidget::refreshEnvelope);
+
     // Initialize range marker rectangle
     rangeMarker.attach(this);
     rangeMarker.setInterval(QwtInterval(0, 1));
@@ -106,6 +225,48 @@ void TimelineWidget::onZoomed(const QRectF &zoomRect)
 }
 
 
+/**
+ * @brief TimelineWidget::setSeries - set the series which are outlined on the timeline
+ * @param series
+ */
+void TimelineWidget::setSeries(const QList<DataSeriesPointer> &series)
+{
+    if (series == envelopeMarker.getDataSeries()) return;
+
+    for (const auto &s : envelopeMarker.getDataSeries())
+    {
+        if (!s.isNull()) disconnect(s.data(), &DataSeries::dataChanged, this, &TimelineWidget::onDataUpdated);
+    }
+
+    for (const auto &s : series)
+    {
+        if (!s.isNull()) connect(s.data(), &DataSeries::dataChanged, this, &TimelineWidget::onDataUpdated);
+    }
+
+    envelopeMarker.setSeries(series);
+
+    replot();
+}
+
+
+void TimelineWidget::onDataUpdated()
+{
+    if (!refreshTimer.isActive())
+    {
+        refreshTimer.start(TIMELINE_REFRESH_INTERVAL);
+    }
+}
+
+
+void TimelineWidget::refreshEnvelope()
+{
+    if (envelopeMarker.updateEnvelopes())
+    {
+        replot();
+    }
+}
+
+
 /**
  * @brief TimelineWidget::updateTimeLimits - set the min / max time limits
  * @param limits
@@ -6,6 +6,12 @@
 #include <qwt_interval.h>
 #include <qwt_plot_zoomer.h>
 
+#include <QList>
+#include <QTimer>
+
+#include "data_series.hpp"
+#include "series_envelope.hpp"
+
 
 /**
  * @brief The RangeMarker class is a custom QwtPlotItem to draw a rectangular section on the curve.
@@ -31,6 +37,36 @@ protected:
 
 
 
+/**
+ * @brief The EnvelopeMarker class is a custom QwtPlotItem to draw the min / max outline of one or more series.
+ *
+ * Each series is scaled to the full height of the timeline, so that the activity of any series
+ * (rather than its magnitude) is visible.
+ */
+class EnvelopeMarker : public QwtPlotItem
+{
+public:
+    EnvelopeMarker();
+
+    void setSeries(const QList<DataSeriesPointer> &series);
+    const QList<DataSeriesPointer>& getDataSeries(void) const { return series; }
+
+    bool updateEnvelopes(void);
+
+    virtual void draw(QPainter *painter,
+                      const QwtScaleMap &xMap,
+                      const QwtScaleMap &yMap,
+                      const QRectF &canvasRect) const override;
+
+protected:
+    QList<DataSeriesPointer> series;
+
+    //! Envelope of each series
+    QList<SeriesEnvelope> envelopes;
+};
+
+
+
 /**
  * @brief The TimelineZoomer class is a custom implementation of QwtPlotZoomer
  *
@@ -62,11 +98,21 @@ public slots:
 
     void onZoomed(const QRectF &zoomRect);
 
+    void setSeries(const QList<DataSeriesPointer> &series);
+
 signals:
     void timeUpdated(const QwtInterval &interval);
 
+protected slots:
+    void onDataUpdated(void);
+    void refreshEnvelope(void);
+
 protected:
     RangeMarker rangeMarker;
+    EnvelopeMarker envelopeMarker;
+
+    //! Coalesces updates of the series
+    QTimer refreshTimer;
 
     TimelineZoomer *zoomer = nullptr;
 };
@@ -0,0 +1,645 @@
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+#include <QColor>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+
+#include "series_file.hpp"
+#include "workspace_file.hpp"
+
+
+const uint32_t WorkspaceFile::FILE_VERSION;
+
+const QString WorkspaceFile::FILE_EXTENSION = "ljws";
+
+static const char FILE_MAGIC[4] = {'L', 'J', 'W', 'S'};
+
+//! Longest string (bytes) which is accepted when reading a workspace
+static const uint32_t MAX_STRING_LENGTH = 1 << 20;
+
+
+template<typename T>
+static bool writeValue(QIODevice& file, const T& value)
+{
+    return SeriesFile::writeData(file, &value, sizeof(value));
+}
+
+
+template<typename T>
+static bool readValue(QIODevice& file, T& value)
+{
+    return SeriesFile::readData(file, &value, sizeof(value));
+}
+
+
+static bool writeString(QIODevice& file, const QString& text)
+{
+    const QByteArray bytes = text.toUtf8();
+    const uint32_t length = bytes.size();
+
+    return writeValue(file, length) && SeriesFile::writeData(file, bytes.constData(), bytes.size());
+}
+
+
+static bool readString(QIODevice& file, QString& text)
+{
+    uint32_t length = 0;
+
+    if (!readValue(file, length) || length > MAX_STRING_LENGTH) return false;
+
+    const QByteArray bytes = file.read(length);
+
+    if ((uint32_t) bytes.size() != length) return false;
+
+    text = QString::fromUtf8(bytes);
+
+    return true;
+}
+
+
+/*
+ * Write the display properties of a series (the label is written by the caller)
+ */
+static bool writeProperties(QIODevice& file, const DataSeries& series)
+{
+    const uint32_t color = series.getColor().rgba();
+    const float lineWidth = series.getLineWidth();
+    const int32_t styles[4] = {series.getLineStyle(), series.getSymbolStyle(), series.getSymbolSize(), series.getValuePrecision()};
+    const double scaling[3] = {series.getScaler(), series.getOffset(), series.getRetention()};
+    const uint8_t compressed = series.isCompressionEnabled() ? 1 : 0;
+
+    return writeString(file, series.getGroup()) &&
+           writeString(file, series.getUnits()) &&
+           writeValue(file, color) &&
+           writeValue(file, lineWidth) &&
+           writeValue(file, styles) &&
+           writeValue(file, scaling) &&
+           writeValue(file, compressed);
+}
+
+
+static bool readProperties(QIODevice& file, DataSeries& series)
+{
+    QString group;
+    QString units;
+    uint32_t color = 0;
+    float lineWidth = 0;
+    int32_t styles[4] = {0, 0, 0, 0};
+    double scaling[3] = {1, 0, 0};
+    uint8_t compressed = 0;
+
+    const bool valid = readString(file, group) &&
+                       readString(file, units) &&
+                       readValue(file, color) &&
+                       readValue(file, lineWidth) &&
+                       readValue(file, styles) &&
+                       readValue(file, scaling) &&
+                       readValue(file, compressed);
+
+    if (!valid) return false;
+
+    series.setGroup(group);
+    series.setUnits(units);
+    series.setColor(QColor::fromRgba(color));
+    series.setLineWidth(lineWidth);
+    series.setLineStyle(styles[0]);
+    series.setSymbolStyle(styles[1]);
+    series.setSymbolSize(styles[2]);
+    series.setValuePrecision(styles[3] == DataSeries::SINGLE_PRECISION ? DataSeries::SINGLE_PRECISION : DataSeries::DOUBLE_PRECISION);
+    series.setScaler(scaling[0], false);
+    series.setOffset(scaling[1], false);
+    series.setRetention(scaling[2], false);
+    series.setCompressionEnabled(compressed != 0);
+
+    return true;
+}
+
+
+/*
+ * Write the samples of a series, preceded by their length (so they can be skipped when the workspace is loaded)
+ */
+static bool writeSamples(QFileDevice& file, const DataSeries& series)
+{
+    const qint64 start = file.pos();
+
+    uint64_t length = 0;
+
+    if (!writeValue(file, length) || !SeriesFile::writeSamples(file, series.getStoredSnapshot())) return false;
+
+    const qint64 end = file.pos();
+
+    length = end - start - sizeof(length);
+
+    return file.seek(start) && writeValue(file, length) && file.seek(end);
+}
+
+
+/*
+ * Skip the samples of a series, returning the offset of the samples (see SeriesFile::readSamples)
+ */
+static bool skipSamples(QFileDevice& file, qint64& offset)
+{
+    uint64_t length = 0;
+
+    if (!readValue(file, length)) return false;
+
+    offset = file.pos();
+
+    return length <= (uint64_t) (file.size() - offset) && file.seek(offset + length);
+}
+
+
+/*
+ * The samples of a series are read from the workspace file when the series is first used
+ */
+static DataSeries::Loader getLoader(const QString& filename, qint64 offset)
+{
+    return [filename, offset](std::vector<double>& t_ms, std::vector<double>& values) {
+        QFile file(filename);
+
+        return file.open(QIODevice::ReadOnly) && file.seek(offset) && SeriesFile::readSamples(file, t_ms, values);
+    };
+}
+
+
+static bool writePlot(QIODevice& file, const WorkspaceFile::PlotState& plot)
+{
+    const uint32_t curveCount = plot.curves.size();
+    const uint32_t markerCount = plot.markers.size();
+
+    bool valid = writeValue(file, curveCount);
+
+    for (const auto& curve : plot.curves)
+    {
+        const int32_t axis = curve.axis;
+
+        valid = valid && writeString(file, curve.source) && writeString(file, curve.series) && writeValue(file, axis);
+    }
+
+    valid = valid && writeValue(file, markerCount);
+
+    for (const auto& marker : plot.markers)
+    {
+        const int32_t curve = marker.curve;
+
+        valid = valid && writeValue(file, marker.timestamp) && writeValue(file, curve);
+    }
+
+    const double view[6] = {plot.t_min, plot.t_max, plot.y1_min, plot.y1_max, plot.y2_min, plot.y2_max};
+    const uint8_t flags[4] = {plot.xGrid, plot.yGrid, plot.timescaleSynced, plot.followNewest};
+    const int32_t modes[2] = {plot.downsampleMode, plot.markerSnap};
+
+    return valid && writeValue(file, view) && writeValue(file, flags) && writeValue(file, modes);
+}
+
+
+static bool readPlot(QIODevice& file, WorkspaceFile::PlotState& plot)
+{
+    uint32_t curveCount = 0;
+
+    if (!readValue(file, curveCount) || curveCount > MAX_STRING_LENGTH) return false;
+
+    for (uint32_t idx = 0; idx < curveCount; idx++)
+    {
+        WorkspaceFile::CurveState curve;
+        int32_t axis = 0;
+
+        if (!readString(file, curve.source) || !readString(file, curve.series) || !readValue(file, axis)) return false;
+
+        curve.axis = axis;
+        plot.curves.append(curve);
+    }
+
+    uint32_t markerCount = 0;
+
+    if (!readValue(file, markerCount) || markerCount > MAX_STRING_LENGTH) return false;
+
+    for (uint32_t idx = 0; idx < markerCount; idx++)
+    {
+        WorkspaceFile::MarkerState marker;
+        int32_t curve = -1;
+
+        if (!readValue(file, marker.timestamp) || !readValue(file, curve)) return false;
+
+        // Markers refer to curves by index
+        marker.curve = (curve >= 0 && curve < (int32_t) curveCount) ? curve : -1;
+        plot.markers.append(marker);
+    }
+
+    double view[6] = {0, 0, 0, 0, 0, 0};
+    uint8_t flags[4] = {1, 1, 1, 0};
+    int32_t modes[2] = {0, 0};
+
+    if (!readValue(file, view) || !readValue(file, flags) || !readValue(file, modes)) return false;
+
+    plot.t_min = view[0];
+    plot.t_max = view[1];
+    plot.y1_min = view[2];
+    plot.y1_max = view[3];
+    plot.y2_min = view[4];
+    plot.y2_max = view[5];
+
+    plot.xGrid = flags[0] != 0;
+    plot.yGrid = flags[1] != 0;
+    plot.timescaleSynced = flags[2] != 0;
+    plot.followNewest = flags[3] != 0;
+
+    plot.downsampleMode = modes[0];
+    plot.markerSnap = modes[1];
+
+    return true;
+}
+
+
+/*
+ * Order the math traces so that each trace follows any traces it depends on (traces with
+ * a circular dependency, which cannot be restored, are appended last)
+ */
+static QList<MathDataSeriesPointer> getSaveOrder(const QList<MathDataSeriesPointer>& traces)
+{
+    QList<MathDataSeriesPointer> remaining = traces;
+    QList<MathDataSeriesPointer> ordered;
+
+    QSet<const DataSeries*> written;
+
+    while (!remaining.isEmpty())
+    {
+        bool progress = false;
+
+        for (int idx = 0; idx < remaining.size(); )
+        {
+            const auto& trace = remaining[idx];
+
+            bool ready = true;
+
+            for (const auto& input : trace->getVariableMapping().values())
+            {
+                const bool isTrace = std::any_of(traces.begin(), traces.end(), [&input](const MathDataSeriesPointer& t) {
+                    return t.data() == input.data();
+                });
+
+                if (isTrace && !written.contains(input.data())) ready = false;
+            }
+
+            if (ready)
+            {
+                written.insert(trace.data());
+                ordered.append(trace);
+                remaining.removeAt(idx);
+                progress = true;
+            }
+            else
+            {
+                idx++;
+            }
+        }
+
+        if (!progress)
+        {
+            ordered.append(remaining);
+            break;
+        }
+    }
+
+    return ordered;
+}
+
+
+/**
+ * @brief WorkspaceFile::save - Write a workspace file (replacing any existing file)
+ * @param filename is the workspace file
+ * @param workspace describes the session (the raw values of each series are stored)
+ * @param errors receives a description of any problem
+ * @return true if the file was written
+ */
+bool WorkspaceFile::save(const QString& filename, const Workspace& workspace, QStringList& errors)
+{
+    // The file is only replaced once it has been written in full
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        errors.append(QString("Could not open file for writing: %1").arg(filename));
+        return false;
+    }
+
+    // The source label of each series, so the inputs of math traces (and the curves of plots) can be resolved
+    QHash<const DataSeries*, QString> sourceLabels;
+
+    for (const auto& source : workspace.sources)
+    {
+        for (int idx = 0; idx < source->getSeriesCount(); idx++)
+        {
+            sourceLabels[source->getSeriesByIndex(idx).data()] = source->getLabel();
+        }
+    }
+
+    for (const auto& trace : workspace.mathTraces)
+    {
+        sourceLabels[trace.data()] = workspace.mathSource;
+    }
+
+    const uint32_t version = FILE_VERSION;
+    const uint32_t sourceCount = workspace.sources.size();
+
+    bool valid = SeriesFile::writeData(file, FILE_MAGIC, sizeof(FILE_MAGIC)) &&
+                 writeValue(file, version) &&
+                 writeValue(file, sourceCount);
+
+    for (const auto& source : workspace.sources)
+    {
+        if (!valid) break;
+
+        QList<DataSeriesPointer> series;
+
+        // Math traces are stored (and restored) separately
+        for (int idx = 0; idx < source->getSeriesCount(); idx++)
+        {
+            auto s = source->getSeriesByIndex(idx);
+
+            if (s && !s.dynamicCast<MathDataSeries>()) series.append(s);
+        }
+
+        const uint32_t seriesCount = series.size();
+
+        valid = writeString(file, source->getSource()) &&
+                writeString(file, source->getLabel()) &&
+                writeString(file, source->getDescription()) &&
+                writeValue(file, source->getTimeScale()) &&
+                writeValue(file, source->getTimeOffset()) &&
+                writeValue(file, source->getTimeWindowStart()) &&
+                writeValue(file, source->getTimeWindowEnd()) &&
+                writeValue(file, seriesCount);
+
+        for (const auto& s : series)
+        {
+            valid = valid && writeString(file, s->getLabel()) && writeProperties(file, *s) && writeSamples(file, *s);
+        }
+    }
+
+    const QList<MathDataSeriesPointer> traces = getSaveOrder(workspace.mathTraces);
+    const uint32_t traceCount = traces.size();
+
+    valid = valid && writeString(file, workspace.mathSource) && writeValue(file, traceCount);
+
+    for (const auto& trace : traces)
+    {
+        if (!valid) break;
+
+        const auto mapping = trace->getVariableMapping();
+        const uint32_t variableCount = mapping.size();
+        const uint8_t lazy = trace->isLazy() ? 1 : 0;
+
+        valid = writeString(file, trace->getLabel()) &&
+                writeString(file, trace->getExpression()) &&
+                writeValue(file, lazy) &&
+                writeValue(file, trace->getMaxGapSize()) &&
+                writeValue(file, variableCount);
+
+        for (auto it = mapping.begin(); valid && it != mapping.end(); ++it)
+        {
+            if (!sourceLabels.contains(it.value().data()))
+            {
+                errors.append(QString("Input '%1' of math trace '%2' is not part of the workspace").arg(it.key()).arg(trace->getLabel()));
+            }
+
+            valid = writeString(file, it.key()) &&
+                    writeString(file, sourceLabels.value(it.value().data())) &&
+                    writeString(file, it.value() ? it.value()->getLabel() : QString());
+        }
+
+        valid = valid && writeProperties(file, *trace);
+
+        // Lazy traces are evaluated for the visible timespan, so they have no samples to store
+        if (valid && !lazy)
+        {
+            valid = writeSamples(file, *trace);
+        }
+    }
+
+    const uint32_t plotCount = workspace.plots.size();
+
+    valid = valid && writeValue(file, plotCount);
+
+    for (const auto& plot : workspace.plots)
+    {
+        valid = valid && writePlot(file, plot);
+    }
+
+    const uint32_t stateLength = workspace.windowState.size();
+
+    valid = valid && writeValue(file, stateLength) && SeriesFile::writeData(file, workspace.windowState.constData(), stateLength);
+
+    if (!valid || !file.commit())
+    {
+        errors.append(QString("Could not write workspace file: %1").arg(filename));
+
+        file.cancelWriting();
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief WorkspaceFile::load - Read a workspace file. The samples of each series are not read, but
+ * loaded from the file when the series is first used (see DataSeries::setLoader)
+ * @param filename is the workspace file
+ * @param workspace receives the contents of the file
+ * @param errors receives a description of any problem
+ * @return true if the file is a valid workspace
+ */
+bool WorkspaceFile::load(const QString& filename, Workspace& workspace, QStringList& errors)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errors.append(QString("Could not open file for reading: %1").arg(filename));
+        return false;
+    }
+
+    char magic[4] = {0};
+    uint32_t version = 0;
+
+    if (!SeriesFile::readData(file, magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0)
+    {
+        errors.append(QString("Not a workspace file: %1").arg(filename));
+        return false;
+    }
+
+    // Version 1 did not store the time alignment of each source, and version 2 did not store the time window
+    if (!readValue(file, version) || version < 1 || version > FILE_VERSION)
+    {
+        errors.append(QString("Unsupported workspace version %1: %2").arg(version).arg(filename));
+        return false;
+    }
+
+    Workspace loaded;
+
+    // Series by (source, series) label, so the inputs of math traces can be resolved
+    QHash<QPair<QString, QString>, DataSeriesPointer> series;
+
+    uint32_t sourceCount = 0;
+
+    bool valid = readValue(file, sourceCount) && sourceCount < MAX_STRING_LENGTH;
+
+    for (uint32_t idx = 0; valid && idx < sourceCount; idx++)
+    {
+        QString sourceName;
+        QString label;
+        QString description;
+        double timeScale = 1.0;
+        double timeOffset = 0.0;
+        double windowStart = -std::numeric_limits<double>::infinity();
+        double windowEnd = std::numeric_limits<double>::infinity();
+        uint32_t seriesCount = 0;
+
+        valid = readString(file, sourceName) &&
+                readString(file, label) &&
+                readString(file, description) &&
+                (version < 2 || (readValue(file, timeScale) && readValue(file, timeOffset))) &&
+                (version < 3 || (readValue(file, windowStart) && readValue(file, windowEnd))) &&
+                readValue(file, seriesCount) && seriesCount < MAX_STRING_LENGTH;
+
+        if (!valid) break;
+
+        DataSourcePointer source(new DataSource(sourceName, label, description));
+
+        // Applied to each series as it is added
+        source->setTimeScaling(timeScale, timeOffset, false);
+
+        if (windowStart > -std::numeric_limits<double>::infinity() || windowEnd < std::numeric_limits<double>::infinity())
+        {
+            source->setTimeWindow(windowStart, windowEnd, false);
+        }
+
+        for (uint32_t jj = 0; valid && jj < seriesCount; jj++)
+        {
+            QString seriesLabel;
+            qint64 offset = 0;
+
+            DataSeriesPointer s(new DataSeries(QString()));
+
+            valid = readString(file, seriesLabel) && readProperties(file, *s) && skipSamples(file, offset);
+
+            if (!valid) break;
+
+            s->setLabel(seriesLabel);
+            s->setLoader(getLoader(filename, offset));
+
+            source->addSeries(s, false);
+            series[qMakePair(label, seriesLabel)] = s;
+        }
+
+        loaded.sources.append(source);
+    }
+
+    uint32_t traceCount = 0;
+
+    valid = valid && readString(file, loaded.mathSource) && readValue(file, traceCount) && traceCount < MAX_STRING_LENGTH;
+
+    for (uint32_t idx = 0; valid && idx < traceCount; idx++)
+    {
+        QString label;
+        QString expression;
+        uint8_t lazy = 0;
+        double maxGapSize = 0;
+        uint32_t variableCount = 0;
+
+        valid = readString(file, label) &&
+                readString(file, expression) &&
+                readValue(file, lazy) &&
+                readValue(file, maxGapSize) &&
+                readValue(file, variableCount) && variableCount < MAX_STRING_LENGTH;
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        for (uint32_t jj = 0; valid && jj < variableCount; jj++)
+        {
+            QString variable;
+            QString inputSource;
+            QString inputSeries;
+
+            valid = readString(file, variable) && readString(file, inputSource) && readString(file, inputSeries);
+
+            if (!valid) break;
+
+            const auto input = series.value(qMakePair(inputSource, inputSeries));
+
+            if (input)
+            {
+                mapping[variable] = input;
+            }
+            else
+            {
+                errors.append(QString("Could not find input '%1' of math trace '%2'").arg(variable).arg(label));
+            }
+        }
+
+        if (!valid) break;
+
+        MathDataSeriesPointer trace(new MathDataSeries(label, expression, mapping));
+
+        trace->setLazy(lazy != 0);
+        trace->setInputSnapshots(QMap<QString, DataSnapshot>(), maxGapSize);
+
+        valid = readProperties(file, *trace);
+
+        if (valid && !lazy)
+        {
+            qint64 offset = 0;
+
+            valid = skipSamples(file, offset);
+
+            trace->setLoader(getLoader(filename, offset));
+        }
+
+        // A trace with a missing input cannot be evaluated
+        if (valid && mapping.size() == (int) variableCount)
+        {
+            loaded.mathTraces.append(trace);
+            series[qMakePair(loaded.mathSource, label)] = trace;
+        }
+    }
+
+    uint32_t plotCount = 0;
+
+    valid = valid && readValue(file, plotCount) && plotCount < MAX_STRING_LENGTH;
+
+    for (uint32_t idx = 0; valid && idx < plotCount; idx++)
+    {
+        PlotState plot;
+
+        valid = readPlot(file, plot);
+
+        loaded.plots.append(plot);
+    }
+
+    uint32_t stateLength = 0;
+
+    valid = valid && readValue(file, stateLength) && stateLength <= MAX_STRING_LENGTH;
+
+    if (valid)
+    {
+        loaded.windowState = file.read(stateLength);
+        valid = (uint32_t) loaded.windowState.size() == stateLength;
+    }
+
+    if (!valid)
+    {
+        errors.append(QString("Invalid workspace file: %1").arg(filename));
+        return false;
+    }
+
+    workspace = loaded;
+
+    return true;
+}
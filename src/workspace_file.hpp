@@ -0,0 +1,117 @@
+#ifndef WORKSPACE_FILE_HPP
+#define WORKSPACE_FILE_HPP
+
+#include <stdint.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "data_source.hpp"
+#include "math_data_series.hpp"
+
+
+/**
+ * @brief The WorkspaceFile class stores a complete session in a single binary file (e.g. session.ljws):
+ * the imported sources and their series, the math traces, the state of each plot and the window layout.
+ *
+ * The samples of each series are stored as compressed columns (see SeriesFile), so re-opening a workspace
+ * does not import (or parse) the original files again. The samples are not read when the workspace is
+ * opened: each series is loaded on demand (see DataSeries::setLoader), from its offset in the file, when
+ * it is first used. Opening a workspace therefore takes roughly as long as reading its headers, and only
+ * the series which are plotted are decoded (rebuilding their summaries as they are added).
+ *
+ *   "LJWS" | version (uint32)
+ *   source count (uint32), then for each source: source | label | description | time scale (double) |
+ *     time offset (double) | time window start (double) | time window end (double) | series count (uint32),
+ *     then for each series: label | properties | sample length (uint64) | samples
+ *   math source | math trace count (uint32), then for each trace (inputs first): label | expression | lazy |
+ *     max gap (double) | variable count (uint32) | (variable | source | series) | properties | samples
+ *   plot count (uint32), then for each plot: the PlotState
+ *   window state length (uint32) | window state
+ *
+ * Strings are stored as length (uint32) | UTF-8. The samples of each series are stored in full (ignoring the
+ * time window of its source), so a cropped source can be restored and then uncropped. The samples of a lazy math trace are not stored.
+ * The series of a source which was loaded from a workspace are loaded (from that file) before it is saved,
+ * so a workspace can safely be saved over the file it was opened from.
+ */
+class WorkspaceFile
+{
+public:
+    static const uint32_t FILE_VERSION = 3;
+
+    //! Extension of workspace files
+    static const QString FILE_EXTENSION;
+
+    /**
+     * @brief The CurveState struct identifies a curve of a plot (by the labels of its source and series)
+     */
+    struct CurveState
+    {
+        QString source;
+        QString series;
+
+        //! Y axis of the curve (QwtPlot::Axis)
+        int axis = 0;
+    };
+
+    /**
+     * @brief The MarkerState struct describes a marker of a plot
+     */
+    struct MarkerState
+    {
+        double timestamp = 0;
+
+        //! Index of the curve the marker is placed on (or -1 for a time marker)
+        int curve = -1;
+    };
+
+    /**
+     * @brief The PlotState struct describes the curves, view and options of a plot (see PlotWidget::getWorkspaceState)
+     */
+    struct PlotState
+    {
+        QList<CurveState> curves;
+        QList<MarkerState> markers;
+
+        //! Visible interval of the time axis and of each y axis
+        double t_min = 0;
+        double t_max = 0;
+        double y1_min = 0;
+        double y1_max = 0;
+        double y2_min = 0;
+        double y2_max = 0;
+
+        bool xGrid = true;
+        bool yGrid = true;
+        bool timescaleSynced = true;
+        bool followNewest = false;
+
+        int downsampleMode = 0;
+        int markerSnap = 0;
+    };
+
+    /**
+     * @brief The Workspace struct holds the contents of a workspace file
+     */
+    struct Workspace
+    {
+        //! Sources of imported data (math traces are stored separately)
+        QList<DataSourcePointer> sources;
+
+        //! Math traces, with the label of their source (in dependency order)
+        QList<MathDataSeriesPointer> mathTraces;
+        QString mathSource;
+
+        QList<PlotState> plots;
+
+        //! Layout of the main window (see QMainWindow::saveState)
+        QByteArray windowState;
+    };
+
+    static bool save(const QString& filename, const Workspace& workspace, QStringList& errors);
+    static bool load(const QString& filename, Workspace& workspace, QStringList& errors);
+};
+
+#endif // WORKSPACE_FILE_HPP
@@ -3,11 +3,57 @@
 #include "test_series.hpp"
 #include "test_source.hpp"
 #include "test_curve.hpp"
+#include "test_fft.hpp"
+#include "test_math.hpp"
+#include "test_importer.hpp"
+#include "test_exporter.hpp"
+#include "test_analysis.hpp"
+#include "test_tools.hpp"
+#include "test_performance.hpp"
 
 int main(int argc, char *argv[])
 {
     int result = 0;
 
+    // Performance gates are run (instead of the unit tests) with --perf, or --perf-report (see PerformanceGateTests)
+    bool perf = false;
+    bool report = false;
+
+    int count = 0;
+
+    for (int ii = 0; ii < argc; ii++)
+    {
+        const QByteArray arg(argv[ii]);
+
+        if (ii > 0 && arg == "--perf")
+        {
+            perf = true;
+        }
+        else if (ii > 0 && arg == "--perf-report")
+        {
+            perf = true;
+            report = true;
+        }
+        else
+        {
+            argv[count++] = argv[ii];
+        }
+    }
+
+    argc = count;
+
+    if (perf)
+    {
+        qDebug() << "Running performance gates";
+
+        PerformanceGateTests test_performance(report);
+        result += QTest::qExec(&test_performance, argc, argv);
+
+        qDebug() << "Performance gates complete" << result;
+
+        return result;
+    }
+
     qDebug() << "Running unit tests for DataSeries class";
 
     DataSeriesTests test_series;
@@ -23,6 +69,36 @@ int main(int argc, char *argv[])
     PlotCurveTests test_curve;
     result += QTest::qExec(&test_curve, argc, argv);
 
+    qDebug() << "Running unit tests for FFTEngine class";
+
+    FFTEngineTests test_fft;
+    result += QTest::qExec(&test_fft, argc, argv);
+
+    qDebug() << "Running unit tests for MathExpressionParser class";
+
+    MathExpressionTests test_math;
+    result += QTest::qExec(&test_math, argc, argv);
+
+    qDebug() << "Running unit tests for importers";
+
+    ImporterTests test_importer;
+    result += QTest::qExec(&test_importer, argc, argv);
+
+    qDebug() << "Running unit tests for exporters";
+
+    ExporterTests test_exporter;
+    result += QTest::qExec(&test_exporter, argc, argv);
+
+    qDebug() << "Running unit tests for analysis engines";
+
+    AnalysisTests test_analysis;
+    result += QTest::qExec(&test_analysis, argc, argv);
+
+    qDebug() << "Running unit tests for debugging and workspace tools";
+
+    ToolTests test_tools;
+    result += QTest::qExec(&test_tools, argc, argv);
+
     qDebug() << "All tests complete" << result;
 
     return result;
@@ -0,0 +1,744 @@
+#ifndef TEST_ANALYSIS_HPP
+#define TEST_ANALYSIS_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "correlation_engine.hpp"
+#include "data_kernels.hpp"
+#include "data_series.hpp"
+#include "event_index.hpp"
+#include "event_store.hpp"
+#include "histogram_engine.hpp"
+#include "quantile_sketch.hpp"
+#include "series_envelope.hpp"
+#include "stats_engine.hpp"
+#include "time_alignment.hpp"
+
+
+class AnalysisTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    AnalysisTests() : series("my series") {}
+
+private slots:
+
+    void testQuantileSketch(void)
+    {
+        const size_t N = 100000;
+
+        std::vector<double> values(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            // Both signs, and a wide range of magnitudes
+            values[ii] = (((ii * 7919) % N) - 25000.0) * 0.01;
+        }
+
+        std::vector<double> sorted(values);
+        std::sort(sorted.begin(), sorted.end());
+
+        QuantileSketch sketch;
+        sketch.add(values.data(), N);
+
+        QCOMPARE(sketch.getCount(), (uint64_t) N);
+        QCOMPARE(sketch.getQuantile(0), sorted.front());
+        QCOMPARE(sketch.getQuantile(1), sorted.back());
+
+        for (double q : { 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 })
+        {
+            const double exact = sorted[(size_t) std::floor(q * (N - 1))];
+
+            QVERIFY(std::fabs(sketch.getQuantile(q) - exact) <= std::fabs(exact) * sketch.getAccuracy() * 1.01);
+        }
+
+        // Merging sketches of parts of the values is the same as sketching every value
+        QuantileSketch a, b;
+
+        a.add(values.data(), N / 3);
+        b.add(values.data() + N / 3, N - N / 3);
+        a.merge(b);
+
+        QCOMPARE(a.getCount(), sketch.getCount());
+        QCOMPARE(a.getBinCount(), sketch.getBinCount());
+
+        for (double q : { 0.1, 0.5, 0.9 })
+        {
+            QCOMPARE(a.getQuantile(q), sketch.getQuantile(q));
+        }
+
+        QVERIFY(std::isnan(QuantileSketch().getQuantile(0.5)));
+    }
+
+    void testStatsEngine(void)
+    {
+        const size_t N = DataBlock::CAPACITY * 3 + 1000;
+
+        std::vector<double> t(N), v(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            t[ii] = (double) ii;
+            v[ii] = 1 + (double) ((ii * 31) % 1000);
+        }
+
+        series.clearData();
+        series.addData(t, v);
+        series.setScaler(-2);
+
+        StatsEngine engine;
+
+        const std::vector<double> quantiles = { 0.1, 0.5, 0.9 };
+
+        const double t_min = 100;
+        const double t_max = N - 100;
+
+        SeriesStats result = engine.computeStats(series.getSnapshot(), t_min, t_max, quantiles);
+
+        std::vector<double> inRange;
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            if (t[ii] >= t_min && t[ii] <= t_max) inRange.push_back(-2 * v[ii]);
+        }
+
+        std::sort(inRange.begin(), inRange.end());
+
+        QCOMPARE(result.stats.count, (uint64_t) inRange.size());
+        QCOMPARE(result.stats.min, inRange.front());
+        QCOMPARE(result.stats.max, inRange.back());
+
+        double sumSquares = 0;
+
+        for (double value : inRange)
+        {
+            sumSquares += value * value;
+        }
+
+        QVERIFY(std::fabs(result.stats.getRms() - std::sqrt(sumSquares / inRange.size())) < 1e-6);
+
+        QCOMPARE(result.quantiles.size(), quantiles.size());
+
+        for (size_t ii = 0; ii < quantiles.size(); ii++)
+        {
+            const double exact = inRange[(size_t) std::floor(quantiles[ii] * (inRange.size() - 1))];
+
+            // Within the accuracy of the sketch (and one rank, as a negative scaler reverses the order)
+            QVERIFY(std::fabs(result.quantiles[ii] - exact) <= std::fabs(exact) * QuantileSketch::DEFAULT_ACCURACY * 1.01 + 2);
+        }
+
+        // Only the full blocks within the range are cached (the partial blocks at each end are scanned)
+        QCOMPARE(engine.getCachedSketchCount(), (size_t) 2);
+
+        // A range of full blocks is sketched from the cache
+        engine.computeStats(series.getSnapshot(), 0, N, quantiles);
+        QCOMPARE(engine.getCachedSketchCount(), (size_t) 3);
+
+        // A cancelled computation is abandoned
+        CancellationToken token;
+        token.cancel();
+
+        engine.clearCache();
+        engine.computeStats(series.getSnapshot(), 0, N, quantiles, &token);
+        QCOMPARE(engine.getCachedSketchCount(), (size_t) 0);
+
+        series.setScaler(1);
+    }
+
+    void testHistogram(void)
+    {
+        // The vectorised kernel matches the scalar kernel (including values outside the range, and the remainder)
+        std::vector<double> values(1003);
+        std::vector<float> values_single(values.size());
+
+        for (size_t ii = 0; ii < values.size(); ii++)
+        {
+            values[ii] = std::sin(ii * 0.37) * 120.0;
+            values_single[ii] = (float) values[ii];
+        }
+
+        const uint32_t BINS = 37;
+
+        for (size_t n : {0, 3, 4, 101, 1003})
+        {
+            std::vector<uint32_t> expected(BINS), result(BINS);
+
+            DataKernels::histogramScalar(values.data(), n, -100, BINS / 200.0, BINS, expected.data());
+            DataKernels::histogram(values.data(), n, -100, BINS / 200.0, BINS, result.data());
+
+            QVERIFY(result == expected);
+
+            std::fill(expected.begin(), expected.end(), 0);
+            std::fill(result.begin(), result.end(), 0);
+
+            DataKernels::histogramScalar(values_single.data(), n, -100, BINS / 200.0, BINS, expected.data());
+            DataKernels::histogram(values_single.data(), n, -100, BINS / 200.0, BINS, result.data());
+
+            QVERIFY(result == expected);
+        }
+
+        const size_t N = DataBlock::CAPACITY * 3 + 1000;
+
+        std::vector<double> t(N), v(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            t[ii] = (double) ii;
+            v[ii] = 1 + (double) ((ii * 31) % 1000);
+        }
+
+        series.clearData();
+        series.addData(t, v);
+        series.setScaler(-2);
+
+        const int bins = 50;
+        const double t_min = 100;
+        const double t_max = N - 100;
+
+        const SeriesHistogram result = HistogramEngine::computeHistogram(series.getSnapshot(), t_min, t_max, bins, true);
+
+        QVERIFY(result.exact);
+        QCOMPARE(result.counts.size(), (size_t) bins);
+        QCOMPARE(result.count, (uint64_t) (N - 199));
+
+        // The bins span the scaled values (a negative scaler reverses the order of the bins)
+        QCOMPARE(result.min, -2000.0);
+        QCOMPARE(result.max, -2.0);
+
+        std::vector<double> expected(bins, 0.0);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            if (t[ii] < t_min || t[ii] > t_max) continue;
+
+            const int bin = std::min(bins - 1, (int) ((-2 * v[ii] - result.min) / result.getBinWidth()));
+
+            expected[bin]++;
+        }
+
+        double total = 0;
+
+        for (int bin = 0; bin < bins; bin++)
+        {
+            // Values on the edge of a bin may be counted in either bin
+            QVERIFY(std::fabs(result.counts[bin] - expected[bin]) <= 2.0 * N / 1000);
+
+            total += result.counts[bin];
+        }
+
+        QCOMPARE(total, (double) result.count);
+
+        // The estimate (from the summary buckets) preserves the total, and the shape of a slowly varying signal
+        // (the samples of a bucket which spans a large range of values, e.g. a step, are spread over that range)
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            v[ii] = 1 + ii * 0.01;
+        }
+
+        series.clearData();
+        series.addData(t, v);
+
+        const SeriesHistogram counted = HistogramEngine::computeHistogram(series.getSnapshot(), t_min, t_max, bins, true);
+        const SeriesHistogram estimate = HistogramEngine::computeHistogram(series.getSnapshot(), t_min, t_max, bins, false);
+
+        QVERIFY(!estimate.exact);
+        QCOMPARE(estimate.min, counted.min);
+        QCOMPARE(estimate.max, counted.max);
+
+        total = 0;
+
+        for (int bin = 0; bin < bins; bin++)
+        {
+            QVERIFY(std::fabs(estimate.counts[bin] - counted.counts[bin]) <= 0.05 * counted.count / bins);
+
+            total += estimate.counts[bin];
+        }
+
+        QVERIFY(std::fabs(total - counted.count) < 1e-6 * counted.count);
+
+        // A range with a single value has every sample in the first bin
+        const SeriesHistogram single = HistogramEngine::computeHistogram(series.getSnapshot(), 10, 10, bins, true);
+
+        QCOMPARE(single.count, (uint64_t) 1);
+        QCOMPARE(single.counts[0], 1.0);
+
+        // A cancelled computation is abandoned
+        CancellationToken token;
+        token.cancel();
+
+        QVERIFY(HistogramEngine::computeHistogram(series.getSnapshot(), 0, N, bins, true, &token).counts.empty());
+
+        series.setScaler(1);
+    }
+
+    void testSeriesEnvelope(void)
+    {
+        const size_t N = DataBlock::CAPACITY * 2 + 5000;
+
+        series.clearData();
+        series.setScaler(1);
+        series.setOffset(0);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            series.addData((double) ii, (double) (ii % 7919), false);
+        }
+
+        SeriesEnvelope envelope;
+
+        QVERIFY(envelope.update(series.getSnapshot()));
+        QVERIFY(!envelope.update(series.getSnapshot()));
+
+        QCOMPARE(envelope.getMin(), 0.0);
+        QCOMPARE(envelope.getMax(), 7918.0);
+
+        // Roughly one bucket per block (plus the partial summary of the final block)
+        QVERIFY(envelope.getBuckets().size() < 64);
+
+        // Appending samples only summarises the final block again
+        for (size_t ii = N; ii < N + 40000; ii++)
+        {
+            series.addData((double) ii, ii == N + 20000 ? 1e6 : -1.0, false);
+        }
+
+        QVERIFY(envelope.update(series.getSnapshot()));
+
+        SeriesEnvelope full;
+        full.update(series.getSnapshot());
+
+        QCOMPARE(envelope.getBuckets().size(), full.getBuckets().size());
+        QCOMPARE(envelope.getMin(), -1.0);
+        QCOMPARE(envelope.getMax(), 1e6);
+
+        uint64_t expected = 0;
+
+        for (size_t ii = 0; ii < full.getBuckets().size(); ii++)
+        {
+            const auto &a = envelope.getBuckets()[ii];
+            const auto &b = full.getBuckets()[ii];
+
+            QCOMPARE(a.idx, b.idx);
+            QCOMPARE(a.t_first, b.t_first);
+            QCOMPARE(a.t_last, b.t_last);
+            QCOMPARE(a.min, b.min);
+            QCOMPARE(a.max, b.max);
+
+            // Buckets cover every sample, in order
+            QCOMPARE(a.idx, expected);
+            expected = (uint64_t) a.t_last + 1;
+        }
+
+        QCOMPARE(expected, (uint64_t) series.size());
+
+        std::vector<double> mins, maxs;
+
+        // Binned into columns of 1000 samples
+        const int columns = (int) (series.size() / 1000);
+
+        QCOMPARE(envelope.getColumns(0, columns * 1000.0, columns, mins, maxs), columns);
+
+        QCOMPARE(maxs[(N + 20000) / 1000], 1e6);
+        QCOMPARE(mins[(N + 30000) / 1000], -1.0);
+
+        // Columns outside the series are empty
+        QCOMPARE(envelope.getColumns(-2000, -1000, 10, mins, maxs), 0);
+        QVERIFY(std::isnan(mins[0]));
+    }
+
+    void testCorrelation(void)
+    {
+        // One sample per grid point (the grid has at most CorrelationEngine::MAX_POINTS points)
+        const int N = CorrelationEngine::MAX_POINTS + 1;
+        const int delay = 20;
+
+        // White noise, so the correlation has a single narrow peak, and every frequency is present
+        std::vector<double> noise(N + delay);
+        uint32_t state = 12345;
+
+        for (auto &value : noise)
+        {
+            state = state * 1103515245 + 12345;
+            value = (double) (state >> 8) / (1 << 24) - 0.5;
+        }
+
+        std::vector<double> t(N);
+        std::vector<double> a(N);
+        std::vector<double> b(N);
+        std::vector<double> c(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx;
+            a[idx] = noise[idx + delay];
+
+            // The target is a delayed copy of the reference
+            b[idx] = noise[idx];
+
+            // Unrelated to the reference
+            c[idx] = noise[(idx * 7919) % N];
+        }
+
+        DataSeries reference;
+        DataSeries target;
+        DataSeries unrelated;
+
+        reference.addData(t, a, false);
+        target.addData(t, b, false);
+        unrelated.addData(t, c, false);
+
+        CorrelationEngine engine;
+
+        const CorrelationResult result = engine.computeCorrelation(reference.getSnapshot(), target.getSnapshot(), 0, N - 1);
+
+        QVERIFY(result.isValid());
+
+        const auto &correlation = result.correlation;
+
+        QCOMPARE(correlation.values.size(), (size_t) (2 * correlation.maxShift + 1));
+        QVERIFY(fabs(correlation.peak.offset + delay) < correlation.resolution);
+        QVERIFY(correlation.peak.correlation > 0.8);
+
+        // The largest value of the correlation is next to the peak
+        const size_t best = std::max_element(correlation.values.begin(), correlation.values.end()) - correlation.values.begin();
+
+        QVERIFY(fabs(correlation.getOffset(best) - correlation.peak.offset) <= correlation.resolution);
+
+        // The delayed copy is coherent (and lags the reference) at low frequencies
+        const auto &coherence = result.coherence;
+
+        QVERIFY(coherence.segments > 1);
+        QCOMPARE(coherence.frequency.size(), coherence.coherence.size());
+
+        const size_t n_bins = coherence.coherence.size() / 8;
+
+        double mean = 0;
+        double phase = 0;
+
+        for (size_t k = 1; k <= n_bins; k++)
+        {
+            mean += coherence.coherence[k] / n_bins;
+            phase += coherence.phase[k] / n_bins;
+        }
+
+        QVERIFY(mean > 0.8);
+        QVERIFY(phase > 0);
+
+        // Spectra of both series are cached, and are re-used with another target
+        QCOMPARE(engine.getCachedSpectrumCount(), (size_t) 2);
+
+        const CorrelationResult other = engine.computeCorrelation(reference.getSnapshot(), unrelated.getSnapshot(), 0, N - 1);
+
+        QCOMPARE(engine.getCachedSpectrumCount(), (size_t) 3);
+        QVERIFY(!other.isValid() || other.correlation.peak.correlation < 0.2);
+
+        mean = 0;
+
+        for (size_t k = 1; k <= n_bins; k++)
+        {
+            mean += other.coherence.coherence[k] / n_bins;
+        }
+
+        QVERIFY(mean < 0.3);
+
+        // The same snapshots (and grid) give the same result, from the cache
+        const CorrelationResult repeat = engine.computeCorrelation(reference.getSnapshot(), target.getSnapshot(), 0, N - 1);
+
+        QCOMPARE(engine.getCachedSpectrumCount(), (size_t) 3);
+        QCOMPARE(repeat.correlation.peak.offset, correlation.peak.offset);
+
+        // A series with no samples in range cannot be correlated
+        QVERIFY(!engine.computeCorrelation(reference.getSnapshot(), target.getSnapshot(), N, 2 * N).isValid());
+    }
+
+    void testTimeAlignment(void)
+    {
+        const int N = 200000;
+        const double shift = 1234.5;
+
+        // Non-periodic signal (so there is a single peak in the correlation)
+        auto signal = [](double t) {
+            return sin(t * 0.001) + 0.5 * sin(t * 0.0073) + (t > 80000 ? 1.0 : 0.0);
+        };
+
+        DataSeries reference;
+        DataSeries target;
+
+        std::vector<double> t(N);
+        std::vector<double> a(N);
+        std::vector<double> b(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx;
+            a[idx] = signal(idx);
+
+            // The clock of the target is ahead of the reference
+            b[idx] = signal(idx - shift);
+        }
+
+        reference.addData(t, a, false);
+        target.addData(t, b, false);
+
+        TimeAlignment::Result result = TimeAlignment::findOffset(reference.getSnapshot(), target.getSnapshot());
+
+        QVERIFY(result.valid);
+        QVERIFY(result.resolution > 0);
+        QVERIFY(fabs(result.offset + shift) < result.resolution);
+        QVERIFY(result.correlation > 0.9);
+
+        // Once aligned, the remaining offset is (almost) zero
+        target.setTimeScaling(1.0, result.offset, false);
+
+        result = TimeAlignment::findOffset(reference.getSnapshot(), target.getSnapshot());
+
+        QVERIFY(result.valid);
+        QVERIFY(fabs(result.offset) < result.resolution);
+
+        // Offsets beyond the maximum lag are not considered
+        target.setTimeScaling(1.0, 0, false);
+
+        result = TimeAlignment::findOffset(reference.getSnapshot(), target.getSnapshot(), 100);
+        QVERIFY(fabs(result.offset) <= 100 + result.resolution);
+
+        // A constant channel cannot be aligned
+        DataSeries constant;
+        constant.addData(t, std::vector<double>(N, 1.0), false);
+
+        QVERIFY(!TimeAlignment::findOffset(reference.getSnapshot(), constant.getSnapshot()).valid);
+    }
+
+    void testEventStore(void)
+    {
+        EventStore store;
+
+        // Events are kept in time order, regardless of the order they were added
+        store.addEvent(30, "c");
+        store.addEvent(10, "a");
+        store.addEvent(20, "b");
+        store.addEvent(20, "b2");
+
+        QCOMPARE(store.size(), (size_t) 4);
+        QCOMPARE(store.getEvent(0).label, QString("a"));
+        QCOMPARE(store.getEvent(1).label, QString("b"));
+        QCOMPARE(store.getEvent(2).label, QString("b2"));
+        QCOMPARE(store.getEvent(3).label, QString("c"));
+
+        QCOMPARE(store.lowerBound(20), (size_t) 1);
+        QCOMPARE(store.upperBound(20), (size_t) 3);
+        QCOMPARE(store.lowerBound(5), (size_t) 0);
+        QCOMPARE(store.upperBound(50), (size_t) 4);
+
+        // Dense events are grouped into clusters
+        const int N = 100000;
+
+        std::vector<EventStore::Event> events(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            events[idx].timestamp = (double) ((idx * 7919) % N);
+        }
+
+        store.clear();
+        store.addEvents(events);
+
+        QCOMPARE(store.size(), (size_t) N);
+
+        for (size_t idx = 1; idx < store.size(); idx++)
+        {
+            QVERIFY(store.getEvent(idx).timestamp >= store.getEvent(idx - 1).timestamp);
+        }
+
+        auto clusters = store.getClusters(1000, 50999, 100);
+
+        // Each cluster spans the events within 100 of its first event (inclusive)
+        QCOMPARE(clusters.size(), (size_t) 496);
+
+        size_t total = 0;
+
+        for (const auto &cluster : clusters)
+        {
+            QVERIFY(cluster.t_last - cluster.t_first <= 100);
+            total += cluster.count;
+        }
+
+        QCOMPARE(total, (size_t) 50000);
+
+        // Each event is separate if the spacing is small enough
+        QCOMPARE(store.getClusters(0, 99, 0).size(), (size_t) 100);
+
+        // Events at each change of value
+        series.clearData();
+        series.setScaler(1);
+        series.setOffset(0);
+
+        for (int idx = 0; idx < 1000; idx++)
+        {
+            series.addData((double) idx, (double) (idx / 100), false);
+        }
+
+        auto changes = EventStore::fromChanges(series.getSnapshot(), "mode");
+
+        QCOMPARE(changes->size(), (size_t) 10);
+        QCOMPARE(changes->getEvent(3).timestamp, 300.0);
+        QCOMPARE(changes->getEvent(3).label, QString("mode = 3"));
+    }
+
+    void testEventIndex(void)
+    {
+        const int N = DataBlock::CAPACITY * 3 + 500;
+
+        DataSeries signal;
+
+        std::vector<double> t(N);
+        std::vector<double> v(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx;
+            v[idx] = sin(idx * 0.001) * 10 + (idx % 7) * 0.01;
+        }
+
+        signal.addData(t, v, false);
+
+        // Intervals found by visiting every sample
+        auto expected = [&](double scaler, bool above, double threshold) {
+            std::vector<std::pair<uint64_t, uint64_t>> intervals;
+
+            for (int idx = 0; idx < N; idx++)
+            {
+                const double value = v[idx] * scaler;
+
+                if (above ? value > threshold : value < threshold)
+                {
+                    if (!intervals.empty() && intervals.back().second == (uint64_t) idx)
+                    {
+                        intervals.back().second++;
+                    }
+                    else
+                    {
+                        intervals.push_back({idx, idx + 1});
+                    }
+                }
+            }
+
+            return intervals;
+        };
+
+        auto compare = [](const EventIndex &index, const std::vector<std::pair<uint64_t, uint64_t>> &intervals) {
+            if (index.size() != intervals.size()) return false;
+
+            for (size_t ii = 0; ii < intervals.size(); ii++)
+            {
+                const auto &interval = index.getInterval(ii);
+
+                if (interval.idx_first != intervals[ii].first || interval.idx_last != intervals[ii].second) return false;
+                if (interval.t_start != (double) intervals[ii].first || interval.t_end != (double) intervals[ii].second - 1) return false;
+            }
+
+            return true;
+        };
+
+        auto above = EventIndex::build(signal.getSnapshot(), EventIndex::CONDITION_ABOVE, 9.5);
+        auto below = EventIndex::build(signal.getSnapshot(), EventIndex::CONDITION_BELOW, -3);
+
+        QVERIFY(above->size() > 0);
+        QVERIFY(compare(*above, expected(1, true, 9.5)));
+        QVERIFY(compare(*below, expected(1, false, -3)));
+
+        // A negative scaler swaps the extremes of each bucket
+        signal.setScaler(-1, false);
+
+        QVERIFY(compare(*EventIndex::build(signal.getSnapshot(), EventIndex::CONDITION_ABOVE, 3), expected(-1, true, 3)));
+
+        signal.setScaler(1, false);
+
+        // Navigation
+        const auto &first = above->getInterval(0);
+
+        QCOMPARE(above->next(0)->t_start, first.t_start);
+        QCOMPARE(above->next(first.t_start)->t_start, above->getInterval(1).t_start);
+        QVERIFY(above->previous(first.t_start) == nullptr);
+        QCOMPARE(above->previous(first.t_start + 1)->t_start, first.t_start);
+        QCOMPARE(above->toEventStore("I")->size(), above->size());
+
+        // Statistics within the intervals
+        double sum = 0;
+        uint64_t count = 0;
+        double maximum = -INFINITY;
+
+        for (size_t ii = 0; ii < above->size(); ii++)
+        {
+            const auto &interval = above->getInterval(ii);
+
+            for (uint64_t idx = interval.idx_first; idx < interval.idx_last; idx++)
+            {
+                sum += v[idx];
+                maximum = std::max(maximum, v[idx]);
+                count++;
+            }
+        }
+
+        const auto stats = above->getStatistics(signal.getSnapshot());
+
+        QCOMPARE(stats.count, count);
+        QCOMPARE(stats.max, maximum);
+        QVERIFY(fabs(stats.getMean() - sum / count) < 1e-9);
+        QVERIFY(stats.min > 9.5);
+
+        // State changes
+        DataSeries mode;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            mode.addData(idx, (idx / 5000) % 3, false);
+        }
+
+        auto states = EventIndex::build(mode.getSnapshot(), EventIndex::CONDITION_CHANGES);
+
+        QCOMPARE(states->size(), (size_t) ((N + 4999) / 5000));
+        QCOMPARE(states->getInterval(1).idx_first, (uint64_t) 5000);
+        QCOMPARE(states->getInterval(1).value, 1.0);
+        QCOMPARE(states->getInterval(3).value, 0.0);
+
+        // Gaps (including a gap within a summary bucket, and one between blocks)
+        DataSeries sparse;
+
+        std::vector<double> ts;
+        std::vector<double> vs;
+
+        double time = 0;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            time += (idx == 100 || idx == DataBlock::CAPACITY || idx == N - 1) ? 500 : 1;
+
+            ts.push_back(time);
+            vs.push_back(1.0);
+        }
+
+        sparse.addData(ts, vs, false);
+
+        auto gaps = EventIndex::build(sparse.getSnapshot(), EventIndex::CONDITION_GAPS, 10);
+
+        QCOMPARE(gaps->size(), (size_t) 3);
+        QCOMPARE(gaps->getInterval(0).idx_first, (uint64_t) 100);
+        QCOMPARE(gaps->getInterval(0).duration(), 500.0);
+        QCOMPARE(gaps->getInterval(1).idx_first, (uint64_t) DataBlock::CAPACITY);
+        QCOMPARE(gaps->getInterval(2).idx_first, (uint64_t) N - 1);
+        QCOMPARE(gaps->getDuration(), 1500.0);
+
+        QVERIFY(EventIndex::build(DataSnapshot(), EventIndex::CONDITION_ABOVE, 0)->isEmpty());
+    }
+
+protected:
+    DataSeries series;
+};
+
+
+#endif // TEST_ANALYSIS_HPP
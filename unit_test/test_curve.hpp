@@ -3,8 +3,15 @@
 
 #include <qobject.h>
 #include <qtest.h>
+#include <qimage.h>
+#include <qpainter.h>
+#include <qwt_scale_map.h>
+#include <qwt_symbol.h>
 
+#include "gpu_compute.hpp"
 #include "plot_curve.hpp"
+#include "hover_lookup.hpp"
+#include "plot_performance.hpp"
 
 
 class PlotCurveTests : public QObject
@@ -47,8 +54,515 @@ private slots:
         // Allow some time for the data to process
         waitMilliseconds(100);
 
+        // Curve draws directly from the resampled output (at most 4 samples per pixel, plus one either side)
+        QVERIFY(curve->dataSize() > 0);
+        QVERIFY(curve->dataSize() <= 4 * 100 + 2);
+        QVERIFY(curve->boundingRect().left() < 5);
+        QVERIFY(curve->boundingRect().right() > 15);
+
         // Re-sample again!
         curve->resampleData(25, 95, 100);
+
+        waitMilliseconds(100);
+
+        QVERIFY(curve->dataSize() > 0);
+        QVERIFY(curve->sample(0).x() < 25);
+
+        // Scaling is applied without resampling
+        series->setScaler(2, false);
+        curve->resampleData(25, 95, 100);
+
+        waitMilliseconds(100);
+
+        QVERIFY(curve->boundingRect().bottom() >= 2 * 95 * 100);
+
+        // Only the most recent of several rapid requests needs to be drawn
+        for (int ii = 0; ii < 50; ii++)
+        {
+            curve->resampleData(ii, ii + 10, 100);
+        }
+
+        waitMilliseconds(100);
+
+        QVERIFY(curve->sample(0).x() < 49);
+        QVERIFY(curve->sample(0).x() > 48);
+    }
+
+    void testPanning(void)
+    {
+        // Panning at a fixed zoom level re-uses the pixel columns of the previous pass
+        for (double t0 = 20; t0 <= 30; t0 += 0.37)
+        {
+            curve->resampleData(t0, t0 + 10, 100);
+
+            waitMilliseconds(20);
+
+            QVERIFY(curve->dataSize() > 0);
+            QVERIFY(curve->dataSize() <= 4 * 101 + 2);
+            QVERIFY(curve->sample(0).x() < t0);
+            QVERIFY(curve->sample(curve->dataSize() - 1).x() >= t0 + 10);
+
+            for (size_t idx = 1; idx < curve->dataSize(); idx++)
+            {
+                QVERIFY(curve->sample(idx).x() >= curve->sample(idx - 1).x());
+            }
+        }
+    }
+
+    void testDownsampleModes(void)
+    {
+        curve->setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_LTTB);
+        QCOMPARE(curve->getDownsampleMode(), PlotCurveUpdater::DOWNSAMPLE_LTTB);
+
+        curve->resampleData(10, 90, 100);
+
+        waitMilliseconds(100);
+
+        // A single sample per pixel column, plus one either side
+        QVERIFY(curve->dataSize() > 0);
+        QVERIFY(curve->dataSize() <= 101 + 2);
+        QVERIFY(curve->sample(0).x() < 10);
+
+        curve->setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_M4);
+
+        waitMilliseconds(100);
+
+        QVERIFY(curve->dataSize() > 101 + 2);
+    }
+
+    void testProgressive(void)
+    {
+        // A coarse pass is drawn first, and then replaced by the full resolution pass
+        curve->resampleData(0, 100, 400, true);
+
+        waitMilliseconds(100);
+
+        QVERIFY(curve->dataSize() > 4 * (400 / PlotCurveUpdater::PROGRESSIVE_FACTOR) + 2);
+        QVERIFY(curve->dataSize() <= 4 * 400 + 2);
+        QVERIFY(curve->sample(0).x() <= 0);
+    }
+
+    void testDensity(void)
+    {
+        PlotCurveUpdater updater(*series);
+
+        PlotSamplesPointer result;
+
+        connect(&updater, &PlotCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+            result = samples;
+        });
+
+        // Values are scaled by 2 (see testDownsampling)
+        updater.setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_DENSITY);
+        updater.setDensityView(0, 20000, 100, qRgb(255, 0, 0));
+        updater.updateCurveSamples(0, 100, 200);
+
+        QVERIFY(result);
+        QCOMPARE(result->density.width(), 200);
+        QCOMPARE(result->density.height(), 100);
+
+        // The series is a straight line, from the bottom left to the top right
+        int filled = 0;
+
+        for (int row = 0; row < 100; row++)
+        {
+            if (qAlpha(result->density.pixel(100, row)) > 0) filled++;
+        }
+
+        QVERIFY(filled > 0 && filled <= 2);
+        QCOMPARE(qAlpha(result->density.pixel(0, 0)), 0);
+        QCOMPARE(qAlpha(result->density.pixel(199, 99)), 0);
+    }
+
+    void testPrefetch(void)
+    {
+        PlotCurveUpdater updater(*series);
+        PlotCurveUpdater reference(*series);
+
+        PlotSamplesPointer result;
+        PlotSamplesPointer expected;
+
+        connect(&updater, &PlotCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+            result = samples;
+        });
+
+        connect(&reference, &PlotCurveUpdater::sampleComplete, [&expected](PlotSamplesPointer samples, double, double) {
+            expected = samples;
+        });
+
+        // Waits for the neighbouring views to be prefetched, as well as the request itself
+        // (column widths are exact binary fractions, so both updaters use identical column boundaries)
+        updater.requestCurveSamples(40, 56, 128);
+        updater.waitForRequests();
+
+        // Panned and zoomed views are drawn from the prefetched columns
+        const double views[3][2] = {{48, 64}, {32, 48}, {43, 43 + 16 * PlotCurveUpdater::ZOOM_STEP}};
+
+        for (const auto& view : views)
+        {
+            updater.requestCurveSamples(view[0], view[1], 128);
+            updater.waitForRequests();
+
+            reference.updateCurveSamples(view[0], view[1], 128);
+
+            QVERIFY(result && expected);
+            QCOMPARE(result->values.size(), expected->values.size());
+            QCOMPARE(result->values.front(), expected->values.front());
+            QCOMPARE(result->values.back(), expected->values.back());
+
+            // A summary bucket which straddles the final column boundary may differ (by less than one column)
+            const double column = (view[1] - view[0]) / 128 * 100;
+
+            QVERIFY(qAbs(result->maxValue - expected->maxValue) < column);
+        }
+    }
+
+    void testHoverLookup(void)
+    {
+        HoverLookup lookup;
+
+        lookup.setSeries({ series, DataSeriesPointer() });
+
+        // Sweep forwards and backwards across the series
+        for (double t = 10; t < 20; t += 0.0137)
+        {
+            QCOMPARE(lookup.lookup(0, t), series->getValueAtTime(t));
+        }
+
+        for (double t = 20; t > 10; t -= 0.0291)
+        {
+            QCOMPARE(lookup.lookup(0, t), series->getValueAtTime(t));
+        }
+
+        QVERIFY(std::isnan(lookup.lookup(1, 10)));
+        QVERIFY(std::isnan(lookup.lookup(2, 10)));
+
+        // A sparse view is resolved from the raw samples
+        bool resampled = true;
+
+        auto samples = std::make_shared<PlotSamples>();
+        samples->timestamps = { 0, 50, 100 };
+        samples->values = { 0, 1000, 2000 };
+
+        lookup.setSamples(0, samples, 2, 1);
+        lookup.setView(10, 10.01, 1000);
+
+        QCOMPARE(lookup.lookup(0, 10.005, &resampled), series->getValueAtTime(10.005));
+        QVERIFY(!resampled);
+
+        // A dense view is resolved from the resampled samples (with scaling applied)
+        lookup.setView(0, 100, 100);
+
+        QCOMPARE(lookup.lookup(0, 25, &resampled), 1001.0);
+        QVERIFY(resampled);
+
+        QCOMPARE(lookup.lookup(0, 75, &resampled), 3001.0);
+        QCOMPARE(lookup.lookup(0, 200, &resampled), 4001.0);
+
+        lookup.setResampledEnabled(false);
+
+        QCOMPARE(lookup.lookup(0, 25, &resampled), series->getValueAtTime(25));
+        QVERIFY(!resampled);
+
+        // Selections are preserved when the set of series changes
+        lookup.setSeries({ DataSeriesPointer(), series });
+
+        QCOMPARE(lookup.indexOf(series), 1);
+
+        std::vector<double> values;
+        lookup.lookupAll(33, values);
+
+        QCOMPARE((int) values.size(), 2);
+        QCOMPARE(values[1], series->getValueAtTime(33));
+    }
+
+    void testResampleStats(void)
+    {
+        PlotCurveUpdater updater(*series);
+
+        QCOMPARE(updater.getStats().passes, (uint64_t) 0);
+        QVERIFY(!updater.isRequestPending());
+
+        // Down-sampled from the block summaries
+        updater.updateCurveSamples(0, 100, 200);
+
+        ResampleStats stats = updater.getStats();
+
+        QCOMPARE(stats.passes, (uint64_t) 1);
+        QVERIFY(!stats.direct);
+        QVERIFY(stats.level >= 0);
+        QVERIFY(stats.rawPoints > 900000);
+        QVERIFY(stats.outputPoints > 0 && stats.outputPoints <= 4 * 200 + 2);
+        QVERIFY(stats.duration >= 0);
+
+        // Every sample of a narrow view is drawn
+        updater.updateCurveSamples(50, 50.01, 200);
+
+        stats = updater.getStats();
+
+        QCOMPARE(stats.passes, (uint64_t) 2);
+        QVERIFY(stats.direct);
+        QVERIFY(stats.rawPoints <= 200);
+        QVERIFY(stats.outputPoints >= stats.rawPoints);
+    }
+
+    // Test that curves of the same series share the output of identical resampling passes
+    void testSharedResample(void)
+    {
+        PlotResampleCache* cache = PlotResampleCache::getInstance();
+
+        cache->clear();
+
+        PlotCurveUpdater first(*series);
+        PlotCurveUpdater second(*series);
+
+        PlotSamplesPointer a;
+        PlotSamplesPointer b;
+
+        connect(&first, &PlotCurveUpdater::sampleComplete, [&a](PlotSamplesPointer samples, double, double) { a = samples; });
+        connect(&second, &PlotCurveUpdater::sampleComplete, [&b](PlotSamplesPointer samples, double, double) { b = samples; });
+
+        first.updateCurveSamples(10, 60, 300);
+        second.updateCurveSamples(10, 60, 300);
+
+        QVERIFY(a && b);
+        QVERIFY(a == b);
+        QVERIFY(!first.getStats().shared);
+        QVERIFY(second.getStats().shared);
+        QCOMPARE(second.getStats().rawPoints, first.getStats().rawPoints);
+        QCOMPARE(cache->size(), (size_t) 1);
+
+        // A different view is resampled
+        second.updateCurveSamples(10, 60, 301);
+
+        QVERIFY(a != b);
+        QVERIFY(!second.getStats().shared);
+        QCOMPARE(cache->size(), (size_t) 2);
+
+        // The samples have changed, so the previous passes are not re-used
+        series->addData(200, 0, false);
+
+        first.updateCurveSamples(10, 60, 300);
+
+        QVERIFY(!first.getStats().shared);
+
+        // The density image depends on the view of each curve, so it is not shared
+        first.setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_DENSITY);
+        second.setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_DENSITY);
+        first.setDensityView(0, 20000, 50, qRgb(255, 0, 0));
+        second.setDensityView(0, 20000, 50, qRgb(255, 0, 0));
+
+        first.updateCurveSamples(0, 100, 200);
+        second.updateCurveSamples(0, 100, 200);
+
+        QVERIFY(a != b);
+        QVERIFY(!second.getStats().shared);
+
+        // Completed passes are bounded
+        second.setDownsampleMode(PlotCurveUpdater::DOWNSAMPLE_M4);
+
+        for (unsigned int pixels = 1; pixels <= PlotResampleCache::MAX_ENTRIES + 10; pixels++)
+        {
+            second.updateCurveSamples(0, 100, pixels);
+        }
+
+        QVERIFY(cache->size() <= PlotResampleCache::MAX_ENTRIES);
+
+        cache->clear();
+
+        QCOMPARE(cache->size(), (size_t) 0);
+    }
+
+    // Test that the symbols of a dense curve are blitted (and those of a sparse curve drawn individually)
+    void testGpuColumns(void)
+    {
+        GpuCompute* gpu = GpuCompute::getInstance();
+
+        DataSeries data("gpu series");
+
+        // Spans several blocks, including a partially filled final block
+        for (size_t idx = 0; idx < 3 * DataBlock::CAPACITY + 1000; idx++)
+        {
+            data.addData(idx * 0.5, std::sin(idx * 0.001) * 100 + (idx % 7), false);
+        }
+
+        data.setScaler(-2, false);
+        data.setOffset(5, false);
+
+        const DataSnapshot snapshot = data.getSnapshot();
+
+        // Columns of various widths (some of which span block boundaries), including an empty column
+        std::vector<uint64_t> bounds = {10, 500, 500, DataBlock::CAPACITY - 3, DataBlock::CAPACITY + 20, 2 * DataBlock::CAPACITY + 70, snapshot.size()};
+
+        std::vector<GpuCompute::Segment> segments;
+
+        GpuCompute::planSegments(snapshot, bounds, segments);
+
+        QVERIFY(!segments.empty());
+
+        // Segments are contiguous, in timestamp order, and never span a block boundary
+        const auto& table = *snapshot.getTable();
+
+        uint64_t next = bounds.front();
+
+        for (const auto& segment : segments)
+        {
+            QVERIFY(segment.last > segment.first);
+            QVERIFY(segment.last <= table.getBlockLength(segment.block, snapshot.size()));
+            QCOMPARE(table.offsets[segment.block] + segment.first, next);
+            QVERIFY(next >= bounds[segment.column] && next < bounds[segment.column + 1]);
+
+            next = table.offsets[segment.block] + segment.last;
+        }
+
+        QCOMPARE(next, bounds.back());
+
+        // Columns assembled from the extremes of each segment match the columns of the raw samples
+        std::vector<PixelColumn> expected(bounds.size() - 1);
+        std::vector<PixelColumn> actual(bounds.size() - 1);
+
+        for (size_t column = 0; column + 1 < bounds.size(); column++)
+        {
+            snapshot.visitBuckets(bounds[column], bounds[column + 1], -1, [&](const DataSnapshot::Bucket& bucket) {
+                expected[column].add(bucket);
+            });
+        }
+
+        for (const auto& segment : segments)
+        {
+            const DataBlock::Columns columns = table.blocks[segment.block]->getColumns(false);
+
+            // The extremes of the raw values, as found by the kernel
+            GpuCompute::Extremes extremes;
+
+            extremes.min = segment.first;
+            extremes.max = segment.first;
+
+            for (uint32_t idx = segment.first; idx < segment.last; idx++)
+            {
+                if (columns.getValue(idx) < columns.getValue(extremes.min)) extremes.min = idx;
+                if (columns.getValue(idx) > columns.getValue(extremes.max)) extremes.max = idx;
+            }
+
+            actual[segment.column].add(GpuCompute::getBucket(snapshot, columns, segment, extremes));
+        }
+
+        for (size_t column = 0; column < expected.size(); column++)
+        {
+            QCOMPARE(actual[column].count, expected[column].count);
+
+            if (expected[column].count == 0) continue;
+
+            QCOMPARE(actual[column].first.timestamp, expected[column].first.timestamp);
+            QCOMPARE(actual[column].last.timestamp, expected[column].last.timestamp);
+            QCOMPARE(actual[column].min.value, expected[column].min.value);
+            QCOMPARE(actual[column].max.value, expected[column].max.value);
+            QCOMPARE(actual[column].min.timestamp, expected[column].min.timestamp);
+            QCOMPARE(actual[column].max.timestamp, expected[column].max.timestamp);
+        }
+
+        // Without a compute context, columns are not reduced on the GPU (and resampling falls back to the CPU)
+        if (!gpu->isAvailable())
+        {
+            QVERIFY(!gpu->visitColumns(snapshot, bounds, [](size_t, const DataSnapshot::Bucket&) {}));
+
+            PlotCurveUpdater updater(data);
+
+            updater.updateCurveSamples(0, 3 * DataBlock::CAPACITY * 0.5, 100);
+
+            QVERIFY(!updater.getStats().gpu);
+            QVERIFY(updater.getStats().outputPoints > 0);
+        }
+    }
+
+    void testSymbolDensity(void)
+    {
+        QVERIFY(!PlotCurve::isSymbolDense(50, 200));
+        QVERIFY(PlotCurve::isSymbolDense(800, 200));
+        QVERIFY(!PlotCurve::isSymbolDense(800, 0));
+
+        DataSeriesPointer dense(new DataSeries("dense"));
+
+        for (int idx = 0; idx <= 100000; idx++)
+        {
+            dense->addData(idx * 0.001, idx * 0.001, false);
+        }
+
+        // Symbols only, so every drawn pixel is a symbol
+        dense->setColor(Qt::red);
+        dense->setLineStyle(Qt::NoPen);
+        dense->setSymbolStyle(QwtSymbol::Rect);
+
+        PlotCurve symbols(dense);
+
+        for (unsigned int pixels : {200, 20})
+        {
+            symbols.resampleData(0, 100, pixels);
+
+            waitMilliseconds(100);
+
+            QVERIFY(symbols.dataSize() > 0);
+            QCOMPARE(PlotCurve::isSymbolDense(symbols.dataSize(), 200), pixels == 200);
+
+            QImage image(200, 100, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            QwtScaleMap x_map;
+            QwtScaleMap y_map;
+
+            x_map.setScaleInterval(0, 100);
+            x_map.setPaintInterval(0, 200);
+            y_map.setScaleInterval(0, 100);
+            y_map.setPaintInterval(100, 0);
+
+            QPainter painter(&image);
+            symbols.drawSeries(&painter, x_map, y_map, QRectF(0, 0, 200, 100), 0, -1);
+            painter.end();
+
+            // The series is a diagonal line, from the bottom left to the top right
+            QVERIFY(qAlpha(image.pixel(100, 50)) > 0);
+            QCOMPARE(qAlpha(image.pixel(100, 5)), 0);
+            QCOMPARE(qAlpha(image.pixel(100, 95)), 0);
+        }
+    }
+
+    void testPerformanceMonitor(void)
+    {
+        PlotPerformanceMonitor monitor;
+
+        // Rates are measured over the most recent window
+        for (qint64 t = 0; t < 2000; t += 50)
+        {
+            monitor.recordPaint(2.5, t);
+        }
+
+        monitor.recordChange(1990);
+
+        QCOMPARE(monitor.getPaintTime(), 2.5);
+        QCOMPARE(monitor.getReplotRate(1999), 20.0);
+        QCOMPARE(monitor.getChangeRate(1999), 1.0);
+        QCOMPARE(monitor.getReplotRate(5000), 0.0);
+
+        std::vector<PlotPerformanceMonitor::CurveInfo> curves(PlotPerformanceMonitor::MAX_CURVES + 2);
+
+        curves[0].label = "a";
+        curves[0].stats.passes = 1;
+        curves[0].stats.duration = 1.5;
+        curves[0].stats.rawPoints = 1000000;
+        curves[0].stats.outputPoints = 800;
+        curves[0].stats.direct = false;
+        curves[0].stats.level = 2;
+        curves[0].pending = true;
+
+        curves[1].label = "b";
+
+        const QStringList lines = monitor.describe(curves, 5000);
+
+        QCOMPARE(lines.count(), PlotPerformanceMonitor::MAX_CURVES + 2);
+        QCOMPARE(lines.at(0), QString("Paint 2.5 ms | 0 replots/s | 0 changes/s | 1 queued"));
+        QCOMPARE(lines.at(1), QString("a: 1.50 ms | 800 / 1000000 points | level 2 | pending"));
+        QCOMPARE(lines.at(2), QString("b: not resampled"));
+        QCOMPARE(lines.last(), QString("(2 more curves)"));
     }
 
 protected:
@@ -0,0 +1,158 @@
+#ifndef TEST_EXPORTER_HPP
+#define TEST_EXPORTER_HPP
+
+#include <stdlib.h>
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "arrow_file.hpp"
+#include "data_series.hpp"
+#include "text_export_pipeline.hpp"
+
+
+class ExporterTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    // Test that columns (of different lengths) are read back from an Arrow IPC file
+    void testArrowFile(void)
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.path() + "/data.arrow";
+
+        const int64_t N = 1000;
+
+        std::vector<double> a(N);
+        std::vector<double> b(N);
+
+        for (int64_t idx = 0; idx < N; idx++)
+        {
+            a[idx] = idx * 0.25;
+            b[idx] = -(double) (rand() % 10000);
+        }
+
+        QFile output(filename);
+        QVERIFY(output.open(QIODevice::WriteOnly));
+
+        ArrowFileWriter writer(output);
+
+        QVERIFY(writer.begin(QStringList() << "a" << "b"));
+
+        QVERIFY(writer.beginBatch(N, {N, N}));
+        QVERIFY(writer.writeColumn(a.data(), N));
+        QVERIFY(writer.writeColumn(b.data(), N));
+
+        // In the second batch, the remaining rows of column b are null
+        QVERIFY(writer.beginBatch(N, {N, 333}));
+        QVERIFY(!writer.writeColumn(a.data(), 333));
+        QVERIFY(writer.writeColumn(a.data(), N));
+
+        // The batch is incomplete
+        QVERIFY(!writer.finish());
+
+        QVERIFY(writer.writeColumn(b.data(), 333));
+        QVERIFY(writer.finish());
+
+        output.close();
+
+        QVERIFY(output.open(QIODevice::ReadOnly));
+
+        const QByteArray contents = output.readAll();
+
+        ArrowFileReader reader;
+
+        QVERIFY(reader.open((const uint8_t*) contents.constData(), contents.size()));
+        QVERIFY(!reader.open((const uint8_t*) contents.constData(), contents.size() - 1));
+        QVERIFY(reader.open((const uint8_t*) contents.constData(), contents.size()));
+
+        QCOMPARE(reader.getColumnCount(), 2);
+        QCOMPARE(reader.getColumnName(1), QString("b"));
+        QVERIFY(reader.isNumericColumn(0));
+        QCOMPARE(reader.getBatchCount(), 2);
+        QCOMPARE(reader.getBatchRows(1), N);
+
+        std::vector<double> values;
+        std::vector<uint8_t> valid;
+
+        QVERIFY(reader.readColumn(0, 0, values, valid));
+        QCOMPARE((int64_t) values.size(), N);
+        QCOMPARE(values[N - 1], a[N - 1]);
+
+        QVERIFY(reader.readColumn(1, 1, values, valid));
+        QCOMPARE((int64_t) values.size(), N);
+
+        for (int64_t idx = 0; idx < N; idx++)
+        {
+            QCOMPARE(valid[idx] != 0, idx < 333);
+
+            if (valid[idx]) QCOMPARE(values[idx], b[idx]);
+        }
+    }
+
+    // Test that blocks which are formatted in parallel are written in order
+    void testTextExportPipeline(void)
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.path() + "/export.csv";
+
+        const size_t N = 1000;
+
+        auto format = [](size_t block, std::vector<char> &buffer) {
+            for (int ii = 0; ii < 10; ii++)
+            {
+                TextExportPipeline::appendNumber(buffer, block + ii * 0.1);
+                buffer.push_back('\n');
+            }
+        };
+
+        std::vector<char> expected;
+
+        for (size_t block = 0; block < N; block++)
+        {
+            format(block, expected);
+        }
+
+        QFile file(filename);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+
+        TextExportPipeline pipeline;
+
+        QVERIFY(pipeline.run(N, format, file));
+        QCOMPARE(pipeline.getBlocksWritten(), N);
+
+        file.close();
+
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QVERIFY(file.readAll() == QByteArray(expected.data(), (int) expected.size()));
+        file.close();
+
+        // Timestamps in ticks are formatted exactly
+        std::vector<char> text;
+
+        for (int64_t ticks : {1709296205123456789LL, 1709296205000000000LL, -1500000000LL, -500000000LL, 1250LL, 0LL})
+        {
+            TextExportPipeline::appendTicks(text, ticks);
+            text.push_back(' ');
+        }
+
+        QCOMPARE(QByteArray(text.data(), (int) text.size()), QByteArray("1709296205.123456789 1709296205 -1.5 -0.5 0.00000125 0 "));
+
+        // Stop after the first few blocks
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(!pipeline.run(N, format, file, [&pipeline]() { return pipeline.getBlocksWritten() >= 10; }));
+        QCOMPARE(pipeline.getBlocksWritten(), (size_t) 10);
+    }
+};
+
+
+#endif // TEST_EXPORTER_HPP
@@ -0,0 +1,327 @@
+#ifndef TEST_FFT_HPP
+#define TEST_FFT_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <cmath>
+#include <memory>
+
+#include "fft_engine.hpp"
+#include "fft_sampler.hpp"
+#include "spectrogram_sampler.hpp"
+
+
+class FFTEngineTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testComplex(void)
+    {
+        // Powers of two, mixed radix, large odd factors and primes (Bluestein)
+        const size_t sizes[] = {1, 2, 8, 64, 12, 60, 1000, 105, 97, 1009, 2 * 37};
+
+        for (size_t n : sizes)
+        {
+            std::vector<FFTComplex> input(n);
+
+            for (size_t k = 0; k < n; k++)
+            {
+                input[k] = FFTComplex(std::sin(0.37 * k) + 0.1 * k, std::cos(1.3 * k));
+            }
+
+            std::vector<FFTComplex> output(n);
+
+            FFTEngine::getPlan(n)->transform(input.data(), output.data());
+
+            const auto expected = naiveTransform(input);
+
+            for (size_t k = 0; k < n; k++)
+            {
+                QVERIFY(std::abs(output[k] - expected[k]) < 1e-9 * n);
+            }
+        }
+    }
+
+    void testReal(void)
+    {
+        const size_t sizes[] = {2, 128, 1000, 999, 194, 97};
+
+        for (size_t n : sizes)
+        {
+            std::vector<double> input(n);
+
+            for (size_t k = 0; k < n; k++)
+            {
+                input[k] = std::sin(0.1 * k) + 0.5 * std::cos(2.7 * k) + 1;
+            }
+
+            const auto plan = FFTEngine::getRealPlan(n);
+
+            QCOMPARE(plan->getBinCount(), n / 2 + 1);
+
+            std::vector<FFTComplex> output(plan->getBinCount());
+
+            plan->transform(input.data(), output.data());
+
+            const auto expected = naiveTransform(std::vector<FFTComplex>(input.begin(), input.end()));
+
+            for (size_t k = 0; k < output.size(); k++)
+            {
+                QVERIFY(std::abs(output[k] - expected[k]) < 1e-9 * n);
+            }
+        }
+    }
+
+    void testPlanCache(void)
+    {
+        // Plans are shared between requests of the same size
+        QCOMPARE(FFTEngine::getPlan(480).get(), FFTEngine::getPlan(480).get());
+        QCOMPARE(FFTEngine::getRealPlan(480).get(), FFTEngine::getRealPlan(480).get());
+    }
+
+    void testWindow(void)
+    {
+        // A tone which falls between two bins leaks far less with a window applied
+        const size_t n = 1000;
+
+        double leakage[3];
+
+        for (int window = FFTEngine::WINDOW_RECTANGULAR; window <= FFTEngine::WINDOW_BLACKMAN; window++)
+        {
+            std::vector<double> input(n);
+
+            for (size_t k = 0; k < n; k++)
+            {
+                input[k] = std::sin(2 * M_PI * 100.5 * k / n);
+            }
+
+            const double gain = FFTEngine::applyWindow(input.data(), n, window);
+
+            QVERIFY(gain > 0 && gain <= 1);
+
+            const auto plan = FFTEngine::getRealPlan(n);
+
+            std::vector<FFTComplex> output(plan->getBinCount());
+
+            plan->transform(input.data(), output.data());
+
+            leakage[window] = std::abs(output[300]) / std::abs(output[100]);
+        }
+
+        QVERIFY(leakage[FFTEngine::WINDOW_HANN] < leakage[FFTEngine::WINDOW_RECTANGULAR] / 100);
+        QVERIFY(leakage[FFTEngine::WINDOW_BLACKMAN] < leakage[FFTEngine::WINDOW_HANN]);
+    }
+
+    void testSpectrogram(void)
+    {
+        // 50Hz tone for the first 100s, then 200Hz (sampled at 1kHz)
+        DataSeries series("spectrogram series");
+
+        for (int ii = 0; ii < 200000; ii++)
+        {
+            const double t = ii * 1e-3;
+
+            series.addData(t, std::sin(2 * M_PI * (t < 100 ? 50 : 200) * t), false);
+        }
+
+        SpectrogramUpdater updater(series);
+
+        SpectrogramFramesPointer result;
+
+        connect(&updater, &SpectrogramUpdater::framesComplete, [&result](SpectrogramFramesPointer frames) {
+            result = frames;
+        });
+
+        updater.updateCurveSamples(50, 150, 500);
+
+        QVERIFY(result && !result->isEmpty());
+        QVERIFY(result->n_frames <= 500 + 2);
+        QCOMPARE(result->n_bins, (size_t) SpectrogramUpdater::FRAME_SIZE / 2 + 1);
+        QVERIFY(std::fabs(result->f_max - 500) < 1e-6);
+
+        QVERIFY(std::fabs(getPeakFrequency(*result, 10) - 50) < 1);
+        QVERIFY(std::fabs(getPeakFrequency(*result, result->n_frames - 10) - 200) < 1);
+
+        // Panning by 10% only computes the newly visible frames
+        const uint64_t computed = updater.getComputedFrameCount();
+
+        updater.updateCurveSamples(60, 160, 500);
+
+        QVERIFY(updater.getComputedFrameCount() - computed <= result->n_frames / 10 + 2);
+        QCOMPARE(result->getFrameTime(0), std::floor(60 / result->hop) * result->hop);
+    }
+
+    void testSpectrumCache(void)
+    {
+        DataSeries series("spectrum series");
+
+        for (int ii = 0; ii < 20000; ii++)
+        {
+            series.addData(ii * 1e-3, std::sin(0.3 * ii), false);
+        }
+
+        FFTCurveUpdater::clearSpectrumCache();
+
+        FFTCurveUpdater updater(series);
+
+        PlotSamplesPointer result;
+
+        connect(&updater, &FFTCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+            result = samples;
+        });
+
+        updater.updateCurveSamples(1, 9, 0);
+
+        const auto first = result;
+
+        QVERIFY(first && first->size() > 0);
+
+        updater.updateCurveSamples(2, 12, 0);
+
+        QVERIFY(result && result != first);
+
+        // Returning to the earlier view re-uses the cached spectrum
+        updater.updateCurveSamples(1, 9, 0);
+
+        QCOMPARE(result.get(), first.get());
+
+        // Any change to the samples invalidates the cached spectrum
+        series.addData(20, 0, false);
+
+        updater.updateCurveSamples(2, 12, 0);
+        updater.updateCurveSamples(1, 9, 0);
+
+        QVERIFY(result && result != first);
+    }
+
+    void testWelchPanning(void)
+    {
+        // 50Hz tone, sampled at 1kHz
+        DataSeries series("welch series");
+
+        for (int ii = 0; ii < 1000000; ii++)
+        {
+            series.addData(ii * 1e-3, std::sin(2 * M_PI * 50 * ii * 1e-3), false);
+        }
+
+        FFTCurveUpdater::clearSpectrumCache();
+
+        FFTCurveUpdater updater(series);
+
+        PlotSamplesPointer result;
+
+        connect(&updater, &FFTCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+            result = samples;
+        });
+
+        updater.updateCurveSamples(100, 400, 0);
+
+        QVERIFY(result && result->size() > 0);
+        QVERIFY(std::fabs(getPeakFrequency(*result) - 50) < 0.1);
+
+        const uint64_t computed = updater.getComputedSegmentCount();
+
+        QVERIFY(computed >= FFTCurveUpdater::WELCH_MIN_SAMPLES / FFTCurveUpdater::WELCH_SEGMENT_SIZE);
+
+        // Panning by 10% only transforms the newly visible segments
+        updater.updateCurveSamples(130, 430, 0);
+
+        QVERIFY(updater.getComputedSegmentCount() - computed <= 2);
+        QVERIFY(std::fabs(getPeakFrequency(*result) - 50) < 0.1);
+    }
+
+    // Test that updaters can be destroyed while a request is being computed (on the thread pool)
+    void testDestroyWhileComputing(void)
+    {
+        DataSeries series("destroyed series");
+
+        for (int ii = 0; ii < 2000000; ii++)
+        {
+            series.addData(ii * 1e-3, std::sin(2 * M_PI * 50 * ii * 1e-3), false);
+        }
+
+        for (int ii = 0; ii < 8; ii++)
+        {
+            FFTCurveUpdater::clearSpectrumCache();
+
+            std::unique_ptr<FFTCurveUpdater> spectrum(new FFTCurveUpdater(series));
+            std::unique_ptr<SpectrogramUpdater> spectrogram(new SpectrogramUpdater(series));
+
+            spectrum->requestCurveSamples(0, 2000, 0);
+            spectrogram->requestCurveSamples(0, 2000, 2000);
+
+            // Destroy the updaters at various stages of the computation
+            QTest::qSleep(ii * 5);
+
+            QVERIFY(spectrum->isRequestPending() || ii > 0);
+
+            spectrum.reset();
+            spectrogram.reset();
+        }
+
+        // The series is unaffected, and can be computed again in full
+        FFTCurveUpdater updater(series);
+
+        PlotSamplesPointer result;
+
+        connect(&updater, &FFTCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+            result = samples;
+        });
+
+        updater.updateCurveSamples(100, 400, 0);
+
+        QVERIFY(result && std::fabs(getPeakFrequency(*result) - 50) < 0.1);
+    }
+
+protected:
+
+    static double getPeakFrequency(const PlotSamples& samples)
+    {
+        size_t peak = 0;
+
+        for (size_t idx = 1; idx < samples.size(); idx++)
+        {
+            if (samples.values[idx] > samples.values[peak]) peak = idx;
+        }
+
+        return samples.timestamps[peak];
+    }
+
+    static double getPeakFrequency(const SpectrogramFrames& frames, size_t frame)
+    {
+        size_t peak = 0;
+
+        for (size_t bin = 1; bin < frames.n_bins; bin++)
+        {
+            if (frames.getValue(frame, bin) > frames.getValue(frame, peak)) peak = bin;
+        }
+
+        return peak * frames.f_max / (frames.n_bins - 1);
+    }
+
+    static std::vector<FFTComplex> naiveTransform(const std::vector<FFTComplex>& input)
+    {
+        const size_t n = input.size();
+
+        std::vector<FFTComplex> output(n);
+
+        for (size_t k = 0; k < n; k++)
+        {
+            FFTComplex sum(0, 0);
+
+            for (size_t j = 0; j < n; j++)
+            {
+                sum += input[j] * std::polar(1.0, -2 * M_PI * (double) ((k * j) % n) / n);
+            }
+
+            output[k] = sum;
+        }
+
+        return output;
+    }
+};
+
+#endif // TEST_FFT_HPP
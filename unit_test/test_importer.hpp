@@ -0,0 +1,1113 @@
+#ifndef TEST_IMPORTER_HPP
+#define TEST_IMPORTER_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "decompression_device.hpp"
+#include "import_arena.hpp"
+#include "import_cache.hpp"
+#include "import_sink.hpp"
+#include "lumberjack_csv_importer.hpp"
+#include "mavlink_importer.hpp"
+#include "parse_kernels.hpp"
+#include "synthetic_generator.hpp"
+#include "time_ticks.hpp"
+
+#ifdef DECOMPRESS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef DECOMPRESS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef DECOMPRESS_LZMA
+#include <lzma.h>
+#endif
+
+/*
+ * Write the compressed data to a file, then decompress it again (in odd-sized reads)
+ */
+static bool checkDecompression(const QString& filename, const QByteArray& compressed, const QByteArray& expected)
+{
+    QFile output(filename);
+
+    if (!output.open(QIODevice::WriteOnly) || output.write(compressed) != compressed.size()) return false;
+
+    output.close();
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    DecompressionDevice device(&file, DecompressionDevice::getFormat(filename));
+
+    if (!device.open(QIODevice::ReadOnly)) return false;
+
+    QByteArray result;
+    QByteArray block;
+
+    while (!device.atEnd())
+    {
+        block = device.read(40961);
+
+        if (block.isEmpty()) break;
+
+        result.append(block);
+    }
+
+    return !device.hasFailed() && device.getCompressedPosition() == compressed.size() && result == expected;
+}
+
+
+/**
+ * @brief The TestCSVImporter class exposes the options of the CSV importer (which are otherwise set by its dialog)
+ */
+class TestCSVImporter : public LumberjackCSVImporter
+{
+public:
+    CSVImportOptions& options(void) { return m_options; }
+
+    //! Read the file a block at a time, as if it could not be memory-mapped
+    void setMapFile(bool map) { m_mapFile = map; }
+
+    //! Small chunks (and so blocks) place many boundaries within a small file
+    void setChunkSize(qint64 bytes) { m_chunkSize = bytes; }
+};
+
+
+class TestMavlinkImporter : public MavlinkImporter
+{
+public:
+    using MavlinkImporter::CHUNK_SIZE;
+
+    //! Small chunks place many boundaries within a file (a chunk size beyond the file size decodes a single chunk)
+    void setChunkSize(qint64 bytes) { m_chunkSize = bytes; }
+};
+
+
+class ImporterTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    // Test the conversion of cells: numbers, booleans, whitespace and empty cells, and ignored rows
+    void testCSVCells(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        const QByteArray contents =
+            "time, a ,b,c\n"
+            "0,1.5,true, 7 \n"
+            "1,\t2 ,NO,\n"
+            "2,,Yes,8\n"
+            "# 3,99,99,99\n"
+            "3,4,off,x\n"
+            " 4 ,-5e-1,y,inf\n"
+            "5,6,maybe,9\n";
+
+        QByteArray crlf = contents;
+        crlf.replace("\n", "\r\n");
+
+        const std::vector<std::pair<double, double>> a = {{0, 1.5}, {1, 2}, {3, 4}, {4, -0.5}, {5, 6}};
+        const std::vector<std::pair<double, double>> b = {{0, 1}, {1, 0}, {2, 1}, {3, 0}, {4, 1}};
+        const std::vector<std::pair<double, double>> c = {{0, 7}, {2, 8}, {5, 9}};
+
+        // Line endings, and the read path (memory-mapped, or a block at a time), do not affect the samples
+        for (const QByteArray& data : {contents, crlf})
+        {
+            for (bool map : {true, false})
+            {
+                const QString filename = dir.filePath(map ? "mapped.csv" : "read.csv");
+
+                QVERIFY(writeFile(filename, data));
+
+                TestCSVImporter importer;
+
+                importer.setFilename(filename);
+                importer.setMapFile(map);
+                importer.options().ignoreRowsStartingWith = "#";
+
+                QStringList errors;
+
+                QVERIFY(importer.importData(errors));
+                QCOMPARE(importer.getDataSeries().count(), 3);
+
+                QVERIFY(matches(findSeries(importer, "a"), a));
+                QVERIFY(matches(findSeries(importer, "b"), b));
+                QVERIFY(matches(findSeries(importer, "c"), c));
+
+                importer.afterImport();
+            }
+        }
+    }
+
+    // Test delimiters other than a comma, and rows with fewer (or more) cells than the headers
+    void testCSVDelimiters(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.filePath("delimited.csv");
+
+        QVERIFY(writeFile(filename, "time;x;y\n1;10\n2;20;200\n3;30;300;3000\n;40;400\n4;;\n"));
+
+        TestCSVImporter importer;
+
+        importer.setFilename(filename);
+        importer.options().delimeter = CSVImportOptions::SEMICOLON;
+
+        QStringList errors;
+
+        QVERIFY(importer.importData(errors));
+
+        QVERIFY(matches(findSeries(importer, "x"), {{1, 10}, {2, 20}, {3, 30}}));
+        QVERIFY(matches(findSeries(importer, "y"), {{2, 200}, {3, 300}}));
+
+        // The row without a timestamp is counted as a bad line
+        QVERIFY(errors.join(" ").contains("Lines with errors: 1"));
+
+        importer.afterImport();
+    }
+
+    // Test that rows are numbered across chunks and blocks (if there is no timestamp column), and that
+    // the header and units rows may span blocks
+    void testCSVChunks(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.filePath("numbered.csv");
+
+        // The header row is longer than a block (see getSmallChunkSize)
+        QByteArray contents = "first_column_of_the_numbered_file,second_column_of_the_numbered_file\n";
+
+        contents += "m,s\n";
+
+        std::vector<std::pair<double, double>> first;
+        std::vector<std::pair<double, double>> second;
+
+        const int N = 500;
+
+        for (int row = 1; row <= N; row++)
+        {
+            contents += QByteArray::number(row % 13) + "," + QByteArray::number(-row);
+
+            // The final line has no newline
+            if (row < N) contents += "\n";
+
+            first.push_back({row, row % 13});
+            second.push_back({row, -row});
+        }
+
+        QVERIFY(writeFile(filename, contents));
+
+        for (bool map : {true, false})
+        {
+            TestCSVImporter importer;
+
+            importer.setFilename(filename);
+            importer.setMapFile(map);
+            importer.setChunkSize(getSmallChunkSize());
+
+            importer.options().hasTimestamp = false;
+            importer.options().hasUnits = true;
+            importer.options().rowUnits = 1;
+            importer.options().rowDataStart = 2;
+
+            QStringList errors;
+
+            QVERIFY(importer.importData(errors));
+            QVERIFY(errors.isEmpty());
+            QCOMPARE(importer.getDataSeries().count(), 2);
+
+            // Every column is imported (the timestamp column is only skipped if the file has one)
+            QVERIFY(matches(findSeries(importer, "first_column_of_the_numbered_file"), first));
+            QVERIFY(matches(findSeries(importer, "second_column_of_the_numbered_file"), second));
+
+            importer.afterImport();
+        }
+    }
+
+    // Test lines which are longer than a block, and a final line without a newline
+    void testCSVLongLines(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.filePath("long.csv");
+
+        QByteArray contents = "time,value,other\n";
+
+        std::vector<std::pair<double, double>> value;
+        std::vector<std::pair<double, double>> other;
+
+        const int N = 200;
+
+        for (int row = 0; row < N; row++)
+        {
+            const QByteArray number = QByteArray::number(row);
+
+            if (row % 50 == 25)
+            {
+                // Padding (which is trimmed) and trailing zeros span several blocks
+                contents += number + "," + QByteArray(300, ' ') + number + "," + number + "." + QByteArray(300, '0');
+            }
+            else
+            {
+                contents += number + "," + number + "," + QByteArray::number(2 * row);
+            }
+
+            if (row + 1 < N) contents += "\n";
+
+            value.push_back({row, row});
+            other.push_back({row, row % 50 == 25 ? row : 2 * row});
+        }
+
+        QVERIFY(writeFile(filename, contents));
+
+        for (bool map : {true, false})
+        {
+            TestCSVImporter importer;
+
+            importer.setFilename(filename);
+            importer.setMapFile(map);
+            importer.setChunkSize(getSmallChunkSize());
+
+            QStringList errors;
+
+            QVERIFY(importer.importData(errors));
+            QVERIFY(errors.isEmpty());
+
+            QVERIFY(matches(findSeries(importer, "value"), value));
+            QVERIFY(matches(findSeries(importer, "other"), other));
+
+            importer.afterImport();
+        }
+    }
+
+    // Test the layouts compiled from format (and format units) messages, and the scaling of fields
+    void testMavlinkFormats(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        // Two message types (ten channels of S000, and two of S001), with a TimeUS and a float field for each channel
+        SyntheticGenerator::Options options;
+
+        options.channels = 12;
+        options.rate = 50;
+        options.duration = 20;
+        options.shape = SyntheticGenerator::SHAPE_SINE;
+
+        const SyntheticGenerator generator(options);
+
+        const QString filename = dir.filePath("log.bin");
+
+        QStringList errors;
+
+        QVERIFY(generator.writeMavlink(filename, errors));
+
+        // A message type which is logged for two instances (identified by its format units), with scaled fields
+        QByteArray log;
+
+        appendFormat(log, 200, 3 + 8 + 1 + 16 + 16, "FMTU", "QBNN", "TimeUS,FmtType,UnitIds,MultIds");
+        appendFormat(log, 201, 3 + 8 + 1 + 2 + 4 + 4, "IMU", "QBcLf", "TimeUS,I,Temp,Lat,AccX");
+
+        QByteArray units;
+
+        appendField<uint64_t>(units, 0);
+        appendField<uint8_t>(units, 201);
+        units += QByteArray("s#OD-").leftJustified(16, '\0');
+        units += QByteArray("F-GE-").leftJustified(16, '\0');
+
+        appendMessage(log, 200, units);
+
+        const int N = 100;
+
+        for (int k = 0; k < N; k++)
+        {
+            QByteArray payload;
+
+            appendField<uint64_t>(payload, 30000000 + k * 1000);
+            appendField<uint8_t>(payload, k % 2);
+            appendField<int16_t>(payload, 2000 + k);
+            appendField<int32_t>(payload, -353000000 + k);
+            appendField<float>(payload, k * 0.5f);
+
+            appendMessage(log, 201, payload);
+        }
+
+        QFile file(filename);
+
+        QVERIFY(file.open(QIODevice::Append));
+        QCOMPARE(file.write(log), log.size());
+
+        file.close();
+
+        MavlinkImporter importer;
+
+        importer.setFilename(filename);
+
+        errors.clear();
+
+        // Every byte is decoded (the length of each message includes its header)
+        QVERIFY(importer.importData(errors));
+        QVERIFY(errors.isEmpty());
+
+        QCOMPARE(importer.getDataSeries().count(), options.channels + 2 * 3);
+
+        // TimeUS is converted to seconds, and each float channel is a series of its message type
+        for (int channel = 0; channel < options.channels; channel++)
+        {
+            const QString label = QString("S%1:C%2").arg(channel / 10, 3, 10, QChar('0')).arg(channel % 10);
+
+            std::vector<std::pair<double, double>> expected;
+
+            for (uint64_t chunk = 0; chunk < generator.getChunkCount(); chunk++)
+            {
+                std::vector<double> t;
+                std::vector<double> v;
+
+                generator.generateTimestamps(chunk, t);
+                generator.generateValues(chunk, channel, t, v);
+
+                for (size_t row = 0; row < t.size(); row++)
+                {
+                    const double timeUS = (double) (uint64_t) std::llround(std::max(t[row], 0.0) * 1e6);
+
+                    expected.push_back({timeUS * 1e-6, (float) v[row]});
+                }
+            }
+
+            QVERIFY(matches(findSeries(importer, label), expected));
+        }
+
+        // Instances are separate series, and the instance field (and the format units) are not imported
+        for (int instance = 0; instance < 2; instance++)
+        {
+            std::vector<std::pair<double, double>> temp;
+            std::vector<std::pair<double, double>> lat;
+            std::vector<std::pair<double, double>> acc;
+
+            for (int k = instance; k < N; k += 2)
+            {
+                const double t = (double) (uint64_t) (30000000 + k * 1000) * 1e-6;
+
+                temp.push_back({t, (double) (int16_t) (2000 + k) * 0.01});
+                lat.push_back({t, (double) (int32_t) (-353000000 + k) * 1e-7});
+                acc.push_back({t, k * 0.5f});
+            }
+
+            const QString prefix = QString("IMU[%1]:").arg(instance);
+
+            QVERIFY(matches(findSeries(importer, prefix + "Temp"), temp));
+            QVERIFY(matches(findSeries(importer, prefix + "Lat"), lat));
+            QVERIFY(matches(findSeries(importer, prefix + "AccX"), acc));
+
+            QVERIFY(findSeries(importer, prefix + "I").isNull());
+        }
+
+        QVERIFY(findSeries(importer, "IMU:Temp").isNull());
+    }
+
+    // Test that decoding the file in (concurrent) chunks gives the same series as decoding a single chunk
+    void testMavlinkChunks(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        // A single message type of ten channels, so that the file spans more than one (default) chunk
+        SyntheticGenerator::Options options;
+
+        options.channels = 10;
+        options.rate = 1000;
+        options.duration = 100;
+
+        const SyntheticGenerator generator(options);
+
+        const QString filename = dir.filePath("log.bin");
+
+        QStringList errors;
+
+        QVERIFY(generator.writeMavlink(filename, errors));
+
+        // Messages without a timestamp use the time of the previous message (which may be in an earlier chunk),
+        // and their payloads hold header byte sequences (of the generated type, and of the TIM type)
+        QByteArray log;
+
+        appendFormat(log, 210, 3 + 8 + 4, "TIM", "Qf", "TimeUS,Value");
+        appendFormat(log, 211, 3 + 4 + 4, "ADV", "II", "Head,Format");
+
+        const int N = 20000;
+
+        std::vector<std::pair<double, double>> head;
+
+        for (int k = 0; k < N; k++)
+        {
+            const uint64_t timeUS = 200000000 + (uint64_t) k * 1000;
+
+            QByteArray tim;
+
+            appendField<uint64_t>(tim, timeUS);
+            appendField<float>(tim, k);
+
+            appendMessage(log, 210, tim);
+
+            for (int idx = 0; idx < 1 + k % 3; idx++)
+            {
+                const uint32_t value = 0x0195A3 | ((uint32_t) (k & 0xFF) << 24);
+
+                QByteArray adv;
+
+                appendField<uint32_t>(adv, value);
+                appendField<uint32_t>(adv, 0xD295A300 | (k & 0xFF));
+
+                appendMessage(log, 211, adv);
+
+                head.push_back({(double) timeUS * 1e-6, value});
+            }
+        }
+
+        QFile file(filename);
+
+        QVERIFY(file.open(QIODevice::Append));
+        QCOMPARE(file.write(log), log.size());
+
+        file.close();
+
+        const qint64 fileSize = QFileInfo(filename).size();
+
+        QVERIFY(fileSize > TestMavlinkImporter::CHUNK_SIZE);
+
+        TestMavlinkImporter reference;
+
+        reference.setFilename(filename);
+        reference.setChunkSize(fileSize);
+
+        errors.clear();
+
+        QVERIFY(reference.importData(errors));
+        QVERIFY(errors.isEmpty());
+
+        QCOMPARE(reference.getDataSeries().count(), options.channels + 1 + 2);
+
+        QVERIFY(matches(findSeries(reference, "ADV:Head"), head));
+
+        for (qint64 chunkSize : {TestMavlinkImporter::CHUNK_SIZE, (qint64) 1000, (qint64) 4093})
+        {
+            TestMavlinkImporter importer;
+
+            importer.setFilename(filename);
+            importer.setChunkSize(chunkSize);
+
+            errors.clear();
+
+            QVERIFY(importer.importData(errors));
+            QVERIFY(errors.isEmpty());
+
+            QCOMPARE(importer.getDataSeries().count(), reference.getDataSeries().count());
+
+            for (const auto& series : reference.getDataSeries())
+            {
+                const DataSnapshot snapshot = series->getSnapshot();
+
+                std::vector<std::pair<double, double>> expected;
+
+                for (uint64_t idx = 0; idx < snapshot.size(); idx++)
+                {
+                    expected.push_back({snapshot.getTimestamp(idx), snapshot.getValue(idx)});
+                }
+
+                QVERIFY(matches(findSeries(importer, series->getLabel()), expected));
+            }
+        }
+    }
+
+    // Test that the parsing kernels match the standard (correctly rounded) conversion
+    void testParseKernels(void)
+    {
+        qDebug() << "Parsing kernels:" << ParseKernels::getInstructionSet();
+
+        auto parse = [](const char* text, double& value) {
+            return ParseKernels::parseDouble(text, text + strlen(text), value);
+        };
+
+        double value = 0;
+
+        for (const char* text : {"0", "-0", "1", "+1.5", " 42 ", "3.", ".25", "-12.5e3", "1E-5", "0.000123",
+                                 "123456789012345678", "12345678901234567890123", "1e300", "0.1",
+                                 "9007199254740993", "2.2250738585072014e-308", "nan", "inf"})
+        {
+            QVERIFY(parse(text, value));
+
+            const double expected = QByteArray(text).toDouble();
+
+            QVERIFY(value == expected || (std::isnan(value) && std::isnan(expected)));
+        }
+
+        for (const char* text : {"", " ", "-", ".", "e5", "1e", "1.2.3", "1,5", "12a", "0x10", "--1"})
+        {
+            QVERIFY(!parse(text, value));
+        }
+
+        // Random values, formatted as logged by typical software
+        for (int idx = 0; idx < 10000; idx++)
+        {
+            const double v = (rand() - RAND_MAX / 2) * pow(10, rand() % 20 - 12);
+
+            for (const char* format : {"%.17g", "%.6f", "%g", "%.3e"})
+            {
+                char text[64];
+                snprintf(text, sizeof(text), format, v);
+
+                QVERIFY(parse(text, value));
+                QCOMPARE(value, strtod(text, nullptr));
+            }
+        }
+
+        // Runs of digits are located 16 bytes at a time
+        const char digits[] = "0123456789012345678901234567890123456789x";
+
+        for (size_t n = 0; n <= 40; n++)
+        {
+            QCOMPARE(ParseKernels::scanDigits(digits, digits + n), n);
+            QCOMPARE(ParseKernels::scanDigits(digits + 40 - n, digits + 41), n);
+        }
+
+        auto parseTime = [](const char* text, double& seconds) {
+            return ParseKernels::parseTime(text, text + strlen(text), seconds);
+        };
+
+        QVERIFY(parseTime("01:02:03", value));
+        QCOMPARE(value, 3723.0);
+
+        QVERIFY(parseTime("01:02:03.5", value));
+        QCOMPARE(value, 3723.5);
+
+        QVERIFY(parseTime("00:00:10:25", value));
+        QCOMPARE(value, 10.25);
+
+        QVERIFY(parseTime("00:00:10:025", value));
+        QCOMPARE(value, 10.025);
+
+        QVERIFY(!parseTime("00:xx:10", value));
+
+        auto parseDateTime = [](const char* text, double& seconds) {
+            return ParseKernels::parseDateTime(text, text + strlen(text), seconds);
+        };
+
+        QVERIFY(parseDateTime("1970-01-01", value));
+        QCOMPARE(value, 0.0);
+
+        QVERIFY(parseDateTime("2024-03-01T12:30:05.250Z", value));
+        QCOMPARE(value, 1709296205.25);
+
+        QVERIFY(parseDateTime("2024-03-01 22:00:05.250+09:30", value));
+        QCOMPARE(value, 1709296205.25);
+
+        QVERIFY(parseDateTime("2000-02-29T00:00", value));
+        QCOMPARE(value, 951782400.0);
+
+        QVERIFY(parseDateTime("1969-12-31T23:59:59Z", value));
+        QCOMPARE(value, -1.0);
+
+        for (const char* text : {"2023-02-29", "2024-13-01", "2024-03-01T25:00", "2024-03-01T12:30Zx", "24-03-01"})
+        {
+            QVERIFY(!parseDateTime(text, value));
+        }
+
+        // Exact timestamps keep nanosecond resolution, far from the epoch
+        auto parseTicks = [](const char* text, int exponent, int64_t& ticks) {
+            return ParseKernels::parseTicks(text, text + strlen(text), exponent, ticks);
+        };
+
+        int64_t ticks = 0;
+
+        QVERIFY(parseTicks("1709296205.123456789", 9, ticks));
+        QCOMPARE(ticks, (int64_t) 1709296205123456789LL);
+
+        QVERIFY(parseTicks(" -1.5 ", 9, ticks));
+        QCOMPARE(ticks, (int64_t) -1500000000LL);
+
+        QVERIFY(parseTicks("1709296205123.4567", 6, ticks));
+        QCOMPARE(ticks, (int64_t) 1709296205123456700LL);
+
+        // Digits beyond a tick are rounded
+        QVERIFY(parseTicks("0.0000000015", 9, ticks));
+        QCOMPARE(ticks, (int64_t) 2);
+
+        QVERIFY(parseTicks("42", 9, ticks));
+        QCOMPARE(ticks, (int64_t) 42000000000LL);
+
+        for (const char* text : {"", "-", ".", "1e5", "1.2.3", "12a", "99999999999", "nan"})
+        {
+            QVERIFY(!parseTicks(text, 9, ticks));
+        }
+
+        auto parseDateTimeTicks = [](const char* text, int64_t& ticks) {
+            return ParseKernels::parseDateTimeTicks(text, text + strlen(text), ticks);
+        };
+
+        QVERIFY(parseDateTimeTicks("2024-03-01T12:30:05.123456789Z", ticks));
+        QCOMPARE(ticks, (int64_t) 1709296205123456789LL);
+
+        QVERIFY(parseDateTimeTicks("2024-03-01 22:00:05.250+09:30", ticks));
+        QCOMPARE(ticks, (int64_t) 1709296205250000000LL);
+
+        QVERIFY(parseDateTimeTicks("1969-12-31T23:59:59.5Z", ticks));
+        QCOMPARE(ticks, (int64_t) -500000000LL);
+
+        QVERIFY(!parseDateTimeTicks("2023-02-29", ticks));
+
+        // Epoch bases are aligned to the start of a day
+        QCOMPARE(TimeTicks::getDayBase(1709296205123456789LL), (int64_t) 1709251200LL * TimeTicks::PER_SECOND);
+        QCOMPARE(TimeTicks::getDayBase(-500000000LL), -TimeTicks::PER_DAY);
+        QCOMPARE(TimeTicks::getDayBase(0), (int64_t) 0);
+
+        QCOMPARE(TimeTicks::fromSeconds(TimeTicks::toSeconds(123456789012345LL)), (int64_t) 123456789012345LL);
+    }
+
+    // Test that imported series are re-used only while the original file (and the import options) are unchanged
+    void testImportCache(void)
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        const QString filename = dir.path() + "/log.csv";
+
+        QFile file(filename);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("t,a,b\n0,1,2\n");
+        file.close();
+
+        QList<DataSeriesPointer> imported;
+
+        for (int ii = 0; ii < 2; ii++)
+        {
+            DataSeriesPointer series(new DataSeries(ii == 0 ? "a" : "b"));
+
+            for (int idx = 0; idx < 100000; idx++)
+            {
+                series->addData(idx * 0.01, ii == 0 ? idx % 17 : std::sin(idx * 0.001), false);
+            }
+
+            series->setEpochBase(ii * TimeTicks::PER_DAY * 19782);
+
+            imported.append(series);
+        }
+
+        const QByteArray key = ImportCache::getKey(filename, "CSV Importer 0.1.0", "options");
+
+        QList<DataSeriesPointer> loaded;
+
+        QVERIFY(!ImportCache::load(filename, key, loaded));
+        QVERIFY(ImportCache::store(filename, key, imported));
+        QVERIFY(ImportCache::load(filename, key, loaded));
+
+        QCOMPARE(loaded.count(), 2);
+
+        for (int ii = 0; ii < 2; ii++)
+        {
+            const auto expected = imported.at(ii)->getSnapshot();
+            const auto result = loaded.at(ii)->getSnapshot();
+
+            QCOMPARE(loaded.at(ii)->getLabel(), imported.at(ii)->getLabel());
+            QCOMPARE(loaded.at(ii)->getEpochBase(), imported.at(ii)->getEpochBase());
+            QCOMPARE(result.size(), expected.size());
+
+            for (uint64_t idx = 0; idx < expected.size(); idx += 997)
+            {
+                QCOMPARE(result.getTimestamp(idx), expected.getTimestamp(idx));
+                QCOMPARE(result.getValue(idx), expected.getValue(idx));
+            }
+        }
+
+        // Different import options
+        QVERIFY(!ImportCache::load(filename, ImportCache::getKey(filename, "CSV Importer 0.1.0", "other"), loaded));
+
+        // The original file has changed
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("1,2,3\n");
+        file.close();
+
+        QVERIFY(!ImportCache::load(filename, ImportCache::getKey(filename, "CSV Importer 0.1.0", "options"), loaded));
+    }
+
+    // Test that samples held in a memory-mapped store behave identically to heap storage
+    void testDecompression(void)
+    {
+        QCOMPARE(DecompressionDevice::getFormat("log.csv.gz"), DecompressionDevice::FORMAT_GZIP);
+        QCOMPARE(DecompressionDevice::getFormat("log.csv.ZST"), DecompressionDevice::FORMAT_ZSTD);
+        QCOMPARE(DecompressionDevice::getFormat("log.csv.xz"), DecompressionDevice::FORMAT_XZ);
+        QCOMPARE(DecompressionDevice::getFormat("log.csv"), DecompressionDevice::FORMAT_NONE);
+        QCOMPARE(DecompressionDevice::getUncompressedName("/data/log.csv.gz"), QString("/data/log.csv"));
+        QCOMPARE(DecompressionDevice::getUncompressedName("/data/log.csv"), QString("/data/log.csv"));
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        // Several parts, which are compressed separately (e.g. gzip members or zstd frames)
+        QList<QByteArray> parts;
+        QByteArray expected;
+
+        for (int ii = 0; ii < 5; ii++)
+        {
+            QByteArray part;
+
+            for (int idx = 0; idx < 20000 * (ii + 1); idx++)
+            {
+                part += QByteArray::number(idx * 0.01) + "," + QByteArray::number(idx % (17 + ii)) + "\n";
+            }
+
+            parts.append(part);
+            expected += part;
+        }
+
+#ifdef DECOMPRESS_ZLIB
+        {
+            QByteArray compressed;
+
+            for (const auto& part : parts)
+            {
+                z_stream zs;
+                memset(&zs, 0, sizeof(zs));
+
+                // gzip header
+                QVERIFY(deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+                QByteArray member(deflateBound(&zs, part.size()) + 32, 0);
+
+                zs.next_in = (Bytef*) part.data();
+                zs.avail_in = part.size();
+                zs.next_out = (Bytef*) member.data();
+                zs.avail_out = member.size();
+
+                QVERIFY(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+
+                member.resize(zs.total_out);
+                deflateEnd(&zs);
+
+                compressed += member;
+            }
+
+            QVERIFY(checkDecompression(dir.path() + "/log.csv.gz", compressed, expected));
+
+            // Truncated data are reported
+            QVERIFY(!checkDecompression(dir.path() + "/truncated.csv.gz", compressed.left(compressed.size() - 100), expected));
+        }
+#endif
+
+#ifdef DECOMPRESS_ZSTD
+        {
+            QByteArray compressed;
+
+            for (int ii = 0; ii < parts.count(); ii++)
+            {
+                const QByteArray& part = parts.at(ii);
+
+                ZSTD_CCtx* context = ZSTD_createCCtx();
+
+                // The last frame does not record its size, so it is decoded as a stream
+                ZSTD_CCtx_setParameter(context, ZSTD_c_contentSizeFlag, ii < parts.count() - 1 ? 1 : 0);
+
+                QByteArray frame(ZSTD_compressBound(part.size()), 0);
+
+                const size_t size = ZSTD_compress2(context, frame.data(), frame.size(), part.data(), part.size());
+                ZSTD_freeCCtx(context);
+
+                QVERIFY(!ZSTD_isError(size));
+
+                frame.resize(size);
+                compressed += frame;
+            }
+
+            QVERIFY(checkDecompression(dir.path() + "/log.csv.zst", compressed, expected));
+            QVERIFY(!checkDecompression(dir.path() + "/truncated.csv.zst", compressed.left(compressed.size() - 100), expected));
+        }
+#endif
+
+#ifdef DECOMPRESS_LZMA
+        {
+            QByteArray compressed(lzma_stream_buffer_bound(expected.size()), 0);
+            size_t size = 0;
+
+            QVERIFY(lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr,
+                                            (const uint8_t*) expected.data(), expected.size(),
+                                            (uint8_t*) compressed.data(), &size, compressed.size()) == LZMA_OK);
+
+            compressed.resize(size);
+
+            QVERIFY(checkDecompression(dir.path() + "/log.csv.xz", compressed, expected));
+            QVERIFY(!checkDecompression(dir.path() + "/truncated.csv.xz", compressed.left(compressed.size() - 100), expected));
+        }
+#endif
+    }
+
+    void testImportSink(void)
+    {
+        SeriesImportSink sink;
+
+        sink.setCompressionEnabled(true);
+
+        const int a = sink.declareChannel("a", "group", "V");
+        const int b = sink.declareChannel("b");
+
+        QCOMPARE(a, 0);
+        QCOMPARE(b, 1);
+        QCOMPARE(sink.getChannelCount(), 2);
+
+        const size_t N = DataBlock::CAPACITY + 100;
+
+        std::vector<double> t(N), va(N), vb(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            t[ii] = (double) ii;
+            va[ii] = (double) (ii % 7);
+            vb[ii] = -(double) ii;
+        }
+
+        // Batches may be pushed from several threads at once
+        const size_t half = N / 2;
+
+        bool pushed = false;
+
+        std::thread worker([&]() {
+            pushed = sink.pushSamples(b, t.data(), vb.data(), half);
+        });
+
+        QVERIFY(sink.pushSamples(a, t.data(), va.data(), N));
+
+        worker.join();
+
+        QVERIFY(pushed);
+
+        const double *columns[] = { vb.data() + half };
+
+        QVERIFY(sink.pushColumns(QVector<int>({ b }), t.data() + half, columns, N - half));
+
+        // Unknown channels are rejected
+        QVERIFY(!sink.pushSamples(2, t.data(), va.data(), 1));
+        QVERIFY(!sink.pushSamples(-1, t.data(), va.data(), 1));
+
+        QCOMPARE(sink.getSampleCount(), (uint64_t) N * 2);
+
+        auto channels = sink.getDataSeries();
+
+        QCOMPARE(channels.count(), 2);
+
+        QCOMPARE(channels[0]->getLabel(), QString("a"));
+        QCOMPARE(channels[0]->getGroup(), QString("group"));
+        QCOMPARE(channels[0]->getUnits(), QString("V"));
+        QVERIFY(channels[0]->isCompressionEnabled());
+
+        QCOMPARE((size_t) channels[0]->size(), N);
+        QCOMPARE((size_t) channels[1]->size(), N);
+
+        bool match = true;
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            if (channels[0]->getValue(ii) != va[ii] || channels[1]->getValue(ii) != vb[ii]) match = false;
+            if (channels[1]->getTimestamp(ii) != t[ii]) match = false;
+        }
+
+        QVERIFY(match);
+    }
+
+    void testImportArena(void)
+    {
+        ImportArena arena;
+
+        QCOMPARE(arena.getCapacity(), (size_t) 0);
+
+        // Allocations are aligned
+        auto *bytes = arena.allocate<char>(3);
+        auto *values = arena.allocate<double>(10);
+
+        QVERIFY(bytes != nullptr);
+        QCOMPARE((size_t) values % alignof(double), (size_t) 0);
+        QCOMPARE(arena.getPageCount(), (size_t) 1);
+        QCOMPARE(arena.getCapacity(), ImportArena::PAGE_SIZE);
+
+        // An allocation larger than a page
+        arena.allocate<double>(ImportArena::PAGE_SIZE / 4);
+
+        QCOMPARE(arena.getPageCount(), (size_t) 2);
+
+        // The pages are merged, and retained, when the arena is reset
+        const size_t capacity = arena.getCapacity();
+
+        arena.reset();
+
+        QCOMPARE(arena.getPageCount(), (size_t) 1);
+        QCOMPARE(arena.getCapacity(), capacity);
+        QCOMPARE(arena.getUsed(), (size_t) 0);
+
+        // Buffers grow in place while they are the most recent allocation
+        ArenaBuffer<double> a(&arena);
+        ArenaBuffer<double> b(&arena);
+
+        for (int ii = 0; ii < 10000; ii++)
+        {
+            a.push_back(ii);
+        }
+
+        QCOMPARE(arena.getUsed(), (size_t) 16384 * sizeof(double));
+
+        for (int ii = 0; ii < 10000; ii++)
+        {
+            b.push_back(-ii);
+            a.push_back(ii + 10000);
+        }
+
+        QCOMPARE(a.size(), (size_t) 20000);
+        QCOMPARE(b.size(), (size_t) 10000);
+
+        for (int ii = 0; ii < 20000; ii++)
+        {
+            QCOMPARE(a[ii], (double) ii);
+        }
+
+        for (int ii = 0; ii < 10000; ii++)
+        {
+            QCOMPARE(b[ii], (double) -ii);
+        }
+
+        // The samples of each block of an import are allocated from the same pages
+        arena.reset();
+
+        const size_t retained = arena.getCapacity();
+
+        for (int block = 0; block < 10; block++)
+        {
+            ArenaBuffer<double> t(&arena);
+
+            t.reserve(50000);
+
+            for (int ii = 0; ii < 50000; ii++)
+            {
+                t.push_back(ii);
+            }
+
+            QCOMPARE(t.back(), 49999.0);
+
+            arena.reset();
+        }
+
+        QCOMPARE(arena.getCapacity(), retained);
+
+        arena.release();
+
+        QCOMPARE(arena.getCapacity(), (size_t) 0);
+        QCOMPARE(arena.getPageCount(), (size_t) 0);
+    }
+
+protected:
+
+    //! Append an ArduPilot log message: the header (0xA3 0x95 and the message type), and the payload
+    static void appendMessage(QByteArray& log, uint8_t type, const QByteArray& payload)
+    {
+        log.append((char) 0xA3);
+        log.append((char) 0x95);
+        log.append((char) type);
+        log.append(payload);
+    }
+
+    //! Append a format message, which describes the layout of a message type (the length includes the header)
+    static void appendFormat(QByteArray& log, uint8_t type, uint8_t length, const char* name, const char* format, const char* labels)
+    {
+        QByteArray payload(86, '\0');
+
+        payload[0] = (char) type;
+        payload[1] = (char) length;
+
+        memcpy(payload.data() + 2, name, std::min<size_t>(strlen(name), 4));
+        memcpy(payload.data() + 6, format, std::min<size_t>(strlen(format), 16));
+        memcpy(payload.data() + 22, labels, std::min<size_t>(strlen(labels), 64));
+
+        appendMessage(log, 128, payload);
+    }
+
+    //! Append the (little-endian) bytes of a field value
+    template<typename T>
+    static void appendField(QByteArray& payload, T value)
+    {
+        payload.append((const char*) &value, sizeof(value));
+    }
+
+    //! Chunk size for which each block is (at most) 64 bytes, so that a small file spans many blocks
+    static qint64 getSmallChunkSize(void)
+    {
+        return std::max(1, 64 / std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+    }
+
+    static bool writeFile(const QString& filename, const QByteArray& contents)
+    {
+        QFile file(filename);
+
+        return file.open(QIODevice::WriteOnly) && file.write(contents) == contents.size();
+    }
+
+    static DataSeriesPointer findSeries(const ImportPlugin& importer, const QString& label)
+    {
+        for (const auto& series : importer.getDataSeries())
+        {
+            if (series->getLabel() == label) return series;
+        }
+
+        return DataSeriesPointer();
+    }
+
+    //! The series holds exactly the expected (timestamp, value) samples, in order
+    static bool matches(const DataSeriesPointer& series, const std::vector<std::pair<double, double>>& expected)
+    {
+        if (series.isNull()) return false;
+
+        const DataSnapshot snapshot = series->getSnapshot();
+
+        if (snapshot.size() != expected.size())
+        {
+            qWarning() << series->getLabel() << "has" << snapshot.size() << "samples, expected" << expected.size();
+            return false;
+        }
+
+        for (size_t idx = 0; idx < expected.size(); idx++)
+        {
+            if (snapshot.getTimestamp(idx) != expected[idx].first || snapshot.getValue(idx) != expected[idx].second)
+            {
+                qWarning() << series->getLabel() << "sample" << idx << "is" << snapshot.getTimestamp(idx) << snapshot.getValue(idx);
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+
+#endif // TEST_IMPORTER_HPP
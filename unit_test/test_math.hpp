@@ -0,0 +1,976 @@
+#ifndef TEST_MATH_HPP
+#define TEST_MATH_HPP
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "math_dependency_graph.hpp"
+#include "math_expression_parser.hpp"
+#include "math_sampler.hpp"
+#include "math_trace_cache.hpp"
+#include "math_trace_computer.hpp"
+#include "series_file.hpp"
+
+
+class MathExpressionTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testEvaluate(void)
+    {
+        MathExpressionParser parser;
+
+        QVERIFY(parser.parse("2 ^ 3 ^ 2 - -a * (b + 1) / 4"));
+
+        QMap<QString, double> variables;
+
+        variables["a"] = 2;
+        variables["b"] = 3;
+
+        double result = 0;
+
+        QVERIFY(parser.evaluate(variables, result));
+        QCOMPARE(result, 514.0);
+
+        // Missing variable
+        variables.remove("b");
+
+        QVERIFY(!parser.evaluate(variables, result));
+
+        QVERIFY(!parser.parse("a +"));
+        QVERIFY(!parser.parse("sqrt 2"));
+    }
+
+    void testCompile(void)
+    {
+        const char* expressions[] = {
+            "a + b * c",
+            "(a - b) / (c + 10)",
+            "2 ^ a ^ 0.5 - -b",
+            "abs(sin(a) * cos(b)) + exp(c / 100) - tan(a * pi / 180)",
+            "sqrt(a * a + b * b + c * c) + log(abs(a) + e)",
+            "((((a + 1) * (b + 2)) - ((c + 3) / (a + 4))) ^ 2)",
+            "c",
+            "42",
+        };
+
+        QStringList names;
+
+        names << "a" << "b" << "c";
+
+        for (const char* expression : expressions)
+        {
+            MathExpressionParser parser;
+
+            QVERIFY(parser.parse(expression));
+
+            MathProgram program;
+
+            QVERIFY(parser.compile(names, program));
+            QVERIFY(program.isValid());
+            QCOMPARE(program.getSlotCount(), 3);
+
+            // The program must agree exactly with the expression tree
+            for (int ii = 0; ii < 100; ii++)
+            {
+                const double values[] = {0.37 * ii - 5, std::sin(ii) * 20, 0.5 * ii};
+
+                QMap<QString, double> variables;
+
+                variables["a"] = values[0];
+                variables["b"] = values[1];
+                variables["c"] = values[2];
+
+                double expected = 0;
+                double result = 0;
+
+                const bool valid = parser.evaluate(variables, expected);
+
+                QCOMPARE(program.evaluate(values, result), valid);
+
+                // NaN results (e.g. a fractional power of a negative number) must also agree
+                if (valid) QVERIFY(result == expected || (std::isnan(result) && std::isnan(expected)));
+            }
+        }
+    }
+
+    void testEvaluateBlock(void)
+    {
+        const char* expressions[] = {
+            "a + b * c",
+            "(a - b) / c",
+            "sqrt(a) + log(b) - 2 ^ c",
+            "abs(sin(a) * cos(b)) / (tan(c) + exp(-a))",
+            "-(a * 1.5)",
+            "7",
+        };
+
+        QStringList names;
+
+        names << "a" << "b" << "c";
+
+        // Include zero and negative values, so that some points fail evaluation
+        const size_t n = 1000;
+
+        std::vector<double> columns[3];
+
+        for (size_t ii = 0; ii < n; ii++)
+        {
+            columns[0].push_back(0.1 * ii - 20);
+            columns[1].push_back(std::cos(0.01 * ii) * 5);
+            columns[2].push_back((double) (ii % 7) - 3);
+        }
+
+        const double* inputs[] = {columns[0].data(), columns[1].data(), columns[2].data()};
+
+        for (const char* expression : expressions)
+        {
+            MathExpressionParser parser;
+            MathProgram program;
+
+            QVERIFY(parser.parse(expression));
+            QVERIFY(parser.compile(names, program));
+
+            std::vector<double> output(n);
+            std::vector<unsigned char> valid(n, 1);
+
+            program.evaluateBlock(inputs, n, output.data(), valid.data());
+
+            // Each point must agree with a separate evaluation
+            for (size_t ii = 0; ii < n; ii++)
+            {
+                const double values[] = {columns[0][ii], columns[1][ii], columns[2][ii]};
+
+                double expected = 0;
+
+                QCOMPARE((bool) valid[ii], program.evaluate(values, expected));
+
+                if (valid[ii]) QVERIFY(output[ii] == expected || (std::isnan(output[ii]) && std::isnan(expected)));
+            }
+        }
+    }
+
+    void testOptimize(void)
+    {
+        QStringList names;
+
+        names << "a" << "b";
+
+        struct Case
+        {
+            const char* expression;
+
+            // Expected number of instructions, after optimisation
+            size_t instructions;
+        };
+
+        const Case cases[] = {
+            // a^2 + b^2 is evaluated once, and 2 * pi is folded
+            {"sqrt(a^2 + b^2) / sqrt(a^2 + b^2 + 2*pi)", 14},
+            {"(a + b) * (b + a) - exp(a + b)", 9},
+            {"a / 4 + a / 3", 7},
+            {"(1 + 2) * 3 ^ 2 + a", 3},
+            {"1 / (2 - 2) + a", 5},
+        };
+
+        for (const Case& c : cases)
+        {
+            MathExpressionParser parser;
+            MathProgram program;
+
+            QVERIFY(parser.parse(c.expression));
+            QVERIFY(parser.compile(names, program));
+            QCOMPARE(program.getInstructions().size(), c.instructions);
+
+            for (const auto& instruction : program.getInstructions())
+            {
+                // x^2 and division by a power of two are replaced with multiplication
+                QVERIFY(instruction.opcode != MathProgram::OPCODE_POWER);
+            }
+
+            // The optimised program must agree exactly with the expression tree
+            for (int ii = 0; ii < 100; ii++)
+            {
+                const double values[] = {0.37 * ii - 5, std::sin(ii) * 20};
+
+                QMap<QString, double> variables;
+
+                variables["a"] = values[0];
+                variables["b"] = values[1];
+
+                double expected = 0;
+                double result = 0;
+
+                const bool valid = parser.evaluate(variables, expected);
+
+                QCOMPARE(program.evaluate(values, result), valid);
+
+                if (valid) QVERIFY(result == expected);
+            }
+        }
+
+        // Identical stateful functions share a single state
+        MathExpressionParser parser;
+        MathProgram program;
+
+        QVERIFY(parser.parse("movavg(a, 100) - movavg(a, 100) + movavg(a, 200)"));
+        QVERIFY(parser.compile(names, program));
+
+        int windows = 0;
+
+        for (const auto& instruction : program.getInstructions())
+        {
+            if (instruction.opcode == MathProgram::OPCODE_MOVAVG) windows++;
+        }
+
+        QCOMPARE(windows, 2);
+        QCOMPARE(program.getRegisterCount(), 1);
+    }
+
+    void testTimestampMerger(void)
+    {
+        DataSeries a("a");
+        DataSeries b("b");
+        DataSeries c("c");
+
+        // Overlapping timestamps (including duplicates within a series), and an empty series
+        for (int ii = 0; ii < 10000; ii++)
+        {
+            a.addData(ii * 2, 0, false);
+            b.addData(ii * 3, 0, false);
+        }
+
+        a.addData(20000 - 2, 1, false);
+
+        std::vector<DataSnapshot> snapshots = {a.getSnapshot(), b.getSnapshot(), c.getSnapshot()};
+
+        TimestampMerger merger(snapshots);
+
+        QCOMPARE(merger.getInputCount(), (uint64_t) (a.size() + b.size()));
+
+        std::vector<double> merged;
+        std::vector<double> buffer(777);
+
+        size_t count = 0;
+
+        while ((count = merger.read(buffer.data(), buffer.size())) > 0)
+        {
+            merged.insert(merged.end(), buffer.begin(), buffer.begin() + count);
+        }
+
+        QCOMPARE(merger.getConsumedCount(), merger.getInputCount());
+
+        // Multiples of 2 or 3 (below 30000)
+        std::vector<double> expected;
+
+        for (int t = 0; t < 30000; t++)
+        {
+            if ((t % 2 == 0 && t < 20000) || t % 3 == 0) expected.push_back(t);
+        }
+
+        QVERIFY(merged == expected);
+
+        // Merging consecutive ranges produces the same union (a boundary belongs to the following range)
+        std::vector<double> ranges;
+
+        const double boundaries[] = {-1, 999, 1000, 12345, 1e9};
+
+        for (int ii = 0; ii < 4; ii++)
+        {
+            TimestampMerger range(snapshots, boundaries[ii], boundaries[ii + 1]);
+
+            while ((count = range.read(buffer.data(), buffer.size())) > 0)
+            {
+                ranges.insert(ranges.end(), buffer.begin(), buffer.begin() + count);
+            }
+        }
+
+        QVERIFY(ranges == expected);
+    }
+
+    void testGapList(void)
+    {
+        DataSeries series("a");
+
+        // Runs of samples, separated by gaps of increasing size
+        double t = 0;
+
+        for (int run = 0; run < 20; run++)
+        {
+            for (int ii = 0; ii < 50; ii++)
+            {
+                series.addData(t, ii, false);
+                t += 10;
+            }
+
+            t += 200 * run;
+        }
+
+        const auto snapshot = series.getSnapshot();
+        const double maxGapSize = 1000;
+
+        GapList gaps(snapshot, maxGapSize);
+        GapList range(snapshot, maxGapSize, 20000, 40000);
+
+        QVERIFY(gaps.getGapCount() > 0);
+        QVERIFY(range.getGapCount() < gaps.getGapCount());
+
+        for (double timestamp = -2000; timestamp < t + 2000; timestamp += 2.5)
+        {
+            // Gap around the timestamp (the preceding sample is at or before it)
+            const uint64_t idx = snapshot.upperBound(timestamp);
+
+            bool expected = false;
+
+            if (idx == 0)
+            {
+                expected = snapshot.getTimestamp(0) - timestamp > maxGapSize;
+            }
+            else if (idx == snapshot.size())
+            {
+                expected = timestamp - snapshot.getTimestamp(idx - 1) > maxGapSize;
+            }
+            else
+            {
+                expected = snapshot.getTimestamp(idx) - snapshot.getTimestamp(idx - 1) > maxGapSize;
+            }
+
+            QCOMPARE(gaps.contains(timestamp), expected);
+
+            if (timestamp >= 20000 && timestamp < 40000) QCOMPARE(range.contains(timestamp), expected);
+        }
+    }
+
+    void testMathTrace(void)
+    {
+        auto a = DataSeriesPointer(new DataSeries("a"));
+        auto b = DataSeriesPointer(new DataSeries("b"));
+
+        // The timeline is split into several chunks
+        const int n = 2 * MathTraceComputer::CHUNK_SAMPLES + 100;
+
+        for (int ii = 0; ii <= n; ii++)
+        {
+            a->addData(ii, ii, false);
+            b->addData(ii + 0.5, 2, false);
+        }
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+        mapping["b"] = b;
+
+        auto output = MathDataSeriesPointer(new MathDataSeries("a / (b - 2) + a", "a / (b - 2) + a", mapping));
+
+        // Every point divides by zero
+        MathTraceComputer computer;
+
+        computer.compute("a / (b - 2) + a", mapping, output);
+        computer.startComputation();
+
+        QCOMPARE(output->size(), (uint64_t) 0);
+
+        computer.compute("a * b - 1", mapping, output);
+        computer.startComputation();
+
+        // Points are computed at the union of the input timestamps
+        QCOMPARE(output->size(), (uint64_t) 2 * (n + 1));
+
+        for (uint64_t idx = 0; idx < output->size(); idx++)
+        {
+            const auto point = output->getDataPoint(idx);
+
+            // Inputs are held at their final value beyond the last sample
+            QCOMPARE(point.value, 2 * std::min(point.timestamp, (double) n) - 1);
+        }
+    }
+
+    void testMathTraceCache(void)
+    {
+        QTemporaryDir dir;
+
+        QVERIFY(dir.isValid());
+
+        MathTraceCache* cache = MathTraceCache::getInstance();
+
+        const QString directory = cache->getDirectory();
+
+        cache->setDirectory(dir.path());
+        cache->setEnabled(true);
+
+        auto a = DataSeriesPointer(new DataSeries("a"));
+
+        // Several chunks of the cache file
+        const int n = 3 * SeriesFile::CHUNK_SAMPLES + 17;
+
+        for (int ii = 0; ii < n; ii++)
+        {
+            a->addData(ii * 0.5, std::sin(0.001 * ii), false);
+        }
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+
+        const uint64_t hits = cache->getHitCount();
+
+        MathTraceComputer computer;
+
+        auto first = MathDataSeriesPointer(new MathDataSeries("first", "a * 3 + 1", mapping));
+
+        computer.compute("a * 3 + 1", mapping, first);
+        computer.startComputation();
+
+        QCOMPARE(first->size(), (uint64_t) n);
+        QCOMPARE(cache->getHitCount(), hits);
+
+        // The same computation (e.g. in a later session) is loaded from the cache
+        auto second = MathDataSeriesPointer(new MathDataSeries("second", "a * 3 + 1", mapping));
+
+        computer.compute("a * 3 + 1", mapping, second);
+        computer.startComputation();
+
+        QCOMPARE(cache->getHitCount(), hits + 1);
+        QCOMPARE(second->size(), first->size());
+        QVERIFY(!second->getInputSnapshots().isEmpty());
+
+        for (uint64_t idx = 0; idx < first->size(); idx++)
+        {
+            QCOMPARE(second->getDataPoint(idx).timestamp, first->getDataPoint(idx).timestamp);
+            QCOMPARE(second->getDataPoint(idx).value, first->getDataPoint(idx).value);
+        }
+
+        // A different gap size, or a change to an input, is computed afresh
+        computer.compute("a * 3 + 1", mapping, second, 500.0);
+        computer.startComputation();
+
+        QCOMPARE(cache->getHitCount(), hits + 1);
+
+        a->addData(n, 2, false);
+
+        computer.compute("a * 3 + 1", mapping, second);
+        computer.startComputation();
+
+        QCOMPARE(cache->getHitCount(), hits + 1);
+        QCOMPARE(second->getDataPoint(second->size() - 1).timestamp, (double) n);
+
+        cache->setEnabled(false);
+        cache->setDirectory(directory);
+    }
+
+    void testDependencyGraph(void)
+    {
+        auto a = DataSeriesPointer(new DataSeries("a"));
+        auto b = DataSeriesPointer(new DataSeries("b"));
+
+        // Several blocks of samples
+        const int n = 4 * DataBlock::CAPACITY;
+
+        for (int ii = 0; ii < n; ii++)
+        {
+            a->addData(ii, ii, false);
+            b->addData(ii + 0.5, 1, false);
+        }
+
+        QMap<QString, DataSeriesPointer> inputs;
+
+        inputs["a"] = a;
+        inputs["b"] = b;
+
+        auto c = MathDataSeriesPointer(new MathDataSeries("c", "a - b", inputs));
+
+        QMap<QString, DataSeriesPointer> chained;
+
+        chained["c"] = c;
+
+        auto d = MathDataSeriesPointer(new MathDataSeries("d", "abs(c)", chained));
+
+        // Series are recomputed in dependency order, regardless of the order they are added
+        MathDependencyGraph graph;
+
+        graph.addSeries(d);
+        graph.addSeries(c);
+
+        MathTraceComputer computer;
+
+        computer.compute("a - b", inputs, c);
+        computer.startComputation();
+
+        computer.compute("abs(c)", chained, d);
+        computer.startComputation();
+
+        QCOMPARE(d->size(), (uint64_t) 2 * n);
+
+        const auto before = d->getSnapshot();
+
+        // Live data are appended to both inputs
+        for (int ii = n; ii < n + 100; ii++)
+        {
+            a->addData(ii, ii, false);
+            b->addData(ii + 0.5, 1, false);
+        }
+
+        graph.invalidate(a.data());
+        graph.invalidate(b.data());
+        graph.update();
+
+        QCOMPARE(d->size(), (uint64_t) 2 * (n + 100));
+
+        for (uint64_t idx = 0; idx < d->size(); idx++)
+        {
+            const auto point = d->getDataPoint(idx);
+
+            QCOMPARE(point.value, std::fabs(std::min(point.timestamp, (double) n + 99) - 1));
+        }
+
+        // Only the newest points were recomputed (the earlier blocks are unchanged). A block is
+        // re-encoded when it is no longer the final block, so the last few blocks are recomputed.
+        uint64_t idx_first = 0;
+        uint64_t idx_last = 0;
+
+        QVERIFY(d->getSnapshot().getCommonRange(before, idx_first, idx_last));
+        QCOMPARE(idx_first, (uint64_t) 0);
+        QVERIFY(idx_last >= before.size() / 2);
+
+        // A change of scaling recomputes the whole of each dependent series
+        b->setScaler(3, false);
+
+        graph.invalidate(b.data());
+        graph.update();
+
+        QCOMPARE(d->size(), (uint64_t) 2 * (n + 100));
+
+        for (uint64_t idx = 0; idx < d->size(); idx++)
+        {
+            const auto point = d->getDataPoint(idx);
+
+            QCOMPARE(point.value, std::fabs(std::min(point.timestamp, (double) n + 99) - 3));
+        }
+
+        // Nothing is recomputed if the inputs are unchanged
+        const auto after = d->getSnapshot();
+
+        graph.invalidate(a.data());
+        graph.update();
+
+        QVERIFY(d->getSnapshot().isIdentical(after));
+    }
+
+    void testMonotonicity(void)
+    {
+        const char* increasing[] = {"a", "2 * a + 1", "exp(a / 3) - 4", "-(-a)", "sqrt(a) + log(a + 1)", "a * (2 ^ 3) + pi"};
+        const char* decreasing[] = {"-a", "1 - 2 * a", "exp(-a)", "a / -4"};
+        const char* unknown[] = {"abs(a)", "a * a", "sin(a)", "1 / a", "a - a", "a ^ 2"};
+
+        QStringList names;
+
+        names << "a";
+
+        MathExpressionParser parser;
+        MathProgram program;
+
+        for (const char* expression : increasing)
+        {
+            QVERIFY(parser.parse(expression) && parser.compile(names, program));
+            QCOMPARE(program.getMonotonicity(), 1);
+        }
+
+        for (const char* expression : decreasing)
+        {
+            QVERIFY(parser.parse(expression) && parser.compile(names, program));
+            QCOMPARE(program.getMonotonicity(), -1);
+        }
+
+        for (const char* expression : unknown)
+        {
+            QVERIFY(parser.parse(expression) && parser.compile(names, program));
+            QCOMPARE(program.getMonotonicity(), 0);
+        }
+
+        // Functions of more than one variable
+        names << "b";
+
+        QVERIFY(parser.parse("a + b") && parser.compile(names, program));
+        QCOMPARE(program.getMonotonicity(), 0);
+    }
+
+    void testLazySeries(void)
+    {
+        auto a = DataSeriesPointer(new DataSeries("a"));
+
+        const int n = 1000000;
+
+        for (int ii = 0; ii < n; ii++)
+        {
+            a->addData(ii, std::sin(ii * 1e-3) * 100 + (ii % 17), false);
+        }
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+
+        const char* expressions[] = {"3 - 2 * a", "abs(a - 50)"};
+
+        for (const char* expression : expressions)
+        {
+            MathDataSeries lazy("lazy", expression, mapping);
+
+            lazy.setLazy(true);
+
+            MathCurveUpdater updater(lazy);
+
+            PlotSamplesPointer result;
+
+            connect(&updater, &MathCurveUpdater::sampleComplete, [&result](PlotSamplesPointer samples, double, double) {
+                result = samples;
+            });
+
+            // Zoomed out: only the visible chunks are evaluated
+            updater.updateCurveSamples(100000, 600000, 1000);
+
+            QVERIFY(result && result->size() > 0);
+            QVERIFY(lazy.size() == 0);
+
+            const uint64_t computed = updater.getComputedChunkCount();
+
+            // The extreme values agree with those of the fully evaluated expression
+            // (the samples either side of the view are also drawn, so the range is checked with a margin)
+            MathExpressionParser parser;
+            MathProgram program;
+
+            QStringList names;
+
+            names << "a";
+
+            QVERIFY(parser.parse(expression) && parser.compile(names, program));
+
+            double inner[2] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+            double outer[2] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+
+            for (int ii = 99000; ii <= 601000; ii++)
+            {
+                double value = a->getDataPoint(ii).value;
+                double output = 0;
+
+                QVERIFY(program.evaluate(&value, output));
+
+                if (ii > 100000 && ii <= 600000)
+                {
+                    inner[0] = std::min(inner[0], output);
+                    inner[1] = std::max(inner[1], output);
+                }
+
+                outer[0] = std::min(outer[0], output);
+                outer[1] = std::max(outer[1], output);
+            }
+
+            QVERIFY(result->minValue <= inner[0] && result->minValue >= outer[0]);
+            QVERIFY(result->maxValue >= inner[1] && result->maxValue <= outer[1]);
+
+            // Only the monotonic expression is evaluated over summary buckets
+            QCOMPARE(updater.getBucketChunkCount() > 0, program.getMonotonicity() != 0);
+
+            // Panning re-uses the chunks which remain visible
+            updater.updateCurveSamples(150000, 650000, 1000);
+
+            QVERIFY(updater.getComputedChunkCount() - computed <= 2);
+        }
+    }
+
+    // Test that an updater can be destroyed while a request is being evaluated (on the thread pool)
+    void testDestroyWhileComputing(void)
+    {
+        auto a = DataSeriesPointer(new DataSeries("a"));
+
+        const int n = 1000000;
+
+        for (int ii = 0; ii < n; ii++)
+        {
+            a->addData(ii, std::sin(ii * 1e-3) * 100 + (ii % 17), false);
+        }
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+
+        MathDataSeries output("output", "movavg(a, 100) + rollmax(a, 50)", mapping);
+
+        output.setLazy(true);
+
+        for (int ii = 0; ii < 8; ii++)
+        {
+            std::unique_ptr<MathCurveUpdater> updater(new MathCurveUpdater(output));
+
+            updater->requestCurveSamples(0, n, 2000);
+
+            // Destroy the updater at various stages of the evaluation
+            QTest::qSleep(ii * 5);
+
+            updater.reset();
+        }
+
+        QCOMPARE(a->size(), (uint64_t) n);
+    }
+
+    void testWindowFunctions(void)
+    {
+        QStringList names;
+
+        names << "a";
+
+        const size_t n = 1000;
+
+        std::vector<double> timestamps;
+        std::vector<double> values;
+
+        for (size_t ii = 0; ii < n; ii++)
+        {
+            // Irregular sample spacing
+            timestamps.push_back(ii * 10.0 + (ii % 3));
+            values.push_back(std::sin(0.05 * ii) * 10 + 0.01 * ii);
+        }
+
+        const char* expressions[] = {
+            "movavg(a, 95)",
+            "rollmin(a, 200)",
+            "rollmax(a, 200)",
+            "rollstd(a, 95)",
+            "diff(a)",
+            "integ(a)",
+        };
+
+        for (const char* expression : expressions)
+        {
+            MathExpressionParser parser;
+            MathProgram program;
+
+            QVERIFY(parser.parse(expression));
+            QVERIFY(parser.compile(names, program));
+            QVERIFY(program.isStateful());
+
+            // Functions of the preceding points can not be evaluated at a single point
+            double result = 0;
+
+            QVERIFY(!program.evaluate(&values[0], result));
+
+            std::vector<double> output(n);
+            std::vector<unsigned char> valid(n, 1);
+
+            // Without a state, no point can be evaluated
+            const double* column = values.data();
+
+            program.evaluateBlock(&column, n, output.data(), valid.data());
+
+            QCOMPARE((size_t) std::count(valid.begin(), valid.end(), 0), n);
+
+            // The state is carried across blocks of different sizes
+            MathProgram::State state;
+            program.reset(state);
+
+            std::fill(valid.begin(), valid.end(), 1);
+
+            const size_t splits[] = {0, 1, 333, 700, n};
+
+            for (int ss = 0; ss < 4; ss++)
+            {
+                const size_t first = splits[ss];
+                const double* inputs = values.data() + first;
+
+                program.evaluateBlock(&inputs, splits[ss + 1] - first, output.data() + first,
+                                      valid.data() + first, timestamps.data() + first, &state);
+            }
+
+            const QString name = QString(expression).left(QString(expression).indexOf("("));
+            const double window = name == "rollmin" || name == "rollmax" ? 200 : 95;
+
+            double integral = 0;
+
+            for (size_t ii = 0; ii < n; ii++)
+            {
+                double expected = 0;
+
+                if (name == "diff")
+                {
+                    QCOMPARE((bool) valid[ii], ii > 0);
+
+                    if (ii == 0) continue;
+
+                    expected = (values[ii] - values[ii - 1]) / ((timestamps[ii] - timestamps[ii - 1]) / 1000);
+                }
+                else if (name == "integ")
+                {
+                    if (ii > 0) integral += 0.5 * (values[ii] + values[ii - 1]) * (timestamps[ii] - timestamps[ii - 1]) / 1000;
+
+                    expected = integral;
+                }
+                else
+                {
+                    // Naive evaluation over the trailing window (t - w, t]
+                    double sum = 0;
+                    double sumSquares = 0;
+                    double minimum = values[ii];
+                    double maximum = values[ii];
+                    int count = 0;
+
+                    for (size_t jj = 0; jj <= ii; jj++)
+                    {
+                        if (timestamps[jj] <= timestamps[ii] - window) continue;
+
+                        sum += values[jj];
+                        sumSquares += values[jj] * values[jj];
+                        minimum = std::min(minimum, values[jj]);
+                        maximum = std::max(maximum, values[jj]);
+                        count++;
+                    }
+
+                    const double mean = sum / count;
+
+                    if (name == "movavg") expected = mean;
+                    if (name == "rollmin") expected = minimum;
+                    if (name == "rollmax") expected = maximum;
+                    if (name == "rollstd") expected = std::sqrt(std::max(0.0, sumSquares / count - mean * mean));
+                }
+
+                QVERIFY(valid[ii]);
+                QVERIFY(std::fabs(output[ii] - expected) < 1e-6 * (1 + std::fabs(expected)));
+            }
+        }
+
+        // Window lengths must be positive constants
+        MathExpressionParser parser;
+
+        QVERIFY(parser.parse("movavg(a, 2 * 50)"));
+        QVERIFY(!parser.parse("movavg(a)"));
+        QVERIFY(!parser.parse("movavg(a, a)"));
+        QVERIFY(!parser.parse("rollstd(a, -1)"));
+        QVERIFY(!parser.parse("diff(a, 10)"));
+    }
+
+    void testWindowChunks(void)
+    {
+        auto a = DataSeriesPointer(new DataSeries("a"));
+
+        // The timeline is split into several chunks
+        const int n = 2 * MathTraceComputer::CHUNK_SAMPLES + 100;
+
+        std::vector<double> timestamps;
+        std::vector<double> values;
+
+        for (int ii = 0; ii < n; ii++)
+        {
+            timestamps.push_back(ii);
+            values.push_back(std::sin(0.001 * ii) * 100 + (ii % 7));
+
+            a->addData(timestamps.back(), values.back(), false);
+        }
+
+        QMap<QString, DataSeriesPointer> mapping;
+
+        mapping["a"] = a;
+
+        QStringList names;
+
+        names << "a";
+
+        const char* expressions[] = {
+            "movavg(diff(a), 50) + rollmax(a, 30)",
+            "integ(a) - rollmin(movavg(a, 20), 10)",
+        };
+
+        for (const char* expression : expressions)
+        {
+            auto output = MathDataSeriesPointer(new MathDataSeries(expression, expression, mapping));
+
+            MathTraceComputer computer;
+
+            computer.compute(expression, mapping, output);
+            computer.startComputation();
+
+            // Each chunk produces the same points as a sequential evaluation
+            MathExpressionParser parser;
+            MathProgram program;
+
+            QVERIFY(parser.parse(expression));
+            QVERIFY(parser.compile(names, program));
+
+            MathProgram::State state;
+            program.reset(state);
+
+            std::vector<double> expected(n);
+            std::vector<unsigned char> valid(n, 1);
+
+            const double* column = values.data();
+
+            program.evaluateBlock(&column, n, expected.data(), valid.data(), timestamps.data(), &state);
+
+            QCOMPARE(output->size(), (uint64_t) std::count(valid.begin(), valid.end(), 1));
+
+            uint64_t idx = 0;
+
+            for (int ii = 0; ii < n; ii++)
+            {
+                if (!valid[ii]) continue;
+
+                const auto point = output->getDataPoint(idx++);
+
+                QCOMPARE(point.timestamp, timestamps[ii]);
+                QVERIFY(std::fabs(point.value - expected[ii]) < 1e-6 * (1 + std::fabs(expected[ii])));
+            }
+        }
+    }
+
+    void testCompileErrors(void)
+    {
+        MathExpressionParser parser;
+        MathProgram program;
+
+        QStringList names;
+
+        names << "a";
+
+        // Variables must be bound to a slot
+        QVERIFY(parser.parse("a + b"));
+        QVERIFY(!parser.compile(names, program));
+        QVERIFY(!program.isValid());
+
+        // Domain errors fail the evaluation
+        double result = 0;
+        double value = 0;
+
+        QVERIFY(parser.parse("1 / a"));
+        QVERIFY(parser.compile(names, program));
+        QVERIFY(!program.evaluate(&value, result));
+
+        value = -1;
+
+        QVERIFY(parser.parse("sqrt(a)"));
+        QVERIFY(parser.compile(names, program));
+        QVERIFY(!program.evaluate(&value, result));
+
+        QVERIFY(parser.parse("log(a + 1)"));
+        QVERIFY(parser.compile(names, program));
+        QVERIFY(!program.evaluate(&value, result));
+
+        // Expressions which are too deeply nested for the evaluation stack
+        QString expression = "a";
+
+        for (int ii = 0; ii < MathProgram::MAX_STACK_DEPTH; ii++)
+        {
+            expression = QString("a + (%1)").arg(expression);
+        }
+
+        QVERIFY(parser.parse(expression));
+        QVERIFY(!parser.compile(names, program));
+    }
+};
+
+#endif // TEST_MATH_HPP
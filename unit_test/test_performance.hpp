@@ -0,0 +1,375 @@
+#ifndef TEST_PERFORMANCE_H
+#define TEST_PERFORMANCE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "data_series.hpp"
+#include "lumberjack_csv_importer.hpp"
+#include "plot_sampler.hpp"
+#include "synthetic_generator.hpp"
+
+
+/**
+ * @brief The PerformanceGateTests class checks a fixed set of performance cases against stored baselines.
+ *
+ * The gates only run when the unit tests are started with --perf (they are too slow, and too sensitive
+ * to the load of the machine, to run with every build). Each case is timed (the best of RUNS runs), and
+ * divided by the duration of a calibration loop measured on the same machine, so the baselines are
+ * (roughly) portable between machines. A case fails if its normalised time exceeds its baseline by more
+ * than the tolerance (50%, unless LUMBERJACK_PERF_TOLERANCE is set, e.g. to 0.25).
+ *
+ * Starting the tests with --perf-report prints the normalised time of each case instead of checking it,
+ * so the baselines can be updated after an intentional change. The baselines describe a release build.
+ *
+ * Each case also checks its output, since a fast path which produces the wrong result is no use.
+ */
+class PerformanceGateTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Number of times each case is timed (the fastest run is used)
+    static const int RUNS = 3;
+
+    //! Samples of the series which are resampled
+    static const qint64 RESAMPLE_POINTS = 10000000;
+
+    //! Width of the resampled view (pixels)
+    static const int RESAMPLE_PIXELS = 2000;
+
+    //! Number of (panned) views resampled by each run, so each run is long enough to time reliably
+    static const int RESAMPLE_PASSES = 10;
+
+    //! Approximate size of the imported CSV file (bytes)
+    static const qint64 CSV_BYTES = 100 * 1024 * 1024;
+
+    PerformanceGateTests(bool report = false) : reportOnly(report) {}
+
+private slots:
+
+    void initTestCase(void)
+    {
+        calibration = calibrate();
+
+        qDebug() << "Calibration loop:" << calibration << "ms";
+
+        QVERIFY(calibration > 0);
+
+        fillSeries(series, RESAMPLE_POINTS);
+    }
+
+    void gateAppend(void)
+    {
+        DataSeries target;
+
+        const double ms = measure([&]() { fillSeries(target, RESAMPLE_POINTS); });
+
+        QCOMPARE(target.size(), (size_t) RESAMPLE_POINTS);
+        QCOMPARE(target.getNewestTimestamp(), (double) (RESAMPLE_POINTS - 1));
+
+        checkBaseline("append", ms);
+    }
+
+    void gateResample_data(void)
+    {
+        QTest::addColumn<int>("mode");
+        QTest::addColumn<double>("zoom");
+
+        QTest::newRow("m4/1") << (int) PlotCurveUpdater::DOWNSAMPLE_M4 << 1.0;
+        QTest::newRow("m4/0.1") << (int) PlotCurveUpdater::DOWNSAMPLE_M4 << 0.1;
+        QTest::newRow("lttb/1") << (int) PlotCurveUpdater::DOWNSAMPLE_LTTB << 1.0;
+    }
+
+    void gateResample(void)
+    {
+        QFETCH(int, mode);
+        QFETCH(double, zoom);
+
+        const double span = RESAMPLE_POINTS * zoom;
+        const double t_min = (RESAMPLE_POINTS - span) / 2;
+        const double t_max = t_min + span;
+
+        PlotSamplesPointer samples;
+
+        // A new updater is used for each pass, so no columns are cached (the final pass is checked)
+        const double ms = measure([&]() {
+            for (int pass = RESAMPLE_PASSES - 1; pass >= 0; pass--)
+            {
+                PlotCurveUpdater updater(series);
+
+                updater.setDownsampleMode(mode);
+
+                connect(&updater, &PlotCurveUpdater::sampleComplete, [&samples](PlotSamplesPointer result, double, double) {
+                    samples = result;
+                });
+
+                const double offset = pass * span * 0.01;
+
+                updater.updateCurveSamples(t_min - offset, t_max - offset, RESAMPLE_PIXELS);
+            }
+        });
+
+        QVERIFY(samples);
+        QVERIFY(samples->size() > (size_t) RESAMPLE_PIXELS / 2);
+
+        // At most four samples per pixel, plus one either side of the view
+        QVERIFY(samples->size() <= (size_t) RESAMPLE_PIXELS * 4 + 2);
+
+        // Samples are in order, within the view (or adjacent to it), with no default-constructed samples
+        double previous = -std::numeric_limits<double>::infinity();
+
+        for (size_t idx = 0; idx < samples->size(); idx++)
+        {
+            const double t = samples->timestamps[idx];
+
+            QVERIFY(t >= previous);
+            QVERIFY(t >= t_min - 1 && t <= t_max + 1);
+
+            previous = t;
+        }
+
+        // The range of the output lies within the range of the series
+        double min = 0;
+        double max = 0;
+
+        QVERIFY(series.getValueRange(min, max));
+        QVERIFY(samples->minValue >= min && samples->maxValue <= max);
+
+        // M4 retains the extremes of every pixel, so the output covers the range of the view
+        if (mode == PlotCurveUpdater::DOWNSAMPLE_M4)
+        {
+            const auto stats = series.getStatistics(t_min, t_max);
+
+            QVERIFY(samples->minValue <= stats.min && samples->maxValue >= stats.max);
+        }
+
+        checkBaseline(QString("resample/%1").arg(QTest::currentDataTag()), ms);
+    }
+
+    void gateStatistics(void)
+    {
+        DataSnapshot::Statistics stats;
+
+        const double ms = measure([&]() {
+            for (int idx = 0; idx < 1000; idx++)
+            {
+                stats = series.getStatistics(idx * 1000.5, RESAMPLE_POINTS - idx * 1000.5);
+            }
+        });
+
+        QVERIFY(stats.count > 0);
+
+        checkBaseline("statistics", ms);
+    }
+
+    void gateImportCSV(void)
+    {
+        QTemporaryDir dir;
+
+        const QString filename = dir.filePath("gate.csv");
+
+        SyntheticGenerator::Options options;
+
+        options.channels = 8;
+        options.rate = 1000;
+        options.shape = SyntheticGenerator::SHAPE_MIXED;
+
+        // Each row is roughly 10 bytes per channel
+        options.duration = (double) CSV_BYTES / (options.channels * 10 + 10) / options.rate;
+
+        QStringList errors;
+
+        QVERIFY(SyntheticGenerator(options).writeCSV(filename, errors));
+
+        qDebug() << "CSV file:" << QFileInfo(filename).size() / (1024 * 1024) << "MB";
+
+        QList<DataSeriesPointer> imported;
+
+        const double ms = measure([&]() {
+            LumberjackCSVImporter importer;
+
+            importer.setFilename(filename);
+
+            QVERIFY(importer.importData(errors));
+
+            imported = importer.getDataSeries();
+        });
+
+        QCOMPARE(imported.count(), options.channels);
+
+        for (const auto &s : imported)
+        {
+            QCOMPARE((uint64_t) s->size(), SyntheticGenerator(options).getRowCount());
+        }
+
+        checkBaseline("import/csv", ms);
+    }
+
+protected:
+    /**
+     * @brief The Baseline struct is the expected duration of a case, as a multiple of the calibration loop
+     */
+    struct Baseline
+    {
+        const char *name;
+        double ratio;
+    };
+
+    static double getBaseline(const QString &name)
+    {
+        // Normalised times of a release build (update with --perf-report)
+        static const Baseline baselines[] = {
+            {"append", 14.0},
+            {"resample/m4/1", 0.045},
+            {"resample/m4/0.1", 0.025},
+            {"resample/lttb/1", 0.04},
+            {"statistics", 0.06},
+            {"import/csv", 10.0},
+        };
+
+        for (const auto &baseline : baselines)
+        {
+            if (name == baseline.name) return baseline.ratio;
+        }
+
+        return 0;
+    }
+
+    static double getTolerance(void)
+    {
+        if (qEnvironmentVariableIsSet("LUMBERJACK_PERF_TOLERANCE"))
+        {
+            return qEnvironmentVariable("LUMBERJACK_PERF_TOLERANCE").toDouble();
+        }
+
+        return 0.5;
+    }
+
+    /*
+     * Duration of a fixed workload (the fastest of RUNS runs), which exercises both arithmetic and memory.
+     * The duration of each case is divided by this, so the baselines do not depend on the speed of the machine.
+     */
+    static double calibrate(void)
+    {
+        const size_t N = 1 << 22;
+
+        std::vector<double> values(N);
+
+        double best = std::numeric_limits<double>::infinity();
+        double checksum = 0;
+
+        for (int run = 0; run < RUNS; run++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+
+            uint64_t state = 1;
+
+            for (size_t idx = 0; idx < N; idx++)
+            {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                values[idx] = (double) (state >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            std::sort(values.begin(), values.begin() + N / 4);
+
+            double sum = 0;
+
+            for (size_t idx = 0; idx < N; idx++)
+            {
+                sum += std::sqrt(values[idx]) * values[(idx * 7) % N];
+            }
+
+            checksum += sum;
+
+            best = std::min(best, timer.nsecsElapsed() * 1e-6);
+        }
+
+        // The checksum is used, so the loop cannot be optimised away
+        return checksum > 0 ? best : 0;
+    }
+
+    //! Duration (ms) of the fastest of RUNS calls of the function
+    template<typename Function>
+    static double measure(Function function)
+    {
+        double best = std::numeric_limits<double>::infinity();
+
+        for (int run = 0; run < RUNS; run++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+
+            function();
+
+            best = std::min(best, timer.nsecsElapsed() * 1e-6);
+        }
+
+        return best;
+    }
+
+    void checkBaseline(const QString &name, double ms)
+    {
+        const double ratio = ms / calibration;
+        const double baseline = getBaseline(name);
+
+        qDebug().noquote() << QString("%1: %2 ms (%3 x calibration, baseline %4)").arg(name).arg(ms, 0, 'f', 1).arg(ratio, 0, 'f', 3).arg(baseline);
+
+        if (reportOnly) return;
+
+        QVERIFY2(baseline > 0, qPrintable(QString("No baseline for %1").arg(name)));
+
+        const double limit = baseline * (1 + getTolerance());
+
+        QVERIFY2(ratio <= limit, qPrintable(QString("%1 took %2 x calibration (limit %3)").arg(name).arg(ratio, 0, 'f', 3).arg(limit, 0, 'f', 3)));
+    }
+
+    //! Fill a series with a noisy sine wave, sampled every millisecond
+    static void fillSeries(DataSeries &target, qint64 n)
+    {
+        target.clearData(false);
+
+        const size_t CHUNK = 1 << 16;
+
+        std::vector<double> t(CHUNK);
+        std::vector<double> v(CHUNK);
+
+        for (qint64 first = 0; first < n; first += CHUNK)
+        {
+            const size_t count = (size_t) std::min<qint64>(CHUNK, n - first);
+
+            for (size_t ii = 0; ii < count; ii++)
+            {
+                const qint64 idx = first + ii;
+
+                t[ii] = (double) idx;
+                v[ii] = std::sin(idx * 1e-3) * 100 + (double) ((idx * 7919) % 13);
+            }
+
+            target.addData(t.data(), v.data(), count, false);
+        }
+    }
+
+    //! Print the normalised durations, rather than checking them
+    bool reportOnly = false;
+
+    //! Duration of the calibration loop (ms)
+    double calibration = 0;
+
+    //! Series which is resampled
+    DataSeries series;
+};
+
+
+#endif // TEST_PERFORMANCE_H
@@ -1,12 +1,100 @@
 #ifndef TEST_SERIES_H
 #define TEST_SERIES_H
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <thread>
 
 #include <qobject.h>
 #include <qtest.h>
 
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
 #include "data_series.hpp"
+#include "data_codec.hpp"
+#include "data_kernels.hpp"
+#include "time_ticks.hpp"
+#include "data_store.hpp"
+#include "plugin_filter.hpp"
+#include "filter_chain.hpp"
+#include "series_update_scheduler.hpp"
+#include "series_buffer.hpp"
+#include "concatenated_series.hpp"
+
+/*
+ * Filters used to test FilterPlugin::filterData
+ */
+class TestGainFilter : public FilterPlugin
+{
+public:
+    virtual QString pluginName(void) const override { return "Gain"; }
+    virtual QString pluginDescription(void) const override { return QString(); }
+    virtual QString pluginVersion(void) const override { return QString(); }
+
+    virtual bool isStateless(void) const override { return true; }
+
+    virtual void filterChunk(const FilterChunk &chunk) override
+    {
+        for (size_t ii = 0; ii < chunk.length; ii++) chunk.output[ii] = chunk.input[ii] * 2;
+    }
+};
+
+
+class TestAffineFilter : public FilterPlugin
+{
+public:
+    TestAffineFilter(double s, double o) : scaler(s), offset(o) {}
+
+    virtual QString pluginName(void) const override { return "Affine"; }
+    virtual QString pluginDescription(void) const override { return QString(); }
+    virtual QString pluginVersion(void) const override { return QString(); }
+
+    virtual bool isStateless(void) const override { return true; }
+    virtual bool getAffine(double &s, double &o) const override { s = scaler; o = offset; return true; }
+
+    virtual void filterChunk(const FilterChunk &chunk) override
+    {
+        for (size_t ii = 0; ii < chunk.length; ii++) chunk.output[ii] = chunk.input[ii] * scaler + offset;
+    }
+
+    double scaler;
+    double offset;
+};
+
+
+class TestSumFilter : public FilterPlugin
+{
+public:
+    virtual QString pluginName(void) const override { return "Sum"; }
+    virtual QString pluginDescription(void) const override { return QString(); }
+    virtual QString pluginVersion(void) const override { return QString(); }
+
+    virtual bool isStateless(void) const override { return false; }
+
+    virtual bool beginFilter(const DataView &samples) override { sum = 0; next = 0; return !samples.isEmpty(); }
+
+    virtual void filterChunk(const FilterChunk &chunk) override
+    {
+        // Chunks must be passed in order
+        if (chunk.index != next) ordered = false;
+        next = chunk.index + chunk.length;
+
+        for (size_t ii = 0; ii < chunk.length; ii++)
+        {
+            sum += chunk.input[ii];
+            chunk.output[ii] = sum;
+        }
+    }
+
+    double sum = 0;
+    uint64_t next = 0;
+    bool ordered = true;
+};
+
 
 class DataSeriesTests : public QObject
 {
@@ -87,6 +175,72 @@ private slots:
         QCOMPARE(update_count, 11);
     }
 
+    // Test for coalesced change notifications
+    void testChangeNotification(void)
+    {
+        auto *scheduler = SeriesUpdateScheduler::getInstance();
+
+        scheduler->notifyAll();
+
+        DataSeries s;
+
+        int count = 0;
+        double t_min = 0;
+        double t_max = 0;
+
+        connect(&s, &DataSeries::dataChanged, this, [&](double t0, double t1) {
+            count++;
+            t_min = t0;
+            t_max = t1;
+        });
+
+        scheduler->notifyAll();
+        count = 0;
+
+        // Each update is queued once, with the interval of every change
+        for (int idx = 0; idx < 100; idx++)
+        {
+            s.addData(1000 + idx, idx, true);
+        }
+
+        s.addData(500, 1, false);
+
+        QCOMPARE(scheduler->getPendingCount(), 1);
+
+        scheduler->notifyAll();
+
+        QCOMPARE(scheduler->getPendingCount(), 0);
+        QCOMPARE(count, 1);
+        QCOMPARE(t_min, 500.0);
+        QCOMPARE(t_max, 1099.0);
+
+        // Truncation changes every sample after the cut (and the series is queued again once it has been notified)
+        s.truncate(1050);
+        s.update();
+
+        QCOMPARE(scheduler->getPendingCount(), 1);
+
+        scheduler->notifyAll();
+
+        QCOMPARE(count, 2);
+        QCOMPARE(t_min, 1050.0);
+        QVERIFY(std::isinf(t_max));
+
+        // A change of scaling changes every sample
+        s.setScaler(2);
+        scheduler->notifyAll();
+
+        QCOMPARE(count, 3);
+        QVERIFY(std::isinf(t_min) && t_min < 0);
+        QVERIFY(std::isinf(t_max) && t_max > 0);
+
+        // Nothing is delivered without an update
+        s.addData(2000, 1, false);
+        scheduler->notifyAll();
+
+        QCOMPARE(count, 3);
+    }
+
     // Tests for binary search indexing
     void testIndexing(void)
     {
@@ -118,6 +272,438 @@ private slots:
         QVERIFY(isInOrder());
     }
 
+    // Tests for data spanning multiple storage blocks
+    void testBlockStorage(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 3;
+
+        // Even timestamps first, then backfill the odd timestamps
+        for (int idx = 0; idx < N; idx += 2)
+        {
+            series.addData(idx, idx, false);
+        }
+
+        for (int idx = N - 1; idx > 0; idx -= 2)
+        {
+            series.addData(idx, idx, false);
+        }
+
+        QCOMPARE(series.size(), N);
+        QVERIFY(isInOrder());
+
+        for (int idx = 0; idx < N; idx += 997)
+        {
+            QCOMPARE(series.getTimestamp(idx), idx);
+            QCOMPARE(series.getValue(idx), idx);
+            QCOMPARE(series.getIndexForTimestamp(idx), idx + 1);
+        }
+    }
+
+    // Tests for batch insertion of samples
+    void testBulkInsert(void)
+    {
+        series.clearData();
+
+        DataSeries reference;
+
+        std::vector<double> t;
+        std::vector<double> v;
+
+        for (int batch = 0; batch < 4; batch++)
+        {
+            t.clear();
+            v.clear();
+
+            for (int idx = 0; idx < 1000; idx++)
+            {
+                // First batch in order, subsequent batches overlap existing data
+                t.push_back(batch == 0 ? idx : rand() % 1500);
+                v.push_back(idx % 10 == 0 ? NAN : rand() % 1000);
+            }
+
+            series.addData(t, v, false);
+
+            for (size_t idx = 0; idx < t.size(); idx++)
+            {
+                reference.addData(t[idx], v[idx], false);
+            }
+        }
+
+        // Non-finite values are discarded
+        QCOMPARE(series.size(), 3600);
+        QCOMPARE(series.size(), reference.size());
+        QVERIFY(isInOrder());
+
+        for (size_t idx = 0; idx < series.size(); idx++)
+        {
+            QCOMPARE(series.getTimestamp(idx), reference.getTimestamp(idx));
+        }
+    }
+
+    // Tests for staging of out-of-order samples
+    void testStagedSamples(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 2;
+
+        // Even timestamps in order
+        for (int idx = 0; idx < N; idx += 2)
+        {
+            series.addData(idx, idx, false);
+        }
+
+        // Late samples are visible as soon as the series is read
+        series.addData(101, 101, false);
+        series.addData(11, 11, false);
+
+        QCOMPARE(series.size(), N / 2 + 2);
+        QCOMPARE(series.getTimestamp(6), 11);
+        QCOMPARE(series.getTimestamp(52), 101);
+        QVERIFY(isInOrder());
+
+        // Backfill the remaining odd timestamps, without reading in between
+        for (int idx = N - 1; idx > 0; idx -= 2)
+        {
+            if (idx != 101 && idx != 11)
+            {
+                series.addData(idx, idx, false);
+            }
+        }
+
+        // Samples with equal timestamps retain their arrival order
+        series.addData(0, -1, false);
+        series.addData(0, -2, false);
+
+        series.flush(false);
+
+        QCOMPARE(series.size(), N + 2);
+        QVERIFY(isInOrder());
+
+        QCOMPARE(series.getValue(0), 0);
+        QCOMPARE(series.getValue(1), -1);
+        QCOMPARE(series.getValue(2), -2);
+
+        for (int idx = 1; idx < N; idx += 997)
+        {
+            QCOMPARE(series.getTimestamp(idx + 2), idx);
+            QCOMPARE(series.getValue(idx + 2), idx);
+        }
+
+        // Appending continues after a merge
+        series.addData(N, N, false);
+
+        QCOMPARE(series.getNewestTimestamp(), N);
+
+        // Staged samples are discarded when the series is cleared
+        series.addData(5, 5, false);
+        series.clearData(false);
+
+        QCOMPARE(series.size(), 0);
+    }
+
+    // Tests for the min/max summary pyramid
+    void testLoader(void)
+    {
+        DataSeries lazy("lazy");
+
+        std::atomic<int> calls{0};
+
+        lazy.setLoader([&calls](std::vector<double>& t, std::vector<double>& v) {
+            calls++;
+
+            for (int idx = 0; idx < 10000; idx++)
+            {
+                t.push_back(idx);
+                v.push_back(idx * 2);
+            }
+
+            return true;
+        });
+
+        // Nothing is loaded until the series is read
+        QVERIFY(!lazy.isLoaded());
+        QCOMPARE(calls.load(), 0);
+
+        // Concurrent readers all observe the complete series, and the loader is only called once
+        std::vector<size_t> sizes(4);
+        std::vector<std::thread> readers;
+
+        for (size_t idx = 0; idx < sizes.size(); idx++)
+        {
+            readers.emplace_back([&lazy, &sizes, idx]() { sizes[idx] = lazy.size(); });
+        }
+
+        for (auto& reader : readers)
+        {
+            reader.join();
+        }
+
+        for (size_t size : sizes)
+        {
+            QCOMPARE(size, 10000);
+        }
+
+        QVERIFY(lazy.isLoaded());
+        QCOMPARE(calls.load(), 1);
+        QCOMPARE(lazy.getValue(1234), 2468);
+
+        // A series which is copied is loaded first
+        DataSeries pending("pending");
+
+        pending.setLoader([](std::vector<double>& t, std::vector<double>& v) {
+            t = {1, 2, 3};
+            v = {4, 5, 6};
+            return true;
+        });
+
+        DataSeries copy(pending);
+
+        QCOMPARE(copy.size(), 3);
+        QCOMPARE(copy.getNewestValue(), 6);
+
+        // A series which fails to load is empty
+        DataSeries failed("failed");
+
+        failed.setLoader([](std::vector<double>& t, std::vector<double>& v) {
+            t = {1};
+            v = {1};
+            return false;
+        });
+
+        QCOMPARE(failed.size(), 0);
+        QVERIFY(failed.isLoaded());
+
+        // A series which is cleared before it is read is never loaded
+        calls = 0;
+
+        lazy.setLoader([&calls](std::vector<double>&, std::vector<double>&) {
+            calls++;
+            return true;
+        });
+
+        lazy.clearData(false);
+
+        QCOMPARE(lazy.size(), 0);
+        QCOMPARE(calls.load(), 0);
+
+        // A series which is truncated (or clipped) before it is read is loaded first
+        auto loadTen = [](std::vector<double>& t, std::vector<double>& v) {
+            for (int idx = 0; idx < 10; idx++)
+            {
+                t.push_back(idx);
+                v.push_back(idx);
+            }
+
+            return true;
+        };
+
+        DataSeries truncated("truncated");
+
+        truncated.setLoader(loadTen);
+        truncated.truncate(5, false);
+
+        QVERIFY(truncated.isLoaded());
+        QCOMPARE(truncated.size(), 5);
+        QCOMPARE(truncated.getNewestValue(), 4);
+
+        DataSeries clipped("clipped");
+
+        clipped.setLoader(loadTen);
+        clipped.clipTimeRange(2, 7, false);
+
+        QVERIFY(clipped.isLoaded());
+        QCOMPARE(clipped.size(), 6);
+        QCOMPARE(clipped.getOldestValue(), 2);
+        QCOMPARE(clipped.getNewestValue(), 7);
+    }
+
+    void testSummary(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 2 + 1000;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, rand() % 10000 - 5000, false);
+        }
+
+        // Insert some out-of-order samples, which forces the summary to be recalculated
+        series.addData(500.5, 9999, false);
+        series.addData(40000.5, -9999, false);
+
+        const uint64_t idx_first = 123;
+        const uint64_t idx_last = series.size() - 456;
+
+        // Expected result, by brute force
+        double v_min = series.getValue(idx_first);
+        double v_max = v_min;
+
+        for (uint64_t idx = idx_first; idx < idx_last; idx++)
+        {
+            v_min = qMin(v_min, series.getValue(idx));
+            v_max = qMax(v_max, series.getValue(idx));
+        }
+
+        for (int level = -1; level < (int) DataBlock::SUMMARY_LEVELS; level++)
+        {
+            uint64_t count = 0;
+            double t_prev = -1;
+            double b_min = v_max;
+            double b_max = v_min;
+
+            series.visitBuckets(idx_first, idx_last, level, [&](const DataSeries::Bucket& bucket) {
+                // Buckets must be contiguous and in order
+                QVERIFY(bucket.first.timestamp > t_prev);
+                t_prev = bucket.last.timestamp;
+
+                count += bucket.count;
+                b_min = qMin(b_min, bucket.min.value);
+                b_max = qMax(b_max, bucket.max.value);
+            });
+
+            QCOMPARE(count, idx_last - idx_first);
+            QCOMPARE(b_min, v_min);
+            QCOMPARE(b_max, v_max);
+        }
+    }
+
+    // Test that a snapshot is unaffected by subsequent changes to the series
+    void testSnapshot(void)
+    {
+        auto snapshot = series.getSnapshot();
+
+        QCOMPARE(snapshot.size(), 100);
+
+        double t_newest = snapshot.getTimestamp(99);
+        double v_first = snapshot.getValue(0);
+
+        // Append, insert and clip
+        for (int idx = 0; idx < 1000; idx++)
+        {
+            series.addData(100 + idx, idx, false);
+        }
+
+        series.addData(0.5, 1234, false);
+        series.clipTimeRange(50, 2000, false);
+
+        QCOMPARE(snapshot.size(), 100);
+        QCOMPARE(snapshot.getTimestamp(99), t_newest);
+        QCOMPARE(snapshot.getValue(0), v_first);
+
+        series.clearData(false);
+
+        QCOMPARE(series.size(), 0);
+        QCOMPARE(snapshot.size(), 100);
+        QCOMPARE(snapshot.upperBound(t_newest), 100);
+        QVERIFY_EXCEPTION_THROWN(snapshot.getValue(100), std::out_of_range);
+    }
+
+    // Tests for zero-copy views across multiple blocks
+    void testView(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 2 + 100;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, idx * 2, false);
+        }
+
+        series.setValuePrecision(DataSeries::SINGLE_PRECISION);
+
+        auto view = series.getView(1000, N - 50);
+
+        QCOMPARE(view.size(), N - 50 - 1000 + 1);
+        QCOMPARE(view.getTimestamp(0), 1000);
+
+        // Iterate sample by sample
+        uint64_t idx = 0;
+
+        for (const auto& point : view)
+        {
+            QCOMPARE(point.timestamp, view.getTimestamp(idx));
+            QCOMPARE(point.value, point.timestamp * 2);
+            idx++;
+        }
+
+        QCOMPARE(idx, view.size());
+
+        // Iterate segment by segment
+        uint64_t count = 0;
+        int segments = 0;
+
+        view.visitSegments([&](const DataView::Segment& segment) {
+            QCOMPARE(segment.index, count);
+            QCOMPARE(segment.getTimestamp(0), view.getTimestamp(count));
+            QCOMPARE(segment.getValue(segment.length - 1), view.getValue(count + segment.length - 1));
+
+            count += segment.length;
+            segments++;
+        });
+
+        QCOMPARE(count, view.size());
+        QCOMPARE(segments, 3);
+
+        // Bulk copy, with and without scaling
+        series.setScaler(-2, false);
+        series.setOffset(5, false);
+
+        auto scaled = series.getView(1000, N - 50);
+
+        std::vector<double> t(scaled.size());
+        std::vector<double> raw(scaled.size());
+        std::vector<double> v(scaled.size());
+
+        scaled.copyTimestamps(t.data());
+        scaled.copyValues(raw.data(), true);
+        scaled.copyValues(v.data());
+
+        for (size_t ii = 0; ii < t.size(); ii += 101)
+        {
+            QCOMPARE(t[ii], view.getTimestamp(ii));
+            QCOMPARE(raw[ii], view.getValue(ii));
+            QCOMPARE(v[ii], view.getValue(ii) * -2 + 5);
+        }
+
+        series.setScaler(1, false);
+        series.setOffset(0, false);
+
+        // View is unaffected by clearing the series
+        series.clearData(false);
+        QCOMPARE(view.getValue(0), 2000);
+
+        series.setValuePrecision(DataSeries::DOUBLE_PRECISION);
+
+        QVERIFY(series.getView(0, 100).isEmpty());
+    }
+
+    // Tests for single precision value storage
+    void testValuePrecision(void)
+    {
+        series.clearData();
+
+        series.addData(0, 0.1);
+        series.addData(1, 1.0 / 3.0);
+
+        QCOMPARE(series.getValuePrecision(), DataSeries::DOUBLE_PRECISION);
+        QCOMPARE(series.getValue(0), 0.1);
+
+        series.setValuePrecision(DataSeries::SINGLE_PRECISION);
+
+        QCOMPARE(series.size(), 2);
+        QCOMPARE(series.getValue(0), (double) 0.1f);
+        QCOMPARE(series.getValue(1), (double) (1.0f / 3.0f));
+
+        // New samples are also stored in single precision
+        series.addData(2, 0.7);
+        QCOMPARE(series.getValue(2), (double) 0.7f);
+    }
+
     // Test that we can copy this series from another series
     void testCopy(void)
     {
@@ -132,6 +718,34 @@ private slots:
 
         QCOMPARE(series.size(), 0);
         QCOMPARE(copy.size(), 100);
+
+        // Large copies share their blocks, but are still modified independently
+        const int N = DataBlock::CAPACITY * 2 + 500;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, idx, false);
+        }
+
+        DataSeries large = series;
+
+        series.addData(N, -1, false);
+        large.addData(N, -2, false);
+        large.addData(10.5, -3, false);
+
+        QCOMPARE(series.size(), N + 1);
+        QCOMPARE(large.size(), N + 2);
+
+        QCOMPARE(series.getNewestValue(), -1);
+        QCOMPARE(large.getNewestValue(), -2);
+
+        QCOMPARE(series.getTimestamp(11), 11);
+        QCOMPARE(large.getTimestamp(11), 10.5);
+
+        for (int idx = 0; idx < N; idx += 997)
+        {
+            QCOMPARE(series.getTimestamp(idx), idx);
+        }
     }
 
     // Test that we can correctly slice out a subsection of data
@@ -177,6 +791,32 @@ private slots:
 
         QCOMPARE(slice_5.getOldestTimestamp(), 0);
         QCOMPARE(slice_5.getNewestTimestamp(), 86);
+
+        // Slices spanning multiple blocks
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 4;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, idx, false);
+        }
+
+        series.setScaler(2, false);
+
+        DataSeries slice_6 = DataSeries(series, 1000, N - 1000);
+
+        QCOMPARE(slice_6.size(), N - 1999);
+        QCOMPARE(slice_6.getOldestTimestamp(), 1000);
+        QCOMPARE(slice_6.getNewestTimestamp(), N - 1000);
+
+        for (int idx = 0; idx < (int) slice_6.size(); idx += 997)
+        {
+            QCOMPARE(slice_6.getTimestamp(idx), idx + 1000);
+            QCOMPARE(slice_6.getValue(idx), series.getValue(idx + 1000));
+        }
+
+        series.setScaler(1, false);
     }
 
     // Test timespan clipping
@@ -208,12 +848,65 @@ private slots:
         QCOMPARE(series.getMaximumValue(56, 105), 49);
     }
 
-    // Test mean (average) calculation
-    void testMean(void)
+    void testBounds(void)
     {
         series.clearData();
 
-        for (int idx = 0; idx < 100; idx++)
+        QVERIFY(series.getBounds().isNull());
+
+        for (int ii = 0; ii < 100; ii++)
+        {
+            series.addData(ii, ii - 50);
+        }
+
+        QRectF bounds = series.getBounds();
+
+        QCOMPARE(bounds.left(), 0.0);
+        QCOMPARE(bounds.right(), 99.0);
+        QCOMPARE(bounds.top(), -50.0);
+        QCOMPARE(bounds.bottom(), 49.0);
+
+        // The range is extended as samples are appended (across block boundaries)
+        for (size_t ii = 100; ii < DataBlock::CAPACITY * 2; ii++)
+        {
+            series.addData(ii, ii == DataBlock::CAPACITY + 10 ? 1000 : 0, false);
+
+            if (ii % 10000 == 0)
+            {
+                QCOMPARE(series.getMaximumValue(), ii > DataBlock::CAPACITY + 10 ? 1000.0 : 49.0);
+            }
+        }
+
+        QCOMPARE(series.getMaximumValue(), 1000.0);
+        QCOMPARE(series.getMinimumValue(), -50.0);
+
+        // Scaling is applied to the retained range
+        series.setScaler(-2);
+
+        QCOMPARE(series.getMinimumValue(), -2000.0);
+        QCOMPARE(series.getMaximumValue(), 100.0);
+
+        series.setScaler(1);
+
+        // Clipping discards the retained range
+        series.clipTimeRange(200, 300);
+
+        QCOMPARE(series.getMinimumValue(), 0.0);
+        QCOMPARE(series.getMaximumValue(), 0.0);
+
+        series.clearData();
+        series.addData(5, 7);
+
+        QCOMPARE(series.getMinimumValue(), 7.0);
+        QCOMPARE(series.getMaximumValue(), 7.0);
+    }
+
+    // Test mean (average) calculation
+    void testMean(void)
+    {
+        series.clearData();
+
+        for (int idx = 0; idx < 100; idx++)
         {
             series.addData(idx, idx);
         }
@@ -248,6 +941,472 @@ private slots:
         QCOMPARE(series.getMeanValue(20.01, 30), 25);
     }
 
+    // Test range statistics against a brute force calculation
+    void testStatistics(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 2 + 5000;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, rand() % 2000 - 1000, false);
+        }
+
+        series.setScaler(-0.5, false);
+        series.setOffset(10, false);
+
+        const double t_min = 77;
+        const double t_max = N - 1234;
+
+        uint64_t count = 0;
+        double v_min = __DBL_MAX__;
+        double v_max = -__DBL_MAX__;
+        double sum = 0;
+        double sum_squares = 0;
+
+        for (uint64_t idx = 0; idx < series.size(); idx++)
+        {
+            double t = series.getTimestamp(idx);
+            double v = series.getValue(idx);
+
+            if (t < t_min || t > t_max) continue;
+
+            count++;
+            v_min = qMin(v_min, v);
+            v_max = qMax(v_max, v);
+            sum += v;
+            sum_squares += v * v;
+        }
+
+        double mean = sum / count;
+        double std_dev = sqrt(sum_squares / count - mean * mean);
+
+        auto stats = series.getStatistics(t_min, t_max);
+
+        QCOMPARE(stats.count, count);
+        QCOMPARE(stats.min, v_min);
+        QCOMPARE(stats.max, v_max);
+        QVERIFY(fabs(stats.getMean() - mean) < 1e-6);
+        QVERIFY(fabs(stats.getStdDev() - std_dev) < 1e-6);
+
+        QCOMPARE(series.getMinimumValue(t_min, t_max), v_min);
+        QCOMPARE(series.getMaximumValue(t_min, t_max), v_max);
+
+        // Range which contains no samples
+        QCOMPARE(series.getStatistics(0.2, 0.8).count, 0);
+
+        series.setScaler(1, false);
+        series.setOffset(0, false);
+    }
+
+    // Test that the variance of values with a large offset is accurate (and never negative)
+    void testStatisticsPrecision(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 2 + 5000;
+        const double base = 1e9;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, base + (idx % 7) * 1e-3, false);
+        }
+
+        const uint64_t idx_first = 77;
+        const uint64_t idx_last = N - 1234;
+
+        // Expected result, by two passes (about the exact mean of the small variations)
+        double sum = 0;
+
+        for (uint64_t idx = idx_first; idx < idx_last; idx++)
+        {
+            sum += series.getValue(idx) - base;
+        }
+
+        const double mean = sum / (idx_last - idx_first);
+        double m2 = 0;
+
+        for (uint64_t idx = idx_first; idx < idx_last; idx++)
+        {
+            const double d = series.getValue(idx) - base - mean;
+            m2 += d * d;
+        }
+
+        const double std_dev = sqrt(m2 / (idx_last - idx_first));
+
+        auto stats = series.getSnapshot().getStatistics(idx_first, idx_last);
+
+        QVERIFY(stats.getVariance() >= 0);
+        QVERIFY(fabs(stats.getStdDev() - std_dev) < 1e-6 * std_dev);
+        QVERIFY(fabs(stats.getRms() - (base + mean)) < 1e-3);
+
+        // The offset does not affect the deviations
+        series.setOffset(-base, false);
+
+        stats = series.getSnapshot().getStatistics(idx_first, idx_last);
+
+        QVERIFY(fabs(stats.getMean() - mean) < 1e-6);
+        QVERIFY(fabs(stats.getStdDev() - std_dev) < 1e-6 * std_dev);
+
+        // Constant values have (almost) no variance, rather than a negative variance from cancellation
+        series.clearData();
+        series.setOffset(0, false);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, base + 0.1, false);
+        }
+
+        stats = series.getSnapshot().getStatistics(0, N);
+
+        QVERIFY(stats.getVariance() >= 0 && stats.getVariance() < 1e-9);
+    }
+
+    // Test that the vectorised reduction kernels match the scalar implementation
+    void testKernels(void)
+    {
+        qDebug() << "Reduction kernels:" << DataKernels::getInstructionSet();
+
+        std::vector<double> values(1000);
+        std::vector<float> values_single(1000);
+
+        for (size_t idx = 0; idx < values.size(); idx++)
+        {
+            values[idx] = (rand() % 20000 - 10000) * 0.125;
+            values_single[idx] = (float) values[idx];
+        }
+
+        for (size_t n : {1, 2, 3, 4, 5, 7, 8, 9, 63, 64, 65, 1000})
+        {
+            DataReduction expected;
+            DataReduction result;
+
+            DataKernels::reduceScalar(values.data(), n, expected);
+            DataKernels::reduce(values.data(), n, result);
+
+            QCOMPARE(result.min, expected.min);
+            QCOMPARE(result.max, expected.max);
+            QVERIFY(fabs(result.sum - expected.sum) < 1e-6);
+            QVERIFY(fabs(result.sumSquares - expected.sumSquares) < 1e-3);
+
+            DataKernels::reduceScalar(values_single.data(), n, expected);
+            DataKernels::reduce(values_single.data(), n, result);
+
+            QCOMPARE(result.min, expected.min);
+            QCOMPARE(result.max, expected.max);
+            QVERIFY(fabs(result.sum - expected.sum) < 1e-6);
+            QVERIFY(fabs(result.sumSquares - expected.sumSquares) < 1e-3);
+
+            QCOMPARE(values[DataKernels::indexOf(values.data(), n, result.min)], result.min);
+        }
+
+        // The branchless search matches the standard search (including repeated values)
+        std::vector<double> sorted(values);
+        std::vector<uint64_t> offsets;
+
+        std::sort(sorted.begin(), sorted.end());
+
+        for (size_t idx = 0; idx < sorted.size(); idx++)
+        {
+            offsets.push_back((uint64_t) idx / 3 * 7);
+        }
+
+        for (size_t n : {0, 1, 2, 3, 7, 8, 9, 1000})
+        {
+            for (int ii = -1; ii <= 1000; ii++)
+            {
+                const double v = ii < 0 ? -1e9 : (ii == 1000 ? 1e9 : sorted[ii]);
+                const uint64_t o = ii < 0 ? 0 : offsets[ii % 1000] + (ii % 2);
+
+                QCOMPARE(DataKernels::lowerBound(sorted.data(), n, v), (uint64_t) (std::lower_bound(sorted.begin(), sorted.begin() + n, v) - sorted.begin()));
+                QCOMPARE(DataKernels::upperBound(sorted.data(), n, v), (uint64_t) (std::upper_bound(sorted.begin(), sorted.begin() + n, v) - sorted.begin()));
+                QCOMPARE(DataKernels::lowerBound(offsets.data(), n, o), (uint64_t) (std::lower_bound(offsets.begin(), offsets.begin() + n, o) - offsets.begin()));
+                QCOMPARE(DataKernels::upperBound(offsets.data(), n, o), (uint64_t) (std::upper_bound(offsets.begin(), offsets.begin() + n, o) - offsets.begin()));
+            }
+        }
+    }
+
+    void testDataStore(void)
+    {
+        auto store = std::make_shared<DataStore>();
+
+        QVERIFY(store->isValid());
+
+        DataSeries reference;
+
+        series.clearData();
+        series.setDataStore(store);
+
+        const int N = DataBlock::CAPACITY * 3 + 100;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            double t = idx % 1000 == 0 ? idx - 500.5 : idx;
+            double v = rand() % 10000;
+
+            series.addData(t, v, false);
+            reference.addData(t, v, false);
+        }
+
+        QVERIFY(store->getMappedBytes() > 0);
+        QCOMPARE(series.size(), reference.size());
+        QVERIFY(isInOrder());
+
+        for (size_t idx = 0; idx < series.size(); idx += 7)
+        {
+            QCOMPARE(series.getTimestamp(idx), reference.getTimestamp(idx));
+            QCOMPARE(series.getValue(idx), reference.getValue(idx));
+        }
+
+        QCOMPARE(series.getStatistics().sum, reference.getStatistics().sum);
+
+        // Move the samples back to the heap
+        auto snapshot = series.getSnapshot();
+
+        series.setDataStore(nullptr);
+
+        QCOMPARE(snapshot.getValue(N - 1), series.getValue(N - 1));
+
+        series.clearData();
+    }
+
+    // Test that the compressed encoding is lossless
+    void testCodec(void)
+    {
+        const size_t N = 5000;
+
+        std::vector<double> t(N);
+        std::vector<double> v(N);
+        std::vector<float> v_single(N);
+
+        for (size_t idx = 0; idx < N; idx++)
+        {
+            // Regular sample rate, with occasional jitter and gaps
+            t[idx] = idx * 0.001 + (idx % 100 == 0 ? 0.0005 : 0) + (idx > N / 2 ? 1e6 : 0) - 2;
+
+            // Mixture of repeated, slowly changing and random values
+            v[idx] = idx < 1000 ? 3.5 : (idx < 3000 ? sin(idx * 0.01) : (rand() - RAND_MAX / 2) * 1e-3);
+            v_single[idx] = (float) v[idx];
+        }
+
+        std::vector<uint64_t> encoded_t;
+        std::vector<uint64_t> encoded_v;
+        std::vector<uint64_t> encoded_single;
+
+        DataCodec::encodeTimestamps(t.data(), N, encoded_t);
+        DataCodec::encodeValues(v.data(), N, encoded_v);
+        DataCodec::encodeValues(v_single.data(), N, encoded_single);
+
+        std::vector<double> t_out(N);
+        std::vector<double> v_out(N);
+        std::vector<float> single_out(N);
+
+        DataCodec::decodeTimestamps(encoded_t, N, t_out.data());
+        DataCodec::decodeValues(encoded_v, N, v_out.data());
+        DataCodec::decodeValues(encoded_single, N, single_out.data());
+
+        for (size_t idx = 0; idx < N; idx++)
+        {
+            QCOMPARE(t_out[idx], t[idx]);
+            QCOMPARE(v_out[idx], v[idx]);
+            QCOMPARE(single_out[idx], v_single[idx]);
+        }
+
+        // Regular timestamps compress to (much) less than one byte per sample
+        QVERIFY(encoded_t.size() * sizeof(uint64_t) < N);
+
+        // Timestamps at whole ticks (e.g. imported exactly) are delta encoded as ticks, which removes the jitter
+        // of the representation of each timestamp as a double
+        std::vector<double> t_ticks(N);
+        std::vector<uint64_t> encoded_ticks;
+
+        for (size_t idx = 0; idx < N; idx++)
+        {
+            t_ticks[idx] = TimeTicks::toSeconds(4000LL * TimeTicks::PER_SECOND + idx * 1000000LL + (idx % 7) * 1000LL);
+        }
+
+        DataCodec::encodeTimestamps(t_ticks.data(), N, encoded_ticks);
+
+        DataCodec::decodeTimestamps(encoded_ticks, N, t_out.data());
+
+        for (size_t idx = 0; idx < N; idx++)
+        {
+            QCOMPARE(t_out[idx], t_ticks[idx]);
+        }
+
+        // Timestamps which are not whole ticks are encoded (exactly) as before
+        t_ticks[N / 2] += 1e-12;
+
+        encoded_t.clear();
+        DataCodec::encodeTimestamps(t_ticks.data(), N, encoded_t);
+        DataCodec::decodeTimestamps(encoded_t, N, t_out.data());
+
+        for (size_t idx = 0; idx < N; idx++)
+        {
+            QCOMPARE(t_out[idx], t_ticks[idx]);
+        }
+
+        QVERIFY(encoded_ticks.size() < encoded_t.size());
+
+        // Empty columns (which may have no storage) are encoded and decoded without being accessed
+        std::vector<double> empty;
+        std::vector<uint64_t> encoded_empty;
+
+        DataCodec::encodeValues(empty.data(), 0, encoded_empty);
+        DataCodec::decodeValues(encoded_empty, 0, empty.data());
+    }
+
+    // Test that a series with compressed blocks behaves identically to an uncompressed series
+    void testCompression(void)
+    {
+        DataSeries reference;
+
+        series.clearData();
+        series.setCompressionEnabled(true);
+
+        const int N = DataBlock::CAPACITY * 4 + 100;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            double v = round(sin(idx * 0.001) * 1000) / 10;
+
+            series.addData(idx, v, false);
+            reference.addData(idx, v, false);
+        }
+
+        QCOMPARE(series.size(), reference.size());
+
+        // Out-of-order samples within compressed blocks
+        for (int idx = 0; idx < 100; idx++)
+        {
+            double t = (rand() % N) + 0.5;
+
+            series.addData(t, idx, false);
+            reference.addData(t, idx, false);
+        }
+
+        QCOMPARE(series.size(), reference.size());
+        QVERIFY(isInOrder());
+
+        for (size_t idx = 0; idx < series.size(); idx += 3)
+        {
+            QCOMPARE(series.getTimestamp(idx), reference.getTimestamp(idx));
+            QCOMPARE(series.getValue(idx), reference.getValue(idx));
+        }
+
+        QCOMPARE(series.getIndexForTimestamp(12345.5), reference.getIndexForTimestamp(12345.5));
+
+        auto stats = series.getStatistics(1000, N - 1000);
+        auto expected = reference.getStatistics(1000, N - 1000);
+
+        QCOMPARE(stats.count, expected.count);
+        QCOMPARE(stats.min, expected.min);
+        QCOMPARE(stats.max, expected.max);
+
+        // Iterate across compressed block boundaries
+        auto view = series.getView();
+        uint64_t idx = 0;
+
+        for (auto it = view.begin(); it != view.end(); ++it, idx++)
+        {
+            if (idx % 1001 == 0)
+            {
+                QCOMPARE((*it).value, reference.getValue(idx));
+            }
+        }
+
+        QCOMPARE(idx, reference.size());
+
+        // A full block of slowly changing, regularly sampled data
+        DataBlock block(DataBlock::CAPACITY);
+
+        for (size_t ii = 0; ii < DataBlock::CAPACITY; ii++)
+        {
+            block.append(ii * 0.01, round(sin(ii * 0.001) * 100));
+        }
+
+        DataBlock compressed(block, DataBlock::ENCODING_COMPRESSED);
+
+        QVERIFY(compressed.isCompressed());
+        QVERIFY(compressed.getEncodedSize() * 5 < DataBlock::CAPACITY * 2 * sizeof(double));
+        QCOMPARE(compressed.getLastTimestamp(), block.getLastTimestamp());
+        QCOMPARE(compressed.getValue(DataBlock::CAPACITY / 2), block.getValue(DataBlock::CAPACITY / 2));
+
+        series.setCompressionEnabled(false);
+        series.clearData();
+    }
+
+    // Test that evenly spaced samples are stored with implicit timestamps
+    void testUniformTimestamps(void)
+    {
+        DataBlock block(DataBlock::CAPACITY);
+
+        for (size_t idx = 0; idx < DataBlock::CAPACITY; idx++)
+        {
+            block.append(100 + idx * 0.004, idx);
+        }
+
+        DataBlock uniform(block, DataBlock::ENCODING_UNIFORM);
+
+        QVERIFY(uniform.hasUniformTimestamps());
+        QVERIFY(!uniform.isCompressed());
+        QVERIFY(fabs(uniform.getUniformInterval() - 0.004) < 1e-12);
+
+        for (size_t idx = 0; idx < DataBlock::CAPACITY; idx += 97)
+        {
+            QVERIFY(fabs(uniform.getTimestamp(idx) - block.getTimestamp(idx)) < 1e-9);
+            QCOMPARE(uniform.getValue(idx), block.getValue(idx));
+
+            // Searches must be consistent with the (implicit) timestamps
+            double t = uniform.getTimestamp(idx);
+
+            QCOMPARE(uniform.lowerBound(t, uniform.size()), idx);
+            QCOMPARE(uniform.upperBound(t, uniform.size()), idx + 1);
+            QCOMPARE(uniform.lowerBound(t + 0.001, uniform.size()), idx + 1);
+        }
+
+        QCOMPARE(uniform.lowerBound(0, uniform.size()), 0);
+        QCOMPARE(uniform.upperBound(1e9, uniform.size()), uniform.size());
+        QCOMPARE(uniform.getLastTimestamp(), uniform.getColumns().getTimestamp(uniform.size() - 1));
+
+        // A single out-of-cadence sample requires explicit timestamps
+        DataBlock jitter(DataBlock::CAPACITY);
+
+        for (size_t idx = 0; idx < DataBlock::CAPACITY; idx++)
+        {
+            jitter.append(idx == 1000 ? 1000.25 : idx, idx);
+        }
+
+        QVERIFY(!jitter.isEvenlySpaced());
+        QVERIFY(!DataBlock(jitter, DataBlock::ENCODING_UNIFORM).hasUniformTimestamps());
+
+        // Series with integer timestamps are stored exactly
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY * 3 + 10;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx, idx * 2, false);
+        }
+
+        for (int idx = 0; idx < N; idx += 101)
+        {
+            QCOMPARE(series.getTimestamp(idx), idx);
+            QCOMPARE(series.getIndexForTimestamp(idx), idx + 1);
+            QCOMPARE(series.getIndexForTimestamp(idx + 0.5, DataSeries::SEARCH_RIGHT_TO_LEFT), idx + 1);
+        }
+
+        // Inserting into an evenly spaced block falls back to explicit timestamps
+        series.addData(500.5, -1, false);
+
+        QCOMPARE(series.size(), N + 1);
+        QCOMPARE(series.getTimestamp(501), 500.5);
+        QCOMPARE(series.getTimestamp(N), N - 1);
+        QVERIFY(isInOrder());
+    }
+
     // Tests for data interpolation
     void testInterpolation(void)
     {
@@ -273,36 +1432,1039 @@ private slots:
         }
     }
 
-public slots:
-    void onDataUpdated()
+    // Tests for sequential lookups with a cursor
+    void testCursor(void)
     {
-        update_count++;
-    }
+        series.clearData();
 
-protected:
+        const int N = DataBlock::CAPACITY * 3 + 100;
 
-    int update_count = 0;
+        // Irregular timestamps (with repeats) spanning multiple blocks
+        for (int idx = 0; idx < N; idx++)
+        {
+            series.addData(idx * 2 + (idx % 3 == 0 ? 1 : 0), idx, false);
+        }
 
-    DataSeries series;
+        auto snapshot = series.getSnapshot();
+        auto cursor = series.getCursor();
 
-    // Determine if timestamp data are correctly ordered
-    bool isInOrder(void) const
-    {
-        if (series.size() <= 1) return true;
+        // Forward, in small and large steps
+        for (double t = -5; t < N * 2 + 5; t += (t < 1000 ? 0.5 : 37.25))
+        {
+            QCOMPARE(cursor.seek(t), snapshot.upperBound(t));
+        }
 
-        int64_t ts = series.getOldestTimestamp();
+        // Backward
+        for (double t = N * 2 + 5; t > -5; t -= 1013.5)
+        {
+            QCOMPARE(cursor.seek(t), snapshot.upperBound(t));
+        }
 
-        for (size_t idx = 0; idx < series.size(); idx++)
+        // Random
+        for (int ii = 0; ii < 1000; ii++)
         {
-            int64_t t = series.getTimestamp(idx);
+            double t = rand() % (N * 2);
 
-            if (t < ts) return false;
+            QCOMPARE(cursor.seek(t), snapshot.upperBound(t));
+        }
 
-            ts = t;
+        // Infinite timestamps, from the final block and on a new cursor
+        for (double t : {INFINITY, INFINITY, -INFINITY, INFINITY})
+        {
+            QCOMPARE(cursor.seek(t), snapshot.upperBound(t));
         }
 
-        return true;
-    }
-};
+        cursor = series.getCursor();
+
+        QCOMPARE(cursor.seek(INFINITY), (uint64_t) N);
+
+        // Interpolation matches the series
+        series.clearData();
+
+        for (int ii = 0; ii <= 10; ii++)
+        {
+            series.addData(ii, ii * 2);
+        }
+
+        // Infinite timestamps within a single block
+        cursor = series.getCursor();
+
+        QCOMPARE(cursor.seek(INFINITY), (uint64_t) 11);
+        QCOMPARE(cursor.seek(INFINITY), (uint64_t) 11);
+
+        cursor = series.getCursor();
+
+        QCOMPARE(cursor.interpolate(-10), 0);
+        QCOMPARE(cursor.interpolate(100), 20);
+        QCOMPARE(cursor.sampleHold(-10), 0);
+
+        for (double t = 0; t <= 10; t += 0.072)
+        {
+            QCOMPARE(cursor.interpolate(t), t * 2);
+            QCOMPARE(cursor.sampleHold(t), (int) t * 2);
+        }
+
+        // Resampling onto a grid matches individual lookups
+        std::vector<double> grid(200);
+
+        cursor.resample(-1, 0.063, grid.size(), grid.data());
+
+        for (size_t ii = 0; ii < grid.size(); ii++)
+        {
+            QCOMPARE(grid[ii], cursor.interpolate(-1 + ii * 0.063));
+        }
+
+        cursor.resample(-1, 0.063, grid.size(), grid.data(), DataCursor::RESAMPLE_HOLD);
+
+        for (size_t ii = 0; ii < grid.size(); ii++)
+        {
+            QCOMPARE(grid[ii], cursor.sampleHold(-1 + ii * 0.063));
+        }
+
+        // ... including across block boundaries, with irregular sample spacing
+        series.clearData();
+
+        for (int ii = 0; ii < 3 * DataBlock::CAPACITY; ii++)
+        {
+            series.addData(ii + 0.3 * (ii % 7), ii % 13);
+        }
+
+        cursor = series.getCursor();
+        grid.resize(5 * DataBlock::CAPACITY);
+
+        cursor.resample(-2.5, 0.61, grid.size(), grid.data());
+
+        for (size_t ii = 0; ii < grid.size(); ii++)
+        {
+            QCOMPARE(grid[ii], cursor.interpolate(-2.5 + ii * 0.61));
+        }
+
+        // An empty cursor is safe to use
+        DataCursor empty;
+
+        QCOMPARE(empty.seek(10), 0);
+        QCOMPARE(empty.interpolate(10), 0);
+    }
+
+    void testRetention(void)
+    {
+        series.clearData();
+
+        const int N = DataBlock::CAPACITY;
+        const int M = N * 10 + N / 2;
+
+        series.setRetention(N, false);
+        QCOMPARE(series.getRetention(), N);
+
+        auto snapshot = series.getSnapshot();
+
+        uint64_t idx_first = 0;
+        uint64_t idx_last = 0;
+
+        // Storage is bounded, however many samples are added
+        for (int ii = 0; ii < M; ii++)
+        {
+            series.addData(ii, ii % 1000, false);
+
+            if (ii == N / 2)
+            {
+                snapshot = series.getSnapshot();
+            }
+        }
+
+        QVERIFY(series.size() >= (size_t) N);
+        QVERIFY(series.size() <= (size_t) N * 2);
+        QCOMPARE(series.getNewestTimestamp(), M - 1);
+        QVERIFY(series.getOldestTimestamp() >= M - 1 - N * 2);
+
+        // The early snapshot still holds the discarded samples
+        QCOMPARE(snapshot.getTimestamp(0), 0);
+        QVERIFY(!series.getSnapshot().getCommonRange(snapshot, idx_first, idx_last));
+
+        // Appended samples are not common to an earlier snapshot
+        snapshot = series.getSnapshot();
+
+        series.addData(M, 0, false);
+
+        QVERIFY(series.getSnapshot().getCommonRange(snapshot, idx_first, idx_last));
+        QCOMPARE(idx_first, 0);
+        QCOMPARE(idx_last, snapshot.size());
+
+        // Disable retention
+        series.setRetention(0, false);
+
+        for (int ii = 0; ii < N * 2; ii++)
+        {
+            series.addData(M + 1 + ii, 0, false);
+        }
+
+        QCOMPARE(series.getOldestTimestamp(), snapshot.getTimestamp(0));
+    }
+
+    void testFilterPlugin(void)
+    {
+        // Several blocks, with a view which starts and ends part way through a block
+        const size_t N = DataBlock::CAPACITY * 5 + 123;
+
+        DataSeries input("input");
+
+        std::vector<double> t(N), v(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            t[ii] = ii * 0.01;
+            v[ii] = (double) (ii % 7);
+        }
+
+        input.addData(t, v);
+        input.setScaler(0.5);
+
+        const DataSnapshot snapshot = input.getSnapshot();
+        const DataView view = snapshot.getView(100, N - 50);
+
+        TestGainFilter gain;
+        DataSeries gained("gain");
+
+        QVERIFY(gain.filterData(view, gained));
+        QCOMPARE((size_t) gained.size(), (size_t) view.size());
+
+        bool match = true;
+
+        for (uint64_t ii = 0; ii < view.size(); ii++)
+        {
+            // Uniform timestamps are stored as a start time and interval (so may differ in the last bit)
+            if (std::fabs(gained.getTimestamp(ii) - view.getTimestamp(ii)) > 1e-9 || gained.getValue(ii) != view.getValue(ii) * 2) match = false;
+        }
+
+        QVERIFY(match);
+
+        TestSumFilter sum;
+        DataSeries summed("sum");
+
+        QVERIFY(sum.filterData(view, summed));
+        QVERIFY(sum.ordered);
+        QCOMPARE((size_t) summed.size(), (size_t) view.size());
+
+        double expected = 0;
+
+        for (uint64_t ii = 0; ii < view.size(); ii++)
+        {
+            expected += view.getValue(ii);
+            if (summed.getValue(ii) != expected) match = false;
+        }
+
+        QVERIFY(match);
+
+        // Filtering an empty view does nothing
+        QVERIFY(sum.filterData(DataView(), summed));
+        QCOMPARE((size_t) summed.size(), (size_t) view.size());
+    }
+
+    void testFilterChain(void)
+    {
+        const size_t N = DataBlock::CAPACITY * 4 + 500;
+
+        std::vector<double> t(N), v(N);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            t[ii] = ii * 0.001;
+            v[ii] = (double) (ii % 11);
+        }
+
+        series.clearData();
+        series.addData(t, v);
+        series.setOffset(1);
+
+        const DataSnapshot raw = series.getRawSnapshot();
+        const size_t blocks = raw.getTable()->blocks.size();
+
+        // Affine filters are folded into the scaling of the snapshot
+        auto chain = std::make_shared<FilterChain>();
+
+        chain->appendFilter(QSharedPointer<FilterPlugin>(new TestAffineFilter(2, 3)));
+        chain->appendFilter(QSharedPointer<FilterPlugin>(new TestAffineFilter(-1, 0.5)));
+
+        series.setFilter(chain);
+
+        DataSnapshot snapshot = series.getSnapshot();
+
+        QVERIFY(snapshot.getTable() == raw.getTable());
+        QCOMPARE(snapshot.getScaler(), -2.0);
+        QCOMPARE(snapshot.getOffset(), -4.5);
+        QCOMPARE(chain->getBlocksFiltered(), (uint64_t) 0);
+
+        // Affine filters after a non-affine filter are fused into one stage
+        chain->appendFilter(QSharedPointer<FilterPlugin>(new TestGainFilter()));
+        chain->appendFilter(QSharedPointer<FilterPlugin>(new TestAffineFilter(0.5, 1)));
+        chain->appendFilter(QSharedPointer<FilterPlugin>(new TestAffineFilter(4, -1)));
+
+        snapshot = series.getSnapshot();
+
+        QCOMPARE((size_t) snapshot.size(), N);
+        QCOMPARE(chain->getBlocksFiltered(), (uint64_t) blocks);
+
+        auto expected = [](double value) { return ((((value + 1) * 2 + 3) * -1 + 0.5) * 2 * 0.5 + 1) * 4 - 1; };
+
+        bool match = true;
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            if (snapshot.getTimestamp(ii) != raw.getTimestamp(ii) || snapshot.getValue(ii) != expected(v[ii])) match = false;
+        }
+
+        QVERIFY(match);
+
+        // The summaries (and statistics) describe the filtered values
+        QCOMPARE(series.getMaximumValue(), expected(0));
+        QCOMPARE(series.getMinimumValue(), expected(10));
+
+        // Reading the series again does not filter any blocks, and appending only filters the final block
+        series.getSnapshot();
+        QCOMPARE(chain->getBlocksFiltered(), (uint64_t) blocks);
+
+        series.addData(N * 0.001, 5);
+
+        snapshot = series.getSnapshot();
+
+        QCOMPARE((size_t) snapshot.size(), N + 1);
+        QCOMPARE(snapshot.getValue(N), expected(5));
+        QCOMPARE(chain->getBlocksFiltered(), (uint64_t) blocks + 1);
+
+        // A stateful filter is applied to the blocks in order
+        auto sum = QSharedPointer<TestSumFilter>(new TestSumFilter());
+
+        chain->clear();
+        chain->appendFilter(sum);
+
+        snapshot = series.getSnapshot();
+
+        QVERIFY(sum->ordered);
+
+        double total = 0;
+
+        for (size_t ii = 0; ii <= N; ii++)
+        {
+            total += raw.getScaler() * (ii < N ? v[ii] : 5) + raw.getOffset();
+
+            if (snapshot.getValue(ii) != total) match = false;
+        }
+
+        QVERIFY(match);
+
+        series.setFilter(nullptr);
+        series.setOffset(0);
+
+        QCOMPARE(series.getValue(0), v[0]);
+    }
+
+    void testSnapPoints(void)
+    {
+        const size_t N = DataBlock::CAPACITY * 2 + 5000;
+
+        series.clearData();
+        series.setScaler(2);
+        series.setOffset(0);
+
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            series.addData((double) ii * 2, std::sin(ii * 0.001) * 100 + (double) (ii % 13), false);
+        }
+
+        const DataSnapshot snapshot = series.getSnapshot();
+
+        QCOMPARE(snapshot.getNearestPoint(100.9).timestamp, 100.0);
+        QCOMPARE(snapshot.getNearestPoint(101.1).timestamp, 102.0);
+        QCOMPARE(snapshot.getNearestPoint(-50).timestamp, 0.0);
+        QCOMPARE(snapshot.getNearestPoint(1e12).timestamp, (double) (N - 1) * 2);
+
+        const uint64_t ranges[][2] = {
+            {0, N},
+            {17, 18},
+            {1000, DataBlock::CAPACITY + 3000},
+            {DataBlock::CAPACITY - 5, DataBlock::CAPACITY + 5},
+            {N - 700, N},
+        };
+
+        for (const auto &range : ranges)
+        {
+            DataPoint lo = snapshot.getDataPoint(range[0]);
+            DataPoint hi = lo;
+
+            for (uint64_t idx = range[0]; idx < range[1]; idx++)
+            {
+                const DataPoint point = snapshot.getDataPoint(idx);
+
+                if (point.value < lo.value) lo = point;
+                if (point.value > hi.value) hi = point;
+            }
+
+            QCOMPARE(snapshot.getExtremePoint(range[0], range[1], false).value, lo.value);
+            QCOMPARE(snapshot.getExtremePoint(range[0], range[1], true).value, hi.value);
+
+            // The sample itself is found (not only its value)
+            QCOMPARE(snapshot.getDataPoint(snapshot.lowerBound(snapshot.getExtremePoint(range[0], range[1], true).timestamp)).value, hi.value);
+        }
+
+        series.setScaler(1);
+    }
+
+    // Test that the memory used by a series is accounted for each category of storage
+    void testMemoryUsage(void)
+    {
+        DataSeries heap;
+
+        QCOMPARE(heap.getMemoryUsage().columns, (uint64_t) 0);
+        QCOMPARE(heap.getMemoryUsage().summary, (uint64_t) 0);
+
+        const int N = DataBlock::CAPACITY * 3 + 100;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            heap.addData(idx, rand() % 1000, false);
+        }
+
+        DataMemoryUsage usage = heap.getMemoryUsage();
+
+        // Evenly spaced blocks do not store timestamps
+        QVERIFY(usage.columns >= (uint64_t) N * sizeof(double));
+        QVERIFY(usage.summary > 0);
+        QVERIFY(usage.index > 0);
+        QCOMPARE(usage.mapped, (uint64_t) 0);
+        QCOMPARE(usage.compressed, (uint64_t) 0);
+
+        // Full blocks are compressed, and decoded columns are cached once they are read
+        heap.setCompressionEnabled(true);
+
+        const DataMemoryUsage compressed = heap.getMemoryUsage();
+
+        QVERIFY(compressed.compressed > 0);
+        QVERIFY(compressed.columns < usage.columns);
+        QCOMPARE(compressed.cache, (uint64_t) 0);
+
+        QCOMPARE(heap.getValue(10), heap.getRawSnapshot().getValue(10));
+        QVERIFY(heap.getMemoryUsage().cache > 0);
+
+        heap.releaseCaches();
+
+        QCOMPARE(heap.getMemoryUsage().cache, (uint64_t) 0);
+
+        // Columns of a memory-mapped store are not allocated on the heap
+        auto store = std::make_shared<DataStore>();
+
+        QVERIFY(store->isValid());
+
+        DataSeries mapped;
+
+        mapped.setDataStore(store);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            mapped.addData(idx, idx, false);
+        }
+
+        usage = mapped.getMemoryUsage();
+
+        QVERIFY(usage.mapped >= (uint64_t) N * sizeof(double));
+        QCOMPARE(usage.getTotalBytes(), usage.getHeapBytes() + usage.mapped);
+
+        // A series which is loaded on demand is not loaded to measure it
+        DataSeries lazy;
+
+        lazy.setLoader([](std::vector<double>& t, std::vector<double>& v) {
+            t.assign(1000, 1);
+            v.assign(1000, 1);
+            return true;
+        });
+
+        QCOMPARE(lazy.getMemoryUsage().getTotalBytes(), (uint64_t) 0);
+        QVERIFY(!lazy.isLoaded());
+    }
+
+    // Test that a buffer exposes the columns of a series (including compressed blocks) without copying them
+    void testSeriesBuffer(void)
+    {
+        const int N = DataBlock::CAPACITY * 3 + 100;
+
+        DataSeries compressed;
+        compressed.setCompressionEnabled(true);
+        compressed.setScaler(2.0, false);
+        compressed.setOffset(1.0, false);
+
+        std::vector<double> t(N);
+        std::vector<double> v(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx * 0.5;
+            v[idx] = round(sin(idx * 0.001) * 1000) / 10;
+        }
+
+        compressed.addData(t, v, false);
+
+        SeriesBuffer buffer = SeriesBuffer::fromSeries(compressed);
+
+        QCOMPARE(buffer.size(), (uint64_t) N);
+        QCOMPARE(buffer.getSegmentCount(), (size_t) 4);
+        QVERIFY(!buffer.isContiguous());
+        QVERIFY(!buffer.isSinglePrecision());
+
+        std::vector<double> timestamps(N);
+        std::vector<double> values(N);
+
+        buffer.copyTimestamps(timestamps.data());
+        buffer.copyValues(values.data(), false);
+
+        QVERIFY(timestamps == t);
+        QVERIFY(values == v);
+
+        buffer.copyValues(values.data());
+
+        QCOMPARE(values[N - 1], v[N - 1] * 2.0 + 1.0);
+
+        // The columns remain valid after the series is cleared (and the decoded blocks are released)
+        const DataView::Segment segment = buffer.getSegment(1);
+
+        compressed.clearData();
+        compressed.releaseCaches();
+
+        QCOMPARE(segment.index, (uint64_t) DataBlock::CAPACITY);
+        QCOMPARE(segment.timestamps[0], t[DataBlock::CAPACITY]);
+        QCOMPARE(segment.values[10], v[DataBlock::CAPACITY + 10]);
+
+        // Single precision values are exposed as they are stored
+        DataSeries single;
+        single.setValuePrecision(DataSeries::SINGLE_PRECISION);
+        single.addData(std::vector<double>{0, 1, 2}, std::vector<double>{0.5, 1.5, 2.5});
+
+        SeriesBuffer singleBuffer = SeriesBuffer::fromSeries(single);
+
+        QVERIFY(singleBuffer.isContiguous());
+        QVERIFY(singleBuffer.isSinglePrecision());
+        QCOMPARE(singleBuffer.getSegment(0).valuesSingle[2], 2.5f);
+
+        QVERIFY(SeriesBuffer(DataSnapshot().getView()).isContiguous());
+    }
+
+    void testTimeScaling(void)
+    {
+        const int N = DataBlock::CAPACITY + 100;
+
+        DataSeries scaled;
+
+        std::vector<double> t(N);
+        std::vector<double> v(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx * 10;
+            v[idx] = idx;
+        }
+
+        scaled.addData(t, v, false);
+        scaled.setTimeScaling(2.0, 1000, false);
+
+        // Timestamps are aligned when they are read
+        QCOMPARE(scaled.getTimestamp(5), 1100.0);
+        QCOMPARE(scaled.getOldestTimestamp(), 1000.0);
+        QCOMPARE(scaled.getValue(5), 5.0);
+
+        const DataSnapshot snapshot = scaled.getSnapshot();
+
+        QVERIFY(snapshot.hasTimeScaling());
+        QCOMPARE(snapshot.lowerBound(1100), (uint64_t) 5);
+        QCOMPARE(snapshot.lowerBound(1101), (uint64_t) 6);
+        QCOMPARE(snapshot.upperBound(1100), (uint64_t) 6);
+        QCOMPARE((*snapshot.getView().begin()).timestamp, 1000.0);
+
+        std::vector<double> timestamps(N);
+
+        snapshot.getView().copyTimestamps(timestamps.data());
+        QCOMPARE(timestamps[N - 1], t[N - 1] * 2 + 1000);
+
+        snapshot.getView().copyTimestamps(timestamps.data(), true);
+        QVERIFY(timestamps == t);
+
+        snapshot.visitBuckets(0, N, 0, [&](const DataSnapshot::Bucket& bucket) {
+            QCOMPARE(bucket.first.timestamp, bucket.first.value * 20 + 1000);
+        });
+
+        // Cursors search (and resample) in aligned time
+        DataCursor cursor = scaled.getCursor();
+
+        QCOMPARE(cursor.interpolate(1010), 0.5);
+        QCOMPARE(cursor.sampleHold(1030), 1.0);
+
+        std::vector<double> resampled(4);
+        cursor.resample(1000 + DataBlock::CAPACITY * 20, 30, 4, resampled.data());
+
+        QCOMPARE(resampled[0], (double) DataBlock::CAPACITY);
+        QCOMPARE(resampled[3], DataBlock::CAPACITY + 4.5);
+
+        // Invalid scaling is ignored
+        scaled.setTimeScaling(0, 0, false);
+        QCOMPARE(scaled.getTimeScale(), 2.0);
+
+        // A snapshot holds the scale and offset of a single update, while the scaling is being changed
+        const double scale = scaled.getTimeScale();
+        const double offset = scaled.getTimeOffset();
+
+        std::atomic<bool> done{false};
+        std::atomic<int> mixed{0};
+
+        scaled.setTimeScaling(1, 10, false);
+
+        std::thread reader([&]() {
+            while (!done.load())
+            {
+                const DataSnapshot s = scaled.getSnapshot();
+
+                // Every update below sets offset = scale * 10
+                if (s.getTimeOffset() != s.getTimeScale() * 10) mixed++;
+            }
+        });
+
+        for (int ii = 2; ii <= 10000; ii++)
+        {
+            scaled.setTimeScaling(ii, ii * 10, false);
+        }
+
+        done = true;
+        reader.join();
+
+        QCOMPARE(mixed.load(), 0);
+
+        scaled.setTimeScaling(scale, offset, false);
+
+        // A source applies its scaling to every series (including those added later)
+        DataSource source("log.csv", "Log");
+        DataSeriesPointer a(new DataSeries("A"));
+        DataSeriesPointer b(new DataSeries("B"));
+
+        a->addData(10, 1, false);
+        b->addData(10, 2, false);
+
+        source.addSeries(a, false);
+        QVERIFY(source.setTimeScaling(1.0, -5, false));
+        QVERIFY(!source.setTimeScaling(-1.0, 0, false));
+        source.addSeries(b, false);
+
+        QCOMPARE(a->getTimestamp(0), 5.0);
+        QCOMPARE(b->getTimestamp(0), 5.0);
+
+        // Changing the time scaling invalidates every sample of a previous snapshot
+        const DataSnapshot previous = a->getSnapshot();
+        uint64_t first = 0;
+        uint64_t last = 0;
+
+        QVERIFY(a->getSnapshot().getCommonRange(previous, first, last));
+
+        a->setTimeScaling(1.0, 0, false);
+
+        QVERIFY(!a->getSnapshot().getCommonRange(previous, first, last));
+    }
+
+    void testSharedTimestamps(void)
+    {
+        const int N = DataBlock::CAPACITY * 3 + 10;
+
+        // Timestamps which are not evenly spaced (so each block stores a timestamp column)
+        std::vector<double> t(N);
+        std::vector<double> a(N);
+        std::vector<double> b(N);
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t[idx] = idx + (idx % 3) * 0.1;
+            a[idx] = idx;
+            b[idx] = -idx;
+        }
+
+        DataSeriesPointer first(new DataSeries("A"));
+        DataSeriesPointer second(new DataSeries("B"));
+        DataSeriesPointer other(new DataSeries("C"));
+
+        first->addData(t, a, false);
+        second->addData(t, b, false);
+
+        t[DataBlock::CAPACITY + 5] += 0.01;
+        other->addData(t, a, false);
+
+        const uint64_t columns = second->getMemoryUsage().columns;
+
+        QVERIFY(!first->getSnapshot().hasSameTimestamps(second->getSnapshot()));
+
+        // Every full block is shared
+        QCOMPARE(second->shareTimestamps(*first), (size_t) 3);
+        QCOMPARE(second->getMemoryUsage().columns, columns - 3 * DataBlock::CAPACITY * sizeof(double));
+
+        QVERIFY(first->getSnapshot().hasSameTimestamps(second->getSnapshot()));
+        QVERIFY(!first->getSnapshot().hasSameTimestamps(other->getSnapshot()));
+
+        // Only the blocks with identical timestamps are shared
+        QCOMPARE(other->shareTimestamps(*first), (size_t) 2);
+
+        // The shared columns remain valid once the series which allocated them is cleared
+        first->clearData(false);
+
+        for (int idx = 0; idx < N; idx += 101)
+        {
+            QCOMPARE(second->getTimestamp(idx), idx + (idx % 3) * 0.1);
+            QCOMPARE(second->getValue(idx), (double) -idx);
+        }
+
+        QCOMPARE(second->getSnapshot().lowerBound(DataBlock::CAPACITY * 2 + 0.5), (uint64_t) DataBlock::CAPACITY * 2 + 1);
+
+        // Sharing is repeated for every series of a source
+        DataSource source("table.csv", "Table");
+        DataSeriesPointer x(new DataSeries("X"));
+        DataSeriesPointer y(new DataSeries("Y"));
+
+        x->addData(t, a, false);
+        y->addData(t, b, false);
+
+        source.addSeries(x, false);
+        source.addSeries(y, false);
+        source.addSeries(other, false);
+
+        // X and Y have the timestamps of C (which already shares two blocks with A)
+        QCOMPARE(source.shareTimestamps(), (size_t) 6);
+        QCOMPARE(source.shareTimestamps(), (size_t) 0);
+        QVERIFY(x->getSnapshot().hasSameTimestamps(y->getSnapshot()));
+    }
+
+    void testAggregate(void)
+    {
+        DataSeries data;
+
+        std::vector<double> t;
+        std::vector<double> v;
+
+        const int N = 3 * DataBlock::CAPACITY + 1000;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t.push_back(idx);
+            v.push_back(idx % 100);
+        }
+
+        data.addData(t, v, false);
+        data.setScaler(2.0, false);
+
+        const auto snapshot = data.getSnapshot();
+
+        // Every statistic of buckets which span several blocks
+        const int buckets = 7;
+        const auto result = data.aggregate(0, N, buckets);
+
+        QCOMPARE(result.size(), (size_t) buckets);
+        QCOMPARE(result.width, (double) N / buckets);
+
+        uint64_t total = 0;
+
+        for (int ii = 0; ii < buckets; ii++)
+        {
+            const uint64_t idx_first = snapshot.lowerBound(result.getBucketStart(ii));
+            const uint64_t idx_last = ii + 1 == buckets ? snapshot.size() : snapshot.lowerBound(result.getBucketStart(ii + 1));
+
+            const auto stats = snapshot.getStatistics(idx_first, idx_last);
+
+            QCOMPARE(result.count[ii], idx_last - idx_first);
+            QCOMPARE(result.min[ii], 0.0);
+            QCOMPARE(result.max[ii], 198.0);
+            QCOMPARE(result.mean[ii], stats.getMean());
+            QCOMPARE(result.stddev[ii], stats.getStdDev());
+            QCOMPARE(result.first[ii], snapshot.getValue(idx_first));
+            QCOMPARE(result.last[ii], snapshot.getValue(idx_last - 1));
+
+            total += result.count[ii];
+        }
+
+        QCOMPARE(total, (uint64_t) N);
+
+        // Buckets without samples
+        const auto sparse = data.aggregate(N - 10.5, N + 100, 4, DataSnapshot::AGGREGATE_COUNT | DataSnapshot::AGGREGATE_MEAN);
+
+        QCOMPARE(sparse.count[0], (uint64_t) 10);
+        QCOMPARE(sparse.count[1], (uint64_t) 0);
+        QVERIFY(std::isnan(sparse.mean[1]));
+
+        // Only the requested statistics are calculated
+        QVERIFY(sparse.min.empty());
+        QVERIFY(sparse.first.empty());
+
+        // Narrow buckets (one sample each)
+        const auto fine = data.aggregate(100, 109.5, 10, DataSnapshot::AGGREGATE_MIN | DataSnapshot::AGGREGATE_MAX);
+
+        for (int ii = 0; ii < 10; ii++)
+        {
+            QCOMPARE(fine.min[ii], 2.0 * ii);
+            QCOMPARE(fine.max[ii], 2.0 * ii);
+        }
+
+        QCOMPARE(data.aggregate(0, N, 0).size(), (size_t) 0);
+    }
+
+    void testConcatenatedSeries(void)
+    {
+        DataSeriesPointer first(new DataSeries("run_001"));
+        DataSeriesPointer second(new DataSeries("run_002"));
+
+        std::vector<double> t;
+        std::vector<double> v;
+
+        // The final block of the first input is partially filled (and may still grow)
+        const int N1 = DataBlock::CAPACITY + 1000;
+        const int N2 = 2 * DataBlock::CAPACITY;
+        const int OVERLAP = 500;
+
+        for (int idx = 0; idx < N1; idx++)
+        {
+            t.push_back(idx);
+            v.push_back(1);
+        }
+
+        first->addData(t, v, false);
+
+        t.clear();
+        v.clear();
+
+        for (int idx = 0; idx < N2; idx++)
+        {
+            t.push_back(N1 - OVERLAP + idx);
+            v.push_back(2);
+        }
+
+        second->addData(t, v, false);
+
+        // Inputs are ordered by time, rather than by the order they are provided
+        ConcatenatedSeries series("Concatenated", {second, first});
+
+        const uint64_t count = N1 + N2 - OVERLAP;
+
+        QCOMPARE(series.size(), (size_t) count);
+        QCOMPARE(series.getOldestTimestamp(), 0.0);
+        QCOMPARE(series.getNewestTimestamp(), (double) (N1 + N2 - OVERLAP - 1));
+        QCOMPARE(series.getValue(N1 - 1), 1.0);
+        QCOMPARE(series.getValue(N1), 2.0);
+
+        // The overlapping samples of the second input are omitted
+        const auto snapshot = series.getSnapshot();
+
+        QCOMPARE(snapshot.getTimestamp(N1), (double) N1);
+
+        // Every block is shared with an input, except that the overlap is trimmed from the second input
+        const auto& table = *snapshot.getTable();
+
+        QCOMPARE(table.blocks.size(), (size_t) 4);
+        QVERIFY(table.blocks[0] == first->getSnapshot().getTable()->blocks[0]);
+        QVERIFY(table.blocks[1] == first->getSnapshot().getTable()->blocks[1]);
+        QVERIFY(table.blocks[3] == second->getSnapshot().getTable()->blocks[1]);
+
+        auto segments = series.getSegments();
+
+        QCOMPARE(segments.size(), 2);
+        QCOMPARE(segments[0].input, 1);
+        QCOMPARE(segments[0].idx_last, (uint64_t) N1);
+        QCOMPARE(segments[1].input, 0);
+        QCOMPARE(segments[1].idx_first, (uint64_t) N1);
+        QCOMPARE(segments[1].t_first, (double) N1);
+
+        QCOMPARE(series.getSegmentForIndex(0), 0);
+        QCOMPARE(series.getSegmentForIndex(N1 - 1), 0);
+        QCOMPARE(series.getSegmentForIndex(N1), 1);
+        QCOMPARE(series.getSegmentForIndex(count), -1);
+
+        // Statistics span the segments
+        const auto stats = snapshot.getStatistics(0, count);
+
+        QCOMPARE(stats.count, count);
+        QCOMPARE(stats.sum, (double) N1 + 2.0 * (N2 - OVERLAP));
+        QCOMPARE(stats.min, 1.0);
+        QCOMPARE(stats.max, 2.0);
+
+        QCOMPARE(snapshot.getStatistics(N1 - 10, N1 + 10).sum, 10.0 + 20.0);
+
+        // Samples appended to the shared block of the first input are not visible until the series is rebuilt
+        first->addData((double) N1, 5.0, false);
+
+        QCOMPARE(series.size(), (size_t) count);
+        QCOMPARE(series.getSnapshot().getStatistics(0, count).max, 2.0);
+
+        // The appended sample replaces the first sample of the second input
+        series.rebuild();
+
+        QCOMPARE(series.size(), (size_t) count);
+        QCOMPARE(series.getValue(N1), 5.0);
+        QCOMPARE(series.getValue(N1 + 1), 2.0);
+        QCOMPARE(series.getSegments()[1].idx_first, (uint64_t) N1 + 1);
+
+        // Samples appended to the final input extend the series
+        second->addData((double) (N1 + N2), 3.0, false);
+        series.rebuild();
+
+        QCOMPARE(series.size(), (size_t) count + 1);
+        QCOMPARE(series.getValue(count), 3.0);
+
+        // A copy of the series is independent of the inputs
+        DataSeries copy(series);
+
+        QCOMPARE(copy.size(), (size_t) count + 1);
+        QCOMPARE(copy.getSnapshot().getStatistics(0, count + 1).sum, N1 + 5.0 + 2.0 * (N2 - OVERLAP - 1) + 3.0);
+
+        // A final block which is cut off (here by a time window) is copied, and the copy is re-used until it changes
+        second->setTimeWindow(0, N1 + N2 - 1000, false);
+        series.rebuild();
+
+        const auto tail = series.getSnapshot().getTable()->blocks.back();
+
+        QVERIFY(tail != second->getSnapshot().getTable()->blocks.back());
+        QCOMPARE(series.getNewestTimestamp(), (double) (N1 + N2 - 1000));
+
+        series.rebuild();
+
+        QVERIFY(series.getSnapshot().getTable()->blocks.back() == tail);
+
+        second->setTimeWindow(0, N1 + N2 - 900, false);
+        series.rebuild();
+
+        QVERIFY(series.getSnapshot().getTable()->blocks.back() != tail);
+        QCOMPARE(series.getNewestTimestamp(), (double) (N1 + N2 - 900));
+    }
+
+    void testTimeWindow(void)
+    {
+        DataSeries data;
+
+        std::vector<double> t;
+        std::vector<double> v;
+
+        const int N = 3 * DataBlock::CAPACITY + 1000;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            t.push_back(idx);
+            v.push_back(idx % 100);
+        }
+
+        data.addData(t, v, false);
+
+        const auto stored = data.getSnapshot();
+
+        // A window which starts part-way through a block, and ends in another block
+        const double t_min = DataBlock::CAPACITY / 2 + 0.5;
+        const double t_max = 2 * DataBlock::CAPACITY + 100;
+
+        data.setTimeWindow(t_max, t_min);
+
+        QVERIFY(data.hasTimeWindow());
+        QCOMPARE(data.getTimeWindowStart(), t_min);
+        QCOMPARE(data.getTimeWindowEnd(), t_max);
+
+        const uint64_t idx_first = DataBlock::CAPACITY / 2 + 1;
+        const uint64_t idx_last = 2 * DataBlock::CAPACITY + 101;
+
+        QCOMPARE(data.size(), (size_t) (idx_last - idx_first));
+        QCOMPARE(data.getOldestTimestamp(), (double) idx_first);
+        QCOMPARE(data.getNewestTimestamp(), t_max);
+        QCOMPARE(data.getTimestamp(0), (double) idx_first);
+        QCOMPARE(data.getValue(10), (double) ((idx_first + 10) % 100));
+
+        const auto window = data.getSnapshot();
+        const auto expected = stored.getStatistics(idx_first, idx_last);
+        const auto stats = window.getStatistics(0, window.size());
+
+        QCOMPARE(stats.count, expected.count);
+        QCOMPARE(stats.sum, expected.sum);
+        QCOMPARE(window.upperBound(t_max + 1000), window.size());
+
+        // Blocks are shared with the stored samples, and the window is only rebuilt when the samples change
+        QVERIFY(window.getTable()->blocks[1] == stored.getTable()->blocks[1]);
+        QVERIFY(data.getSnapshot().isIdentical(window));
+
+        // The stored samples are unchanged
+        QCOMPARE(data.getStoredSnapshot().size(), (uint64_t) N);
+
+        // Samples appended after the end of the window are not visible
+        data.addData(N + 1.0, 1.0, false);
+
+        QCOMPARE(data.size(), (size_t) (idx_last - idx_first));
+
+        // The window moves with the samples when the series is realigned
+        data.setTimeScaling(1.0, 1000.0, false);
+
+        QCOMPARE(data.getTimeWindowStart(), t_min + 1000);
+        QCOMPARE(data.getOldestTimestamp(), idx_first + 1000.0);
+        QCOMPARE(data.size(), (size_t) (idx_last - idx_first));
+
+        data.setTimeScaling(1.0, 0.0, false);
+
+        // Truncation applies to the stored samples
+        data.truncate(2 * DataBlock::CAPACITY, false);
+
+        QCOMPARE(data.getStoredSnapshot().size(), (uint64_t) 2 * DataBlock::CAPACITY);
+        QCOMPARE(data.size(), (size_t) (2 * DataBlock::CAPACITY - idx_first));
+
+        data.clearTimeWindow(false);
+
+        QVERIFY(!data.hasTimeWindow());
+        QCOMPARE(data.size(), (size_t) 2 * DataBlock::CAPACITY);
+
+        // A window which contains no samples
+        data.setTimeWindow(-100, -10, false);
+
+        QCOMPARE(data.size(), (size_t) 0);
+        QVERIFY(data.getSnapshot().isEmpty());
+
+        // The window of a source applies to series which are added later
+        DataSource source("test", "Test");
+
+        source.setTimeWindow(10, 20, false);
+
+        DataSeriesPointer series(new DataSeries("series"));
+        series->addData(t, v, false);
+
+        source.addSeries(series);
+
+        QCOMPARE(series->size(), (size_t) 11);
+
+        source.clearTimeWindow(false);
+
+        QCOMPARE(series->size(), (size_t) N);
+    }
+
+public slots:
+    void onDataUpdated()
+    {
+        update_count++;
+    }
+
+protected:
+
+    int update_count = 0;
+
+    DataSeries series;
+
+    // Determine if timestamp data are correctly ordered
+    bool isInOrder(void) const
+    {
+        if (series.size() <= 1) return true;
+
+        int64_t ts = series.getOldestTimestamp();
+
+        for (size_t idx = 0; idx < series.size(); idx++)
+        {
+            int64_t t = series.getTimestamp(idx);
+
+            if (t < ts) return false;
+
+            ts = t;
+        }
+
+        return true;
+    }
+
+};
+
 
 #endif // TEST_SERIES_H
@@ -3,10 +3,16 @@
 
 #include <stdlib.h>
 
+#include <thread>
+
 #include <qobject.h>
 #include <qtest.h>
 
 #include "data_source.hpp"
+#include "label_registry.hpp"
+#include "series_search_index.hpp"
+#include "spsc_ring.hpp"
+#include "telemetry_ingest.hpp"
 
 
 class DataSourceTests : public QObject
@@ -118,6 +124,273 @@ private slots:
         QCOMPARE(groups.size(), 2);
     }
 
+    void testSearchIndex(void)
+    {
+        SeriesSearchIndex index;
+
+        index.append("GPS.altitude", "Navigation");
+        index.append("GPS.latitude", "Navigation");
+        index.append("IMU.accel_x", "Sensors");
+        index.append("IMU.accel_y", "Sensors");
+        index.append("battery voltage");
+
+        QCOMPARE(index.search("").size(), 5);
+        QCOMPARE(index.search("   ").size(), 5);
+
+        // Case insensitive, anywhere within the label
+        QCOMPARE(index.search("gps"), QStringList({ "GPS.altitude", "GPS.latitude" }));
+        QCOMPARE(index.search("TITUDE"), QStringList({ "GPS.altitude", "GPS.latitude" }));
+
+        // Every pattern must match
+        QCOMPARE(index.search("gps alt"), QStringList({ "GPS.altitude" }));
+        QCOMPARE(index.search("gps zzz").size(), 0);
+
+        // Groups are also searched
+        QCOMPARE(index.search("sensors"), QStringList({ "IMU.accel_x", "IMU.accel_y" }));
+        QCOMPARE(index.search("sensors _y"), QStringList({ "IMU.accel_y" }));
+
+        // Wildcards within a pattern
+        QCOMPARE(index.search("imu*x"), QStringList({ "IMU.accel_x" }));
+        QCOMPARE(index.search("gps.?atitude"), QStringList({ "GPS.latitude" }));
+        QCOMPARE(index.search("a?c*_[x]"), QStringList({ "IMU.accel_x" }));
+
+        // Short patterns are not indexed, but still match
+        QCOMPARE(index.search("x").size(), 1);
+        QCOMPARE(index.search("ba"), QStringList({ "battery voltage" }));
+    }
+
+    void testLabelRegistry(void)
+    {
+        auto *registry = LabelRegistry::getInstance();
+
+        const auto id = registry->intern("registry.speed");
+
+        QVERIFY(id != LabelRegistry::INVALID_ID);
+        QCOMPARE(registry->intern("registry.speed"), id);
+        QCOMPARE(registry->find("registry.speed"), id);
+        QCOMPARE(registry->getLabel(id), "registry.speed");
+
+        QCOMPARE(registry->find("registry.never_added"), LabelRegistry::INVALID_ID);
+
+        // Series are found by the ID of their label
+        DataSource table("table.csv", "Table");
+
+        DataSeriesPointer speed(new DataSeries("registry.speed"));
+        DataSeriesPointer other(new DataSeries("registry.other"));
+
+        QVERIFY(table.addSeries(speed));
+        QVERIFY(table.addSeries(other));
+        QVERIFY(!table.addSeries(speed));
+
+        QCOMPARE(table.getSeriesById(id), speed);
+        QCOMPARE(table.getSeriesById(registry->find("registry.other")), other);
+        QVERIFY(table.getSeriesById(LabelRegistry::INVALID_ID).isNull());
+
+        QVERIFY(table.containsSeries(speed));
+        QVERIFY(!table.containsSeries(DataSeriesPointer(new DataSeries("registry.speed"))));
+
+        // Series are indexed in label order
+        QCOMPARE(table.getSeriesByIndex(0), other);
+        QCOMPARE(table.getSeriesByIndex(1), speed);
+
+        QVERIFY(table.removeSeries(other));
+        QVERIFY(table.getSeriesById(registry->find("registry.other")).isNull());
+        QCOMPARE(table.getSeriesByIndex(0), speed);
+
+        // A renamed series can still be removed
+        speed->setLabel("registry.renamed");
+
+        QVERIFY(table.containsSeries(speed));
+        QVERIFY(table.removeSeries(speed));
+        QCOMPARE(table.getSeriesCount(), 0);
+    }
+
+    void testLabelLookupPerformance(void)
+    {
+        DataSource table("table.csv", "Table");
+
+        QStringList labels;
+
+        for (int channel = 0; channel < 10000; channel++)
+        {
+            labels.append(QString("device.channel_%1").arg(channel));
+            table.addSeries(new DataSeries(labels.back()), false);
+        }
+
+        QCOMPARE(table.getSeriesCount(), 10000);
+        QCOMPARE(table.getSeriesByLabel("device.channel_9999")->getLabel(), "device.channel_9999");
+
+        // Labels are resolved once, and then each series is found by ID
+        QVector<LabelRegistry::Id> ids;
+
+        for (const auto &label : labels)
+        {
+            ids.append(LabelRegistry::getInstance()->find(label));
+        }
+
+        QBENCHMARK
+        {
+            for (const auto id : ids)
+            {
+                QVERIFY(!table.getSeriesById(id).isNull());
+            }
+        }
+    }
+
+    void testSearchIndexPerformance(void)
+    {
+        SeriesSearchIndex index;
+
+        for (int source = 0; source < 5; source++)
+        {
+            for (int channel = 0; channel < 2000; channel++)
+            {
+                index.append(QString("device_%1.channel_%2.value").arg(source).arg(channel), QString("group_%1").arg(channel % 20));
+            }
+        }
+
+        QCOMPARE(index.search("channel_1999").size(), 5);
+        QCOMPARE(index.search("device_3 group_7").size(), 200);
+
+        // Each keystroke of a filter
+        const QString filter = "device_2 channel_15";
+
+        QBENCHMARK
+        {
+            for (int ii = 1; ii <= filter.length(); ii++)
+            {
+                index.search(filter.left(ii));
+            }
+        }
+    }
+
+    void testSPSCRing(void)
+    {
+        SPSCRing<uint64_t> ring(1000);
+
+        QCOMPARE(ring.capacity(), size_t(1024));
+        QVERIFY(ring.empty());
+
+        // A full ring rejects (rather than overwrites) elements
+        for (uint64_t ii = 0; ii < 1024; ii++)
+        {
+            QVERIFY(ring.push(ii));
+        }
+
+        QVERIFY(!ring.push(1024));
+        QCOMPARE(ring.size(), size_t(1024));
+
+        uint64_t output[1024];
+
+        QCOMPARE(ring.pop(output, 1000), size_t(1000));
+        QCOMPARE(output[999], uint64_t(999));
+        QCOMPARE(ring.pop(output, 1000), size_t(24));
+        QCOMPARE(output[0], uint64_t(1000));
+        QCOMPARE(ring.pop(output, 1000), size_t(0));
+
+        // Elements are received in order while the producer and consumer run concurrently
+        const uint64_t count = 1000000;
+
+        std::thread producer([&]() {
+            for (uint64_t ii = 0; ii < count; ii++)
+            {
+                while (!ring.push(ii)) std::this_thread::yield();
+            }
+        });
+
+        uint64_t expected = 0;
+        bool ordered = true;
+
+        while (expected < count)
+        {
+            const size_t n = ring.pop(output, 1024);
+
+            for (size_t ii = 0; ii < n; ii++)
+            {
+                ordered &= output[ii] == expected++;
+            }
+        }
+
+        producer.join();
+
+        QVERIFY(ordered);
+        QVERIFY(ring.empty());
+    }
+
+    void testTelemetryIngest(void)
+    {
+        TelemetryIngest ingest(64);
+
+        QByteArray stream = TelemetryIngest::encodeName(7, "motor.current");
+
+        for (int ii = 0; ii < 10; ii++)
+        {
+            stream.append(TelemetryIngest::encodeSamples(ii * 10.0, {7, 300}, {ii * 1.5, -ii}));
+        }
+
+        // A partial packet is not consumed (a stream provides the remainder later)
+        const int split = stream.size() - 5;
+
+        const size_t consumed = ingest.decode(stream.constData(), split);
+
+        QVERIFY(consumed < (size_t) split);
+        QCOMPARE(ingest.getPacketCount(), uint64_t(10));
+
+        stream.remove(0, (int) consumed);
+
+        QCOMPARE(ingest.decode(stream.constData(), stream.size()), (size_t) stream.size());
+        QCOMPARE(ingest.getPacketCount(), uint64_t(11));
+        QCOMPARE(ingest.getSampleCount(), uint64_t(20));
+
+        auto names = ingest.takeNames();
+
+        QCOMPARE(names.size(), 1);
+        QCOMPARE(names.value(7), "motor.current");
+        QVERIFY(ingest.takeNames().isEmpty());
+
+        QMap<uint16_t, std::vector<double>> received;
+        double last_t = -1;
+
+        ingest.drain([&](uint16_t id, const double *t_ms, const double *values, size_t count) {
+            for (size_t ii = 0; ii < count; ii++)
+            {
+                received[id].push_back(values[ii]);
+            }
+
+            if (id == 7) last_t = t_ms[count - 1];
+        });
+
+        QCOMPARE(received.size(), 2);
+        QCOMPARE(received[7].size(), size_t(10));
+        QCOMPARE(received[7][9], 13.5);
+        QCOMPARE(received[300][4], -4.0);
+        QCOMPARE(last_t, 90.0);
+
+        // Corrupt bytes are skipped, and the following packet is still decoded
+        QByteArray corrupt("garbage");
+        corrupt.append(TelemetryIngest::encodeSamples(100, {7}, {1}));
+
+        QCOMPARE(ingest.decode(corrupt.constData(), corrupt.size()), (size_t) corrupt.size());
+        QCOMPARE(ingest.getMalformedCount(), uint64_t(1));
+
+        // Samples which do not fit in the ring of their channel are dropped
+        for (int ii = 0; ii < 100; ii++)
+        {
+            const QByteArray packet = TelemetryIngest::encodeSamples(200 + ii, {9}, {(double) ii});
+            ingest.decode(packet.constData(), packet.size());
+        }
+
+        QCOMPARE(ingest.getDroppedCount(), uint64_t(100 - 64));
+
+        size_t total = 0;
+
+        ingest.drain([&](uint16_t id, const double *t_ms, const double *values, size_t count) {
+            total += count;
+        });
+
+        QCOMPARE(total, size_t(1 + 64));
+    }
+
     // Tests for DataSourceManager class
     void testDataSourceManager(void)
     {
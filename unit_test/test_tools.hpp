@@ -0,0 +1,477 @@
+#ifndef TEST_TOOLS_HPP
+#define TEST_TOOLS_HPP
+
+#include <string.h>
+
+#include <qobject.h>
+#include <qtest.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "data_series.hpp"
+#include "lumberjack_debug.hpp"
+#include "synthetic_generator.hpp"
+#include "trace_recorder.hpp"
+#include "workspace_file.hpp"
+
+
+class ToolTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testDebugMessageLog(void)
+    {
+        std::unique_ptr<DebugMessageLog> log(new DebugMessageLog());
+
+        DebugMessageLog::Cursor cursor;
+
+        for (int idx = 0; idx < 10; idx++)
+        {
+            log->append(idx, idx % 2 ? QtWarningMsg : QtDebugMsg, QString("message %1").arg(idx));
+        }
+
+        QCOMPARE(log->getLatestSequence(), (uint64_t) 10);
+
+        // Only the selected types
+        auto messages = log->getMessages(cursor, 1 << QtWarningMsg);
+
+        QCOMPARE(messages.count(), 5);
+        QCOMPARE(messages.at(0).message, QString("message 1"));
+        QCOMPARE(messages.at(0).sequence, (uint64_t) 2);
+
+        // Messages are only returned once
+        QCOMPARE(log->getMessages(cursor, 1 << QtWarningMsg).count(), 0);
+
+        // Other types have not been read yet, and are returned in sequence
+        messages = log->getMessages(cursor, DebugMessageLog::getFullMask());
+
+        QCOMPARE(messages.count(), 5);
+        QCOMPARE(messages.at(4).message, QString("message 8"));
+
+        // Only the most recent messages are retained
+        for (size_t idx = 0; idx < DebugMessageLog::CAPACITY + 100; idx++)
+        {
+            log->append(idx, QtInfoMsg, QString("info %1").arg(idx));
+        }
+
+        messages = log->getMessages(cursor, DebugMessageLog::getFullMask());
+
+        QCOMPARE(messages.count(), (int) DebugMessageLog::CAPACITY);
+        QCOMPARE(messages.last().message, QString("info %1").arg(DebugMessageLog::CAPACITY + 99));
+
+        // Long messages are truncated
+        log->append(0, QtCriticalMsg, QString(DebugMessageLog::MAX_MESSAGE_LENGTH * 2, 'x'));
+
+        messages = log->getMessages(cursor, DebugMessageLog::getFullMask());
+
+        QCOMPARE(messages.count(), 1);
+        QCOMPARE(messages.at(0).message.length(), DebugMessageLog::MAX_MESSAGE_LENGTH);
+
+        // Cleared messages are not returned, even to a new reader
+        log->clear();
+
+        DebugMessageLog::Cursor other;
+
+        QCOMPARE(log->getMessages(other, DebugMessageLog::getFullMask()).count(), 0);
+
+        // Concurrent writers
+        const int THREADS = 4;
+        const int COUNT = 500;
+
+        std::vector<std::thread> writers;
+
+        for (int thread = 0; thread < THREADS; thread++)
+        {
+            writers.emplace_back([&log, thread]() {
+                for (int idx = 0; idx < COUNT; idx++)
+                {
+                    log->append(idx, QtDebugMsg, QString("thread %1").arg(thread));
+                }
+            });
+        }
+
+        for (auto &writer : writers)
+        {
+            writer.join();
+        }
+
+        messages = log->getMessages(other, DebugMessageLog::getFullMask());
+
+        QCOMPARE(messages.count(), THREADS * COUNT);
+
+        for (int idx = 1; idx < messages.count(); idx++)
+        {
+            QVERIFY(messages.at(idx).sequence > messages.at(idx - 1).sequence);
+        }
+
+        // A reader which runs while the writers wrap around the buffer never receives a message twice
+        std::atomic<bool> done{false};
+
+        writers.clear();
+
+        for (int thread = 0; thread < THREADS; thread++)
+        {
+            writers.emplace_back([&log, thread]() {
+                for (int idx = 0; idx < 20 * COUNT; idx++)
+                {
+                    log->append(idx, QtDebugMsg, QString("thread %1").arg(thread));
+                }
+            });
+        }
+
+        // (a message may be returned after a newer message, which was recorded in its type ring first)
+        std::set<uint64_t> received;
+        int repeated = 0;
+
+        std::thread reader([&]() {
+            while (!done.load())
+            {
+                for (const auto& message : log->getMessages(other, DebugMessageLog::getFullMask()))
+                {
+                    if (!received.insert(message.sequence).second) repeated++;
+                }
+            }
+        });
+
+        for (auto &writer : writers)
+        {
+            writer.join();
+        }
+
+        done = true;
+        reader.join();
+
+        QCOMPARE(repeated, 0);
+    }
+
+    void testTraceRecorder(void)
+    {
+        auto *recorder = TraceRecorder::getInstance();
+
+        recorder->setEnabled(false);
+        recorder->clear();
+
+        {
+            TRACE_SCOPE("Disabled", "test");
+        }
+
+        QCOMPARE(recorder->getEventCount(), (size_t) 0);
+
+        recorder->setEnabled(true);
+
+        const int THREADS = 4;
+        const int SPANS = 1000;
+
+        std::vector<std::thread> threads;
+
+        for (int idx = 0; idx < THREADS; idx++)
+        {
+            threads.emplace_back([]() {
+                for (int span = 0; span < SPANS; span++)
+                {
+                    TRACE_SCOPE("Outer", "test");
+                    TRACE_SCOPE("Inner \"quoted\"", "test");
+                }
+            });
+        }
+
+        for (auto &thread : threads) thread.join();
+
+        QCOMPARE(recorder->getEventCount(), (size_t) (THREADS * SPANS * 2));
+
+        const QByteArray trace = recorder->toChromeTrace();
+
+        QVERIFY(trace.startsWith("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+        QVERIFY(trace.contains("\"name\":\"Outer\",\"cat\":\"test\""));
+        QVERIFY(trace.contains("\"name\":\"Inner \\\"quoted\\\"\""));
+        QVERIFY(trace.contains("\"name\":\"thread_name\""));
+        QVERIFY(!trace.contains("Disabled"));
+
+        // The oldest events of a full buffer are overwritten
+        for (size_t span = 0; span < TraceRecorder::EVENTS_PER_THREAD + 100; span++)
+        {
+            TRACE_SCOPE("Overflow", "test");
+        }
+
+        QCOMPARE(recorder->getEventCount(), (size_t) (THREADS * SPANS * 2) + TraceRecorder::EVENTS_PER_THREAD);
+
+        recorder->setEnabled(false);
+        recorder->clear();
+
+        QCOMPARE(recorder->getEventCount(), (size_t) 0);
+    }
+
+    void testSyntheticGenerator(void)
+    {
+        SyntheticGenerator::Options options;
+
+        options.channels = 4;
+        options.rate = 1000;
+        options.duration = 200;
+        options.jitter = 0.2;
+        options.gapFraction = 0.1;
+        options.gapLength = 0.5;
+        options.outOfOrderFraction = 0.01;
+        options.nanFraction = 0.02;
+        options.seed = 1234;
+
+        SyntheticGenerator generator(options);
+        SyntheticGenerator repeat(options);
+
+        options.seed++;
+        SyntheticGenerator other(options);
+
+        QCOMPARE(generator.getRowCount(), (uint64_t) 200000);
+        QCOMPARE(generator.getChunkCount(), (uint64_t) 4);
+
+        std::vector<double> t, t_repeat, t_other;
+        std::vector<double> v, v_repeat;
+
+        uint64_t rows = 0;
+        uint64_t swapped = 0;
+        uint64_t nans = 0;
+        uint64_t values[4] = {0, 0, 0, 0};
+
+        bool different = false;
+
+        for (uint64_t chunk = 0; chunk < generator.getChunkCount(); chunk++)
+        {
+            generator.generateTimestamps(chunk, t);
+            repeat.generateTimestamps(chunk, t_repeat);
+            other.generateTimestamps(chunk, t_other);
+
+            // The same options always generate the same dataset
+            QVERIFY(t == t_repeat);
+            different |= t != t_other;
+
+            rows += t.size();
+
+            for (size_t idx = 1; idx < t.size(); idx++)
+            {
+                swapped += t[idx] < t[idx - 1];
+            }
+
+            for (int channel = 0; channel < 4; channel++)
+            {
+                generator.generateValues(chunk, channel, t, v);
+                repeat.generateValues(chunk, channel, t, v_repeat);
+
+                QCOMPARE(v.size(), t.size());
+                QVERIFY(memcmp(v.data(), v_repeat.data(), v.size() * sizeof(double)) == 0);
+
+                for (double value : v)
+                {
+                    nans += std::isnan(value);
+                    values[channel] += !std::isnan(value);
+                }
+            }
+        }
+
+        QVERIFY(different);
+
+        // Approximately 10% of the timeline is within gaps, 1% of samples are swapped and 2% of values are NaN
+        QVERIFY(rows > 170000 && rows < 190000);
+        QVERIFY(swapped > rows / 200 && swapped < rows / 50);
+        QVERIFY(nans > rows * 4 / 100 && nans < rows * 12 / 100);
+
+        // Series are sorted by timestamp, and omit the NaN values
+        const auto series = generator.generateSeries();
+
+        QCOMPARE(series.count(), 4);
+
+        for (int channel = 0; channel < 4; channel++)
+        {
+            const DataSnapshot snapshot = series.at(channel)->getSnapshot();
+
+            QCOMPARE(snapshot.size(), values[channel]);
+
+            double previous = -INFINITY;
+            bool ordered = true;
+
+            for (const DataPoint point : snapshot.getView())
+            {
+                ordered &= point.timestamp >= previous;
+                previous = point.timestamp;
+            }
+
+            QVERIFY(ordered);
+        }
+
+        // Files contain a row (or a message) for every timestamp
+        QTemporaryDir dir;
+        QStringList errors;
+
+        QVERIFY(generator.writeFile(dir.filePath("synthetic.csv"), errors));
+        QVERIFY(generator.writeFile(dir.filePath("synthetic.bin"), errors));
+        QVERIFY(!generator.writeFile(dir.filePath("synthetic.txt"), errors));
+
+        QFile csv(dir.filePath("synthetic.csv"));
+        QVERIFY(csv.open(QIODevice::ReadOnly));
+
+        QCOMPARE(csv.readLine().trimmed(), QByteArray("time,Channel 0,Channel 1,Channel 2,Channel 3"));
+        QCOMPARE((uint64_t) csv.readAll().count('\n'), rows);
+
+        // The formats of FMT and one message type, then a message of 3 + 8 + 4 * 4 bytes for each timestamp
+        QCOMPARE((uint64_t) QFileInfo(dir.filePath("synthetic.bin")).size(), 2 * 89 + rows * 27);
+    }
+
+    void testWorkspaceFile(void)
+    {
+        QTemporaryDir dir;
+
+        const QString filename = dir.filePath("session.ljws");
+
+        WorkspaceFile::Workspace workspace;
+
+        DataSourcePointer source(new DataSource("log.csv", "Log", "Imported log"));
+
+        DataSeriesPointer a(new DataSeries("Group", "A"));
+        DataSeriesPointer b(new DataSeries("B"));
+
+        const int N = DataBlock::CAPACITY * 2 + 17;
+
+        for (int idx = 0; idx < N; idx++)
+        {
+            a->addData(idx * 10, sin(idx * 0.01), false);
+            b->addData(idx * 5 + 0.5, idx % 7, false);
+        }
+
+        a->setUnits("V");
+        a->setColor(QColor(10, 20, 30));
+        a->setScaler(2, false);
+        a->setOffset(-1, false);
+        b->setValuePrecision(DataSeries::SINGLE_PRECISION);
+
+        source->addSeries(a, false);
+        source->addSeries(b, false);
+        source->setTimeScaling(1.5, 100, false);
+
+        workspace.sources.append(source);
+        workspace.mathSource = "Math Traces";
+
+        QMap<QString, DataSeriesPointer> mapping;
+        mapping["a"] = a;
+        mapping["b"] = b;
+
+        MathDataSeriesPointer sum(new MathDataSeries("Sum", "a + b", mapping));
+        sum->addData(1, 2, false);
+        sum->addData(2, 3, false);
+
+        QMap<QString, DataSeriesPointer> derived;
+        derived["s"] = sum;
+
+        MathDataSeriesPointer lazy(new MathDataSeries("Double", "s * 2", derived));
+        lazy->setLazy(true);
+
+        // Traces are stored after the traces they depend on
+        workspace.mathTraces.append(lazy);
+        workspace.mathTraces.append(sum);
+
+        WorkspaceFile::PlotState plot;
+
+        plot.curves.append({"Log", "A", 2});
+        plot.markers.append({15.0, 0});
+        plot.markers.append({25.0, -1});
+        plot.t_min = 10;
+        plot.t_max = 20;
+        plot.yGrid = false;
+        plot.downsampleMode = 2;
+
+        workspace.plots.append(plot);
+        workspace.windowState = QByteArray("layout");
+
+        QStringList errors;
+
+        QVERIFY(WorkspaceFile::save(filename, workspace, errors));
+        QVERIFY(errors.isEmpty());
+
+        WorkspaceFile::Workspace loaded;
+
+        QVERIFY(WorkspaceFile::load(filename, loaded, errors));
+        QVERIFY(errors.isEmpty());
+
+        QCOMPARE(loaded.sources.size(), 1);
+        QCOMPARE(loaded.sources[0]->getLabel(), QString("Log"));
+        QCOMPARE(loaded.sources[0]->getSource(), QString("log.csv"));
+        QCOMPARE(loaded.sources[0]->getSeriesCount(), 2);
+        QCOMPARE(loaded.sources[0]->getTimeScale(), 1.5);
+        QCOMPARE(loaded.sources[0]->getTimeOffset(), 100.0);
+
+        auto la = loaded.sources[0]->getSeriesByLabel("A");
+        auto lb = loaded.sources[0]->getSeriesByLabel("B");
+
+        QVERIFY(la && lb);
+
+        // Samples are only read once they are used
+        QVERIFY(!la->isLoaded());
+        QVERIFY(!lb->isLoaded());
+
+        QCOMPARE(la->getGroup(), QString("Group"));
+        QCOMPARE(la->getUnits(), QString("V"));
+        QCOMPARE(la->getColor(), QColor(10, 20, 30));
+        QCOMPARE(la->getScaler(), 2.0);
+        QCOMPARE(lb->getValuePrecision(), DataSeries::SINGLE_PRECISION);
+
+        QCOMPARE(la->size(), (size_t) N);
+        QVERIFY(la->isLoaded());
+        QVERIFY(!lb->isLoaded());
+
+        for (int idx = 0; idx < N; idx += 97)
+        {
+            QCOMPARE(la->getTimestamp(idx), a->getTimestamp(idx));
+            QCOMPARE(la->getValue(idx), a->getValue(idx));
+            QCOMPARE(lb->getValue(idx), b->getValue(idx));
+        }
+
+        QCOMPARE(loaded.mathTraces.size(), 2);
+        QCOMPARE(loaded.mathTraces[0]->getLabel(), QString("Sum"));
+        QCOMPARE(loaded.mathTraces[0]->getExpression(), QString("a + b"));
+        QCOMPARE(loaded.mathTraces[0]->getInputSeries("a"), la);
+        QCOMPARE(loaded.mathTraces[0]->size(), (size_t) 2);
+
+        QVERIFY(loaded.mathTraces[1]->isLazy());
+        QCOMPARE(loaded.mathTraces[1]->getInputSeries("s"), (DataSeriesPointer) loaded.mathTraces[0]);
+        QCOMPARE(loaded.mathTraces[1]->size(), (size_t) 0);
+
+        QCOMPARE(loaded.plots.size(), 1);
+        QCOMPARE(loaded.plots[0].curves.size(), 1);
+        QCOMPARE(loaded.plots[0].curves[0].series, QString("A"));
+        QCOMPARE(loaded.plots[0].curves[0].axis, 2);
+        QCOMPARE(loaded.plots[0].markers.size(), 2);
+        QCOMPARE(loaded.plots[0].markers[1].curve, -1);
+        QCOMPARE(loaded.plots[0].t_max, 20.0);
+        QVERIFY(!loaded.plots[0].yGrid);
+        QCOMPARE(loaded.plots[0].downsampleMode, 2);
+        QCOMPARE(loaded.windowState, QByteArray("layout"));
+
+        // Saving over the workspace the series were loaded from
+        QVERIFY(WorkspaceFile::save(filename, loaded, errors));
+        QVERIFY(lb->isLoaded());
+
+        WorkspaceFile::Workspace reloaded;
+
+        QVERIFY(WorkspaceFile::load(filename, reloaded, errors));
+        QCOMPARE(reloaded.sources[0]->getSeriesByLabel("B")->size(), (size_t) N);
+
+        // A file which is not a workspace is rejected
+        QVERIFY(!WorkspaceFile::load(dir.filePath("missing.ljws"), loaded, errors));
+
+        QFile other(dir.filePath("other.ljws"));
+        QVERIFY(other.open(QIODevice::WriteOnly));
+        other.write("LJICxxxx");
+        other.close();
+
+        QVERIFY(!WorkspaceFile::load(other.fileName(), loaded, errors));
+    }
+};
+
+
+#endif // TEST_TOOLS_HPP
@@ -1,6 +1,8 @@
-QT += core gui testlib
+QT += core gui opengl testlib widgets
 
-CONFIG += c++11 console
+greaterThan(QT_MAJOR_VERSION, 5): QT += openglwidgets
+
+CONFIG += c++17 console
 CONFIG += testcase
 
 CONFIG -= app_bundle
@@ -30,21 +32,146 @@ CONFIG (debug, debug|release) {
 INCLUDEPATH += ../qwt/src
 
 INCLUDEPATH += ../src
+INCLUDEPATH += ../src/widgets
+INCLUDEPATH += ../src/plugins
+INCLUDEPATH += ../plugins/csv_importer
+INCLUDEPATH += ../plugins/mavlink_importer
+
+# Optional decompression libraries (the tests of each format only run if it is supported)
+include(../src/decompression.pri)
 
 SOURCES += \
+    ../src/arrow_file.cpp \
+    ../src/concatenated_series.cpp \
+    ../src/correlation_engine.cpp \
+    ../src/data_block.cpp \
+    ../src/data_codec.cpp \
+    ../src/data_kernels.cpp \
+    ../src/data_store.cpp \
     ../src/data_series.cpp \
     ../src/data_source.cpp \
+    ../src/decompression_device.cpp \
+    ../src/event_index.cpp \
+    ../src/event_store.cpp \
+    ../src/filter_chain.cpp \
+    ../src/fft_engine.cpp \
+    ../src/fft_sampler.cpp \
+    ../src/gpu_compute.cpp \
+    ../src/histogram_engine.cpp \
+    ../src/hover_lookup.cpp \
+    ../src/import_arena.cpp \
+    ../src/import_cache.cpp \
+    ../src/import_sink.cpp \
+    ../src/label_registry.cpp \
+    ../src/lumberjack_debug.cpp \
+    ../src/math_data_series.cpp \
+    ../src/math_dependency_graph.cpp \
+    ../src/math_expression_parser.cpp \
+    ../src/math_sampler.cpp \
+    ../src/math_trace_cache.cpp \
+    ../src/math_trace_computer.cpp \
+    ../src/parallel_for.cpp \
+    ../src/parse_kernels.cpp \
     ../src/plot_curve.cpp \
+    ../src/plot_opengl_canvas.cpp \
+    ../src/plot_performance.cpp \
+    ../src/plugins/plugin_filter.cpp \
+    ../src/plugins/plugin_importer.cpp \
+    ../src/quantile_sketch.cpp \
+    ../src/series_buffer.cpp \
+    ../src/series_file.cpp \
+    ../src/series_envelope.cpp \
+    ../src/series_search_index.cpp \
+    ../src/series_update_scheduler.cpp \
+    ../src/spectrogram_sampler.cpp \
+    ../src/stats_engine.cpp \
+    ../src/synthetic_generator.cpp \
+    ../src/telemetry_ingest.cpp \
+    ../src/text_export_pipeline.cpp \
+    ../src/time_alignment.cpp \
+    ../src/trace_recorder.cpp \
+    ../src/workspace_file.cpp \
+    ../src/widgets/plot_sampler.cpp \
+    ../plugins/csv_importer/import_options_dialog.cpp \
+    ../plugins/csv_importer/lumberjack_csv_importer.cpp \
+    ../plugins/mavlink_importer/mavlink_importer.cpp \
     main.cpp \
 
 HEADERS += \
+    ../src/arrow_file.hpp \
+    ../src/concatenated_series.hpp \
+    ../src/correlation_engine.hpp \
+    ../src/data_block.hpp \
+    ../src/data_codec.hpp \
+    ../src/data_kernels.hpp \
+    ../src/data_store.hpp \
     ../src/data_series.hpp \
     ../src/data_source.hpp \
+    ../src/decompression_device.hpp \
+    ../src/event_index.hpp \
+    ../src/event_store.hpp \
+    ../src/filter_chain.hpp \
+    ../src/fft_engine.hpp \
+    ../src/fft_sampler.hpp \
+    ../src/gpu_compute.hpp \
+    ../src/histogram_engine.hpp \
+    ../src/hover_lookup.hpp \
+    ../src/import_arena.hpp \
+    ../src/import_cache.hpp \
+    ../src/import_sink.hpp \
+    ../src/label_registry.hpp \
+    ../src/lumberjack_debug.hpp \
+    ../src/math_data_series.hpp \
+    ../src/math_dependency_graph.hpp \
+    ../src/math_expression_parser.hpp \
+    ../src/math_sampler.hpp \
+    ../src/math_trace_cache.hpp \
+    ../src/math_trace_computer.hpp \
+    ../src/parallel_for.hpp \
+    ../src/parse_kernels.hpp \
     ../src/lumberjack_version.hpp \
     ../src/plot_curve.hpp \
+    ../src/plot_opengl_canvas.hpp \
+    ../src/plot_performance.hpp \
+    ../src/cancellation_token.hpp \
+    ../src/plugins/plugin_base.hpp \
+    ../src/plugins/plugin_filter.hpp \
+    ../src/plugins/plugin_importer.hpp \
+    ../src/quantile_sketch.hpp \
+    ../src/series_buffer.hpp \
+    ../src/series_file.hpp \
+    ../src/series_envelope.hpp \
+    ../src/series_search_index.hpp \
+    ../src/series_update_scheduler.hpp \
+    ../src/spectrogram_sampler.hpp \
+    ../src/spsc_ring.hpp \
+    ../src/stats_engine.hpp \
+    ../src/synthetic_generator.hpp \
+    ../src/telemetry_ingest.hpp \
+    ../src/text_export_pipeline.hpp \
+    ../src/time_alignment.hpp \
+    ../src/time_ticks.hpp \
+    ../src/trace_recorder.hpp \
+    ../src/workspace_file.hpp \
+    ../src/widgets/plot_sampler.hpp \
+    ../plugins/csv_importer/csv_import_options.hpp \
+    ../plugins/csv_importer/import_options_dialog.hpp \
+    ../plugins/csv_importer/lumberjack_csv_importer.hpp \
+    ../plugins/mavlink_importer/mavlink_importer.hpp \
+    test_analysis.hpp \
     test_curve.hpp \
+    test_exporter.hpp \
+    test_fft.hpp \
+    test_importer.hpp \
+    test_math.hpp \
+    test_performance.hpp \
     test_series.hpp \
-    test_source.hpp
+    test_source.hpp \
+    test_tools.hpp
+
+# The CSV importer is used by the importer tests and the performance gates
+FORMS += \
+    ../plugins/csv_importer/ui/csv_import_options.ui
 
 # Generate coverage data
 QMAKE_CXXFLAGS += --coverage